@@ -0,0 +1,110 @@
+﻿//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+
+#include "pch.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace LogMonitorTests
+{
+    ///
+    /// Tests the growth and shrinking of the AdaptiveReadBuffer.
+    ///
+    TEST_CLASS(AdaptiveReadBufferTests)
+    {
+    public:
+
+        ///
+        /// Check that the buffer doubles when reads fill it, and stops at
+        /// the maximum size.
+        ///
+        TEST_METHOD(TestBufferGrowsUpToMaxSize)
+        {
+            const DWORD maxSize = 5 * AdaptiveReadBuffer::MIN_SIZE_BYTES;
+            AdaptiveReadBuffer buffer(maxSize);
+
+            Assert::AreEqual(AdaptiveReadBuffer::MIN_SIZE_BYTES, buffer.Size());
+
+            buffer.BeginReadPass();
+
+            buffer.RecordRead(buffer.Size());
+            Assert::AreEqual(2 * AdaptiveReadBuffer::MIN_SIZE_BYTES, buffer.Size());
+
+            //
+            // A read that doesn't fill the buffer doesn't change its size.
+            //
+            buffer.RecordRead(buffer.Size() - 1);
+            Assert::AreEqual(2 * AdaptiveReadBuffer::MIN_SIZE_BYTES, buffer.Size());
+
+            buffer.RecordRead(buffer.Size());
+            Assert::AreEqual(4 * AdaptiveReadBuffer::MIN_SIZE_BYTES, buffer.Size());
+
+            buffer.RecordRead(buffer.Size());
+            Assert::AreEqual(maxSize, buffer.Size());
+
+            buffer.RecordRead(buffer.Size());
+            Assert::AreEqual(maxSize, buffer.Size());
+
+            //
+            // The pass used the buffer, so it keeps its size.
+            //
+            buffer.EndReadPass();
+            Assert::AreEqual(maxSize, buffer.Size());
+
+            Assert::IsNotNull(buffer.Data());
+        }
+
+        ///
+        /// Check that the buffer is halved after each quiet pass, down to
+        /// the minimum size.
+        ///
+        TEST_METHOD(TestBufferShrinksWhenQuiet)
+        {
+            AdaptiveReadBuffer buffer(8 * AdaptiveReadBuffer::MIN_SIZE_BYTES);
+
+            buffer.BeginReadPass();
+            while (buffer.Size() < buffer.MaxSize())
+            {
+                buffer.Data();
+                buffer.RecordRead(buffer.Size());
+            }
+            buffer.EndReadPass();
+
+            Assert::AreEqual(8 * AdaptiveReadBuffer::MIN_SIZE_BYTES, buffer.Size());
+
+            const DWORD expectedSizes[] = {
+                4 * AdaptiveReadBuffer::MIN_SIZE_BYTES,
+                2 * AdaptiveReadBuffer::MIN_SIZE_BYTES,
+                AdaptiveReadBuffer::MIN_SIZE_BYTES,
+                AdaptiveReadBuffer::MIN_SIZE_BYTES
+            };
+
+            for (DWORD expectedSize : expectedSizes)
+            {
+                buffer.BeginReadPass();
+                buffer.RecordRead(10);
+                buffer.RecordRead(0);
+                buffer.EndReadPass();
+
+                Assert::AreEqual(expectedSize, buffer.Size());
+            }
+        }
+
+        ///
+        /// Check that the maximum size is adjusted to the supported range.
+        ///
+        TEST_METHOD(TestMaxSizeIsAdjusted)
+        {
+            AdaptiveReadBuffer buffer(1);
+            Assert::AreEqual(AdaptiveReadBuffer::MIN_SIZE_BYTES, buffer.MaxSize());
+
+            buffer.SetMaxSize(MAXDWORD);
+            Assert::AreEqual(AdaptiveReadBuffer::MAX_SIZE_BYTES, buffer.MaxSize());
+
+            buffer.SetMaxSize(AdaptiveReadBuffer::DEFAULT_MAX_SIZE_BYTES);
+            Assert::AreEqual(AdaptiveReadBuffer::DEFAULT_MAX_SIZE_BYTES, buffer.MaxSize());
+        }
+    };
+}
@@ -0,0 +1,524 @@
+﻿//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+
+#include "pch.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace LogMonitorTests
+{
+    ///
+    /// Tests of the Lz4BlockCodec, BlockSpoolWriter and BlockSpoolReader
+    /// classes, and of the compressed RotatingFileSink.
+    ///
+    TEST_CLASS(BlockSpoolTests)
+    {
+        std::wstring m_directory;
+
+        static std::string ReadFileContent(
+            _In_ const std::wstring& Path
+            )
+        {
+            std::ifstream file(Path, std::ios::binary);
+
+            return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        }
+
+        static void WriteFileContent(
+            _In_ const std::wstring& Path,
+            _In_ const std::string& Content
+            )
+        {
+            std::ofstream file(Path, std::ios::binary);
+
+            file.write(Content.data(), Content.size());
+        }
+
+        ///
+        /// Lines like the ones of an IIS log, with a few varying fields.
+        ///
+        static std::string MakeIisLines(
+            _In_ size_t Count
+            )
+        {
+            std::string lines;
+
+            for (size_t i = 0; i < Count; i++)
+            {
+                lines += "2024-05-14 10:" + std::to_string(10 + i / 600 % 50) + ":" + std::to_string(10 + i / 10 % 50)
+                    + " 172.17.0.2 GET /api/orders/" + std::to_string(i * 7919 % 100000)
+                    + " - 80 - 172.17.0.1 Mozilla/5.0+(Windows+NT+10.0;+Win64;+x64) - "
+                    + ((i % 13 == 0) ? "404" : "200") + " 0 0 " + std::to_string(i * 31 % 1000) + "\n";
+            }
+
+            return lines;
+        }
+
+        ///
+        /// Lines like the ones of the ETW source in XML.
+        ///
+        static std::string MakeEtwLines(
+            _In_ size_t Count
+            )
+        {
+            std::string lines;
+
+            for (size_t i = 0; i < Count; i++)
+            {
+                lines += "<Source>EtwEvent</Source><Time>2024-05-14T10:11:" + std::to_string(10 + i % 50)
+                    + ".000Z</Time><LogEntry><ProviderName>Microsoft-Windows-WinINet</ProviderName>"
+                    + "<ProviderId>43D1A55C-76D6-4F7E-995C-64C711E5CAFE</ProviderId><Level>Information</Level>"
+                    + "<PID>" + std::to_string(1000 + i % 17) + "</PID><TID>" + std::to_string(2000 + i % 101)
+                    + "</TID><KeyWords>0x4000000000000000</KeyWords><EventId>" + std::to_string(i % 300)
+                    + "</EventId><EventData><Request>" + std::to_string(i * 2654435761U) + "</Request></EventData></LogEntry>\n";
+            }
+
+            return lines;
+        }
+
+        static void AssertRoundTrip(
+            _In_ BlockCodec& Codec,
+            _In_ const std::string& Data
+            )
+        {
+            std::vector<char> compressed(Codec.GetMaxCompressedSize(Data.size()));
+            const size_t compressedSize = Codec.Compress(Data.data(), Data.size(), compressed.data(), compressed.size());
+
+            Assert::IsTrue(compressedSize > 0);
+            Assert::IsTrue(compressedSize <= compressed.size());
+
+            std::string decompressed(Data.size(), '\0');
+
+            Assert::IsTrue(Codec.Decompress(compressed.data(), compressedSize, &decompressed[0], decompressed.size()));
+            Assert::IsTrue(Data == decompressed);
+        }
+
+        static std::string ReadAllBlocks(
+            _In_ const std::wstring& Path
+            )
+        {
+            BlockSpoolReader reader(Path);
+            std::string lines;
+            std::string block;
+            DWORD status;
+
+            Assert::AreEqual(static_cast<DWORD>(ERROR_SUCCESS), reader.Open());
+
+            while ((status = reader.ReadBlock(block)) == ERROR_SUCCESS)
+            {
+                lines += block;
+            }
+
+            Assert::AreEqual(static_cast<DWORD>(ERROR_HANDLE_EOF), status);
+
+            return lines;
+        }
+
+    public:
+
+        TEST_METHOD_INITIALIZE(InitializeBlockSpoolTest)
+        {
+            m_directory = CreateTempDirectory();
+            Assert::IsFalse(m_directory.empty());
+        }
+
+        TEST_METHOD_CLEANUP(CleanupBlockSpoolTest)
+        {
+            WIN32_FIND_DATAW findData;
+            HANDLE find = FindFirstFileW((m_directory + L"\\*").c_str(), &findData);
+
+            if (find != INVALID_HANDLE_VALUE)
+            {
+                do
+                {
+                    DeleteFileW((m_directory + L"\\" + findData.cFileName).c_str());
+                } while (FindNextFileW(find, &findData));
+
+                FindClose(find);
+            }
+
+            RemoveDirectoryW(m_directory.c_str());
+        }
+
+        ///
+        /// Check that the codec decompresses what it compressed, for inputs
+        /// shorter than a match, runs that overlap their own output, and
+        /// bytes that don't compress.
+        ///
+        TEST_METHOD(TestLz4RoundTrip)
+        {
+            std::unique_ptr<BlockCodec> codec = BlockCodec::Create(CompressionCodec::Lz4);
+
+            Assert::IsTrue(codec != nullptr);
+            Assert::IsTrue(codec->GetId() == CompressionCodec::Lz4);
+            Assert::IsTrue(BlockCodec::Create(CompressionCodec::None) == nullptr);
+
+            AssertRoundTrip(*codec, "");
+            AssertRoundTrip(*codec, "a");
+            AssertRoundTrip(*codec, "line 1\n");
+            AssertRoundTrip(*codec, std::string(100000, 'x'));
+            AssertRoundTrip(*codec, std::string(1000, 'a') + "b" + std::string(1000, 'a'));
+            AssertRoundTrip(*codec, MakeIisLines(1000));
+            AssertRoundTrip(*codec, MakeEtwLines(1000));
+
+            std::string random(200000, '\0');
+            UINT32 seed = 12345;
+
+            for (char& c : random)
+            {
+                seed = seed * 1103515245 + 12345;
+                c = static_cast<char>(seed >> 16);
+            }
+
+            AssertRoundTrip(*codec, random);
+
+            //
+            // Matches more than 64 KB apart can't be referenced.
+            //
+            AssertRoundTrip(*codec, random.substr(0, 70000) + random.substr(0, 70000));
+        }
+
+        ///
+        /// Check that a truncated or corrupted block is rejected.
+        ///
+        TEST_METHOD(TestLz4InvalidBlock)
+        {
+            Lz4BlockCodec codec;
+            const std::string data = MakeIisLines(100);
+
+            std::vector<char> compressed(codec.GetMaxCompressedSize(data.size()));
+            const size_t compressedSize = codec.Compress(data.data(), data.size(), compressed.data(), compressed.size());
+            std::string decompressed(data.size(), '\0');
+
+            Assert::IsFalse(codec.Decompress(compressed.data(), compressedSize - 1, &decompressed[0], decompressed.size()));
+            Assert::IsFalse(codec.Decompress(compressed.data(), compressedSize, &decompressed[0], decompressed.size() - 1));
+            Assert::IsFalse(codec.Decompress(compressed.data(), 0, &decompressed[0], decompressed.size()));
+
+            //
+            // An offset before the start of the block.
+            //
+            const char badOffset[] = { 0x10, 'a', 0x10, 0x00, 0x50, 'a', 'a', 'a', 'a', 'a' };
+
+            Assert::IsFalse(codec.Decompress(badOffset, sizeof(badOffset), &decompressed[0], 10));
+
+            //
+            // The destination must be large enough for the compressor.
+            //
+            Assert::AreEqual(static_cast<size_t>(0), codec.Compress(data.data(), data.size(), compressed.data(), 16));
+        }
+
+        ///
+        /// Check that the blocks hold whole lines, and that a line longer
+        /// than a block gets a block of its own.
+        ///
+        TEST_METHOD(TestSpoolBlocks)
+        {
+            BlockSpoolWriter spool(BlockCodec::Create(CompressionCodec::Lz4), BlockSpoolWriter::MIN_BLOCK_BYTES, 60000);
+            const std::string lines = MakeIisLines(500);
+            const std::string longLine = std::string(3 * BlockSpoolWriter::MIN_BLOCK_BYTES, 'L') + "\n";
+            std::string output;
+
+            for (size_t offset = 0; offset < lines.size(); offset += 1000)
+            {
+                spool.Append(lines.data() + offset, (std::min)(lines.size() - offset, static_cast<size_t>(1000)), output);
+            }
+
+            spool.Append(longLine.data(), longLine.size(), output);
+
+            Assert::IsTrue(spool.GetStatistics().Blocks > 1);
+
+            spool.Append("last line\n", 10, output);
+
+            Assert::AreEqual(static_cast<size_t>(10), spool.GetBufferedBytes());
+
+            spool.Flush(output);
+
+            Assert::AreEqual(static_cast<size_t>(0), spool.GetBufferedBytes());
+            Assert::AreEqual(static_cast<UINT64>(output.size()), spool.GetStatistics().CompressedBytes);
+
+            Lz4BlockCodec codec;
+            std::string decompressed;
+            size_t offset = 0;
+            bool foundLongLine = false;
+
+            while (offset < output.size())
+            {
+                BlockHeader header;
+
+                Assert::IsTrue(header.Parse(output.data() + offset));
+                offset += BlockHeader::SIZE;
+
+                std::string block(header.UncompressedSize, '\0');
+
+                if ((header.Flags & BlockHeader::FLAG_STORED) != 0)
+                {
+                    block.assign(output.data() + offset, header.StoredSize);
+                }
+                else
+                {
+                    Assert::IsTrue(codec.Decompress(output.data() + offset, header.StoredSize, &block[0], block.size()));
+                }
+
+                Assert::IsTrue(block.back() == '\n');
+                Assert::IsTrue(block.size() <= BlockSpoolWriter::MIN_BLOCK_BYTES || block == longLine);
+
+                foundLongLine = foundLongLine || block == longLine;
+                decompressed += block;
+                offset += header.StoredSize;
+            }
+
+            Assert::IsTrue(foundLongLine);
+            Assert::IsTrue(lines + longLine + "last line\n" == decompressed);
+        }
+
+        ///
+        /// Check that the reader can start at any block.
+        ///
+        TEST_METHOD(TestReaderSeekToBlock)
+        {
+            const std::wstring path = m_directory + L"\\output.lz4";
+            BlockSpoolWriter spool(BlockCodec::Create(CompressionCodec::Lz4), BlockSpoolWriter::MIN_BLOCK_BYTES);
+            std::string output;
+            std::vector<std::string> blocks;
+
+            for (int i = 0; i < 5; i++)
+            {
+                blocks.push_back("block " + std::to_string(i) + "\n" + MakeIisLines(10));
+                spool.Append(blocks.back().data(), blocks.back().size(), output);
+                spool.Flush(output);
+            }
+
+            WriteFileContent(path, output);
+
+            BlockSpoolReader reader(path);
+            std::string lines;
+
+            Assert::AreEqual(static_cast<DWORD>(ERROR_SUCCESS), reader.Open());
+
+            Assert::AreEqual(static_cast<DWORD>(ERROR_SUCCESS), reader.SeekToBlock(3));
+            Assert::AreEqual(static_cast<DWORD>(ERROR_SUCCESS), reader.ReadBlock(lines));
+            Assert::AreEqual(blocks[3].c_str(), lines.c_str());
+            Assert::AreEqual(static_cast<DWORD>(ERROR_SUCCESS), reader.ReadBlock(lines));
+            Assert::AreEqual(blocks[4].c_str(), lines.c_str());
+            Assert::AreEqual(static_cast<DWORD>(ERROR_HANDLE_EOF), reader.ReadBlock(lines));
+
+            Assert::AreEqual(static_cast<DWORD>(ERROR_SUCCESS), reader.SeekToBlock(0));
+            Assert::AreEqual(static_cast<DWORD>(ERROR_SUCCESS), reader.ReadBlock(lines));
+            Assert::AreEqual(blocks[0].c_str(), lines.c_str());
+
+            Assert::AreEqual(static_cast<DWORD>(ERROR_HANDLE_EOF), reader.SeekToBlock(6));
+
+            reader.Close();
+
+            //
+            // A truncated last block is reported as invalid.
+            //
+            WriteFileContent(path, output.substr(0, output.size() - 1));
+
+            Assert::AreEqual(static_cast<DWORD>(ERROR_SUCCESS), reader.Open());
+            Assert::AreEqual(static_cast<DWORD>(ERROR_SUCCESS), reader.SeekToBlock(4));
+            Assert::AreEqual(static_cast<DWORD>(ERROR_INVALID_DATA), reader.ReadBlock(lines));
+        }
+
+        ///
+        /// Check that the compressed file sink writes blocks, and rotates an
+        /// existing file written in the other format.
+        ///
+        TEST_METHOD(TestCompressedFileSink)
+        {
+            const std::wstring path = m_directory + L"\\output.log";
+
+            WriteFileContent(path, "plain line\n");
+
+            const std::string lines = MakeIisLines(1000);
+
+            {
+                RotatingFileSink sink(path, 0, 0, 1);
+
+                sink.SetCompression(BlockCodec::Create(CompressionCodec::Lz4));
+
+                Assert::AreEqual(static_cast<DWORD>(ERROR_SUCCESS), sink.Open());
+                Assert::AreEqual(static_cast<DWORD>(ERROR_SUCCESS), sink.Write(lines.data(), lines.size()));
+                Assert::AreEqual(static_cast<DWORD>(ERROR_SUCCESS), sink.Flush());
+
+                Assert::AreEqual(1ULL, sink.GetRotations());
+                Assert::IsTrue(sink.GetFileSize() < lines.size() / 2);
+            }
+
+            Assert::AreEqual("plain line\n", ReadFileContent(path + L".1").c_str());
+            Assert::IsTrue(lines == ReadAllBlocks(path));
+
+            //
+            // A compressed file is appended to, and the destructor writes the
+            // last block.
+            //
+            {
+                RotatingFileSink sink(path, 0, 0, 1);
+
+                sink.SetCompression(BlockCodec::Create(CompressionCodec::Lz4));
+
+                Assert::AreEqual(static_cast<DWORD>(ERROR_SUCCESS), sink.Write("last line\n", 10));
+                Assert::AreEqual(0ULL, sink.GetRotations());
+            }
+
+            Assert::IsTrue(lines + "last line\n" == ReadAllBlocks(path));
+        }
+
+        ///
+        /// Check that the LogWriter writes the last block when it stops.
+        ///
+        TEST_METHOD(TestLogWriterCompressedFileSink)
+        {
+            const std::wstring path = m_directory + L"\\output.log";
+
+            {
+                auto sink = std::make_unique<RotatingFileSink>(path);
+                sink->SetCompression(BlockCodec::Create(CompressionCodec::Lz4));
+
+                LogWriter writer;
+
+                writer.SetFileSink(std::move(sink), false);
+
+                Assert::IsTrue(writer.Start(0));
+
+                for (int i = 0; i < 100; i++)
+                {
+                    writer.WriteConsoleLog("line " + std::to_string(i));
+                }
+
+                writer.Stop();
+            }
+
+            std::string expected;
+
+            for (int i = 0; i < 100; i++)
+            {
+                expected += "line " + std::to_string(i) + "\n";
+            }
+
+            Assert::AreEqual(expected.c_str(), ReadAllBlocks(path).c_str());
+        }
+
+        ///
+        /// Check that the LogWriter writes a block that got too old while no
+        /// other line was written.
+        ///
+        TEST_METHOD(TestLogWriterFlushesIdleBlock)
+        {
+            const std::wstring path = m_directory + L"\\output.log";
+            const DWORD maxWaitMillis = 10 * BlockSpoolWriter::DEFAULT_MAX_BLOCK_AGE_MILLIS;
+
+            {
+                auto sink = std::make_unique<RotatingFileSink>(path);
+                sink->SetCompression(BlockCodec::Create(CompressionCodec::Lz4));
+
+                LogWriter writer;
+
+                writer.SetFileSink(std::move(sink), false);
+
+                Assert::IsTrue(writer.Start(0));
+
+                writer.WriteConsoleLog("first line");
+                writer.WriteConsoleLog("last line");
+
+                //
+                // No other batch comes, so only the idle writer can write
+                // the block.
+                //
+                const ULONGLONG start = GetTickCount64();
+
+                while (ReadFileContent(path).empty() && GetTickCount64() - start < maxWaitMillis)
+                {
+                    Sleep(50);
+                }
+
+                Assert::AreEqual("first line\nlast line\n", ReadAllBlocks(path).c_str());
+
+                writer.Stop();
+            }
+        }
+
+        ///
+        /// Report the ratio and the speed of the codec on IIS and ETW lines,
+        /// with the default block size.
+        ///
+        TEST_METHOD(TestCompressionBenchmark)
+        {
+            const std::pair<const char*, std::string> inputs[] = {
+                { "IIS", MakeIisLines(100000) },
+                { "ETW", MakeEtwLines(50000) }
+            };
+
+            LARGE_INTEGER frequency;
+            QueryPerformanceFrequency(&frequency);
+
+            for (const auto& input : inputs)
+            {
+                const std::string& lines = input.second;
+                BlockSpoolWriter spool(BlockCodec::Create(CompressionCodec::Lz4));
+                std::string output;
+
+                output.reserve(lines.size());
+
+                spool.Append(lines.data(), lines.size(), output);
+                spool.Flush(output);
+
+                const BlockSpoolWriter::Statistics& statistics = spool.GetStatistics();
+
+                Assert::AreEqual(static_cast<UINT64>(lines.size()), statistics.UncompressedBytes);
+
+                //
+                // Decompress all the blocks, as a reader would.
+                //
+                Lz4BlockCodec codec;
+                std::string block;
+                LARGE_INTEGER start;
+                LARGE_INTEGER end;
+                size_t decompressed = 0;
+
+                QueryPerformanceCounter(&start);
+
+                for (size_t offset = 0; offset < output.size();)
+                {
+                    BlockHeader header;
+
+                    Assert::IsTrue(header.Parse(output.data() + offset));
+                    offset += BlockHeader::SIZE;
+
+                    block.resize(header.UncompressedSize);
+
+                    Assert::IsTrue(codec.Decompress(output.data() + offset, header.StoredSize, &block[0], block.size()));
+
+                    decompressed += block.size();
+                    offset += header.StoredSize;
+                }
+
+                QueryPerformanceCounter(&end);
+
+                Assert::AreEqual(lines.size(), decompressed);
+
+                const double megabytes = lines.size() / (1024.0 * 1024.0);
+                const double compressSeconds = (std::max)(statistics.CompressMicroseconds, 1ULL) / 1000000.0;
+                const double decompressSeconds = (std::max)(end.QuadPart - start.QuadPart, 1LL)
+                    / static_cast<double>(frequency.QuadPart);
+                const double ratio = static_cast<double>(statistics.UncompressedBytes) / statistics.CompressedBytes;
+
+                Logger::WriteMessage(
+                    FORMAT_STRING(
+                        L"%S lines: %.1f MB in %llu blocks, ratio %.2f, compress %.0f MB/s, decompress %.0f MB/s\n",
+                        input.first,
+                        megabytes,
+                        statistics.Blocks,
+                        ratio,
+                        megabytes / compressSeconds,
+                        megabytes / decompressSeconds
+                    ).c_str()
+                );
+
+                Assert::IsTrue(ratio > 2.0);
+            }
+        }
+    };
+}
@@ -0,0 +1,78 @@
+﻿//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+
+#include "pch.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace LogMonitorTests
+{
+    ///
+    /// Tests the keys of the LogFileMonitor path tables.
+    ///
+    TEST_CLASS(CaseFoldedPathTests)
+    {
+    public:
+
+        ///
+        /// Check that paths that only differ in case are the same key.
+        ///
+        TEST_METHOD(TestPathsDifferingInCaseAreEqual)
+        {
+            const CaseFoldedPath lower(L"logs\\sub\\app.log");
+            const CaseFoldedPath mixed(L"Logs\\SUB\\App.Log");
+
+            Assert::IsTrue(lower == mixed);
+            Assert::AreEqual(lower.Hash(), mixed.Hash());
+            Assert::AreEqual(L"LOGS\\SUB\\APP.LOG", lower.Folded().c_str());
+
+            //
+            // Non ASCII characters are folded too.
+            //
+            const CaseFoldedPath accentLower(L"café.log");
+            const CaseFoldedPath accentUpper(L"CAFÉ.LOG");
+
+            Assert::IsTrue(accentLower == accentUpper);
+            Assert::AreEqual(accentLower.Hash(), accentUpper.Hash());
+        }
+
+        ///
+        /// Check that different paths are different keys.
+        ///
+        TEST_METHOD(TestDifferentPathsAreNotEqual)
+        {
+            Assert::IsTrue(CaseFoldedPath(L"app1.log") != CaseFoldedPath(L"app2.log"));
+            Assert::IsTrue(CaseFoldedPath(L"app.log") != CaseFoldedPath(L"app.log.1"));
+            Assert::IsTrue(CaseFoldedPath(L"") != CaseFoldedPath(L"a"));
+            Assert::IsTrue(CaseFoldedPath(L"") == CaseFoldedPath(L""));
+        }
+
+        ///
+        /// Check the lookup of paths in an unordered map, with many entries.
+        ///
+        TEST_METHOD(TestUnorderedMapLookup)
+        {
+            std::unordered_map<CaseFoldedPath, size_t, CaseFoldedPath::Hasher> paths;
+            const size_t count = 10000;
+
+            for (size_t i = 0; i < count; i++)
+            {
+                paths[std::wstring(L"dir\\file") + std::to_wstring(i) + L".log"] = i;
+            }
+
+            Assert::AreEqual(count, paths.size());
+
+            for (size_t i = 0; i < count; i++)
+            {
+                auto it = paths.find(std::wstring(L"DIR\\FILE") + std::to_wstring(i) + L".LOG");
+
+                Assert::IsTrue(it != paths.end());
+                Assert::AreEqual(i, it->second);
+            }
+
+            Assert::IsTrue(paths.find(std::wstring(L"dir\\file.log")) == paths.end());
+        }
+    };
+}
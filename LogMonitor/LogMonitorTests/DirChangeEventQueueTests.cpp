@@ -0,0 +1,165 @@
+﻿//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+
+#include "pch.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace LogMonitorTests
+{
+    ///
+    /// Tests the directory change event queue of the log file monitors.
+    ///
+    TEST_CLASS(DirChangeEventQueueTests)
+    {
+        static DirChangeNotificationEvent MakeEvent(
+            _In_ const std::wstring& FileName,
+            _In_ EventAction Action,
+            _In_ UINT64 Timestamp
+            )
+        {
+            DirChangeNotificationEvent event;
+
+            event.FileName = FileName;
+            event.Action = Action;
+            event.Timestamp = Timestamp;
+
+            return event;
+        }
+
+    public:
+
+        ///
+        /// Check that repeated Modify events of a file are folded into the
+        /// first one, which keeps its position and takes the newest timestamp.
+        ///
+        TEST_METHOD(TestModifyEventsAreCoalesced)
+        {
+            DirChangeEventQueue queue;
+            std::vector<DirChangeNotificationEvent> events;
+
+            Assert::IsTrue(queue.Push(MakeEvent(L"a.log", EventAction::Modify, 1)));
+            Assert::IsFalse(queue.Push(MakeEvent(L"b.log", EventAction::Modify, 2)));
+            Assert::IsFalse(queue.Push(MakeEvent(L"A.LOG", EventAction::Modify, 3)));
+            Assert::IsFalse(queue.Push(MakeEvent(L"a.log", EventAction::Modify, 4)));
+
+            Assert::AreEqual(static_cast<size_t>(2), queue.Size());
+
+            queue.PopAll(events);
+
+            Assert::IsTrue(queue.Empty());
+            Assert::AreEqual(static_cast<size_t>(2), events.size());
+            Assert::AreEqual(L"a.log", events[0].FileName.c_str());
+            Assert::AreEqual(static_cast<UINT64>(4), events[0].Timestamp);
+            Assert::AreEqual(L"b.log", events[1].FileName.c_str());
+
+            const DirChangeEventQueue::Statistics& statistics = queue.GetStatistics();
+
+            Assert::AreEqual(static_cast<UINT64>(4), statistics.Pushed);
+            Assert::AreEqual(static_cast<UINT64>(2), statistics.Coalesced);
+            Assert::AreEqual(static_cast<size_t>(2), statistics.MaxDepth);
+
+            //
+            // The queue is empty again, so the next event notifies the consumer.
+            //
+            Assert::IsTrue(queue.Push(MakeEvent(L"a.log", EventAction::Modify, 5)));
+        }
+
+        ///
+        /// Check that Modify events aren't folded across other events of the
+        /// same file, or across a ReInit event.
+        ///
+        TEST_METHOD(TestModifyEventsKeepOrderWithOtherEvents)
+        {
+            DirChangeEventQueue queue;
+            std::vector<DirChangeNotificationEvent> events;
+
+            queue.Push(MakeEvent(L"a.log", EventAction::Modify, 1));
+            queue.Push(MakeEvent(L"a.log", EventAction::Remove, 2));
+            queue.Push(MakeEvent(L"a.log", EventAction::Add, 3));
+            queue.Push(MakeEvent(L"a.log", EventAction::Modify, 4));
+            queue.Push(MakeEvent(L"", EventAction::ReInit, 5));
+            queue.Push(MakeEvent(L"a.log", EventAction::Modify, 6));
+            queue.Push(MakeEvent(L"a.log", EventAction::RenameOld, 7));
+            queue.Push(MakeEvent(L"a.log", EventAction::Modify, 8));
+
+            queue.PopAll(events);
+
+            const EventAction expected[] = {
+                EventAction::Modify,
+                EventAction::Remove,
+                EventAction::Add,
+                EventAction::Modify,
+                EventAction::ReInit,
+                EventAction::Modify,
+                EventAction::RenameOld,
+                EventAction::Modify
+            };
+
+            Assert::AreEqual(_countof(expected), events.size());
+
+            for (size_t i = 0; i < events.size(); i++)
+            {
+                Assert::AreEqual(static_cast<int>(expected[i]), static_cast<int>(events[i].Action));
+                Assert::AreEqual(static_cast<UINT64>(i + 1), events[i].Timestamp);
+            }
+
+            Assert::AreEqual(static_cast<UINT64>(0), queue.GetStatistics().Coalesced);
+        }
+
+        ///
+        /// Check that a full queue is replaced by a single ReInit event.
+        ///
+        TEST_METHOD(TestOverflowReplacesEventsWithReInit)
+        {
+            DirChangeEventQueue queue(4);
+            std::vector<DirChangeNotificationEvent> events;
+
+            for (UINT64 i = 0; i < 4; i++)
+            {
+                queue.Push(MakeEvent(L"file" + std::to_wstring(i) + L".log", EventAction::Add, i));
+            }
+
+            Assert::AreEqual(static_cast<size_t>(4), queue.Size());
+            Assert::AreEqual(static_cast<UINT64>(0), queue.GetStatistics().Overflows);
+
+            Assert::IsFalse(queue.Push(MakeEvent(L"file4.log", EventAction::Add, 4)));
+
+            Assert::AreEqual(static_cast<size_t>(1), queue.Size());
+            Assert::AreEqual(static_cast<UINT64>(1), queue.GetStatistics().Overflows);
+            Assert::AreEqual(static_cast<size_t>(4), queue.GetStatistics().MaxDepth);
+
+            //
+            // Events after the overflow are queued after the ReInit event.
+            //
+            queue.Push(MakeEvent(L"file0.log", EventAction::Modify, 5));
+            queue.PopAll(events);
+
+            Assert::AreEqual(static_cast<size_t>(2), events.size());
+            Assert::AreEqual(static_cast<int>(EventAction::ReInit), static_cast<int>(events[0].Action));
+            Assert::AreEqual(static_cast<int>(EventAction::Modify), static_cast<int>(events[1].Action));
+        }
+
+        ///
+        /// Check that Clear drops the pending events and the folding state.
+        ///
+        TEST_METHOD(TestClear)
+        {
+            DirChangeEventQueue queue;
+            std::vector<DirChangeNotificationEvent> events;
+
+            queue.Push(MakeEvent(L"a.log", EventAction::Modify, 1));
+            queue.Clear();
+
+            Assert::IsTrue(queue.Empty());
+            Assert::IsTrue(queue.Push(MakeEvent(L"a.log", EventAction::Modify, 2)));
+
+            queue.PopAll(events);
+
+            Assert::AreEqual(static_cast<size_t>(1), events.size());
+            Assert::AreEqual(static_cast<UINT64>(2), events[0].Timestamp);
+        }
+    };
+}
@@ -0,0 +1,507 @@
+﻿//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+
+#include "pch.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace LogMonitorTests
+{
+    ///
+    /// Tests of the DurableQueue class.
+    ///
+    TEST_CLASS(DurableQueueTests)
+    {
+        std::wstring m_directory;
+
+        static std::string ReadFileContent(
+            _In_ const std::wstring& Path
+            )
+        {
+            std::ifstream file(Path, std::ios::binary);
+
+            return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        }
+
+        static void WriteFileContent(
+            _In_ const std::wstring& Path,
+            _In_ const std::string& Content
+            )
+        {
+            std::ofstream file(Path, std::ios::binary | std::ios::trunc);
+
+            file.write(Content.data(), Content.size());
+        }
+
+        ///
+        /// Appends the records "<Prefix><index>", from First, as one batch.
+        ///
+        static void AppendBatch(
+            _In_ DurableQueue& Queue,
+            _In_ int First,
+            _In_ int Count,
+            _In_ const std::string& Prefix = "record "
+            )
+        {
+            std::string records;
+            std::vector<size_t> ends;
+
+            for (int i = First; i < First + Count; i++)
+            {
+                records += Prefix + std::to_string(i);
+                ends.push_back(records.size());
+            }
+
+            Assert::AreEqual(static_cast<DWORD>(ERROR_SUCCESS), Queue.Append(records.data(), ends));
+        }
+
+        ///
+        /// Reads the unread records, in batches of MaxRecords and MaxBytes.
+        ///
+        static std::vector<std::string> ReadAll(
+            _In_ DurableQueue& Queue,
+            _In_ size_t MaxRecords = 100,
+            _In_ size_t MaxBytes = 1024 * 1024
+            )
+        {
+            std::vector<std::string> result;
+            std::string records;
+            std::vector<size_t> ends;
+
+            for (;;)
+            {
+                Assert::AreEqual(static_cast<DWORD>(ERROR_SUCCESS), Queue.Read(MaxRecords, MaxBytes, records, ends));
+
+                if (ends.empty())
+                {
+                    break;
+                }
+
+                Assert::IsTrue(ends.size() <= MaxRecords);
+                Assert::IsTrue(ends.size() == 1 || records.size() <= MaxBytes);
+
+                size_t start = 0;
+
+                for (const size_t end : ends)
+                {
+                    result.push_back(records.substr(start, end - start));
+                    start = end;
+                }
+            }
+
+            return result;
+        }
+
+        ///
+        /// Path of the segment with the highest sequence.
+        ///
+        std::wstring LastSegmentPath() const
+        {
+            WIN32_FIND_DATAW findData;
+            HANDLE find = FindFirstFileW((m_directory + L"\\*.lmq").c_str(), &findData);
+            std::wstring last;
+
+            Assert::IsTrue(find != INVALID_HANDLE_VALUE);
+
+            do
+            {
+                if (last.empty() || wcscmp(findData.cFileName, last.c_str()) > 0)
+                {
+                    last = findData.cFileName;
+                }
+            } while (FindNextFileW(find, &findData));
+
+            FindClose(find);
+
+            return m_directory + L"\\" + last;
+        }
+
+        void RemoveFiles() const
+        {
+            WIN32_FIND_DATAW findData;
+            HANDLE find = FindFirstFileW((m_directory + L"\\*").c_str(), &findData);
+
+            if (find != INVALID_HANDLE_VALUE)
+            {
+                do
+                {
+                    DeleteFileW((m_directory + L"\\" + findData.cFileName).c_str());
+                } while (FindNextFileW(find, &findData));
+
+                FindClose(find);
+            }
+        }
+
+    public:
+
+        TEST_METHOD_INITIALIZE(InitializeDurableQueueTest)
+        {
+            m_directory = CreateTempDirectory();
+            Assert::IsFalse(m_directory.empty());
+        }
+
+        TEST_METHOD_CLEANUP(CleanupDurableQueueTest)
+        {
+            RemoveFiles();
+            RemoveDirectoryW(m_directory.c_str());
+        }
+
+        ///
+        /// Check that the records are read in order, in batches of the max
+        /// records, and read again after a rewind.
+        ///
+        TEST_METHOD(TestAppendRead)
+        {
+            DurableQueue queue(m_directory);
+
+            Assert::AreEqual(static_cast<DWORD>(ERROR_SUCCESS), queue.Open());
+            Assert::IsFalse(queue.HasUnreadRecords());
+
+            AppendBatch(queue, 0, 10);
+            AppendBatch(queue, 10, 5);
+
+            Assert::IsTrue(queue.HasUnreadRecords());
+
+            auto records = ReadAll(queue, 4);
+
+            Assert::AreEqual(static_cast<size_t>(15), records.size());
+
+            for (int i = 0; i < 15; i++)
+            {
+                Assert::AreEqual(("record " + std::to_string(i)).c_str(), records[i].c_str());
+            }
+
+            Assert::IsFalse(queue.HasUnreadRecords());
+
+            queue.Rewind();
+
+            Assert::AreEqual(static_cast<size_t>(15), ReadAll(queue).size());
+
+            Assert::AreEqual(static_cast<DWORD>(ERROR_SUCCESS), queue.Acknowledge());
+            Assert::AreEqual(15ULL, queue.GetStatistics().AcknowledgedRecords);
+
+            queue.Rewind();
+
+            Assert::IsFalse(queue.HasUnreadRecords());
+        }
+
+        ///
+        /// Check that the records after the acknowledged cursor are read
+        /// again after a restart, and only those.
+        ///
+        TEST_METHOD(TestReplayAfterRestart)
+        {
+            {
+                DurableQueue queue(m_directory);
+
+                AppendBatch(queue, 0, 15);
+            }
+
+            std::string records;
+            std::vector<size_t> ends;
+
+            {
+                DurableQueue queue(m_directory);
+
+                Assert::AreEqual(static_cast<DWORD>(ERROR_SUCCESS), queue.Open());
+                Assert::AreEqual(15ULL, queue.GetStatistics().ReplayedRecords);
+
+                Assert::AreEqual(static_cast<DWORD>(ERROR_SUCCESS), queue.Read(6, 1024 * 1024, records, ends));
+                Assert::AreEqual(static_cast<size_t>(6), ends.size());
+                Assert::AreEqual(static_cast<DWORD>(ERROR_SUCCESS), queue.Acknowledge());
+
+                //
+                // Read, but not acknowledged.
+                //
+                Assert::AreEqual(static_cast<DWORD>(ERROR_SUCCESS), queue.Read(3, 1024 * 1024, records, ends));
+            }
+
+            {
+                DurableQueue queue(m_directory);
+
+                Assert::AreEqual(static_cast<DWORD>(ERROR_SUCCESS), queue.Open());
+                Assert::AreEqual(9ULL, queue.GetStatistics().ReplayedRecords);
+
+                auto replayed = ReadAll(queue);
+
+                Assert::AreEqual(static_cast<size_t>(9), replayed.size());
+                Assert::AreEqual("record 6", replayed[0].c_str());
+
+                AppendBatch(queue, 15, 1);
+
+                replayed = ReadAll(queue);
+
+                Assert::AreEqual(static_cast<size_t>(1), replayed.size());
+                Assert::AreEqual("record 15", replayed[0].c_str());
+                Assert::AreEqual(static_cast<DWORD>(ERROR_SUCCESS), queue.Acknowledge());
+            }
+
+            DurableQueue queue(m_directory);
+
+            Assert::AreEqual(static_cast<DWORD>(ERROR_SUCCESS), queue.Open());
+            Assert::AreEqual(0ULL, queue.GetStatistics().ReplayedRecords);
+            Assert::IsFalse(queue.HasUnreadRecords());
+        }
+
+        ///
+        /// Check that a record torn by a crash, and the bytes after it, are
+        /// ignored and overwritten by the next batch.
+        ///
+        TEST_METHOD(TestTornRecord)
+        {
+            {
+                DurableQueue queue(m_directory);
+
+                AppendBatch(queue, 0, 3);
+            }
+
+            const std::wstring segmentPath = LastSegmentPath();
+            const std::string segment = ReadFileContent(segmentPath);
+
+            WriteFileContent(segmentPath, segment.substr(0, segment.size() - 2));
+
+            {
+                DurableQueue queue(m_directory);
+
+                Assert::AreEqual(static_cast<DWORD>(ERROR_SUCCESS), queue.Open());
+                Assert::AreEqual(2ULL, queue.GetStatistics().ReplayedRecords);
+
+                AppendBatch(queue, 100, 2);
+
+                const auto records = ReadAll(queue);
+
+                Assert::AreEqual(static_cast<size_t>(4), records.size());
+                Assert::AreEqual("record 0", records[0].c_str());
+                Assert::AreEqual("record 1", records[1].c_str());
+                Assert::AreEqual("record 100", records[2].c_str());
+                Assert::AreEqual("record 101", records[3].c_str());
+            }
+
+            //
+            // Bytes of a batch that was only partly written.
+            //
+            WriteFileContent(segmentPath, ReadFileContent(segmentPath) + std::string(100, '\x5A'));
+
+            DurableQueue queue(m_directory);
+
+            Assert::AreEqual(static_cast<DWORD>(ERROR_SUCCESS), queue.Open());
+            Assert::AreEqual(4ULL, queue.GetStatistics().ReplayedRecords);
+        }
+
+        ///
+        /// Check that all the records are read again when the cursor file
+        /// is corrupted.
+        ///
+        TEST_METHOD(TestCorruptCursor)
+        {
+            {
+                DurableQueue queue(m_directory);
+
+                AppendBatch(queue, 0, 20);
+
+                Assert::AreEqual(static_cast<size_t>(10), ReadAll(queue, 10).size());
+                Assert::AreEqual(static_cast<DWORD>(ERROR_SUCCESS), queue.Acknowledge());
+            }
+
+            WriteFileContent(m_directory + L"\\cursor", std::string(22, 'x'));
+
+            DurableQueue queue(m_directory);
+
+            Assert::AreEqual(static_cast<DWORD>(ERROR_SUCCESS), queue.Open());
+            Assert::AreEqual(20ULL, queue.GetStatistics().ReplayedRecords);
+            Assert::AreEqual(static_cast<size_t>(20), ReadAll(queue).size());
+        }
+
+        ///
+        /// Check that the acknowledged segments are recycled, so the queue
+        /// keeps a few files however many records go through it.
+        ///
+        TEST_METHOD(TestRecycleSegments)
+        {
+            const std::string padding(200, 'p');
+
+            {
+                DurableQueue queue(m_directory, 1024 * 1024, DurableQueue::MIN_SEGMENT_BYTES);
+                int next = 0;
+
+                for (int round = 0; round < 200; round++)
+                {
+                    AppendBatch(queue, next, 50, padding);
+
+                    const auto records = ReadAll(queue);
+
+                    Assert::AreEqual(static_cast<size_t>(50), records.size());
+                    Assert::AreEqual((padding + std::to_string(next)).c_str(), records[0].c_str());
+                    Assert::AreEqual(static_cast<DWORD>(ERROR_SUCCESS), queue.Acknowledge());
+
+                    next += 50;
+                }
+
+                Assert::IsTrue(queue.GetStatistics().RecycledSegments > 10);
+                Assert::IsTrue(queue.GetSegmentCount() <= 2);
+            }
+
+            WIN32_FIND_DATAW findData;
+            HANDLE find = FindFirstFileW((m_directory + L"\\*").c_str(), &findData);
+            size_t files = 0;
+
+            Assert::IsTrue(find != INVALID_HANDLE_VALUE);
+
+            do
+            {
+                if ((findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) == 0)
+                {
+                    files++;
+                }
+            } while (FindNextFileW(find, &findData));
+
+            FindClose(find);
+
+            //
+            // The cursor, the segments and the spare segments.
+            //
+            Assert::IsTrue(files <= 1 + 2 + DurableQueue::MAX_RECYCLED_SEGMENTS);
+
+            //
+            // The old records of a reused spare segment aren't read.
+            //
+            DurableQueue queue(m_directory, 1024 * 1024, DurableQueue::MIN_SEGMENT_BYTES);
+
+            Assert::AreEqual(static_cast<DWORD>(ERROR_SUCCESS), queue.Open());
+            Assert::AreEqual(0ULL, queue.GetStatistics().ReplayedRecords);
+
+            AppendBatch(queue, 0, 3);
+
+            Assert::AreEqual(static_cast<size_t>(3), ReadAll(queue).size());
+        }
+
+        ///
+        /// Check that the oldest segments are dropped to stay under the max
+        /// bytes, with the records that weren't read, and that the newest
+        /// records are kept.
+        ///
+        TEST_METHOD(TestMaxBytes)
+        {
+            const UINT64 maxBytes = 1024 * 1024;
+            const std::string padding(1000, 'c');
+            DurableQueue queue(m_directory, maxBytes, DurableQueue::MIN_SEGMENT_BYTES);
+            int next = 0;
+
+            AppendBatch(queue, next, 10, padding);
+            next += 10;
+
+            //
+            // The cursors are in the first segment when it's dropped.
+            //
+            std::string records;
+            std::vector<size_t> ends;
+
+            Assert::AreEqual(static_cast<DWORD>(ERROR_SUCCESS), queue.Read(3, 1024 * 1024, records, ends));
+            Assert::AreEqual(static_cast<DWORD>(ERROR_SUCCESS), queue.Acknowledge());
+
+            for (int i = 0; i < 100; i++)
+            {
+                AppendBatch(queue, next, 20, padding);
+                next += 20;
+            }
+
+            Assert::IsTrue(queue.GetQueuedBytes() <= maxBytes);
+
+            const UINT64 dropped = queue.GetStatistics().DroppedRecords;
+            const auto unread = ReadAll(queue);
+
+            Assert::IsTrue(dropped > 0);
+            Assert::AreEqual(static_cast<UINT64>(next - 3), unread.size() + dropped);
+            Assert::AreEqual((padding + std::to_string(3 + dropped)).c_str(), unread.front().c_str());
+            Assert::AreEqual((padding + std::to_string(next - 1)).c_str(), unread.back().c_str());
+        }
+
+        ///
+        /// Check that a record larger than the read buffer and the max batch
+        /// bytes is read alone.
+        ///
+        TEST_METHOD(TestLargeRecord)
+        {
+            const std::string large(3 * 1024 * 1024, 'L');
+
+            {
+                DurableQueue queue(m_directory, DurableQueue::DEFAULT_MAX_BYTES, 1024 * 1024);
+                const std::vector<size_t> ends{ large.size() };
+
+                Assert::AreEqual(static_cast<DWORD>(ERROR_SUCCESS), queue.Append(large.data(), ends));
+
+                AppendBatch(queue, 0, 2);
+
+                const auto records = ReadAll(queue, 100, 1024);
+
+                Assert::AreEqual(static_cast<size_t>(3), records.size());
+                Assert::IsTrue(large == records[0]);
+            }
+
+            DurableQueue queue(m_directory, DurableQueue::DEFAULT_MAX_BYTES, 1024 * 1024);
+            const auto records = ReadAll(queue);
+
+            Assert::AreEqual(3ULL, queue.GetStatistics().ReplayedRecords);
+            Assert::AreEqual(static_cast<size_t>(3), records.size());
+            Assert::IsTrue(large == records[0]);
+            Assert::AreEqual("record 1", records[2].c_str());
+        }
+
+        ///
+        /// Report the sustained write rate of batches of IIS-like lines, over
+        /// several segments.
+        ///
+        TEST_METHOD(TestWriteThroughput)
+        {
+            const std::string line = "2024-05-14 10:11:12 172.17.0.2 GET /api/orders/12345 - 80 - 172.17.0.1 "
+                "Mozilla/5.0+(Windows+NT+10.0;+Win64;+x64) - 200 0 0 31";
+            const int batches = 4000;
+            std::string records;
+            std::vector<size_t> ends;
+
+            for (DWORD i = 0; i < NetworkSink::DEFAULT_MAX_BATCH_RECORDS; i++)
+            {
+                records += line;
+                ends.push_back(records.size());
+            }
+
+            DurableQueue queue(m_directory, 256 * 1024 * 1024);
+
+            Assert::AreEqual(static_cast<DWORD>(ERROR_SUCCESS), queue.Open());
+
+            LARGE_INTEGER frequency;
+            LARGE_INTEGER start;
+            LARGE_INTEGER end;
+
+            QueryPerformanceFrequency(&frequency);
+            QueryPerformanceCounter(&start);
+
+            for (int i = 0; i < batches; i++)
+            {
+                Assert::AreEqual(static_cast<DWORD>(ERROR_SUCCESS), queue.Append(records.data(), ends));
+            }
+
+            QueryPerformanceCounter(&end);
+
+            const double seconds = (std::max)(end.QuadPart - start.QuadPart, 1LL) / static_cast<double>(frequency.QuadPart);
+            const double megabytes = static_cast<double>(records.size()) * batches / (1024.0 * 1024.0);
+            const UINT64 appended = queue.GetStatistics().AppendedRecords;
+
+            Logger::WriteMessage(
+                FORMAT_STRING(
+                    L"Queue writes: %.0f MB in %llu records, %.0f MB/s, %.0f records/s, %llu segments, %llu records dropped\n",
+                    megabytes,
+                    appended,
+                    megabytes / seconds,
+                    appended / seconds,
+                    static_cast<UINT64>(queue.GetSegmentCount()),
+                    queue.GetStatistics().DroppedRecords
+                ).c_str()
+            );
+
+            Assert::AreEqual(static_cast<UINT64>(ends.size()) * batches, appended);
+        }
+    };
+}
@@ -0,0 +1,420 @@
+﻿//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+
+#include "pch.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace LogMonitorTests
+{
+    ///
+    /// EventLogApi that renders the same event for any handle, and counts
+    /// the calls.
+    ///
+    class MockEventLogApi final : public EventLogApi
+    {
+    public:
+        std::wstring ProviderName = L"Microsoft-Windows-Test";
+        std::wstring ChannelName = L"Application";
+        UINT16 EventId = 100;
+        UINT8 Level = 2;
+        UINT64 TimeCreated = 132000000000000000ULL;
+
+        //
+        // Providers that OpenPublisherMetadata fails to open, with
+        // MissingPublisherStatus.
+        //
+        std::vector<std::wstring> MissingPublishers;
+        DWORD MissingPublisherStatus = ERROR_FILE_NOT_FOUND;
+
+        DWORD ContextsCreated = 0;
+        DWORD RenderCalls = 0;
+        DWORD PublishersOpened = 0;
+        DWORD HandlesClosed = 0;
+        std::vector<EVT_HANDLE> ClosedPublishers;
+
+        EVT_HANDLE CreateRenderContext(
+            _In_ DWORD ValuePathsCount,
+            _In_reads_(ValuePathsCount) LPCWSTR* ValuePaths,
+            _In_ DWORD Flags,
+            _Out_ DWORD& Status
+            ) override
+        {
+            UNREFERENCED_PARAMETER(ValuePaths);
+            UNREFERENCED_PARAMETER(Flags);
+
+            ContextsCreated++;
+            m_valuesCount = ValuePathsCount;
+            Status = ERROR_SUCCESS;
+
+            return reinterpret_cast<EVT_HANDLE>(static_cast<UINT_PTR>(ContextsCreated));
+        }
+
+        DWORD Render(
+            _In_ EVT_HANDLE Context,
+            _In_ EVT_HANDLE Fragment,
+            _In_ DWORD Flags,
+            _In_ DWORD BufferSize,
+            _Out_writes_bytes_to_opt_(BufferSize, *BufferUsed) PVOID Buffer,
+            _Out_ PDWORD BufferUsed,
+            _Out_ PDWORD PropertyCount
+            ) override
+        {
+            UNREFERENCED_PARAMETER(Context);
+            UNREFERENCED_PARAMETER(Fragment);
+            UNREFERENCED_PARAMETER(Flags);
+
+            RenderCalls++;
+
+            //
+            // Like EvtRender, the strings are after the variants.
+            //
+            const size_t providerSize = (ProviderName.size() + 1) * sizeof(wchar_t);
+            const size_t channelSize = (ChannelName.size() + 1) * sizeof(wchar_t);
+            const size_t variantsSize = m_valuesCount * sizeof(EVT_VARIANT);
+
+            *BufferUsed = static_cast<DWORD>(variantsSize + providerSize + channelSize);
+            *PropertyCount = m_valuesCount;
+
+            if (BufferSize < *BufferUsed)
+            {
+                return ERROR_INSUFFICIENT_BUFFER;
+            }
+
+            EVT_VARIANT* variants = static_cast<EVT_VARIANT*>(Buffer);
+            BYTE* strings = static_cast<BYTE*>(Buffer) + variantsSize;
+
+            ZeroMemory(variants, variantsSize);
+
+            memcpy(strings, ProviderName.c_str(), providerSize);
+            variants[0].StringVal = reinterpret_cast<LPCWSTR>(strings);
+            variants[0].Type = EvtVarTypeString;
+
+            memcpy(strings + providerSize, ChannelName.c_str(), channelSize);
+            variants[1].StringVal = reinterpret_cast<LPCWSTR>(strings + providerSize);
+            variants[1].Type = EvtVarTypeString;
+
+            variants[2].UInt16Val = EventId;
+            variants[2].Type = EvtVarTypeUInt16;
+
+            variants[3].ByteVal = Level;
+            variants[3].Type = EvtVarTypeByte;
+
+            variants[4].FileTimeVal = TimeCreated;
+            variants[4].Type = EvtVarTypeFileTime;
+
+            return ERROR_SUCCESS;
+        }
+
+        EVT_HANDLE OpenPublisherMetadata(
+            _In_ LPCWSTR PublisherId,
+            _Out_ DWORD& Status
+            ) override
+        {
+            PublishersOpened++;
+
+            if (std::find(MissingPublishers.begin(), MissingPublishers.end(), PublisherId) != MissingPublishers.end())
+            {
+                Status = MissingPublisherStatus;
+                return NULL;
+            }
+
+            Status = ERROR_SUCCESS;
+
+            return GetPublisherHandle(PublishersOpened);
+        }
+
+        void Close(
+            _In_ EVT_HANDLE Object
+            ) override
+        {
+            HandlesClosed++;
+
+            if (reinterpret_cast<UINT_PTR>(Object) >= PUBLISHER_HANDLE_BASE)
+            {
+                ClosedPublishers.push_back(Object);
+            }
+        }
+
+        ///
+        /// Handle returned by the Index-th call of OpenPublisherMetadata.
+        ///
+        static EVT_HANDLE GetPublisherHandle(
+            _In_ DWORD Index
+            )
+        {
+            return reinterpret_cast<EVT_HANDLE>(static_cast<UINT_PTR>(PUBLISHER_HANDLE_BASE + Index));
+        }
+
+    private:
+        static constexpr UINT_PTR PUBLISHER_HANDLE_BASE = 0x10000;
+
+        DWORD m_valuesCount = 0;
+    };
+
+    ///
+    /// Tests of the EventRenderer class, with a mock of the Event Log API.
+    ///
+    TEST_CLASS(EventRendererTests)
+    {
+        static EVT_HANDLE GetEventHandle(
+            _In_ int Index
+            )
+        {
+            return reinterpret_cast<EVT_HANDLE>(static_cast<UINT_PTR>(0x1000 + Index));
+        }
+
+    public:
+
+        ///
+        /// Check that the values of the events are extracted, with a single
+        /// render context for all of them.
+        ///
+        TEST_METHOD(TestRenderValues)
+        {
+            MockEventLogApi api;
+
+            {
+                EventRenderer renderer(api);
+                EventSystemValues values;
+
+                for (int i = 0; i < 3; i++)
+                {
+                    api.EventId = static_cast<UINT16>(100 + i);
+
+                    Assert::AreEqual(static_cast<DWORD>(ERROR_SUCCESS), renderer.Render(GetEventHandle(i), values));
+
+                    Assert::AreEqual(L"Microsoft-Windows-Test", values.ProviderName);
+                    Assert::AreEqual(L"Application", values.ChannelName);
+                    Assert::AreEqual(100 + i, static_cast<int>(values.EventId));
+                    Assert::AreEqual(2, static_cast<int>(values.Level));
+
+                    ULARGE_INTEGER timeCreated;
+                    timeCreated.LowPart = values.TimeCreated.dwLowDateTime;
+                    timeCreated.HighPart = values.TimeCreated.dwHighDateTime;
+
+                    Assert::AreEqual(api.TimeCreated, static_cast<UINT64>(timeCreated.QuadPart));
+                }
+
+                Assert::AreEqual(1UL, api.ContextsCreated);
+                Assert::AreEqual(3UL, api.RenderCalls);
+                Assert::AreEqual(0UL, api.HandlesClosed);
+            }
+
+            //
+            // The context is closed with the renderer.
+            //
+            Assert::AreEqual(1UL, api.HandlesClosed);
+        }
+
+        ///
+        /// Check that the buffer grows for an event that doesn't fit, and
+        /// that the next events are rendered with a single call.
+        ///
+        TEST_METHOD(TestBufferGrowsOnlyWhenNeeded)
+        {
+            MockEventLogApi api;
+            EventRenderer renderer(api);
+            EventSystemValues values;
+
+            Assert::AreEqual(static_cast<DWORD>(ERROR_SUCCESS), renderer.Render(GetEventHandle(0), values));
+            Assert::AreEqual(1UL, api.RenderCalls);
+            Assert::AreEqual(0ULL, renderer.GetBufferGrowths());
+
+            const size_t initialSize = renderer.GetBufferSize();
+
+            api.ProviderName = std::wstring(initialSize / sizeof(wchar_t), L'p');
+
+            Assert::AreEqual(static_cast<DWORD>(ERROR_SUCCESS), renderer.Render(GetEventHandle(1), values));
+            Assert::AreEqual(api.ProviderName.c_str(), values.ProviderName);
+            Assert::AreEqual(3UL, api.RenderCalls);
+            Assert::AreEqual(1ULL, renderer.GetBufferGrowths());
+            Assert::IsTrue(renderer.GetBufferSize() > initialSize);
+
+            //
+            // The smaller and the same events fit in the larger buffer.
+            //
+            api.ProviderName = L"Short";
+
+            Assert::AreEqual(static_cast<DWORD>(ERROR_SUCCESS), renderer.Render(GetEventHandle(2), values));
+            Assert::AreEqual(L"Short", values.ProviderName);
+            Assert::AreEqual(4UL, api.RenderCalls);
+            Assert::AreEqual(1ULL, renderer.GetBufferGrowths());
+        }
+
+        ///
+        /// Measure the rendering cost of an event, without the cost of the
+        /// Event Log API.
+        ///
+        TEST_METHOD(TestRenderCost)
+        {
+            const int events = 1000000;
+
+            MockEventLogApi api;
+            EventRenderer renderer(api);
+            EventSystemValues values;
+
+            LARGE_INTEGER frequency;
+            LARGE_INTEGER start;
+            LARGE_INTEGER end;
+
+            QueryPerformanceFrequency(&frequency);
+            QueryPerformanceCounter(&start);
+
+            for (int i = 0; i < events; i++)
+            {
+                renderer.Render(GetEventHandle(i), values);
+            }
+
+            QueryPerformanceCounter(&end);
+
+            const double seconds = static_cast<double>(end.QuadPart - start.QuadPart) / frequency.QuadPart;
+
+            Assert::AreEqual(1UL, api.ContextsCreated);
+            Assert::AreEqual(static_cast<DWORD>(events), api.RenderCalls);
+            Assert::AreEqual(0ULL, renderer.GetBufferGrowths());
+
+            Logger::WriteMessage(
+                FORMAT_STRING(L"Render: %.0f ns/event\n", seconds * 1e9 / events).c_str()
+            );
+        }
+    };
+
+    ///
+    /// Tests of the PublisherMetadataCache class, with a mock of the Event
+    /// Log API.
+    ///
+    TEST_CLASS(PublisherMetadataCacheTests)
+    {
+    public:
+
+        ///
+        /// Check that the metadata of a provider is opened once, and counted
+        /// as hits for the next events.
+        ///
+        TEST_METHOD(TestCachedPublisher)
+        {
+            MockEventLogApi api;
+
+            {
+                PublisherMetadataCache cache(api);
+
+                EVT_HANDLE publisher = cache.Get(L"Microsoft-Windows-Test");
+
+                Assert::IsTrue(publisher == MockEventLogApi::GetPublisherHandle(1));
+
+                for (int i = 0; i < 5; i++)
+                {
+                    Assert::IsTrue(publisher == cache.Get(L"Microsoft-Windows-Test"));
+                }
+
+                Assert::IsTrue(MockEventLogApi::GetPublisherHandle(2) == cache.Get(L"Microsoft-Windows-Other"));
+
+                Assert::AreEqual(2UL, api.PublishersOpened);
+                Assert::AreEqual(0UL, api.HandlesClosed);
+                Assert::AreEqual(5ULL, cache.GetHits());
+                Assert::AreEqual(2ULL, cache.GetMisses());
+                Assert::AreEqual(static_cast<size_t>(2), cache.Size());
+            }
+
+            //
+            // The handles are closed with the cache.
+            //
+            Assert::AreEqual(2UL, api.HandlesClosed);
+        }
+
+        ///
+        /// Check that the least recently used publisher is closed when the
+        /// cache is full.
+        ///
+        TEST_METHOD(TestEviction)
+        {
+            MockEventLogApi api;
+            PublisherMetadataCache cache(api, 2);
+
+            cache.Get(L"A");
+            cache.Get(L"B");
+            cache.Get(L"A");
+            cache.Get(L"C");
+
+            Assert::AreEqual(3UL, api.PublishersOpened);
+            Assert::AreEqual(1ULL, cache.GetEvictions());
+            Assert::AreEqual(static_cast<size_t>(1), api.ClosedPublishers.size());
+            Assert::IsTrue(MockEventLogApi::GetPublisherHandle(2) == api.ClosedPublishers[0]);
+
+            //
+            // A is still cached, B is opened again.
+            //
+            Assert::IsTrue(MockEventLogApi::GetPublisherHandle(1) == cache.Get(L"A"));
+            Assert::IsTrue(MockEventLogApi::GetPublisherHandle(4) == cache.Get(L"B"));
+            Assert::AreEqual(4UL, api.PublishersOpened);
+        }
+
+        ///
+        /// Check that a provider without metadata isn't opened again for
+        /// each event.
+        ///
+        TEST_METHOD(TestPublisherWithoutMetadata)
+        {
+            MockEventLogApi api;
+
+            api.MissingPublishers.push_back(L"EventCreate");
+
+            {
+                PublisherMetadataCache cache(api);
+
+                Assert::IsTrue(NULL == cache.Get(L"EventCreate"));
+                Assert::IsTrue(NULL == cache.Get(L"EventCreate"));
+
+                Assert::AreEqual(1UL, api.PublishersOpened);
+                Assert::AreEqual(1ULL, cache.GetHits());
+            }
+
+            Assert::AreEqual(0UL, api.HandlesClosed);
+
+            api.MissingPublisherStatus = ERROR_EVT_PUBLISHER_METADATA_NOT_FOUND;
+
+            PublisherMetadataCache cache(api);
+
+            Assert::IsTrue(NULL == cache.Get(L"EventCreate"));
+            Assert::IsTrue(NULL == cache.Get(L"EventCreate"));
+
+            Assert::AreEqual(2UL, api.PublishersOpened);
+            Assert::AreEqual(static_cast<size_t>(1), cache.Size());
+        }
+
+        ///
+        /// Check that a provider that fails to be opened for another reason
+        /// isn't cached, and is opened again with the next event.
+        ///
+        TEST_METHOD(TestPublisherOpenFailure)
+        {
+            MockEventLogApi api;
+
+            api.MissingPublishers.push_back(L"Microsoft-Windows-Test");
+            api.MissingPublisherStatus = ERROR_ACCESS_DENIED;
+
+            PublisherMetadataCache cache(api);
+
+            Assert::IsTrue(NULL == cache.Get(L"Microsoft-Windows-Test"));
+            Assert::IsTrue(NULL == cache.Get(L"Microsoft-Windows-Test"));
+
+            Assert::AreEqual(2UL, api.PublishersOpened);
+            Assert::AreEqual(0ULL, cache.GetHits());
+            Assert::AreEqual(static_cast<size_t>(0), cache.Size());
+
+            //
+            // Once the provider can be opened, its handle is cached.
+            //
+            api.MissingPublishers.clear();
+
+            Assert::IsTrue(MockEventLogApi::GetPublisherHandle(3) == cache.Get(L"Microsoft-Windows-Test"));
+            Assert::IsTrue(MockEventLogApi::GetPublisherHandle(3) == cache.Get(L"Microsoft-Windows-Test"));
+
+            Assert::AreEqual(3UL, api.PublishersOpened);
+            Assert::AreEqual(1ULL, cache.GetHits());
+        }
+    };
+}
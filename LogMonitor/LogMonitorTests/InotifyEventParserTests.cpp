@@ -0,0 +1,253 @@
+﻿//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+
+#include "pch.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace LogMonitorTests
+{
+    ///
+    /// Tests the conversion of the inotify records of the Linux backend of
+    /// the directory watcher, with synthetic records.
+    ///
+    TEST_CLASS(InotifyEventParserTests)
+    {
+        static void AppendRecord(
+            _Inout_ std::vector<char>& Buffer,
+            _In_ INT32 Wd,
+            _In_ UINT32 Mask,
+            _In_ const std::string& Name
+            )
+        {
+            //
+            // The name is NUL-terminated, and padded like the kernel does.
+            //
+            InotifyEventParser::EventHeader header{};
+            header.Wd = Wd;
+            header.Mask = Mask;
+            header.Length = Name.empty()
+                ? 0
+                : static_cast<UINT32>((Name.size() + sizeof(header)) & ~(sizeof(header) - 1));
+
+            const size_t offset = Buffer.size();
+
+            Buffer.resize(offset + sizeof(header) + header.Length, '\0');
+            memcpy(Buffer.data() + offset, &header, sizeof(header));
+            memcpy(Buffer.data() + offset + sizeof(header), Name.data(), Name.size());
+        }
+
+        static void AssertEvent(
+            _In_ const DirChangeNotificationEvent& Event,
+            _In_ EventAction Action,
+            _In_ LPCWSTR FileName
+            )
+        {
+            Assert::AreEqual(static_cast<int>(Action), static_cast<int>(Event.Action));
+            Assert::AreEqual(FileName, Event.FileName.c_str());
+        }
+
+    public:
+
+        ///
+        /// Check the conversion of the records of the watched directory and
+        /// of a subdirectory to events named relative to the directory.
+        ///
+        TEST_METHOD(TestParseEvents)
+        {
+            InotifyEventParser parser(true);
+            std::vector<char> buffer;
+
+            parser.AddWatch(1, "");
+            parser.AddWatch(2, "sub");
+
+            AppendRecord(buffer, 1, InotifyEventParser::MASK_CREATE, "a.log");
+            AppendRecord(buffer, 2, InotifyEventParser::MASK_MODIFY, "a.log");
+            AppendRecord(buffer, 1, 0x00000001, "accessed.log");
+            AppendRecord(buffer, 1, InotifyEventParser::MASK_MOVED_FROM, "b.log");
+            AppendRecord(buffer, 1, InotifyEventParser::MASK_MOVED_TO, "c.log");
+            AppendRecord(buffer, 2, InotifyEventParser::MASK_DELETE, "\xc3\xa9.log");
+            AppendRecord(buffer, 7, InotifyEventParser::MASK_MODIFY, "unknown.log");
+
+            std::vector<DirChangeNotificationEvent> events;
+            std::vector<std::string> newDirectories;
+            std::vector<INT32> removedWatches;
+
+            parser.Parse(buffer.data(), buffer.size(), 42, events, newDirectories, removedWatches);
+
+            Assert::AreEqual(static_cast<size_t>(5), events.size());
+            AssertEvent(events[0], EventAction::Add, L"a.log");
+            AssertEvent(events[1], EventAction::Modify, L"sub/a.log");
+            AssertEvent(events[2], EventAction::RenameOld, L"b.log");
+            AssertEvent(events[3], EventAction::RenameNew, L"c.log");
+            AssertEvent(events[4], EventAction::Remove, L"sub/\x00e9.log");
+
+            for (const auto& event : events)
+            {
+                Assert::AreEqual(static_cast<UINT64>(42), event.Timestamp);
+            }
+
+            Assert::IsTrue(newDirectories.empty());
+            Assert::IsTrue(removedWatches.empty());
+        }
+
+        ///
+        /// Check that IN_Q_OVERFLOW is a ReInit event, and that a record
+        /// going past the end of the buffer is ignored.
+        ///
+        TEST_METHOD(TestParseOverflowAndTruncatedRecords)
+        {
+            InotifyEventParser parser(false);
+            std::vector<char> buffer;
+
+            parser.AddWatch(1, "");
+
+            AppendRecord(buffer, -1, InotifyEventParser::MASK_Q_OVERFLOW, "");
+            AppendRecord(buffer, 1, InotifyEventParser::MASK_MODIFY, "a.log");
+
+            std::vector<DirChangeNotificationEvent> events;
+            std::vector<std::string> newDirectories;
+            std::vector<INT32> removedWatches;
+
+            parser.Parse(buffer.data(), buffer.size() - 1, 1, events, newDirectories, removedWatches);
+
+            Assert::AreEqual(static_cast<size_t>(1), events.size());
+            AssertEvent(events[0], EventAction::ReInit, L"");
+        }
+
+        ///
+        /// Check that a directory created in the tree is followed by a ReInit
+        /// event and returned to be watched, only with IncludeSubfolders.
+        ///
+        TEST_METHOD(TestNewDirectory)
+        {
+            const bool includeSubfoldersValues[] = { true, false };
+
+            for (bool includeSubfolders : includeSubfoldersValues)
+            {
+                InotifyEventParser parser(includeSubfolders);
+                std::vector<char> buffer;
+
+                parser.AddWatch(1, "");
+                parser.AddWatch(2, "sub");
+
+                AppendRecord(buffer, 2, InotifyEventParser::MASK_CREATE | InotifyEventParser::MASK_ISDIR, "new");
+                AppendRecord(buffer, 1, InotifyEventParser::MASK_MOVED_TO | InotifyEventParser::MASK_ISDIR, "moved");
+
+                std::vector<DirChangeNotificationEvent> events;
+                std::vector<std::string> newDirectories;
+                std::vector<INT32> removedWatches;
+
+                parser.Parse(buffer.data(), buffer.size(), 1, events, newDirectories, removedWatches);
+
+                if (includeSubfolders)
+                {
+                    Assert::AreEqual(static_cast<size_t>(4), events.size());
+                    AssertEvent(events[0], EventAction::Add, L"sub/new");
+                    AssertEvent(events[1], EventAction::ReInit, L"");
+                    AssertEvent(events[2], EventAction::RenameNew, L"moved");
+                    AssertEvent(events[3], EventAction::ReInit, L"");
+
+                    Assert::AreEqual(static_cast<size_t>(2), newDirectories.size());
+                    Assert::AreEqual("sub/new", newDirectories[0].c_str());
+                    Assert::AreEqual("moved", newDirectories[1].c_str());
+                }
+                else
+                {
+                    Assert::AreEqual(static_cast<size_t>(2), events.size());
+                    AssertEvent(events[0], EventAction::Add, L"sub/new");
+                    AssertEvent(events[1], EventAction::RenameNew, L"moved");
+
+                    Assert::IsTrue(newDirectories.empty());
+                }
+            }
+        }
+
+        ///
+        /// Check that the watches of a directory moved out of its place are
+        /// removed with the ones of its subdirectories, and that its next
+        /// records are ignored.
+        ///
+        TEST_METHOD(TestDirectoryMovedOut)
+        {
+            InotifyEventParser parser(true);
+            std::vector<char> buffer;
+
+            parser.AddWatch(1, "");
+            parser.AddWatch(2, "sub");
+            parser.AddWatch(3, "sub/deep");
+            parser.AddWatch(4, "subway");
+
+            AppendRecord(buffer, 1, InotifyEventParser::MASK_MOVED_FROM | InotifyEventParser::MASK_ISDIR, "sub");
+            AppendRecord(buffer, 2, InotifyEventParser::MASK_MOVE_SELF, "");
+            AppendRecord(buffer, 3, InotifyEventParser::MASK_MODIFY, "a.log");
+            AppendRecord(buffer, 4, InotifyEventParser::MASK_MODIFY, "a.log");
+
+            std::vector<DirChangeNotificationEvent> events;
+            std::vector<std::string> newDirectories;
+            std::vector<INT32> removedWatches;
+
+            parser.Parse(buffer.data(), buffer.size(), 1, events, newDirectories, removedWatches);
+
+            Assert::AreEqual(static_cast<size_t>(2), events.size());
+            AssertEvent(events[0], EventAction::RenameOld, L"sub");
+            AssertEvent(events[1], EventAction::Modify, L"subway/a.log");
+
+            std::sort(removedWatches.begin(), removedWatches.end());
+
+            Assert::AreEqual(static_cast<size_t>(2), removedWatches.size());
+            Assert::AreEqual(2, removedWatches[0]);
+            Assert::AreEqual(3, removedWatches[1]);
+            Assert::AreEqual(static_cast<size_t>(2), parser.GetWatchCount());
+
+            //
+            // A subdirectory moved without its IN_MOVED_FROM record, lost in
+            // an overflow, is removed by its own IN_MOVE_SELF record.
+            //
+            buffer.clear();
+            removedWatches.clear();
+            events.clear();
+
+            AppendRecord(buffer, 4, InotifyEventParser::MASK_MOVE_SELF, "");
+
+            parser.Parse(buffer.data(), buffer.size(), 1, events, newDirectories, removedWatches);
+
+            Assert::IsTrue(events.empty());
+            Assert::AreEqual(static_cast<size_t>(1), removedWatches.size());
+            Assert::AreEqual(4, removedWatches[0]);
+        }
+
+        ///
+        /// Check that the move or the deletion of the watched directory is a
+        /// ReInit event, and that a watch removed by the system is forgotten.
+        ///
+        TEST_METHOD(TestWatchedDirectoryMovedOrRemoved)
+        {
+            InotifyEventParser parser(true);
+            std::vector<char> buffer;
+
+            parser.AddWatch(1, "");
+            parser.AddWatch(2, "sub");
+
+            AppendRecord(buffer, 1, InotifyEventParser::MASK_MOVE_SELF, "");
+            AppendRecord(buffer, 2, InotifyEventParser::MASK_DELETE_SELF, "");
+            AppendRecord(buffer, 2, InotifyEventParser::MASK_IGNORED, "");
+            AppendRecord(buffer, 2, InotifyEventParser::MASK_CREATE, "a.log");
+            AppendRecord(buffer, 1, InotifyEventParser::MASK_DELETE_SELF, "");
+
+            std::vector<DirChangeNotificationEvent> events;
+            std::vector<std::string> newDirectories;
+            std::vector<INT32> removedWatches;
+
+            parser.Parse(buffer.data(), buffer.size(), 1, events, newDirectories, removedWatches);
+
+            Assert::AreEqual(static_cast<size_t>(2), events.size());
+            AssertEvent(events[0], EventAction::ReInit, L"");
+            AssertEvent(events[1], EventAction::ReInit, L"");
+            Assert::IsTrue(removedWatches.empty());
+            Assert::AreEqual(static_cast<size_t>(1), parser.GetWatchCount());
+        }
+    };
+}
@@ -0,0 +1,156 @@
+﻿//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+
+#include "pch.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace LogMonitorTests
+{
+    ///
+    /// Tests of the JsonLineParser class, used to parse the JSON lines of a
+    /// Process source.
+    ///
+    TEST_CLASS(JsonLineParserTests)
+    {
+        static std::string MemberName(
+            _In_ const JsonLineParser::Member& Field
+            )
+        {
+            return std::string(Field.Name, Field.NameLength);
+        }
+
+        static std::string MemberValue(
+            _In_ const JsonLineParser::Member& Field
+            )
+        {
+            return std::string(Field.Value, Field.ValueLength);
+        }
+
+    public:
+
+        ///
+        /// Check the views and types of the members of a line, with the
+        /// nested values kept as their JSON text.
+        ///
+        TEST_METHOD(TestMembers)
+        {
+            const std::string line =
+                " {\"level\":\"info\", \"msg\" : \"say \\\"hi\\\"\",\"n\":-1.5e3,"
+                "\"ok\":true,\"none\":null,\"ctx\":{\"a\":[1,{\"b\":[]}]},\"tags\":[\"x\",\"y\"]} ";
+            JsonLineParser parser;
+
+            Assert::IsTrue(parser.Parse(line.data(), line.size()));
+
+            const std::vector<JsonLineParser::Member>& members = parser.GetMembers();
+
+            Assert::AreEqual(static_cast<size_t>(7), members.size());
+
+            Assert::AreEqual("level", MemberName(members[0]).c_str());
+            Assert::AreEqual("info", MemberValue(members[0]).c_str());
+            Assert::IsTrue(members[0].Type == JsonLineParser::ValueType::String);
+
+            Assert::AreEqual("msg", MemberName(members[1]).c_str());
+            Assert::AreEqual("say \\\"hi\\\"", MemberValue(members[1]).c_str());
+
+            Assert::AreEqual("-1.5e3", MemberValue(members[2]).c_str());
+            Assert::IsTrue(members[2].Type == JsonLineParser::ValueType::Number);
+
+            Assert::AreEqual("true", MemberValue(members[3]).c_str());
+            Assert::IsTrue(members[3].Type == JsonLineParser::ValueType::Boolean);
+
+            Assert::AreEqual("null", MemberValue(members[4]).c_str());
+            Assert::IsTrue(members[4].Type == JsonLineParser::ValueType::Null);
+
+            Assert::AreEqual("{\"a\":[1,{\"b\":[]}]}", MemberValue(members[5]).c_str());
+            Assert::IsTrue(members[5].Type == JsonLineParser::ValueType::Object);
+
+            Assert::AreEqual("[\"x\",\"y\"]", MemberValue(members[6]).c_str());
+            Assert::IsTrue(members[6].Type == JsonLineParser::ValueType::Array);
+
+            const std::string empty = "{}";
+
+            Assert::IsTrue(parser.Parse(empty.data(), empty.size()));
+            Assert::IsTrue(parser.GetMembers().empty());
+        }
+
+        ///
+        /// Check that the lines that aren't a single valid JSON object
+        /// aren't parsed, and leave no members.
+        ///
+        TEST_METHOD(TestInvalidLines)
+        {
+            const char* lines[] = {
+                "",
+                "plain text",
+                "[1,2]",
+                "\"string\"",
+                "{\"a\":1",
+                "{\"a\":1,}",
+                "{\"a\":1} trailing",
+                "{\"a\":1}{\"b\":2}",
+                "{a:1}",
+                "{\"a\":01}",
+                "{\"a\":1.}",
+                "{\"a\":tru}",
+                "{\"a\":\"bad \\x escape\"}",
+                "{\"a\":\"bad \\u12 escape\"}",
+                "{\"a\":\"tab\tin string\"}",
+                "{\"a\":[1,]}",
+                "{\"a\" 1}",
+            };
+            JsonLineParser parser;
+
+            for (const char* line : lines)
+            {
+                const std::string valid = "{\"valid\":1}";
+
+                Assert::IsTrue(parser.Parse(valid.data(), valid.size()));
+
+                Assert::IsFalse(parser.Parse(line, strlen(line)), Utility::Utf8ToWide(line).c_str());
+                Assert::IsTrue(parser.GetMembers().empty());
+            }
+        }
+
+        ///
+        /// Check that the values nested deeper than MAX_DEPTH aren't parsed.
+        ///
+        TEST_METHOD(TestMaxDepth)
+        {
+            JsonLineParser parser;
+            std::string line = "{\"a\":";
+
+            line.append(JsonLineParser::MAX_DEPTH - 1, '[');
+            line.append(JsonLineParser::MAX_DEPTH - 1, ']');
+            line.push_back('}');
+
+            Assert::IsTrue(parser.Parse(line.data(), line.size()));
+
+            line = "{\"a\":";
+            line.append(JsonLineParser::MAX_DEPTH, '[');
+            line.append(JsonLineParser::MAX_DEPTH, ']');
+            line.push_back('}');
+
+            Assert::IsFalse(parser.Parse(line.data(), line.size()));
+        }
+
+        ///
+        /// Check that the escape sequences are decoded to UTF-8, and that a
+        /// lone surrogate is replaced.
+        ///
+        TEST_METHOD(TestUnescape)
+        {
+            const std::string value =
+                "q\\\" b\\\\ s\\/ \\b\\f\\n\\r\\t \\u0041\\u00e9\\u20ac\\ud83d\\ude00 \\ud800x \\udc00";
+            std::string buffer = "prefix ";
+
+            JsonLineParser::AppendUnescaped(buffer, value.data(), value.size());
+
+            Assert::AreEqual(
+                "prefix q\" b\\ s/ \b\f\n\r\t A\xc3\xa9\xe2\x82\xac\xf0\x9f\x98\x80 \xef\xbf\xbdx \xef\xbf\xbd",
+                buffer.c_str());
+        }
+    };
+}
@@ -0,0 +1,208 @@
+﻿//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+
+#include "pch.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace LogMonitorTests
+{
+    ///
+    /// Tests the JSON Lines output format.
+    ///
+    TEST_CLASS(JsonLineWriterTests)
+    {
+        static FILETIME MakeFileTime(
+            _In_ WORD Year,
+            _In_ WORD Month,
+            _In_ WORD Day,
+            _In_ WORD Hour,
+            _In_ WORD Minute,
+            _In_ WORD Second,
+            _In_ WORD Milliseconds
+            )
+        {
+            SYSTEMTIME st{};
+            FILETIME ft{};
+
+            st.wYear = Year;
+            st.wMonth = Month;
+            st.wDay = Day;
+            st.wHour = Hour;
+            st.wMinute = Minute;
+            st.wSecond = Second;
+            st.wMilliseconds = Milliseconds;
+
+            SystemTimeToFileTime(&st, &ft);
+
+            return ft;
+        }
+
+    public:
+
+        ///
+        /// Check that the characters JSON requires to escape are escaped,
+        /// and that UTF-16 strings are transcoded to UTF-8.
+        ///
+        TEST_METHOD(TestStringEscaping)
+        {
+            std::string buffer;
+            JsonLineWriter json(buffer);
+
+            json.BeginArray();
+            json.String(L"quote\" backslash\\ tab\t\r\n");
+            json.String("bell\x07 unit\x1f");
+            json.String(L"caf\x00e9 \x20ac \xd83d\xde00");
+            json.String(std::wstring(L"lone \xd800 surrogate").c_str());
+            json.String("caf\xc3\xa9");
+            json.String(L"", 0);
+            json.EndArray();
+
+            Assert::AreEqual(
+                "[\"quote\\\" backslash\\\\ tab\\t\\r\\n\","
+                "\"bell\\u0007 unit\\u001f\","
+                "\"caf\xc3\xa9 \xe2\x82\xac \xf0\x9f\x98\x80\","
+                "\"lone \xef\xbf\xbd surrogate\","
+                "\"caf\xc3\xa9\","
+                "\"\"]",
+                buffer.c_str());
+        }
+
+        ///
+        /// Check the commas between the members of nested objects and
+        /// arrays, and the number formats.
+        ///
+        TEST_METHOD(TestNestingAndNumbers)
+        {
+            std::string buffer;
+            JsonLineWriter json(buffer);
+
+            json.BeginObject();
+            json.Key("a");
+            json.Number(0);
+            json.Key(L"b");
+            json.BeginArray();
+            json.Number(18446744073709551615ULL);
+            json.BeginObject();
+            json.EndObject();
+            json.BeginArray();
+            json.EndArray();
+            json.EndArray();
+            json.Key("c");
+            json.HexNumberString(0x8000000000000010ULL);
+            json.Key("d");
+            json.HexNumberString(0);
+            json.EndObject();
+
+            Assert::AreEqual(
+                "{\"a\":0,\"b\":[18446744073709551615,{},[]],\"c\":\"0x8000000000000010\",\"d\":\"0x0\"}",
+                buffer.c_str());
+        }
+
+        ///
+        /// Check the ISO 8601 format of the times.
+        ///
+        TEST_METHOD(TestTime)
+        {
+            std::string buffer;
+            JsonLineWriter json(buffer);
+
+            json.Time(MakeFileTime(2024, 1, 2, 3, 4, 5, 67));
+
+            Assert::AreEqual("\"2024-01-02T03:04:05.067Z\"", buffer.c_str());
+        }
+
+        ///
+        /// Check that an event is a single line JSON object, even if its
+        /// message has line breaks.
+        ///
+        TEST_METHOD(TestEventLogJsonFormat)
+        {
+            std::string buffer;
+
+            EventMonitor::FormatEventJson(
+                buffer,
+                MakeFileTime(2024, 12, 31, 23, 59, 59, 999),
+                L"Application",
+                L"Error",
+                1000,
+                L"Faulting application \"app.exe\".\r\nPath: C:\\app");
+
+            Assert::AreEqual(
+                "{\"Source\":\"EventLog\",\"LogEntry\":{\"Time\":\"2024-12-31T23:59:59.999Z\","
+                "\"Channel\":\"Application\",\"Level\":\"Error\",\"EventId\":1000,"
+                "\"Message\":\"Faulting application \\\"app.exe\\\".\\r\\nPath: C:\\\\app\"}}",
+                buffer.c_str());
+        }
+
+        ///
+        /// Compare the cost of formatting an event in the XML format, then
+        /// transcoding it to UTF-8, with the JSON format written in UTF-8
+        /// directly to a reused buffer.
+        ///
+        TEST_METHOD(TestEventFormatThroughput)
+        {
+            const int events = 200000;
+            const FILETIME timeCreated = MakeFileTime(2024, 1, 2, 3, 4, 5, 678);
+            const LPCWSTR message =
+                L"The description for Event ID 1000 from source Application Error: "
+                L"faulting application name: app.exe, version: 1.0.0.0, caf\x00e9.";
+
+            LARGE_INTEGER frequency;
+            LARGE_INTEGER start;
+            LARGE_INTEGER end;
+
+            QueryPerformanceFrequency(&frequency);
+
+            size_t xmlBytes = 0;
+            std::wstring xml;
+
+            QueryPerformanceCounter(&start);
+
+            for (int i = 0; i < events; i++)
+            {
+                xml.clear();
+                EventMonitor::FormatEventXml(xml, timeCreated, L"Application", L"Error", 1000, message, false);
+
+                const std::string line = Utility::WideToUtf8(xml);
+
+                xmlBytes += line.size();
+            }
+
+            QueryPerformanceCounter(&end);
+
+            const double xmlSeconds = static_cast<double>(end.QuadPart - start.QuadPart) / frequency.QuadPart;
+
+            size_t jsonBytes = 0;
+            std::string buffer;
+
+            QueryPerformanceCounter(&start);
+
+            for (int i = 0; i < events; i++)
+            {
+                buffer.clear();
+                EventMonitor::FormatEventJson(buffer, timeCreated, L"Application", L"Error", 1000, message);
+
+                jsonBytes += buffer.size();
+            }
+
+            QueryPerformanceCounter(&end);
+
+            const double jsonSeconds = static_cast<double>(end.QuadPart - start.QuadPart) / frequency.QuadPart;
+
+            Assert::IsTrue(jsonBytes > 0);
+
+            Logger::WriteMessage(
+                FORMAT_STRING(
+                    L"XML: %llu bytes/event, %.0f ns/event. JSON: %llu bytes/event, %.0f ns/event\n",
+                    static_cast<UINT64>(xmlBytes / events),
+                    xmlSeconds * 1e9 / events,
+                    static_cast<UINT64>(jsonBytes / events),
+                    jsonSeconds * 1e9 / events
+                ).c_str()
+            );
+        }
+    };
+}
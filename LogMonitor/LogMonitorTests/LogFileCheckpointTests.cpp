@@ -0,0 +1,162 @@
+﻿//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+
+#include "pch.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace LogMonitorTests
+{
+    ///
+    /// Tests the serialization and the storage of the log file checkpoints.
+    ///
+    TEST_CLASS(LogFileCheckpointTests)
+    {
+        static LogFileCheckpoint MakeCheckpoint(
+            _In_ BYTE Seed
+            )
+        {
+            LogFileCheckpoint checkpoint;
+
+            ZeroMemory(&checkpoint, sizeof(checkpoint));
+            checkpoint.FileId.VolumeSerialNumber = 0x1000 + Seed;
+            checkpoint.FileId.FileId.Identifier[0] = Seed;
+            checkpoint.FileId.FileId.Identifier[15] = static_cast<BYTE>(~Seed);
+            checkpoint.NextReadOffset = 0x100000000ULL + Seed;
+            checkpoint.EncodingType = LM_FILETYPE::FileTypeUTF16LE;
+            checkpoint.FingerprintSize = Seed;
+            checkpoint.Fingerprint = 0xABCDEF0000000000ULL + Seed;
+
+            return checkpoint;
+        }
+
+        static void AssertCheckpointsEqual(
+            _In_ const LogFileCheckpoint& Expected,
+            _In_ const LogFileCheckpoint& Actual
+            )
+        {
+            Assert::AreEqual(0, memcmp(&Expected.FileId, &Actual.FileId, sizeof(Expected.FileId)));
+            Assert::AreEqual(Expected.NextReadOffset, Actual.NextReadOffset);
+            Assert::AreEqual(static_cast<int>(Expected.EncodingType), static_cast<int>(Actual.EncodingType));
+            Assert::AreEqual(Expected.FingerprintSize, Actual.FingerprintSize);
+            Assert::AreEqual(Expected.Fingerprint, Actual.Fingerprint);
+        }
+
+    public:
+
+        ///
+        /// Check that serialized checkpoints are parsed back unchanged.
+        ///
+        TEST_METHOD(TestSerializeRoundTrip)
+        {
+            std::vector<LogFileCheckpoint> checkpoints = { MakeCheckpoint(1), MakeCheckpoint(2), MakeCheckpoint(200) };
+            std::vector<LogFileCheckpoint> parsed;
+            std::vector<BYTE> content;
+
+            LogFileCheckpointStore::Serialize(checkpoints, content);
+
+            Assert::IsTrue(LogFileCheckpointStore::Deserialize(content.data(), content.size(), parsed));
+            Assert::AreEqual(checkpoints.size(), parsed.size());
+
+            for (size_t i = 0; i < checkpoints.size(); i++)
+            {
+                AssertCheckpointsEqual(checkpoints[i], parsed[i]);
+            }
+
+            //
+            // An empty list is valid too.
+            //
+            LogFileCheckpointStore::Serialize(std::vector<LogFileCheckpoint>(), content);
+
+            Assert::IsTrue(LogFileCheckpointStore::Deserialize(content.data(), content.size(), parsed));
+            Assert::AreEqual(size_t(0), parsed.size());
+        }
+
+        ///
+        /// Check that truncated or modified content is rejected.
+        ///
+        TEST_METHOD(TestDeserializeRejectsCorruptedContent)
+        {
+            std::vector<LogFileCheckpoint> checkpoints = { MakeCheckpoint(1), MakeCheckpoint(2) };
+            std::vector<LogFileCheckpoint> parsed;
+            std::vector<BYTE> content;
+
+            LogFileCheckpointStore::Serialize(checkpoints, content);
+
+            Assert::IsFalse(LogFileCheckpointStore::Deserialize(content.data(), content.size() - 1, parsed));
+            Assert::AreEqual(size_t(0), parsed.size());
+
+            Assert::IsFalse(LogFileCheckpointStore::Deserialize(content.data(), 4, parsed));
+
+            std::vector<BYTE> modified = content;
+            modified[content.size() / 2] ^= 0x01;
+
+            Assert::IsFalse(LogFileCheckpointStore::Deserialize(modified.data(), modified.size(), parsed));
+
+            modified = content;
+            modified[0] = 'X';
+
+            Assert::IsFalse(LogFileCheckpointStore::Deserialize(modified.data(), modified.size(), parsed));
+        }
+
+        ///
+        /// Check that the checkpoints are saved to a file and loaded back, and
+        /// that a missing file is reported as ERROR_FILE_NOT_FOUND.
+        ///
+        TEST_METHOD(TestSaveAndLoadCheckpointFile)
+        {
+            WCHAR tempDirectory[MAX_PATH + 1] = { 0 };
+            Assert::AreNotEqual(0UL, GetTempPathW(MAX_PATH + 1, tempDirectory));
+
+            const std::wstring filePath = std::wstring(tempDirectory)
+                + L"LogMonitorCheckpointTest" + std::to_wstring(GetCurrentProcessId()) + L".bin";
+
+            DeleteFileW(filePath.c_str());
+
+            LogFileCheckpointStore store(filePath);
+            std::vector<LogFileCheckpoint> loaded;
+
+            Assert::AreEqual(static_cast<DWORD>(ERROR_FILE_NOT_FOUND), store.Load(loaded));
+
+            std::vector<LogFileCheckpoint> checkpoints = { MakeCheckpoint(7) };
+            Assert::AreEqual(static_cast<DWORD>(ERROR_SUCCESS), store.Save(checkpoints));
+
+            //
+            // Saving again replaces the previous content.
+            //
+            checkpoints.push_back(MakeCheckpoint(8));
+            Assert::AreEqual(static_cast<DWORD>(ERROR_SUCCESS), store.Save(checkpoints));
+
+            Assert::AreEqual(static_cast<DWORD>(ERROR_SUCCESS), store.Load(loaded));
+            Assert::AreEqual(checkpoints.size(), loaded.size());
+            AssertCheckpointsEqual(checkpoints[1], loaded[1]);
+
+            Assert::IsFalse(PathFileExistsW((filePath + L".tmp").c_str()));
+
+            DeleteFileW(filePath.c_str());
+        }
+
+        ///
+        /// Check that the fingerprint depends on the content and its size.
+        ///
+        TEST_METHOD(TestFingerprint)
+        {
+            const BYTE first[] = { 'l', 'o', 'g', '1' };
+            const BYTE second[] = { 'l', 'o', 'g', '2' };
+
+            Assert::AreEqual(
+                LogFileCheckpointStore::ComputeFingerprint(first, sizeof(first)),
+                LogFileCheckpointStore::ComputeFingerprint(first, sizeof(first)));
+
+            Assert::AreNotEqual(
+                LogFileCheckpointStore::ComputeFingerprint(first, sizeof(first)),
+                LogFileCheckpointStore::ComputeFingerprint(second, sizeof(second)));
+
+            Assert::AreNotEqual(
+                LogFileCheckpointStore::ComputeFingerprint(first, sizeof(first)),
+                LogFileCheckpointStore::ComputeFingerprint(first, sizeof(first) - 1));
+        }
+    };
+}
@@ -0,0 +1,336 @@
+﻿//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+
+#include "pch.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace LogMonitorTests
+{
+    ///
+    /// Tests the LogLineDecoder. The content is fed in chunks of every possible
+    /// size, to check that characters and line breaks split between chunks are
+    /// decoded the same way as when the whole content is decoded at once.
+    ///
+    TEST_CLASS(LogLineDecoderTests)
+    {
+        ///
+        /// Decodes Content in chunks of ChunkSize bytes, and returns the lines found.
+        ///
+        std::vector<std::string> DecodeInChunks(
+            _In_ const std::string& Content,
+            _In_ LM_FILETYPE EncodingType,
+            _In_ size_t ChunkSize
+            )
+        {
+            std::vector<std::string> lines;
+            LogLineDecoder decoder;
+
+            const LogLineDecoder::LineCallback onLine =
+                [&lines](_In_reads_(Length) const char* Line, _In_ size_t Length)
+                {
+                    lines.emplace_back(Line, Length);
+                };
+
+            decoder.SetEncoding(EncodingType);
+
+            for (size_t offset = 0; offset < Content.size(); offset += ChunkSize)
+            {
+                const size_t size = (std::min)(ChunkSize, Content.size() - offset);
+                decoder.Decode(reinterpret_cast<const BYTE*>(Content.data() + offset), size, onLine);
+            }
+
+            decoder.Flush(onLine);
+
+            return lines;
+        }
+
+        void AssertLinesAreEqual(
+            _In_ const std::vector<std::string>& Expected,
+            _In_ const std::vector<std::string>& Actual
+            )
+        {
+            Assert::AreEqual(Expected.size(), Actual.size());
+
+            for (size_t i = 0; i < Expected.size(); i++)
+            {
+                Assert::AreEqual(Expected[i].c_str(), Actual[i].c_str());
+            }
+        }
+
+    public:
+
+        ///
+        /// Check that LF, CR LF and CR are line breaks, even when a CR LF is split
+        /// between two chunks.
+        ///
+        TEST_METHOD(TestLineBreaksSplitBetweenChunks)
+        {
+            const std::string content = "first\r\nsecond\nthird\rfourth\r\n\r\nlast";
+            const std::vector<std::string> expected = { "first", "second", "third", "fourth", "", "last" };
+
+            for (size_t chunkSize = 1; chunkSize <= content.size(); chunkSize++)
+            {
+                AssertLinesAreEqual(expected, DecodeInChunks(content, LM_FILETYPE::ANSI, chunkSize));
+            }
+        }
+
+        ///
+        /// Check that UTF-8 sequences of every length are passed through
+        /// unchanged when they are split between two chunks.
+        ///
+        TEST_METHOD(TestUtf8SequencesSplitBetweenChunks)
+        {
+            const std::string content = "a\xc3\xa9 \xe3\x83\x86 \xf0\x9f\x98\x80 \xef\xbf\xbd\nnext \xe2\x82\xac";
+            const std::vector<std::string> expected = { "a\xc3\xa9 \xe3\x83\x86 \xf0\x9f\x98\x80 \xef\xbf\xbd", "next \xe2\x82\xac" };
+
+            for (size_t chunkSize = 1; chunkSize <= content.size(); chunkSize++)
+            {
+                AssertLinesAreEqual(expected, DecodeInChunks(content, LM_FILETYPE::UTF8, chunkSize));
+            }
+        }
+
+        ///
+        /// Check that invalid UTF-8 sequences are replaced by U+FFFD.
+        ///
+        TEST_METHOD(TestInvalidUtf8Sequences)
+        {
+            const std::string content = "a\xc3(b\xff\n";
+            const std::vector<std::string> expected = { "a\xef\xbf\xbd(b\xef\xbf\xbd" };
+
+            for (size_t chunkSize = 1; chunkSize <= content.size(); chunkSize++)
+            {
+                AssertLinesAreEqual(expected, DecodeInChunks(content, LM_FILETYPE::UTF8, chunkSize));
+            }
+        }
+
+        ///
+        /// Check that UTF-16 code units and surrogate pairs split between two
+        /// chunks are transcoded to UTF-8, for both little and big endian, and
+        /// that an unpaired surrogate is replaced by U+FFFD.
+        ///
+        TEST_METHOD(TestUtf16CodeUnitsSplitBetweenChunks)
+        {
+            const std::wstring text = L"line \x30c6 \xd83d\xde00\r\nsecond \xdc00line";
+            const std::vector<std::string> expected = { "line \xe3\x83\x86 \xf0\x9f\x98\x80", "second \xef\xbf\xbdline" };
+
+            std::string littleEndian;
+            std::string bigEndian;
+
+            for (wchar_t ch : text)
+            {
+                littleEndian.push_back(static_cast<char>(ch & 0xFF));
+                littleEndian.push_back(static_cast<char>((ch >> 8) & 0xFF));
+
+                bigEndian.push_back(static_cast<char>((ch >> 8) & 0xFF));
+                bigEndian.push_back(static_cast<char>(ch & 0xFF));
+            }
+
+            for (size_t chunkSize = 1; chunkSize <= littleEndian.size(); chunkSize++)
+            {
+                AssertLinesAreEqual(expected, DecodeInChunks(littleEndian, LM_FILETYPE::UTF16LE, chunkSize));
+                AssertLinesAreEqual(expected, DecodeInChunks(bigEndian, LM_FILETYPE::UTF16BE, chunkSize));
+            }
+        }
+
+        ///
+        /// Check that ANSI content is decoded as Latin-1.
+        ///
+        TEST_METHOD(TestAnsiContent)
+        {
+            const std::string content = "caf\xe9\nplain\n";
+            const std::vector<std::string> expected = { "caf\xc3\xa9", "plain" };
+
+            for (size_t chunkSize = 1; chunkSize <= content.size(); chunkSize++)
+            {
+                AssertLinesAreEqual(expected, DecodeInChunks(content, LM_FILETYPE::ANSI, chunkSize));
+            }
+        }
+
+        ///
+        /// Check that the lines of valid UTF-8 content are reported in place,
+        /// without being copied.
+        ///
+        TEST_METHOD(TestValidUtf8IsSplitInPlace)
+        {
+            const std::string content = "first \xc3\xa9\nsecond\n";
+            std::vector<const char*> lineStarts;
+            LogLineDecoder decoder;
+
+            decoder.SetEncoding(LM_FILETYPE::UTF8);
+            decoder.Decode(
+                reinterpret_cast<const BYTE*>(content.data()),
+                content.size(),
+                [&lineStarts](_In_reads_(Length) const char* Line, _In_ size_t Length)
+                {
+                    UNREFERENCED_PARAMETER(Length);
+                    lineStarts.push_back(Line);
+                });
+
+            Assert::AreEqual(static_cast<size_t>(2), lineStarts.size());
+            Assert::IsTrue(lineStarts[0] == content.data());
+            Assert::IsTrue(lineStarts[1] == content.data() + 9);
+        }
+
+        ///
+        /// Compares the throughput of the UTF-8 output path with the previous
+        /// one, which decoded the file to UTF-16 and encoded every line back
+        /// to UTF-8 when it was written. The results are written to the test
+        /// log.
+        ///
+        TEST_METHOD(TestUtf8OutputThroughput)
+        {
+            const std::string line = "2024-01-01T00:00:00.000Z INFO request served caf\xc3\xa9 \xe2\x82\xac 200 1234ms\n";
+            const int passes = 20;
+
+            //
+            // The chunks end on a line break, so the previous path doesn't
+            // have to keep the incomplete lines.
+            //
+            const size_t chunkSize = line.size() * 1024;
+
+            std::string content;
+            for (size_t i = 0; i < 64 * 1024; i++)
+            {
+                content += line;
+            }
+
+            LARGE_INTEGER frequency;
+            LARGE_INTEGER start;
+            LARGE_INTEGER end;
+
+            QueryPerformanceFrequency(&frequency);
+
+            //
+            // Previous path: UTF-8 to UTF-16 when the file is read, then
+            // UTF-16 to UTF-8 for every line written.
+            //
+            size_t legacyLines = 0;
+            size_t legacyBytes = 0;
+            std::wstring wideContent;
+            std::string output;
+
+            QueryPerformanceCounter(&start);
+
+            for (int pass = 0; pass < passes; pass++)
+            {
+                for (size_t offset = 0; offset < content.size(); offset += chunkSize)
+                {
+                    const int size = static_cast<int>((std::min)(chunkSize, content.size() - offset));
+                    const int wideSize = MultiByteToWideChar(CP_UTF8, 0, content.data() + offset, size, NULL, 0);
+
+                    wideContent.resize(wideSize);
+                    MultiByteToWideChar(CP_UTF8, 0, content.data() + offset, size, &wideContent[0], wideSize);
+
+                    size_t lineStart = 0;
+                    size_t lineBreak;
+
+                    while ((lineBreak = wideContent.find(L'\n', lineStart)) != std::wstring::npos)
+                    {
+                        const int lineLength = static_cast<int>(lineBreak - lineStart);
+                        const int outputSize = WideCharToMultiByte(CP_UTF8, 0, wideContent.data() + lineStart, lineLength, NULL, 0, NULL, NULL);
+
+                        output.resize(outputSize);
+                        WideCharToMultiByte(CP_UTF8, 0, wideContent.data() + lineStart, lineLength, &output[0], outputSize, NULL, NULL);
+
+                        legacyBytes += output.size();
+                        legacyLines++;
+                        lineStart = lineBreak + 1;
+                    }
+                }
+            }
+
+            QueryPerformanceCounter(&end);
+
+            const double legacySeconds = static_cast<double>(end.QuadPart - start.QuadPart) / frequency.QuadPart;
+
+            //
+            // UTF-8 path: the lines are validated and reported in place.
+            //
+            size_t lines = 0;
+            size_t bytes = 0;
+            LogLineDecoder decoder;
+
+            const LogLineDecoder::LineCallback onLine =
+                [&lines, &bytes](_In_reads_(Length) const char* Line, _In_ size_t Length)
+                {
+                    UNREFERENCED_PARAMETER(Line);
+                    bytes += Length;
+                    lines++;
+                };
+
+            decoder.SetEncoding(LM_FILETYPE::UTF8);
+
+            QueryPerformanceCounter(&start);
+
+            for (int pass = 0; pass < passes; pass++)
+            {
+                for (size_t offset = 0; offset < content.size(); offset += chunkSize)
+                {
+                    const size_t size = (std::min)(chunkSize, content.size() - offset);
+                    decoder.Decode(reinterpret_cast<const BYTE*>(content.data() + offset), size, onLine);
+                }
+            }
+
+            QueryPerformanceCounter(&end);
+
+            const double seconds = static_cast<double>(end.QuadPart - start.QuadPart) / frequency.QuadPart;
+            const double megabytes = static_cast<double>(content.size()) * passes / (1024 * 1024);
+
+            Assert::AreEqual(legacyLines, lines);
+            Assert::AreEqual(legacyBytes, bytes);
+
+            Logger::WriteMessage(
+                FORMAT_STRING(
+                    L"UTF-16 round trip: %.0f MB/s, UTF-8 pass-through: %.0f MB/s\n",
+                    megabytes / legacySeconds,
+                    megabytes / seconds
+                ).c_str()
+            );
+        }
+
+        ///
+        /// Check that the vectorized search finds the line breaks in every
+        /// position of long lines.
+        ///
+        TEST_METHOD(TestFindLineBreakInLongLines)
+        {
+            for (size_t length = 0; length < 70; length++)
+            {
+                std::string line(length, 'x');
+
+                Assert::AreEqual(length, LogLineDecoder::FindLineBreak(line.data(), line.size()));
+
+                for (size_t position = 0; position < length; position++)
+                {
+                    std::string withBreak = line;
+
+                    withBreak[position] = (position % 2 == 0) ? '\n' : '\r';
+                    Assert::AreEqual(position, LogLineDecoder::FindLineBreak(withBreak.data(), withBreak.size()));
+                }
+            }
+        }
+
+        ///
+        /// Check that a line without line break is reported once it reaches
+        /// MAX_LINE_BYTES, at the end of a chunk, without splitting a
+        /// character.
+        ///
+        TEST_METHOD(TestLongLineIsBounded)
+        {
+            const size_t chunkSize = 64 * 1024;
+            std::string content(LogLineDecoder::MAX_LINE_BYTES + 10, 'x');
+
+            content += "\xc3\xa9tail\nnext\n";
+
+            const std::vector<std::string> lines = DecodeInChunks(content, LM_FILETYPE::UTF8, chunkSize);
+
+            Assert::AreEqual(static_cast<size_t>(3), lines.size());
+            Assert::AreEqual(LogLineDecoder::MAX_LINE_BYTES, lines[0].size());
+            Assert::AreEqual("xxxxxxxxxx\xc3\xa9tail", lines[1].c_str());
+            Assert::AreEqual("next", lines[2].c_str());
+        }
+    };
+}
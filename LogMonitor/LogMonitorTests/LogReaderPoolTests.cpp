@@ -0,0 +1,124 @@
+﻿//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+
+#include "pch.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace LogMonitorTests
+{
+    ///
+    /// Tests the reader pool shared by the log file monitors.
+    ///
+    TEST_CLASS(LogReaderPoolTests)
+    {
+    public:
+
+        ///
+        /// Check that the jobs of a strand run in the order they were posted,
+        /// one at a time, and that Close waits for them.
+        ///
+        TEST_METHOD(TestStrandRunsJobsInOrder)
+        {
+            auto pool = std::make_shared<LogReaderPool>(4);
+            LogReaderStrand strand(pool);
+
+            std::vector<int> order;
+            volatile LONG running = 0;
+            volatile LONG overlapped = 0;
+            const int count = 1000;
+
+            for (int i = 0; i < count; i++)
+            {
+                Assert::IsTrue(strand.Post(
+                    [&order, &running, &overlapped, i]()
+                    {
+                        if (InterlockedIncrement(&running) != 1)
+                        {
+                            InterlockedExchange(&overlapped, 1);
+                        }
+
+                        order.push_back(i);
+
+                        InterlockedDecrement(&running);
+                    }));
+            }
+
+            strand.Close();
+
+            Assert::AreEqual(0L, static_cast<LONG>(overlapped));
+            Assert::AreEqual(static_cast<size_t>(count), order.size());
+
+            for (int i = 0; i < count; i++)
+            {
+                Assert::AreEqual(i, order[i]);
+            }
+
+            //
+            // A closed strand doesn't accept jobs.
+            //
+            Assert::IsFalse(strand.Post([]() {}));
+        }
+
+        ///
+        /// Check that different strands run in parallel, on a fixed number
+        /// of threads.
+        ///
+        TEST_METHOD(TestStrandsRunInParallel)
+        {
+            auto pool = std::make_shared<LogReaderPool>(2);
+            Assert::AreEqual(static_cast<size_t>(2), pool->ThreadCount());
+
+            LogReaderStrand first(pool);
+            LogReaderStrand second(pool);
+
+            HANDLE firstStarted = CreateEvent(nullptr, TRUE, FALSE, nullptr);
+            HANDLE secondStarted = CreateEvent(nullptr, TRUE, FALSE, nullptr);
+
+            //
+            // Each job waits for the other one, so they only finish if they
+            // run at the same time.
+            //
+            bool firstSawSecond = false;
+            bool secondSawFirst = false;
+
+            first.Post(
+                [&]()
+                {
+                    SetEvent(firstStarted);
+                    firstSawSecond = WaitForSingleObject(secondStarted, 10000) == WAIT_OBJECT_0;
+                });
+
+            second.Post(
+                [&]()
+                {
+                    SetEvent(secondStarted);
+                    secondSawFirst = WaitForSingleObject(firstStarted, 10000) == WAIT_OBJECT_0;
+                });
+
+            first.Close();
+            second.Close();
+
+            Assert::IsTrue(firstSawSecond);
+            Assert::IsTrue(secondSawFirst);
+
+            CloseHandle(firstStarted);
+            CloseHandle(secondStarted);
+        }
+
+        ///
+        /// Check the bounds of the thread count.
+        ///
+        TEST_METHOD(TestThreadCount)
+        {
+            const size_t defaultCount = LogReaderPool::DefaultThreadCount();
+
+            Assert::IsTrue(defaultCount >= 1);
+            Assert::IsTrue(defaultCount <= LogReaderPool::MAX_THREAD_COUNT);
+
+            Assert::AreEqual(static_cast<size_t>(1), LogReaderPool(0).ThreadCount());
+        }
+    };
+}
@@ -0,0 +1,326 @@
+﻿//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+
+#include "pch.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+#define BUFFER_SIZE 65536
+
+namespace LogMonitorTests
+{
+    ///
+    /// Tests the asynchronous mode of LogWriter, and its record ring.
+    ///
+    TEST_CLASS(LogWriterTests)
+    {
+        char bigOutBuf[BUFFER_SIZE];
+
+        void RedirectStdout()
+        {
+            ZeroMemory(bigOutBuf, sizeof(bigOutBuf));
+            fflush(stdout);
+            _setmode(_fileno(stdout), _O_BINARY);
+            setvbuf(stdout, bigOutBuf, _IOFBF, sizeof(bigOutBuf) - 1);
+        }
+
+    public:
+
+        ///
+        /// Check that the ring returns the records in order, and rejects
+        /// records when it's full.
+        ///
+        TEST_METHOD(TestRecordRingOrderAndCapacity)
+        {
+            LogRecordRing ring(3);
+            std::string record;
+
+            Assert::AreEqual(static_cast<size_t>(4), ring.Capacity());
+
+            for (int i = 0; i < 4; i++)
+            {
+                record = std::to_string(i);
+                Assert::IsTrue(ring.TryPush(record));
+            }
+
+            record = "full";
+            Assert::IsFalse(ring.TryPush(record));
+            Assert::AreEqual("full", record.c_str());
+
+            for (int i = 0; i < 4; i++)
+            {
+                Assert::IsTrue(ring.TryPop(record));
+                Assert::AreEqual(std::to_string(i), record);
+            }
+
+            Assert::IsFalse(ring.TryPop(record));
+            Assert::AreEqual(static_cast<size_t>(0), ring.ApproximateSize());
+        }
+
+        ///
+        /// Check that a line written through the writer thread reaches
+        /// stdout once Flush returns, and that lines are written
+        /// synchronously again after Stop.
+        ///
+        TEST_METHOD(TestAsynchronousWriteAndFlush)
+        {
+            LogWriter writer;
+
+            RedirectStdout();
+
+            Assert::IsTrue(writer.Start(1000));
+
+            writer.WriteConsoleLog(std::string("first line"));
+            writer.Flush();
+
+            Assert::AreEqual("first line\n", bigOutBuf);
+            Assert::AreEqual(static_cast<UINT64>(1), writer.GetStatistics().RecordsWritten);
+
+            writer.Stop();
+
+            ZeroMemory(bigOutBuf, sizeof(bigOutBuf));
+
+            writer.WriteConsoleLog(std::wstring(L"second line"));
+
+            Assert::AreEqual("second line\n", bigOutBuf);
+        }
+
+        ///
+        /// Check that a DropNewest source drops the lines that exceed the max
+        /// buffered bytes, and that the dropped lines are reported on Stop.
+        /// The writer waits for the flush latency after the first line, so
+        /// the lines accumulate.
+        ///
+        TEST_METHOD(TestOverflowPolicyDropNewest)
+        {
+            LogWriter writer;
+
+            RedirectStdout();
+
+            Assert::IsTrue(writer.Start(1000, 1024, 100));
+
+            const UINT32 sourceId = writer.RegisterSource(L"test source", OverflowPolicy::DropNewest, 1);
+
+            for (int i = 0; i < 50; i++)
+            {
+                writer.WriteConsoleLog("line " + std::to_string(1000 + i) + ".", sourceId);
+            }
+
+            writer.Flush();
+            writer.Stop();
+
+            Assert::AreEqual(static_cast<UINT64>(10), writer.GetStatistics().RecordsWritten);
+            Assert::AreEqual(static_cast<UINT64>(40), writer.GetDroppedRecords(sourceId));
+
+            const std::string output(bigOutBuf);
+
+            Assert::IsTrue(output.find("line 1009.\n") != std::string::npos);
+            Assert::IsTrue(output.find("line 1010.") == std::string::npos);
+            Assert::IsTrue(output.find("Dropped 40 lines of source 'test source'") != std::string::npos);
+        }
+
+        ///
+        /// Check that a DropOldest source keeps its last lines, and that the
+        /// lines of a Block source are never dropped.
+        ///
+        TEST_METHOD(TestOverflowPolicyDropOldest)
+        {
+            LogWriter writer;
+
+            RedirectStdout();
+
+            Assert::IsTrue(writer.Start(1000, 1024, 100));
+
+            const UINT32 sourceId = writer.RegisterSource(L"test source", OverflowPolicy::DropOldest, 1);
+
+            for (int i = 0; i < 50; i++)
+            {
+                writer.WriteConsoleLog("line " + std::to_string(1000 + i) + ".", sourceId);
+            }
+
+            writer.WriteConsoleLog(std::string("block line"));
+
+            writer.Flush();
+            writer.Stop();
+
+            Assert::AreEqual(static_cast<UINT64>(11), writer.GetStatistics().RecordsWritten);
+            Assert::AreEqual(static_cast<UINT64>(40), writer.GetDroppedRecords(sourceId));
+            Assert::AreEqual(static_cast<UINT64>(0), writer.GetDroppedRecords(LogWriter::LOGMONITOR_SOURCE_ID));
+
+            const std::string output(bigOutBuf);
+
+            Assert::AreEqual(static_cast<size_t>(0), output.find("line 1040.\nline 1041.\n"));
+            Assert::IsTrue(output.find("line 1049.\nblock line\n") != std::string::npos);
+        }
+
+        ///
+        /// Check that a Sample source keeps some of the lines that exceed the
+        /// max buffered bytes, and drops the others.
+        ///
+        TEST_METHOD(TestOverflowPolicySample)
+        {
+            LogWriter writer;
+
+            RedirectStdout();
+
+            Assert::IsTrue(writer.Start(1000, 1024, 100));
+
+            const UINT32 sourceId = writer.RegisterSource(L"test source", OverflowPolicy::Sample, 4);
+
+            for (int i = 0; i < 50; i++)
+            {
+                writer.WriteConsoleLog("line " + std::to_string(1000 + i) + ".", sourceId);
+            }
+
+            writer.Flush();
+            writer.Stop();
+
+            const UINT64 written = writer.GetStatistics().RecordsWritten;
+            const UINT64 dropped = writer.GetDroppedRecords(sourceId);
+
+            Assert::AreEqual(static_cast<UINT64>(50), written + dropped);
+            Assert::IsTrue(written > 10);
+            Assert::IsTrue(dropped > 0);
+        }
+
+        ///
+        /// Check that the lines of a source over its rate limit are
+        /// suppressed, that the other sources and the LogMonitor traces
+        /// aren't, and that the suppressed lines are reported on Stop.
+        ///
+        TEST_METHOD(TestRateLimit)
+        {
+            LogWriter writer;
+
+            RedirectStdout();
+
+            Assert::IsTrue(writer.Start(1000));
+
+            const UINT32 limitedId = writer.RegisterSource(L"limited source", OverflowPolicy::Block, 1, 1, 5);
+            const UINT32 otherId = writer.RegisterSource(L"other source", OverflowPolicy::Block, 1);
+
+            for (int i = 0; i < 50; i++)
+            {
+                writer.WriteConsoleLog("limited " + std::to_string(1000 + i) + ".", limitedId);
+                writer.WriteConsoleLog(std::string("other line"), otherId);
+            }
+
+            writer.WriteConsoleLog(std::string("trace line"));
+
+            writer.Flush();
+            writer.Stop();
+
+            const UINT64 suppressed = writer.GetSuppressedRecords(limitedId);
+
+            //
+            // The bucket gets a token per second, so one more line can pass
+            // if the loop is slow.
+            //
+            Assert::IsTrue(suppressed == 45 || suppressed == 44);
+            Assert::AreEqual(static_cast<UINT64>(0), writer.GetSuppressedRecords(otherId));
+            Assert::AreEqual(suppressed, writer.GetStatistics().SuppressedRecords);
+            Assert::AreEqual(101 - suppressed, writer.GetStatistics().RecordsWritten);
+
+            const std::string output(bigOutBuf);
+
+            Assert::IsTrue(output.find("limited 1004.\n") != std::string::npos);
+            Assert::IsTrue(output.find("trace line\n") != std::string::npos);
+            Assert::IsTrue(
+                output.find(std::to_string(suppressed) + " lines suppressed from source 'limited source'") != std::string::npos);
+        }
+
+        ///
+        /// Writes lines from 1 to 32 threads, and reports the throughput and
+        /// the 99th percentile of the time spent in WriteConsoleLog. Check
+        /// that no line is lost and that lines are grouped in batches.
+        ///
+        TEST_METHOD(TestConcurrentProducersThroughput)
+        {
+            const size_t producerCounts[] = { 1, 4, 32 };
+            const size_t linesPerProducer = 2000;
+
+            LARGE_INTEGER frequency;
+            QueryPerformanceFrequency(&frequency);
+
+            for (size_t producerCount : producerCounts)
+            {
+                LogWriter writer;
+
+                RedirectStdout();
+
+                Assert::IsTrue(writer.Start(LogWriter::DEFAULT_FLUSH_LATENCY_MILLIS, 1024));
+
+                std::vector<std::vector<LONGLONG>> latencies(producerCount);
+                std::vector<std::thread> producers;
+
+                LARGE_INTEGER start;
+                QueryPerformanceCounter(&start);
+
+                for (size_t p = 0; p < producerCount; p++)
+                {
+                    producers.emplace_back(
+                        [&writer, &latencies, p, linesPerProducer]()
+                        {
+                            latencies[p].reserve(linesPerProducer);
+
+                            for (size_t i = 0; i < linesPerProducer; i++)
+                            {
+                                std::string line = "producer " + std::to_string(p) + " line " + std::to_string(i);
+
+                                LARGE_INTEGER before;
+                                LARGE_INTEGER after;
+
+                                QueryPerformanceCounter(&before);
+                                writer.WriteConsoleLog(std::move(line));
+                                QueryPerformanceCounter(&after);
+
+                                latencies[p].push_back(after.QuadPart - before.QuadPart);
+                            }
+                        });
+                }
+
+                for (auto& producer : producers)
+                {
+                    producer.join();
+                }
+
+                writer.Flush();
+
+                LARGE_INTEGER end;
+                QueryPerformanceCounter(&end);
+
+                writer.Stop();
+
+                const LogWriter::Statistics statistics = writer.GetStatistics();
+                const UINT64 totalLines = producerCount * linesPerProducer;
+
+                Assert::AreEqual(totalLines, statistics.RecordsWritten);
+                Assert::IsTrue(statistics.Batches < totalLines);
+
+                std::vector<LONGLONG> allLatencies;
+                for (const auto& producerLatencies : latencies)
+                {
+                    allLatencies.insert(allLatencies.end(), producerLatencies.begin(), producerLatencies.end());
+                }
+
+                std::sort(allLatencies.begin(), allLatencies.end());
+
+                const double seconds = static_cast<double>(end.QuadPart - start.QuadPart) / frequency.QuadPart;
+                const double p99Micros = 1000000.0 * allLatencies[allLatencies.size() * 99 / 100] / frequency.QuadPart;
+
+                Logger::WriteMessage(
+                    FORMAT_STRING(
+                        L"%zu producers: %.0f lines/s, p99 enqueue %.2f us, %llu batches, %llu full ring waits\n",
+                        producerCount,
+                        totalLines / seconds,
+                        p99Micros,
+                        statistics.Batches,
+                        statistics.FullRingWaits
+                    ).c_str()
+                );
+            }
+        }
+    };
+}
@@ -0,0 +1,110 @@
+﻿//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+
+#include "pch.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace LogMonitorTests
+{
+    ///
+    /// Tests of the LruCache class.
+    ///
+    TEST_CLASS(LruCacheTests)
+    {
+    public:
+
+        ///
+        /// Check that the least recently used entry is evicted when the
+        /// cache is full, and that Find refreshes the entries.
+        ///
+        TEST_METHOD(TestLeastRecentlyUsedIsEvicted)
+        {
+            std::vector<int> evicted;
+
+            LruCache<int, std::wstring> cache(
+                3,
+                [&evicted](const int& Key, std::wstring&) { evicted.push_back(Key); });
+
+            cache.Insert(1, L"one");
+            cache.Insert(2, L"two");
+            cache.Insert(3, L"three");
+
+            //
+            // 1 becomes the most recently used, so 2 is evicted.
+            //
+            Assert::IsNotNull(cache.Find(1));
+            cache.Insert(4, L"four");
+
+            Assert::AreEqual((size_t)1, evicted.size());
+            Assert::AreEqual(2, evicted[0]);
+            Assert::IsNull(cache.Find(2));
+
+            Assert::AreEqual((size_t)3, cache.Size());
+            Assert::AreEqual(L"one", cache.Find(1)->c_str());
+            Assert::AreEqual(L"three", cache.Find(3)->c_str());
+            Assert::AreEqual(L"four", cache.Find(4)->c_str());
+
+            Assert::AreEqual((UINT64)1, cache.Evictions());
+        }
+
+        ///
+        /// Check that the eviction callback is invoked for replaced and
+        /// removed entries, and when the cache is cleared or destroyed.
+        ///
+        TEST_METHOD(TestEvictCallbackReleasesEveryEntry)
+        {
+            int released = 0;
+
+            {
+                LruCache<int, int> cache(
+                    10,
+                    [&released](const int&, int&) { released++; });
+
+                cache.Insert(1, 1);
+                cache.Insert(2, 2);
+                cache.Insert(3, 3);
+
+                //
+                // Replacing a value releases the old one.
+                //
+                cache.Insert(1, 10);
+                Assert::AreEqual(1, released);
+                Assert::AreEqual(10, *cache.Find(1));
+
+                Assert::IsTrue(cache.Remove(2));
+                Assert::IsFalse(cache.Remove(2));
+                Assert::AreEqual(2, released);
+
+                cache.Clear();
+                Assert::AreEqual(4, released);
+                Assert::AreEqual((size_t)0, cache.Size());
+
+                cache.Insert(5, 5);
+            }
+
+            Assert::AreEqual(5, released);
+        }
+
+        ///
+        /// Check the hit and miss counters.
+        ///
+        TEST_METHOD(TestHitAndMissCounters)
+        {
+            LruCache<std::wstring, int> cache(2);
+
+            Assert::IsNull(cache.Find(L"a"));
+            cache.Insert(L"a", 1);
+
+            Assert::IsNotNull(cache.Find(L"a"));
+            Assert::IsNotNull(cache.Find(L"a"));
+            Assert::IsNull(cache.Find(L"b"));
+
+            Assert::AreEqual((UINT64)2, cache.Hits());
+            Assert::AreEqual((UINT64)2, cache.Misses());
+            Assert::AreEqual((UINT64)0, cache.Evictions());
+        }
+    };
+}
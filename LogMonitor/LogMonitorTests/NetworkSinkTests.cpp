@@ -0,0 +1,705 @@
+﻿//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+
+#include "pch.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace LogMonitorTests
+{
+    ///
+    /// Tests of the NetworkSink class, against a collector listening on the
+    /// loopback address.
+    ///
+    TEST_CLASS(NetworkSinkTests)
+    {
+        static NetworkOutputSettings MakeSettings(
+            _In_ USHORT Port,
+            _In_ NetworkProtocol Protocol,
+            _In_ NetworkFraming Framing
+            )
+        {
+            NetworkOutputSettings settings;
+
+            settings.Host = L"127.0.0.1";
+            settings.Port = Port;
+            settings.Protocol = Protocol;
+            settings.Framing = Framing;
+            settings.MaxBatchDelayMillis = 5;
+            settings.MinReconnectDelayMillis = 10;
+            settings.MaxReconnectDelayMillis = 200;
+
+            return settings;
+        }
+
+        ///
+        /// Creates a socket bound to the loopback address. With a zero port,
+        /// returns the port picked by the system.
+        ///
+        static SOCKET Bind(
+            _In_ int Type,
+            _Inout_ USHORT& Port
+            )
+        {
+            SOCKET socket = ::socket(AF_INET, Type, 0);
+            Assert::AreNotEqual(INVALID_SOCKET, socket);
+
+            const BOOL reuse = TRUE;
+            setsockopt(socket, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&reuse), sizeof(reuse));
+
+            sockaddr_in address{};
+            address.sin_family = AF_INET;
+            address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            address.sin_port = htons(Port);
+
+            Assert::AreEqual(0, bind(socket, reinterpret_cast<sockaddr*>(&address), sizeof(address)));
+
+            int length = sizeof(address);
+            getsockname(socket, reinterpret_cast<sockaddr*>(&address), &length);
+            Port = ntohs(address.sin_port);
+
+            if (Type == SOCK_STREAM)
+            {
+                Assert::AreEqual(0, listen(socket, SOMAXCONN));
+            }
+
+            return socket;
+        }
+
+        ///
+        /// Accepts a connection and reads it until the sink closes it.
+        ///
+        static std::string ReceiveConnection(
+            _In_ SOCKET Listener
+            )
+        {
+            SOCKET connection = accept(Listener, NULL, NULL);
+            Assert::AreNotEqual(INVALID_SOCKET, connection);
+
+            std::string data;
+            char buffer[64 * 1024];
+            int received;
+
+            while ((received = recv(connection, buffer, sizeof(buffer), 0)) > 0)
+            {
+                data.append(buffer, received);
+            }
+
+            closesocket(connection);
+
+            return data;
+        }
+
+        ///
+        /// Reads until the data has the expected number of octet-counted
+        /// syslog frames.
+        ///
+        static void ReceiveFrames(
+            _In_ SOCKET Connection,
+            _Inout_ std::string& Data,
+            _In_ size_t Frames
+            )
+        {
+            char buffer[4096];
+
+            while (ParseSyslogFrames(Data).size() < Frames)
+            {
+                const int received = recv(Connection, buffer, sizeof(buffer), 0);
+                Assert::IsTrue(received > 0);
+
+                Data.append(buffer, received);
+            }
+        }
+
+        ///
+        /// Splits a TCP stream of "LEN SP MSG" frames, ignoring a truncated
+        /// last frame.
+        ///
+        static std::vector<std::string> ParseSyslogFrames(
+            _In_ const std::string& Data
+            )
+        {
+            std::vector<std::string> messages;
+            size_t offset = 0;
+
+            while (offset < Data.size())
+            {
+                const size_t space = Data.find(' ', offset);
+
+                if (space == std::string::npos)
+                {
+                    break;
+                }
+
+                const size_t length = std::stoul(Data.substr(offset, space - offset));
+
+                if (space + 1 + length > Data.size())
+                {
+                    break;
+                }
+
+                messages.push_back(Data.substr(space + 1, length));
+                offset = space + 1 + length;
+            }
+
+            return messages;
+        }
+
+        ///
+        /// Returns the MSG of a syslog message, after checking its header.
+        ///
+        static std::string SyslogMessage(
+            _In_ const std::string& Message
+            )
+        {
+            Assert::AreEqual(0, Message.compare(0, 6, "<14>1 "));
+
+            //
+            // TIMESTAMP HOSTNAME APP-NAME PROCID MSGID STRUCTURED-DATA
+            //
+            size_t offset = 6;
+
+            for (int field = 0; field < 6; field++)
+            {
+                offset = Message.find(' ', offset) + 1;
+                Assert::AreNotEqual(static_cast<size_t>(0), offset);
+            }
+
+            const std::string header = Message.substr(0, offset);
+            const std::string suffix = " logmonitor " + std::to_string(GetCurrentProcessId()) + " - - ";
+
+            Assert::IsTrue(header.size() > suffix.size());
+            Assert::AreEqual(suffix.c_str(), header.substr(header.size() - suffix.size()).c_str());
+
+            return Message.substr(offset);
+        }
+
+        static UINT32 ReadBigEndian(
+            _In_ const std::string& Data,
+            _Inout_ size_t& Offset,
+            _In_ size_t Bytes
+            )
+        {
+            UINT32 value = 0;
+
+            for (size_t i = 0; i < Bytes; i++)
+            {
+                value = (value << 8) | static_cast<UINT8>(Data[Offset++]);
+            }
+
+            return value;
+        }
+
+        ///
+        /// Reads a MessagePack str.
+        ///
+        static std::string ReadMessagePackString(
+            _In_ const std::string& Data,
+            _Inout_ size_t& Offset
+            )
+        {
+            const UINT8 type = static_cast<UINT8>(Data[Offset++]);
+            size_t length;
+
+            if ((type & 0xE0) == 0xA0)
+            {
+                length = type & 0x1F;
+            }
+            else if (type == 0xD9)
+            {
+                length = ReadBigEndian(Data, Offset, 1);
+            }
+            else if (type == 0xDA)
+            {
+                length = ReadBigEndian(Data, Offset, 2);
+            }
+            else
+            {
+                Assert::AreEqual(0xDB, static_cast<int>(type));
+                length = ReadBigEndian(Data, Offset, 4);
+            }
+
+            const std::string value = Data.substr(Offset, length);
+            Offset += length;
+
+            return value;
+        }
+
+    public:
+
+        TEST_METHOD_INITIALIZE(InitializeNetworkSinkTest)
+        {
+            WSADATA wsaData;
+            Assert::AreEqual(0, WSAStartup(MAKEWORD(2, 2), &wsaData));
+        }
+
+        TEST_METHOD_CLEANUP(CleanupNetworkSinkTest)
+        {
+            WSACleanup();
+        }
+
+        ///
+        /// Check that the lines are sent over TCP as octet-counted RFC 5424
+        /// messages, including the lines with line breaks, and that Stop
+        /// sends the pending lines.
+        ///
+        TEST_METHOD(TestSyslogTcp)
+        {
+            USHORT port = 0;
+            SOCKET listener = Bind(SOCK_STREAM, port);
+
+            NetworkSink sink(MakeSettings(port, NetworkProtocol::Tcp, NetworkFraming::Syslog));
+
+            Assert::AreEqual(static_cast<DWORD>(ERROR_SUCCESS), sink.Start());
+
+            const std::string records[] = {
+                "first line",
+                "<Event>\n  <Data>multi-line</Data>\n</Event>",
+                ""
+            };
+
+            for (const auto& record : records)
+            {
+                sink.Append(record.data(), record.size());
+            }
+
+            sink.Stop();
+
+            const auto messages = ParseSyslogFrames(ReceiveConnection(listener));
+
+            closesocket(listener);
+
+            Assert::AreEqual(_countof(records), messages.size());
+
+            for (size_t i = 0; i < messages.size(); i++)
+            {
+                Assert::AreEqual(records[i].c_str(), SyslogMessage(messages[i]).c_str());
+            }
+
+            const auto statistics = sink.GetStatistics();
+
+            Assert::AreEqual(3ULL, statistics.RecordsSent);
+            Assert::AreEqual(1ULL, statistics.Connections);
+            Assert::AreEqual(0ULL, statistics.DroppedRecords);
+        }
+
+        ///
+        /// Check that each line is sent in its own datagram over UDP.
+        ///
+        TEST_METHOD(TestSyslogUdp)
+        {
+            USHORT port = 0;
+            SOCKET receiver = Bind(SOCK_DGRAM, port);
+
+            const DWORD timeout = 5000;
+            setsockopt(receiver, SOL_SOCKET, SO_RCVTIMEO, reinterpret_cast<const char*>(&timeout), sizeof(timeout));
+
+            NetworkSink sink(MakeSettings(port, NetworkProtocol::Udp, NetworkFraming::Syslog));
+
+            Assert::AreEqual(static_cast<DWORD>(ERROR_SUCCESS), sink.Start());
+
+            for (int i = 0; i < 10; i++)
+            {
+                const std::string record = "line " + std::to_string(i);
+
+                sink.Append(record.data(), record.size());
+            }
+
+            for (int i = 0; i < 10; i++)
+            {
+                char buffer[2048];
+                const int received = recv(receiver, buffer, sizeof(buffer), 0);
+
+                Assert::IsTrue(received > 0);
+                Assert::AreEqual(
+                    ("line " + std::to_string(i)).c_str(),
+                    SyslogMessage(std::string(buffer, received)).c_str());
+            }
+
+            sink.Stop();
+            closesocket(receiver);
+
+            Assert::AreEqual(10ULL, sink.GetStatistics().RecordsSent);
+        }
+
+        ///
+        /// Check the Forward mode messages: the tag, then an array with an
+        /// EventTime and a "log" record per line.
+        ///
+        TEST_METHOD(TestFluentForward)
+        {
+            USHORT port = 0;
+            SOCKET listener = Bind(SOCK_STREAM, port);
+
+            auto settings = MakeSettings(port, NetworkProtocol::Tcp, NetworkFraming::FluentForward);
+            settings.Tag = L"container.app";
+
+            NetworkSink sink(settings);
+
+            Assert::AreEqual(static_cast<DWORD>(ERROR_SUCCESS), sink.Start());
+
+            FILETIME before;
+            GetSystemTimeAsFileTime(&before);
+
+            const std::string records[] = {
+                "short",
+                std::string(40, 'a'),
+                std::string(300, 'b'),
+                std::string(70000, 'c')
+            };
+
+            for (const auto& record : records)
+            {
+                sink.Append(record.data(), record.size());
+            }
+
+            sink.Stop();
+
+            const std::string data = ReceiveConnection(listener);
+
+            closesocket(listener);
+
+            const UINT32 beforeSeconds = static_cast<UINT32>(
+                TimestampFormatter::ToTicks(before) / TimestampFormatter::TICKS_PER_SECOND - 11644473600ULL);
+
+            size_t offset = 0;
+            size_t entries = 0;
+
+            while (offset < data.size())
+            {
+                Assert::AreEqual(0x92, static_cast<int>(static_cast<UINT8>(data[offset++])));
+                Assert::AreEqual("container.app", ReadMessagePackString(data, offset).c_str());
+
+                const UINT8 arrayType = static_cast<UINT8>(data[offset++]);
+                Assert::AreEqual(0x90, arrayType & 0xF0);
+
+                for (int i = 0; i < (arrayType & 0x0F); i++, entries++)
+                {
+                    Assert::AreEqual(0x92, static_cast<int>(static_cast<UINT8>(data[offset++])));
+                    Assert::AreEqual(0xD7, static_cast<int>(static_cast<UINT8>(data[offset++])));
+                    Assert::AreEqual(0x00, static_cast<int>(data[offset++]));
+
+                    const UINT32 seconds = ReadBigEndian(data, offset, 4);
+                    const UINT32 nanoseconds = ReadBigEndian(data, offset, 4);
+
+                    Assert::IsTrue(seconds >= beforeSeconds && seconds < beforeSeconds + 60);
+                    Assert::IsTrue(nanoseconds < 1000000000);
+
+                    Assert::AreEqual(0x81, static_cast<int>(static_cast<UINT8>(data[offset++])));
+                    Assert::AreEqual("log", ReadMessagePackString(data, offset).c_str());
+                    Assert::IsTrue(records[entries] == ReadMessagePackString(data, offset));
+                }
+            }
+
+            Assert::AreEqual(_countof(records), entries);
+        }
+
+        ///
+        /// Check that the sink connects again after the collector restarts,
+        /// without losing the lines appended while it was down, and report
+        /// the time from the restart to the first line received.
+        ///
+        TEST_METHOD(TestReconnect)
+        {
+            USHORT port = 0;
+            SOCKET listener = Bind(SOCK_STREAM, port);
+
+            NetworkSink sink(MakeSettings(port, NetworkProtocol::Tcp, NetworkFraming::Syslog));
+
+            Assert::AreEqual(static_cast<DWORD>(ERROR_SUCCESS), sink.Start());
+
+            sink.Append("before", 6);
+
+            SOCKET connection = accept(listener, NULL, NULL);
+            Assert::AreNotEqual(INVALID_SOCKET, connection);
+
+            std::string data;
+            ReceiveFrames(connection, data, 1);
+            Assert::AreEqual("before", SyslogMessage(ParseSyslogFrames(data)[0]).c_str());
+
+            //
+            // Stop the collector, and append lines while it's down.
+            //
+            closesocket(connection);
+            closesocket(listener);
+
+            for (int i = 0; i < 10; i++)
+            {
+                const std::string record = "while down " + std::to_string(i);
+
+                sink.Append(record.data(), record.size());
+                Sleep(20);
+            }
+
+            LARGE_INTEGER frequency;
+            LARGE_INTEGER restart;
+            LARGE_INTEGER received;
+
+            QueryPerformanceFrequency(&frequency);
+            QueryPerformanceCounter(&restart);
+
+            listener = Bind(SOCK_STREAM, port);
+
+            connection = accept(listener, NULL, NULL);
+            Assert::AreNotEqual(INVALID_SOCKET, connection);
+
+            data.clear();
+            ReceiveFrames(connection, data, 10);
+
+            QueryPerformanceCounter(&received);
+
+            closesocket(connection);
+            closesocket(listener);
+
+            const auto messages = ParseSyslogFrames(data);
+
+            Assert::AreEqual(static_cast<size_t>(10), messages.size());
+
+            for (int i = 0; i < 10; i++)
+            {
+                Assert::AreEqual(("while down " + std::to_string(i)).c_str(), SyslogMessage(messages[i]).c_str());
+            }
+
+            sink.Stop();
+
+            Assert::AreEqual(2ULL, sink.GetStatistics().Connections);
+
+            Logger::WriteMessage(
+                FORMAT_STRING(
+                    L"Reconnect latency after the collector restarted: %.1f ms\n",
+                    static_cast<double>(received.QuadPart - restart.QuadPart) * 1000 / frequency.QuadPart
+                ).c_str()
+            );
+        }
+
+        ///
+        /// Check that the newest lines are dropped once the pending lines
+        /// use the max buffered bytes.
+        ///
+        TEST_METHOD(TestMaxBufferedBytes)
+        {
+            USHORT port = 0;
+            SOCKET listener = Bind(SOCK_STREAM, port);
+
+            auto settings = MakeSettings(port, NetworkProtocol::Tcp, NetworkFraming::Syslog);
+            settings.MaxBufferedBytes = 1000;
+
+            //
+            // Not started, so nothing is sent.
+            //
+            NetworkSink sink(settings);
+            const std::string record(100, 'x');
+
+            for (int i = 0; i < 20; i++)
+            {
+                sink.Append(record.data(), record.size());
+            }
+
+            const UINT64 dropped = sink.GetStatistics().DroppedRecords;
+
+            Assert::IsTrue(dropped > 10 && dropped < 20);
+
+            Assert::AreEqual(static_cast<DWORD>(ERROR_SUCCESS), sink.Start());
+            sink.Stop();
+
+            const auto messages = ParseSyslogFrames(ReceiveConnection(listener));
+
+            closesocket(listener);
+
+            Assert::AreEqual(20 - dropped, static_cast<UINT64>(messages.size()));
+        }
+
+        ///
+        /// Check that the lines queued while the collector is down are kept
+        /// on disk when the sink stops, and sent by the next sink on the same
+        /// queue directory, before its own lines.
+        ///
+        TEST_METHOD(TestDurableQueue)
+        {
+            USHORT port = 0;
+            SOCKET listener = Bind(SOCK_STREAM, port);
+
+            closesocket(listener);
+
+            const std::wstring directory = CreateTempDirectory();
+            Assert::IsFalse(directory.empty());
+
+            auto settings = MakeSettings(port, NetworkProtocol::Tcp, NetworkFraming::Syslog);
+            settings.QueueDirectory = directory;
+
+            {
+                NetworkSink sink(settings);
+
+                Assert::AreEqual(static_cast<DWORD>(ERROR_SUCCESS), sink.Start());
+
+                for (int i = 0; i < 10; i++)
+                {
+                    const std::string record = "queued " + std::to_string(i);
+
+                    sink.Append(record.data(), record.size());
+                }
+
+                sink.Stop();
+
+                Assert::AreEqual(0ULL, sink.GetStatistics().RecordsSent);
+                Assert::AreEqual(0ULL, sink.GetStatistics().DroppedRecords);
+            }
+
+            listener = Bind(SOCK_STREAM, port);
+
+            {
+                NetworkSink sink(settings);
+
+                Assert::AreEqual(static_cast<DWORD>(ERROR_SUCCESS), sink.Start());
+
+                sink.Append("after restart", 13);
+                sink.Stop();
+
+                Assert::AreEqual(11ULL, sink.GetStatistics().RecordsSent);
+            }
+
+            const auto messages = ParseSyslogFrames(ReceiveConnection(listener));
+
+            closesocket(listener);
+
+            Assert::AreEqual(static_cast<size_t>(11), messages.size());
+
+            for (int i = 0; i < 10; i++)
+            {
+                Assert::AreEqual(("queued " + std::to_string(i)).c_str(), SyslogMessage(messages[i]).c_str());
+            }
+
+            Assert::AreEqual("after restart", SyslogMessage(messages[10]).c_str());
+
+            //
+            // Everything was acknowledged.
+            //
+            {
+                DurableQueue queue(directory);
+
+                Assert::AreEqual(static_cast<DWORD>(ERROR_SUCCESS), queue.Open());
+                Assert::AreEqual(0ULL, queue.GetStatistics().ReplayedRecords);
+            }
+
+            WIN32_FIND_DATAW findData;
+            HANDLE find = FindFirstFileW((directory + L"\\*").c_str(), &findData);
+
+            if (find != INVALID_HANDLE_VALUE)
+            {
+                do
+                {
+                    DeleteFileW((directory + L"\\" + findData.cFileName).c_str());
+                } while (FindNextFileW(find, &findData));
+
+                FindClose(find);
+            }
+
+            RemoveDirectoryW(directory.c_str());
+        }
+
+        ///
+        /// Check that the LogWriter sends each of its lines to the network
+        /// sink.
+        ///
+        TEST_METHOD(TestLogWriterNetworkSink)
+        {
+            USHORT port = 0;
+            SOCKET listener = Bind(SOCK_STREAM, port);
+
+            {
+                LogWriter writer;
+                auto sink = std::make_unique<NetworkSink>(
+                    MakeSettings(port, NetworkProtocol::Tcp, NetworkFraming::Syslog));
+
+                Assert::AreEqual(static_cast<DWORD>(ERROR_SUCCESS), sink->Start());
+
+                writer.SetNetworkSink(std::move(sink), false);
+
+                writer.WriteConsoleLog(std::string("synchronous line"));
+
+                Assert::IsTrue(writer.Start(0));
+
+                for (int i = 0; i < 100; i++)
+                {
+                    writer.WriteConsoleLog("line " + std::to_string(i));
+                }
+
+                writer.Stop();
+
+                Assert::AreEqual(101ULL, writer.GetNetworkSink()->GetStatistics().RecordsSent);
+            }
+
+            const auto messages = ParseSyslogFrames(ReceiveConnection(listener));
+
+            closesocket(listener);
+
+            Assert::AreEqual(static_cast<size_t>(101), messages.size());
+            Assert::AreEqual("synchronous line", SyslogMessage(messages[0]).c_str());
+
+            for (int i = 0; i < 100; i++)
+            {
+                Assert::AreEqual(("line " + std::to_string(i)).c_str(), SyslogMessage(messages[i + 1]).c_str());
+            }
+        }
+
+        ///
+        /// Measure the throughput of the sink to a collector that reads as
+        /// fast as it can, and the number of lines per batch.
+        ///
+        TEST_METHOD(TestThroughput)
+        {
+            const int records = 200000;
+            USHORT port = 0;
+            SOCKET listener = Bind(SOCK_STREAM, port);
+
+            auto settings = MakeSettings(port, NetworkProtocol::Tcp, NetworkFraming::Syslog);
+            settings.MaxBufferedBytes = 256 * 1024 * 1024;
+
+            NetworkSink sink(settings);
+
+            Assert::AreEqual(static_cast<DWORD>(ERROR_SUCCESS), sink.Start());
+
+            std::string data;
+            std::thread collector([&]() { data = ReceiveConnection(listener); });
+
+            const std::string record =
+                "2024-01-02T03:04:05.678Z 10.0.0.1 GET /api/values 200 - a typical access log line of a web server";
+
+            LARGE_INTEGER frequency;
+            LARGE_INTEGER start;
+            LARGE_INTEGER end;
+
+            QueryPerformanceFrequency(&frequency);
+            QueryPerformanceCounter(&start);
+
+            for (int i = 0; i < records; i++)
+            {
+                sink.Append(record.data(), record.size());
+            }
+
+            sink.Stop();
+            collector.join();
+
+            QueryPerformanceCounter(&end);
+
+            closesocket(listener);
+
+            const double seconds = static_cast<double>(end.QuadPart - start.QuadPart) / frequency.QuadPart;
+            const auto statistics = sink.GetStatistics();
+
+            Assert::AreEqual(static_cast<size_t>(records), ParseSyslogFrames(data).size());
+            Assert::AreEqual(static_cast<UINT64>(records), statistics.RecordsSent);
+
+            Logger::WriteMessage(
+                FORMAT_STRING(
+                    L"NetworkSink: %.0f lines/s, %.1f MB/s, %.0f lines per batch\n",
+                    records / seconds,
+                    data.size() / seconds / (1024 * 1024),
+                    static_cast<double>(statistics.RecordsSent) / statistics.Batches
+                ).c_str()
+            );
+        }
+    };
+}
@@ -0,0 +1,444 @@
+﻿//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+
+#include "pch.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace LogMonitorTests
+{
+    ///
+    /// Tests of the ProcessOutputRelay class, with the lines written to a
+    /// file sink.
+    ///
+    TEST_CLASS(ProcessOutputRelayTests)
+    {
+        std::wstring m_directory;
+
+        static std::string ReadFileContent(
+            _In_ const std::wstring& Path
+            )
+        {
+            std::ifstream file(Path, std::ios::binary);
+
+            return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        }
+
+        static void WritePipe(
+            _In_ HANDLE Pipe,
+            _In_ const std::string& Data
+            )
+        {
+            DWORD written = 0;
+
+            Assert::IsTrue(WriteFile(Pipe, Data.data(), static_cast<DWORD>(Data.size()), &written, NULL) != FALSE);
+            Assert::AreEqual(static_cast<DWORD>(Data.size()), written);
+        }
+
+        ///
+        /// Waits until the relay has read the pipe Reads times, so the next
+        /// write isn't read together with the earlier ones.
+        ///
+        static void WaitForReads(
+            _In_ const ProcessOutputRelay& Relay,
+            _In_ UINT64 Reads
+            )
+        {
+            const ULONGLONG start = GetTickCount64();
+
+            while (Relay.GetStatistics().Reads < Reads)
+            {
+                Assert::IsTrue(GetTickCount64() - start < 5000);
+                Sleep(1);
+            }
+        }
+
+        ///
+        /// Creates a pipe with an inheritable write handle.
+        ///
+        static void CreateRelayPipe(
+            _Out_ HANDLE& ReadPipe,
+            _Out_ HANDLE& WritePipe
+            )
+        {
+            SECURITY_ATTRIBUTES attributes{};
+            attributes.nLength = sizeof(attributes);
+            attributes.bInheritHandle = TRUE;
+
+            Assert::IsTrue(CreatePipe(&ReadPipe, &WritePipe, &attributes, ProcessOutputRelay::PIPE_BUFFER_BYTES) != FALSE);
+            Assert::IsTrue(SetHandleInformation(ReadPipe, HANDLE_FLAG_INHERIT, 0) != FALSE);
+        }
+
+        static void StartWriter(
+            _In_ LogWriter& Writer,
+            _In_ const std::wstring& Path
+            )
+        {
+            Writer.SetFileSink(std::make_unique<RotatingFileSink>(Path, 1024ULL * 1024 * 1024), false);
+
+            Assert::IsTrue(Writer.Start(0));
+        }
+
+    public:
+
+        TEST_METHOD_INITIALIZE(InitializeProcessOutputRelayTest)
+        {
+            m_directory = CreateTempDirectory();
+            Assert::IsFalse(m_directory.empty());
+        }
+
+        TEST_METHOD_CLEANUP(CleanupProcessOutputRelayTest)
+        {
+            WIN32_FIND_DATAW findData;
+            HANDLE find = FindFirstFileW((m_directory + L"\\*").c_str(), &findData);
+
+            if (find != INVALID_HANDLE_VALUE)
+            {
+                do
+                {
+                    DeleteFileW((m_directory + L"\\" + findData.cFileName).c_str());
+                } while (FindNextFileW(find, &findData));
+
+                FindClose(find);
+            }
+
+            RemoveDirectoryW(m_directory.c_str());
+        }
+
+        ///
+        /// Check that the lines split between writes are written whole, with
+        /// the CR LF and CR line breaks replaced, and that the last line is
+        /// written without a line break when the pipe is closed.
+        ///
+        TEST_METHOD(TestLineAssembly)
+        {
+            const std::wstring path = m_directory + L"\\output.log";
+            LogWriter writer;
+            HANDLE readPipe;
+            HANDLE writePipe;
+
+            StartWriter(writer, path);
+            CreateRelayPipe(readPipe, writePipe);
+
+            ProcessOutputRelay relay(readPipe, writer.RegisterSource(L"Process stdout", OverflowPolicy::Block, 1), writer);
+
+            Assert::AreEqual(static_cast<DWORD>(ERROR_SUCCESS), relay.Start());
+
+            WritePipe(writePipe, "first li");
+            WaitForReads(relay, 1);
+            WritePipe(writePipe, "ne\r\nsecond line\n\nthird");
+            WaitForReads(relay, 2);
+            WritePipe(writePipe, " line\r");
+            WaitForReads(relay, 3);
+            WritePipe(writePipe, "\nfourth line\rlast line");
+
+            CloseHandle(writePipe);
+
+            Assert::IsTrue(relay.WaitForEnd(5000));
+
+            relay.Stop();
+            writer.Stop();
+
+            Assert::AreEqual(
+                "first line\nsecond line\n\nthird line\nfourth line\nlast line\n",
+                ReadFileContent(path).c_str());
+            Assert::AreEqual(6ULL, relay.GetStatistics().Lines);
+            Assert::IsTrue(relay.GetStatistics().Reads >= 4);
+        }
+
+        ///
+        /// Check that Stop returns while the pipe is still open, and writes
+        /// the incomplete last line.
+        ///
+        TEST_METHOD(TestStopWhilePipeOpen)
+        {
+            const std::wstring path = m_directory + L"\\output.log";
+            LogWriter writer;
+            HANDLE readPipe;
+            HANDLE writePipe;
+
+            StartWriter(writer, path);
+            CreateRelayPipe(readPipe, writePipe);
+
+            {
+                ProcessOutputRelay relay(readPipe, LogWriter::LOGMONITOR_SOURCE_ID, writer);
+
+                Assert::AreEqual(static_cast<DWORD>(ERROR_SUCCESS), relay.Start());
+
+                WritePipe(writePipe, "complete\npartial");
+
+                Assert::IsFalse(relay.WaitForEnd(100));
+
+                relay.Stop();
+
+                Assert::AreEqual(2ULL, relay.GetStatistics().Lines);
+            }
+
+            CloseHandle(writePipe);
+            writer.Stop();
+
+            Assert::AreEqual("complete\npartial\n", ReadFileContent(path).c_str());
+        }
+
+        ///
+        /// Check that the stream of a Process source is written in the JSON
+        /// output format, with its encoding detected from its BOM, and the
+        /// lines that are JSON objects written as fields.
+        ///
+        TEST_METHOD(TestProcessSourceJson)
+        {
+            const std::wstring path = m_directory + L"\\output.log";
+            LogWriter writer;
+            HANDLE readPipe;
+            HANDLE writePipe;
+
+            writer.SetOutputFormat(OutputFormat::Json);
+            StartWriter(writer, path);
+            CreateRelayPipe(readPipe, writePipe);
+
+            ProcessOutputRelay relay(readPipe, writer.RegisterSource(L"Process stdout", OverflowPolicy::Block, 1), writer);
+
+            relay.SetProcessSource("stdout", true);
+
+            Assert::AreEqual(static_cast<DWORD>(ERROR_SUCCESS), relay.Start());
+
+            const std::wstring content = L"\xfeffplain \"text\"\r\n{\"level\":\"info\",\"n\":1}\r\n{\"broken\":\r\n";
+
+            WritePipe(writePipe, std::string(reinterpret_cast<const char*>(content.data()), content.size() * sizeof(WCHAR)));
+
+            CloseHandle(writePipe);
+
+            Assert::IsTrue(relay.WaitForEnd(5000));
+
+            relay.Stop();
+            writer.Stop();
+
+            const std::string output = ReadFileContent(path);
+            const std::string prefix = "{\"Source\":\"Process\",\"LogEntry\":{\"Time\":\"";
+            const char* expectedEnds[] = {
+                "\",\"Stream\":\"stdout\",\"Logline\":\"plain \\\"text\\\"\"}}",
+                "\",\"Stream\":\"stdout\",\"Fields\":{\"level\":\"info\",\"n\":1}}}",
+                "\",\"Stream\":\"stdout\",\"Logline\":\"{\\\"broken\\\":\"}}",
+            };
+            size_t start = 0;
+
+            for (const char* expectedEnd : expectedEnds)
+            {
+                const size_t end = output.find('\n', start);
+
+                Assert::AreNotEqual(std::string::npos, end);
+
+                const std::string line = output.substr(start, end - start);
+                const size_t timeEnd = line.find('"', prefix.size());
+
+                Assert::AreEqual(0, line.compare(0, prefix.size(), prefix));
+                Assert::AreNotEqual(std::string::npos, timeEnd);
+                Assert::AreEqual(expectedEnd, line.substr(timeEnd).c_str());
+
+                start = end + 1;
+            }
+
+            Assert::AreEqual(output.size(), start);
+        }
+
+        ///
+        /// Check that the stream of a Process source is written in the XML
+        /// output format, with the members of a JSON line as elements.
+        ///
+        TEST_METHOD(TestProcessSourceXml)
+        {
+            const std::wstring path = m_directory + L"\\output.log";
+            LogWriter writer;
+            HANDLE readPipe;
+            HANDLE writePipe;
+
+            StartWriter(writer, path);
+            CreateRelayPipe(readPipe, writePipe);
+
+            ProcessOutputRelay relay(readPipe, writer.RegisterSource(L"Process stderr", OverflowPolicy::Block, 1), writer);
+
+            relay.SetProcessSource("stderr", true);
+
+            Assert::AreEqual(static_cast<DWORD>(ERROR_SUCCESS), relay.Start());
+
+            WritePipe(writePipe, "{\"msg\":\"two\\nlines \\u00e9\",\"ctx\":{\"id\":7}}\nplain\n");
+
+            CloseHandle(writePipe);
+
+            Assert::IsTrue(relay.WaitForEnd(5000));
+
+            relay.Stop();
+            writer.Stop();
+
+            const std::string output = ReadFileContent(path);
+            const std::string prefix = "<Source>Process</Source><Time>";
+            const char* expectedEnds[] = {
+                "</Time><LogEntry><Stream>stderr</Stream><msg>two lines \xc3\xa9</msg><ctx>{\"id\":7}</ctx></LogEntry>",
+                "</Time><LogEntry><Stream>stderr</Stream><Logline>plain</Logline></LogEntry>",
+            };
+            size_t start = 0;
+
+            for (const char* expectedEnd : expectedEnds)
+            {
+                const size_t end = output.find('\n', start);
+
+                Assert::AreNotEqual(std::string::npos, end);
+
+                const std::string line = output.substr(start, end - start);
+                const size_t timeEnd = line.find('<', prefix.size());
+
+                Assert::AreEqual(0, line.compare(0, prefix.size(), prefix));
+                Assert::AreNotEqual(std::string::npos, timeEnd);
+                Assert::AreEqual(expectedEnd, line.substr(timeEnd).c_str());
+
+                start = end + 1;
+            }
+
+            Assert::AreEqual(output.size(), start);
+        }
+
+        ///
+        /// Check that the members of a JSON line whose names aren't valid XML
+        /// names are written as Field elements, with the name escaped in
+        /// their Name attribute.
+        ///
+        TEST_METHOD(TestProcessSourceXmlInvalidNames)
+        {
+            const std::wstring path = m_directory + L"\\output.log";
+            LogWriter writer;
+            HANDLE readPipe;
+            HANDLE writePipe;
+
+            StartWriter(writer, path);
+            CreateRelayPipe(readPipe, writePipe);
+
+            ProcessOutputRelay relay(readPipe, writer.RegisterSource(L"Process stdout", OverflowPolicy::Block, 1), writer);
+
+            relay.SetProcessSource("stdout", true);
+
+            Assert::AreEqual(static_cast<DWORD>(ERROR_SUCCESS), relay.Start());
+
+            WritePipe(writePipe, "{\"\":1,\"a b\":2,\"1x\":3,\"<x\":4,\"a\\\"&\":5,\"x-1.y_z\":6}\n");
+
+            CloseHandle(writePipe);
+
+            Assert::IsTrue(relay.WaitForEnd(5000));
+
+            relay.Stop();
+            writer.Stop();
+
+            const std::string output = ReadFileContent(path);
+            const std::string expectedEnd =
+                "<LogEntry><Stream>stdout</Stream>"
+                "<Field Name=\"\">1</Field>"
+                "<Field Name=\"a b\">2</Field>"
+                "<Field Name=\"1x\">3</Field>"
+                "<Field Name=\"&lt;x\">4</Field>"
+                "<Field Name=\"a&quot;&amp;\">5</Field>"
+                "<x-1.y_z>6</x-1.y_z>"
+                "</LogEntry>\n";
+
+            Assert::IsTrue(output.size() > expectedEnd.size());
+            Assert::AreEqual(expectedEnd.c_str(), output.substr(output.size() - expectedEnd.size()).c_str());
+        }
+
+        ///
+        /// Report the throughput of the relay, with a child process that
+        /// writes a file of IIS-like lines to its stdout at full speed.
+        ///
+        TEST_METHOD(TestRelayThroughput)
+        {
+            const std::wstring inputPath = m_directory + L"\\input.log";
+            const std::wstring outputPath = m_directory + L"\\output.log";
+            const size_t lineCount = 500000;
+            std::string lines;
+
+            for (size_t i = 0; i < lineCount; i++)
+            {
+                lines += "2024-05-14 10:11:12 172.17.0.2 GET /api/orders/" + std::to_string(i)
+                    + " - 80 - 172.17.0.1 Mozilla/5.0+(Windows+NT+10.0;+Win64;+x64) - 200 0 0 31\r\n";
+            }
+
+            {
+                std::ofstream input(inputPath, std::ios::binary);
+
+                input.write(lines.data(), lines.size());
+            }
+
+            LogWriter writer;
+            HANDLE readPipe;
+            HANDLE writePipe;
+
+            StartWriter(writer, outputPath);
+            CreateRelayPipe(readPipe, writePipe);
+
+            ProcessOutputRelay relay(readPipe, writer.RegisterSource(L"Process stdout", OverflowPolicy::Block, 1), writer);
+
+            Assert::AreEqual(static_cast<DWORD>(ERROR_SUCCESS), relay.Start());
+
+            std::wstring commandLine = L"cmd.exe /c type \"" + inputPath + L"\"";
+            STARTUPINFOW startupInfo{};
+            PROCESS_INFORMATION processInfo{};
+
+            startupInfo.cb = sizeof(startupInfo);
+            startupInfo.hStdOutput = writePipe;
+            startupInfo.hStdError = writePipe;
+            startupInfo.hStdInput = GetStdHandle(STD_INPUT_HANDLE);
+            startupInfo.dwFlags = STARTF_USESTDHANDLES;
+
+            LARGE_INTEGER frequency;
+            LARGE_INTEGER start;
+            LARGE_INTEGER end;
+
+            QueryPerformanceFrequency(&frequency);
+            QueryPerformanceCounter(&start);
+
+            Assert::IsTrue(CreateProcessW(
+                NULL,
+                &commandLine[0],
+                NULL,
+                NULL,
+                TRUE,
+                CREATE_NO_WINDOW,
+                NULL,
+                NULL,
+                &startupInfo,
+                &processInfo) != FALSE);
+
+            CloseHandle(writePipe);
+
+            Assert::IsTrue(relay.WaitForEnd(60000));
+
+            writer.Flush();
+
+            QueryPerformanceCounter(&end);
+
+            WaitForSingleObject(processInfo.hProcess, INFINITE);
+            CloseHandle(processInfo.hProcess);
+            CloseHandle(processInfo.hThread);
+
+            relay.Stop();
+            writer.Stop();
+
+            const ProcessOutputRelay::Statistics statistics = relay.GetStatistics();
+            const double seconds = (std::max)(end.QuadPart - start.QuadPart, 1LL) / static_cast<double>(frequency.QuadPart);
+
+            Logger::WriteMessage(
+                FORMAT_STRING(
+                    L"Process output relay: %.1f MB, %llu lines in %llu reads, %.0f MB/s, %.0f lines/s\n",
+                    statistics.Bytes / (1024.0 * 1024.0),
+                    statistics.Lines,
+                    statistics.Reads,
+                    statistics.Bytes / (1024.0 * 1024.0) / seconds,
+                    statistics.Lines / seconds
+                ).c_str()
+            );
+
+            Assert::AreEqual(static_cast<UINT64>(lineCount), statistics.Lines);
+            Assert::AreEqual(static_cast<UINT64>(lines.size()), statistics.Bytes);
+            Assert::AreEqual(lines.size() - lineCount, ReadFileContent(outputPath).size());
+        }
+    };
+}
@@ -0,0 +1,305 @@
+﻿//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+
+#include "pch.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace LogMonitorTests
+{
+    ///
+    /// Tests of the RotatingFileSink class.
+    ///
+    TEST_CLASS(RotatingFileSinkTests)
+    {
+        std::wstring m_directory;
+
+        static std::string ReadFileContent(
+            _In_ const std::wstring& Path
+            )
+        {
+            std::ifstream file(Path, std::ios::binary);
+
+            return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        }
+
+        static void WriteString(
+            _Inout_ RotatingFileSink& Sink,
+            _In_ const std::string& Lines
+            )
+        {
+            Assert::AreEqual(static_cast<DWORD>(ERROR_SUCCESS), Sink.Write(Lines.data(), Lines.size()));
+        }
+
+    public:
+
+        TEST_METHOD_INITIALIZE(InitializeRotatingFileSinkTest)
+        {
+            m_directory = CreateTempDirectory();
+            Assert::IsFalse(m_directory.empty());
+        }
+
+        TEST_METHOD_CLEANUP(CleanupRotatingFileSinkTest)
+        {
+            WIN32_FIND_DATAW findData;
+            HANDLE find = FindFirstFileW((m_directory + L"\\*").c_str(), &findData);
+
+            if (find != INVALID_HANDLE_VALUE)
+            {
+                do
+                {
+                    DeleteFileW((m_directory + L"\\" + findData.cFileName).c_str());
+                } while (FindNextFileW(find, &findData));
+
+                FindClose(find);
+            }
+
+            RemoveDirectoryW(m_directory.c_str());
+        }
+
+        ///
+        /// Check that the batches are appended to an existing file, and that
+        /// the file is rotated before a batch would exceed the max size.
+        ///
+        TEST_METHOD(TestRotateBySize)
+        {
+            const std::wstring path = m_directory + L"\\output.log";
+
+            {
+                RotatingFileSink sink(path, 32, 0, 3);
+
+                Assert::AreEqual(static_cast<DWORD>(ERROR_SUCCESS), sink.Open());
+                WriteString(sink, "line 1\nline 2\n");
+            }
+
+            RotatingFileSink sink(path, 32, 0, 3);
+
+            Assert::AreEqual(static_cast<DWORD>(ERROR_SUCCESS), sink.Open());
+            Assert::AreEqual(14ULL, sink.GetFileSize());
+
+            WriteString(sink, "line 3\n");
+            WriteString(sink, "line 4\nline 5\n");
+
+            Assert::AreEqual(1ULL, sink.GetRotations());
+
+            //
+            // A batch larger than the max size is written to its own file.
+            //
+            WriteString(sink, "a batch larger than the max file size\n");
+
+            sink.Close();
+
+            Assert::AreEqual(2ULL, sink.GetRotations());
+            Assert::AreEqual("line 1\nline 2\nline 3\n", ReadFileContent(path + L".2").c_str());
+            Assert::AreEqual("line 4\nline 5\n", ReadFileContent(path + L".1").c_str());
+            Assert::AreEqual("a batch larger than the max file size\n", ReadFileContent(path).c_str());
+        }
+
+        ///
+        /// Check that only the retained files count is kept.
+        ///
+        TEST_METHOD(TestRetainedFiles)
+        {
+            const std::wstring path = m_directory + L"\\output.log";
+            RotatingFileSink sink(path, 8, 0, 2);
+
+            for (int i = 0; i < 5; i++)
+            {
+                WriteString(sink, "line " + std::to_string(i) + "\n");
+            }
+
+            sink.Close();
+
+            Assert::AreEqual(4ULL, sink.GetRotations());
+            Assert::AreEqual("line 4\n", ReadFileContent(path).c_str());
+            Assert::AreEqual("line 3\n", ReadFileContent(path + L".1").c_str());
+            Assert::AreEqual("line 2\n", ReadFileContent(path + L".2").c_str());
+            Assert::IsFalse(PathFileExistsW((path + L".3").c_str()));
+        }
+
+        ///
+        /// Check that the file is rotated once it's older than the rotation
+        /// interval.
+        ///
+        TEST_METHOD(TestRotateByAge)
+        {
+            const std::wstring path = m_directory + L"\\output.log";
+            RotatingFileSink sink(path, 0, 1, 1);
+
+            WriteString(sink, "line 1\n");
+            WriteString(sink, "line 2\n");
+
+            Assert::AreEqual(0ULL, sink.GetRotations());
+
+            Sleep(1100);
+
+            WriteString(sink, "line 3\n");
+
+            sink.Close();
+
+            Assert::AreEqual(1ULL, sink.GetRotations());
+            Assert::AreEqual("line 1\nline 2\n", ReadFileContent(path + L".1").c_str());
+            Assert::AreEqual("line 3\n", ReadFileContent(path).c_str());
+        }
+
+        ///
+        /// Check that the age of an existing file counts from its creation
+        /// time, and not from the time it's reopened.
+        ///
+        TEST_METHOD(TestRotateByAgeOfExistingFile)
+        {
+            const std::wstring path = m_directory + L"\\output.log";
+
+            {
+                RotatingFileSink sink(path, 0, 3600, 1);
+
+                WriteString(sink, "line 1\n");
+            }
+
+            //
+            // The file was created two hours ago.
+            //
+            HANDLE file = CreateFileW(path.c_str(), FILE_WRITE_ATTRIBUTES, FILE_SHARE_READ, NULL, OPEN_EXISTING, 0, NULL);
+            FILETIME now{};
+            ULARGE_INTEGER created{};
+
+            Assert::IsTrue(file != INVALID_HANDLE_VALUE);
+
+            GetSystemTimeAsFileTime(&now);
+            created.LowPart = now.dwLowDateTime;
+            created.HighPart = now.dwHighDateTime;
+            created.QuadPart -= 2ULL * 3600 * 1000 * 10000;
+
+            FILETIME creationTime{ created.LowPart, created.HighPart };
+
+            Assert::IsTrue(SetFileTime(file, &creationTime, NULL, NULL) != FALSE);
+            CloseHandle(file);
+
+            RotatingFileSink sink(path, 0, 3600, 1);
+
+            Assert::AreEqual(static_cast<DWORD>(ERROR_SUCCESS), sink.Open());
+
+            WriteString(sink, "line 2\n");
+            WriteString(sink, "line 3\n");
+
+            sink.Close();
+
+            Assert::AreEqual(1ULL, sink.GetRotations());
+            Assert::AreEqual("line 1\n", ReadFileContent(path + L".1").c_str());
+            Assert::AreEqual("line 2\nline 3\n", ReadFileContent(path).c_str());
+        }
+
+        ///
+        /// Check that a file created again at the path of a renamed file
+        /// doesn't get its creation time, by the tunneling of the file
+        /// system, and isn't rotated when it's reopened.
+        ///
+        TEST_METHOD(TestRotateByAgeOfRecreatedFile)
+        {
+            const std::wstring path = m_directory + L"\\output.log";
+
+            {
+                RotatingFileSink sink(path, 0, 3600, 1);
+
+                WriteString(sink, "old line\n");
+            }
+
+            //
+            // The file was created two hours ago, and it's renamed.
+            //
+            HANDLE file = CreateFileW(path.c_str(), FILE_WRITE_ATTRIBUTES, FILE_SHARE_READ, NULL, OPEN_EXISTING, 0, NULL);
+            FILETIME now{};
+            ULARGE_INTEGER created{};
+
+            Assert::IsTrue(file != INVALID_HANDLE_VALUE);
+
+            GetSystemTimeAsFileTime(&now);
+            created.LowPart = now.dwLowDateTime;
+            created.HighPart = now.dwHighDateTime;
+            created.QuadPart -= 2ULL * 3600 * 1000 * 10000;
+
+            FILETIME creationTime{ created.LowPart, created.HighPart };
+
+            Assert::IsTrue(SetFileTime(file, &creationTime, NULL, NULL) != FALSE);
+            CloseHandle(file);
+
+            Assert::IsTrue(MoveFileExW(path.c_str(), (path + L".old").c_str(), 0) != FALSE);
+
+            {
+                RotatingFileSink sink(path, 0, 3600, 1);
+
+                WriteString(sink, "line 1\n");
+            }
+
+            RotatingFileSink sink(path, 0, 3600, 1);
+
+            Assert::AreEqual(static_cast<DWORD>(ERROR_SUCCESS), sink.Open());
+
+            WriteString(sink, "line 2\n");
+
+            sink.Close();
+
+            Assert::AreEqual(0ULL, sink.GetRotations());
+            Assert::AreEqual("line 1\nline 2\n", ReadFileContent(path).c_str());
+        }
+
+        ///
+        /// Check that the preallocated space doesn't change the size of the
+        /// file, nor the rotation.
+        ///
+        TEST_METHOD(TestPreallocate)
+        {
+            const std::wstring path = m_directory + L"\\output.log";
+            RotatingFileSink sink(path, 64 * 1024, 0, 1, 64 * 1024);
+
+            Assert::AreEqual(static_cast<DWORD>(ERROR_SUCCESS), sink.Open());
+            Assert::AreEqual(0ULL, sink.GetFileSize());
+
+            WriteString(sink, "line 1\n");
+
+            Assert::AreEqual(7ULL, sink.GetFileSize());
+            Assert::AreEqual(0ULL, sink.GetRotations());
+
+            sink.Close();
+
+            Assert::AreEqual("line 1\n", ReadFileContent(path).c_str());
+        }
+
+        ///
+        /// Check that the LogWriter writes its lines to the file sink, and
+        /// not to stdout when disabled.
+        ///
+        TEST_METHOD(TestLogWriterFileSink)
+        {
+            const std::wstring path = m_directory + L"\\output.log";
+
+            {
+                LogWriter writer;
+
+                writer.SetFileSink(std::make_unique<RotatingFileSink>(path), false);
+
+                writer.WriteConsoleLog(std::string("synchronous line"));
+
+                Assert::IsTrue(writer.Start(0));
+
+                for (int i = 0; i < 100; i++)
+                {
+                    writer.WriteConsoleLog("line " + std::to_string(i));
+                }
+
+                writer.Stop();
+            }
+
+            std::string expected = "synchronous line\n";
+
+            for (int i = 0; i < 100; i++)
+            {
+                expected += "line " + std::to_string(i) + "\n";
+            }
+
+            Assert::AreEqual(expected.c_str(), ReadFileContent(path).c_str());
+        }
+    };
+}
@@ -0,0 +1,210 @@
+﻿//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+
+#include "pch.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace LogMonitorTests
+{
+    ///
+    /// Tests of the TimestampFormatter class.
+    ///
+    TEST_CLASS(TimestampFormatterTests)
+    {
+        static std::string FormatTicks(
+            _Inout_ TimestampFormatter& Timestamps,
+            _In_ UINT64 Ticks
+            )
+        {
+            char timestamp[TimestampFormatter::MAX_LENGTH];
+            const size_t length = Timestamps.Format(Ticks, timestamp);
+
+            return std::string(timestamp, length);
+        }
+
+        static UINT64 MakeTicks(
+            _In_ WORD Year,
+            _In_ WORD Month,
+            _In_ WORD Day,
+            _In_ WORD Hour,
+            _In_ WORD Minute,
+            _In_ WORD Second
+            )
+        {
+            SYSTEMTIME st{};
+            FILETIME ft{};
+
+            st.wYear = Year;
+            st.wMonth = Month;
+            st.wDay = Day;
+            st.wHour = Hour;
+            st.wMinute = Minute;
+            st.wSecond = Second;
+
+            SystemTimeToFileTime(&st, &ft);
+
+            return TimestampFormatter::ToTicks(ft);
+        }
+
+    public:
+
+        ///
+        /// Check the fraction of a second written with each precision.
+        ///
+        TEST_METHOD(TestPrecision)
+        {
+            const UINT64 ticks = MakeTicks(2024, 1, 2, 3, 4, 5) + 678912;
+
+            TimestampFormatter milliseconds(TimestampPrecision::Milliseconds);
+            TimestampFormatter microseconds(TimestampPrecision::Microseconds);
+            TimestampFormatter hundredNanoseconds(TimestampPrecision::HundredNanoseconds);
+
+            Assert::AreEqual("2024-01-02T03:04:05.067Z", FormatTicks(milliseconds, ticks).c_str());
+            Assert::AreEqual("2024-01-02T03:04:05.067891Z", FormatTicks(microseconds, ticks).c_str());
+            Assert::AreEqual("2024-01-02T03:04:05.0678912Z", FormatTicks(hundredNanoseconds, ticks).c_str());
+        }
+
+        ///
+        /// Check the dates around leap days and the limits of the supported
+        /// range, and that the cached prefix is updated when the second and
+        /// the day change.
+        ///
+        TEST_METHOD(TestDates)
+        {
+            TimestampFormatter formatter;
+
+            Assert::AreEqual("1601-01-01T00:00:00.000Z", FormatTicks(formatter, 0).c_str());
+            Assert::AreEqual("1900-02-28T23:59:59.000Z", FormatTicks(formatter, MakeTicks(1900, 2, 28, 23, 59, 59)).c_str());
+            Assert::AreEqual("1900-03-01T00:00:00.000Z", FormatTicks(formatter, MakeTicks(1900, 2, 28, 23, 59, 59) + TimestampFormatter::TICKS_PER_SECOND).c_str());
+            Assert::AreEqual("2000-02-29T23:59:59.999Z", FormatTicks(formatter, MakeTicks(2000, 2, 29, 23, 59, 59) + 9999999).c_str());
+            Assert::AreEqual("2000-03-01T00:00:00.000Z", FormatTicks(formatter, MakeTicks(2000, 3, 1, 0, 0, 0)).c_str());
+            Assert::AreEqual("2000-03-01T00:00:00.500Z", FormatTicks(formatter, MakeTicks(2000, 3, 1, 0, 0, 0) + 5000000).c_str());
+            Assert::AreEqual("9999-12-31T23:59:59.000Z", FormatTicks(formatter, MakeTicks(9999, 12, 31, 23, 59, 59)).c_str());
+        }
+
+        ///
+        /// Compare the timestamps with FileTimeToSystemTime, for times spread
+        /// over several centuries.
+        ///
+        TEST_METHOD(TestMatchesFileTimeToSystemTime)
+        {
+            TimestampFormatter formatter;
+            UINT64 ticks = MakeTicks(1970, 1, 1, 0, 0, 0);
+
+            for (int i = 0; i < 100000; i++)
+            {
+                //
+                // About 25 days and a few milliseconds between two times.
+                //
+                ticks += 21600000000000ULL + 123457;
+
+                FILETIME ft;
+                SYSTEMTIME st;
+
+                ft.dwLowDateTime = static_cast<DWORD>(ticks);
+                ft.dwHighDateTime = static_cast<DWORD>(ticks >> 32);
+                FileTimeToSystemTime(&ft, &st);
+
+                char expected[32];
+                sprintf_s(expected, "%04u-%02u-%02uT%02u:%02u:%02u.%03uZ",
+                    st.wYear, st.wMonth, st.wDay, st.wHour, st.wMinute, st.wSecond, st.wMilliseconds);
+
+                Assert::AreEqual(expected, FormatTicks(formatter, ticks).c_str());
+            }
+        }
+
+        ///
+        /// Check that the formatter of the thread follows the precision of
+        /// the process.
+        ///
+        TEST_METHOD(TestDefaultPrecision)
+        {
+            FILETIME ft{};
+            const UINT64 ticks = MakeTicks(2024, 1, 2, 3, 4, 5) + 678912;
+
+            ft.dwLowDateTime = static_cast<DWORD>(ticks);
+            ft.dwHighDateTime = static_cast<DWORD>(ticks >> 32);
+
+            Assert::AreEqual(L"2024-01-02T03:04:05.067Z", Utility::FileTimeToString(ft).c_str());
+
+            TimestampFormatter::SetDefaultPrecision(TimestampPrecision::Microseconds);
+
+            const std::wstring microseconds = Utility::FileTimeToString(ft);
+
+            TimestampFormatter::SetDefaultPrecision(TimestampPrecision::Milliseconds);
+
+            Assert::AreEqual(L"2024-01-02T03:04:05.067891Z", microseconds.c_str());
+        }
+
+        ///
+        /// Compare the cost of the previous locale-aware formatting with the
+        /// cached formatter, for timestamps a few microseconds apart.
+        ///
+        TEST_METHOD(TestFormatThroughput)
+        {
+            const int timestamps = 1000000;
+            const UINT64 firstTicks = MakeTicks(2024, 1, 2, 3, 4, 5);
+
+            LARGE_INTEGER frequency;
+            LARGE_INTEGER start;
+            LARGE_INTEGER end;
+
+            QueryPerformanceFrequency(&frequency);
+
+            size_t localeLength = 0;
+
+            QueryPerformanceCounter(&start);
+
+            for (int i = 0; i < timestamps / 10; i++)
+            {
+                const UINT64 ticks = firstTicks + i * 50ULL;
+                FILETIME ft;
+                SYSTEMTIME st;
+                wchar_t dateStr[64];
+                wchar_t timeStr[64];
+
+                ft.dwLowDateTime = static_cast<DWORD>(ticks);
+                ft.dwHighDateTime = static_cast<DWORD>(ticks >> 32);
+                FileTimeToSystemTime(&ft, &st);
+
+                GetDateFormatEx(0, 0, &st, L"yyyy-MM-dd", dateStr, _countof(dateStr), 0);
+                GetTimeFormatEx(0, 0, &st, L"HH:mm:ss", timeStr, _countof(timeStr));
+
+                localeLength += FORMAT_STRING(L"%sT%s.000Z", dateStr, timeStr).size();
+            }
+
+            QueryPerformanceCounter(&end);
+
+            const double localeSeconds =
+                static_cast<double>(end.QuadPart - start.QuadPart) / frequency.QuadPart * 10;
+
+            TimestampFormatter formatter;
+            size_t cachedLength = 0;
+            char timestamp[TimestampFormatter::MAX_LENGTH];
+
+            QueryPerformanceCounter(&start);
+
+            for (int i = 0; i < timestamps; i++)
+            {
+                cachedLength += formatter.Format(firstTicks + i * 50ULL, timestamp);
+            }
+
+            QueryPerformanceCounter(&end);
+
+            const double cachedSeconds = static_cast<double>(end.QuadPart - start.QuadPart) / frequency.QuadPart;
+
+            Assert::AreEqual(localeLength * 10, cachedLength);
+
+            Logger::WriteMessage(
+                FORMAT_STRING(
+                    L"GetDateFormatEx: %.0f timestamps/s. TimestampFormatter: %.0f timestamps/s\n",
+                    timestamps / localeSeconds,
+                    timestamps / cachedSeconds
+                ).c_str()
+            );
+        }
+    };
+}
@@ -0,0 +1,155 @@
+﻿//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+
+#include "pch.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace LogMonitorTests
+{
+    ///
+    /// Tests of the TokenBucket class, used for the rate limits of the
+    /// sources.
+    ///
+    TEST_CLASS(TokenBucketTests)
+    {
+        static INT64 GetFrequency()
+        {
+            LARGE_INTEGER frequency;
+            QueryPerformanceFrequency(&frequency);
+
+            return frequency.QuadPart;
+        }
+
+    public:
+
+        ///
+        /// Check that a bucket allows its burst at once, then its rate.
+        ///
+        TEST_METHOD(TestBurstAndRefill)
+        {
+            const INT64 frequency = GetFrequency();
+            const INT64 start = 1000 * frequency;
+            TokenBucket bucket;
+
+            bucket.Configure(10, 5);
+
+            Assert::IsTrue(bucket.IsEnabled());
+            Assert::AreEqual(10UL, bucket.GetRecordsPerSecond());
+
+            for (int i = 0; i < 5; i++)
+            {
+                Assert::IsTrue(bucket.TryTake(start));
+            }
+
+            Assert::IsFalse(bucket.TryTake(start));
+
+            //
+            // A tenth of a second later, one token was added.
+            //
+            Assert::IsTrue(bucket.TryTake(start + frequency / 10));
+            Assert::IsFalse(bucket.TryTake(start + frequency / 10));
+
+            //
+            // After a long pause, the bucket is full, but not more.
+            //
+            const INT64 later = start + 60 * frequency;
+            int taken = 0;
+
+            while (bucket.TryTake(later))
+            {
+                taken++;
+            }
+
+            Assert::AreEqual(5, taken);
+        }
+
+        ///
+        /// Check that a burst of 0 is one second of lines, and that a bucket
+        /// without rate never suppresses.
+        ///
+        TEST_METHOD(TestDefaults)
+        {
+            const INT64 start = 1000 * GetFrequency();
+            TokenBucket bucket;
+            int taken = 0;
+
+            Assert::IsFalse(bucket.IsEnabled());
+            Assert::IsTrue(bucket.TryTake());
+
+            bucket.Configure(20, 0);
+
+            while (bucket.TryTake(start))
+            {
+                taken++;
+            }
+
+            Assert::AreEqual(20, taken);
+
+            bucket.Configure(0, 0);
+
+            Assert::IsFalse(bucket.IsEnabled());
+            Assert::IsTrue(bucket.TryTake(start));
+        }
+
+        ///
+        /// Check that concurrent threads never take more tokens than the
+        /// bucket holds, and report the cost of TryTake.
+        ///
+        TEST_METHOD(TestConcurrentTakes)
+        {
+            const DWORD burst = 10000;
+            const int threadCount = 8;
+            const int attempts = 100000;
+            TokenBucket bucket;
+            std::atomic<int> taken{ 0 };
+            std::vector<std::thread> threads;
+
+            //
+            // One token per second, so the refill is negligible.
+            //
+            bucket.Configure(1, burst);
+
+            LARGE_INTEGER start;
+            LARGE_INTEGER end;
+
+            QueryPerformanceCounter(&start);
+
+            for (int i = 0; i < threadCount; i++)
+            {
+                threads.emplace_back([&]()
+                {
+                    for (int j = 0; j < attempts; j++)
+                    {
+                        if (bucket.TryTake())
+                        {
+                            taken++;
+                        }
+                    }
+                });
+            }
+
+            for (std::thread& thread : threads)
+            {
+                thread.join();
+            }
+
+            QueryPerformanceCounter(&end);
+
+            const double seconds = static_cast<double>(end.QuadPart - start.QuadPart) / GetFrequency();
+
+            Logger::WriteMessage(
+                FORMAT_STRING(
+                    L"TokenBucket: %d threads, %d takes in %.3f s",
+                    threadCount,
+                    threadCount * attempts,
+                    seconds
+                ).c_str());
+
+            Assert::IsTrue(taken.load() >= static_cast<int>(burst));
+            Assert::IsTrue(taken.load() <= static_cast<int>(burst) + 1 + static_cast<int>(seconds));
+        }
+    };
+}
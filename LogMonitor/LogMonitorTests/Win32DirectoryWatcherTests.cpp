@@ -0,0 +1,186 @@
+﻿//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+
+#include "pch.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace LogMonitorTests
+{
+    ///
+    /// Tests the ReadDirectoryChangesW backend of the directory watcher.
+    ///
+    TEST_CLASS(Win32DirectoryWatcherTests)
+    {
+        static void AppendNotification(
+            _Inout_ std::vector<BYTE>& Buffer,
+            _In_ DWORD Action,
+            _In_ const std::wstring& FileName
+            )
+        {
+            const size_t headerSize = offsetof(FILE_NOTIFY_INFORMATION, FileName);
+            const size_t entrySize = (headerSize + FileName.size() * sizeof(WCHAR) + sizeof(DWORD) - 1)
+                                   & ~(sizeof(DWORD) - 1);
+            const size_t offset = Buffer.size();
+
+            Buffer.resize(offset + entrySize);
+
+            FILE_NOTIFY_INFORMATION* entry = reinterpret_cast<FILE_NOTIFY_INFORMATION*>(Buffer.data() + offset);
+
+            entry->NextEntryOffset = 0;
+            entry->Action = Action;
+            entry->FileNameLength = static_cast<DWORD>(FileName.size() * sizeof(WCHAR));
+            memcpy(entry->FileName, FileName.data(), FileName.size() * sizeof(WCHAR));
+        }
+
+        static void LinkNotifications(
+            _Inout_ std::vector<BYTE>& Buffer,
+            _In_ const std::vector<size_t>& Offsets
+            )
+        {
+            for (size_t i = 0; i + 1 < Offsets.size(); i++)
+            {
+                reinterpret_cast<FILE_NOTIFY_INFORMATION*>(Buffer.data() + Offsets[i])->NextEntryOffset =
+                    static_cast<DWORD>(Offsets[i + 1] - Offsets[i]);
+            }
+        }
+
+    public:
+
+        ///
+        /// Check the conversion of the notification records to events.
+        ///
+        TEST_METHOD(TestParseNotifications)
+        {
+            std::vector<BYTE> buffer;
+            std::vector<size_t> offsets;
+
+            const DWORD actions[] = {
+                FILE_ACTION_ADDED,
+                FILE_ACTION_MODIFIED,
+                0x100,
+                FILE_ACTION_RENAMED_OLD_NAME,
+                FILE_ACTION_RENAMED_NEW_NAME,
+                FILE_ACTION_REMOVED
+            };
+            const std::wstring names[] = { L"a.log", L"sub\\a.log", L"unknown", L"b.log", L"c.log", L"c.log" };
+
+            for (size_t i = 0; i < _countof(actions); i++)
+            {
+                offsets.push_back(buffer.size());
+                AppendNotification(buffer, actions[i], names[i]);
+            }
+
+            LinkNotifications(buffer, offsets);
+
+            std::vector<DirChangeNotificationEvent> events;
+            Win32DirectoryWatcher::ParseNotifications(buffer.data(), static_cast<DWORD>(buffer.size()), 42, events);
+
+            const EventAction expected[] = {
+                EventAction::Add,
+                EventAction::Modify,
+                EventAction::RenameOld,
+                EventAction::RenameNew,
+                EventAction::Remove
+            };
+            const std::wstring expectedNames[] = { L"a.log", L"sub\\a.log", L"b.log", L"c.log", L"c.log" };
+
+            Assert::AreEqual(_countof(expected), events.size());
+
+            for (size_t i = 0; i < events.size(); i++)
+            {
+                Assert::AreEqual(static_cast<int>(expected[i]), static_cast<int>(events[i].Action));
+                Assert::AreEqual(expectedNames[i].c_str(), events[i].FileName.c_str());
+                Assert::AreEqual(static_cast<UINT64>(42), events[i].Timestamp);
+            }
+        }
+
+        ///
+        /// Check that an empty result, returned when the system buffer
+        /// overflowed, is a ReInit event, and that a record going past the
+        /// end of the buffer is ignored.
+        ///
+        TEST_METHOD(TestParseOverflowAndTruncatedNotifications)
+        {
+            std::vector<DirChangeNotificationEvent> events;
+
+            Win32DirectoryWatcher::ParseNotifications(nullptr, 0, 1, events);
+
+            Assert::AreEqual(static_cast<size_t>(1), events.size());
+            Assert::AreEqual(static_cast<int>(EventAction::ReInit), static_cast<int>(events[0].Action));
+
+            std::vector<BYTE> buffer;
+            AppendNotification(buffer, FILE_ACTION_ADDED, L"a.log");
+            reinterpret_cast<FILE_NOTIFY_INFORMATION*>(buffer.data())->NextEntryOffset = 4096;
+
+            events.clear();
+            Win32DirectoryWatcher::ParseNotifications(buffer.data(), static_cast<DWORD>(buffer.size()), 1, events);
+
+            Assert::AreEqual(static_cast<size_t>(1), events.size());
+            Assert::AreEqual(L"a.log", events[0].FileName.c_str());
+        }
+
+        ///
+        /// Check that the creation of a file in a watched directory is
+        /// reported.
+        ///
+        TEST_METHOD(TestWatchDirectory)
+        {
+            WCHAR tempDirectory[MAX_PATH + 1] = { 0 };
+            Assert::AreNotEqual(0UL, GetTempPathW(MAX_PATH + 1, tempDirectory));
+
+            const std::wstring directory = std::wstring(tempDirectory)
+                + L"LogMonitorWatcherTest" + std::to_wstring(GetCurrentProcessId());
+            const std::wstring filePath = directory + L"\\watched.log";
+
+            CreateDirectoryW(directory.c_str(), nullptr);
+            DeleteFileW(filePath.c_str());
+
+            HANDLE directoryHandle = CreateFileW(directory.c_str(),
+                                                 FILE_LIST_DIRECTORY,
+                                                 FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                                                 nullptr,
+                                                 OPEN_EXISTING,
+                                                 FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED,
+                                                 nullptr);
+            Assert::IsTrue(directoryHandle != INVALID_HANDLE_VALUE);
+
+            {
+                Win32DirectoryWatcher watcher(directoryHandle, false);
+                Assert::AreEqual(static_cast<DWORD>(ERROR_SUCCESS), watcher.Start());
+
+                HANDLE file = CreateFileW(filePath.c_str(),
+                                          GENERIC_WRITE,
+                                          FILE_SHARE_READ,
+                                          nullptr,
+                                          CREATE_ALWAYS,
+                                          FILE_ATTRIBUTE_NORMAL,
+                                          nullptr);
+                Assert::IsTrue(file != INVALID_HANDLE_VALUE);
+                CloseHandle(file);
+
+                bool added = false;
+                std::vector<DirChangeNotificationEvent> events;
+
+                while (!added && WaitForSingleObject(watcher.GetWaitObject(), 10000) == WAIT_OBJECT_0)
+                {
+                    Assert::AreEqual(static_cast<DWORD>(ERROR_SUCCESS), watcher.ReadEvents(events));
+
+                    for (const auto& event : events)
+                    {
+                        added = added || (event.Action == EventAction::Add && event.FileName == L"watched.log");
+                    }
+
+                    events.clear();
+                }
+
+                Assert::IsTrue(added);
+            }
+
+            DeleteFileW(filePath.c_str());
+            RemoveDirectoryW(directory.c_str());
+        }
+    };
+}
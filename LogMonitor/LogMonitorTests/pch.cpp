@@ -1,10 +1,10 @@
-//
-// Copyright (c) Microsoft Corporation.
-// Licensed under the MIT license.
-//
-
-// pch.cpp: source file corresponding to the pre-compiled header
-
-#include "pch.h"
-
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+
+// pch.cpp: source file corresponding to the pre-compiled header
+
+#include "pch.h"
+
 // When you are using pre-compiled headers, this source file is necessary for compilation to succeed.
\ No newline at end of file
@@ -1,66 +1,96 @@
-//
-// Copyright (c) Microsoft Corporation.
-// Licensed under the MIT license.
-//
-
-// pch.h: This is a precompiled header file.
-// Files listed below are compiled only once, improving build performance for future builds.
-// This also affects IntelliSense performance, including code completion and many code browsing features.
-// However, files listed here are ALL re-compiled if any one of them is updated between builds.
-// Do not add files here that you will be updating frequently as this negates the performance advantage.
-
-#ifndef PCH_H
-#define PCH_H
-
-// add headers that you want to pre-compile here
-
-#include "CppUnitTest.h"
-#include <functional>
-#include <conio.h>
-#include <stdio.h>
-#include <array>
-#include <memory>
-#include <variant>
-#include <cstdint>
-#include <string>
-#include <algorithm>
-#include <sstream>
-#include <vector>
-#include <queue>
-#include <map>
-#include <regex>
-#include <stdexcept>
-#include <Windows.h>
-#include <cctype>
-#include <sal.h>
-#include <winevt.h>
-#include <wbemidl.h>
-#include <wmistr.h>
-#include <evntrace.h>
-#include <tdh.h>
-#include <in6addr.h>
-#include <winsock.h>
-#include <time.h>
-#include <iostream>
-#include <tchar.h>
-#include <strsafe.h>
-#include <fstream>
-#include <streambuf>
-#include <system_error>
-#include <codecvt>
-#include "shlwapi.h"
-#include <direct.h >
-#include <io.h> 
-#include <fcntl.h> 
-#include "../src/LogMonitor/Utility.h"
-#include "../src/LogMonitor/Parser/ConfigFileParser.h"
-#include "../src/LogMonitor/Parser/LoggerSettings.h"
-#include "../src/LogMonitor/Parser/JsonFileParser.h"
-#include "../src/LogMonitor/LogWriter.h"
-#include "../src/LogMonitor/EtwMonitor.h"
-#include "../src/LogMonitor/EventMonitor.h"
-#include "../src/LogMonitor/FileMonitor/Utilities.h"
-#include "../src/LogMonitor/LogFileMonitor.h"
-#include "../src/LogMonitor/ProcessMonitor.h"
-#include "Utility.h"
-#endif //PCH_H
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+
+// pch.h: This is a precompiled header file.
+// Files listed below are compiled only once, improving build performance for future builds.
+// This also affects IntelliSense performance, including code completion and many code browsing features.
+// However, files listed here are ALL re-compiled if any one of them is updated between builds.
+// Do not add files here that you will be updating frequently as this negates the performance advantage.
+
+#ifndef PCH_H
+#define PCH_H
+
+// add headers that you want to pre-compile here
+
+#include "CppUnitTest.h"
+#include <functional>
+#include <conio.h>
+#include <stdio.h>
+#include <array>
+#include <memory>
+#include <variant>
+#include <cstdint>
+#include <string>
+#include <algorithm>
+#include <sstream>
+#include <vector>
+#include <queue>
+#include <map>
+#include <list>
+#include <unordered_map>
+#include <regex>
+#include <stdexcept>
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <Windows.h>
+#include <cctype>
+#include <sal.h>
+#include <winevt.h>
+#include <wbemidl.h>
+#include <wmistr.h>
+#include <evntrace.h>
+#include <tdh.h>
+#include <in6addr.h>
+#include <time.h>
+#include <iostream>
+#include <thread>
+#include <tchar.h>
+#include <strsafe.h>
+#include <fstream>
+#include <streambuf>
+#include <system_error>
+#include <atomic>
+#include <type_traits>
+#include <codecvt>
+#include "shlwapi.h"
+#include <direct.h >
+#include <io.h> 
+#include <fcntl.h> 
+#include "../src/LogMonitor/Output/Formatter.h"
+#include "../src/LogMonitor/Output/TimestampFormatter.h"
+#include "../src/LogMonitor/Output/BlockCodec.h"
+#include "../src/LogMonitor/Output/Lz4BlockCodec.h"
+#include "../src/LogMonitor/Utility.h"
+#include "../src/LogMonitor/LruCache.h"
+#include "../src/LogMonitor/Parser/ConfigFileParser.h"
+#include "../src/LogMonitor/Parser/LoggerSettings.h"
+#include "../src/LogMonitor/Parser/JsonFileParser.h"
+#include "../src/LogMonitor/Parser/JsonLineParser.h"
+#include "../src/LogMonitor/Output/LogRecordRing.h"
+#include "../src/LogMonitor/Output/TokenBucket.h"
+#include "../src/LogMonitor/Output/JsonLineWriter.h"
+#include "../src/LogMonitor/Output/BlockSpool.h"
+#include "../src/LogMonitor/Output/RotatingFileSink.h"
+#include "../src/LogMonitor/Output/DurableQueue.h"
+#include "../src/LogMonitor/Output/NetworkSink.h"
+#include "../src/LogMonitor/LogWriter.h"
+#include "../src/LogMonitor/EtwMonitor.h"
+#include "../src/LogMonitor/EventRenderer.h"
+#include "../src/LogMonitor/EventMonitor.h"
+#include "../src/LogMonitor/FileMonitor/Utilities.h"
+#include "../src/LogMonitor/FileMonitor/CaseFoldedPath.h"
+#include "../src/LogMonitor/FileMonitor/LogLineDecoder.h"
+#include "../src/LogMonitor/FileMonitor/AdaptiveReadBuffer.h"
+#include "../src/LogMonitor/FileMonitor/LogFileCheckpoint.h"
+#include "../src/LogMonitor/FileMonitor/LogReaderPool.h"
+#include "../src/LogMonitor/FileMonitor/DirectoryWatcher.h"
+#include "../src/LogMonitor/FileMonitor/Win32DirectoryWatcher.h"
+#include "../src/LogMonitor/FileMonitor/InotifyEventParser.h"
+#include "../src/LogMonitor/FileMonitor/InotifyDirectoryWatcher.h"
+#include "../src/LogMonitor/FileMonitor/DirChangeEventQueue.h"
+#include "../src/LogMonitor/LogFileMonitor.h"
+#include "../src/LogMonitor/ProcessMonitor.h"
+#include "Utility.h"
+#endif //PCH_H
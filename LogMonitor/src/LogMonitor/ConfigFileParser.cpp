@@ -1,691 +1,1374 @@
-//
-// Copyright (c) Microsoft Corporation.
-// Licensed under the MIT license.
-//
-
-#include "pch.h"
-#include "./Parser/ConfigFileParser.h"
-#include "./LogWriter.h"
-
-/// ConfigFileParser.cpp
-///
-/// Reads the configuration file content (as a string), parsing it with a
-/// JsonFileParser object previously created.
-///
-/// The main entry point in this file is OpenConfigFile.
-///
-
-///
-/// Open the config file and convert the document content into json
-///
-/// \param FileName       Config File name.
-///
-/// \return True if the configuration file was valid. Otherwise false
-///
-bool OpenConfigFile(_In_ const PWCHAR ConfigFileName, _Out_ LoggerSettings& Config)
-{
-    bool success;
-    std::wifstream configFileStream(ConfigFileName);
-    configFileStream.imbue(std::locale(configFileStream.getloc(),
-        new std::codecvt_utf8_utf16<wchar_t, 0x10ffff, std::little_endian>));
-
-    if (configFileStream.is_open())
-    {
-        try
-        {
-            //
-            // Convert the document content to a string, to pass it to JsonFileParser constructor.
-            //
-            std::wstring configFileStr((std::istreambuf_iterator<wchar_t>(configFileStream)),
-                std::istreambuf_iterator<wchar_t>());
-            configFileStr.erase(remove(configFileStr.begin(), configFileStr.end(), 0xFEFF), configFileStr.end());
-
-            JsonFileParser jsonParser(configFileStr);
-
-            success = ReadConfigFile(jsonParser, Config);
-        }
-        catch (std::exception& ex)
-        {
-            logWriter.TraceError(
-                Utility::FormatString(L"Failed to read json configuration file. %S", ex.what()).c_str()
-            );
-            success = false;
-        }
-        catch (...)
-        {
-            logWriter.TraceError(
-                Utility::FormatString(L"Failed to read json configuration file. Unknown error occurred.").c_str()
-            );
-            success = false;
-        }
-    } else {
-        logWriter.TraceError(
-            Utility::FormatString(
-                L"Configuration file '%s' not found. Logs will not be monitored.",
-                ConfigFileName
-            ).c_str()
-        );
-        success = false;
-    }
-
-    return success;
-}
-
-///
-/// Read the root JSON of the config file
-///
-/// \param Parser       A pre-initialized JSON parser.
-/// \param Config       Returns a LoggerSettings struct with the values specified
-///     in the config file.
-///
-/// \return True if the configuration file was valid. Otherwise false
-///
-bool
-ReadConfigFile(
-    _In_ JsonFileParser& Parser,
-    _Out_ LoggerSettings& Config
-    )
-{
-    if (Parser.GetNextDataType() != JsonFileParser::DataType::Object)
-    {
-        logWriter.TraceError(L"Failed to parse configuration file. Object expected at the file's root");
-        return false;
-    }
-
-    bool containsLogConfigTag = false;
-
-    if (Parser.BeginParseObject())
-    {
-        do
-        {
-            const std::wstring key(Parser.GetKey());
-
-            if (_wcsnicmp(key.c_str(), JSON_TAG_LOG_CONFIG, _countof(JSON_TAG_LOG_CONFIG)) == 0)
-            {
-                containsLogConfigTag = ReadLogConfigObject(Parser, Config);
-            }
-            else
-            {
-                Parser.SkipValue();
-            }
-        } while (Parser.ParseNextObjectElement());
-    }
-
-    return containsLogConfigTag;
-}
-
-///
-/// Read LogConfig tag, that contains the config of the sources
-///
-/// \param Parser       A pre-initialized JSON parser.
-/// \param Config       Returns a LoggerSettings struct with the values specified
-///                     in the config file.
-///
-/// \return True if LogConfig tag was valid. Otherwise false
-///
-bool
-ReadLogConfigObject(
-    _In_ JsonFileParser& Parser,
-    _Out_ LoggerSettings& Config
-    )
-{
-    if (Parser.GetNextDataType() != JsonFileParser::DataType::Object)
-    {
-        logWriter.TraceError(L"Failed to parse configuration file. 'LogConfig' is expected to be an object");
-        Parser.SkipValue();
-        return false;
-    }
-
-    bool sourcesTagFound = false;
-    if (Parser.BeginParseObject())
-    {
-        do
-        {
-            const std::wstring key(Parser.GetKey());
-
-            if (_wcsnicmp(key.c_str(), JSON_TAG_SOURCES, _countof(JSON_TAG_SOURCES)) == 0)
-            {
-                if (Parser.GetNextDataType() != JsonFileParser::DataType::Array)
-                {
-                    logWriter.TraceError(L"Failed to parse configuration file. 'sources' attribute expected to be an array");
-                    Parser.SkipValue();
-                    continue;
-                }
-
-                sourcesTagFound = true;
-
-                if (!Parser.BeginParseArray())
-                {
-                    continue;
-                }
-
-                do
-                {
-                    AttributesMap sourceAttributes;
-
-                    //
-                    // Read all attributes of a source from the config file,
-                    // instantiate it and add it to the end of the vector
-                    //
-                    if (ReadSourceAttributes(Parser, sourceAttributes)) {
-                        if (!AddNewSource(Parser, sourceAttributes, Config.Sources))
-                        {
-                            logWriter.TraceWarning(L"Failed to parse configuration file. Error reading invalid source.");
-                        }
-                    }
-                    else
-                    {
-                        logWriter.TraceWarning(L"Failed to parse configuration file. Error retrieving source attributes. Invalid source");
-                    }
-
-                    for (auto attributePair : sourceAttributes)
-                    {
-                        if (attributePair.second != nullptr)
-                        {
-                            delete attributePair.second;
-                        }
-                    }
-                } while (Parser.ParseNextArrayElement());
-            }
-            else
-            {
-                logWriter.TraceWarning(Utility::FormatString(L"Error parsing configuration file. 'Unknow key %ws in the configuration file.", key.c_str()).c_str());
-                Parser.SkipValue();
-            }
-        } while (Parser.ParseNextObjectElement());
-    }
-
-    return sourcesTagFound;
-}
-
-///
-/// Look for all the attributes that a single 'source' object contains
-///
-/// \param Parser       A pre-initialized JSON parser.
-/// \param Config       Returns an AttributesMap, with all allowed tag names and theirs values
-///
-/// \return True if the attributes contained valid values. Otherwise false
-///
-bool
-ReadSourceAttributes(
-    _In_ JsonFileParser& Parser,
-    _Out_ AttributesMap& Attributes
-    )
-{
-    if (Parser.GetNextDataType() != JsonFileParser::DataType::Object)
-    {
-        logWriter.TraceError(L"Failed to parse configuration file. Source item expected to be an object");
-        Parser.SkipValue();
-        return false;
-    }
-
-    bool success = true;
-
-    if (Parser.BeginParseObject())
-    {
-        do
-        {
-            //
-            // If source reading already fail, just skip attributes^M
-            //
-            if (!success)
-            {
-                Parser.SkipValue();
-                continue;
-            }
-
-            const std::wstring key(Parser.GetKey());
-
-            if (_wcsnicmp(key.c_str(), JSON_TAG_TYPE, _countof(JSON_TAG_TYPE)) == 0)
-            {
-                const auto& typeString = Parser.ParseStringValue();
-                LogSourceType* type = nullptr;
-
-                //
-                // Check if the string is the name of a valid LogSourceType
-                //
-                int sourceTypeArraySize = sizeof(LogSourceTypeNames) / sizeof(LogSourceTypeNames[0]);
-                for (int i = 0; i < sourceTypeArraySize; i++)
-                {
-                    if (_wcsnicmp(typeString.c_str(), LogSourceTypeNames[i], typeString.length()) == 0)
-                    {
-                        type = new LogSourceType;
-                        *type = static_cast<LogSourceType>(i);
-                    }
-                }
-
-                //
-                // If the value isn't a valid type, fail.
-                //
-                if (type == nullptr)
-                {
-                    logWriter.TraceError(
-                        Utility::FormatString(
-                            L"Error parsing configuration file. '%s' isn't a valid source type", typeString.c_str()
-                        ).c_str()
-                    );
-
-                    success = false;
-                }
-                else
-                {
-                    Attributes[key] = type;
-                }
-            }
-            else if (_wcsnicmp(key.c_str(), JSON_TAG_CHANNELS, _countof(JSON_TAG_CHANNELS)) == 0)
-            {
-                if (Parser.GetNextDataType() != JsonFileParser::DataType::Array)
-                {
-                    logWriter.TraceError(L"Error parsing configuration file. 'channels' attribute expected to be an array");
-                    Parser.SkipValue();
-                    continue;
-                }
-
-                if (Parser.BeginParseArray())
-                {
-                    std::vector<EventLogChannel>* channels = new std::vector<EventLogChannel>();
-
-                    //
-                    // Get only the valid channels of this JSON object.
-                    //
-                    do
-                    {
-                        channels->emplace_back();
-                        if (!ReadLogChannel(Parser, channels->back()))
-                        {
-                            logWriter.TraceWarning(L"Error parsing configuration file. Discarded invalid channel (it must have a non-empty 'name').");
-                            channels->pop_back();
-                        }
-                    } while (Parser.ParseNextArrayElement());
-
-                    Attributes[key] = channels;
-                }
-            }
-            //
-            // These attributes are string type
-            // * directory
-            // * filter
-            //
-            else if (_wcsnicmp(key.c_str(), JSON_TAG_DIRECTORY, _countof(JSON_TAG_DIRECTORY)) == 0
-                || _wcsnicmp(key.c_str(), JSON_TAG_FILTER, _countof(JSON_TAG_FILTER)) == 0)
-            {
-                Attributes[key] = new std::wstring(Parser.ParseStringValue());
-            }
-            //
-            // These attributes are boolean type
-            // * eventFormatMultiLine
-            // * startAtOldestRecord
-            // * includeSubdirectories
-            // * includeFileNames
-            //
-            else if (
-                _wcsnicmp(
-                    key.c_str(),
-                    JSON_TAG_FORMAT_MULTILINE,
-                    _countof(JSON_TAG_FORMAT_MULTILINE)) == 0
-                || _wcsnicmp(
-                    key.c_str(),
-                    JSON_TAG_START_AT_OLDEST_RECORD,
-                    _countof(JSON_TAG_START_AT_OLDEST_RECORD)) == 0
-                || _wcsnicmp(
-                    key.c_str(),
-                    JSON_TAG_INCLUDE_SUBDIRECTORIES,
-                    _countof(JSON_TAG_INCLUDE_SUBDIRECTORIES)) == 0
-                || _wcsnicmp(
-                    key.c_str(),
-                    JSON_TAG_INCLUDE_FILENAMES,
-                    _countof(JSON_TAG_INCLUDE_FILENAMES)) == 0)
-            {
-                Attributes[key] = new bool{ Parser.ParseBooleanValue() };
-            }
-            else if (_wcsnicmp(key.c_str(), JSON_TAG_PROVIDERS, _countof(JSON_TAG_PROVIDERS)) == 0)
-            {
-                if (Parser.GetNextDataType() != JsonFileParser::DataType::Array)
-                {
-                    logWriter.TraceError(L"Error parsing configuration file. 'providers' attribute expected to be an array");
-                    Parser.SkipValue();
-                    continue;
-                }
-
-                if (Parser.BeginParseArray())
-                {
-                    std::vector<ETWProvider>* providers = new std::vector<ETWProvider>();
-
-                    //
-                    // Get only the valid providers of this JSON object.
-                    //
-                    do
-                    {
-                        providers->emplace_back();
-                        if (!ReadETWProvider(Parser, providers->back()))
-                        {
-                            logWriter.TraceWarning(L"Error parsing configuration file. Discarded invalid provider (it must have a non-empty 'providerName' or 'providerGuid').");
-                            providers->pop_back();
-                        }
-                    } while (Parser.ParseNextArrayElement());
-
-                    Attributes[key] = providers;
-                }
-            }
-            else
-            {
-                //
-                // Discard unwanted attributes
-                //
-                Parser.SkipValue();
-            }
-        } while (Parser.ParseNextObjectElement());
-    }
-
-    return success;
-}
-
-///
-/// Reads a single 'channel' object from the parser, and store it in the Result
-///
-/// \param Parser       A pre-initialized JSON parser.
-/// \param Result       Returns an EventLogChannel struct filled with the values specified in the config file.
-///
-/// \return True if the channel is valid. Otherwise false
-///
-bool
-ReadLogChannel(
-    _In_ JsonFileParser& Parser,
-    _Out_ EventLogChannel& Result
-    )
-{
-    if (Parser.GetNextDataType() != JsonFileParser::DataType::Object)
-    {
-        logWriter.TraceError(L"Error parsing configuration file. Channel item expected to be an object");
-        Parser.SkipValue();
-        return false;
-    }
-
-    if (!Parser.BeginParseObject())
-    {
-        logWriter.TraceError(L"Error parsing configuration file. Error reading channel object");
-        return false;
-    }
-
-    do
-    {
-        const auto& key = Parser.GetKey();
-
-        if (_wcsnicmp(key.c_str(), JSON_TAG_CHANNEL_NAME, _countof(JSON_TAG_CHANNEL_NAME)) == 0)
-        {
-            //
-            // Recover the name of the channel
-            //
-            Result.Name = Parser.ParseStringValue();
-        }
-        else if (_wcsnicmp(key.c_str(), JSON_TAG_CHANNEL_LEVEL, _countof(JSON_TAG_CHANNEL_LEVEL)) == 0)
-        {
-            //
-            // Get the level as a string, and convert it to EventChannelLogLevel.
-            //
-            std::wstring logLevelStr = Parser.ParseStringValue();
-            bool success = Result.SetLevelByString(logLevelStr);
-
-            //
-            // Print an error message the string doesn't matches with a valid log level name.
-            //
-            if (!success)
-            {
-                logWriter.TraceWarning(
-                    Utility::FormatString(
-                        L"Error parsing configuration file. '%s' isn't a valid log level. Setting 'Error' level as default", logLevelStr.c_str()
-                    ).c_str()
-                );
-            }
-        }
-        else
-        {
-            //
-            // Discard unwanted attributes
-            //
-            Parser.SkipValue();
-        }
-    } while (Parser.ParseNextObjectElement());
-
-
-    return Result.IsValid();
-}
-
-///
-/// Reads a single 'provider' object from the parser, and return it in the Result param
-///
-/// \param Parser       A pre-initialized JSON parser.
-/// \param Result       Returns an ETWProvider struct filled with the values specified in the config file.
-///
-/// \return True if the channel is valid. Otherwise false
-///
-bool
-ReadETWProvider(
-    _In_ JsonFileParser& Parser,
-    _Out_ ETWProvider& Result
-    )
-{
-    if (Parser.GetNextDataType() != JsonFileParser::DataType::Object)
-    {
-        logWriter.TraceError(L"Error parsing configuration file. Provider item expected to be an object");
-        Parser.SkipValue();
-        return false;
-    }
-
-    if (!Parser.BeginParseObject())
-    {
-        logWriter.TraceError(L"Error parsing configuration file. Error reading provider object");
-        return false;
-    }
-
-    do
-    {
-        const auto& key = Parser.GetKey();
-
-        if (_wcsnicmp(key.c_str(), JSON_TAG_PROVIDER_NAME, _countof(JSON_TAG_PROVIDER_NAME)) == 0)
-        {
-            //
-            // Recover the name of the provider
-            //
-            Result.ProviderName = Parser.ParseStringValue();
-        }
-        else if (_wcsnicmp(key.c_str(), JSON_TAG_PROVIDER_GUID, _countof(JSON_TAG_PROVIDER_GUID)) == 0)
-        {
-            //
-            // Recover the GUID of the provider. If the string isn't a valid
-            // GUID, ProviderGuidStr will be empty
-            //
-            Result.SetProviderGuid(Parser.ParseStringValue());
-        }
-        else if (_wcsnicmp(key.c_str(), JSON_TAG_PROVIDER_LEVEL, _countof(JSON_TAG_PROVIDER_LEVEL)) == 0)
-        {
-            //
-            // Get the level as a string, and convert it to EventChannelLogLevel.
-            //
-            std::wstring logLevelStr = Parser.ParseStringValue();
-            bool success = Result.StringToLevel(logLevelStr);
-
-            //
-            // Print an error message the string doesn't matches with a valid log level name.
-            //
-            if (!success)
-            {
-                logWriter.TraceWarning(
-                    Utility::FormatString(
-                        L"Error parsing configuration file. '%s' isn't a valid log level. Setting 'Error' level as default", logLevelStr.c_str()
-                    ).c_str()
-                );
-            }
-        }
-        else if (_wcsnicmp(key.c_str(), JSON_TAG_KEYWORDS, _countof(JSON_TAG_KEYWORDS)) == 0)
-        {
-            //
-            // Recover the GUID of the provider
-            //
-            Result.Keywords = wcstoull(Parser.ParseStringValue().c_str(), NULL, 0);
-        }
-        else
-        {
-            //
-            // Discard unwanted attributes
-            //
-            Parser.SkipValue();
-        }
-    } while (Parser.ParseNextObjectElement());
-
-
-    return Result.IsValid();
-}
-
-///
-/// Converts the attributes to a valid Source and add it to the vector Sources
-///
-/// \param Parser       A pre-initialized JSON parser.
-/// \param Attributes   An AttributesMap that contains the attributes of the new source objet.
-/// \param Sources      A vector, where the new source is going to be inserted after been instantiated.
-///
-/// \return True if Source was created and added successfully. Otherwise false
-///
-bool
-AddNewSource(
-    _In_ JsonFileParser& Parser,
-    _In_ AttributesMap& Attributes,
-    _Inout_ std::vector<std::shared_ptr<LogSource> >& Sources
-    )
-{
-    //
-    // Check the source has a type.
-    //
-    if (Attributes.find(JSON_TAG_TYPE) == Attributes.end()
-        || Attributes[JSON_TAG_TYPE] == nullptr)
-    {
-        return false;
-    }
-
-    switch (*(LogSourceType*)Attributes[JSON_TAG_TYPE])
-    {
-        case LogSourceType::EventLog:
-        {
-            std::shared_ptr<SourceEventLog> sourceEventLog = std::make_shared< SourceEventLog>();
-
-            //
-            // Fill the new EventLog source object, with its attributes
-            //
-            if (!SourceEventLog::Unwrap(Attributes, *sourceEventLog))
-            {
-                logWriter.TraceError(L"Error parsing configuration file. Invalid EventLog source (it must have a non-empty 'channels')");
-                return false;
-            }
-
-            Sources.push_back(std::reinterpret_pointer_cast<LogSource>(std::move(sourceEventLog)));
-
-            break;
-        }
-
-        case LogSourceType::File:
-        {
-            std::shared_ptr<SourceFile> sourceFile = std::make_shared< SourceFile>();
-
-            //
-            // Fill the new File source object, with its attributes
-            //
-            if (!SourceFile::Unwrap(Attributes, *sourceFile))
-            {
-                logWriter.TraceError(L"Error parsing configuration file. Invalid File source (it must have a non-empty 'directory')");
-                return false;
-            }
-
-            Sources.push_back(std::reinterpret_pointer_cast<LogSource>(std::move(sourceFile)));
-
-            break;
-        }
-
-        case LogSourceType::ETW:
-        {
-            std::shared_ptr<SourceETW> sourceETW = std::make_shared< SourceETW>();
-
-            //
-            // Fill the new ETW source object, with its attributes
-            //
-            if (!SourceETW::Unwrap(Attributes, *sourceETW))
-            {
-                logWriter.TraceError(L"Error parsing configuration file. Invalid ETW source (it must have a non-empty 'providers')");
-                return false;
-            }
-
-            Sources.push_back(std::reinterpret_pointer_cast<LogSource>(std::move(sourceETW)));
-
-            break;
-        }
-    }
-    return true;
-}
-
-///
-/// Debug function
-///
-void _PrintSettings(_Out_ LoggerSettings& Config)
-{
-    std::wprintf(L"LogConfig:\n");
-    std::wprintf(L"\tsources:\n");
-
-    for (auto source : Config.Sources)
-    {
-        switch (source->Type)
-        {
-        case LogSourceType::EventLog:
-        {
-            std::wprintf(L"\t\tType: EventLog\n");
-            std::shared_ptr<SourceEventLog> sourceEventLog = std::reinterpret_pointer_cast<SourceEventLog>(source);
-
-            std::wprintf(L"\t\teventFormatMultiLine: %ls\n", sourceEventLog->EventFormatMultiLine ? L"true" : L"false");
-            std::wprintf(L"\t\tstartAtOldestRecord: %ls\n", sourceEventLog->StartAtOldestRecord ? L"true" : L"false");
-
-            std::wprintf(L"\t\tChannels (%d):\n", (int)sourceEventLog->Channels.size());
-            for (auto channel : sourceEventLog->Channels)
-            {
-                std::wprintf(L"\t\t\tName: %ls\n", channel.Name.c_str());
-                std::wprintf(L"\t\t\tLevel: %d\n", (int)channel.Level);
-                std::wprintf(L"\n");
-            }
-            std::wprintf(L"\n");
-
-            break;
-        }
-        case LogSourceType::File:
-        {
-            std::wprintf(L"\t\tType: File\n");
-            std::shared_ptr<SourceFile> sourceFile = std::reinterpret_pointer_cast<SourceFile>(source);
-
-            std::wprintf(L"\t\tDirectory: %ls\n", sourceFile->Directory.c_str());
-            std::wprintf(L"\t\tFilter: %ls\n", sourceFile->Filter.c_str());
-            std::wprintf(L"\t\tIncludeSubdirectories: %ls\n", sourceFile->IncludeSubdirectories ? L"true" : L"false");
-            std::wprintf(L"\t\tIncludeFileNames: %ls\n", sourceFile->IncludeFileNames ? L"true" : L"false");
-            std::wprintf(L"\n");
-
-            break;
-        }
-        case LogSourceType::ETW:
-        {
-            std::wprintf(L"\t\tType: ETW\n");
-
-            std::shared_ptr<SourceETW> sourceETW = std::reinterpret_pointer_cast<SourceETW>(source);
-
-            std::wprintf(L"\t\teventFormatMultiLine: %ls\n", sourceETW->EventFormatMultiLine ? L"true" : L"false");
-
-            std::wprintf(L"\t\tProviders (%d):\n", (int)sourceETW->Providers.size());
-            for (auto provider : sourceETW->Providers)
-            {
-                std::wprintf(L"\t\t\tProviderName: %ls\n", provider.ProviderName.c_str());
-                std::wprintf(L"\t\t\tProviderGuid: %ls\n", provider.ProviderGuidStr.c_str());
-                std::wprintf(L"\t\t\tLevel: %d\n", (int)provider.Level);
-                std::wprintf(L"\t\t\tKeywords: %llx\n", provider.Keywords);
-                std::wprintf(L"\n");
-            }
-            std::wprintf(L"\n");
-
-            break;
-        }
-        } // Switch
-    }
-}
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+
+#include "pch.h"
+#include "./Parser/ConfigFileParser.h"
+#include "./LogWriter.h"
+
+/// ConfigFileParser.cpp
+///
+/// Reads the configuration file content (as a string), parsing it with a
+/// JsonFileParser object previously created.
+///
+/// The main entry point in this file is OpenConfigFile.
+///
+
+///
+/// Open the config file and convert the document content into json
+///
+/// \param FileName       Config File name.
+///
+/// \return True if the configuration file was valid. Otherwise false
+///
+bool OpenConfigFile(_In_ const PWCHAR ConfigFileName, _Out_ LoggerSettings& Config)
+{
+    bool success;
+    std::wifstream configFileStream(ConfigFileName);
+    configFileStream.imbue(std::locale(configFileStream.getloc(),
+        new std::codecvt_utf8_utf16<wchar_t, 0x10ffff, std::little_endian>));
+
+    if (configFileStream.is_open())
+    {
+        try
+        {
+            //
+            // Convert the document content to a string, to pass it to JsonFileParser constructor.
+            //
+            std::wstring configFileStr((std::istreambuf_iterator<wchar_t>(configFileStream)),
+                std::istreambuf_iterator<wchar_t>());
+            configFileStr.erase(remove(configFileStr.begin(), configFileStr.end(), 0xFEFF), configFileStr.end());
+
+            JsonFileParser jsonParser(configFileStr);
+
+            success = ReadConfigFile(jsonParser, Config);
+        }
+        catch (std::exception& ex)
+        {
+            logWriter.TraceError(
+                FORMAT_STRING(L"Failed to read json configuration file. %S", ex.what()).c_str()
+            );
+            success = false;
+        }
+        catch (...)
+        {
+            logWriter.TraceError(
+                L"Failed to read json configuration file. Unknown error occurred."
+            );
+            success = false;
+        }
+    } else {
+        logWriter.TraceError(
+            FORMAT_STRING(
+                L"Configuration file '%s' not found. Logs will not be monitored.",
+                ConfigFileName
+            ).c_str()
+        );
+        success = false;
+    }
+
+    return success;
+}
+
+///
+/// Read the root JSON of the config file
+///
+/// \param Parser       A pre-initialized JSON parser.
+/// \param Config       Returns a LoggerSettings struct with the values specified
+///     in the config file.
+///
+/// \return True if the configuration file was valid. Otherwise false
+///
+bool
+ReadConfigFile(
+    _In_ JsonFileParser& Parser,
+    _Out_ LoggerSettings& Config
+    )
+{
+    if (Parser.GetNextDataType() != JsonFileParser::DataType::Object)
+    {
+        logWriter.TraceError(L"Failed to parse configuration file. Object expected at the file's root");
+        return false;
+    }
+
+    bool containsLogConfigTag = false;
+
+    if (Parser.BeginParseObject())
+    {
+        do
+        {
+            const std::wstring key(Parser.GetKey());
+
+            if (_wcsnicmp(key.c_str(), JSON_TAG_LOG_CONFIG, _countof(JSON_TAG_LOG_CONFIG)) == 0)
+            {
+                containsLogConfigTag = ReadLogConfigObject(Parser, Config);
+            }
+            else
+            {
+                Parser.SkipValue();
+            }
+        } while (Parser.ParseNextObjectElement());
+    }
+
+    return containsLogConfigTag;
+}
+
+///
+/// Read LogConfig tag, that contains the config of the sources
+///
+/// \param Parser       A pre-initialized JSON parser.
+/// \param Config       Returns a LoggerSettings struct with the values specified
+///                     in the config file.
+///
+/// \return True if LogConfig tag was valid. Otherwise false
+///
+bool
+ReadLogConfigObject(
+    _In_ JsonFileParser& Parser,
+    _Out_ LoggerSettings& Config
+    )
+{
+    if (Parser.GetNextDataType() != JsonFileParser::DataType::Object)
+    {
+        logWriter.TraceError(L"Failed to parse configuration file. 'LogConfig' is expected to be an object");
+        Parser.SkipValue();
+        return false;
+    }
+
+    bool sourcesTagFound = false;
+    if (Parser.BeginParseObject())
+    {
+        do
+        {
+            const std::wstring key(Parser.GetKey());
+
+            if (_wcsnicmp(key.c_str(), JSON_TAG_SOURCES, _countof(JSON_TAG_SOURCES)) == 0)
+            {
+                if (Parser.GetNextDataType() != JsonFileParser::DataType::Array)
+                {
+                    logWriter.TraceError(L"Failed to parse configuration file. 'sources' attribute expected to be an array");
+                    Parser.SkipValue();
+                    continue;
+                }
+
+                sourcesTagFound = true;
+
+                if (!Parser.BeginParseArray())
+                {
+                    continue;
+                }
+
+                do
+                {
+                    AttributesMap sourceAttributes;
+
+                    //
+                    // Read all attributes of a source from the config file,
+                    // instantiate it and add it to the end of the vector
+                    //
+                    if (ReadSourceAttributes(Parser, sourceAttributes)) {
+                        if (!AddNewSource(Parser, sourceAttributes, Config.Sources))
+                        {
+                            logWriter.TraceWarning(L"Failed to parse configuration file. Error reading invalid source.");
+                        }
+                    }
+                    else
+                    {
+                        logWriter.TraceWarning(L"Failed to parse configuration file. Error retrieving source attributes. Invalid source");
+                    }
+
+                    for (auto attributePair : sourceAttributes)
+                    {
+                        if (attributePair.second != nullptr)
+                        {
+                            delete attributePair.second;
+                        }
+                    }
+                } while (Parser.ParseNextArrayElement());
+            }
+            else if (_wcsnicmp(key.c_str(), JSON_TAG_OUTPUT, _countof(JSON_TAG_OUTPUT)) == 0)
+            {
+                ReadOutputObject(Parser, Config.Output);
+            }
+            else
+            {
+                logWriter.TraceWarning(FORMAT_STRING(L"Error parsing configuration file. 'Unknow key %ws in the configuration file.", key.c_str()).c_str());
+                Parser.SkipValue();
+            }
+        } while (Parser.ParseNextObjectElement());
+    }
+
+    return sourcesTagFound;
+}
+
+///
+/// Reads the 'output' object of LogConfig. Invalid attributes keep their
+/// default value.
+///
+/// \param Parser       A pre-initialized JSON parser.
+/// \param Result       Returns an OutputSettings struct with the values specified
+///                     in the config file.
+///
+/// \return True if the output object was valid. Otherwise false
+///
+bool
+ReadOutputObject(
+    _In_ JsonFileParser& Parser,
+    _Out_ OutputSettings& Result
+    )
+{
+    if (Parser.GetNextDataType() != JsonFileParser::DataType::Object)
+    {
+        logWriter.TraceError(L"Error parsing configuration file. 'output' attribute expected to be an object");
+        Parser.SkipValue();
+        return false;
+    }
+
+    bool success = true;
+
+    if (!Parser.BeginParseObject())
+    {
+        return success;
+    }
+
+    do
+    {
+        const std::wstring key(Parser.GetKey());
+
+        if (_wcsnicmp(key.c_str(), JSON_TAG_FLUSH_LATENCY, _countof(JSON_TAG_FLUSH_LATENCY)) == 0
+            || _wcsnicmp(key.c_str(), JSON_TAG_MAX_BUFFERED_BYTES, _countof(JSON_TAG_MAX_BUFFERED_BYTES)) == 0
+            || _wcsnicmp(key.c_str(), JSON_TAG_DROP_REPORT_INTERVAL, _countof(JSON_TAG_DROP_REPORT_INTERVAL)) == 0)
+        {
+            if (Parser.GetNextDataType() != JsonFileParser::DataType::Number)
+            {
+                logWriter.TraceError(
+                    FORMAT_STRING(
+                        L"Error parsing configuration file. '%s' attribute expected to be a number", key.c_str()
+                    ).c_str()
+                );
+                Parser.SkipValue();
+                success = false;
+                continue;
+            }
+
+            const double value = Parser.ParseNumericValue();
+
+            if (value < 0)
+            {
+                logWriter.TraceError(
+                    FORMAT_STRING(
+                        L"Error parsing configuration file. '%s' attribute can't be negative", key.c_str()
+                    ).c_str()
+                );
+                success = false;
+                continue;
+            }
+
+            const DWORD dwordValue = static_cast<DWORD>((std::min)(value, static_cast<double>(MAXDWORD)));
+
+            if (_wcsnicmp(key.c_str(), JSON_TAG_FLUSH_LATENCY, _countof(JSON_TAG_FLUSH_LATENCY)) == 0)
+            {
+                Result.FlushLatencyMillis = dwordValue;
+            }
+            else if (_wcsnicmp(key.c_str(), JSON_TAG_MAX_BUFFERED_BYTES, _countof(JSON_TAG_MAX_BUFFERED_BYTES)) == 0)
+            {
+                Result.MaxBufferedBytes = static_cast<UINT64>((std::min)(value, static_cast<double>(MAXLONGLONG)));
+            }
+            else
+            {
+                Result.DropReportIntervalSeconds = dwordValue;
+            }
+        }
+        else if (_wcsnicmp(key.c_str(), JSON_TAG_OUTPUT_FORMAT, _countof(JSON_TAG_OUTPUT_FORMAT)) == 0)
+        {
+            if (Parser.GetNextDataType() != JsonFileParser::DataType::String)
+            {
+                logWriter.TraceError(L"Error parsing configuration file. 'format' attribute expected to be a string");
+                Parser.SkipValue();
+                success = false;
+                continue;
+            }
+
+            const auto& formatString = Parser.ParseStringValue();
+            bool found = false;
+
+            for (int i = 0; i < _countof(OutputFormatNames); i++)
+            {
+                if (_wcsicmp(formatString.c_str(), OutputFormatNames[i]) == 0)
+                {
+                    Result.Format = static_cast<OutputFormat>(i);
+                    found = true;
+                }
+            }
+
+            if (!found)
+            {
+                logWriter.TraceError(
+                    FORMAT_STRING(
+                        L"Error parsing configuration file. '%s' isn't a valid output format",
+                        formatString.c_str()
+                    ).c_str()
+                );
+                success = false;
+            }
+        }
+        else if (_wcsnicmp(key.c_str(), JSON_TAG_TIMESTAMP_PRECISION, _countof(JSON_TAG_TIMESTAMP_PRECISION)) == 0)
+        {
+            if (Parser.GetNextDataType() != JsonFileParser::DataType::String)
+            {
+                logWriter.TraceError(L"Error parsing configuration file. 'timestampPrecision' attribute expected to be a string");
+                Parser.SkipValue();
+                success = false;
+                continue;
+            }
+
+            const auto& precisionString = Parser.ParseStringValue();
+            bool found = false;
+
+            for (int i = 0; i < _countof(TimestampPrecisionNames); i++)
+            {
+                if (_wcsicmp(precisionString.c_str(), TimestampPrecisionNames[i]) == 0)
+                {
+                    Result.TimePrecision = static_cast<TimestampPrecision>(i);
+                    found = true;
+                }
+            }
+
+            if (!found)
+            {
+                logWriter.TraceError(
+                    FORMAT_STRING(
+                        L"Error parsing configuration file. '%s' isn't a valid timestamp precision",
+                        precisionString.c_str()
+                    ).c_str()
+                );
+                success = false;
+            }
+        }
+        else if (_wcsnicmp(key.c_str(), JSON_TAG_OUTPUT_STDOUT, _countof(JSON_TAG_OUTPUT_STDOUT)) == 0)
+        {
+            if (Parser.GetNextDataType() != JsonFileParser::DataType::Boolean)
+            {
+                logWriter.TraceError(L"Error parsing configuration file. 'stdout' attribute expected to be a boolean");
+                Parser.SkipValue();
+                success = false;
+                continue;
+            }
+
+            Result.Stdout = Parser.ParseBooleanValue();
+        }
+        else if (_wcsnicmp(key.c_str(), JSON_TAG_OUTPUT_FILE, _countof(JSON_TAG_OUTPUT_FILE)) == 0)
+        {
+            if (!ReadOutputFileObject(Parser, Result.File))
+            {
+                success = false;
+            }
+        }
+        else if (_wcsnicmp(key.c_str(), JSON_TAG_OUTPUT_NETWORK, _countof(JSON_TAG_OUTPUT_NETWORK)) == 0)
+        {
+            if (!ReadOutputNetworkObject(Parser, Result.Network))
+            {
+                success = false;
+            }
+        }
+        else
+        {
+            logWriter.TraceWarning(
+                FORMAT_STRING(
+                    L"Error parsing configuration file. Unknown key %ws in the 'output' object.", key.c_str()
+                ).c_str()
+            );
+            Parser.SkipValue();
+        }
+    } while (Parser.ParseNextObjectElement());
+
+    if (!Result.Stdout && Result.File.Path.empty() && Result.Network.Host.empty())
+    {
+        logWriter.TraceWarning(
+            L"Error parsing configuration file. 'stdout' can only be false with an output file or network. The lines are written to stdout."
+        );
+        Result.Stdout = true;
+    }
+
+    return success;
+}
+
+///
+/// Reads the 'file' object of 'output'. Invalid attributes keep their
+/// default value.
+///
+/// \param Parser       A pre-initialized JSON parser.
+/// \param Result       Returns a FileOutputSettings struct with the values
+///                     specified in the config file.
+///
+/// \return True if the file object was valid. Otherwise false
+///
+bool
+ReadOutputFileObject(
+    _In_ JsonFileParser& Parser,
+    _Out_ FileOutputSettings& Result
+    )
+{
+    if (Parser.GetNextDataType() != JsonFileParser::DataType::Object)
+    {
+        logWriter.TraceError(L"Error parsing configuration file. 'file' attribute expected to be an object");
+        Parser.SkipValue();
+        return false;
+    }
+
+    bool success = true;
+
+    if (!Parser.BeginParseObject())
+    {
+        return success;
+    }
+
+    do
+    {
+        const std::wstring key(Parser.GetKey());
+
+        if (_wcsnicmp(key.c_str(), JSON_TAG_FILE_PATH, _countof(JSON_TAG_FILE_PATH)) == 0)
+        {
+            if (Parser.GetNextDataType() != JsonFileParser::DataType::String)
+            {
+                logWriter.TraceError(L"Error parsing configuration file. 'path' attribute expected to be a string");
+                Parser.SkipValue();
+                success = false;
+                continue;
+            }
+
+            Result.Path = Parser.ParseStringValue();
+        }
+        else if (_wcsnicmp(key.c_str(), JSON_TAG_COMPRESSION, _countof(JSON_TAG_COMPRESSION)) == 0)
+        {
+            if (Parser.GetNextDataType() != JsonFileParser::DataType::String)
+            {
+                logWriter.TraceError(L"Error parsing configuration file. 'compression' attribute expected to be a string");
+                Parser.SkipValue();
+                success = false;
+                continue;
+            }
+
+            const auto& compressionString = Parser.ParseStringValue();
+            bool found = false;
+
+            for (int i = 0; i < _countof(CompressionCodecNames); i++)
+            {
+                if (_wcsicmp(compressionString.c_str(), CompressionCodecNames[i]) == 0)
+                {
+                    Result.Compression = static_cast<CompressionCodec>(i);
+                    found = true;
+                }
+            }
+
+            if (!found)
+            {
+                logWriter.TraceError(
+                    FORMAT_STRING(
+                        L"Error parsing configuration file. '%s' isn't a valid compression",
+                        compressionString.c_str()
+                    ).c_str()
+                );
+                success = false;
+            }
+        }
+        else if (_wcsnicmp(key.c_str(), JSON_TAG_MAX_FILE_SIZE, _countof(JSON_TAG_MAX_FILE_SIZE)) == 0
+            || _wcsnicmp(key.c_str(), JSON_TAG_ROTATION_INTERVAL, _countof(JSON_TAG_ROTATION_INTERVAL)) == 0
+            || _wcsnicmp(key.c_str(), JSON_TAG_RETAINED_FILES, _countof(JSON_TAG_RETAINED_FILES)) == 0
+            || _wcsnicmp(key.c_str(), JSON_TAG_PREALLOCATE_BYTES, _countof(JSON_TAG_PREALLOCATE_BYTES)) == 0
+            || _wcsnicmp(key.c_str(), JSON_TAG_COMPRESSION_BLOCK_BYTES, _countof(JSON_TAG_COMPRESSION_BLOCK_BYTES)) == 0)
+        {
+            if (Parser.GetNextDataType() != JsonFileParser::DataType::Number)
+            {
+                logWriter.TraceError(
+                    FORMAT_STRING(
+                        L"Error parsing configuration file. '%s' attribute expected to be a number", key.c_str()
+                    ).c_str()
+                );
+                Parser.SkipValue();
+                success = false;
+                continue;
+            }
+
+            const double value = Parser.ParseNumericValue();
+
+            if (value < 0)
+            {
+                logWriter.TraceError(
+                    FORMAT_STRING(
+                        L"Error parsing configuration file. '%s' attribute can't be negative", key.c_str()
+                    ).c_str()
+                );
+                success = false;
+                continue;
+            }
+
+            const DWORD dwordValue = static_cast<DWORD>((std::min)(value, static_cast<double>(MAXDWORD)));
+            const UINT64 sizeValue = static_cast<UINT64>((std::min)(value, static_cast<double>(MAXLONGLONG)));
+
+            if (_wcsnicmp(key.c_str(), JSON_TAG_MAX_FILE_SIZE, _countof(JSON_TAG_MAX_FILE_SIZE)) == 0)
+            {
+                Result.MaxFileSizeBytes = sizeValue;
+            }
+            else if (_wcsnicmp(key.c_str(), JSON_TAG_ROTATION_INTERVAL, _countof(JSON_TAG_ROTATION_INTERVAL)) == 0)
+            {
+                Result.RotationIntervalSeconds = dwordValue;
+            }
+            else if (_wcsnicmp(key.c_str(), JSON_TAG_RETAINED_FILES, _countof(JSON_TAG_RETAINED_FILES)) == 0)
+            {
+                Result.RetainedFiles = dwordValue;
+            }
+            else if (_wcsnicmp(key.c_str(), JSON_TAG_PREALLOCATE_BYTES, _countof(JSON_TAG_PREALLOCATE_BYTES)) == 0)
+            {
+                Result.PreallocateBytes = sizeValue;
+            }
+            else
+            {
+                Result.CompressionBlockBytes = sizeValue;
+            }
+        }
+        else
+        {
+            logWriter.TraceWarning(
+                FORMAT_STRING(
+                    L"Error parsing configuration file. Unknown key %ws in the 'file' object.", key.c_str()
+                ).c_str()
+            );
+            Parser.SkipValue();
+        }
+    } while (Parser.ParseNextObjectElement());
+
+    if (Result.Path.empty())
+    {
+        logWriter.TraceError(L"Error parsing configuration file. 'path' attribute is required in the 'file' object");
+        success = false;
+    }
+
+    return success;
+}
+
+///
+/// Reads the 'network' object of 'output'. Invalid attributes keep their
+/// default value.
+///
+/// \param Parser       A pre-initialized JSON parser.
+/// \param Result       Returns a NetworkOutputSettings struct with the values
+///                     specified in the config file.
+///
+/// \return True if the network object was valid. Otherwise false
+///
+bool
+ReadOutputNetworkObject(
+    _In_ JsonFileParser& Parser,
+    _Out_ NetworkOutputSettings& Result
+    )
+{
+    if (Parser.GetNextDataType() != JsonFileParser::DataType::Object)
+    {
+        logWriter.TraceError(L"Error parsing configuration file. 'network' attribute expected to be an object");
+        Parser.SkipValue();
+        return false;
+    }
+
+    bool success = true;
+
+    if (!Parser.BeginParseObject())
+    {
+        return success;
+    }
+
+    do
+    {
+        const std::wstring key(Parser.GetKey());
+
+        if (_wcsnicmp(key.c_str(), JSON_TAG_NETWORK_HOST, _countof(JSON_TAG_NETWORK_HOST)) == 0
+            || _wcsnicmp(key.c_str(), JSON_TAG_NETWORK_TAG, _countof(JSON_TAG_NETWORK_TAG)) == 0
+            || _wcsnicmp(key.c_str(), JSON_TAG_QUEUE_DIRECTORY, _countof(JSON_TAG_QUEUE_DIRECTORY)) == 0)
+        {
+            if (Parser.GetNextDataType() != JsonFileParser::DataType::String)
+            {
+                logWriter.TraceError(
+                    FORMAT_STRING(
+                        L"Error parsing configuration file. '%s' attribute expected to be a string", key.c_str()
+                    ).c_str()
+                );
+                Parser.SkipValue();
+                success = false;
+                continue;
+            }
+
+            if (_wcsnicmp(key.c_str(), JSON_TAG_NETWORK_HOST, _countof(JSON_TAG_NETWORK_HOST)) == 0)
+            {
+                Result.Host = Parser.ParseStringValue();
+            }
+            else if (_wcsnicmp(key.c_str(), JSON_TAG_NETWORK_TAG, _countof(JSON_TAG_NETWORK_TAG)) == 0)
+            {
+                Result.Tag = Parser.ParseStringValue();
+            }
+            else
+            {
+                Result.QueueDirectory = Parser.ParseStringValue();
+            }
+        }
+        else if (_wcsnicmp(key.c_str(), JSON_TAG_NETWORK_PROTOCOL, _countof(JSON_TAG_NETWORK_PROTOCOL)) == 0)
+        {
+            if (Parser.GetNextDataType() != JsonFileParser::DataType::String)
+            {
+                logWriter.TraceError(L"Error parsing configuration file. 'protocol' attribute expected to be a string");
+                Parser.SkipValue();
+                success = false;
+                continue;
+            }
+
+            const auto& protocolString = Parser.ParseStringValue();
+            bool found = false;
+
+            for (int i = 0; i < _countof(NetworkProtocolNames); i++)
+            {
+                if (_wcsicmp(protocolString.c_str(), NetworkProtocolNames[i]) == 0)
+                {
+                    Result.Protocol = static_cast<NetworkProtocol>(i);
+                    found = true;
+                }
+            }
+
+            if (!found)
+            {
+                logWriter.TraceError(
+                    FORMAT_STRING(
+                        L"Error parsing configuration file. '%s' isn't a valid network protocol",
+                        protocolString.c_str()
+                    ).c_str()
+                );
+                success = false;
+            }
+        }
+        else if (_wcsnicmp(key.c_str(), JSON_TAG_NETWORK_FRAMING, _countof(JSON_TAG_NETWORK_FRAMING)) == 0)
+        {
+            if (Parser.GetNextDataType() != JsonFileParser::DataType::String)
+            {
+                logWriter.TraceError(L"Error parsing configuration file. 'framing' attribute expected to be a string");
+                Parser.SkipValue();
+                success = false;
+                continue;
+            }
+
+            const auto& framingString = Parser.ParseStringValue();
+            bool found = false;
+
+            for (int i = 0; i < _countof(NetworkFramingNames); i++)
+            {
+                if (_wcsicmp(framingString.c_str(), NetworkFramingNames[i]) == 0)
+                {
+                    Result.Framing = static_cast<NetworkFraming>(i);
+                    found = true;
+                }
+            }
+
+            if (!found)
+            {
+                logWriter.TraceError(
+                    FORMAT_STRING(
+                        L"Error parsing configuration file. '%s' isn't a valid network framing",
+                        framingString.c_str()
+                    ).c_str()
+                );
+                success = false;
+            }
+        }
+        else if (_wcsnicmp(key.c_str(), JSON_TAG_NETWORK_PORT, _countof(JSON_TAG_NETWORK_PORT)) == 0
+            || _wcsnicmp(key.c_str(), JSON_TAG_MAX_BATCH_RECORDS, _countof(JSON_TAG_MAX_BATCH_RECORDS)) == 0
+            || _wcsnicmp(key.c_str(), JSON_TAG_MAX_BATCH_BYTES, _countof(JSON_TAG_MAX_BATCH_BYTES)) == 0
+            || _wcsnicmp(key.c_str(), JSON_TAG_MAX_BATCH_DELAY, _countof(JSON_TAG_MAX_BATCH_DELAY)) == 0
+            || _wcsnicmp(key.c_str(), JSON_TAG_MAX_BUFFERED_BYTES, _countof(JSON_TAG_MAX_BUFFERED_BYTES)) == 0
+            || _wcsnicmp(key.c_str(), JSON_TAG_MIN_RECONNECT_DELAY, _countof(JSON_TAG_MIN_RECONNECT_DELAY)) == 0
+            || _wcsnicmp(key.c_str(), JSON_TAG_MAX_RECONNECT_DELAY, _countof(JSON_TAG_MAX_RECONNECT_DELAY)) == 0
+            || _wcsnicmp(key.c_str(), JSON_TAG_QUEUE_MAX_BYTES, _countof(JSON_TAG_QUEUE_MAX_BYTES)) == 0
+            || _wcsnicmp(key.c_str(), JSON_TAG_QUEUE_SEGMENT_BYTES, _countof(JSON_TAG_QUEUE_SEGMENT_BYTES)) == 0)
+        {
+            if (Parser.GetNextDataType() != JsonFileParser::DataType::Number)
+            {
+                logWriter.TraceError(
+                    FORMAT_STRING(
+                        L"Error parsing configuration file. '%s' attribute expected to be a number", key.c_str()
+                    ).c_str()
+                );
+                Parser.SkipValue();
+                success = false;
+                continue;
+            }
+
+            const double value = Parser.ParseNumericValue();
+
+            if (value < 0)
+            {
+                logWriter.TraceError(
+                    FORMAT_STRING(
+                        L"Error parsing configuration file. '%s' attribute can't be negative", key.c_str()
+                    ).c_str()
+                );
+                success = false;
+                continue;
+            }
+
+            const DWORD dwordValue = static_cast<DWORD>((std::min)(value, static_cast<double>(MAXDWORD)));
+            const UINT64 sizeValue = static_cast<UINT64>((std::min)(value, static_cast<double>(MAXLONGLONG)));
+
+            if (_wcsnicmp(key.c_str(), JSON_TAG_NETWORK_PORT, _countof(JSON_TAG_NETWORK_PORT)) == 0)
+            {
+                if (value > USHRT_MAX)
+                {
+                    logWriter.TraceError(L"Error parsing configuration file. 'port' attribute must be lower than 65536");
+                    success = false;
+                    continue;
+                }
+
+                Result.Port = static_cast<USHORT>(value);
+            }
+            else if (_wcsnicmp(key.c_str(), JSON_TAG_MAX_BATCH_RECORDS, _countof(JSON_TAG_MAX_BATCH_RECORDS)) == 0)
+            {
+                Result.MaxBatchRecords = dwordValue;
+            }
+            else if (_wcsnicmp(key.c_str(), JSON_TAG_MAX_BATCH_BYTES, _countof(JSON_TAG_MAX_BATCH_BYTES)) == 0)
+            {
+                Result.MaxBatchBytes = sizeValue;
+            }
+            else if (_wcsnicmp(key.c_str(), JSON_TAG_MAX_BATCH_DELAY, _countof(JSON_TAG_MAX_BATCH_DELAY)) == 0)
+            {
+                Result.MaxBatchDelayMillis = dwordValue;
+            }
+            else if (_wcsnicmp(key.c_str(), JSON_TAG_MAX_BUFFERED_BYTES, _countof(JSON_TAG_MAX_BUFFERED_BYTES)) == 0)
+            {
+                Result.MaxBufferedBytes = sizeValue;
+            }
+            else if (_wcsnicmp(key.c_str(), JSON_TAG_MIN_RECONNECT_DELAY, _countof(JSON_TAG_MIN_RECONNECT_DELAY)) == 0)
+            {
+                Result.MinReconnectDelayMillis = dwordValue;
+            }
+            else if (_wcsnicmp(key.c_str(), JSON_TAG_MAX_RECONNECT_DELAY, _countof(JSON_TAG_MAX_RECONNECT_DELAY)) == 0)
+            {
+                Result.MaxReconnectDelayMillis = dwordValue;
+            }
+            else if (_wcsnicmp(key.c_str(), JSON_TAG_QUEUE_MAX_BYTES, _countof(JSON_TAG_QUEUE_MAX_BYTES)) == 0)
+            {
+                Result.QueueMaxBytes = sizeValue;
+            }
+            else
+            {
+                Result.QueueSegmentBytes = sizeValue;
+            }
+        }
+        else
+        {
+            logWriter.TraceWarning(
+                FORMAT_STRING(
+                    L"Error parsing configuration file. Unknown key %ws in the 'network' object.", key.c_str()
+                ).c_str()
+            );
+            Parser.SkipValue();
+        }
+    } while (Parser.ParseNextObjectElement());
+
+    if (Result.Host.empty())
+    {
+        logWriter.TraceError(L"Error parsing configuration file. 'host' attribute is required in the 'network' object");
+        success = false;
+    }
+
+    if (Result.Framing == NetworkFraming::FluentForward && Result.Protocol == NetworkProtocol::Udp)
+    {
+        logWriter.TraceError(L"Error parsing configuration file. 'FluentForward' framing requires the 'TCP' protocol");
+        Result.Protocol = NetworkProtocol::Tcp;
+        success = false;
+    }
+
+    return success;
+}
+
+///
+/// Look for all the attributes that a single 'source' object contains
+///
+/// \param Parser       A pre-initialized JSON parser.
+/// \param Config       Returns an AttributesMap, with all allowed tag names and theirs values
+///
+/// \return True if the attributes contained valid values. Otherwise false
+///
+bool
+ReadSourceAttributes(
+    _In_ JsonFileParser& Parser,
+    _Out_ AttributesMap& Attributes
+    )
+{
+    if (Parser.GetNextDataType() != JsonFileParser::DataType::Object)
+    {
+        logWriter.TraceError(L"Failed to parse configuration file. Source item expected to be an object");
+        Parser.SkipValue();
+        return false;
+    }
+
+    bool success = true;
+
+    if (Parser.BeginParseObject())
+    {
+        do
+        {
+            //
+            // If source reading already fail, just skip attributes^M
+            //
+            if (!success)
+            {
+                Parser.SkipValue();
+                continue;
+            }
+
+            const std::wstring key(Parser.GetKey());
+
+            if (_wcsnicmp(key.c_str(), JSON_TAG_TYPE, _countof(JSON_TAG_TYPE)) == 0)
+            {
+                const auto& typeString = Parser.ParseStringValue();
+                LogSourceType* type = nullptr;
+
+                //
+                // Check if the string is the name of a valid LogSourceType
+                //
+                int sourceTypeArraySize = sizeof(LogSourceTypeNames) / sizeof(LogSourceTypeNames[0]);
+                for (int i = 0; i < sourceTypeArraySize; i++)
+                {
+                    if (_wcsnicmp(typeString.c_str(), LogSourceTypeNames[i], typeString.length()) == 0)
+                    {
+                        type = new LogSourceType;
+                        *type = static_cast<LogSourceType>(i);
+                    }
+                }
+
+                //
+                // If the value isn't a valid type, fail.
+                //
+                if (type == nullptr)
+                {
+                    logWriter.TraceError(
+                        FORMAT_STRING(
+                            L"Error parsing configuration file. '%s' isn't a valid source type", typeString.c_str()
+                        ).c_str()
+                    );
+
+                    success = false;
+                }
+                else
+                {
+                    Attributes[key] = type;
+                }
+            }
+            else if (_wcsnicmp(key.c_str(), JSON_TAG_OVERFLOW_POLICY, _countof(JSON_TAG_OVERFLOW_POLICY)) == 0)
+            {
+                const auto& policyString = Parser.ParseStringValue();
+                OverflowPolicy* policy = nullptr;
+
+                //
+                // Check if the string is the name of a valid OverflowPolicy
+                //
+                for (int i = 0; i < _countof(OverflowPolicyNames); i++)
+                {
+                    if (_wcsicmp(policyString.c_str(), OverflowPolicyNames[i]) == 0)
+                    {
+                        policy = new OverflowPolicy;
+                        *policy = static_cast<OverflowPolicy>(i);
+                    }
+                }
+
+                //
+                // An invalid policy keeps the default one, so no line is lost.
+                //
+                if (policy == nullptr)
+                {
+                    logWriter.TraceWarning(
+                        FORMAT_STRING(
+                            L"Error parsing configuration file. '%s' isn't a valid overflow policy. Using 'Block'.",
+                            policyString.c_str()
+                        ).c_str()
+                    );
+                }
+                else
+                {
+                    Attributes[key] = policy;
+                }
+            }
+            else if (_wcsnicmp(key.c_str(), JSON_TAG_CHANNELS, _countof(JSON_TAG_CHANNELS)) == 0)
+            {
+                if (Parser.GetNextDataType() != JsonFileParser::DataType::Array)
+                {
+                    logWriter.TraceError(L"Error parsing configuration file. 'channels' attribute expected to be an array");
+                    Parser.SkipValue();
+                    continue;
+                }
+
+                if (Parser.BeginParseArray())
+                {
+                    std::vector<EventLogChannel>* channels = new std::vector<EventLogChannel>();
+
+                    //
+                    // Get only the valid channels of this JSON object.
+                    //
+                    do
+                    {
+                        channels->emplace_back();
+                        if (!ReadLogChannel(Parser, channels->back()))
+                        {
+                            logWriter.TraceWarning(L"Error parsing configuration file. Discarded invalid channel (it must have a non-empty 'name').");
+                            channels->pop_back();
+                        }
+                    } while (Parser.ParseNextArrayElement());
+
+                    Attributes[key] = channels;
+                }
+            }
+            //
+            // These attributes are string type
+            // * directory
+            // * filter
+            // * checkpointFile
+            //
+            else if (_wcsnicmp(key.c_str(), JSON_TAG_DIRECTORY, _countof(JSON_TAG_DIRECTORY)) == 0
+                || _wcsnicmp(key.c_str(), JSON_TAG_FILTER, _countof(JSON_TAG_FILTER)) == 0
+                || _wcsnicmp(key.c_str(), JSON_TAG_CHECKPOINT_FILE, _countof(JSON_TAG_CHECKPOINT_FILE)) == 0)
+            {
+                Attributes[key] = new std::wstring(Parser.ParseStringValue());
+            }
+            //
+            // These attributes are boolean type
+            // * eventFormatMultiLine
+            // * startAtOldestRecord
+            // * includeSubdirectories
+            // * includeFileNames
+            // * parseJsonLines
+            //
+            else if (
+                _wcsnicmp(
+                    key.c_str(),
+                    JSON_TAG_FORMAT_MULTILINE,
+                    _countof(JSON_TAG_FORMAT_MULTILINE)) == 0
+                || _wcsnicmp(
+                    key.c_str(),
+                    JSON_TAG_START_AT_OLDEST_RECORD,
+                    _countof(JSON_TAG_START_AT_OLDEST_RECORD)) == 0
+                || _wcsnicmp(
+                    key.c_str(),
+                    JSON_TAG_INCLUDE_SUBDIRECTORIES,
+                    _countof(JSON_TAG_INCLUDE_SUBDIRECTORIES)) == 0
+                || _wcsnicmp(
+                    key.c_str(),
+                    JSON_TAG_INCLUDE_FILENAMES,
+                    _countof(JSON_TAG_INCLUDE_FILENAMES)) == 0
+                || _wcsnicmp(
+                    key.c_str(),
+                    JSON_TAG_PARSE_JSON_LINES,
+                    _countof(JSON_TAG_PARSE_JSON_LINES)) == 0)
+            {
+                Attributes[key] = new bool{ Parser.ParseBooleanValue() };
+            }
+            //
+            // These attributes are numeric type
+            // * maxReadBufferSize
+            // * checkpointIntervalSeconds
+            // * overflowSampleRate
+            // * rateLimit
+            // * rateLimitBurst
+            //
+            else if (_wcsnicmp(key.c_str(), JSON_TAG_MAX_READ_BUFFER_SIZE, _countof(JSON_TAG_MAX_READ_BUFFER_SIZE)) == 0
+                || _wcsnicmp(key.c_str(), JSON_TAG_CHECKPOINT_INTERVAL, _countof(JSON_TAG_CHECKPOINT_INTERVAL)) == 0
+                || _wcsnicmp(key.c_str(), JSON_TAG_OVERFLOW_SAMPLE_RATE, _countof(JSON_TAG_OVERFLOW_SAMPLE_RATE)) == 0
+                || _wcsnicmp(key.c_str(), JSON_TAG_RATE_LIMIT, _countof(JSON_TAG_RATE_LIMIT)) == 0
+                || _wcsnicmp(key.c_str(), JSON_TAG_RATE_LIMIT_BURST, _countof(JSON_TAG_RATE_LIMIT_BURST)) == 0)
+            {
+                if (Parser.GetNextDataType() != JsonFileParser::DataType::Number)
+                {
+                    logWriter.TraceError(
+                        FORMAT_STRING(
+                            L"Error parsing configuration file. '%s' attribute expected to be a number", key.c_str()
+                        ).c_str()
+                    );
+                    Parser.SkipValue();
+                    continue;
+                }
+
+                Attributes[key] = new double{ Parser.ParseNumericValue() };
+            }
+            else if (_wcsnicmp(key.c_str(), JSON_TAG_PROVIDERS, _countof(JSON_TAG_PROVIDERS)) == 0)
+            {
+                if (Parser.GetNextDataType() != JsonFileParser::DataType::Array)
+                {
+                    logWriter.TraceError(L"Error parsing configuration file. 'providers' attribute expected to be an array");
+                    Parser.SkipValue();
+                    continue;
+                }
+
+                if (Parser.BeginParseArray())
+                {
+                    std::vector<ETWProvider>* providers = new std::vector<ETWProvider>();
+
+                    //
+                    // Get only the valid providers of this JSON object.
+                    //
+                    do
+                    {
+                        providers->emplace_back();
+                        if (!ReadETWProvider(Parser, providers->back()))
+                        {
+                            logWriter.TraceWarning(L"Error parsing configuration file. Discarded invalid provider (it must have a non-empty 'providerName' or 'providerGuid').");
+                            providers->pop_back();
+                        }
+                    } while (Parser.ParseNextArrayElement());
+
+                    Attributes[key] = providers;
+                }
+            }
+            else
+            {
+                //
+                // Discard unwanted attributes
+                //
+                Parser.SkipValue();
+            }
+        } while (Parser.ParseNextObjectElement());
+    }
+
+    return success;
+}
+
+///
+/// Reads a single 'channel' object from the parser, and store it in the Result
+///
+/// \param Parser       A pre-initialized JSON parser.
+/// \param Result       Returns an EventLogChannel struct filled with the values specified in the config file.
+///
+/// \return True if the channel is valid. Otherwise false
+///
+bool
+ReadLogChannel(
+    _In_ JsonFileParser& Parser,
+    _Out_ EventLogChannel& Result
+    )
+{
+    if (Parser.GetNextDataType() != JsonFileParser::DataType::Object)
+    {
+        logWriter.TraceError(L"Error parsing configuration file. Channel item expected to be an object");
+        Parser.SkipValue();
+        return false;
+    }
+
+    if (!Parser.BeginParseObject())
+    {
+        logWriter.TraceError(L"Error parsing configuration file. Error reading channel object");
+        return false;
+    }
+
+    do
+    {
+        const auto& key = Parser.GetKey();
+
+        if (_wcsnicmp(key.c_str(), JSON_TAG_CHANNEL_NAME, _countof(JSON_TAG_CHANNEL_NAME)) == 0)
+        {
+            //
+            // Recover the name of the channel
+            //
+            Result.Name = Parser.ParseStringValue();
+        }
+        else if (_wcsnicmp(key.c_str(), JSON_TAG_CHANNEL_LEVEL, _countof(JSON_TAG_CHANNEL_LEVEL)) == 0)
+        {
+            //
+            // Get the level as a string, and convert it to EventChannelLogLevel.
+            //
+            std::wstring logLevelStr = Parser.ParseStringValue();
+            bool success = Result.SetLevelByString(logLevelStr);
+
+            //
+            // Print an error message the string doesn't matches with a valid log level name.
+            //
+            if (!success)
+            {
+                logWriter.TraceWarning(
+                    FORMAT_STRING(
+                        L"Error parsing configuration file. '%s' isn't a valid log level. Setting 'Error' level as default", logLevelStr.c_str()
+                    ).c_str()
+                );
+            }
+        }
+        else
+        {
+            //
+            // Discard unwanted attributes
+            //
+            Parser.SkipValue();
+        }
+    } while (Parser.ParseNextObjectElement());
+
+
+    return Result.IsValid();
+}
+
+///
+/// Reads a single 'provider' object from the parser, and return it in the Result param
+///
+/// \param Parser       A pre-initialized JSON parser.
+/// \param Result       Returns an ETWProvider struct filled with the values specified in the config file.
+///
+/// \return True if the channel is valid. Otherwise false
+///
+bool
+ReadETWProvider(
+    _In_ JsonFileParser& Parser,
+    _Out_ ETWProvider& Result
+    )
+{
+    if (Parser.GetNextDataType() != JsonFileParser::DataType::Object)
+    {
+        logWriter.TraceError(L"Error parsing configuration file. Provider item expected to be an object");
+        Parser.SkipValue();
+        return false;
+    }
+
+    if (!Parser.BeginParseObject())
+    {
+        logWriter.TraceError(L"Error parsing configuration file. Error reading provider object");
+        return false;
+    }
+
+    do
+    {
+        const auto& key = Parser.GetKey();
+
+        if (_wcsnicmp(key.c_str(), JSON_TAG_PROVIDER_NAME, _countof(JSON_TAG_PROVIDER_NAME)) == 0)
+        {
+            //
+            // Recover the name of the provider
+            //
+            Result.ProviderName = Parser.ParseStringValue();
+        }
+        else if (_wcsnicmp(key.c_str(), JSON_TAG_PROVIDER_GUID, _countof(JSON_TAG_PROVIDER_GUID)) == 0)
+        {
+            //
+            // Recover the GUID of the provider. If the string isn't a valid
+            // GUID, ProviderGuidStr will be empty
+            //
+            Result.SetProviderGuid(Parser.ParseStringValue());
+        }
+        else if (_wcsnicmp(key.c_str(), JSON_TAG_PROVIDER_LEVEL, _countof(JSON_TAG_PROVIDER_LEVEL)) == 0)
+        {
+            //
+            // Get the level as a string, and convert it to EventChannelLogLevel.
+            //
+            std::wstring logLevelStr = Parser.ParseStringValue();
+            bool success = Result.StringToLevel(logLevelStr);
+
+            //
+            // Print an error message the string doesn't matches with a valid log level name.
+            //
+            if (!success)
+            {
+                logWriter.TraceWarning(
+                    FORMAT_STRING(
+                        L"Error parsing configuration file. '%s' isn't a valid log level. Setting 'Error' level as default", logLevelStr.c_str()
+                    ).c_str()
+                );
+            }
+        }
+        else if (_wcsnicmp(key.c_str(), JSON_TAG_KEYWORDS, _countof(JSON_TAG_KEYWORDS)) == 0)
+        {
+            //
+            // Recover the GUID of the provider
+            //
+            Result.Keywords = wcstoull(Parser.ParseStringValue().c_str(), NULL, 0);
+        }
+        else
+        {
+            //
+            // Discard unwanted attributes
+            //
+            Parser.SkipValue();
+        }
+    } while (Parser.ParseNextObjectElement());
+
+
+    return Result.IsValid();
+}
+
+///
+/// Converts the attributes to a valid Source and add it to the vector Sources
+///
+/// \param Parser       A pre-initialized JSON parser.
+/// \param Attributes   An AttributesMap that contains the attributes of the new source objet.
+/// \param Sources      A vector, where the new source is going to be inserted after been instantiated.
+///
+/// \return True if Source was created and added successfully. Otherwise false
+///
+bool
+AddNewSource(
+    _In_ JsonFileParser& Parser,
+    _In_ AttributesMap& Attributes,
+    _Inout_ std::vector<std::shared_ptr<LogSource> >& Sources
+    )
+{
+    //
+    // Check the source has a type.
+    //
+    if (Attributes.find(JSON_TAG_TYPE) == Attributes.end()
+        || Attributes[JSON_TAG_TYPE] == nullptr)
+    {
+        return false;
+    }
+
+    switch (*(LogSourceType*)Attributes[JSON_TAG_TYPE])
+    {
+        case LogSourceType::EventLog:
+        {
+            std::shared_ptr<SourceEventLog> sourceEventLog = std::make_shared< SourceEventLog>();
+
+            //
+            // Fill the new EventLog source object, with its attributes
+            //
+            if (!SourceEventLog::Unwrap(Attributes, *sourceEventLog))
+            {
+                logWriter.TraceError(L"Error parsing configuration file. Invalid EventLog source (it must have a non-empty 'channels')");
+                return false;
+            }
+
+            Sources.push_back(std::reinterpret_pointer_cast<LogSource>(std::move(sourceEventLog)));
+
+            break;
+        }
+
+        case LogSourceType::File:
+        {
+            std::shared_ptr<SourceFile> sourceFile = std::make_shared< SourceFile>();
+
+            //
+            // Fill the new File source object, with its attributes
+            //
+            if (!SourceFile::Unwrap(Attributes, *sourceFile))
+            {
+                logWriter.TraceError(L"Error parsing configuration file. Invalid File source (it must have a non-empty 'directory')");
+                return false;
+            }
+
+            Sources.push_back(std::reinterpret_pointer_cast<LogSource>(std::move(sourceFile)));
+
+            break;
+        }
+
+        case LogSourceType::ETW:
+        {
+            std::shared_ptr<SourceETW> sourceETW = std::make_shared< SourceETW>();
+
+            //
+            // Fill the new ETW source object, with its attributes
+            //
+            if (!SourceETW::Unwrap(Attributes, *sourceETW))
+            {
+                logWriter.TraceError(L"Error parsing configuration file. Invalid ETW source (it must have a non-empty 'providers')");
+                return false;
+            }
+
+            Sources.push_back(std::reinterpret_pointer_cast<LogSource>(std::move(sourceETW)));
+
+            break;
+        }
+
+        case LogSourceType::Process:
+        {
+            std::shared_ptr<SourceProcess> sourceProcess = std::make_shared< SourceProcess>();
+
+            //
+            // Fill the new Process source object, with its attributes
+            //
+            SourceProcess::Unwrap(Attributes, *sourceProcess);
+
+            Sources.push_back(std::reinterpret_pointer_cast<LogSource>(std::move(sourceProcess)));
+
+            break;
+        }
+    }
+    return true;
+}
+
+///
+/// Debug function
+///
+void _PrintSettings(_Out_ LoggerSettings& Config)
+{
+    std::wprintf(L"LogConfig:\n");
+    std::wprintf(L"\tsources:\n");
+
+    for (auto source : Config.Sources)
+    {
+        switch (source->Type)
+        {
+        case LogSourceType::EventLog:
+        {
+            std::wprintf(L"\t\tType: EventLog\n");
+            std::shared_ptr<SourceEventLog> sourceEventLog = std::reinterpret_pointer_cast<SourceEventLog>(source);
+
+            std::wprintf(L"\t\teventFormatMultiLine: %ls\n", sourceEventLog->EventFormatMultiLine ? L"true" : L"false");
+            std::wprintf(L"\t\tstartAtOldestRecord: %ls\n", sourceEventLog->StartAtOldestRecord ? L"true" : L"false");
+
+            std::wprintf(L"\t\tChannels (%d):\n", (int)sourceEventLog->Channels.size());
+            for (auto channel : sourceEventLog->Channels)
+            {
+                std::wprintf(L"\t\t\tName: %ls\n", channel.Name.c_str());
+                std::wprintf(L"\t\t\tLevel: %d\n", (int)channel.Level);
+                std::wprintf(L"\n");
+            }
+            std::wprintf(L"\n");
+
+            break;
+        }
+        case LogSourceType::File:
+        {
+            std::wprintf(L"\t\tType: File\n");
+            std::shared_ptr<SourceFile> sourceFile = std::reinterpret_pointer_cast<SourceFile>(source);
+
+            std::wprintf(L"\t\tDirectory: %ls\n", sourceFile->Directory.c_str());
+            std::wprintf(L"\t\tFilter: %ls\n", sourceFile->Filter.c_str());
+            std::wprintf(L"\t\tIncludeSubdirectories: %ls\n", sourceFile->IncludeSubdirectories ? L"true" : L"false");
+            std::wprintf(L"\t\tIncludeFileNames: %ls\n", sourceFile->IncludeFileNames ? L"true" : L"false");
+            std::wprintf(L"\t\tMaxReadBufferSize: %lu\n", sourceFile->MaxReadBufferSize);
+            std::wprintf(L"\t\tCheckpointFile: %ls\n", sourceFile->CheckpointFile.c_str());
+            std::wprintf(L"\t\tCheckpointIntervalSeconds: %lu\n", sourceFile->CheckpointIntervalSeconds);
+            std::wprintf(L"\n");
+
+            break;
+        }
+        case LogSourceType::ETW:
+        {
+            std::wprintf(L"\t\tType: ETW\n");
+
+            std::shared_ptr<SourceETW> sourceETW = std::reinterpret_pointer_cast<SourceETW>(source);
+
+            std::wprintf(L"\t\teventFormatMultiLine: %ls\n", sourceETW->EventFormatMultiLine ? L"true" : L"false");
+
+            std::wprintf(L"\t\tProviders (%d):\n", (int)sourceETW->Providers.size());
+            for (auto provider : sourceETW->Providers)
+            {
+                std::wprintf(L"\t\t\tProviderName: %ls\n", provider.ProviderName.c_str());
+                std::wprintf(L"\t\t\tProviderGuid: %ls\n", provider.ProviderGuidStr.c_str());
+                std::wprintf(L"\t\t\tLevel: %d\n", (int)provider.Level);
+                std::wprintf(L"\t\t\tKeywords: %llx\n", provider.Keywords);
+                std::wprintf(L"\n");
+            }
+            std::wprintf(L"\n");
+
+            break;
+        }
+        case LogSourceType::Process:
+        {
+            std::wprintf(L"\t\tType: Process\n");
+            std::shared_ptr<SourceProcess> sourceProcess = std::reinterpret_pointer_cast<SourceProcess>(source);
+
+            std::wprintf(L"\t\tParseJsonLines: %ls\n", sourceProcess->ParseJsonLines ? L"true" : L"false");
+            std::wprintf(L"\n");
+
+            break;
+        }
+        } // Switch
+    }
+}
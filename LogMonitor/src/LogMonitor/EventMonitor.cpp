@@ -1,722 +1,780 @@
-//
-// Copyright (c) Microsoft Corporation.
-// Licensed under the MIT license.
-//
-
-#include "pch.h"
-
-using namespace std;
-
-
-///
-/// EventMonitor.cpp
-///
-/// Monitors a event log for new events in specified channels.
-///
-/// EventMonitor starts a monitor thread that waits for events from EvtSubscribe
-/// or for a stop event to be set. The same thread processes the changes and invokes the callback.
-/// Note: The constructor blocks until the spawned thread starts listening for changes or dies.
-///
-/// The destructor signals the stop event and waits up to MONITOR_THREAD_EXIT_MAX_WAIT_MILLIS for the monitoring
-/// thread to exit. To prevent the thread from out-living EventMonitor, the destructor fails fast
-/// if the wait fails or times out. This also ensures the callback is not being called and will not be
-/// called once EventMonitor is destroyed.
-///
-
-
-EventMonitor::EventMonitor(
-    _In_ const std::vector<EventLogChannel>& EventChannels,
-    _In_ bool EventFormatMultiLine,
-    _In_ bool StartAtOldestRecord
-    ) :
-    m_eventChannels(EventChannels),
-    m_eventFormatMultiLine(EventFormatMultiLine),
-    m_startAtOldestRecord(StartAtOldestRecord)
-{
-    m_stopEvent = NULL;
-    m_eventMonitorThread = NULL;
-
-    m_stopEvent = CreateEvent(nullptr, TRUE, FALSE, nullptr);
-
-    if (!m_stopEvent)
-    {
-        throw std::system_error(std::error_code(GetLastError(), std::system_category()), "CreateEvent");
-    }
-
-    m_eventMonitorThread = CreateThread(
-        nullptr,
-        0,
-        (LPTHREAD_START_ROUTINE)&EventMonitor::StartEventMonitorStatic,
-        this,
-        0,
-        nullptr
-    );
-
-    if (!m_eventMonitorThread)
-    {
-        throw std::system_error(std::error_code(GetLastError(), std::system_category()), "CreateThread");
-    }
-}
-
-EventMonitor::~EventMonitor()
-{
-    if (!SetEvent(m_stopEvent))
-    {
-        logWriter.TraceError(
-            Utility::FormatString(L"Failed to gracefully stop event log monitor %lu", GetLastError()).c_str()
-        );
-    }
-    else
-    {
-        //
-        // Wait for watch thread to exit.
-        //
-        DWORD waitResult = WaitForSingleObject(m_eventMonitorThread, EVENT_MONITOR_THREAD_EXIT_MAX_WAIT_MILLIS);
-
-        if (waitResult != WAIT_OBJECT_0)
-        {
-            HRESULT hr = (waitResult == WAIT_FAILED) ? HRESULT_FROM_WIN32(GetLastError())
-                                                           : HRESULT_FROM_WIN32(waitResult);
-        }
-    }
-
-    if (!m_eventMonitorThread)
-    {
-        CloseHandle(m_eventMonitorThread);
-    }
-
-    if (!m_stopEvent)
-    {
-        CloseHandle(m_stopEvent);
-    }
-}
-
-///
-/// Entry for the spawned event monitor thread.
-///
-/// \param Context Callback context to the event monitor thread.
-///                It's EventMonitor object that started this thread.
-///
-/// \return Status of event monitoring operation.
-///
-DWORD
-EventMonitor::StartEventMonitorStatic(
-    _In_ LPVOID Context
-    )
-{
-    auto pThis = reinterpret_cast<EventMonitor*>(Context);
-    try
-    {
-        DWORD status = pThis->StartEventMonitor();
-        if (status != ERROR_SUCCESS)
-        {
-            logWriter.TraceError(
-                Utility::FormatString(L"Failed to start event log monitor. Error: %lu", status).c_str()
-            );
-        }
-        return status;
-    }
-    catch (std::exception& ex)
-    {
-        logWriter.TraceError(
-            Utility::FormatString(L"Failed to start event log monitor. %S", ex.what()).c_str()
-        );
-        return E_FAIL;
-    }
-    catch (...)
-    {
-        logWriter.TraceError(
-            Utility::FormatString(L"Failed to start event log monitor. Unknown error occurred.").c_str()
-        );
-        return E_FAIL;
-    }
-}
-
-
-///
-/// Entry for the spawned event monitor thread. Loops to wait for either the stop event in which case it exits
-/// or for events to be arrived. When new events are arrived, it invokes the callback, resets,
-/// and starts the wait again.
-///
-/// \return Status of event monitoring operation.
-///
-DWORD
-EventMonitor::StartEventMonitor()
-{
-    DWORD status = ERROR_SUCCESS;
-    EVT_HANDLE hSubscription = NULL;
-    const LPWSTR pwsQuery = (LPWSTR)(L"*");
-    const DWORD eventsCount = 2;
-
-    EnableEventLogChannels();
-
-    //
-    // Order stop event first so that stop is prioritized if both events are already signalled (changes
-    // are available but stop has been called).
-    //
-    HANDLE aWaitHandles[eventsCount];
-
-    aWaitHandles[0] = m_stopEvent;
-
-    //
-    // Get a handle to a manual reset event object that the subscription will signal
-    // when events become available that match your query criteria.
-    //
-    HANDLE subscEvent = CreateEvent(NULL, TRUE, TRUE, NULL);
-    if(!subscEvent)
-    {
-        return GetLastError();
-    }
-    aWaitHandles[1] = subscEvent;
-
-    //
-    // Subscribe to events.
-    //
-    DWORD evtSubscribeFlags = this->m_startAtOldestRecord ?
-        EvtSubscribeStartAtOldestRecord : EvtSubscribeToFutureEvents;
-
-    hSubscription = EvtSubscribe(
-        NULL,
-        aWaitHandles[1],
-        NULL,
-        ConstructWindowsEventQuery(m_eventChannels).c_str(),
-        NULL,
-        NULL,
-        NULL,
-        evtSubscribeFlags
-    );
-
-    if (NULL == hSubscription)
-    {
-        status = GetLastError();
-
-        if (ERROR_EVT_CHANNEL_NOT_FOUND == status)
-            logWriter.TraceError(L"Failed to subscribe to event log channel. The specified event channel was not found.");
-        else if (ERROR_EVT_INVALID_QUERY == status)
-            logWriter.TraceError(
-                Utility::FormatString(
-                    L"Failed to subscribe to event log channel. Event query %s is not valid.",
-                    pwsQuery).c_str()
-            );
-        else
-            logWriter.TraceError(
-                Utility::FormatString(L"Failed to subscribe to event log channel. Error: %lu.", status).c_str()
-            );
-    }
-
-    if (status == ERROR_SUCCESS)
-    {
-        while (true)
-        {
-            DWORD wait = WaitForMultipleObjects(eventsCount, aWaitHandles, FALSE, INFINITE);
-
-            if (0 == wait - WAIT_OBJECT_0)  // Console input
-            {
-                break;
-            }
-            else if (1 == wait - WAIT_OBJECT_0) // Query results
-            {
-                if (ERROR_NO_MORE_ITEMS != (status = EnumerateResults(hSubscription)))
-                {
-                    break;
-                }
-
-                status = ERROR_SUCCESS;
-                ResetEvent(aWaitHandles[1]);
-            }
-            else
-            {
-                if (WAIT_FAILED == wait)
-                {
-                    logWriter.TraceError(
-                        Utility::FormatString(
-                            L"Failed to subscribe to event log channel. Wait operation on event handle failed. Error: %lu.",
-                            GetLastError()).c_str()
-                    );
-                }
-                break;
-            }
-        }
-    }
-
-    if (hSubscription)
-    {
-        EvtClose(hSubscription);
-    }
-
-    if(subscEvent)
-    {
-        CloseHandle(subscEvent);
-    }
-
-    return status;
-}
-
-
-///
-/// Constructs and returns an XML Query for Windows Event collection using the supplied parameters.
-///
-/// \param EventChannels         Supplies the event channels to query.
-///
-/// \return XML Query for Windows Event collection.
-///
-std::wstring
-EventMonitor::ConstructWindowsEventQuery(
-    _In_ const std::vector<EventLogChannel>& EventChannels
-    )
-{
-    //
-    // Construct the query
-    //
-    std::wstring query = LR"(<QueryList>)";
-    query += LR"(<Query Id="0" Path="System">)";
-
-    for (const auto& eventChannel : EventChannels)
-    {
-        //
-        // Construct the query portion for the log level
-        //
-        std::wstring logLevelQuery = L"";
-        logLevelQuery = L"(";
-
-        if (eventChannel.Level >= EventChannelLogLevel::Critical)
-        {
-            logLevelQuery += L"Level=1 or ";
-        }
-        if (eventChannel.Level >= EventChannelLogLevel::Error)
-        {
-            logLevelQuery += L"Level=2 or ";
-        }
-        if (eventChannel.Level >= EventChannelLogLevel::Warning)
-        {
-            logLevelQuery += L"Level=3 or ";
-        }
-        if (eventChannel.Level >= EventChannelLogLevel::Information)
-        {
-            logLevelQuery += L"Level=4 or ";
-        }
-        if (eventChannel.Level >= EventChannelLogLevel::Verbose)
-        {
-            logLevelQuery += L"Level=5 or ";
-        }
-
-        //
-        // Remove last ' or '
-        //
-        logLevelQuery.erase(logLevelQuery.size() - 4);
-        logLevelQuery += L")";
-
-        query += Utility::FormatString(
-            LR"(<Select Path="%s">*[System[%s)", eventChannel.Name.c_str(), logLevelQuery.c_str());
-
-        query += LR"(]]</Select>)";
-    }
-
-    query += LR"(</Query>)";
-    query += LR"(</QueryList>)";
-
-    return query;
-}
-
-
-///
-/// Enumerate the events in the result set.
-///
-/// \param EventChannels         The handle to the subscription that EvtSubscribe function returned.
-///
-/// \return A DWORD with a windows error value. If the function succeeded, it returns
-///     ERROR_SUCCESS.
-///
-DWORD
-EventMonitor::EnumerateResults(
-    _In_ EVT_HANDLE hResults
-    )
-{
-    DWORD status = ERROR_SUCCESS;
-    EVT_HANDLE hEvents[EVENT_ARRAY_SIZE];
-    DWORD dwReturned = 0;
-
-    while (true)
-    {
-        //
-        // Get a block of events from the result set.
-        //
-        if (!EvtNext(hResults, EVENT_ARRAY_SIZE, hEvents, INFINITE, 0, &dwReturned))
-        {
-            if (ERROR_NO_MORE_ITEMS != (status = GetLastError()))
-            {
-                logWriter.TraceError(
-                    Utility::FormatString(L"Failed to query next event. Error: %lu.", status).c_str()
-                );
-            }
-
-            goto cleanup;
-        }
-
-        //
-        // For each event, call the PrintEvent function which renders the
-        // event for display.
-        //
-        for (DWORD i = 0; i < dwReturned; i++)
-        {
-            status = PrintEvent(hEvents[i]);
-
-            if (ERROR_SUCCESS != status)
-            {
-                logWriter.TraceWarning(
-                    Utility::FormatString(
-                        L"Failed to render event log event. The event will not be processed. Error: %lu.",
-                        status
-                    ).c_str()
-                );
-                status = ERROR_SUCCESS;
-            }
-
-            EvtClose(hEvents[i]);
-            hEvents[i] = NULL;
-        }
-    }
-
-cleanup:
-
-    //
-    // Closes any events in case an error occurred above.
-    //
-    for (DWORD i = 0; i < dwReturned; i++)
-    {
-        if (NULL != hEvents[i])
-        {
-            EvtClose(hEvents[i]);
-        }
-    }
-
-    return status;
-}
-
-///
-/// Constructs an EventLog object with the contents of an event's value paths.
-///
-/// \param EventHandle  Supplies a handle to an event, used to extract value paths.
-/// \param AdditionalValuePaths  Supplies additional values to include in the returned EventLog object.
-///
-/// \return DWORD
-///
-DWORD
-EventMonitor::PrintEvent(
-    _In_ const HANDLE& EventHandle
-    )
-{
-    DWORD status = ERROR_SUCCESS;
-    DWORD bytesWritten = 0;
-    EVT_HANDLE renderContext = NULL;
-    EVT_HANDLE publisher = NULL;
-
-    static constexpr LPCWSTR defaultValuePaths[] = {
-        L"Event/System/Provider/@Name",
-        L"Event/System/Channel",
-        L"Event/System/EventID",
-        L"Event/System/Level",
-        L"Event/System/TimeCreated/@SystemTime",
-    };
-
-    static const std::vector<std::wstring> c_LevelToString =
-    {
-        L"Unknown",
-        L"Critical",
-        L"Error",
-        L"Warning",
-        L"Information",
-        L"Verbose",
-    };
-
-    static const DWORD defaultValuePathsCount = sizeof(defaultValuePaths) / sizeof(LPCWSTR);
-
-    try
-    {
-        //
-        // Construct the value paths that will be used to query the events
-        //
-        std::vector<LPCWSTR> valuePaths(defaultValuePaths, defaultValuePaths + defaultValuePathsCount);
-
-        //
-        // Collect event system properties
-        //
-        renderContext = EvtCreateRenderContext(
-            static_cast<DWORD>(valuePaths.size()),
-            &valuePaths[0],
-            EvtRenderContextValues
-        );
-
-        if (!renderContext)
-        {
-            return GetLastError();
-        }
-
-        DWORD propertyCount = 0;
-        DWORD bufferSize = 0;
-        std::vector<EVT_VARIANT> variants;
-
-        EvtRender(renderContext, EventHandle, EvtRenderEventValues, 0, nullptr, &bufferSize, &propertyCount);
-        if (ERROR_INVALID_HANDLE == GetLastError())
-        {
-            status = ERROR_INVALID_HANDLE;
-        }
-
-        status = GetLastError();
-        if (ERROR_INSUFFICIENT_BUFFER == status || ERROR_EVT_UNRESOLVED_VALUE_INSERT == status)
-        {
-            status = ERROR_SUCCESS;
-        }
-
-        if (status == ERROR_SUCCESS)
-        {
-            //
-            // Allocate more memory to accommodate modulus
-            //
-            variants.resize((bufferSize / sizeof(EVT_VARIANT)) + 1, EVT_VARIANT{});
-            if(!EvtRender(
-                renderContext,
-                EventHandle,
-                EvtRenderEventValues,
-                bufferSize,
-                &variants[0],
-                &bufferSize,
-                &propertyCount))
-            {
-                status = GetLastError();
-
-                logWriter.TraceError(
-                    Utility::FormatString(L"Failed to render event. Error: %lu", status).c_str()
-                );
-            }
-        }
-
-        if (status == ERROR_SUCCESS)
-        {
-            //
-            // Extract the variant values for each queried property. If the variant failed to get a valid type
-            // set a default value.
-            //
-            std::wstring providerName = (EvtVarTypeString != variants[0].Type) ? L"" : variants[0].StringVal;
-            std::wstring channelName = (EvtVarTypeString != variants[1].Type) ? L"" : variants[1].StringVal;
-            UINT16 eventId = (EvtVarTypeUInt16 != variants[2].Type) ? 0 : variants[2].UInt16Val;
-            UINT8 level = (EvtVarTypeByte != variants[3].Type) ? 0 : variants[3].ByteVal;
-            ULARGE_INTEGER fileTimeAsInt{};
-            fileTimeAsInt.QuadPart = (EvtVarTypeFileTime != variants[4].Type) ? 0 : variants[4].FileTimeVal;
-            FILETIME fileTimeCreated{
-                fileTimeAsInt.LowPart,
-                fileTimeAsInt.HighPart
-            };
-
-            //
-            // Collect user message
-            //
-            publisher = EvtOpenPublisherMetadata(nullptr, providerName.c_str(), nullptr, 0, 0);
-
-            if (publisher)
-            {
-                EvtFormatMessage(publisher, EventHandle, 0, 0, nullptr, EvtFormatMessageEvent, 0, nullptr, &bufferSize);
-                status = GetLastError();
-
-                if (status != ERROR_EVT_MESSAGE_NOT_FOUND)
-                {
-                    if (ERROR_INSUFFICIENT_BUFFER == status || ERROR_EVT_UNRESOLVED_VALUE_INSERT == status)
-                    {
-                        status = ERROR_SUCCESS;
-                    }
-
-                    if (m_eventMessageBuffer.capacity() < bufferSize)
-                    {
-                        m_eventMessageBuffer.resize(bufferSize);
-                    }
-
-                    if (!EvtFormatMessage(
-                        publisher,
-                        EventHandle,
-                        0,
-                        0,
-                        nullptr,
-                        EvtFormatMessageEvent,
-                        bufferSize,
-                        &m_eventMessageBuffer[0],
-                        &bufferSize))
-                    {
-                        status = GetLastError();
-                    }
-                }
-                else
-                {
-                    status = ERROR_SUCCESS;
-                }
-            }
-
-            if (status == ERROR_SUCCESS)
-            {
-                std::wstring formattedEvent = Utility::FormatString(
-                    L"<Source>EventLog</Source><Time>%s</Time><LogEntry><Channel>%s</Channel><Level>%s</Level><EventId>%u</EventId><Message>%s</Message></LogEntry>",
-                    Utility::FileTimeToString(fileTimeCreated).c_str(),
-                    channelName.c_str(),
-                    c_LevelToString[static_cast<UINT8>(level)].c_str(),
-                    eventId,
-                    (LPWSTR)(&m_eventMessageBuffer[0])
-                );
-
-                //
-                // If the multi-line option is disabled, remove all new lines from the output.
-                //
-                if (!this->m_eventFormatMultiLine)
-                {
-                    std::transform(formattedEvent.begin(), formattedEvent.end(), formattedEvent.begin(),
-                        [](WCHAR ch) {
-                            switch (ch) {
-                            case L'\r':
-                            case L'\n':
-                                return L' ';
-                            }
-                            return ch;
-                        });
-                }
-
-                logWriter.WriteConsoleLog(formattedEvent);
-            }
-        }
-    }
-    catch(...)
-    {
-        logWriter.TraceWarning(L"Failed to render event log event. The event will not be processed.");
-    }
-
-    if (publisher)
-    {
-        EvtClose(publisher);
-    }
-
-    if (renderContext)
-    {
-        EvtClose(renderContext);
-    }
-
-    return status;
-}
-
-
-/// Enables all monitored event log channels.
-///
-/// \return None
-///
-void
-EventMonitor::EnableEventLogChannels()
-{
-    for (const auto& eventChannel : m_eventChannels)
-    {
-        EnableEventLogChannel(eventChannel.Name.c_str());
-    }
-}
-
-
-/// Enables or disables an Event Log channel.
-///
-/// \param ChannelPath  Full path to the event log channel.
-///
-/// \return None
-///
-void
-EventMonitor::EnableEventLogChannel(
-    _In_ LPCWSTR ChannelPath
-    )
-{
-    DWORD       status = ERROR_SUCCESS;
-    EVT_HANDLE  channelConfig = NULL;
-    EVT_VARIANT propValue;
-    DWORD dwPropValSize;
-
-    //
-    // Open the channel configuration.
-    //
-    channelConfig = EvtOpenChannelConfig(NULL, ChannelPath, 0);
-    if (NULL == channelConfig)
-    {
-        status = GetLastError();
-        goto Exit;
-    }
-
-    if (EvtGetChannelConfigProperty(channelConfig,
-        EvtChannelConfigEnabled,
-        0,
-        sizeof(EVT_VARIANT),
-        &propValue,
-        &dwPropValSize))
-    {
-        //
-        // Return if event channel is already enabled.
-        //
-        if (propValue.BooleanVal)
-        {
-            goto Exit;
-        }
-    }
-    else
-    {
-        status = GetLastError();
-        logWriter.TraceError(
-            Utility::FormatString(
-                L"Failed to query event channel configuration. Channel: %ws Error: 0x%X",
-                ChannelPath,
-                status
-            ).c_str()
-        );
-    }
-
-    //
-    // Set the Enabled property.
-    //
-    propValue.Type = EvtVarTypeBoolean;
-    propValue.Count = 1;
-    propValue.BooleanVal = true;
-
-    if (!EvtSetChannelConfigProperty(
-        channelConfig,
-        EvtChannelConfigEnabled,
-        0,
-        &propValue
-    ))
-    {
-        status = GetLastError();
-        goto Exit;
-    }
-
-    //
-    // Save changes.
-    //
-    if (!EvtSaveChannelConfig(channelConfig, 0))
-    {
-        status = GetLastError();
-        if (status == ERROR_EVT_INVALID_OPERATION_OVER_ENABLED_DIRECT_CHANNEL)
-        {
-            //
-            // The channel is already enabled.
-            //
-            status = ERROR_SUCCESS;
-        }
-        else
-        {
-            goto Exit;
-        }
-    }
-
-    status = ERROR_SUCCESS;
-
-Exit:
-
-    if (ERROR_SUCCESS != status)
-    {
-        logWriter.TraceError(
-            Utility::FormatString(L"Failed to enable event channel %ws: 0x%X", ChannelPath, status).c_str()
-        );
-    }
-
-    if (channelConfig != NULL)
-    {
-        EvtClose(channelConfig);
-    }
-}
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+
+#include "pch.h"
+
+using namespace std;
+
+
+///
+/// EventMonitor.cpp
+///
+/// Monitors a event log for new events in specified channels.
+///
+/// EventMonitor starts a monitor thread that waits for events from EvtSubscribe
+/// or for a stop event to be set. The same thread processes the changes and invokes the callback.
+/// Note: The constructor blocks until the spawned thread starts listening for changes or dies.
+///
+/// The destructor signals the stop event and waits up to MONITOR_THREAD_EXIT_MAX_WAIT_MILLIS for the monitoring
+/// thread to exit. To prevent the thread from out-living EventMonitor, the destructor fails fast
+/// if the wait fails or times out. This also ensures the callback is not being called and will not be
+/// called once EventMonitor is destroyed.
+///
+
+
+EventMonitor::EventMonitor(
+    _In_ const std::vector<EventLogChannel>& EventChannels,
+    _In_ bool EventFormatMultiLine,
+    _In_ bool StartAtOldestRecord
+    ) :
+    m_eventChannels(EventChannels),
+    m_eventFormatMultiLine(EventFormatMultiLine),
+    m_startAtOldestRecord(StartAtOldestRecord),
+    m_eventRenderer(m_eventLogApi),
+    m_publisherMetadata(m_eventLogApi)
+{
+    m_stopEvent = NULL;
+    m_eventMonitorThread = NULL;
+
+    m_stopEvent = CreateEvent(nullptr, TRUE, FALSE, nullptr);
+
+    if (!m_stopEvent)
+    {
+        throw std::system_error(std::error_code(GetLastError(), std::system_category()), "CreateEvent");
+    }
+
+    m_eventMonitorThread = CreateThread(
+        nullptr,
+        0,
+        (LPTHREAD_START_ROUTINE)&EventMonitor::StartEventMonitorStatic,
+        this,
+        0,
+        nullptr
+    );
+
+    if (!m_eventMonitorThread)
+    {
+        throw std::system_error(std::error_code(GetLastError(), std::system_category()), "CreateThread");
+    }
+}
+
+EventMonitor::~EventMonitor()
+{
+    if (!SetEvent(m_stopEvent))
+    {
+        logWriter.TraceError(
+            FORMAT_STRING(L"Failed to gracefully stop event log monitor %lu", GetLastError()).c_str()
+        );
+    }
+    else
+    {
+        //
+        // Wait for watch thread to exit.
+        //
+        DWORD waitResult = WaitForSingleObject(m_eventMonitorThread, EVENT_MONITOR_THREAD_EXIT_MAX_WAIT_MILLIS);
+
+        if (waitResult != WAIT_OBJECT_0)
+        {
+            HRESULT hr = (waitResult == WAIT_FAILED) ? HRESULT_FROM_WIN32(GetLastError())
+                                                           : HRESULT_FROM_WIN32(waitResult);
+        }
+    }
+
+    if (!m_eventMonitorThread)
+    {
+        CloseHandle(m_eventMonitorThread);
+    }
+
+    if (!m_stopEvent)
+    {
+        CloseHandle(m_stopEvent);
+    }
+}
+
+///
+/// Entry for the spawned event monitor thread.
+///
+/// \param Context Callback context to the event monitor thread.
+///                It's EventMonitor object that started this thread.
+///
+/// \return Status of event monitoring operation.
+///
+DWORD
+EventMonitor::StartEventMonitorStatic(
+    _In_ LPVOID Context
+    )
+{
+    auto pThis = reinterpret_cast<EventMonitor*>(Context);
+    try
+    {
+        DWORD status = pThis->StartEventMonitor();
+        if (status != ERROR_SUCCESS)
+        {
+            logWriter.TraceError(
+                FORMAT_STRING(L"Failed to start event log monitor. Error: %lu", status).c_str()
+            );
+        }
+        return status;
+    }
+    catch (std::exception& ex)
+    {
+        logWriter.TraceError(
+            FORMAT_STRING(L"Failed to start event log monitor. %S", ex.what()).c_str()
+        );
+        return E_FAIL;
+    }
+    catch (...)
+    {
+        logWriter.TraceError(
+            L"Failed to start event log monitor. Unknown error occurred."
+        );
+        return E_FAIL;
+    }
+}
+
+
+///
+/// Entry for the spawned event monitor thread. Loops to wait for either the stop event in which case it exits
+/// or for events to be arrived. When new events are arrived, it invokes the callback, resets,
+/// and starts the wait again.
+///
+/// \return Status of event monitoring operation.
+///
+DWORD
+EventMonitor::StartEventMonitor()
+{
+    DWORD status = ERROR_SUCCESS;
+    EVT_HANDLE hSubscription = NULL;
+    const LPWSTR pwsQuery = (LPWSTR)(L"*");
+    const DWORD eventsCount = 2;
+
+    EnableEventLogChannels();
+
+    //
+    // Order stop event first so that stop is prioritized if both events are already signalled (changes
+    // are available but stop has been called).
+    //
+    HANDLE aWaitHandles[eventsCount];
+
+    aWaitHandles[0] = m_stopEvent;
+
+    //
+    // Get a handle to a manual reset event object that the subscription will signal
+    // when events become available that match your query criteria.
+    //
+    HANDLE subscEvent = CreateEvent(NULL, TRUE, TRUE, NULL);
+    if(!subscEvent)
+    {
+        return GetLastError();
+    }
+    aWaitHandles[1] = subscEvent;
+
+    //
+    // Subscribe to events.
+    //
+    DWORD evtSubscribeFlags = this->m_startAtOldestRecord ?
+        EvtSubscribeStartAtOldestRecord : EvtSubscribeToFutureEvents;
+
+    hSubscription = EvtSubscribe(
+        NULL,
+        aWaitHandles[1],
+        NULL,
+        ConstructWindowsEventQuery(m_eventChannels).c_str(),
+        NULL,
+        NULL,
+        NULL,
+        evtSubscribeFlags
+    );
+
+    if (NULL == hSubscription)
+    {
+        status = GetLastError();
+
+        if (ERROR_EVT_CHANNEL_NOT_FOUND == status)
+            logWriter.TraceError(L"Failed to subscribe to event log channel. The specified event channel was not found.");
+        else if (ERROR_EVT_INVALID_QUERY == status)
+            logWriter.TraceError(
+                FORMAT_STRING(
+                    L"Failed to subscribe to event log channel. Event query %s is not valid.",
+                    pwsQuery).c_str()
+            );
+        else
+            logWriter.TraceError(
+                FORMAT_STRING(L"Failed to subscribe to event log channel. Error: %lu.", status).c_str()
+            );
+    }
+
+    if (status == ERROR_SUCCESS)
+    {
+        while (true)
+        {
+            DWORD wait = WaitForMultipleObjects(eventsCount, aWaitHandles, FALSE, INFINITE);
+
+            if (0 == wait - WAIT_OBJECT_0)  // Console input
+            {
+                break;
+            }
+            else if (1 == wait - WAIT_OBJECT_0) // Query results
+            {
+                if (ERROR_NO_MORE_ITEMS != (status = EnumerateResults(hSubscription)))
+                {
+                    break;
+                }
+
+                status = ERROR_SUCCESS;
+                ResetEvent(aWaitHandles[1]);
+            }
+            else
+            {
+                if (WAIT_FAILED == wait)
+                {
+                    logWriter.TraceError(
+                        FORMAT_STRING(
+                            L"Failed to subscribe to event log channel. Wait operation on event handle failed. Error: %lu.",
+                            GetLastError()).c_str()
+                    );
+                }
+                break;
+            }
+        }
+    }
+
+    if (hSubscription)
+    {
+        EvtClose(hSubscription);
+    }
+
+    if (m_publisherMetadata.GetHits() + m_publisherMetadata.GetMisses() > 0)
+    {
+        logWriter.TraceInfo(
+            FORMAT_STRING(
+                L"Event log monitor stopped. Publisher metadata cache: %llu hits, %llu misses, %llu evictions.",
+                m_publisherMetadata.GetHits(),
+                m_publisherMetadata.GetMisses(),
+                m_publisherMetadata.GetEvictions()
+            ).c_str()
+        );
+    }
+
+    if(subscEvent)
+    {
+        CloseHandle(subscEvent);
+    }
+
+    return status;
+}
+
+
+///
+/// Constructs and returns an XML Query for Windows Event collection using the supplied parameters.
+///
+/// \param EventChannels         Supplies the event channels to query.
+///
+/// \return XML Query for Windows Event collection.
+///
+std::wstring
+EventMonitor::ConstructWindowsEventQuery(
+    _In_ const std::vector<EventLogChannel>& EventChannels
+    )
+{
+    //
+    // Construct the query
+    //
+    std::wstring query = LR"(<QueryList>)";
+    query += LR"(<Query Id="0" Path="System">)";
+
+    for (const auto& eventChannel : EventChannels)
+    {
+        //
+        // Construct the query portion for the log level
+        //
+        std::wstring logLevelQuery = L"";
+        logLevelQuery = L"(";
+
+        if (eventChannel.Level >= EventChannelLogLevel::Critical)
+        {
+            logLevelQuery += L"Level=1 or ";
+        }
+        if (eventChannel.Level >= EventChannelLogLevel::Error)
+        {
+            logLevelQuery += L"Level=2 or ";
+        }
+        if (eventChannel.Level >= EventChannelLogLevel::Warning)
+        {
+            logLevelQuery += L"Level=3 or ";
+        }
+        if (eventChannel.Level >= EventChannelLogLevel::Information)
+        {
+            logLevelQuery += L"Level=4 or ";
+        }
+        if (eventChannel.Level >= EventChannelLogLevel::Verbose)
+        {
+            logLevelQuery += L"Level=5 or ";
+        }
+
+        //
+        // Remove last ' or '
+        //
+        logLevelQuery.erase(logLevelQuery.size() - 4);
+        logLevelQuery += L")";
+
+        query += FORMAT_STRING(
+            LR"(<Select Path="%s">*[System[%s)", eventChannel.Name.c_str(), logLevelQuery.c_str());
+
+        query += LR"(]]</Select>)";
+    }
+
+    query += LR"(</Query>)";
+    query += LR"(</QueryList>)";
+
+    return query;
+}
+
+
+///
+/// Enumerate the events in the result set.
+///
+/// \param EventChannels         The handle to the subscription that EvtSubscribe function returned.
+///
+/// \return A DWORD with a windows error value. If the function succeeded, it returns
+///     ERROR_SUCCESS.
+///
+DWORD
+EventMonitor::EnumerateResults(
+    _In_ EVT_HANDLE hResults
+    )
+{
+    DWORD status = ERROR_SUCCESS;
+    EVT_HANDLE hEvents[EVENT_ARRAY_SIZE];
+    DWORD dwReturned = 0;
+
+    while (true)
+    {
+        //
+        // Get a block of events from the result set.
+        //
+        if (!EvtNext(hResults, EVENT_ARRAY_SIZE, hEvents, INFINITE, 0, &dwReturned))
+        {
+            if (ERROR_NO_MORE_ITEMS != (status = GetLastError()))
+            {
+                logWriter.TraceError(
+                    FORMAT_STRING(L"Failed to query next event. Error: %lu.", status).c_str()
+                );
+            }
+
+            goto cleanup;
+        }
+
+        //
+        // For each event, call the PrintEvent function which renders the
+        // event for display.
+        //
+        for (DWORD i = 0; i < dwReturned; i++)
+        {
+            status = PrintEvent(hEvents[i]);
+
+            if (ERROR_SUCCESS != status)
+            {
+                logWriter.TraceWarning(
+                    FORMAT_STRING(
+                        L"Failed to render event log event. The event will not be processed. Error: %lu.",
+                        status
+                    ).c_str()
+                );
+                status = ERROR_SUCCESS;
+            }
+
+            EvtClose(hEvents[i]);
+            hEvents[i] = NULL;
+        }
+    }
+
+cleanup:
+
+    //
+    // Closes any events in case an error occurred above.
+    //
+    for (DWORD i = 0; i < dwReturned; i++)
+    {
+        if (NULL != hEvents[i])
+        {
+            EvtClose(hEvents[i]);
+        }
+    }
+
+    return status;
+}
+
+///
+/// Constructs an EventLog object with the contents of an event's value paths.
+///
+/// \param EventHandle  Supplies a handle to an event, used to extract value paths.
+/// \param AdditionalValuePaths  Supplies additional values to include in the returned EventLog object.
+///
+/// \return DWORD
+///
+DWORD
+EventMonitor::PrintEvent(
+    _In_ const HANDLE& EventHandle
+    )
+{
+    DWORD status = ERROR_SUCCESS;
+    DWORD bufferSize = 0;
+
+    static const std::vector<std::wstring> c_LevelToString =
+    {
+        L"Unknown",
+        L"Critical",
+        L"Error",
+        L"Warning",
+        L"Information",
+        L"Verbose",
+    };
+
+    try
+    {
+        //
+        // Collect event system properties
+        //
+        EventSystemValues values;
+
+        status = m_eventRenderer.Render(EventHandle, values);
+
+        if (status != ERROR_SUCCESS)
+        {
+            logWriter.TraceError(
+                FORMAT_STRING(L"Failed to render event. Error: %lu", status).c_str()
+            );
+        }
+
+        if (status == ERROR_SUCCESS)
+        {
+            //
+            // Collect user message
+            //
+            EVT_HANDLE publisher = m_publisherMetadata.Get(values.ProviderName);
+
+            if (publisher)
+            {
+                EvtFormatMessage(publisher, EventHandle, 0, 0, nullptr, EvtFormatMessageEvent, 0, nullptr, &bufferSize);
+                status = GetLastError();
+
+                if (status != ERROR_EVT_MESSAGE_NOT_FOUND)
+                {
+                    if (ERROR_INSUFFICIENT_BUFFER == status || ERROR_EVT_UNRESOLVED_VALUE_INSERT == status)
+                    {
+                        status = ERROR_SUCCESS;
+                    }
+
+                    if (m_eventMessageBuffer.capacity() < bufferSize)
+                    {
+                        m_eventMessageBuffer.resize(bufferSize);
+                    }
+
+                    if (!EvtFormatMessage(
+                        publisher,
+                        EventHandle,
+                        0,
+                        0,
+                        nullptr,
+                        EvtFormatMessageEvent,
+                        bufferSize,
+                        &m_eventMessageBuffer[0],
+                        &bufferSize))
+                    {
+                        status = GetLastError();
+                    }
+                }
+                else
+                {
+                    status = ERROR_SUCCESS;
+                }
+            }
+
+            if (status == ERROR_SUCCESS)
+            {
+                const LPCWSTR levelName = (values.Level < c_LevelToString.size())
+                    ? c_LevelToString[values.Level].c_str()
+                    : c_LevelToString[0].c_str();
+                const LPCWSTR message = m_eventMessageBuffer.empty() ? L"" : &m_eventMessageBuffer[0];
+
+                m_outputLine.clear();
+
+                if (logWriter.GetOutputFormat() == OutputFormat::Json)
+                {
+                    FormatEventJson(m_outputLine, values.TimeCreated, values.ChannelName, levelName, values.EventId, message);
+                }
+                else
+                {
+                    m_eventLine.clear();
+
+                    FormatEventXml(
+                        m_eventLine,
+                        values.TimeCreated,
+                        values.ChannelName,
+                        levelName,
+                        values.EventId,
+                        message,
+                        m_eventFormatMultiLine);
+
+                    Utility::AppendUtf8(m_outputLine, m_eventLine.data(), m_eventLine.size());
+                }
+
+                logWriter.WriteConsoleLog(std::move(m_outputLine), GetOutputSourceId(values.ChannelName));
+            }
+        }
+    }
+    catch(...)
+    {
+        logWriter.TraceWarning(L"Failed to render event log event. The event will not be processed.");
+    }
+
+    return status;
+}
+
+///
+/// Returns the LogWriter source of the events of a channel, so each EventLog
+/// source has its own overflow policy and rate limit.
+///
+/// \param ChannelName  Name of the channel of the event.
+///
+/// \return The source of the channel, or the one of the first channel if the
+///     event's channel isn't one of the configured ones.
+///
+UINT32
+EventMonitor::GetOutputSourceId(
+    _In_ LPCWSTR ChannelName
+    ) const
+{
+    for (const auto& channel : m_eventChannels)
+    {
+        if (_wcsicmp(channel.Name.c_str(), ChannelName) == 0)
+        {
+            return channel.OutputSourceId;
+        }
+    }
+
+    return m_eventChannels.empty()
+        ? LogWriter::LOGMONITOR_SOURCE_ID
+        : m_eventChannels[0].OutputSourceId;
+}
+
+///
+/// Formats an event in the XML format, appended to Buffer.
+///
+/// \param Buffer       The buffer where the event is appended.
+/// \param TimeCreated  Time the event was created.
+/// \param ChannelName  Channel of the event.
+/// \param Level        Name of the level of the event.
+/// \param EventId      Id of the event.
+/// \param Message      Message of the event.
+/// \param MultiLine    If false, the line breaks of the message are replaced
+///                     by spaces.
+///
+void
+EventMonitor::FormatEventXml(
+    _Inout_ std::wstring& Buffer,
+    _In_ const FILETIME& TimeCreated,
+    _In_ LPCWSTR ChannelName,
+    _In_ LPCWSTR Level,
+    _In_ UINT16 EventId,
+    _In_ LPCWSTR Message,
+    _In_ bool MultiLine
+    )
+{
+    const size_t start = Buffer.size();
+
+    Buffer.append(L"<Source>EventLog</Source><Time>");
+    TimestampFormatter::ForCurrentThread().Append(Buffer, TimeCreated);
+
+    APPEND_FORMAT(
+        Buffer,
+        L"</Time><LogEntry><Channel>%s</Channel><Level>%s</Level><EventId>%u</EventId><Message>%s</Message></LogEntry>",
+        ChannelName,
+        Level,
+        EventId,
+        Message
+    );
+
+    //
+    // If the multi-line option is disabled, remove all new lines from the output.
+    //
+    if (!MultiLine)
+    {
+        std::transform(Buffer.begin() + start, Buffer.end(), Buffer.begin() + start,
+            [](WCHAR ch) {
+                switch (ch) {
+                case L'\r':
+                case L'\n':
+                    return L' ';
+                }
+                return ch;
+            });
+    }
+}
+
+///
+/// Formats an event as a JSON object, appended to Buffer. The line breaks
+/// of the message are escaped, so the object is always a single line.
+///
+/// \param Buffer       The UTF-8 buffer where the object is appended.
+/// \param TimeCreated  Time the event was created.
+/// \param ChannelName  Channel of the event.
+/// \param Level        Name of the level of the event.
+/// \param EventId      Id of the event.
+/// \param Message      Message of the event.
+///
+void
+EventMonitor::FormatEventJson(
+    _Inout_ std::string& Buffer,
+    _In_ const FILETIME& TimeCreated,
+    _In_ LPCWSTR ChannelName,
+    _In_ LPCWSTR Level,
+    _In_ UINT16 EventId,
+    _In_ LPCWSTR Message
+    )
+{
+    JsonLineWriter json(Buffer);
+
+    json.BeginObject();
+    json.Key("Source");
+    json.String("EventLog");
+    json.Key("LogEntry");
+    json.BeginObject();
+    json.Key("Time");
+    json.Time(TimeCreated);
+    json.Key("Channel");
+    json.String(ChannelName);
+    json.Key("Level");
+    json.String(Level);
+    json.Key("EventId");
+    json.Number(EventId);
+    json.Key("Message");
+    json.String(Message);
+    json.EndObject();
+    json.EndObject();
+}
+
+
+/// Enables all monitored event log channels.
+///
+/// \return None
+///
+void
+EventMonitor::EnableEventLogChannels()
+{
+    for (const auto& eventChannel : m_eventChannels)
+    {
+        EnableEventLogChannel(eventChannel.Name.c_str());
+    }
+}
+
+
+/// Enables or disables an Event Log channel.
+///
+/// \param ChannelPath  Full path to the event log channel.
+///
+/// \return None
+///
+void
+EventMonitor::EnableEventLogChannel(
+    _In_ LPCWSTR ChannelPath
+    )
+{
+    DWORD       status = ERROR_SUCCESS;
+    EVT_HANDLE  channelConfig = NULL;
+    EVT_VARIANT propValue;
+    DWORD dwPropValSize;
+
+    //
+    // Open the channel configuration.
+    //
+    channelConfig = EvtOpenChannelConfig(NULL, ChannelPath, 0);
+    if (NULL == channelConfig)
+    {
+        status = GetLastError();
+        goto Exit;
+    }
+
+    if (EvtGetChannelConfigProperty(channelConfig,
+        EvtChannelConfigEnabled,
+        0,
+        sizeof(EVT_VARIANT),
+        &propValue,
+        &dwPropValSize))
+    {
+        //
+        // Return if event channel is already enabled.
+        //
+        if (propValue.BooleanVal)
+        {
+            goto Exit;
+        }
+    }
+    else
+    {
+        status = GetLastError();
+        logWriter.TraceError(
+            FORMAT_STRING(
+                L"Failed to query event channel configuration. Channel: %ws Error: 0x%X",
+                ChannelPath,
+                status
+            ).c_str()
+        );
+    }
+
+    //
+    // Set the Enabled property.
+    //
+    propValue.Type = EvtVarTypeBoolean;
+    propValue.Count = 1;
+    propValue.BooleanVal = true;
+
+    if (!EvtSetChannelConfigProperty(
+        channelConfig,
+        EvtChannelConfigEnabled,
+        0,
+        &propValue
+    ))
+    {
+        status = GetLastError();
+        goto Exit;
+    }
+
+    //
+    // Save changes.
+    //
+    if (!EvtSaveChannelConfig(channelConfig, 0))
+    {
+        status = GetLastError();
+        if (status == ERROR_EVT_INVALID_OPERATION_OVER_ENABLED_DIRECT_CHANNEL)
+        {
+            //
+            // The channel is already enabled.
+            //
+            status = ERROR_SUCCESS;
+        }
+        else
+        {
+            goto Exit;
+        }
+    }
+
+    status = ERROR_SUCCESS;
+
+Exit:
+
+    if (ERROR_SUCCESS != status)
+    {
+        logWriter.TraceError(
+            FORMAT_STRING(L"Failed to enable event channel %ws: 0x%X", ChannelPath, status).c_str()
+        );
+    }
+
+    if (channelConfig != NULL)
+    {
+        EvtClose(channelConfig);
+    }
+}
@@ -1,62 +1,105 @@
-//
-// Copyright (c) Microsoft Corporation.
-// Licensed under the MIT license.
-//
-
-#pragma once
-
-class EventMonitor final
-{
-public:
-    EventMonitor() = delete;
-
-    EventMonitor(
-        _In_ const std::vector<EventLogChannel>& eventChannels,
-        _In_ bool EventFormatMultiLine,
-        _In_ bool StartAtOldestRecord
-        );
-
-    ~EventMonitor();
-
-private:
-    static constexpr int EVENT_MONITOR_THREAD_EXIT_MAX_WAIT_MILLIS = 5 * 1000;
-    static constexpr int EVENT_ARRAY_SIZE = 10;
-
-    const std::vector<EventLogChannel> m_eventChannels;
-    bool m_eventFormatMultiLine;
-    bool m_startAtOldestRecord;
-
-    //
-    // Signaled by destructor to request the spawned thread to stop.
-    //
-    HANDLE m_stopEvent;
-
-    //
-    // Handle to an event subscriber thread.
-    //
-    HANDLE m_eventMonitorThread;
-
-    std::vector<wchar_t> m_eventMessageBuffer;
-
-    DWORD StartEventMonitor();
-
-    static DWORD StartEventMonitorStatic(
-        _In_ LPVOID Context
-        );
-
-    std::wstring ConstructWindowsEventQuery(
-        _In_ const std::vector<EventLogChannel>& EventChannels
-        );
-
-    DWORD EnumerateResults(
-        _In_ EVT_HANDLE ResultsHandle
-        );
-
-    DWORD PrintEvent(
-        _In_ const HANDLE& EventHandle
-        );
-
-    void EnableEventLogChannels();
-
-    static void EnableEventLogChannel(_In_ LPCWSTR ChannelPath);
-};
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+
+#pragma once
+
+class EventMonitor final
+{
+public:
+    EventMonitor() = delete;
+
+    EventMonitor(
+        _In_ const std::vector<EventLogChannel>& eventChannels,
+        _In_ bool EventFormatMultiLine,
+        _In_ bool StartAtOldestRecord
+        );
+
+    ~EventMonitor();
+
+    static void FormatEventXml(
+        _Inout_ std::wstring& Buffer,
+        _In_ const FILETIME& TimeCreated,
+        _In_ LPCWSTR ChannelName,
+        _In_ LPCWSTR Level,
+        _In_ UINT16 EventId,
+        _In_ LPCWSTR Message,
+        _In_ bool MultiLine
+        );
+
+    static void FormatEventJson(
+        _Inout_ std::string& Buffer,
+        _In_ const FILETIME& TimeCreated,
+        _In_ LPCWSTR ChannelName,
+        _In_ LPCWSTR Level,
+        _In_ UINT16 EventId,
+        _In_ LPCWSTR Message
+        );
+
+private:
+    static constexpr int EVENT_MONITOR_THREAD_EXIT_MAX_WAIT_MILLIS = 5 * 1000;
+    static constexpr int EVENT_ARRAY_SIZE = 10;
+
+    const std::vector<EventLogChannel> m_eventChannels;
+    bool m_eventFormatMultiLine;
+    bool m_startAtOldestRecord;
+
+    //
+    // Signaled by destructor to request the spawned thread to stop.
+    //
+    HANDLE m_stopEvent;
+
+    //
+    // Handle to an event subscriber thread.
+    //
+    HANDLE m_eventMonitorThread;
+
+    //
+    // Renders the system values of the events. The render context and the
+    // buffer of the variants are kept between the events.
+    //
+    Win32EventLogApi m_eventLogApi;
+    EventRenderer m_eventRenderer;
+
+    //
+    // Metadata handles of the providers of the events, used to format their
+    // messages.
+    //
+    PublisherMetadataCache m_publisherMetadata;
+
+    std::vector<wchar_t> m_eventMessageBuffer;
+
+    //
+    // Buffers of the formatted events, reused between events. The LogWriter
+    // gives back the buffer of an earlier line when one is written.
+    //
+    std::wstring m_eventLine;
+    std::string m_outputLine;
+
+    DWORD StartEventMonitor();
+
+    static DWORD StartEventMonitorStatic(
+        _In_ LPVOID Context
+        );
+
+    std::wstring ConstructWindowsEventQuery(
+        _In_ const std::vector<EventLogChannel>& EventChannels
+        );
+
+    DWORD EnumerateResults(
+        _In_ EVT_HANDLE ResultsHandle
+        );
+
+    DWORD PrintEvent(
+        _In_ const HANDLE& EventHandle
+        );
+
+    UINT32 GetOutputSourceId(
+        _In_ LPCWSTR ChannelName
+        ) const;
+
+    void EnableEventLogChannels();
+
+    static void EnableEventLogChannel(_In_ LPCWSTR ChannelPath);
+};
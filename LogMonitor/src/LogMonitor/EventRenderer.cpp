@@ -0,0 +1,280 @@
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+
+#include "pch.h"
+
+/// EventRenderer.cpp
+///
+/// Defines a class to render the system values of the events, with a render
+/// context and a buffer kept between them, and a cache of the metadata of
+/// their providers.
+///
+
+constexpr size_t EventRenderer::INITIAL_VARIANTS_COUNT;
+constexpr size_t PublisherMetadataCache::DEFAULT_CAPACITY;
+
+//
+// Paths of the values of EventSystemValues, in the order of the variants.
+//
+static LPCWSTR c_eventSystemValuePaths[] = {
+    L"Event/System/Provider/@Name",
+    L"Event/System/Channel",
+    L"Event/System/EventID",
+    L"Event/System/Level",
+    L"Event/System/TimeCreated/@SystemTime",
+};
+
+static constexpr DWORD c_eventSystemValuePathsCount =
+    sizeof(c_eventSystemValuePaths) / sizeof(c_eventSystemValuePaths[0]);
+
+EVT_HANDLE
+Win32EventLogApi::CreateRenderContext(
+    _In_ DWORD ValuePathsCount,
+    _In_reads_(ValuePathsCount) LPCWSTR* ValuePaths,
+    _In_ DWORD Flags,
+    _Out_ DWORD& Status
+    )
+{
+    EVT_HANDLE context = EvtCreateRenderContext(ValuePathsCount, ValuePaths, Flags);
+
+    Status = context ? ERROR_SUCCESS : GetLastError();
+
+    return context;
+}
+
+DWORD
+Win32EventLogApi::Render(
+    _In_ EVT_HANDLE Context,
+    _In_ EVT_HANDLE Fragment,
+    _In_ DWORD Flags,
+    _In_ DWORD BufferSize,
+    _Out_writes_bytes_to_opt_(BufferSize, *BufferUsed) PVOID Buffer,
+    _Out_ PDWORD BufferUsed,
+    _Out_ PDWORD PropertyCount
+    )
+{
+    if (!EvtRender(Context, Fragment, Flags, BufferSize, Buffer, BufferUsed, PropertyCount))
+    {
+        return GetLastError();
+    }
+
+    return ERROR_SUCCESS;
+}
+
+EVT_HANDLE
+Win32EventLogApi::OpenPublisherMetadata(
+    _In_ LPCWSTR PublisherId,
+    _Out_ DWORD& Status
+    )
+{
+    EVT_HANDLE publisher = EvtOpenPublisherMetadata(nullptr, PublisherId, nullptr, 0, 0);
+
+    Status = publisher ? ERROR_SUCCESS : GetLastError();
+
+    return publisher;
+}
+
+void
+Win32EventLogApi::Close(
+    _In_ EVT_HANDLE Object
+    )
+{
+    EvtClose(Object);
+}
+
+EventRenderer::EventRenderer(
+    _In_ EventLogApi& Api
+    ) :
+    m_api(Api),
+    m_variants(INITIAL_VARIANTS_COUNT, EVT_VARIANT{})
+{
+}
+
+EventRenderer::~EventRenderer()
+{
+    if (m_renderContext)
+    {
+        m_api.Close(m_renderContext);
+    }
+}
+
+///
+/// Renders the system values of an event.
+///
+/// \param Event    Handle to the event.
+/// \param Values   Returns the values. A value the event doesn't have is
+///                 empty, or 0.
+///
+/// \return ERROR_SUCCESS, or the error of the Event Log API.
+///
+DWORD
+EventRenderer::Render(
+    _In_ EVT_HANDLE Event,
+    _Out_ EventSystemValues& Values
+    )
+{
+    DWORD status = ERROR_SUCCESS;
+
+    Values = EventSystemValues{ L"", L"", 0, 0, {} };
+
+    if (!m_renderContext)
+    {
+        m_renderContext = m_api.CreateRenderContext(
+            c_eventSystemValuePathsCount,
+            c_eventSystemValuePaths,
+            EvtRenderContextValues,
+            status);
+
+        if (!m_renderContext)
+        {
+            return status;
+        }
+    }
+
+    DWORD bufferUsed = 0;
+    DWORD propertyCount = 0;
+
+    status = m_api.Render(
+        m_renderContext,
+        Event,
+        EvtRenderEventValues,
+        static_cast<DWORD>(GetBufferSize()),
+        &m_variants[0],
+        &bufferUsed,
+        &propertyCount);
+
+    if (status == ERROR_INSUFFICIENT_BUFFER)
+    {
+        //
+        // Round up to whole variants, and keep the larger buffer for the
+        // next events.
+        //
+        m_variants.resize((bufferUsed + sizeof(EVT_VARIANT) - 1) / sizeof(EVT_VARIANT), EVT_VARIANT{});
+        m_bufferGrowths++;
+
+        status = m_api.Render(
+            m_renderContext,
+            Event,
+            EvtRenderEventValues,
+            static_cast<DWORD>(GetBufferSize()),
+            &m_variants[0],
+            &bufferUsed,
+            &propertyCount);
+    }
+
+    if (status != ERROR_SUCCESS)
+    {
+        return status;
+    }
+
+    if (propertyCount < c_eventSystemValuePathsCount)
+    {
+        return ERROR_INVALID_DATA;
+    }
+
+    //
+    // Extract the variant values for each queried property. If the variant
+    // failed to get a valid type, keep the default value.
+    //
+    if (m_variants[0].Type == EvtVarTypeString && m_variants[0].StringVal)
+    {
+        Values.ProviderName = m_variants[0].StringVal;
+    }
+
+    if (m_variants[1].Type == EvtVarTypeString && m_variants[1].StringVal)
+    {
+        Values.ChannelName = m_variants[1].StringVal;
+    }
+
+    if (m_variants[2].Type == EvtVarTypeUInt16)
+    {
+        Values.EventId = m_variants[2].UInt16Val;
+    }
+
+    if (m_variants[3].Type == EvtVarTypeByte)
+    {
+        Values.Level = m_variants[3].ByteVal;
+    }
+
+    if (m_variants[4].Type == EvtVarTypeFileTime)
+    {
+        ULARGE_INTEGER fileTimeAsInt{};
+
+        fileTimeAsInt.QuadPart = m_variants[4].FileTimeVal;
+        Values.TimeCreated.dwLowDateTime = fileTimeAsInt.LowPart;
+        Values.TimeCreated.dwHighDateTime = fileTimeAsInt.HighPart;
+    }
+
+    return ERROR_SUCCESS;
+}
+
+PublisherMetadataCache::PublisherMetadataCache(
+    _In_ EventLogApi& Api,
+    _In_ size_t Capacity
+    ) :
+    m_api(Api),
+    m_handles(
+        Capacity,
+        [this](const std::wstring&, EVT_HANDLE& Publisher)
+        {
+            if (Publisher)
+            {
+                m_api.Close(Publisher);
+            }
+        })
+{
+}
+
+///
+/// Returns the metadata handle of a provider, opened on the first event of
+/// the provider.
+///
+/// \param ProviderName    Name of the provider.
+///
+/// \return The handle, owned by the cache and valid until the next call.
+///     NULL if the provider has no metadata, or if it failed to be opened.
+///
+EVT_HANDLE
+PublisherMetadataCache::Get(
+    _In_ LPCWSTR ProviderName
+    )
+{
+    //
+    // The key is copied into a buffer kept between the calls.
+    //
+    m_providerName.assign(ProviderName);
+
+    EVT_HANDLE* cachedPublisher = m_handles.Find(m_providerName);
+    if (cachedPublisher != nullptr)
+    {
+        return *cachedPublisher;
+    }
+
+    DWORD status = ERROR_SUCCESS;
+    EVT_HANDLE publisher = m_api.OpenPublisherMetadata(ProviderName, status);
+
+    if (!publisher &&
+        status != ERROR_FILE_NOT_FOUND &&
+        status != ERROR_EVT_PUBLISHER_METADATA_NOT_FOUND)
+    {
+        //
+        // The failure may be transient, so the provider is opened again
+        // with its next event.
+        //
+        logWriter.TraceWarning(
+            FORMAT_STRING(
+                L"Failed to open the metadata of provider %ws. Error: %lu",
+                ProviderName,
+                status
+            ).c_str()
+        );
+
+        return NULL;
+    }
+
+    m_handles.Insert(m_providerName, publisher);
+
+    return publisher;
+}
@@ -0,0 +1,221 @@
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+
+#pragma once
+
+///
+/// Calls of the Event Log API used to render the events. The errors are
+/// returned instead of being left in GetLastError, so a mock doesn't have to
+/// set them.
+///
+/// The tests implement it to check and measure the rendering without the
+/// event log.
+///
+class EventLogApi
+{
+public:
+    virtual ~EventLogApi() = default;
+
+    ///
+    /// \return A handle to the render context, or NULL with the error in
+    ///     Status.
+    ///
+    virtual EVT_HANDLE CreateRenderContext(
+        _In_ DWORD ValuePathsCount,
+        _In_reads_(ValuePathsCount) LPCWSTR* ValuePaths,
+        _In_ DWORD Flags,
+        _Out_ DWORD& Status
+        ) = 0;
+
+    ///
+    /// \return ERROR_SUCCESS, ERROR_INSUFFICIENT_BUFFER with the needed size
+    ///     in BufferUsed, or the error of EvtRender.
+    ///
+    virtual DWORD Render(
+        _In_ EVT_HANDLE Context,
+        _In_ EVT_HANDLE Fragment,
+        _In_ DWORD Flags,
+        _In_ DWORD BufferSize,
+        _Out_writes_bytes_to_opt_(BufferSize, *BufferUsed) PVOID Buffer,
+        _Out_ PDWORD BufferUsed,
+        _Out_ PDWORD PropertyCount
+        ) = 0;
+
+    ///
+    /// \return A handle to the metadata of a provider, or NULL with the error
+    ///     in Status.
+    ///
+    virtual EVT_HANDLE OpenPublisherMetadata(
+        _In_ LPCWSTR PublisherId,
+        _Out_ DWORD& Status
+        ) = 0;
+
+    virtual void Close(
+        _In_ EVT_HANDLE Object
+        ) = 0;
+};
+
+///
+/// EventLogApi of the system.
+///
+class Win32EventLogApi final : public EventLogApi
+{
+public:
+    EVT_HANDLE CreateRenderContext(
+        _In_ DWORD ValuePathsCount,
+        _In_reads_(ValuePathsCount) LPCWSTR* ValuePaths,
+        _In_ DWORD Flags,
+        _Out_ DWORD& Status
+        ) override;
+
+    DWORD Render(
+        _In_ EVT_HANDLE Context,
+        _In_ EVT_HANDLE Fragment,
+        _In_ DWORD Flags,
+        _In_ DWORD BufferSize,
+        _Out_writes_bytes_to_opt_(BufferSize, *BufferUsed) PVOID Buffer,
+        _Out_ PDWORD BufferUsed,
+        _Out_ PDWORD PropertyCount
+        ) override;
+
+    EVT_HANDLE OpenPublisherMetadata(
+        _In_ LPCWSTR PublisherId,
+        _Out_ DWORD& Status
+        ) override;
+
+    void Close(
+        _In_ EVT_HANDLE Object
+        ) override;
+};
+
+///
+/// System values of an event. The strings point into the buffer of the
+/// EventRenderer, and are valid until the next event is rendered.
+///
+struct EventSystemValues
+{
+    LPCWSTR ProviderName;
+    LPCWSTR ChannelName;
+    UINT16 EventId;
+    UINT8 Level;
+    FILETIME TimeCreated;
+};
+
+///
+/// Renders the system values of the events.
+///
+/// The render context is created with the first event and kept until the
+/// renderer is destroyed, and the variants are rendered into a buffer that
+/// is kept between the events. An event is rendered with a single call,
+/// unless it needs a larger buffer than the earlier ones.
+///
+/// The renderer isn't thread safe.
+///
+class EventRenderer final
+{
+public:
+    EventRenderer(
+        _In_ EventLogApi& Api
+        );
+
+    EventRenderer(const EventRenderer&) = delete;
+    EventRenderer& operator=(const EventRenderer&) = delete;
+
+    ~EventRenderer();
+
+    DWORD Render(
+        _In_ EVT_HANDLE Event,
+        _Out_ EventSystemValues& Values
+        );
+
+    ///
+    /// Size of the buffer of the variants, in bytes.
+    ///
+    size_t GetBufferSize() const
+    {
+        return m_variants.size() * sizeof(EVT_VARIANT);
+    }
+
+    ///
+    /// Number of times an event needed a larger buffer.
+    ///
+    UINT64 GetBufferGrowths() const
+    {
+        return m_bufferGrowths;
+    }
+
+private:
+    //
+    // Enough for the variants and the strings of most events.
+    //
+    static constexpr size_t INITIAL_VARIANTS_COUNT = 32;
+
+    EventLogApi& m_api;
+
+    EVT_HANDLE m_renderContext = NULL;
+
+    std::vector<EVT_VARIANT> m_variants;
+
+    UINT64 m_bufferGrowths = 0;
+};
+
+///
+/// Metadata handles of the providers, kept open for the next events of the
+/// same provider. The least recently used handles are closed when the cache
+/// is full.
+///
+/// A provider without metadata is cached too, so its events don't try to
+/// open it again until it's evicted. Other errors aren't cached, so the next
+/// event of the provider opens it again.
+///
+/// The cache isn't thread safe.
+///
+class PublisherMetadataCache final
+{
+public:
+    //
+    // The events of a container come from a handful of providers.
+    //
+    static constexpr size_t DEFAULT_CAPACITY = 64;
+
+    PublisherMetadataCache(
+        _In_ EventLogApi& Api,
+        _In_ size_t Capacity = DEFAULT_CAPACITY
+        );
+
+    EVT_HANDLE Get(
+        _In_ LPCWSTR ProviderName
+        );
+
+    size_t Size() const
+    {
+        return m_handles.Size();
+    }
+
+    UINT64 GetHits() const
+    {
+        return m_handles.Hits();
+    }
+
+    UINT64 GetMisses() const
+    {
+        return m_handles.Misses();
+    }
+
+    UINT64 GetEvictions() const
+    {
+        return m_handles.Evictions();
+    }
+
+private:
+    EventLogApi& m_api;
+
+    //
+    // Declared after m_api, that closes the handles when it's destroyed.
+    //
+    LruCache<std::wstring, EVT_HANDLE> m_handles;
+
+    std::wstring m_providerName;
+};
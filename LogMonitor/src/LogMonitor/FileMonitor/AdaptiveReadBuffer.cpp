@@ -0,0 +1,116 @@
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+
+#include "pch.h"
+
+///
+/// AdaptiveReadBuffer.cpp
+///
+/// Read buffer that grows with the amount of data read from a log file, and
+/// shrinks when the file goes quiet.
+///
+
+constexpr DWORD AdaptiveReadBuffer::MIN_SIZE_BYTES;
+constexpr DWORD AdaptiveReadBuffer::DEFAULT_MAX_SIZE_BYTES;
+constexpr DWORD AdaptiveReadBuffer::MAX_SIZE_BYTES;
+
+///
+/// \param MaxSize      Maximum size of the buffer, in bytes. It's adjusted to
+///                     the range [MIN_SIZE_BYTES, MAX_SIZE_BYTES].
+///
+AdaptiveReadBuffer::AdaptiveReadBuffer(
+    _In_ DWORD MaxSize
+    ) :
+    m_size(MIN_SIZE_BYTES),
+    m_maxSize(MIN_SIZE_BYTES),
+    m_passBytesRead(0)
+{
+    SetMaxSize(MaxSize);
+}
+
+void
+AdaptiveReadBuffer::SetMaxSize(
+    _In_ DWORD MaxSize
+    )
+{
+    m_maxSize = (std::max)(MIN_SIZE_BYTES, (std::min)(MaxSize, MAX_SIZE_BYTES));
+
+    if (m_size > m_maxSize)
+    {
+        Resize(m_maxSize);
+    }
+}
+
+///
+/// Returns the buffer, allocating it if needed. The pointer is invalidated
+/// by RecordRead and EndReadPass.
+///
+BYTE*
+AdaptiveReadBuffer::Data()
+{
+    if (m_buffer.size() != m_size)
+    {
+        m_buffer.resize(m_size);
+    }
+
+    return m_buffer.data();
+}
+
+void
+AdaptiveReadBuffer::BeginReadPass()
+{
+    m_passBytesRead = 0;
+}
+
+///
+/// Records the result of a read. If the read filled the buffer there is
+/// probably more data waiting, so the buffer grows for the next read.
+///
+/// \param BytesRead    Number of bytes read into the buffer.
+///
+void
+AdaptiveReadBuffer::RecordRead(
+    _In_ DWORD BytesRead
+    )
+{
+    m_passBytesRead += BytesRead;
+
+    if (BytesRead >= m_size && m_size < m_maxSize)
+    {
+        Resize((m_size > m_maxSize / 2) ? m_maxSize : m_size * 2);
+    }
+}
+
+///
+/// Shrinks the buffer if the last read pass used only a small part of it.
+///
+void
+AdaptiveReadBuffer::EndReadPass()
+{
+    if (m_size > MIN_SIZE_BYTES && m_passBytesRead < m_size / 4)
+    {
+        Resize((std::max)(MIN_SIZE_BYTES, m_size / 2));
+    }
+}
+
+void
+AdaptiveReadBuffer::Resize(
+    _In_ DWORD NewSize
+    )
+{
+    const bool shrink = NewSize < m_size;
+
+    m_size = NewSize;
+
+    if (!m_buffer.empty())
+    {
+        m_buffer.resize(m_size);
+
+        if (shrink)
+        {
+            m_buffer.shrink_to_fit();
+        }
+    }
+}
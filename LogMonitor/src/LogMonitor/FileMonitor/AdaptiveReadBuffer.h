@@ -0,0 +1,74 @@
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+
+#pragma once
+
+///
+/// Read buffer of a monitored log file, sized after the amount of data found
+/// in each read pass.
+///
+/// The buffer starts at MIN_SIZE_BYTES and doubles every time a read fills
+/// it completely, up to the configured maximum, so large backlogs are read
+/// with few big reads. When a read pass finds less than a quarter of the
+/// buffer size, the buffer is halved, so files that go quiet give back the
+/// memory.
+///
+/// The buffer is kept in LogFileInformation, so it's reused between passes.
+///
+class AdaptiveReadBuffer final
+{
+public:
+    static constexpr DWORD MIN_SIZE_BYTES = 4 * 1024;
+    static constexpr DWORD DEFAULT_MAX_SIZE_BYTES = 1024 * 1024;
+    static constexpr DWORD MAX_SIZE_BYTES = 64 * 1024 * 1024;
+
+    AdaptiveReadBuffer(
+        _In_ DWORD MaxSize = DEFAULT_MAX_SIZE_BYTES
+        );
+
+    void SetMaxSize(
+        _In_ DWORD MaxSize
+        );
+
+    BYTE* Data();
+
+    DWORD Size() const
+    {
+        return m_size;
+    }
+
+    DWORD MaxSize() const
+    {
+        return m_maxSize;
+    }
+
+    void BeginReadPass();
+
+    void RecordRead(
+        _In_ DWORD BytesRead
+        );
+
+    void EndReadPass();
+
+private:
+    std::vector<BYTE> m_buffer;
+
+    //
+    // Current size of the buffer. The vector is only allocated when the
+    // buffer is used.
+    //
+    DWORD m_size;
+
+    DWORD m_maxSize;
+
+    //
+    // Bytes read since the last call to BeginReadPass.
+    //
+    UINT64 m_passBytesRead;
+
+    void Resize(
+        _In_ DWORD NewSize
+        );
+};
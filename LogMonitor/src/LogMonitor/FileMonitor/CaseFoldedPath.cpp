@@ -0,0 +1,69 @@
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+
+#include "pch.h"
+
+CaseFoldedPath::CaseFoldedPath(
+    _In_ const std::wstring& Path
+    ) :
+    m_folded(Fold(Path))
+{
+    //
+    // FNV-1a over the folded characters.
+    //
+    UINT64 hash = 14695981039346656037ULL;
+
+    for (wchar_t c : m_folded)
+    {
+        hash = (hash ^ static_cast<UINT16>(c)) * 1099511628211ULL;
+    }
+
+    m_hash = static_cast<size_t>(hash);
+}
+
+///
+/// Uppercases a path. ASCII characters are handled inline; a path with
+/// other characters is mapped with LCMapStringEx and the invariant locale,
+/// which maps each character to one character, like the file system does.
+///
+/// \param Path         The path to fold.
+///
+/// \return The folded path, with the same length as Path.
+///
+std::wstring
+CaseFoldedPath::Fold(
+    _In_ const std::wstring& Path
+    )
+{
+    std::wstring folded(Path);
+    bool isAscii = true;
+
+    for (wchar_t& c : folded)
+    {
+        if (c >= L'a' && c <= L'z')
+        {
+            c = static_cast<wchar_t>(c - (L'a' - L'A'));
+        }
+        else if (c >= 0x80)
+        {
+            isAscii = false;
+        }
+    }
+
+    if (!isAscii)
+    {
+        LCMapStringEx(LOCALE_NAME_INVARIANT,
+                      LCMAP_UPPERCASE,
+                      Path.c_str(),
+                      static_cast<int>(Path.size()),
+                      &folded[0],
+                      static_cast<int>(folded.size()),
+                      nullptr,
+                      nullptr,
+                      0);
+    }
+
+    return folded;
+}
@@ -0,0 +1,59 @@
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+
+#pragma once
+
+///
+/// Key of the path tables of LogFileMonitor. The path is uppercased and
+/// hashed once, when the key is built, so lookups in an unordered container
+/// cost a single hash and, on a match, a single memory compare, instead of
+/// a case insensitive compare per tree node.
+///
+/// Paths are compared the way the file system compares names: uppercased
+/// with the invariant locale.
+///
+class CaseFoldedPath final
+{
+public:
+    CaseFoldedPath(
+        _In_ const std::wstring& Path
+        );
+
+    const std::wstring& Folded() const
+    {
+        return m_folded;
+    }
+
+    size_t Hash() const
+    {
+        return m_hash;
+    }
+
+    bool operator==(const CaseFoldedPath& Other) const
+    {
+        return m_hash == Other.m_hash && m_folded == Other.m_folded;
+    }
+
+    bool operator!=(const CaseFoldedPath& Other) const
+    {
+        return !(*this == Other);
+    }
+
+    struct Hasher
+    {
+        size_t operator() (const CaseFoldedPath& Path) const
+        {
+            return Path.Hash();
+        }
+    };
+
+    static std::wstring Fold(
+        _In_ const std::wstring& Path
+        );
+
+private:
+    std::wstring m_folded;
+    size_t m_hash;
+};
@@ -0,0 +1,117 @@
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+
+#include "pch.h"
+
+constexpr size_t DirChangeEventQueue::DEFAULT_CAPACITY;
+
+DirChangeEventQueue::DirChangeEventQueue(
+    _In_ size_t Capacity
+    ) :
+    m_capacity(Capacity > 0 ? Capacity : 1)
+{
+}
+
+///
+/// Adds an event at the end of the queue, or folds it into a pending
+/// Modify event of the same file.
+///
+/// \param Event        The event.
+///
+/// \return True if the queue was empty, so the consumer has to be notified.
+///
+bool
+DirChangeEventQueue::Push(
+    _In_ const DirChangeNotificationEvent& Event
+    )
+{
+    const bool wasEmpty = m_events.empty();
+
+    m_statistics.Pushed++;
+
+    if (Event.Action == EventAction::Modify)
+    {
+        const CaseFoldedPath key(Event.FileName);
+
+        auto pending = m_pendingModify.find(key);
+        if (pending != m_pendingModify.end())
+        {
+            DirChangeNotificationEvent& pendingEvent = m_events[pending->second];
+
+            if (Event.Timestamp > pendingEvent.Timestamp)
+            {
+                pendingEvent.Timestamp = Event.Timestamp;
+            }
+
+            m_statistics.Coalesced++;
+
+            return false;
+        }
+
+        if (m_events.size() < m_capacity)
+        {
+            m_pendingModify.emplace(key, m_events.size());
+        }
+    }
+    else if (Event.Action == EventAction::ReInit)
+    {
+        m_pendingModify.clear();
+    }
+    else
+    {
+        m_pendingModify.erase(CaseFoldedPath(Event.FileName));
+    }
+
+    if (m_events.size() >= m_capacity)
+    {
+        //
+        // Too many pending changes. Drop them and rescan the directory.
+        //
+        m_statistics.Overflows++;
+
+        m_events.clear();
+        m_pendingModify.clear();
+
+        DirChangeNotificationEvent reInitEvent;
+        reInitEvent.Action = EventAction::ReInit;
+        reInitEvent.Timestamp = Event.Timestamp;
+
+        m_events.push_back(std::move(reInitEvent));
+
+        return wasEmpty;
+    }
+
+    m_events.push_back(Event);
+
+    if (m_events.size() > m_statistics.MaxDepth)
+    {
+        m_statistics.MaxDepth = m_events.size();
+    }
+
+    return wasEmpty;
+}
+
+///
+/// Removes all the events of the queue.
+///
+/// \param Events       Returns the events, in queue order.
+///
+void
+DirChangeEventQueue::PopAll(
+    _Out_ std::vector<DirChangeNotificationEvent>& Events
+    )
+{
+    Events.clear();
+    Events.swap(m_events);
+
+    m_pendingModify.clear();
+}
+
+void
+DirChangeEventQueue::Clear()
+{
+    m_events.clear();
+    m_pendingModify.clear();
+}
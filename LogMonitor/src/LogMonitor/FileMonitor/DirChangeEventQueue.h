@@ -0,0 +1,77 @@
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+
+#pragma once
+
+///
+/// Bounded queue of the directory change events of a LogFileMonitor.
+///
+/// A Modify event for a file that already has a pending Modify event is
+/// folded into the pending one, which takes the newest timestamp. Folding
+/// stops at any other event for the same name (Add, Remove, renames), and
+/// at a ReInit event, so those keep their order relative to the Modify
+/// events.
+///
+/// When the queue is full, the pending events are replaced by a single
+/// ReInit event, which rescans the directory like a change notification
+/// buffer overflow does.
+///
+/// The queue isn't thread safe.
+///
+class DirChangeEventQueue final
+{
+public:
+    static constexpr size_t DEFAULT_CAPACITY = 16 * 1024;
+
+    struct Statistics
+    {
+        UINT64 Pushed = 0;
+        UINT64 Coalesced = 0;
+        UINT64 Overflows = 0;
+        size_t MaxDepth = 0;
+    };
+
+    DirChangeEventQueue(
+        _In_ size_t Capacity = DEFAULT_CAPACITY
+        );
+
+    bool Push(
+        _In_ const DirChangeNotificationEvent& Event
+        );
+
+    void PopAll(
+        _Out_ std::vector<DirChangeNotificationEvent>& Events
+        );
+
+    void Clear();
+
+    size_t Size() const
+    {
+        return m_events.size();
+    }
+
+    bool Empty() const
+    {
+        return m_events.empty();
+    }
+
+    const Statistics& GetStatistics() const
+    {
+        return m_statistics;
+    }
+
+private:
+    std::vector<DirChangeNotificationEvent> m_events;
+
+    //
+    // Position in m_events of the Modify event that later Modify events
+    // for the same file are folded into.
+    //
+    std::unordered_map<CaseFoldedPath, size_t, CaseFoldedPath::Hasher> m_pendingModify;
+
+    size_t m_capacity;
+
+    Statistics m_statistics;
+};
@@ -0,0 +1,87 @@
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+
+#pragma once
+
+enum class EventAction
+{
+    Add = 0,
+    Modify = 1,
+    Remove = 2,
+    RenameOld = 3,
+    RenameNew = 4,
+    ReInit = 5,
+    Unknown = 5,
+};
+
+
+struct DirChangeNotificationEvent
+{
+    std::wstring FileName;
+    EventAction Action;
+    UINT64 Timestamp;
+};
+
+//
+// Object the watcher thread waits on for the events of a DirectoryWatcher:
+// an event handle on Windows, a file descriptor elsewhere.
+//
+#ifdef _WIN32
+typedef HANDLE DirectoryWatcherWaitObject;
+#else
+typedef int DirectoryWatcherWaitObject;
+#endif
+
+///
+/// Source of the change events of a log directory.
+///
+/// The events carry the name of the file relative to the watched directory.
+/// A backend that loses events, because its notification buffer overflowed,
+/// reports a ReInit event instead so the directory is scanned again.
+///
+/// A watcher is used by a single thread.
+///
+class DirectoryWatcher
+{
+public:
+    virtual ~DirectoryWatcher() {}
+
+    ///
+    /// Starts watching the directory. Changes made after Start returns are
+    /// reported by ReadEvents.
+    ///
+    /// \return ERROR_SUCCESS, or the error that stopped the watch.
+    ///
+    virtual DWORD Start() = 0;
+
+    ///
+    /// Returns the object that is signaled, or readable, when ReadEvents has
+    /// events to return.
+    ///
+    virtual DirectoryWatcherWaitObject GetWaitObject() const = 0;
+
+    ///
+    /// Appends the pending events, and waits for the next ones.
+    ///
+    /// \param Events       The events are appended to this vector.
+    ///
+    /// \return ERROR_SUCCESS, or the error that stopped the watch.
+    ///
+    virtual DWORD ReadEvents(
+        _Inout_ std::vector<DirChangeNotificationEvent>& Events
+        ) = 0;
+};
+
+#ifdef _WIN32
+
+///
+/// Creates the watcher of a log directory. The watcher owns the handle of
+/// the directory, opened with FILE_FLAG_OVERLAPPED.
+///
+typedef std::function<std::unique_ptr<DirectoryWatcher>(
+    HANDLE DirectoryHandle,
+    bool IncludeSubfolders)> DirectoryWatcherFactory;
+
+#endif
@@ -0,0 +1,209 @@
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+
+#include "pch.h"
+
+#ifdef __linux__
+
+#include <dirent.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+
+static_assert(sizeof(InotifyEventParser::EventHeader) == sizeof(struct inotify_event),
+              "The parser's record header must match struct inotify_event.");
+static_assert(InotifyEventParser::MASK_MODIFY == IN_MODIFY
+              && InotifyEventParser::MASK_MOVED_FROM == IN_MOVED_FROM
+              && InotifyEventParser::MASK_MOVED_TO == IN_MOVED_TO
+              && InotifyEventParser::MASK_CREATE == IN_CREATE
+              && InotifyEventParser::MASK_DELETE == IN_DELETE
+              && InotifyEventParser::MASK_DELETE_SELF == IN_DELETE_SELF
+              && InotifyEventParser::MASK_MOVE_SELF == IN_MOVE_SELF
+              && InotifyEventParser::MASK_Q_OVERFLOW == IN_Q_OVERFLOW
+              && InotifyEventParser::MASK_IGNORED == IN_IGNORED
+              && InotifyEventParser::MASK_ISDIR == IN_ISDIR,
+              "The parser's masks must match <sys/inotify.h>.");
+
+constexpr size_t InotifyDirectoryWatcher::EVENTS_BUFFER_SIZE_BYTES;
+constexpr uint32_t InotifyDirectoryWatcher::WATCH_MASK;
+
+InotifyDirectoryWatcher::InotifyDirectoryWatcher(
+    _In_ const std::string& Directory,
+    _In_ bool IncludeSubfolders
+    ) :
+    m_directory(Directory),
+    m_includeSubfolders(IncludeSubfolders),
+    m_inotifyFd(-1),
+    m_parser(IncludeSubfolders),
+    m_buffer(EVENTS_BUFFER_SIZE_BYTES)
+{
+    while (m_directory.size() > 1 && m_directory[m_directory.size() - 1] == '/')
+    {
+        m_directory.resize(m_directory.size() - 1);
+    }
+}
+
+InotifyDirectoryWatcher::~InotifyDirectoryWatcher()
+{
+    if (m_inotifyFd != -1)
+    {
+        close(m_inotifyFd);
+    }
+}
+
+DWORD
+InotifyDirectoryWatcher::Start()
+{
+    m_inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (m_inotifyFd == -1)
+    {
+        return static_cast<DWORD>(errno);
+    }
+
+    return m_includeSubfolders ? AddWatchTree(std::string()) : AddWatch(std::string());
+}
+
+///
+/// Reads the pending inotify events, without blocking, and updates the
+/// watches of the directories moved or created in the tree.
+///
+DWORD
+InotifyDirectoryWatcher::ReadEvents(
+    _Inout_ std::vector<DirChangeNotificationEvent>& Events
+    )
+{
+    for (;;)
+    {
+        const ssize_t size = read(m_inotifyFd, m_buffer.data(), m_buffer.size());
+
+        if (size == -1)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+
+            return (errno == EAGAIN) ? ERROR_SUCCESS : static_cast<DWORD>(errno);
+        }
+
+        if (size == 0)
+        {
+            return ERROR_SUCCESS;
+        }
+
+        m_newDirectories.clear();
+        m_removedWatches.clear();
+
+        m_parser.Parse(
+            m_buffer.data(),
+            static_cast<size_t>(size),
+            GetTimestamp(),
+            Events,
+            m_newDirectories,
+            m_removedWatches);
+
+        //
+        // The watches are removed first: a directory moved inside the tree
+        // has the same inode, and gets a new watch for its new path.
+        //
+        for (INT32 wd : m_removedWatches)
+        {
+            inotify_rm_watch(m_inotifyFd, wd);
+        }
+
+        for (const std::string& directory : m_newDirectories)
+        {
+            AddWatchTree(directory);
+        }
+    }
+}
+
+DWORD
+InotifyDirectoryWatcher::AddWatch(
+    _In_ const std::string& RelativePath
+    )
+{
+    const std::string path = RelativePath.empty() ? m_directory : m_directory + '/' + RelativePath;
+
+    const int wd = inotify_add_watch(m_inotifyFd, path.c_str(), WATCH_MASK);
+    if (wd == -1)
+    {
+        return static_cast<DWORD>(errno);
+    }
+
+    m_parser.AddWatch(wd, RelativePath);
+
+    return ERROR_SUCCESS;
+}
+
+///
+/// Adds a watch for a directory and all its subdirectories. Only the failure
+/// of the top directory is returned, a subdirectory can be removed while the
+/// tree is enumerated.
+///
+DWORD
+InotifyDirectoryWatcher::AddWatchTree(
+    _In_ const std::string& RelativePath
+    )
+{
+    DWORD status = AddWatch(RelativePath);
+    if (status != ERROR_SUCCESS)
+    {
+        return status;
+    }
+
+    std::vector<std::string> pending = { RelativePath };
+
+    while (!pending.empty())
+    {
+        const std::string relativeDirectory = pending.back();
+        pending.pop_back();
+
+        const std::string path = relativeDirectory.empty() ? m_directory : m_directory + '/' + relativeDirectory;
+
+        DIR* directory = opendir(path.c_str());
+        if (directory == nullptr)
+        {
+            continue;
+        }
+
+        while (const struct dirent* entry = readdir(directory))
+        {
+            //
+            // DT_UNKNOWN is resolved by IN_ONLYDIR, which fails for a file.
+            //
+            if ((entry->d_type != DT_DIR && entry->d_type != DT_UNKNOWN)
+                || strcmp(entry->d_name, ".") == 0
+                || strcmp(entry->d_name, "..") == 0)
+            {
+                continue;
+            }
+
+            const std::string child = relativeDirectory.empty()
+                ? std::string(entry->d_name)
+                : relativeDirectory + '/' + entry->d_name;
+
+            if (AddWatch(child) == ERROR_SUCCESS)
+            {
+                pending.push_back(child);
+            }
+        }
+
+        closedir(directory);
+    }
+
+    return ERROR_SUCCESS;
+}
+
+UINT64
+InotifyDirectoryWatcher::GetTimestamp()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return static_cast<UINT64>(now.tv_sec) * 1000 + static_cast<UINT64>(now.tv_nsec) / 1000000;
+}
+
+#endif
@@ -0,0 +1,91 @@
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+
+#pragma once
+
+#ifdef __linux__
+
+#include <sys/inotify.h>
+
+///
+/// DirectoryWatcher backed by inotify, to run the log file tailing outside
+/// Windows.
+///
+/// inotify doesn't watch subdirectories, so with IncludeSubfolders a watch
+/// is added for each directory of the tree, including the ones created or
+/// moved into it later, and the watches of a directory moved out of its
+/// place are removed. The records are converted by an InotifyEventParser,
+/// that reports IN_Q_OVERFLOW as a ReInit event.
+///
+class InotifyDirectoryWatcher final : public DirectoryWatcher
+{
+public:
+    static constexpr size_t EVENTS_BUFFER_SIZE_BYTES = 64 * 1024;
+
+    static constexpr uint32_t WATCH_MASK = IN_CREATE
+                                         | IN_MODIFY
+                                         | IN_DELETE
+                                         | IN_MOVED_FROM
+                                         | IN_MOVED_TO
+                                         | IN_MOVE_SELF
+                                         | IN_DELETE_SELF
+                                         | IN_ONLYDIR;
+
+    ///
+    /// \param Directory            The directory, UTF-8 encoded.
+    /// \param IncludeSubfolders    True to watch the subdirectories too.
+    ///
+    InotifyDirectoryWatcher(
+        _In_ const std::string& Directory,
+        _In_ bool IncludeSubfolders
+        );
+
+    ~InotifyDirectoryWatcher();
+
+    InotifyDirectoryWatcher(const InotifyDirectoryWatcher&) = delete;
+    InotifyDirectoryWatcher& operator=(const InotifyDirectoryWatcher&) = delete;
+
+    DWORD Start() override;
+
+    DirectoryWatcherWaitObject GetWaitObject() const override
+    {
+        return m_inotifyFd;
+    }
+
+    DWORD ReadEvents(
+        _Inout_ std::vector<DirChangeNotificationEvent>& Events
+        ) override;
+
+private:
+    DWORD AddWatch(
+        _In_ const std::string& RelativePath
+        );
+
+    DWORD AddWatchTree(
+        _In_ const std::string& RelativePath
+        );
+
+    static UINT64 GetTimestamp();
+
+    std::string m_directory;
+    bool m_includeSubfolders;
+
+    int m_inotifyFd;
+
+    InotifyEventParser m_parser;
+
+    //
+    // Must be aligned for struct inotify_event, so allocated on the heap.
+    //
+    std::vector<char> m_buffer;
+
+    //
+    // Watches returned by the parser, kept between the reads.
+    //
+    std::vector<std::string> m_newDirectories;
+    std::vector<INT32> m_removedWatches;
+};
+
+#endif
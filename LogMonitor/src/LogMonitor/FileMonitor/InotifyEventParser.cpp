@@ -0,0 +1,298 @@
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+
+#include "pch.h"
+
+constexpr UINT32 InotifyEventParser::MASK_MODIFY;
+constexpr UINT32 InotifyEventParser::MASK_MOVED_FROM;
+constexpr UINT32 InotifyEventParser::MASK_MOVED_TO;
+constexpr UINT32 InotifyEventParser::MASK_CREATE;
+constexpr UINT32 InotifyEventParser::MASK_DELETE;
+constexpr UINT32 InotifyEventParser::MASK_DELETE_SELF;
+constexpr UINT32 InotifyEventParser::MASK_MOVE_SELF;
+constexpr UINT32 InotifyEventParser::MASK_Q_OVERFLOW;
+constexpr UINT32 InotifyEventParser::MASK_IGNORED;
+constexpr UINT32 InotifyEventParser::MASK_ISDIR;
+
+///
+/// Records the relative path of a watch. A watch added again for the same
+/// directory has the same descriptor, and takes the new path.
+///
+void
+InotifyEventParser::AddWatch(
+    _In_ INT32 Wd,
+    _In_ const std::string& RelativePath
+    )
+{
+    m_watchPaths[Wd] = RelativePath;
+}
+
+///
+/// Converts inotify records to change events.
+///
+/// \param Buffer           The records.
+/// \param Size             Size of the records in bytes.
+/// \param Timestamp        Timestamp of the events.
+/// \param Events           The events are appended to this vector.
+/// \param NewDirectories   The directories to watch are appended to this
+///                         vector.
+/// \param RemovedWatches   The watches to remove are appended to this
+///                         vector. They are already forgotten by the parser.
+///
+void
+InotifyEventParser::Parse(
+    _In_reads_bytes_(Size) const char* Buffer,
+    _In_ size_t Size,
+    _In_ UINT64 Timestamp,
+    _Inout_ std::vector<DirChangeNotificationEvent>& Events,
+    _Inout_ std::vector<std::string>& NewDirectories,
+    _Inout_ std::vector<INT32>& RemovedWatches
+    )
+{
+    DirChangeNotificationEvent changeEvent;
+    changeEvent.Timestamp = Timestamp;
+
+    size_t offset = 0;
+
+    while (Size - offset >= sizeof(EventHeader))
+    {
+        EventHeader event;
+        memcpy(&event, Buffer + offset, sizeof(event));
+
+        const size_t eventSize = sizeof(EventHeader) + event.Length;
+        if (eventSize > Size - offset)
+        {
+            break;
+        }
+
+        const char* name = Buffer + offset + sizeof(EventHeader);
+        offset += eventSize;
+
+        if (event.Mask & MASK_Q_OVERFLOW)
+        {
+            changeEvent.Action = EventAction::ReInit;
+            changeEvent.FileName.clear();
+            Events.push_back(changeEvent);
+            continue;
+        }
+
+        auto watchPath = m_watchPaths.find(event.Wd);
+        if (watchPath == m_watchPaths.end())
+        {
+            //
+            // The watch was removed, and its last records are ignored.
+            //
+            continue;
+        }
+
+        if (event.Mask & MASK_IGNORED)
+        {
+            //
+            // The watch was removed by the system, because its directory was
+            // deleted or its file system unmounted. A move doesn't remove it.
+            //
+            m_watchPaths.erase(watchPath);
+            continue;
+        }
+
+        if (event.Mask & (MASK_MOVE_SELF | MASK_DELETE_SELF))
+        {
+            if (watchPath->second.empty())
+            {
+                //
+                // The files of the watched directory are opened by its path,
+                // which no longer has them.
+                //
+                changeEvent.Action = EventAction::ReInit;
+                changeEvent.FileName.clear();
+                Events.push_back(changeEvent);
+            }
+            else if (event.Mask & MASK_MOVE_SELF)
+            {
+                //
+                // The IN_MOVED_FROM record of the parent already removed the
+                // watch, unless it was lost in an overflow.
+                //
+                RemoveWatchTree(std::string(watchPath->second), RemovedWatches);
+            }
+
+            continue;
+        }
+
+        if (event.Length == 0)
+        {
+            continue;
+        }
+
+        std::string relativePath = watchPath->second;
+        if (!relativePath.empty())
+        {
+            relativePath += '/';
+        }
+        relativePath += std::string(name, strnlen(name, event.Length));
+
+        if (event.Mask & MASK_CREATE)
+        {
+            changeEvent.Action = EventAction::Add;
+        }
+        else if (event.Mask & MASK_DELETE)
+        {
+            changeEvent.Action = EventAction::Remove;
+        }
+        else if (event.Mask & MASK_MODIFY)
+        {
+            changeEvent.Action = EventAction::Modify;
+        }
+        else if (event.Mask & MASK_MOVED_FROM)
+        {
+            changeEvent.Action = EventAction::RenameOld;
+        }
+        else if (event.Mask & MASK_MOVED_TO)
+        {
+            changeEvent.Action = EventAction::RenameNew;
+        }
+        else
+        {
+            continue;
+        }
+
+        changeEvent.FileName = Utf8ToWide(relativePath);
+        Events.push_back(changeEvent);
+
+        if (!(event.Mask & MASK_ISDIR) || !m_includeSubfolders)
+        {
+            continue;
+        }
+
+        if (event.Mask & MASK_MOVED_FROM)
+        {
+            RemoveWatchTree(relativePath, RemovedWatches);
+        }
+        else if (event.Mask & (MASK_CREATE | MASK_MOVED_TO))
+        {
+            //
+            // Files may have been created in the new directory before its
+            // watch is added. Scan the directory again to find them.
+            //
+            NewDirectories.push_back(relativePath);
+
+            changeEvent.Action = EventAction::ReInit;
+            changeEvent.FileName.clear();
+            Events.push_back(changeEvent);
+        }
+    }
+}
+
+///
+/// Forgets the watches of a directory and of its subdirectories.
+///
+void
+InotifyEventParser::RemoveWatchTree(
+    _In_ const std::string& RelativePath,
+    _Inout_ std::vector<INT32>& RemovedWatches
+    )
+{
+    for (auto watchPath = m_watchPaths.begin(); watchPath != m_watchPaths.end();)
+    {
+        const std::string& path = watchPath->second;
+
+        if (path.compare(0, RelativePath.size(), RelativePath) == 0
+            && (path.size() == RelativePath.size() || path[RelativePath.size()] == '/'))
+        {
+            RemovedWatches.push_back(watchPath->first);
+            watchPath = m_watchPaths.erase(watchPath);
+        }
+        else
+        {
+            ++watchPath;
+        }
+    }
+}
+
+///
+/// Decodes a UTF-8 file name. Invalid sequences are replaced by U+FFFD.
+///
+std::wstring
+InotifyEventParser::Utf8ToWide(
+    _In_ const std::string& Value
+    )
+{
+    std::wstring result;
+    result.reserve(Value.size());
+
+    size_t i = 0;
+
+    while (i < Value.size())
+    {
+        const unsigned char lead = static_cast<unsigned char>(Value[i]);
+        UINT32 codePoint;
+        size_t length;
+
+        if (lead < 0x80)
+        {
+            codePoint = lead;
+            length = 1;
+        }
+        else if ((lead & 0xE0) == 0xC0)
+        {
+            codePoint = lead & 0x1F;
+            length = 2;
+        }
+        else if ((lead & 0xF0) == 0xE0)
+        {
+            codePoint = lead & 0x0F;
+            length = 3;
+        }
+        else if ((lead & 0xF8) == 0xF0)
+        {
+            codePoint = lead & 0x07;
+            length = 4;
+        }
+        else
+        {
+            result += static_cast<wchar_t>(0xFFFD);
+            i++;
+            continue;
+        }
+
+        size_t j = 1;
+
+        for (; j < length && i + j < Value.size(); j++)
+        {
+            const unsigned char next = static_cast<unsigned char>(Value[i + j]);
+            if ((next & 0xC0) != 0x80)
+            {
+                break;
+            }
+
+            codePoint = (codePoint << 6) | (next & 0x3F);
+        }
+
+        if (j != length)
+        {
+            result += static_cast<wchar_t>(0xFFFD);
+            i += j;
+            continue;
+        }
+
+        if (sizeof(wchar_t) == 2 && codePoint >= 0x10000)
+        {
+            //
+            // A surrogate pair in UTF-16.
+            //
+            codePoint -= 0x10000;
+            result += static_cast<wchar_t>(0xD800 + (codePoint >> 10));
+            result += static_cast<wchar_t>(0xDC00 + (codePoint & 0x3FF));
+        }
+        else
+        {
+            result += static_cast<wchar_t>(codePoint);
+        }
+
+        i += length;
+    }
+
+    return result;
+}
@@ -0,0 +1,105 @@
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+
+#pragma once
+
+///
+/// Converts the records read from an inotify descriptor to change events,
+/// and keeps the relative paths of the watched directories.
+///
+/// The parser doesn't call inotify, so it builds and is tested on any
+/// platform with synthetic records. The masks and the record header are the
+/// ones of the inotify ABI, checked against <sys/inotify.h> by the
+/// InotifyDirectoryWatcher that uses the parser.
+///
+/// The watches to add and to remove are returned to the watcher:
+///
+/// - With IncludeSubfolders, a directory created in the tree, or moved into
+///   it, is reported as an Add or RenameNew event followed by a ReInit
+///   event, because files can be created in it before its watch is added.
+///   Its path is returned in NewDirectories.
+///
+/// - A directory moved out of its place in the tree keeps its watches, that
+///   would report its next events under its old path. The watches of the
+///   directory and of its subdirectories are returned in RemovedWatches.
+///
+/// - IN_Q_OVERFLOW, and the move or the deletion of the watched directory
+///   itself, are reported as a ReInit event.
+///
+/// The names of the events use the native '/' separator.
+///
+class InotifyEventParser final
+{
+public:
+    //
+    // Masks of <sys/inotify.h>.
+    //
+    static constexpr UINT32 MASK_MODIFY = 0x00000002;
+    static constexpr UINT32 MASK_MOVED_FROM = 0x00000040;
+    static constexpr UINT32 MASK_MOVED_TO = 0x00000080;
+    static constexpr UINT32 MASK_CREATE = 0x00000100;
+    static constexpr UINT32 MASK_DELETE = 0x00000200;
+    static constexpr UINT32 MASK_DELETE_SELF = 0x00000400;
+    static constexpr UINT32 MASK_MOVE_SELF = 0x00000800;
+    static constexpr UINT32 MASK_Q_OVERFLOW = 0x00004000;
+    static constexpr UINT32 MASK_IGNORED = 0x00008000;
+    static constexpr UINT32 MASK_ISDIR = 0x40000000;
+
+    ///
+    /// Header of a record, followed by Length bytes of the NUL-padded name.
+    /// Same layout as struct inotify_event.
+    ///
+    struct EventHeader
+    {
+        INT32 Wd;
+        UINT32 Mask;
+        UINT32 Cookie;
+        UINT32 Length;
+    };
+
+    InotifyEventParser(
+        _In_ bool IncludeSubfolders
+        ) :
+        m_includeSubfolders(IncludeSubfolders)
+    {
+    }
+
+    void AddWatch(
+        _In_ INT32 Wd,
+        _In_ const std::string& RelativePath
+        );
+
+    size_t GetWatchCount() const
+    {
+        return m_watchPaths.size();
+    }
+
+    void Parse(
+        _In_reads_bytes_(Size) const char* Buffer,
+        _In_ size_t Size,
+        _In_ UINT64 Timestamp,
+        _Inout_ std::vector<DirChangeNotificationEvent>& Events,
+        _Inout_ std::vector<std::string>& NewDirectories,
+        _Inout_ std::vector<INT32>& RemovedWatches
+        );
+
+    static std::wstring Utf8ToWide(
+        _In_ const std::string& Value
+        );
+
+private:
+    void RemoveWatchTree(
+        _In_ const std::string& RelativePath,
+        _Inout_ std::vector<INT32>& RemovedWatches
+        );
+
+    bool m_includeSubfolders;
+
+    //
+    // Watched directories, by watch descriptor. The path is relative to the
+    // watched directory, empty for the directory itself.
+    //
+    std::unordered_map<INT32, std::string> m_watchPaths;
+};
@@ -0,0 +1,301 @@
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+
+#include "pch.h"
+
+///
+/// LogFileCheckpoint.cpp
+///
+/// Binary format of the checkpoint file, all values little endian:
+///
+///     UINT32  Magic ("LMCP")
+///     UINT32  Version
+///     UINT32  Number of records
+///     Records:
+///         UINT64  Volume serial number
+///         BYTE[16] File identifier
+///         UINT64  Next read offset
+///         UINT32  Encoding type
+///         UINT32  Fingerprint size
+///         UINT64  Fingerprint
+///     UINT64  FNV-1a hash of all the previous bytes
+///
+
+constexpr UINT32 LogFileCheckpointStore::FINGERPRINT_MAX_BYTES;
+constexpr UINT32 LogFileCheckpointStore::FILE_MAGIC;
+constexpr UINT32 LogFileCheckpointStore::FILE_VERSION;
+
+namespace
+{
+    const size_t CHECKPOINT_HEADER_SIZE = 3 * sizeof(UINT32);
+    const size_t CHECKPOINT_RECORD_SIZE = sizeof(UINT64) + sizeof(FILE_ID_128) + sizeof(UINT64) + 2 * sizeof(UINT32) + sizeof(UINT64);
+
+    //
+    // Upper bound of the file size accepted by Load, to not allocate an
+    // arbitrary amount of memory for a corrupted file.
+    //
+    const UINT64 CHECKPOINT_MAX_FILE_SIZE = 64 * 1024 * 1024;
+
+    template <typename T>
+    void AppendCheckpointValue(
+        _Inout_ std::vector<BYTE>& Buffer,
+        _In_ const T& Value
+        )
+    {
+        const BYTE* bytes = reinterpret_cast<const BYTE*>(&Value);
+        Buffer.insert(Buffer.end(), bytes, bytes + sizeof(T));
+    }
+
+    template <typename T>
+    T ReadCheckpointValue(
+        _In_reads_bytes_(sizeof(T)) const BYTE* Buffer
+        )
+    {
+        T value;
+        memcpy(&value, Buffer, sizeof(T));
+        return value;
+    }
+}
+
+///
+/// Computes the FNV-1a hash of a buffer.
+///
+/// \param Buffer       The bytes to hash.
+/// \param Size         Size of the buffer in bytes.
+///
+/// \return The 64 bits hash.
+///
+UINT64
+LogFileCheckpointStore::ComputeFingerprint(
+    _In_reads_bytes_(Size) const BYTE* Buffer,
+    _In_ size_t Size
+    )
+{
+    UINT64 hash = 14695981039346656037ULL;
+
+    for (size_t i = 0; i < Size; i++)
+    {
+        hash = (hash ^ Buffer[i]) * 1099511628211ULL;
+    }
+
+    return hash;
+}
+
+void
+LogFileCheckpointStore::Serialize(
+    _In_ const std::vector<LogFileCheckpoint>& Checkpoints,
+    _Out_ std::vector<BYTE>& Buffer
+    )
+{
+    Buffer.clear();
+    Buffer.reserve(CHECKPOINT_HEADER_SIZE + Checkpoints.size() * CHECKPOINT_RECORD_SIZE + sizeof(UINT64));
+
+    AppendCheckpointValue(Buffer, FILE_MAGIC);
+    AppendCheckpointValue(Buffer, FILE_VERSION);
+    AppendCheckpointValue(Buffer, static_cast<UINT32>(Checkpoints.size()));
+
+    for (const auto& checkpoint : Checkpoints)
+    {
+        AppendCheckpointValue(Buffer, static_cast<UINT64>(checkpoint.FileId.VolumeSerialNumber));
+        Buffer.insert(
+            Buffer.end(),
+            checkpoint.FileId.FileId.Identifier,
+            checkpoint.FileId.FileId.Identifier + sizeof(checkpoint.FileId.FileId.Identifier));
+        AppendCheckpointValue(Buffer, checkpoint.NextReadOffset);
+        AppendCheckpointValue(Buffer, static_cast<UINT32>(checkpoint.EncodingType));
+        AppendCheckpointValue(Buffer, checkpoint.FingerprintSize);
+        AppendCheckpointValue(Buffer, checkpoint.Fingerprint);
+    }
+
+    AppendCheckpointValue(Buffer, ComputeFingerprint(Buffer.data(), Buffer.size()));
+}
+
+///
+/// Parses the content of a checkpoint file.
+///
+/// \return False if the content isn't a valid checkpoint file. In that case
+///     Checkpoints is empty.
+///
+bool
+LogFileCheckpointStore::Deserialize(
+    _In_reads_bytes_(Size) const BYTE* Buffer,
+    _In_ size_t Size,
+    _Out_ std::vector<LogFileCheckpoint>& Checkpoints
+    )
+{
+    Checkpoints.clear();
+
+    if (Size < CHECKPOINT_HEADER_SIZE + sizeof(UINT64))
+    {
+        return false;
+    }
+
+    const size_t contentSize = Size - sizeof(UINT64);
+
+    if (ReadCheckpointValue<UINT32>(Buffer) != FILE_MAGIC
+        || ReadCheckpointValue<UINT32>(Buffer + sizeof(UINT32)) != FILE_VERSION
+        || ReadCheckpointValue<UINT64>(Buffer + contentSize) != ComputeFingerprint(Buffer, contentSize))
+    {
+        return false;
+    }
+
+    const UINT32 count = ReadCheckpointValue<UINT32>(Buffer + 2 * sizeof(UINT32));
+
+    if (contentSize != CHECKPOINT_HEADER_SIZE + static_cast<size_t>(count) * CHECKPOINT_RECORD_SIZE)
+    {
+        return false;
+    }
+
+    Checkpoints.resize(count);
+
+    const BYTE* record = Buffer + CHECKPOINT_HEADER_SIZE;
+
+    for (auto& checkpoint : Checkpoints)
+    {
+        const BYTE* field = record;
+
+        checkpoint.FileId.VolumeSerialNumber = ReadCheckpointValue<UINT64>(field);
+        field += sizeof(UINT64);
+
+        memcpy(checkpoint.FileId.FileId.Identifier, field, sizeof(checkpoint.FileId.FileId.Identifier));
+        field += sizeof(checkpoint.FileId.FileId.Identifier);
+
+        checkpoint.NextReadOffset = ReadCheckpointValue<UINT64>(field);
+        field += sizeof(UINT64);
+
+        checkpoint.EncodingType = static_cast<LM_FILETYPE>(ReadCheckpointValue<UINT32>(field));
+        field += sizeof(UINT32);
+
+        checkpoint.FingerprintSize = ReadCheckpointValue<UINT32>(field);
+        field += sizeof(UINT32);
+
+        checkpoint.Fingerprint = ReadCheckpointValue<UINT64>(field);
+
+        record += CHECKPOINT_RECORD_SIZE;
+    }
+
+    return true;
+}
+
+///
+/// Reads the checkpoint file.
+///
+/// \param Checkpoints      Returns the checkpoints stored in the file.
+///
+/// \return ERROR_SUCCESS, ERROR_FILE_NOT_FOUND if there isn't a checkpoint
+///     file yet, ERROR_FILE_CORRUPT if its content isn't valid, or the error
+///     that stopped the read.
+///
+DWORD
+LogFileCheckpointStore::Load(
+    _Out_ std::vector<LogFileCheckpoint>& Checkpoints
+    ) const
+{
+    DWORD status = ERROR_SUCCESS;
+
+    Checkpoints.clear();
+
+    HANDLE checkpointFile = CreateFileW(m_filePath.c_str(),
+                                        GENERIC_READ,
+                                        FILE_SHARE_READ,
+                                        nullptr,
+                                        OPEN_EXISTING,
+                                        FILE_ATTRIBUTE_NORMAL,
+                                        nullptr);
+    if (checkpointFile == INVALID_HANDLE_VALUE)
+    {
+        status = GetLastError();
+        return (status == ERROR_PATH_NOT_FOUND) ? ERROR_FILE_NOT_FOUND : status;
+    }
+
+    LARGE_INTEGER fileSize = {};
+    std::vector<BYTE> content;
+
+    if (!GetFileSizeEx(checkpointFile, &fileSize))
+    {
+        status = GetLastError();
+    }
+    else if (static_cast<UINT64>(fileSize.QuadPart) > CHECKPOINT_MAX_FILE_SIZE)
+    {
+        status = ERROR_FILE_CORRUPT;
+    }
+    else
+    {
+        DWORD bytesRead = 0;
+
+        content.resize(static_cast<size_t>(fileSize.QuadPart));
+
+        if (!content.empty()
+            && !ReadFile(checkpointFile, content.data(), static_cast<DWORD>(content.size()), &bytesRead, nullptr))
+        {
+            status = GetLastError();
+        }
+        else if (bytesRead != content.size()
+            || !Deserialize(content.data(), content.size(), Checkpoints))
+        {
+            status = ERROR_FILE_CORRUPT;
+        }
+    }
+
+    CloseHandle(checkpointFile);
+
+    return status;
+}
+
+///
+/// Replaces the checkpoint file with the given checkpoints. The new file is
+/// flushed to disk before it replaces the previous one, so the checkpoint
+/// file is always complete.
+///
+/// \param Checkpoints      The checkpoints to store.
+///
+/// \return ERROR_SUCCESS, or the error that stopped the write.
+///
+DWORD
+LogFileCheckpointStore::Save(
+    _In_ const std::vector<LogFileCheckpoint>& Checkpoints
+    ) const
+{
+    DWORD status = ERROR_SUCCESS;
+    const std::wstring tempFilePath = m_filePath + L".tmp";
+
+    std::vector<BYTE> content;
+    Serialize(Checkpoints, content);
+
+    HANDLE tempFile = CreateFileW(tempFilePath.c_str(),
+                                  GENERIC_WRITE,
+                                  0,
+                                  nullptr,
+                                  CREATE_ALWAYS,
+                                  FILE_ATTRIBUTE_NORMAL,
+                                  nullptr);
+    if (tempFile == INVALID_HANDLE_VALUE)
+    {
+        return GetLastError();
+    }
+
+    DWORD bytesWritten = 0;
+
+    if (!WriteFile(tempFile, content.data(), static_cast<DWORD>(content.size()), &bytesWritten, nullptr)
+        || !FlushFileBuffers(tempFile))
+    {
+        status = GetLastError();
+    }
+
+    CloseHandle(tempFile);
+
+    if (status == ERROR_SUCCESS
+        && !MoveFileExW(tempFilePath.c_str(), m_filePath.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH))
+    {
+        status = GetLastError();
+    }
+
+    if (status != ERROR_SUCCESS)
+    {
+        DeleteFileW(tempFilePath.c_str());
+    }
+
+    return status;
+}
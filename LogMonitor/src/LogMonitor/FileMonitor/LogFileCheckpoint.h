@@ -0,0 +1,79 @@
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+
+#pragma once
+
+///
+/// Read position of a monitored log file, saved so a restarted LogMonitor
+/// resumes reading where the previous instance stopped.
+///
+struct LogFileCheckpoint
+{
+    FILE_ID_INFO FileId;
+    UINT64 NextReadOffset;
+    LM_FILETYPE EncodingType;
+
+    //
+    // Hash of the first FingerprintSize bytes of the file. It detects a
+    // file ID reused by a different file.
+    //
+    UINT32 FingerprintSize;
+    UINT64 Fingerprint;
+};
+
+///
+/// Stores the checkpoints of a LogFileMonitor in a binary file.
+///
+/// The file is replaced atomically: the checkpoints are written to a
+/// temporary file, flushed to disk, and then moved over the previous one.
+/// A checksum protects against partially written or corrupted files.
+///
+class LogFileCheckpointStore final
+{
+public:
+    static constexpr UINT32 FINGERPRINT_MAX_BYTES = 1024;
+
+    LogFileCheckpointStore(
+        _In_ const std::wstring& FilePath
+        ) :
+        m_filePath(FilePath)
+    {
+    }
+
+    const std::wstring& GetFilePath() const
+    {
+        return m_filePath;
+    }
+
+    DWORD Load(
+        _Out_ std::vector<LogFileCheckpoint>& Checkpoints
+        ) const;
+
+    DWORD Save(
+        _In_ const std::vector<LogFileCheckpoint>& Checkpoints
+        ) const;
+
+    static void Serialize(
+        _In_ const std::vector<LogFileCheckpoint>& Checkpoints,
+        _Out_ std::vector<BYTE>& Buffer
+        );
+
+    static bool Deserialize(
+        _In_reads_bytes_(Size) const BYTE* Buffer,
+        _In_ size_t Size,
+        _Out_ std::vector<LogFileCheckpoint>& Checkpoints
+        );
+
+    static UINT64 ComputeFingerprint(
+        _In_reads_bytes_(Size) const BYTE* Buffer,
+        _In_ size_t Size
+        );
+
+private:
+    static constexpr UINT32 FILE_MAGIC = 0x50434D4C; // "LMCP"
+    static constexpr UINT32 FILE_VERSION = 1;
+
+    std::wstring m_filePath;
+};
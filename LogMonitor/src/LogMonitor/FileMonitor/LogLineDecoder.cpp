@@ -0,0 +1,583 @@
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+
+#include "pch.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define LOG_LINE_DECODER_SSE2
+#endif
+
+///
+/// LogLineDecoder.cpp
+///
+/// Decodes the content of a log file to UTF-8 and splits it into lines.
+///
+/// Line breaks are LF, CR LF and a single CR. The line break characters are
+/// not part of the reported lines.
+///
+
+constexpr size_t LogLineDecoder::MAX_LINE_BYTES;
+
+LogLineDecoder::LogLineDecoder()
+{
+    Reset();
+}
+
+///
+/// Sets the encoding of the decoded content. Changing the encoding discards
+/// the incomplete code units of the previous encoding.
+///
+/// \param EncodingType     The encoding of the bytes passed to Decode.
+///
+void
+LogLineDecoder::SetEncoding(
+    _In_ LM_FILETYPE EncodingType
+    )
+{
+    if (m_encoding != EncodingType)
+    {
+        m_encoding = EncodingType;
+        m_pendingBytesCount = 0;
+        m_pendingHighSurrogate = 0;
+    }
+}
+
+///
+/// Discards all the state kept between chunks.
+///
+void
+LogLineDecoder::Reset()
+{
+    m_encoding = LM_FILETYPE::FileTypeUnknown;
+    m_pendingBytesCount = 0;
+    m_pendingHighSurrogate = 0;
+    m_skipLineFeed = false;
+    m_decoded.clear();
+    m_partialLine.clear();
+}
+
+///
+/// Decodes a chunk of the file and invokes OnLine for every line completed
+/// by it. The content after the last line break is kept until the next call.
+///
+/// \param Buffer       The bytes read from the file.
+/// \param Size         Size of the buffer in bytes.
+/// \param OnLine       Callback invoked with each complete line.
+///
+void
+LogLineDecoder::Decode(
+    _In_reads_bytes_(Size) const BYTE* Buffer,
+    _In_ size_t Size,
+    _In_ const LineCallback& OnLine
+    )
+{
+    m_decoded.clear();
+
+    switch (m_encoding)
+    {
+        case LM_FILETYPE::UTF16LE:
+            DecodeUtf16(Buffer, Size, false);
+            SplitLines(m_decoded.data(), m_decoded.size(), OnLine);
+            break;
+
+        case LM_FILETYPE::UTF16BE:
+            DecodeUtf16(Buffer, Size, true);
+            SplitLines(m_decoded.data(), m_decoded.size(), OnLine);
+            break;
+
+        case LM_FILETYPE::UTF8:
+            DecodeUtf8(Buffer, Size, OnLine);
+            break;
+
+        default:
+            DecodeAnsi(Buffer, Size, OnLine);
+            break;
+    }
+}
+
+///
+/// Reports the incomplete line, if any. Incomplete code units are kept,
+/// because the rest of them could still be written to the file.
+///
+/// \param OnLine       Callback invoked with the incomplete line.
+///
+void
+LogLineDecoder::Flush(
+    _In_ const LineCallback& OnLine
+    )
+{
+    if (!m_partialLine.empty())
+    {
+        OnLine(m_partialLine.data(), m_partialLine.size());
+        m_partialLine.clear();
+    }
+}
+
+///
+/// Looks for the first CR or LF character.
+///
+/// \param Data         The UTF-8 content.
+/// \param Length       Number of bytes in Data.
+///
+/// \return The index of the first line break character, or Length if there isn't any.
+///
+size_t
+LogLineDecoder::FindLineBreak(
+    _In_reads_(Length) const char* Data,
+    _In_ size_t Length
+    )
+{
+    size_t i = 0;
+
+#ifdef LOG_LINE_DECODER_SSE2
+    const __m128i carriageReturn = _mm_set1_epi8('\r');
+    const __m128i lineFeed = _mm_set1_epi8('\n');
+
+    for (; i + 16 <= Length; i += 16)
+    {
+        const __m128i chars = _mm_loadu_si128(reinterpret_cast<const __m128i*>(Data + i));
+        const __m128i matches = _mm_or_si128(
+            _mm_cmpeq_epi8(chars, carriageReturn),
+            _mm_cmpeq_epi8(chars, lineFeed));
+
+        const unsigned int mask = static_cast<unsigned int>(_mm_movemask_epi8(matches));
+        if (mask != 0)
+        {
+#ifdef _MSC_VER
+            unsigned long bitIndex;
+            _BitScanForward(&bitIndex, mask);
+#else
+            const unsigned int bitIndex = static_cast<unsigned int>(__builtin_ctz(mask));
+#endif
+            return i + bitIndex;
+        }
+    }
+#endif
+
+    for (; i < Length; i++)
+    {
+        if (Data[i] == '\r' || Data[i] == '\n')
+        {
+            return i;
+        }
+    }
+
+    return Length;
+}
+
+///
+/// Returns the number of ASCII bytes at the beginning of the buffer.
+///
+size_t
+LogLineDecoder::SkipAscii(
+    _In_reads_bytes_(Size) const BYTE* Buffer,
+    _In_ size_t Size
+    )
+{
+    size_t i = 0;
+
+#ifdef LOG_LINE_DECODER_SSE2
+    for (; i + 16 <= Size; i += 16)
+    {
+        const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(Buffer + i));
+
+        if (_mm_movemask_epi8(bytes) != 0)
+        {
+            break;
+        }
+    }
+#endif
+
+    while (i < Size && Buffer[i] < 0x80)
+    {
+        i++;
+    }
+
+    return i;
+}
+
+void
+LogLineDecoder::SplitLines(
+    _In_reads_(Length) const char* Data,
+    _In_ size_t Length,
+    _In_ const LineCallback& OnLine
+    )
+{
+    size_t start = 0;
+
+    if (m_skipLineFeed && Length > 0)
+    {
+        //
+        // Second half of a CR LF split between two chunks.
+        //
+        if (Data[0] == '\n')
+        {
+            start = 1;
+        }
+        m_skipLineFeed = false;
+    }
+
+    while (start < Length)
+    {
+        size_t lineBreak = start + FindLineBreak(Data + start, Length - start);
+
+        if (lineBreak == Length)
+        {
+            m_partialLine.append(Data + start, Length - start);
+
+            if (m_partialLine.size() >= MAX_LINE_BYTES)
+            {
+                //
+                // The chunks end on whole code points, so the line is split
+                // between two characters.
+                //
+                OnLine(m_partialLine.data(), m_partialLine.size());
+                std::string().swap(m_partialLine);
+            }
+
+            break;
+        }
+
+        if (m_partialLine.empty())
+        {
+            OnLine(Data + start, lineBreak - start);
+        }
+        else
+        {
+            m_partialLine.append(Data + start, lineBreak - start);
+            OnLine(m_partialLine.data(), m_partialLine.size());
+            m_partialLine.clear();
+        }
+
+        if (Data[lineBreak] == '\r')
+        {
+            if (lineBreak + 1 < Length)
+            {
+                if (Data[lineBreak + 1] == '\n')
+                {
+                    lineBreak++;
+                }
+            }
+            else
+            {
+                m_skipLineFeed = true;
+            }
+        }
+
+        start = lineBreak + 1;
+    }
+}
+
+///
+/// Transcodes UTF-16 content to UTF-8. Unpaired surrogates are decoded as
+/// U+FFFD.
+///
+void
+LogLineDecoder::DecodeUtf16(
+    _In_reads_bytes_(Size) const BYTE* Buffer,
+    _In_ size_t Size,
+    _In_ bool BigEndian
+    )
+{
+    size_t i = 0;
+
+    m_decoded.reserve(Size);
+
+    if (m_pendingBytesCount == 1 && Size > 0)
+    {
+        const BYTE first = m_pendingBytes[0];
+        const BYTE second = Buffer[0];
+
+        AppendUtf16Unit(static_cast<UINT16>(BigEndian ? ((first << 8) | second) : ((second << 8) | first)));
+        m_pendingBytesCount = 0;
+        i = 1;
+    }
+
+    const int high = BigEndian ? 0 : 1;
+    const int low = BigEndian ? 1 : 0;
+
+    for (; i + 1 < Size; i += sizeof(UINT16))
+    {
+        const UINT16 unit = static_cast<UINT16>((Buffer[i + high] << 8) | Buffer[i + low]);
+
+        if (unit < 0x80 && m_pendingHighSurrogate == 0)
+        {
+            m_decoded.push_back(static_cast<char>(unit));
+        }
+        else
+        {
+            AppendUtf16Unit(unit);
+        }
+    }
+
+    if (i < Size)
+    {
+        m_pendingBytes[0] = Buffer[i];
+        m_pendingBytesCount = 1;
+    }
+}
+
+void
+LogLineDecoder::AppendUtf16Unit(
+    _In_ UINT16 Unit
+    )
+{
+    if (m_pendingHighSurrogate != 0)
+    {
+        const UINT16 highSurrogate = m_pendingHighSurrogate;
+        m_pendingHighSurrogate = 0;
+
+        if (Unit >= 0xDC00 && Unit <= 0xDFFF)
+        {
+            AppendCodePoint(0x10000 + ((static_cast<UINT32>(highSurrogate) - 0xD800) << 10) + (Unit - 0xDC00));
+            return;
+        }
+
+        AppendCodePoint(REPLACEMENT_CHARACTER);
+    }
+
+    if (Unit >= 0xD800 && Unit <= 0xDBFF)
+    {
+        m_pendingHighSurrogate = Unit;
+    }
+    else if (Unit >= 0xDC00 && Unit <= 0xDFFF)
+    {
+        AppendCodePoint(REPLACEMENT_CHARACTER);
+    }
+    else
+    {
+        AppendCodePoint(Unit);
+    }
+}
+
+///
+/// Validates UTF-8 content and splits it into lines. Valid content is split
+/// in place. Invalid sequences are replaced by U+FFFD in a copy.
+///
+void
+LogLineDecoder::DecodeUtf8(
+    _In_reads_bytes_(Size) const BYTE* Buffer,
+    _In_ size_t Size,
+    _In_ const LineCallback& OnLine
+    )
+{
+    size_t i = 0;
+    UINT32 codePoint = 0;
+
+    if (m_pendingBytesCount > 0)
+    {
+        //
+        // Complete the sequence started in the previous chunk.
+        //
+        BYTE sequence[sizeof(m_pendingBytes)];
+        const size_t pendingCount = m_pendingBytesCount;
+        const size_t copyCount = (std::min)(sizeof(sequence) - pendingCount, Size);
+
+        memcpy(sequence, m_pendingBytes, pendingCount);
+        memcpy(sequence + pendingCount, Buffer, copyCount);
+
+        const size_t sequenceLength = DecodeUtf8Sequence(sequence, pendingCount + copyCount, codePoint);
+        if (sequenceLength == 0)
+        {
+            //
+            // Still incomplete.
+            //
+            memcpy(m_pendingBytes + pendingCount, Buffer, copyCount);
+            m_pendingBytesCount += copyCount;
+            return;
+        }
+
+        AppendCodePoint(codePoint == INVALID_SEQUENCE ? REPLACEMENT_CHARACTER : codePoint);
+        m_pendingBytesCount = 0;
+
+        //
+        // An invalid sequence can end before the bytes of this chunk.
+        //
+        i = (sequenceLength > pendingCount) ? sequenceLength - pendingCount : 0;
+    }
+
+    const size_t start = i;
+
+    //
+    // Start of the bytes that are valid but haven't been copied to
+    // m_decoded. Only used once the chunk needs a copy.
+    //
+    size_t copyStart = i;
+    bool copied = !m_decoded.empty();
+
+    while (i < Size)
+    {
+        i += SkipAscii(Buffer + i, Size - i);
+
+        if (i == Size)
+        {
+            break;
+        }
+
+        const size_t sequenceLength = DecodeUtf8Sequence(Buffer + i, Size - i, codePoint);
+        if (sequenceLength == 0)
+        {
+            //
+            // The chunk ends in the middle of a sequence.
+            //
+            m_pendingBytesCount = Size - i;
+            memcpy(m_pendingBytes, Buffer + i, m_pendingBytesCount);
+            break;
+        }
+
+        if (codePoint == INVALID_SEQUENCE)
+        {
+            m_decoded.append(reinterpret_cast<const char*>(Buffer) + copyStart, i - copyStart);
+            AppendCodePoint(REPLACEMENT_CHARACTER);
+            copyStart = i + sequenceLength;
+            copied = true;
+        }
+
+        i += sequenceLength;
+    }
+
+    if (!copied)
+    {
+        SplitLines(reinterpret_cast<const char*>(Buffer) + start, i - start, OnLine);
+        return;
+    }
+
+    m_decoded.append(reinterpret_cast<const char*>(Buffer) + copyStart, i - copyStart);
+    SplitLines(m_decoded.data(), m_decoded.size(), OnLine);
+}
+
+///
+/// Decodes ANSI content as Latin-1. Chunks that are only ASCII are split in
+/// place.
+///
+void
+LogLineDecoder::DecodeAnsi(
+    _In_reads_bytes_(Size) const BYTE* Buffer,
+    _In_ size_t Size,
+    _In_ const LineCallback& OnLine
+    )
+{
+    const size_t asciiLength = SkipAscii(Buffer, Size);
+
+    if (asciiLength == Size)
+    {
+        SplitLines(reinterpret_cast<const char*>(Buffer), Size, OnLine);
+        return;
+    }
+
+    m_decoded.reserve(Size + (Size - asciiLength));
+    m_decoded.assign(reinterpret_cast<const char*>(Buffer), asciiLength);
+
+    for (size_t i = asciiLength; i < Size; i++)
+    {
+        AppendCodePoint(Buffer[i]);
+    }
+
+    SplitLines(m_decoded.data(), m_decoded.size(), OnLine);
+}
+
+void
+LogLineDecoder::AppendCodePoint(
+    _In_ UINT32 CodePoint
+    )
+{
+    if (CodePoint < 0x80)
+    {
+        m_decoded.push_back(static_cast<char>(CodePoint));
+    }
+    else if (CodePoint < 0x800)
+    {
+        m_decoded.push_back(static_cast<char>(0xC0 | (CodePoint >> 6)));
+        m_decoded.push_back(static_cast<char>(0x80 | (CodePoint & 0x3F)));
+    }
+    else if (CodePoint < 0x10000)
+    {
+        m_decoded.push_back(static_cast<char>(0xE0 | (CodePoint >> 12)));
+        m_decoded.push_back(static_cast<char>(0x80 | ((CodePoint >> 6) & 0x3F)));
+        m_decoded.push_back(static_cast<char>(0x80 | (CodePoint & 0x3F)));
+    }
+    else
+    {
+        m_decoded.push_back(static_cast<char>(0xF0 | (CodePoint >> 18)));
+        m_decoded.push_back(static_cast<char>(0x80 | ((CodePoint >> 12) & 0x3F)));
+        m_decoded.push_back(static_cast<char>(0x80 | ((CodePoint >> 6) & 0x3F)));
+        m_decoded.push_back(static_cast<char>(0x80 | (CodePoint & 0x3F)));
+    }
+}
+
+///
+/// Decodes one UTF-8 sequence.
+///
+/// \param Buffer       Start of the sequence.
+/// \param Size         Number of available bytes.
+/// \param CodePoint    Returns the decoded code point, or INVALID_SEQUENCE.
+///
+/// \return The number of bytes consumed, or 0 if the sequence is valid so
+///     far but incomplete.
+///
+size_t
+LogLineDecoder::DecodeUtf8Sequence(
+    _In_reads_bytes_(Size) const BYTE* Buffer,
+    _In_ size_t Size,
+    _Out_ UINT32& CodePoint
+    )
+{
+    const BYTE lead = Buffer[0];
+    size_t sequenceLength;
+    UINT32 minimum;
+
+    if (lead < 0x80)
+    {
+        CodePoint = lead;
+        return 1;
+    }
+    else if ((lead & 0xE0) == 0xC0)
+    {
+        sequenceLength = 2;
+        minimum = 0x80;
+        CodePoint = lead & 0x1F;
+    }
+    else if ((lead & 0xF0) == 0xE0)
+    {
+        sequenceLength = 3;
+        minimum = 0x800;
+        CodePoint = lead & 0x0F;
+    }
+    else if ((lead & 0xF8) == 0xF0)
+    {
+        sequenceLength = 4;
+        minimum = 0x10000;
+        CodePoint = lead & 0x07;
+    }
+    else
+    {
+        CodePoint = INVALID_SEQUENCE;
+        return 1;
+    }
+
+    for (size_t i = 1; i < sequenceLength; i++)
+    {
+        if (i >= Size)
+        {
+            return 0;
+        }
+
+        if ((Buffer[i] & 0xC0) != 0x80)
+        {
+            CodePoint = INVALID_SEQUENCE;
+            return i;
+        }
+
+        CodePoint = (CodePoint << 6) | (Buffer[i] & 0x3F);
+    }
+
+    if (CodePoint < minimum || CodePoint > 0x10FFFF || (CodePoint >= 0xD800 && CodePoint <= 0xDFFF))
+    {
+        CodePoint = INVALID_SEQUENCE;
+    }
+
+    return sequenceLength;
+}
@@ -0,0 +1,157 @@
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+
+#pragma once
+
+///
+/// LogMonitor filetype
+///
+enum LM_FILETYPE {
+    FileTypeUnknown,
+    ANSI,
+    UTF16LE,
+    UTF16BE,
+    UTF8
+};
+
+///
+/// Stateful decoder and line splitter for the content of a log file.
+///
+/// The content of a log file is read in chunks of arbitrary size, so a UTF-8
+/// multibyte sequence, a UTF-16 code unit or a CR LF pair can be split
+/// between two reads. LogLineDecoder keeps the incomplete code units and the
+/// incomplete line between calls to Decode, and reports every complete line
+/// as a view (pointer and length) into the read buffer or its internal
+/// buffers. The views are only valid during the callback.
+///
+/// The lines are reported in UTF-8, the encoding of the output. Valid UTF-8
+/// content, and ANSI content that is only ASCII, is split in place without
+/// being copied or transcoded. UTF-16 content is transcoded once.
+///
+/// A line that grows past MAX_LINE_BYTES without a line break is reported
+/// at the end of the chunk that exceeds it, so a file without line breaks
+/// doesn't make the incomplete line grow without bounds.
+///
+/// The decoder doesn't call any Win32 API, so it can be exercised with
+/// synthetic byte streams.
+///
+class LogLineDecoder final
+{
+public:
+    static constexpr size_t MAX_LINE_BYTES = 1024 * 1024;
+
+    typedef std::function<void(_In_reads_(Length) const char* Line, _In_ size_t Length)> LineCallback;
+
+    LogLineDecoder();
+
+    void SetEncoding(
+        _In_ LM_FILETYPE EncodingType
+        );
+
+    LM_FILETYPE GetEncoding() const
+    {
+        return m_encoding;
+    }
+
+    void Decode(
+        _In_reads_bytes_(Size) const BYTE* Buffer,
+        _In_ size_t Size,
+        _In_ const LineCallback& OnLine
+        );
+
+    void Flush(
+        _In_ const LineCallback& OnLine
+        );
+
+    void Reset();
+
+    static size_t FindLineBreak(
+        _In_reads_(Length) const char* Data,
+        _In_ size_t Length
+        );
+
+private:
+    static constexpr UINT32 REPLACEMENT_CHARACTER = 0xFFFD;
+
+    //
+    // Returned by DecodeUtf8Sequence for an invalid sequence, to tell it
+    // apart from an encoded U+FFFD.
+    //
+    static constexpr UINT32 INVALID_SEQUENCE = 0xFFFFFFFF;
+
+    LM_FILETYPE m_encoding;
+
+    //
+    // Bytes of an incomplete code unit (UTF-16) or code point (UTF-8)
+    // at the end of the last decoded chunk.
+    //
+    BYTE m_pendingBytes[4];
+    size_t m_pendingBytesCount;
+
+    //
+    // UTF-16 high surrogate at the end of the last decoded chunk, or 0.
+    //
+    UINT16 m_pendingHighSurrogate;
+
+    //
+    // The last chunk ended with a CR, so a LF at the beginning of the
+    // next chunk belongs to the same line break.
+    //
+    bool m_skipLineFeed;
+
+    //
+    // Content of the current chunk, transcoded to UTF-8 when it can't be
+    // split in place. Reused between calls.
+    //
+    std::string m_decoded;
+
+    //
+    // Content of the current line that hasn't been terminated yet.
+    //
+    std::string m_partialLine;
+
+    void DecodeUtf8(
+        _In_reads_bytes_(Size) const BYTE* Buffer,
+        _In_ size_t Size,
+        _In_ const LineCallback& OnLine
+        );
+
+    void DecodeUtf16(
+        _In_reads_bytes_(Size) const BYTE* Buffer,
+        _In_ size_t Size,
+        _In_ bool BigEndian
+        );
+
+    void DecodeAnsi(
+        _In_reads_bytes_(Size) const BYTE* Buffer,
+        _In_ size_t Size,
+        _In_ const LineCallback& OnLine
+        );
+
+    void AppendUtf16Unit(
+        _In_ UINT16 Unit
+        );
+
+    void AppendCodePoint(
+        _In_ UINT32 CodePoint
+        );
+
+    void SplitLines(
+        _In_reads_(Length) const char* Data,
+        _In_ size_t Length,
+        _In_ const LineCallback& OnLine
+        );
+
+    static size_t SkipAscii(
+        _In_reads_bytes_(Size) const BYTE* Buffer,
+        _In_ size_t Size
+        );
+
+    static size_t DecodeUtf8Sequence(
+        _In_reads_bytes_(Size) const BYTE* Buffer,
+        _In_ size_t Size,
+        _Out_ UINT32& CodePoint
+        );
+};
@@ -0,0 +1,282 @@
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+
+#include "pch.h"
+
+constexpr size_t LogReaderPool::MAX_THREAD_COUNT;
+constexpr size_t LogReaderPool::MAX_JOBS_PER_TURN;
+
+LogReaderPool::LogReaderPool(
+    _In_ size_t ThreadCount
+    ) :
+    m_stopping(false)
+{
+    InitializeSRWLock(&m_lock);
+    InitializeConditionVariable(&m_workAvailable);
+    InitializeConditionVariable(&m_strandIdle);
+
+    if (ThreadCount == 0)
+    {
+        ThreadCount = 1;
+    }
+    else if (ThreadCount > MAX_THREAD_COUNT)
+    {
+        ThreadCount = MAX_THREAD_COUNT;
+    }
+
+    for (size_t i = 0; i < ThreadCount; i++)
+    {
+        HANDLE thread = CreateThread(
+            nullptr,
+            0,
+            (LPTHREAD_START_ROUTINE)&LogReaderPool::WorkerThreadStatic,
+            this,
+            0,
+            nullptr);
+        if (!thread)
+        {
+            DWORD status = GetLastError();
+
+            if (m_threads.empty())
+            {
+                throw std::system_error(std::error_code(status, std::system_category()), "CreateThread");
+            }
+
+            logWriter.TraceWarning(
+                FORMAT_STRING(
+                    L"Failed to create log reader thread. The log reader pool will use %zu threads. Error: %lu",
+                    m_threads.size(),
+                    status
+                ).c_str()
+            );
+            break;
+        }
+
+        m_threads.push_back(thread);
+    }
+}
+
+LogReaderPool::~LogReaderPool()
+{
+    AcquireSRWLockExclusive(&m_lock);
+    m_stopping = true;
+    ReleaseSRWLockExclusive(&m_lock);
+
+    WakeAllConditionVariable(&m_workAvailable);
+
+    WaitForMultipleObjects(static_cast<DWORD>(m_threads.size()), m_threads.data(), TRUE, INFINITE);
+
+    for (HANDLE thread : m_threads)
+    {
+        CloseHandle(thread);
+    }
+}
+
+///
+/// \return The pool shared by all the log file monitors. It's created on the
+///     first call, and the function keeps a reference to it until the process
+///     exits, so its threads are created once even if the monitors are all
+///     stopped and started again. The pool isn't released with the last
+///     strand: a strand can be released by a job, on a thread the destructor
+///     of the pool would wait for.
+///
+std::shared_ptr<LogReaderPool>
+LogReaderPool::Shared()
+{
+    static std::shared_ptr<LogReaderPool> sharedPool = std::make_shared<LogReaderPool>(DefaultThreadCount());
+
+    return sharedPool;
+}
+
+///
+/// Gets the number of processors LogMonitor can use: the processors of its
+/// affinity mask, reduced by the CPU rate hard cap of the job object when
+/// it runs in a container with a CPU limit.
+///
+/// \return The number of threads of the shared pool.
+///
+size_t
+LogReaderPool::DefaultThreadCount()
+{
+    size_t processorCount = 0;
+    DWORD_PTR processAffinity = 0;
+    DWORD_PTR systemAffinity = 0;
+
+    if (GetProcessAffinityMask(GetCurrentProcess(), &processAffinity, &systemAffinity))
+    {
+        for (; processAffinity != 0; processAffinity &= processAffinity - 1)
+        {
+            processorCount++;
+        }
+    }
+
+    if (processorCount == 0)
+    {
+        processorCount = GetActiveProcessorCount(ALL_PROCESSOR_GROUPS);
+    }
+
+    JOBOBJECT_CPU_RATE_CONTROL_INFORMATION cpuRate = {};
+
+    if (QueryInformationJobObject(nullptr,
+                                  JobObjectCpuRateControlInformation,
+                                  &cpuRate,
+                                  sizeof(cpuRate),
+                                  nullptr)
+        && (cpuRate.ControlFlags & JOB_OBJECT_CPU_RATE_CONTROL_ENABLE)
+        && (cpuRate.ControlFlags & (JOB_OBJECT_CPU_RATE_CONTROL_HARD_CAP | JOB_OBJECT_CPU_RATE_CONTROL_MIN_MAX_RATE)))
+    {
+        //
+        // The rate is the share of all the processors, in 1/100 of a percent.
+        //
+        const size_t rate = (cpuRate.ControlFlags & JOB_OBJECT_CPU_RATE_CONTROL_MIN_MAX_RATE)
+            ? cpuRate.MaxRate
+            : cpuRate.CpuRate;
+        const size_t systemProcessors = GetActiveProcessorCount(ALL_PROCESSOR_GROUPS);
+        const size_t quota = (systemProcessors * rate + 9999) / 10000;
+
+        if (quota < processorCount)
+        {
+            processorCount = quota;
+        }
+    }
+
+    if (processorCount == 0)
+    {
+        processorCount = 1;
+    }
+
+    return processorCount < MAX_THREAD_COUNT ? processorCount : MAX_THREAD_COUNT;
+}
+
+DWORD
+LogReaderPool::WorkerThreadStatic(
+    _In_ LPVOID Context
+    )
+{
+    reinterpret_cast<LogReaderPool*>(Context)->WorkerThread();
+
+    return ERROR_SUCCESS;
+}
+
+void
+LogReaderPool::WorkerThread()
+{
+    AcquireSRWLockExclusive(&m_lock);
+
+    while (true)
+    {
+        while (!m_stopping && m_readyStrands.empty())
+        {
+            SleepConditionVariableSRW(&m_workAvailable, &m_lock, INFINITE, 0);
+        }
+
+        if (m_stopping)
+        {
+            break;
+        }
+
+        LogReaderStrand* strand = m_readyStrands.front();
+        m_readyStrands.pop();
+
+        for (size_t i = 0; i < MAX_JOBS_PER_TURN && !strand->m_jobs.empty(); i++)
+        {
+            Job job = std::move(strand->m_jobs.front());
+            strand->m_jobs.pop();
+
+            ReleaseSRWLockExclusive(&m_lock);
+
+            try
+            {
+                job();
+            }
+            catch (...)
+            {
+                logWriter.TraceError(L"Unexpected error in a log reader job.");
+            }
+
+            AcquireSRWLockExclusive(&m_lock);
+        }
+
+        if (strand->m_jobs.empty())
+        {
+            strand->m_scheduled = false;
+            WakeAllConditionVariable(&m_strandIdle);
+        }
+        else
+        {
+            m_readyStrands.push(strand);
+            WakeConditionVariable(&m_workAvailable);
+        }
+    }
+
+    ReleaseSRWLockExclusive(&m_lock);
+}
+
+LogReaderStrand::LogReaderStrand(
+    _In_ std::shared_ptr<LogReaderPool> Pool
+    ) :
+    m_pool(std::move(Pool)),
+    m_scheduled(false),
+    m_closed(false)
+{
+}
+
+LogReaderStrand::~LogReaderStrand()
+{
+    Close();
+}
+
+///
+/// Queues a job, to run after the jobs already posted to the strand.
+///
+/// \param Job          The job.
+///
+/// \return False if the strand was closed. The job isn't run.
+///
+bool
+LogReaderStrand::Post(
+    _In_ LogReaderPool::Job Job
+    )
+{
+    AcquireSRWLockExclusive(&m_pool->m_lock);
+
+    if (m_closed)
+    {
+        ReleaseSRWLockExclusive(&m_pool->m_lock);
+        return false;
+    }
+
+    m_jobs.push(std::move(Job));
+
+    if (!m_scheduled)
+    {
+        m_scheduled = true;
+        m_pool->m_readyStrands.push(this);
+        WakeConditionVariable(&m_pool->m_workAvailable);
+    }
+
+    ReleaseSRWLockExclusive(&m_pool->m_lock);
+
+    return true;
+}
+
+///
+/// Stops accepting jobs, and waits until the jobs already posted finish.
+/// It must not be called from a job of the same strand.
+///
+void
+LogReaderStrand::Close()
+{
+    AcquireSRWLockExclusive(&m_pool->m_lock);
+
+    m_closed = true;
+
+    while (m_scheduled)
+    {
+        SleepConditionVariableSRW(&m_pool->m_strandIdle, &m_pool->m_lock, INFINITE, 0);
+    }
+
+    ReleaseSRWLockExclusive(&m_pool->m_lock);
+}
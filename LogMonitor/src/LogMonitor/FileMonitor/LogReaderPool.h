@@ -0,0 +1,109 @@
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+
+#pragma once
+
+class LogReaderStrand;
+
+///
+/// Fixed set of threads shared by all the LogFileMonitor instances to read
+/// log files, instead of a reader thread per monitored directory.
+///
+/// Work is submitted through strands. The jobs of a strand run one at a
+/// time and in the order they were posted, so a LogFileMonitor keeps the
+/// order of the reads of each file and doesn't need to lock its tables.
+/// Different strands run in parallel. A worker runs up to
+/// MAX_JOBS_PER_TURN jobs of a strand before moving it to the back of the
+/// ready queue, so a busy directory doesn't starve the others.
+///
+class LogReaderPool final
+{
+public:
+    typedef std::function<void()> Job;
+
+    static constexpr size_t MAX_THREAD_COUNT = 16;
+    static constexpr size_t MAX_JOBS_PER_TURN = 16;
+
+    LogReaderPool(
+        _In_ size_t ThreadCount
+        );
+
+    LogReaderPool(const LogReaderPool&) = delete;
+    LogReaderPool& operator=(const LogReaderPool&) = delete;
+
+    ~LogReaderPool();
+
+    size_t ThreadCount() const
+    {
+        return m_threads.size();
+    }
+
+    static std::shared_ptr<LogReaderPool> Shared();
+
+    static size_t DefaultThreadCount();
+
+private:
+    friend class LogReaderStrand;
+
+    SRWLOCK m_lock;
+
+    //
+    // Signaled when a strand is added to the ready queue, or on stop.
+    //
+    CONDITION_VARIABLE m_workAvailable;
+
+    //
+    // Signaled when a strand has no queued or running job.
+    //
+    CONDITION_VARIABLE m_strandIdle;
+
+    std::queue<LogReaderStrand*> m_readyStrands;
+
+    std::vector<HANDLE> m_threads;
+
+    bool m_stopping;
+
+    static DWORD WorkerThreadStatic(
+        _In_ LPVOID Context
+        );
+
+    void WorkerThread();
+};
+
+///
+/// Serial queue of jobs run by a LogReaderPool.
+///
+class LogReaderStrand final
+{
+public:
+    LogReaderStrand(
+        _In_ std::shared_ptr<LogReaderPool> Pool
+        );
+
+    LogReaderStrand(const LogReaderStrand&) = delete;
+    LogReaderStrand& operator=(const LogReaderStrand&) = delete;
+
+    ~LogReaderStrand();
+
+    bool Post(
+        _In_ LogReaderPool::Job Job
+        );
+
+    void Close();
+
+private:
+    friend class LogReaderPool;
+
+    std::shared_ptr<LogReaderPool> m_pool;
+
+    std::queue<LogReaderPool::Job> m_jobs;
+
+    //
+    // True while the strand is in the ready queue or a worker runs its jobs.
+    //
+    bool m_scheduled;
+
+    bool m_closed;
+};
@@ -72,7 +72,7 @@ HANDLE GetLogDirHandle(std::wstring logDirectory, HANDLE stopEvent) {
         {
             status = GetLastError();
             logWriter.TraceError(
-                Utility::FormatString(
+                FORMAT_STRING(
                     L"Failed to create timer object. Log directory %ws will not be monitored for log entries. Error=%d",
                     logDirectory.c_str(),
                     status
@@ -90,7 +90,7 @@ HANDLE GetLogDirHandle(std::wstring logDirectory, HANDLE stopEvent) {
             {
                 status = GetLastError();
                 logWriter.TraceError(
-                    Utility::FormatString(
+                    FORMAT_STRING(
                         L"Failed to set timer object to monitor log file changes in directory %s. Error: %lu",
                         logDirectory.c_str(),
                         status
@@ -0,0 +1,217 @@
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+
+#include "pch.h"
+
+#ifdef _WIN32
+
+constexpr DWORD Win32DirectoryWatcher::RECORDS_BUFFER_SIZE_BYTES;
+constexpr DWORD Win32DirectoryWatcher::NOTIFY_FILTERS;
+
+Win32DirectoryWatcher::Win32DirectoryWatcher(
+    _In_ HANDLE DirectoryHandle,
+    _In_ bool IncludeSubfolders
+    ) :
+    m_directoryHandle(DirectoryHandle),
+    m_includeSubfolders(IncludeSubfolders),
+    m_overlappedEvent(NULL),
+    m_overflowed(false),
+    m_records(RECORDS_BUFFER_SIZE_BYTES)
+{
+    ZeroMemory(&m_overlapped, sizeof(m_overlapped));
+
+    m_overlappedEvent = CreateFileMonitorEvent(TRUE, FALSE);
+    m_overlapped.hEvent = m_overlappedEvent;
+}
+
+Win32DirectoryWatcher::~Win32DirectoryWatcher()
+{
+    if (m_directoryHandle != INVALID_HANDLE_VALUE)
+    {
+        //
+        // Wait for the pending read to be cancelled, so the system doesn't
+        // write to the records buffer once it's freed.
+        //
+        DWORD bytesTransferred = 0;
+
+        if (CancelIoEx(m_directoryHandle, &m_overlapped))
+        {
+            GetOverlappedResult(m_directoryHandle, &m_overlapped, &bytesTransferred, TRUE);
+        }
+
+        CloseHandle(m_directoryHandle);
+    }
+
+    if (m_overlappedEvent)
+    {
+        CloseHandle(m_overlappedEvent);
+    }
+}
+
+DWORD
+Win32DirectoryWatcher::Start()
+{
+    return BeginRead();
+}
+
+///
+/// Returns the result of the pending read, and starts the next one.
+///
+DWORD
+Win32DirectoryWatcher::ReadEvents(
+    _Inout_ std::vector<DirChangeNotificationEvent>& Events
+    )
+{
+    if (m_overflowed)
+    {
+        m_overflowed = false;
+
+        ResetEvent(m_overlappedEvent);
+
+        //
+        // The change buffer was full and all events were discarded.
+        //
+        ParseNotifications(nullptr, 0, GetTickCount64(), Events);
+
+        return BeginRead();
+    }
+
+    DWORD bytesTransferred = 0;
+
+    if (!GetOverlappedResult(m_directoryHandle, &m_overlapped, &bytesTransferred, FALSE))
+    {
+        return GetLastError();
+    }
+
+    ParseNotifications(m_records.data(), bytesTransferred, GetTickCount64(), Events);
+
+    return BeginRead();
+}
+
+///
+/// Converts the FILE_NOTIFY_INFORMATION records returned by
+/// ReadDirectoryChangesW to change events.
+///
+/// \param Buffer       The records.
+/// \param Size         Size of the records in bytes. Zero means that the
+///                     system buffer overflowed, which is reported as a
+///                     ReInit event.
+/// \param Timestamp    Timestamp of the events.
+/// \param Events       The events are appended to this vector.
+///
+void
+Win32DirectoryWatcher::ParseNotifications(
+    _In_reads_bytes_(Size) const BYTE* Buffer,
+    _In_ DWORD Size,
+    _In_ UINT64 Timestamp,
+    _Inout_ std::vector<DirChangeNotificationEvent>& Events
+    )
+{
+    DirChangeNotificationEvent changeEvent;
+    changeEvent.Timestamp = Timestamp;
+
+    if (Size == 0)
+    {
+        changeEvent.Action = EventAction::ReInit;
+        Events.push_back(std::move(changeEvent));
+        return;
+    }
+
+    const size_t headerSize = offsetof(FILE_NOTIFY_INFORMATION, FileName);
+    DWORD offset = 0;
+
+    for (;;)
+    {
+        if (Size - offset < headerSize)
+        {
+            break;
+        }
+
+        const FILE_NOTIFY_INFORMATION* fileNotificationInfo =
+            reinterpret_cast<const FILE_NOTIFY_INFORMATION*>(Buffer + offset);
+
+        const DWORD fileNameSize = (std::min)(fileNotificationInfo->FileNameLength, static_cast<DWORD>(Size - offset - headerSize));
+
+        bool known = true;
+
+        switch (fileNotificationInfo->Action)
+        {
+            case FILE_ACTION_ADDED:
+                changeEvent.Action = EventAction::Add;
+                break;
+
+            case FILE_ACTION_REMOVED:
+                changeEvent.Action = EventAction::Remove;
+                break;
+
+            case FILE_ACTION_MODIFIED:
+                changeEvent.Action = EventAction::Modify;
+                break;
+
+            case FILE_ACTION_RENAMED_OLD_NAME:
+                changeEvent.Action = EventAction::RenameOld;
+                break;
+
+            case FILE_ACTION_RENAMED_NEW_NAME:
+                changeEvent.Action = EventAction::RenameNew;
+                break;
+
+            default:
+                known = false;
+                break;
+        }
+
+        if (known)
+        {
+            changeEvent.FileName.assign(fileNotificationInfo->FileName, fileNameSize / sizeof(WCHAR));
+            Events.push_back(changeEvent);
+        }
+
+        const DWORD nextEntryOffset = fileNotificationInfo->NextEntryOffset;
+
+        if (nextEntryOffset == 0 || nextEntryOffset > Size - offset)
+        {
+            break;
+        }
+
+        offset += nextEntryOffset;
+    }
+}
+
+///
+/// Starts an overlapped read of the directory changes. A change buffer
+/// overflow is reported by the next ReadEvents.
+///
+DWORD
+Win32DirectoryWatcher::BeginRead()
+{
+    m_overlapped.Offset = 0;
+    m_overlapped.OffsetHigh = 0;
+
+    if (!ReadDirectoryChangesW(
+            m_directoryHandle,
+            m_records.data(),
+            static_cast<DWORD>(m_records.size()),
+            m_includeSubfolders,
+            NOTIFY_FILTERS,
+            nullptr,
+            &m_overlapped,
+            nullptr))
+    {
+        const DWORD status = GetLastError();
+
+        if (status != ERROR_NOTIFY_ENUM_DIR)
+        {
+            return status;
+        }
+
+        m_overflowed = true;
+        SetEvent(m_overlappedEvent);
+    }
+
+    return ERROR_SUCCESS;
+}
+
+#endif
@@ -0,0 +1,79 @@
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+
+#pragma once
+
+#ifdef _WIN32
+
+///
+/// DirectoryWatcher backed by ReadDirectoryChangesW, with an overlapped read
+/// always pending between two calls to ReadEvents.
+///
+class Win32DirectoryWatcher final : public DirectoryWatcher
+{
+public:
+    static constexpr DWORD RECORDS_BUFFER_SIZE_BYTES = 8 * 1024;
+
+    static constexpr DWORD NOTIFY_FILTERS = FILE_NOTIFY_CHANGE_CREATION
+                                          | FILE_NOTIFY_CHANGE_DIR_NAME
+                                          | FILE_NOTIFY_CHANGE_FILE_NAME
+                                          | FILE_NOTIFY_CHANGE_LAST_WRITE
+                                          | FILE_NOTIFY_CHANGE_SIZE;
+
+    ///
+    /// \param DirectoryHandle      Handle of the directory, opened with
+    ///                             FILE_FLAG_OVERLAPPED. The watcher closes it.
+    /// \param IncludeSubfolders    True to watch the subdirectories too.
+    ///
+    Win32DirectoryWatcher(
+        _In_ HANDLE DirectoryHandle,
+        _In_ bool IncludeSubfolders
+        );
+
+    ~Win32DirectoryWatcher();
+
+    Win32DirectoryWatcher(const Win32DirectoryWatcher&) = delete;
+    Win32DirectoryWatcher& operator=(const Win32DirectoryWatcher&) = delete;
+
+    DWORD Start() override;
+
+    DirectoryWatcherWaitObject GetWaitObject() const override
+    {
+        return m_overlappedEvent;
+    }
+
+    DWORD ReadEvents(
+        _Inout_ std::vector<DirChangeNotificationEvent>& Events
+        ) override;
+
+    static void ParseNotifications(
+        _In_reads_bytes_(Size) const BYTE* Buffer,
+        _In_ DWORD Size,
+        _In_ UINT64 Timestamp,
+        _Inout_ std::vector<DirChangeNotificationEvent>& Events
+        );
+
+private:
+    DWORD BeginRead();
+
+    HANDLE m_directoryHandle;
+    bool m_includeSubfolders;
+
+    OVERLAPPED m_overlapped;
+    HANDLE m_overlappedEvent;
+
+    //
+    // True when the last read failed with ERROR_NOTIFY_ENUM_DIR. The wait
+    // object is signaled, and the next ReadEvents returns a ReInit event.
+    //
+    bool m_overflowed;
+
+    //
+    // Must be DWORD aligned so allocated on the heap.
+    //
+    std::vector<BYTE> m_records;
+};
+
+#endif
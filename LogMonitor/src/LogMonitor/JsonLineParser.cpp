@@ -0,0 +1,570 @@
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+
+#include "pch.h"
+
+/// JsonLineParser.cpp
+///
+/// Defines a class to parse the members of a log line that is a JSON object.
+///
+
+constexpr size_t JsonLineParser::MAX_DEPTH;
+
+///
+/// Parses a line, and keeps the views of its top-level members.
+///
+/// \param Line     The line, in UTF-8, without line break.
+/// \param Length   Size of the line in bytes.
+///
+/// \return True if the line is a JSON object. Otherwise false, and there
+///     are no members.
+///
+bool
+JsonLineParser::Parse(
+    _In_reads_(Length) const char* Line,
+    _In_ size_t Length
+    )
+{
+    m_members.clear();
+
+    m_position = Line;
+    m_end = Line + Length;
+
+    SkipWhitespace();
+
+    if (m_position == m_end || *m_position != '{')
+    {
+        return false;
+    }
+
+    if (!ParseObject(1))
+    {
+        m_members.clear();
+        return false;
+    }
+
+    SkipWhitespace();
+
+    if (m_position != m_end)
+    {
+        m_members.clear();
+        return false;
+    }
+
+    return true;
+}
+
+///
+/// Appends a JSON string, without its quotes, to a buffer, with its escape
+/// sequences decoded to UTF-8. A lone surrogate is replaced by U+FFFD.
+///
+/// \param Buffer   The buffer the string is appended to.
+/// \param Value    Content of a valid JSON string, still escaped.
+/// \param Length   Size of the content in bytes.
+///
+void
+JsonLineParser::AppendUnescaped(
+    _Inout_ std::string& Buffer,
+    _In_reads_(Length) const char* Value,
+    _In_ size_t Length
+    )
+{
+    size_t start = 0;
+    size_t i = 0;
+
+    while (i < Length)
+    {
+        if (Value[i] != '\\')
+        {
+            i++;
+            continue;
+        }
+
+        Buffer.append(Value + start, i - start);
+
+        const char escaped = Value[i + 1];
+        i += 2;
+
+        switch (escaped)
+        {
+            case 'b':
+                Buffer.push_back('\b');
+                break;
+            case 'f':
+                Buffer.push_back('\f');
+                break;
+            case 'n':
+                Buffer.push_back('\n');
+                break;
+            case 'r':
+                Buffer.push_back('\r');
+                break;
+            case 't':
+                Buffer.push_back('\t');
+                break;
+            case 'u':
+            {
+                UINT32 codePoint = 0;
+
+                ParseHex4(Value + i, codePoint);
+                i += 4;
+
+                if (codePoint >= 0xD800 && codePoint <= 0xDBFF)
+                {
+                    UINT32 lowSurrogate = 0;
+
+                    if (i + 6 <= Length
+                        && Value[i] == '\\'
+                        && Value[i + 1] == 'u'
+                        && ParseHex4(Value + i + 2, lowSurrogate)
+                        && lowSurrogate >= 0xDC00 && lowSurrogate <= 0xDFFF)
+                    {
+                        codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (lowSurrogate - 0xDC00);
+                        i += 6;
+                    }
+                    else
+                    {
+                        codePoint = 0xFFFD;
+                    }
+                }
+                else if (codePoint >= 0xDC00 && codePoint <= 0xDFFF)
+                {
+                    codePoint = 0xFFFD;
+                }
+
+                if (codePoint < 0x80)
+                {
+                    Buffer.push_back(static_cast<char>(codePoint));
+                }
+                else if (codePoint < 0x800)
+                {
+                    Buffer.push_back(static_cast<char>(0xC0 | (codePoint >> 6)));
+                    Buffer.push_back(static_cast<char>(0x80 | (codePoint & 0x3F)));
+                }
+                else if (codePoint < 0x10000)
+                {
+                    Buffer.push_back(static_cast<char>(0xE0 | (codePoint >> 12)));
+                    Buffer.push_back(static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F)));
+                    Buffer.push_back(static_cast<char>(0x80 | (codePoint & 0x3F)));
+                }
+                else
+                {
+                    Buffer.push_back(static_cast<char>(0xF0 | (codePoint >> 18)));
+                    Buffer.push_back(static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F)));
+                    Buffer.push_back(static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F)));
+                    Buffer.push_back(static_cast<char>(0x80 | (codePoint & 0x3F)));
+                }
+
+                break;
+            }
+            default:
+                //
+                // '"', '\\' and '/' are escaped as themselves.
+                //
+                Buffer.push_back(escaped);
+                break;
+        }
+
+        start = i;
+    }
+
+    Buffer.append(Value + start, Length - start);
+}
+
+void
+JsonLineParser::SkipWhitespace()
+{
+    while (m_position != m_end
+        && (*m_position == ' ' || *m_position == '\t' || *m_position == '\r' || *m_position == '\n'))
+    {
+        m_position++;
+    }
+}
+
+///
+/// Parses the value at the current position.
+///
+/// \param Depth    Number of objects and arrays the value is in.
+/// \param Type     Returns the type of the value.
+///
+/// \return True if the value is valid. The position is then after it.
+///
+bool
+JsonLineParser::ParseValue(
+    _In_ size_t Depth,
+    _Out_ ValueType& Type
+    )
+{
+    Type = ValueType::Null;
+
+    if (m_position == m_end)
+    {
+        return false;
+    }
+
+    switch (*m_position)
+    {
+        case '"':
+            Type = ValueType::String;
+            m_position++;
+            return ParseString();
+
+        case '{':
+            Type = ValueType::Object;
+            return Depth < MAX_DEPTH && ParseObject(Depth + 1);
+
+        case '[':
+            Type = ValueType::Array;
+            return Depth < MAX_DEPTH && ParseArray(Depth + 1);
+
+        case 't':
+            Type = ValueType::Boolean;
+            return ParseLiteral("true");
+
+        case 'f':
+            Type = ValueType::Boolean;
+            return ParseLiteral("false");
+
+        case 'n':
+            Type = ValueType::Null;
+            return ParseLiteral("null");
+
+        default:
+            Type = ValueType::Number;
+            return ParseNumber();
+    }
+}
+
+///
+/// Parses the content of a string, after its opening quote.
+///
+/// \return True if the string is valid. The position is then after its
+///     closing quote.
+///
+bool
+JsonLineParser::ParseString()
+{
+    while (m_position != m_end)
+    {
+        const unsigned char ch = static_cast<unsigned char>(*m_position);
+
+        if (ch == '"')
+        {
+            m_position++;
+            return true;
+        }
+
+        if (ch < 0x20)
+        {
+            return false;
+        }
+
+        if (ch != '\\')
+        {
+            m_position++;
+            continue;
+        }
+
+        if (m_end - m_position < 2)
+        {
+            return false;
+        }
+
+        switch (m_position[1])
+        {
+            case '"':
+            case '\\':
+            case '/':
+            case 'b':
+            case 'f':
+            case 'n':
+            case 'r':
+            case 't':
+                m_position += 2;
+                break;
+
+            case 'u':
+            {
+                UINT32 unit;
+
+                if (m_end - m_position < 6 || !ParseHex4(m_position + 2, unit))
+                {
+                    return false;
+                }
+
+                m_position += 6;
+                break;
+            }
+
+            default:
+                return false;
+        }
+    }
+
+    return false;
+}
+
+bool
+JsonLineParser::ParseNumber()
+{
+    if (m_position != m_end && *m_position == '-')
+    {
+        m_position++;
+    }
+
+    if (m_position == m_end || !isdigit(static_cast<unsigned char>(*m_position)))
+    {
+        return false;
+    }
+
+    //
+    // No leading zeros.
+    //
+    if (*m_position == '0')
+    {
+        m_position++;
+    }
+    else
+    {
+        while (m_position != m_end && isdigit(static_cast<unsigned char>(*m_position)))
+        {
+            m_position++;
+        }
+    }
+
+    if (m_position != m_end && *m_position == '.')
+    {
+        m_position++;
+
+        if (m_position == m_end || !isdigit(static_cast<unsigned char>(*m_position)))
+        {
+            return false;
+        }
+
+        while (m_position != m_end && isdigit(static_cast<unsigned char>(*m_position)))
+        {
+            m_position++;
+        }
+    }
+
+    if (m_position != m_end && (*m_position == 'e' || *m_position == 'E'))
+    {
+        m_position++;
+
+        if (m_position != m_end && (*m_position == '+' || *m_position == '-'))
+        {
+            m_position++;
+        }
+
+        if (m_position == m_end || !isdigit(static_cast<unsigned char>(*m_position)))
+        {
+            return false;
+        }
+
+        while (m_position != m_end && isdigit(static_cast<unsigned char>(*m_position)))
+        {
+            m_position++;
+        }
+    }
+
+    return true;
+}
+
+bool
+JsonLineParser::ParseLiteral(
+    _In_z_ const char* Literal
+    )
+{
+    const size_t length = strlen(Literal);
+
+    if (static_cast<size_t>(m_end - m_position) < length || memcmp(m_position, Literal, length) != 0)
+    {
+        return false;
+    }
+
+    m_position += length;
+
+    return true;
+}
+
+///
+/// Parses an object, from its opening brace. The members of the object of
+/// the line, at depth 1, are kept.
+///
+bool
+JsonLineParser::ParseObject(
+    _In_ size_t Depth
+    )
+{
+    m_position++;
+    SkipWhitespace();
+
+    if (m_position != m_end && *m_position == '}')
+    {
+        m_position++;
+        return true;
+    }
+
+    while (true)
+    {
+        if (m_position == m_end || *m_position != '"')
+        {
+            return false;
+        }
+
+        Member member;
+
+        member.Name = ++m_position;
+
+        if (!ParseString())
+        {
+            return false;
+        }
+
+        member.NameLength = m_position - 1 - member.Name;
+
+        SkipWhitespace();
+
+        if (m_position == m_end || *m_position != ':')
+        {
+            return false;
+        }
+
+        m_position++;
+        SkipWhitespace();
+
+        member.Value = m_position;
+
+        if (!ParseValue(Depth, member.Type))
+        {
+            return false;
+        }
+
+        if (Depth == 1)
+        {
+            member.ValueLength = m_position - member.Value;
+
+            //
+            // The view of a string is its content.
+            //
+            if (member.Type == ValueType::String)
+            {
+                member.Value++;
+                member.ValueLength -= 2;
+            }
+
+            m_members.push_back(member);
+        }
+
+        SkipWhitespace();
+
+        if (m_position == m_end)
+        {
+            return false;
+        }
+
+        if (*m_position == '}')
+        {
+            m_position++;
+            return true;
+        }
+
+        if (*m_position != ',')
+        {
+            return false;
+        }
+
+        m_position++;
+        SkipWhitespace();
+    }
+}
+
+///
+/// Parses a nested array, from its opening bracket.
+///
+bool
+JsonLineParser::ParseArray(
+    _In_ size_t Depth
+    )
+{
+    m_position++;
+    SkipWhitespace();
+
+    if (m_position != m_end && *m_position == ']')
+    {
+        m_position++;
+        return true;
+    }
+
+    while (true)
+    {
+        ValueType type;
+
+        if (!ParseValue(Depth, type))
+        {
+            return false;
+        }
+
+        SkipWhitespace();
+
+        if (m_position == m_end)
+        {
+            return false;
+        }
+
+        if (*m_position == ']')
+        {
+            m_position++;
+            return true;
+        }
+
+        if (*m_position != ',')
+        {
+            return false;
+        }
+
+        m_position++;
+        SkipWhitespace();
+    }
+}
+
+///
+/// \return False if the 4 characters aren't hexadecimal digits.
+///
+bool
+JsonLineParser::ParseHex4(
+    _In_reads_(4) const char* Digits,
+    _Out_ UINT32& Value
+    )
+{
+    Value = 0;
+
+    for (int i = 0; i < 4; i++)
+    {
+        const char ch = Digits[i];
+        UINT32 digit;
+
+        if (ch >= '0' && ch <= '9')
+        {
+            digit = ch - '0';
+        }
+        else if (ch >= 'a' && ch <= 'f')
+        {
+            digit = ch - 'a' + 10;
+        }
+        else if (ch >= 'A' && ch <= 'F')
+        {
+            digit = ch - 'A' + 10;
+        }
+        else
+        {
+            return false;
+        }
+
+        Value = (Value << 4) | digit;
+    }
+
+    return true;
+}
@@ -1,2025 +1,2852 @@
-//
-// Copyright (c) Microsoft Corporation.
-// Licensed under the MIT license.
-//
-
-#include "pch.h"
-
-using namespace std;
-
-///
-/// LogFileMonitor.cpp
-///
-/// Monitors a log directory for changes to the log files matching the criteria specified by a filter.
-///
-/// LogFileMonitor starts a monitor thread that waits for file change notifications from ReadDirectoryChangesW
-/// or for a stop event to be set. It also starts a worker thread that processes the change notification events.
-///
-/// The destructor signals the stop event and waits up to LOG_MONITOR_THREAD_EXIT_MAX_WAIT_MILLIS for the monitoring
-/// thread to exit. To prevent the thread from out-living LogFileMonitor, the destructor fails fast
-/// if the wait fails or times out. This also ensures the callback is not being called and will not be
-/// called once LogFileMonitor is destroyed.
-///
-
-
-#define LOG_DIR_NOTIFY_FILTERS   (FILE_NOTIFY_CHANGE_CREATION |         \
-                                  FILE_NOTIFY_CHANGE_DIR_NAME |         \
-                                  FILE_NOTIFY_CHANGE_FILE_NAME |        \
-                                  FILE_NOTIFY_CHANGE_LAST_WRITE |       \
-                                  FILE_NOTIFY_CHANGE_SIZE)
-
-///
-/// Constructor creates a thread to monitor log directory changes and waits until
-/// that thread registers for directory change notifications. This ensures that no
-/// changes to log files are missed once the LogFileMonitor object is created.
-///
-/// \param LogDirectory:        The log directory to be monitored
-/// \param Filter:              The filter to apply when looking fr log files
-/// \param IncludeSubfolders:   TRUE if subdirectories also needs to be monitored
-///
-LogFileMonitor::LogFileMonitor(_In_ const std::wstring& LogDirectory,
-                               _In_ const std::wstring& Filter,
-                               _In_ bool IncludeSubfolders,
-                               _In_ bool IncludeFileNames
-                               ) :
-                               m_logDirectory(LogDirectory),
-                               m_filter(Filter),
-                               m_includeSubfolders(IncludeSubfolders),
-                               m_includeFileNames(IncludeFileNames)
-{
-    m_stopEvent = NULL;
-    m_overlappedEvent = NULL;
-    m_workerThreadEvent = NULL;
-    m_logFilesChangeHandlerThread = NULL;
-    m_dirMonitorStartedEvent = NULL;
-    m_logDirMonitorThread = NULL;
-    m_logDirHandle = INVALID_HANDLE_VALUE;
-
-    InitializeSRWLock(&m_eventQueueLock);
-
-    while (!m_logDirectory.empty() && m_logDirectory[ m_logDirectory.size() - 1 ] == L'\\')
-    {
-        m_logDirectory.resize(m_logDirectory.size() - 1);
-    }
-    m_logDirectory = PREFIX_EXTENDED_PATH + m_logDirectory;
-
-    if (m_filter.empty())
-    {
-        m_filter = L"*";
-    }
-
-    m_stopEvent = CreateFileMonitorEvent(TRUE, FALSE);
-
-    m_overlappedEvent = CreateFileMonitorEvent(TRUE, TRUE);
-
-    m_overlapped.hEvent = m_overlappedEvent;
-
-    m_workerThreadEvent = CreateFileMonitorEvent(TRUE, TRUE);
-
-    m_dirMonitorStartedEvent = CreateFileMonitorEvent(TRUE, FALSE);
-
-    m_readLogFilesFromStart = false;
-
-    m_logDirMonitorThread = CreateThread(
-        nullptr,
-        0,
-        (LPTHREAD_START_ROUTINE)&LogFileMonitor::StartLogFileMonitorStatic,
-        this,
-        0,
-        nullptr);
-    if(!m_logDirMonitorThread)
-    {
-        throw std::system_error(std::error_code(GetLastError(), std::system_category()), "CreateThread");
-    }
-
-    //
-    // Wait until log directory change notification is registered or the monitoring thread exited.
-    //
-    const DWORD eventsCount = 2;
-    HANDLE events[eventsCount] = {m_dirMonitorStartedEvent, m_logDirMonitorThread};
-    DWORD waitResult = WaitForMultipleObjects(eventsCount, events, FALSE, INFINITE);
-
-    if (waitResult != WAIT_OBJECT_0)
-    {
-        if (waitResult == WAIT_OBJECT_0 + 1)
-        {
-            DWORD threadExitCode;
-            HRESULT hr = GetExitCodeThread(m_logDirMonitorThread, &threadExitCode)
-                            ? HRESULT_FROM_WIN32(threadExitCode) : HRESULT_FROM_WIN32(GetLastError());
-
-            if (FAILED(hr))
-            {
-                throw std::system_error(std::error_code(hr, std::system_category()), "StartLogFileMonitorStatic");
-            }
-        }
-        else
-        {
-            throw std::system_error(std::error_code(GetLastError(), std::system_category()), "WaitForMultipleObjects");
-        }
-    }
-}
-
-
-LogFileMonitor::~LogFileMonitor()
-{
-    const DWORD eventsCount = 2;
-    HANDLE events[eventsCount] = {m_logDirMonitorThread, m_logFilesChangeHandlerThread};
-
-    if(!SetEvent(m_stopEvent))
-    {
-        logWriter.TraceError(
-            Utility::FormatString(L"Failed to signal event to stop log file monitor. %lu", GetLastError()).c_str()
-        );
-    }
-    else
-    {
-        //
-        // Wait for directory monitor and change notification handler threads to exit.
-        //
-        DWORD waitResult = WaitForMultipleObjects(eventsCount, events, TRUE, LOG_MONITOR_THREAD_EXIT_MAX_WAIT_MILLIS);
-
-        if (waitResult != WAIT_OBJECT_0)
-        {
-            HRESULT hr = (waitResult == WAIT_FAILED) ? HRESULT_FROM_WIN32(GetLastError())
-                                                           : HRESULT_FROM_WIN32(waitResult);
-            if (FAILED(hr))
-            {
-                logWriter.TraceError(
-                    Utility::FormatString(
-                        L"Failed to wait for log file monitor to stop. Log directory: %s Error: %lu",
-                        m_logDirectory.c_str(),
-                        hr
-                    ).c_str()
-                );
-            }
-        }
-    }
-
-    if (!m_logDirMonitorThread)
-    {
-        CloseHandle(m_logDirMonitorThread);
-    }
-
-    if (!m_logFilesChangeHandlerThread)
-    {
-        CloseHandle(m_logFilesChangeHandlerThread);
-    }
-
-    if (!m_dirMonitorStartedEvent)
-    {
-        CloseHandle(m_dirMonitorStartedEvent);
-    }
-
-    if (!m_workerThreadEvent)
-    {
-        CloseHandle(m_workerThreadEvent);
-    }
-
-    if (!m_overlappedEvent)
-    {
-        CloseHandle(m_overlappedEvent);
-    }
-
-    if (!m_stopEvent)
-    {
-        CloseHandle(m_stopEvent);
-    }
-
-    if (m_logDirHandle != INVALID_HANDLE_VALUE)
-    {
-        CloseHandle(m_logDirHandle);
-    }
-}
-
-
-///
-/// Worker routine to monitor log directory changes.
-///
-/// \param Context: LogFileMonitor object passed in as callback context
-///
-/// \return ERROR_SUCCESS: If log monitoring is started successfully
-///         Failure:       If log directory monitoring failed.
-///
-DWORD
-LogFileMonitor::StartLogFileMonitorStatic(
-    _In_ LPVOID Context
-    )
-{
-    auto pThis = reinterpret_cast<LogFileMonitor*>(Context);
-    try
-    {
-        DWORD status = pThis->StartLogFileMonitor();
-        if (status != ERROR_SUCCESS)
-        {
-            logWriter.TraceError(
-                Utility::FormatString(
-                    L"Failed to start log file monitor. Log files in a directory %s will not be monitored. Error: %lu",
-                    pThis->m_logDirectory.c_str(),
-                    status
-                ).c_str()
-            );
-        }
-        return status;
-    }
-    catch (std::exception& ex)
-    {
-        logWriter.TraceError(
-            Utility::FormatString(
-                L"Failed to start log file monitor. Log files in a directory %s will not be monitored. %S",
-                pThis->m_logDirectory.c_str(),
-                ex.what()
-            ).c_str()
-        );
-        return E_FAIL;
-    }
-    catch (...)
-    {
-        logWriter.TraceError(
-            Utility::FormatString(
-                L"Failed to start log file monitor. Log files in a directory %s will not be monitored.",
-                pThis->m_logDirectory.c_str()
-            ).c_str()
-        );
-        return E_FAIL;
-    }
-}
-
-DWORD LogFileMonitor::EnqueueDirChangeEvents(DirChangeNotificationEvent event, BOOLEAN lock = TRUE) {
-    if (event.Action != EventAction::ReInit && event.Action != EventAction::RenameNew)
-    {
-        if (!FileMatchesFilter((LPCWSTR)(event.FileName.c_str()), m_filter.c_str()))
-        {
-            //
-            // It could be because the name was short formatted. Make it long path and try again.
-            //
-            event.FileName = Utility::GetLongPath(m_logDirectory + L'\\' + event.FileName)
-                                        .substr(m_logDirectory.size() + 1);
-
-            if (!FileMatchesFilter((LPCWSTR)(event.FileName.c_str()), m_filter.c_str()))
-            {
-                return ERROR_NO_MATCH;
-            }
-        }
-    }
-
-    if(lock) AcquireSRWLockExclusive(&m_eventQueueLock);
-
-    m_directoryChangeEvents.emplace(event);
-
-    if (m_directoryChangeEvents.size() == 1)
-    {
-        //wprintf(L"Signalling worker thread to start processing the event queue\n");
-        if(!SetEvent(m_workerThreadEvent))
-        {
-            logWriter.TraceError(
-                Utility::FormatString(
-                    L"Failed to signal worker thread of log changes."
-                    " This may cause lag in log file monitoring or lost log messages."
-                    " Log directory: %ws, Error: %d",
-                    m_logDirectory.c_str(),
-                    GetLastError()
-                ).c_str()
-            );
-        }
-    }
-
-    if(lock) ReleaseSRWLockExclusive(&m_eventQueueLock);
-
-    return ERROR_SUCCESS;
-}
-
-
-///
-/// Entry for the spawned log file monitor thread. It loops to wait for either the stop event in which case it exits
-/// or for the log file changes. When log file changes are notified, it inserts the changed file information into a
-/// queue, signal the change notification worker thread, resets, and starts the wait again.
-///
-/// \return ERROR_SUCCESS: If log monitoring is started successfully
-///         Failure:       If log directory monitoring failed.
-///
-DWORD
-LogFileMonitor::StartLogFileMonitor()
-{
-    DWORD status = ERROR_SUCCESS;
-    const DWORD eventsCount = 2;
-    bool changeHandlerThreadCreated = false;
-    bool dirMonitorStartedEventSignalled = false;
-
-    //
-    // Order stop event first so that stop is prioritized if both events are already signalled (changes
-    // are available but stop has been called).
-    //
-    HANDLE events[eventsCount] = {m_stopEvent, m_overlapped.hEvent};
-    bool stopWatching = false;
-
-    SetEvent(m_dirMonitorStartedEvent);
-    dirMonitorStartedEventSignalled = true;
-
-    // Get Log Dir Handle
-    HANDLE logDirHandle = GetLogDirHandle(m_logDirectory, m_stopEvent);
-
-    if(logDirHandle == INVALID_HANDLE_VALUE) {
-        status = GetLastError();
-
-        logWriter.TraceError(
-            Utility::FormatString(
-                L"Failed to open log directory handle. Directory: %ws Error=%d",
-                m_logDirectory.c_str(),
-                status
-            ).c_str()
-        );
-        return status;
-    }
-
-    // Handle cases where log file didn't exist during init and we need to read content added within 15 second wait
-    DWORD lastLogHandleError = GetLastError();
-    if (lastLogHandleError == ERROR_FILE_NOT_FOUND ||
-        lastLogHandleError == ERROR_PATH_NOT_FOUND)
-    {
-        m_readLogFilesFromStart = true;
-    }
-
-    m_logDirHandle = logDirHandle;
-
-    //
-    // Now that the directory was open, we can obtain its long and short path.
-    //
-    m_logDirectory = Utility::GetLongPath(m_logDirectory);
-    m_shortLogDirectory = Utility::GetShortPath(m_logDirectory);
-
-    status = InitializeDirectoryChangeEventsQueue();
-    if (status != ERROR_SUCCESS)
-    {
-        //
-        // Failed to enumerate log files in a directory.
-        // Ignore the failure and continue. Some log file
-        // information will not be monitored.
-        //
-        logWriter.TraceError(
-            Utility::FormatString(
-                L"Failed to open enumerate log directory. Directory: %ws Error=%d",
-                m_logDirectory.c_str(),
-                status
-            ).c_str()
-        );
-    }
-
-    //
-    // Initialize the list of log file in a given directory and start a worker thread to
-    // process directory change notification events.
-    //
-    while (!stopWatching)
-    {
-        std::fill(records.begin(), records.end(), (BYTE)0); // Reset previous entries if any.
-        m_overlapped.Offset = 0;
-        m_overlapped.OffsetHigh = 0;
-        BOOL success = ReadDirectoryChangesW(
-            m_logDirHandle,
-            records.data(),
-            static_cast<ULONG>(records.size()),
-            m_includeSubfolders,
-            LOG_DIR_NOTIFY_FILTERS,
-            nullptr,
-            &m_overlapped,
-            nullptr);
-
-        if (!success)
-        {
-            status = GetLastError();
-            if (status == ERROR_NOTIFY_ENUM_DIR)
-            {
-                status = ERROR_SUCCESS;
-                if (!dirMonitorStartedEventSignalled)
-                {
-                    SetEvent(m_dirMonitorStartedEvent);
-                    dirMonitorStartedEventSignalled = true;
-                }
-
-                //
-                // The change buffer was full and all events were discarded. Scan the directory again
-                // and create file add event for each log file. In cse of failure, just log message
-                // and continue.
-                //
-                DirChangeNotificationEvent changeEvent;
-
-                changeEvent.Timestamp = GetTickCount64();
-                changeEvent.Action = EventAction::ReInit;
-
-                EnqueueDirChangeEvents(changeEvent);
-
-                continue;
-            }
-            else
-            {
-                logWriter.TraceError(
-                    Utility::FormatString(
-                        L"Failed to monitor log directory changes. Log directory: %ws, Error: %d",
-                        m_logDirectory.c_str(),
-                        status
-                    ).c_str()
-                );
-            }
-        }
-
-        if (!dirMonitorStartedEventSignalled)
-        {
-            SetEvent(m_dirMonitorStartedEvent);
-            dirMonitorStartedEventSignalled = true;
-        }
-
-        if (status == ERROR_SUCCESS)
-        {
-            if (!changeHandlerThreadCreated)
-            {
-                m_logFilesChangeHandlerThread = CreateThread(
-                    nullptr,
-                    0,
-                    (LPTHREAD_START_ROUTINE)&LogFileMonitor::LogFilesChangeHandlerStatic,
-                    this,
-                    0,
-                    nullptr);
-                if (!m_logFilesChangeHandlerThread)
-                {
-                    status = GetLastError();
-                    logWriter.TraceError(
-                        Utility::FormatString(
-                            L"Failed to create a thread to read log files from directory: %ws Error=%d",
-                            m_logDirectory.c_str(),
-                            status
-                        ).c_str()
-                    );
-
-                    return status;
-                }
-                else
-                {
-                    changeHandlerThreadCreated = true;
-                }
-            }
-
-            DWORD wait = WaitForMultipleObjects(eventsCount, events, FALSE, INFINITE);
-            switch(wait)
-            {
-                case WAIT_OBJECT_0:
-                {
-                    //
-                    // Clear the event queue
-                    //
-                    AcquireSRWLockExclusive(&m_eventQueueLock);
-
-                    while (m_directoryChangeEvents.size() > 0)
-                    {
-                        m_directoryChangeEvents.pop();
-                    }
-
-                    ReleaseSRWLockExclusive(&m_eventQueueLock);
-
-                    stopWatching = true;
-                }
-                break;
-
-                case WAIT_OBJECT_0 + 1:
-                {
-                    status = LogDirectoryChangeNotificationHandler();
-                }
-                break;
-
-                default:
-                    status = GetLastError();
-                    logWriter.TraceError(
-                        Utility::FormatString(
-                            L"Failed to monitor log directory changes. Wait operation failed. Log directory: %ws, Error: %d",
-                            m_logDirectory.c_str(),
-                            status
-                        ).c_str()
-                    );
-                    stopWatching = true;
-            }
-        }
-        else
-        {
-            stopWatching = true;
-        }
-    }
-
-    return status;
-}
-
-
-///
-/// Check if the filename matches a filter.
-///
-/// \param FileName         The filename to be evaluated.
-/// \param SearchPattern    The filter to evaluate with.
-///
-/// \return True if the file matches filter. Otherwise, false
-///
-inline BOOL
-LogFileMonitor::FileMatchesFilter(
-    _In_ LPCWSTR FileName,
-    _In_ LPCWSTR SearchPattern
-    )
-{
-    return PathMatchSpec(FileName, SearchPattern);
-}
-
-
-DWORD
-LogFileMonitor::InitializeMonitoredFilesInfo()
-{
-    DWORD status = ERROR_SUCCESS;
-
-    return status;
-}
-
-
-DWORD
-LogFileMonitor::LogDirectoryChangeNotificationHandler()
-{
-    DWORD status = ERROR_SUCCESS;
-    DWORD dwBytesTransfered = 0;
-    DWORD dwNextEntryOffset = 0;
-
-    if (!GetOverlappedResult(m_logDirHandle, &m_overlapped, &dwBytesTransfered, FALSE))
-    {
-        status = GetLastError();
-        return status;
-    }
-
-    if (dwBytesTransfered)
-    {
-        int i = 0;
-        FILE_NOTIFY_INFORMATION *fileNotificationInfo = reinterpret_cast<PFILE_NOTIFY_INFORMATION>(records.data());
-        WCHAR pszFileName[4096];
-        do
-        {
-            i++;
-
-            //
-            // Extract the FileName
-            //
-            DWORD dwFileNameLength = fileNotificationInfo->FileNameLength / sizeof(WCHAR);
-            if (dwFileNameLength > 4096)
-            {
-                dwFileNameLength = 4095;
-            }
-            CopyMemory(pszFileName, fileNotificationInfo->FileName, sizeof(WCHAR)*dwFileNameLength);
-            pszFileName[dwFileNameLength] = '\0';
-
-            std::wstring fileName = pszFileName;
-
-            DirChangeNotificationEvent changeEvent;
-
-            switch (fileNotificationInfo->Action)
-            {
-                case FILE_ACTION_ADDED:
-                {
-                    changeEvent.Action = EventAction::Add;
-                    break;
-                }
-                case FILE_ACTION_REMOVED:
-                {
-                    changeEvent.Action = EventAction::Remove;
-                    break;
-                }
-                case (FILE_ACTION_MODIFIED):
-                {
-                    changeEvent.Action = EventAction::Modify;
-                    break;
-                }
-                case (FILE_ACTION_RENAMED_OLD_NAME):
-                {
-                    changeEvent.Action = EventAction::RenameOld;
-                    break;
-                }
-                case (FILE_ACTION_RENAMED_NEW_NAME):
-                {;
-                    changeEvent.Action = EventAction::RenameNew;
-                    break;
-                }
-                default:
-                {
-                    changeEvent.Action = EventAction::Unknown;
-                    break;
-                }
-            }
-
-            if (changeEvent.Action == EventAction::Add ||
-                changeEvent.Action == EventAction::Remove ||
-                changeEvent.Action == EventAction::Modify ||
-                changeEvent.Action == EventAction::RenameOld ||
-                changeEvent.Action == EventAction::RenameNew)
-            {
-                changeEvent.FileName = fileName;
-                changeEvent.Timestamp = GetTickCount64();
-
-                EnqueueDirChangeEvents(changeEvent);
-            }
-
-            dwNextEntryOffset = fileNotificationInfo->NextEntryOffset;
-            fileNotificationInfo =
-                (FILE_NOTIFY_INFORMATION*)((LPBYTE)fileNotificationInfo + fileNotificationInfo->NextEntryOffset);
-
-        } while (dwNextEntryOffset);
-    }
-    else
-    {
-        logWriter.TraceError(L"Error monitoring log directory. Invalid directory change notification data.");
-    }
-
-    return S_OK;
-}
-
-
-DWORD
-LogFileMonitor::InitializeDirectoryChangeEventsQueue()
-{
-    DWORD status = ERROR_SUCCESS;
-    std::vector<std::pair<std::wstring, FILE_ID_INFO> > logFiles;
-
-    //wprintf(L"InitializeDirectoryChangeEventsQueue\n");
-
-    status = GetFilesInDirectory(m_logDirectory, m_filter, logFiles, m_includeSubfolders);
-
-    if (status == ERROR_SUCCESS)
-    {
-        AcquireSRWLockExclusive(&m_eventQueueLock);
-
-        //
-        // Read log files from the start only when the tool is launched
-        // for the first time and the log files did not exist before.
-        // Subsequent attempts to enumerate the directory should set
-        // the file next read offset to the size of the file.
-        //
-        bool readLogFileFromStart = m_readLogFilesFromStart;
-
-        m_readLogFilesFromStart = false;
-
-        for (auto file : logFiles)
-        {
-            const std::wstring& fileName = file.first;
-            const FILE_ID_INFO& fileId = file.second;
-
-            const std::wstring longPath = fileName.substr(m_logDirectory.size() + 1);
-
-            auto element = GetLogFilesInformationIt(longPath);
-
-            if (element != m_logFilesInformation.end())
-            {
-                //
-                // Log file already exist. Do nothing.
-                //
-            }
-            else
-            {
-                auto logFileInfo = std::make_shared<LogFileInformation>();
-
-                const std::wstring shortPath = Utility::GetShortPath(fileName).substr(m_shortLogDirectory.size() + 1);
-
-                logFileInfo->FileName = longPath;
-                logFileInfo->NextReadOffset = 0;
-                logFileInfo->LastReadTimestamp = 0;
-
-                if (!readLogFileFromStart)
-                {
-                    LARGE_INTEGER fileSize = {};
-
-                    HANDLE logFile = CreateFileW(fileName.c_str(),
-                                                  GENERIC_READ,
-                                                  FILE_SHARE_READ | FILE_SHARE_WRITE,
-                                                  nullptr,
-                                                  OPEN_EXISTING,
-                                                  FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
-                                                  nullptr);
-                    if (logFile == INVALID_HANDLE_VALUE)
-                    {
-                        logWriter.TraceError(
-                            Utility::FormatString(
-                                L"Error in log file monitor. Failed to open file %ws. Error = %d",
-                                fileName.c_str(),
-                                GetLastError()
-                            ).c_str()
-                        );
-
-                        //
-                        // Ignore failure and continue. In the worst case we will
-                        // read the entire log file.
-                        //
-                        continue;
-                    }
-
-                    if (!GetFileSizeEx (logFile, &fileSize))
-                    {
-                        logWriter.TraceError(
-                            Utility::FormatString(
-                                L"Error in log file monitor. Failed to get size of file %ws. Error = %d",
-                                fileName.c_str(),
-                                GetLastError()
-                            ).c_str()
-                        );
-                    }
-                    else
-                    {
-                        logFileInfo->NextReadOffset = fileSize.QuadPart;
-                    }
-
-                    CloseHandle(logFile);
-                }
-
-                m_longPaths[shortPath] = longPath;
-                m_logFilesInformation[longPath] = std::move(logFileInfo);
-                m_fileIds[fileId] = longPath;
-            }
-
-            DirChangeNotificationEvent changeEvent;
-
-            changeEvent.Action = EventAction::Modify;
-            changeEvent.FileName = longPath;
-            changeEvent.Timestamp = GetTickCount64();
-
-            EnqueueDirChangeEvents(changeEvent, FALSE);
-        }
-
-        ReleaseSRWLockExclusive(&m_eventQueueLock);
-    }
-    else
-    {
-        logWriter.TraceError(
-            Utility::FormatString(
-                L"Error in log file monitor. Failed to enumerate log directory %ws. Error=%d",
-                m_logDirectory.c_str(),
-                GetLastError()
-            ).c_str()
-        );
-    }
-
-    return status;
-}
-
-
-DWORD
-LogFileMonitor::LogFilesChangeHandlerStatic(
-    _In_ LPVOID Context
-    )
-{
-    auto pThis = reinterpret_cast<LogFileMonitor*>(Context);
-    try
-    {
-        DWORD status = pThis->LogFilesChangeHandler();
-        if (status != ERROR_SUCCESS)
-        {
-            logWriter.TraceError(
-                Utility::FormatString(
-                    L"Failed to monitor log directory changes. Log files in a directory %s will not be monitored. Error: %lu",
-                    pThis->m_logDirectory.c_str(),
-                    status
-                ).c_str()
-            );
-        }
-        return status;
-    }
-    catch (std::exception& ex)
-    {
-        logWriter.TraceError(
-            Utility::FormatString(
-                L"Failed to monitor log directory changes. Log files in a directory %s will not be monitored. %S",
-                pThis->m_logDirectory.c_str(),
-                ex.what()
-            ).c_str()
-        );
-        return E_FAIL;
-    }
-    catch (...)
-    {
-        logWriter.TraceError(
-            Utility::FormatString(
-                L"Failed to monitor log directory changes. Log files in a directory %s will not be monitored",
-                pThis->m_logDirectory.c_str()
-            ).c_str()
-        );
-        return E_FAIL;
-    }
-}
-
-
-DWORD
-LogFileMonitor::LogFilesChangeHandler()
-{
-    DWORD status = ERROR_SUCCESS;
-    bool stopWatching = false;
-    const DWORD eventsCount = 3;
-
-    LARGE_INTEGER liDueTime;
-    INT64 millisecondsToWait = 30000LL;
-    liDueTime.QuadPart = -millisecondsToWait*10000LL; // wait time in 100 nanoseconds
-
-    HANDLE timerEvent = CreateWaitableTimer(NULL, FALSE, NULL);
-    if (!timerEvent)
-    {
-        status = GetLastError();
-        logWriter.TraceError(
-            Utility::FormatString(
-                L"Failed to create timer object to monitor log file changes in directory %s. Error: %lu",
-                m_logDirectory.c_str(),
-                status
-            ).c_str()
-        );
-        return status;
-    }
-
-    HANDLE events[eventsCount] = {m_stopEvent, m_workerThreadEvent, timerEvent};
-
-    status = InitializeDirectoryChangeEventsQueue();
-
-    if (status != ERROR_SUCCESS)
-    {
-        logWriter.TraceError(
-            Utility::FormatString(
-                L"Failed to enumerate log directory %ws. Some log files may not be monitored for application logs",
-                m_logDirectory.c_str()
-            ).c_str()
-        );
-    }
-
-    if (!SetWaitableTimer(timerEvent, &liDueTime, 0, NULL, NULL, 0))
-    {
-        status = GetLastError();
-        
-        logWriter.TraceError(
-            Utility::FormatString(
-                L"Failed to set timer object to monitor log file changes in directory %s. Error: %lu",
-                m_logDirectory.c_str(),
-                status
-            ).c_str()
-        );
-    }
-
-    while (!stopWatching)
-    {
-        DWORD wait = WaitForMultipleObjects(eventsCount, events, FALSE, INFINITE);
-        switch(wait)
-        {
-            case WAIT_OBJECT_0:
-            {
-                stopWatching = true;
-                CancelWaitableTimer(timerEvent);
-            }
-            break;
-
-            case WAIT_OBJECT_0 + 1:
-            {
-                AcquireSRWLockExclusive(&m_eventQueueLock);
-
-                while (m_directoryChangeEvents.size() > 0)
-                {
-                    auto event = m_directoryChangeEvents.front();
-                    m_directoryChangeEvents.pop();
-
-                    //
-                    // Try to recover the long path. The worst case is when it's already
-                    // a long path, and it will make a useless variable reassign.
-                    //
-                    auto it = m_longPaths.find(event.FileName);
-
-                    if (it != m_longPaths.end())
-                    {
-                        event.FileName = it->second;
-                    }
-
-                    ReleaseSRWLockExclusive(&m_eventQueueLock);
-
-                    switch (event.Action)
-                    {
-                        case EventAction::Add:
-                        {
-                            status = LogFileAddEventHandler(event);
-                            break;
-                        }
-
-                        case EventAction::Modify:
-                        {
-                            status = LogFileModifyEventHandler(event);
-                            break;
-                        }
-
-                        case EventAction::Remove:
-                        {
-                            status = LogFileRemoveEventHandler(event);
-                            break;
-                        }
-
-                        case EventAction::RenameOld:
-                        {
-                            //
-                            // Nothing to do
-                            //
-                            break;
-                        }
-
-                        case EventAction::RenameNew:
-                        {
-                            status = LogFileRenameNewEventHandler(event);
-                            break;
-                        }
-
-                        case EventAction::ReInit:
-                        {
-                            status = LogFileReInitEventHandler(event);
-                            break;
-                        }
-
-                        default:
-                            break;
-                    }
-
-                    AcquireSRWLockExclusive(&m_eventQueueLock);
-                }
-
-                if(!ResetEvent(m_workerThreadEvent))
-                {
-                    status = GetLastError();
-
-                    logWriter.TraceError(
-                        Utility::FormatString(
-                            L"Failed to reset event object to monitor log file changes in directory %s. Error: %lu",
-                            m_logDirectory.c_str(),
-                            status
-                        ).c_str()
-                    );
-                    stopWatching = true;
-                }
-
-                if (!SetWaitableTimer(timerEvent, &liDueTime, 0, NULL, NULL, 0))
-                {
-                    status = GetLastError();
-
-                    logWriter.TraceError(
-                        Utility::FormatString(
-                            L"Failed to set timer object to monitor log file changes in directory %s. Error: %lu",
-                            m_logDirectory.c_str(),
-                            status
-                        ).c_str()
-                    );
-                }
-
-                ReleaseSRWLockExclusive(&m_eventQueueLock);
-            }
-            break;
-
-            case WAIT_OBJECT_0 + 2:
-            {
-                map<std::wstring, std::shared_ptr<LogFileInformation>>::iterator it;
-
-                //wprintf(L"LogFilesChangeHandler: Timer event\n");
-
-                for ( it = m_logFilesInformation.begin(); it != m_logFilesInformation.end(); it++ )
-                {
-                    ReadLogFile(it->second);
-                }
-
-                if (!SetWaitableTimer(timerEvent, &liDueTime, 0, NULL, NULL, 0))
-                {
-                    status = GetLastError();
-
-                    logWriter.TraceError(
-                        Utility::FormatString(
-                            L"Failed to set timer object to monitor log file changes in directory %s. Error: %lu",
-                            m_logDirectory.c_str(),
-                            status
-                        ).c_str()
-                    );
-                }
-            }
-            break;
-
-            default:
-            {
-                status = GetLastError();
-
-                logWriter.TraceError(
-                    Utility::FormatString(
-                        L"Failed to wait on directory change notification events to monitor log file changes in directory %s. Error: %lu",
-                        m_logDirectory.c_str(),
-                        status
-                    ).c_str()
-                );
-                stopWatching = true;
-            }
-            break;
-        }
-    }
-
-    return status;
-}
-
-
-DWORD
-LogFileMonitor::LogFileAddEventHandler(
-    _In_ DirChangeNotificationEvent& Event
-    )
-{
-    DWORD status = ERROR_SUCCESS;
-
-    auto element = GetLogFilesInformationIt(Event.FileName);
-
-    if (element != m_logFilesInformation.end())
-    {
-        //
-        // Log file already exist. Do nothing.
-        //
-    }
-    else
-    {
-        const std::wstring fullLongPath = Utility::GetLongPath(m_logDirectory + L'\\' + Event.FileName);
-
-        DWORD ftyp = GetFileAttributesW(fullLongPath.c_str());
-        if (ftyp == INVALID_FILE_ATTRIBUTES)
-        {
-            status = GetLastError();
-            logWriter.TraceError(
-                Utility::FormatString(
-                    L"Error in log file monitor. Failed to query attributes of File: %ws. Error: %d",
-                    fullLongPath.c_str(),
-                    status
-                ).c_str()
-            );
-
-            return status;
-        }
-
-        if (!(ftyp & FILE_ATTRIBUTE_DIRECTORY))
-        {
-            auto logFileInfo = std::make_shared<LogFileInformation>();
-
-            //
-            // Get the short and long relative path
-            //
-            const std::wstring longPath = fullLongPath.substr(m_logDirectory.size() + 1);
-
-            const std::wstring shortPath = Utility::GetShortPath(fullLongPath).substr(m_shortLogDirectory.size() + 1);
-
-            logFileInfo->FileName = longPath;
-            logFileInfo->NextReadOffset = 0;
-            logFileInfo->LastReadTimestamp = 0;
-            logFileInfo->EncodingType = LM_FILETYPE::FileTypeUnknown;
-
-            FILE_ID_INFO fileId{ 0 };
-            status = GetFileId(fullLongPath, fileId);
-
-            if (status != ERROR_SUCCESS)
-            {
-                status = GetLastError();
-                logWriter.TraceError(
-                    Utility::FormatString(
-                        L"Error in log file monitor. Failed to query file ID. File: %ws. Error: %d",
-                        fullLongPath.c_str(),
-                        status
-                    ).c_str()
-                );
-            }
-
-            status = ReadLogFile(logFileInfo);
-
-            m_fileIds[fileId] = longPath;
-            m_longPaths[shortPath] = longPath;
-            m_logFilesInformation[longPath] = std::move(logFileInfo);
-        }
-    }
-
-    return status;
-}
-
-
-DWORD
-LogFileMonitor::LogFileRemoveEventHandler(
-    _In_ DirChangeNotificationEvent& Event
-    )
-{
-    DWORD status = ERROR_SUCCESS;
-    bool isShortPath = false;
-
-    auto element = GetLogFilesInformationIt(Event.FileName, &isShortPath);
-
-    if (element != m_logFilesInformation.end())
-    {
-        std::wstring longPath = element->second->FileName;
-
-        m_logFilesInformation.erase(element);
-
-        auto longPathIterator = (!isShortPath) ? m_longPaths.find(Event.FileName) :
-            std::find_if(
-                m_longPaths.begin(),
-                m_longPaths.end(),
-                [&longPath](const auto& it) { return _wcsicmp(it.second.c_str(), longPath.c_str()) == 0; });
-
-        if (longPathIterator != m_longPaths.end())
-        {
-            m_longPaths.erase(longPathIterator);
-        }
-
-        auto fileIdIterator =
-            std::find_if(
-                m_fileIds.begin(),
-                m_fileIds.end(),
-                [&longPath](const auto& it) { return _wcsicmp(it.second.c_str(), longPath.c_str()) == 0; });
-
-        if (fileIdIterator != m_fileIds.end())
-        {
-            m_fileIds.erase(fileIdIterator);
-        }
-    }
-    else
-    {
-        //
-        // Log file not found.
-        //
-    }
-
-    return status;
-}
-
-
-DWORD
-LogFileMonitor::LogFileModifyEventHandler(
-    _In_ DirChangeNotificationEvent& Event
-    )
-{
-    DWORD status = ERROR_SUCCESS;
-
-    auto element = GetLogFilesInformationIt(Event.FileName);
-
-    if (element != m_logFilesInformation.end() &&
-        Event.Timestamp > element->second->LastReadTimestamp)
-    {
-        status = ReadLogFile(element->second);
-    }
-    else
-    {
-        //
-        // Log file not found or event is too old.
-        //
-    }
-
-    return status;
-}
-
-DWORD
-LogFileMonitor::LogFileRenameNewEventHandler(
-    _In_ DirChangeNotificationEvent& Event
-    )
-{
-    DWORD status = ERROR_SUCCESS;
-
-    const std::wstring fullLongPath = Utility::GetLongPath(m_logDirectory + L'\\' + Event.FileName);
-    const std::wstring longPath = fullLongPath.substr(m_logDirectory.size() + 1);
-
-    DWORD ftyp = GetFileAttributesW(fullLongPath.c_str());
-    if (ftyp == INVALID_FILE_ATTRIBUTES)
-    {
-        status = GetLastError();
-        logWriter.TraceError(
-            Utility::FormatString(
-                L"Error in log file monitor. Failed to query file attributes. File: %ws. Error: %d",
-                fullLongPath.c_str(),
-                status
-            ).c_str()
-        );
-
-        return status;
-    }
-
-    if (ftyp & FILE_ATTRIBUTE_DIRECTORY)
-    {
-        if (m_includeSubfolders)
-        {
-            std::vector<std::pair<std::wstring, FILE_ID_INFO>> logFiles;
-
-            GetFilesInDirectory(fullLongPath, m_filter, logFiles, m_includeSubfolders);
-
-            for (auto file : logFiles)
-            {
-                const std::wstring& fileName = file.first;
-                const FILE_ID_INFO& fileId = file.second;
-
-                auto itFileId = m_fileIds.find(fileId);
-
-                if (itFileId != m_fileIds.end())
-                {
-                    RenameFileInMaps(fileName, itFileId->second, fileId);
-                }
-            }
-        }
-    }
-    else
-    {
-        FILE_ID_INFO fileId{ 0 };
-        GetFileId(fullLongPath, fileId);
-
-        auto it = m_fileIds.find(fileId);
-
-        if (it != m_fileIds.end())
-        {
-            if (FileMatchesFilter(fullLongPath.c_str(), m_filter.c_str()))
-            {
-                RenameFileInMaps(fullLongPath, it->second, fileId);
-            }
-            else
-            {
-                DirChangeNotificationEvent e = Event;
-
-                e.FileName = it->second;
-                e.Action = EventAction::Remove;
-
-                LogFileRemoveEventHandler(e);
-            }
-        }
-        else if (FileMatchesFilter(fullLongPath.c_str(), m_filter.c_str()))
-        {
-            DirChangeNotificationEvent e = Event;
-
-            e.FileName = longPath;
-            e.Action = EventAction::Add;
-
-            LogFileAddEventHandler(e);
-        }
-    }
-
-    return status;
-}
-
-///
-/// This functions replace all the occurrence of the OldName in the maps
-/// with the new name, based on a FileId. If it doesn't find the old
-/// elements in the maps, creates new ones.
-///
-/// \param NewFullName      The new full filename.
-/// \param OldName          The old relative filename.
-/// \param FileId           FileId of the file.
-///
-void
-LogFileMonitor::RenameFileInMaps(
-    _In_ const std::wstring& NewFullName,
-    _In_ const std::wstring& OldName,
-    _In_ const FILE_ID_INFO& FileId
-    )
-{
-    const std::wstring longPath = NewFullName.substr(m_logDirectory.size() + 1);
-    const std::wstring shortPath = Utility::GetShortPath(NewFullName).substr(m_shortLogDirectory.size() + 1);
-
-    auto it = GetLogFilesInformationIt(OldName);
-
-    shared_ptr<LogFileInformation> fileInfo;
-    if (it != m_logFilesInformation.end())
-    {
-        fileInfo = it->second;
-        fileInfo->FileName = longPath;
-        m_logFilesInformation.erase(it);
-    }
-    else
-    {
-        fileInfo = std::make_shared<LogFileInformation>();
-        fileInfo->FileName = longPath;
-        fileInfo->EncodingType = LM_FILETYPE::FileTypeUnknown;
-        fileInfo->LastReadTimestamp = 0;
-        fileInfo->NextReadOffset = 0;
-    }
-
-    //
-    // Try first the case when the long and short path are the same.
-    //
-    auto longPathIterator = m_longPaths.find(OldName);
-    if (longPathIterator == m_longPaths.end())
-    {
-        //
-        // Look for the map element with value equal to long path.
-        //
-        longPathIterator =
-            std::find_if(
-                m_longPaths.begin(),
-                m_longPaths.end(),
-                [&OldName](const auto& it) {
-                    return _wcsicmp(it.second.c_str(), OldName.c_str()) == 0;
-                }
-            );
-    }
-
-    if (longPathIterator != m_longPaths.end())
-    {
-        m_longPaths.erase(longPathIterator);
-    }
-
-    m_logFilesInformation[longPath] = fileInfo;
-    m_longPaths[shortPath] = longPath;
-    m_fileIds[FileId] = longPath;
-}
-
-
-DWORD
-LogFileMonitor::LogFileReInitEventHandler(
-    _In_ DirChangeNotificationEvent& Event
-    )
-{
-    DWORD status = ERROR_SUCCESS;
-    std::vector<std::pair<std::wstring, FILE_ID_INFO>> logFiles;
-
-    status = GetFilesInDirectory(m_logDirectory, m_filter, logFiles, m_includeSubfolders);
-
-    if (status == ERROR_SUCCESS)
-    {
-        for (auto file : logFiles)
-        {
-            const std::wstring& fileName = file.first;
-            const FILE_ID_INFO& fileId = file.second;
-
-            const std::wstring longPath = fileName.substr(m_logDirectory.size() + 1);
-
-            auto element = GetLogFilesInformationIt(longPath);
-
-            if (element != m_logFilesInformation.end())
-            {
-                //
-                // Log file already exist. Do nothing.
-                //
-            }
-            else
-            {
-                auto logFileInfo = std::make_shared<LogFileInformation>();
-
-                const std::wstring shortPath = Utility::GetShortPath(fileName).substr(m_shortLogDirectory.size() + 1);
-
-                logFileInfo->FileName = longPath;
-                logFileInfo->NextReadOffset = 0;
-                logFileInfo->LastReadTimestamp = 0;
-
-                m_longPaths[shortPath] = longPath;
-                m_logFilesInformation[longPath] = std::move(logFileInfo);
-                m_fileIds[fileId] = longPath;
-            }
-        }
-    }
-    else
-    {
-        logWriter.TraceError(
-            Utility::FormatString(
-                L"Error in log file monitor. Failed to enumerate log directory %ws. Error: %d",
-                m_logDirectory.c_str(),
-                GetLastError()
-            ).c_str()
-        );
-    }
-
-    map<std::wstring, std::shared_ptr<LogFileInformation>>::iterator it;
-
-    //wprintf(L"LogFilesChangeHandler: Timer event\n");
-
-    for ( it = m_logFilesInformation.begin(); it != m_logFilesInformation.end(); it++ )
-    {
-        ReadLogFile(it->second);
-    }
-
-    return status;
-}
-
-
-DWORD
-LogFileMonitor::ReadLogFile(
-    _Inout_ std::shared_ptr<LogFileInformation> LogFileInfo
-    )
-{
-    DWORD status = ERROR_SUCCESS;
-    OVERLAPPED overlapped = { 0, 0, 0, 0, nullptr };
-    BYTE bom[3 * sizeof(char)] = { 0, 0, 0 }; // Bom could be up to 3 bytes size in UTF8.
-    bool wasBomRead = false;
-
-    const std::wstring fullLongPath = m_logDirectory + L'\\' + LogFileInfo->FileName;
-
-    HANDLE logFile = CreateFileW(fullLongPath.c_str(),
-                                  GENERIC_READ,
-                                  FILE_SHARE_READ | FILE_SHARE_WRITE,
-                                  nullptr,
-                                  OPEN_EXISTING,
-                                  FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
-                                  nullptr);
-    if (logFile == INVALID_HANDLE_VALUE)
-    {
-        status = GetLastError();
-        if (status == ERROR_FILE_NOT_FOUND || status == ERROR_PATH_NOT_FOUND)
-        {
-            //
-            // This errors should not trace anything.
-            //
-            status = ERROR_SUCCESS;
-        }
-        else
-        {
-            logWriter.TraceError(
-                Utility::FormatString(
-                    L"Error in log file monitor. Failed to open file %ws. Error: %d",
-                    fullLongPath.c_str(),
-                    status
-                ).c_str()
-            );
-        }
-        return status;
-    }
-
-    DWORD dwPtr = SetFilePointer(logFile, 0L, NULL, FILE_BEGIN);
-    if (dwPtr == INVALID_SET_FILE_POINTER)
-    {
-        logWriter.TraceError(
-            Utility::FormatString(
-                L"Error in log file monitor. SetFilePointer failed. File: %ws. Error: %d",
-                fullLongPath.c_str(),
-                GetLastError()
-            ).c_str()
-        );
-    }
-
-    //
-    // If the beginning of the file hasn't been read yet, don't get the BOM.
-    // Also, if EncodingType is already known, skip this.
-    //
-    if (LogFileInfo->NextReadOffset >= 3 && LogFileInfo->EncodingType == LM_FILETYPE::FileTypeUnknown)
-    {
-        DWORD bytesRead = 0;
-        overlapped.Offset = 0;
-        overlapped.OffsetHigh = 0;
-
-        if (!::ReadFile(
-                logFile,
-                &bom,
-                sizeof(bom),
-                &bytesRead,
-                &overlapped)
-            || bytesRead < (sizeof(bom) - 1)) // UTF16 BOM could be only 2 bytes
-        {
-            //
-            // It wasn't possible to read the BOM or it was smaller than expected.
-            //
-            wasBomRead = false;
-        }
-        else
-        {
-            wasBomRead = true;
-        }
-    }
-
-    //
-    //log the name of the source log file if includeFileNames field if true
-    //
-    wstring fileName;
-    if (m_includeFileNames)
-    {
-        fileName = Utility::FormatString(L"[Log File: %ws] ", LogFileInfo->FileName.c_str()).c_str();
-    }
-
-    const DWORD bytesToRead = 4096;
-    std::vector<BYTE> logFileContents(
-        static_cast<size_t>(bytesToRead));
-    DWORD bytesRead = 0;
-
-    std::wstring currentLineBuffer;
-
-    //
-    // It's important to catch a possible error inside the loop, to at least print
-    // the content of currentLineBuffer, if it has any.
-    //
-    try
-    {
-        do
-        {
-            bytesRead = 0;
-
-            overlapped.Offset = UINT(LogFileInfo->NextReadOffset & 0xFFFFFFFF);
-            overlapped.OffsetHigh = UINT(LogFileInfo->NextReadOffset >> 32);
-
-            LogFileInfo->LastReadTimestamp = GetTickCount64();
-
-            if (!::ReadFile(
-                logFile,
-                logFileContents.data(),
-                bytesToRead,
-                &bytesRead,
-                &overlapped))
-            {
-                status = GetLastError();
-                if (status == ERROR_HANDLE_EOF)
-                {
-                    bytesRead = 0;
-                    status = ERROR_SUCCESS;
-                }
-                else
-                {
-                    logWriter.TraceError(
-                        Utility::FormatString(
-                            L"Error in log file monitor. File read error. File: %ws. Error: %d",
-                            LogFileInfo->FileName.c_str(),
-                            GetLastError()
-                        ).c_str()
-                    );
-
-                    LogFileInfo->LastReadTimestamp = 0;
-                }
-                break;
-            }
-
-            if (bytesRead > 0)
-            {
-                //
-                // Get file type if it's still unknown
-                //
-                UINT foundBomSize = 0;
-                if (LogFileInfo->EncodingType == LM_FILETYPE::FileTypeUnknown)
-                {
-                    if (wasBomRead)
-                    {
-                        LogFileInfo->EncodingType = this->FileTypeFromBuffer(
-                            logFileContents.data(),
-                            bytesRead,
-                            bom,
-                            sizeof(bom),
-                            foundBomSize
-                        );
-                    }
-                    else
-                    {
-                        LogFileInfo->EncodingType = this->FileTypeFromBuffer(
-                            logFileContents.data(),
-                            bytesRead,
-                            logFileContents.data(),
-                            bytesRead,
-                            foundBomSize
-                        );
-                    }
-                }
-
-                //
-                // Check if we need to skip only some bytes, instead of the whole BOM
-                //
-                if (foundBomSize > LogFileInfo->NextReadOffset)
-                {
-                    foundBomSize = (UINT)(foundBomSize - LogFileInfo->NextReadOffset);
-                }
-                else
-                {
-                    //
-                    // It means that the BOM is not in the read content
-                    //
-                    foundBomSize = 0;
-                }
-
-                //
-                // Decode read string to UTF16, skipping the BOM if necessary.
-                //
-                const std::wstring decodedString = ConvertStringToUTF16(
-                    logFileContents.data() + foundBomSize,
-                    bytesRead - foundBomSize,
-                    LogFileInfo->EncodingType
-                );
-
-                //
-                // Search 'new line' characters, and if found, print the line.
-                //
-                std::size_t found = decodedString.find_last_of(L"\n\r");
-                std::size_t remainingStringIndex = 0;
-
-                if (found != std::string::npos)
-                {
-                    remainingStringIndex = found + 1;
-
-                    if ((found - 1) >= 0
-                        && (decodedString[(found - 1)] == L'\n' || decodedString[(found - 1)] == L'\r')
-                        && decodedString[(found - 1)] != decodedString[found])
-                    {
-                        //
-                        // Is a CR LF or LF CR new line, and we don't want to print two new lines
-                        //
-                        found--;
-                    }
-
-                    // TODO(annandaa): handle the writing to file case. The UTF-16 BOM should be added at
-                    // the beginning, and use WriteLog function.
-                    // Also, in the writing to file scenario, instead of print each line here,
-                    // we should store the lines to print, and then, print them once time.
-
-                    //
-                    // Write to console log.
-                    //
-                    if (!currentLineBuffer.empty())
-                    {
-                        try
-                        {
-                            currentLineBuffer.insert(
-                                currentLineBuffer.end(),
-                                decodedString.begin(),
-                                decodedString.begin() + found
-                            );
-                            LogFileMonitor::WriteToConsole(currentLineBuffer, LogFileInfo->FileName);
-                        }
-                        catch (...)
-                        {
-                            //
-                            // If insert failed, print them now.
-                            //
-                            LogFileMonitor::WriteToConsole(currentLineBuffer, LogFileInfo->FileName);
-
-                            std::wstring remainingBuffer = decodedString.substr(0, found);
-                            LogFileMonitor::WriteToConsole(remainingBuffer, LogFileInfo->FileName);
-                        }
-
-                        currentLineBuffer.clear();
-                    }
-                    else
-                    {
-                        //
-                        // newLineBuffer was empty, so only print the found line.
-                        //
-                        std::wstring foundLineBuffer = decodedString.substr(0, found);
-                        LogFileMonitor::WriteToConsole(foundLineBuffer, LogFileInfo->FileName);
-                    }
-                }
-                //
-                // If the whole line wasn't printed (the last character wasn't a new line), add the remainder
-                // to currentLineBuffer.
-                //
-                if(remainingStringIndex < decodedString.size())
-                {
-                    try
-                    {
-                        currentLineBuffer.insert(currentLineBuffer.end(),
-                                                 decodedString.begin() + remainingStringIndex,
-                                                 decodedString.end());
-                    }
-                    catch (...)
-                    {
-                        //
-                        // If insert failed, print buffers now and clear currentLineBuffer.
-                        //
-                        std::wstring remainingBuffer(decodedString.begin() + remainingStringIndex, decodedString.end());
-
-                        LogFileMonitor::WriteToConsole(currentLineBuffer, LogFileInfo->FileName);
-                        LogFileMonitor::WriteToConsole(remainingBuffer, LogFileInfo->FileName);
-                        currentLineBuffer.clear();
-                    }
-                }
-            }
-
-            LogFileInfo->NextReadOffset += bytesRead;
-        } while (bytesRead > 0);
-    }
-    catch (...) {}
-
-    if (!currentLineBuffer.empty())
-    {
-        //
-        // If we reach EOF, print the last line.
-        //
-        LogFileMonitor::WriteToConsole(currentLineBuffer, LogFileInfo->FileName);
-    }
-
-    CloseHandle(logFile);
-
-    return status;
-}
-
-void LogFileMonitor::WriteToConsole( _In_ std::wstring Message, _In_ std::wstring FileName) {
-    wstring prefix;
-    if (m_includeFileNames)
-    {
-        prefix = Utility::FormatString(L"[Log File: %s] ", FileName.c_str());
-    }
-
-    logWriter.WriteConsoleLog(prefix + Utility::ReplaceAll(Message, L"\n", L"\n" + prefix));
-}
-
-DWORD
-LogFileMonitor::GetFilesInDirectory(
-    _In_ const std::wstring& FolderPath,
-    _In_ const std::wstring& SearchPattern,
-    _Out_ std::vector<std::pair<std::wstring, FILE_ID_INFO>>& Files,
-    _In_ bool ShouldLookInSubfolders
-    )
-{
-    WIN32_FIND_DATA ffd;
-    DWORD status = ERROR_SUCCESS;
-
-    //
-    // First search through subfolders.
-    //
-    if (ShouldLookInSubfolders)
-    {
-        std::wstring toSearch = FolderPath + L"\\*";
-        HANDLE hFind = FindFirstFileW(toSearch.c_str(), &ffd);
-        if (hFind != INVALID_HANDLE_VALUE)
-        {
-            do
-            {
-                if ((ffd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) && (ffd.cFileName[0] != L'.'))
-                {
-                    std::wstring subfolderPath = FolderPath + L"\\" + ffd.cFileName;
-                    status = GetFilesInDirectory(subfolderPath, SearchPattern, Files, true);
-                }
-            } while (FindNextFile(hFind, &ffd) != 0 && (status == ERROR_SUCCESS));
-            FindClose(hFind);
-        }
-        else
-        {
-            status = GetLastError();
-        }
-    }
-
-    if (status == ERROR_SUCCESS)
-    {
-        //
-        // Now search for files using SearchPattern
-        //
-        std::wstring toSearch = FolderPath + L"\\" + SearchPattern;
-        HANDLE hFind = FindFirstFileW(toSearch.c_str(), &ffd);
-        if (hFind != INVALID_HANDLE_VALUE)
-        {
-            do
-            {
-                //
-                // Filter out the files that do not match the specified filter.
-                //
-                if (!(ffd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
-                    && FileMatchesFilter(ffd.cFileName, SearchPattern.c_str()))
-                {
-                    std::wstring fileName = FolderPath + L"\\" + ffd.cFileName;
-
-                    FILE_ID_INFO fileId{ 0 };
-                    GetFileId(fileName, fileId);
-
-                    //wprintf(L"Started monitoring file: %s\n",fileName.c_str());
-
-                    Files.push_back({ fileName, fileId });
-                }
-            } while (FindNextFile(hFind, &ffd) != 0);
-
-            status = GetLastError();
-
-            if (status == ERROR_NO_MORE_FILES)
-            {
-                status = ERROR_SUCCESS;
-            }
-
-            FindClose(hFind);
-        }
-    }
-
-
-    return status;
-}
-
-LM_FILETYPE
-LogFileMonitor::FileTypeFromBuffer(
-    _In_reads_bytes_(ContentSize) LPBYTE FileContents,
-    _In_ UINT ContentSize,
-    _In_reads_bytes_(BomSize) LPBYTE Bom,
-    _In_ UINT BomSize,
-    _Out_ UINT& FoundBomSize
-    )
-{
-    LM_FILETYPE lmFileType = LM_FILETYPE::FileTypeUnknown;
-    FoundBomSize = 0;
-
-    PWSTR szBuf = (PWSTR)FileContents;
-    if (ContentSize <= 1 && BomSize <= 1)
-    {
-        return lmFileType;
-    }
-
-    switch (*((PWSTR)Bom))
-    {
-    //
-    // look for the standard BOMs.
-    //
-    case BYTE_ORDER_MARK:
-        lmFileType = LM_FILETYPE::UTF16LE;
-        FoundBomSize = sizeof(WCHAR);
-        break;
-
-    case REVERSE_BYTE_ORDER_MARK:
-        lmFileType = LM_FILETYPE::UTF16BE;
-        FoundBomSize = sizeof(WCHAR);
-        break;
-
-    //
-    // UTF bom has 3 bytes.
-    //
-    case BOM_UTF8_HALF:
-        if (BomSize > 2 && ((BYTE) * ((Bom)+2) == BOM_UTF8_2HALF))
-        {
-            lmFileType = LM_FILETYPE::UTF8;
-            FoundBomSize = sizeof(char) * 3;
-            break;
-        }
-
-        //
-        // If UTF8 BOM doesn't match, continue with the evaluation
-        //
-    default:
-        //
-        // Is the file unicode without BOM ?
-        //
-        if (Utility::IsInputTextUnicode((LPCSTR)FileContents, ContentSize))
-        {
-            lmFileType = LM_FILETYPE::UTF16LE;
-        }
-        else
-        {
-            //
-            // Is the file UTF-8 even though it doesn't have UTF-8 BOM ?
-            //
-            if (Utility::IsTextUTF8((LPCSTR)FileContents, ContentSize))
-            {
-                lmFileType = LM_FILETYPE::UTF8;
-            }
-            //
-            // well, it is most likely an ansi file.
-            //
-            else
-            {
-                lmFileType = LM_FILETYPE::ANSI;
-            }
-        }
-        break;
-    }
-
-    return lmFileType;
-}
-
-
-std::wstring
-LogFileMonitor::ConvertStringToUTF16(
-    _In_reads_bytes_(StringSize) LPBYTE StringPtr,
-    _In_ UINT StringSize,
-    _In_ LM_FILETYPE EncodingType
-    )
-{
-    std::wstring Result;
-    if (StringSize == 0)
-    {
-        return std::wstring();
-    }
-
-    switch (EncodingType)
-    {
-    case LM_FILETYPE::UTF16LE:
-    {
-        Result = wstring((wchar_t*)StringPtr, (wchar_t*)(StringPtr + StringSize));
-        break;
-    }
-    case LM_FILETYPE::UTF16BE:
-    {
-        Result = wstring((wchar_t*)StringPtr, (wchar_t*)(StringPtr + StringSize));
-
-        //
-        // Reverse each wide character, to make it little endian
-        //
-        for (unsigned int i = 0; i < Result.size(); i++)
-        {
-            Result[i] = (TCHAR)(((Result[i] << 8) & 0xFF00) + ((Result[i] >> 8) & 0xFF));
-        }
-        break;
-    }
-    case LM_FILETYPE::UTF8:
-    {
-        int size_needed = MultiByteToWideChar(CP_UTF8, 0, (LPCCH)StringPtr, StringSize, NULL, 0);
-        Result.resize(size_needed);
-
-        MultiByteToWideChar(CP_UTF8, 0, (LPCCH)StringPtr, StringSize, (LPWSTR)(Result.data()), size_needed);
-        break;
-    }
-    default:
-    {
-        std::string tempStr((char*)StringPtr, (char*)(StringPtr + StringSize));
-        //
-        // ANSI
-        //
-        Result = wstring(tempStr.begin(), tempStr.end());
-    }
-    }
-
-    return Result;
-}
-
-///
-/// Gets an iterator, using first the Key as if it was a long path, and if it
-/// isn't found recovering the long path using Key as a short path.
-///
-/// \param Key         The filename to look for.
-/// \param IsShortPath Optional boolean pointer. If it's passed, it will return
-///     false if the key wasn't a short path. Otherwise, will be true.
-///
-/// \return Iterator to a m_logFilesInformation element.
-///
-LogFileMonitor::LogFileInfoMap::iterator
-LogFileMonitor::GetLogFilesInformationIt(
-    _In_ const std::wstring& Key,
-    _Out_opt_ bool* IsShortPath
-    )
-{
-    auto element = m_logFilesInformation.find(Key);
-
-    if (element == m_logFilesInformation.end())
-    {
-        auto longPath = m_longPaths.find(Key);
-        if (longPath != m_longPaths.end())
-        {
-            element = m_logFilesInformation.find(longPath->second);
-        }
-
-        if (IsShortPath != NULL)
-        {
-            *IsShortPath = true;
-        }
-    }
-    else
-    {
-        if (IsShortPath != NULL)
-        {
-            *IsShortPath = false;
-        }
-    }
-
-    return element;
-}
-
-///
-/// Gets the file id from a specified file.
-///
-/// \param FullLongPath     The filename of the file to get its id.
-/// \param FileId           An output parameter, with the file id.
-/// \param Handle           Optional. If it is passed, it doesn't need to
-///     open the file again.
-///
-/// \return DWORD with a standard result of the function.
-///
-DWORD
-LogFileMonitor::GetFileId(
-    _In_ const std::wstring& FullLongPath,
-    _Out_ FILE_ID_INFO& FileId,
-    _In_opt_ HANDLE Handle
-    )
-{
-    DWORD status = ERROR_SUCCESS;
-
-    //
-    // Flag to close the handle at the end of the function.
-    //
-    bool handleWasGiven = false;
-
-    if (Handle == INVALID_HANDLE_VALUE)
-    {
-        Handle = CreateFileW(FullLongPath.c_str(),
-            GENERIC_READ,
-            FILE_SHARE_READ | FILE_SHARE_WRITE,
-            nullptr,
-            OPEN_EXISTING,
-            FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
-            nullptr);
-    }
-    else
-    {
-        handleWasGiven = true;
-    }
-
-    if (Handle == INVALID_HANDLE_VALUE)
-    {
-        status = GetLastError();
-        logWriter.TraceError(
-            Utility::FormatString(
-                L"Error in log file monitor. Failed to open file %ws. Error: %d",
-                FullLongPath.c_str(),
-                status
-            ).c_str()
-        );
-        return status;
-    }
-
-    BOOL infoQueryStatus = ::GetFileInformationByHandleEx(
-        Handle,
-        FileIdInfo,
-        &FileId,
-        sizeof(FILE_ID_INFO));
-
-    if (!infoQueryStatus)
-    {
-        status = GetLastError();
-        logWriter.TraceError(
-            Utility::FormatString(
-                L"Error in log file monitor. Failed to query file information. File: %ws. Error: %d",
-                FullLongPath.c_str(),
-                status
-            ).c_str()
-        );
-    }
-
-    if (!handleWasGiven)
-    {
-        CloseHandle(Handle);
-    }
-
-    return status;
-}
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+
+#include "pch.h"
+
+using namespace std;
+
+///
+/// LogFileMonitor.cpp
+///
+/// Monitors a log directory for changes to the log files matching the criteria specified by a filter.
+///
+/// LogFileMonitor starts a monitor thread that waits for file change notifications from a DirectoryWatcher
+/// (ReadDirectoryChangesW on Windows) or for a stop event to be set. The change notification events are processed, and the log files read, by jobs
+/// posted to a strand of the LogReaderPool shared by all the monitors.
+///
+/// The destructor signals the stop event and waits for the monitoring thread to exit, once the reader jobs
+/// of the monitor finished. If it takes longer than LOG_MONITOR_THREAD_EXIT_MAX_WAIT_MILLIS, the delay is
+/// traced and the destructor keeps waiting, so neither the thread nor a reader job out-lives LogFileMonitor.
+///
+
+
+///
+/// Constructor creates a thread to monitor log directory changes and waits until
+/// that thread registers for directory change notifications. This ensures that no
+/// changes to log files are missed once the LogFileMonitor object is created.
+///
+/// \param LogDirectory:        The log directory to be monitored
+/// \param Filter:              The filter to apply when looking fr log files
+/// \param IncludeSubfolders:   TRUE if subdirectories also needs to be monitored
+/// \param IncludeFileNames:    TRUE if the file name is printed before each line
+/// \param MaxReadBufferSize:   Maximum size in bytes of the read buffer of each file.
+///                             Zero uses AdaptiveReadBuffer::DEFAULT_MAX_SIZE_BYTES
+/// \param CheckpointFile:      File where the read offsets are saved, to resume
+///                             reading after a restart. Empty to disable checkpoints
+/// \param CheckpointIntervalSeconds: Minimum time between two saves of the checkpoint
+///                             file. Zero uses DEFAULT_CHECKPOINT_INTERVAL_SECONDS
+/// \param OutputSourceId:      Id returned by LogWriter::RegisterSource for this source
+/// \param WatcherFactory:      Creates the watcher of the directory changes. nullptr
+///                             for a Win32DirectoryWatcher
+///
+LogFileMonitor::LogFileMonitor(_In_ const std::wstring& LogDirectory,
+                               _In_ const std::wstring& Filter,
+                               _In_ bool IncludeSubfolders,
+                               _In_ bool IncludeFileNames,
+                               _In_ DWORD MaxReadBufferSize,
+                               _In_ const std::wstring& CheckpointFile,
+                               _In_ DWORD CheckpointIntervalSeconds,
+                               _In_ UINT32 OutputSourceId,
+                               _In_ DirectoryWatcherFactory WatcherFactory
+                               ) :
+                               m_logDirectory(LogDirectory),
+                               m_filter(Filter),
+                               m_includeSubfolders(IncludeSubfolders),
+                               m_includeFileNames(IncludeFileNames),
+                               m_maxReadBufferSize(MaxReadBufferSize != 0
+                                   ? MaxReadBufferSize
+                                   : AdaptiveReadBuffer::DEFAULT_MAX_SIZE_BYTES),
+                               m_outputSourceId(OutputSourceId),
+                               m_directoryWatcherFactory(std::move(WatcherFactory)),
+                               m_fileHandles(
+                                   MAX_CACHED_FILE_HANDLES,
+                                   [](const FILE_ID_INFO&, HANDLE& Handle) { CloseHandle(Handle); }),
+                               m_readerStrand(LogReaderPool::Shared())
+{
+    if (!CheckpointFile.empty())
+    {
+        m_checkpointStore = std::make_unique<LogFileCheckpointStore>(CheckpointFile);
+    }
+
+    if (CheckpointIntervalSeconds == 0)
+    {
+        CheckpointIntervalSeconds = DEFAULT_CHECKPOINT_INTERVAL_SECONDS;
+    }
+    else if (CheckpointIntervalSeconds > MAX_CHECKPOINT_INTERVAL_SECONDS)
+    {
+        CheckpointIntervalSeconds = MAX_CHECKPOINT_INTERVAL_SECONDS;
+    }
+
+    m_checkpointIntervalMillis = CheckpointIntervalSeconds * 1000;
+    m_lastCheckpointTime = 0;
+    m_checkpointDirty = false;
+    m_checkpointsRestored = false;
+    m_resumedFilesCount = 0;
+    m_pollTimerDueTimestamp = 0;
+
+    m_stopEvent = NULL;
+    m_pollTimer = NULL;
+    m_dirMonitorStartedEvent = NULL;
+    m_logDirMonitorThread = NULL;
+
+    InitializeSRWLock(&m_eventQueueLock);
+
+    while (!m_logDirectory.empty() && m_logDirectory[ m_logDirectory.size() - 1 ] == L'\\')
+    {
+        m_logDirectory.resize(m_logDirectory.size() - 1);
+    }
+    m_logDirectory = PREFIX_EXTENDED_PATH + m_logDirectory;
+
+    if (m_filter.empty())
+    {
+        m_filter = L"*";
+    }
+
+    m_stopEvent = CreateFileMonitorEvent(TRUE, FALSE);
+
+    m_pollTimer = CreateWaitableTimer(NULL, FALSE, NULL);
+    if (!m_pollTimer)
+    {
+        throw std::system_error(std::error_code(GetLastError(), std::system_category()), "CreateWaitableTimer");
+    }
+
+    m_readerJobsStarted = false;
+
+    m_dirMonitorStartedEvent = CreateFileMonitorEvent(TRUE, FALSE);
+
+    m_readLogFilesFromStart = false;
+
+    m_logDirMonitorThread = CreateThread(
+        nullptr,
+        0,
+        (LPTHREAD_START_ROUTINE)&LogFileMonitor::StartLogFileMonitorStatic,
+        this,
+        0,
+        nullptr);
+    if(!m_logDirMonitorThread)
+    {
+        throw std::system_error(std::error_code(GetLastError(), std::system_category()), "CreateThread");
+    }
+
+    //
+    // Wait until log directory change notification is registered or the monitoring thread exited.
+    //
+    const DWORD eventsCount = 2;
+    HANDLE events[eventsCount] = {m_dirMonitorStartedEvent, m_logDirMonitorThread};
+    DWORD waitResult = WaitForMultipleObjects(eventsCount, events, FALSE, INFINITE);
+
+    if (waitResult != WAIT_OBJECT_0)
+    {
+        if (waitResult == WAIT_OBJECT_0 + 1)
+        {
+            DWORD threadExitCode;
+            HRESULT hr = GetExitCodeThread(m_logDirMonitorThread, &threadExitCode)
+                            ? HRESULT_FROM_WIN32(threadExitCode) : HRESULT_FROM_WIN32(GetLastError());
+
+            if (FAILED(hr))
+            {
+                throw std::system_error(std::error_code(hr, std::system_category()), "StartLogFileMonitorStatic");
+            }
+        }
+        else
+        {
+            throw std::system_error(std::error_code(GetLastError(), std::system_category()), "WaitForMultipleObjects");
+        }
+    }
+}
+
+
+LogFileMonitor::~LogFileMonitor()
+{
+    const DWORD eventsCount = 1;
+    HANDLE events[eventsCount] = {m_logDirMonitorThread};
+
+    if(!SetEvent(m_stopEvent))
+    {
+        logWriter.TraceError(
+            FORMAT_STRING(L"Failed to signal event to stop log file monitor. %lu", GetLastError()).c_str()
+        );
+    }
+    else
+    {
+        //
+        // Wait for the directory monitor thread to exit. It waits for the
+        // reader jobs of this monitor to finish.
+        //
+        DWORD waitResult = WaitForMultipleObjects(eventsCount, events, TRUE, LOG_MONITOR_THREAD_EXIT_MAX_WAIT_MILLIS);
+
+        if (waitResult == WAIT_TIMEOUT)
+        {
+            //
+            // A reader job is still running, like a long read. The thread
+            // and the jobs use the members of the monitor, so it can't be
+            // destroyed before they finish.
+            //
+            logWriter.TraceWarning(
+                FORMAT_STRING(
+                    L"Log file monitor of directory %s is still waiting for its reads to finish before it stops.",
+                    m_logDirectory.c_str()
+                ).c_str()
+            );
+
+            waitResult = WaitForMultipleObjects(eventsCount, events, TRUE, INFINITE);
+        }
+
+        if (waitResult != WAIT_OBJECT_0)
+        {
+            HRESULT hr = (waitResult == WAIT_FAILED) ? HRESULT_FROM_WIN32(GetLastError())
+                                                           : HRESULT_FROM_WIN32(waitResult);
+            if (FAILED(hr))
+            {
+                logWriter.TraceError(
+                    FORMAT_STRING(
+                        L"Failed to wait for log file monitor to stop. Log directory: %s Error: %lu",
+                        m_logDirectory.c_str(),
+                        hr
+                    ).c_str()
+                );
+            }
+        }
+    }
+
+    if (!m_logDirMonitorThread)
+    {
+        CloseHandle(m_logDirMonitorThread);
+    }
+
+    //
+    // In case the monitor thread didn't run.
+    //
+    m_readerStrand.Close();
+
+    if (!m_dirMonitorStartedEvent)
+    {
+        CloseHandle(m_dirMonitorStartedEvent);
+    }
+
+    if (m_pollTimer)
+    {
+        CloseHandle(m_pollTimer);
+    }
+
+    if (!m_stopEvent)
+    {
+        CloseHandle(m_stopEvent);
+    }
+}
+
+
+///
+/// Worker routine to monitor log directory changes.
+///
+/// \param Context: LogFileMonitor object passed in as callback context
+///
+/// \return ERROR_SUCCESS: If log monitoring is started successfully
+///         Failure:       If log directory monitoring failed.
+///
+DWORD
+LogFileMonitor::StartLogFileMonitorStatic(
+    _In_ LPVOID Context
+    )
+{
+    auto pThis = reinterpret_cast<LogFileMonitor*>(Context);
+    DWORD status = ERROR_SUCCESS;
+
+    try
+    {
+        status = pThis->StartLogFileMonitor();
+        if (status != ERROR_SUCCESS)
+        {
+            logWriter.TraceError(
+                FORMAT_STRING(
+                    L"Failed to start log file monitor. Log files in a directory %s will not be monitored. Error: %lu",
+                    pThis->m_logDirectory.c_str(),
+                    status
+                ).c_str()
+            );
+        }
+    }
+    catch (std::exception& ex)
+    {
+        logWriter.TraceError(
+            FORMAT_STRING(
+                L"Failed to start log file monitor. Log files in a directory %s will not be monitored. %S",
+                pThis->m_logDirectory.c_str(),
+                ex.what()
+            ).c_str()
+        );
+        status = E_FAIL;
+    }
+    catch (...)
+    {
+        logWriter.TraceError(
+            FORMAT_STRING(
+                L"Failed to start log file monitor. Log files in a directory %s will not be monitored.",
+                pThis->m_logDirectory.c_str()
+            ).c_str()
+        );
+        status = E_FAIL;
+    }
+
+    //
+    // Let the reader jobs already posted, like the last checkpoint save,
+    // finish before the thread exits.
+    //
+    pThis->m_readerStrand.Close();
+
+    pThis->m_directoryWatcher.reset();
+
+    return status;
+}
+
+DWORD LogFileMonitor::EnqueueDirChangeEvents(DirChangeNotificationEvent event, BOOLEAN lock = TRUE) {
+    if (event.Action != EventAction::ReInit && event.Action != EventAction::RenameNew)
+    {
+        if (!FileMatchesFilter((LPCWSTR)(event.FileName.c_str()), m_filter.c_str()))
+        {
+            //
+            // It could be because the name was short formatted. Make it long path and try again.
+            //
+            event.FileName = Utility::GetLongPath(m_logDirectory + L'\\' + event.FileName)
+                                        .substr(m_logDirectory.size() + 1);
+
+            if (!FileMatchesFilter((LPCWSTR)(event.FileName.c_str()), m_filter.c_str()))
+            {
+                return ERROR_NO_MATCH;
+            }
+        }
+    }
+
+    if(lock) AcquireSRWLockExclusive(&m_eventQueueLock);
+
+    //
+    // The job drains the whole queue, only post one when the queue was empty.
+    // Before the reader starts, StartReaderJob processes the queued events.
+    //
+    const UINT64 overflows = m_directoryChangeEvents.GetStatistics().Overflows;
+
+    if (m_directoryChangeEvents.Push(event) && m_readerJobsStarted)
+    {
+        PostReaderJob([this]() { return DirChangeEventsJob(); });
+    }
+
+    if (m_directoryChangeEvents.GetStatistics().Overflows != overflows)
+    {
+        logWriter.TraceWarning(
+            FORMAT_STRING(
+                L"Log file monitor change event queue is full, the directory %ws will be scanned again.",
+                m_logDirectory.c_str()
+            ).c_str()
+        );
+    }
+
+    if(lock) ReleaseSRWLockExclusive(&m_eventQueueLock);
+
+    return ERROR_SUCCESS;
+}
+
+
+///
+/// Entry for the spawned log file monitor thread. It loops to wait for either the stop event in which case it exits
+/// or for the log file changes. When log file changes are notified, it inserts the changed file information into a
+/// queue, signal the change notification worker thread, resets, and starts the wait again.
+///
+/// \return ERROR_SUCCESS: If log monitoring is started successfully
+///         Failure:       If log directory monitoring failed.
+///
+DWORD
+LogFileMonitor::StartLogFileMonitor()
+{
+    DWORD status = ERROR_SUCCESS;
+    const DWORD eventsCount = 3;
+    bool stopWatching = false;
+
+    //
+    // With checkpoints enabled, wake up at least once per interval to save
+    // the offsets of the files read since the last save.
+    //
+    const DWORD waitTimeout = m_checkpointStore ? m_checkpointIntervalMillis : INFINITE;
+
+    SetEvent(m_dirMonitorStartedEvent);
+
+    // Get Log Dir Handle
+    HANDLE logDirHandle = GetLogDirHandle(m_logDirectory, m_stopEvent);
+
+    if(logDirHandle == INVALID_HANDLE_VALUE) {
+        status = GetLastError();
+
+        logWriter.TraceError(
+            FORMAT_STRING(
+                L"Failed to open log directory handle. Directory: %ws Error=%d",
+                m_logDirectory.c_str(),
+                status
+            ).c_str()
+        );
+        return status;
+    }
+
+    // Handle cases where log file didn't exist during init and we need to read content added within 15 second wait
+    DWORD lastLogHandleError = GetLastError();
+    if (lastLogHandleError == ERROR_FILE_NOT_FOUND ||
+        lastLogHandleError == ERROR_PATH_NOT_FOUND)
+    {
+        m_readLogFilesFromStart = true;
+    }
+
+    try
+    {
+        if (m_directoryWatcherFactory)
+        {
+            m_directoryWatcher = m_directoryWatcherFactory(logDirHandle, m_includeSubfolders);
+        }
+        else
+        {
+            m_directoryWatcher = std::make_unique<Win32DirectoryWatcher>(logDirHandle, m_includeSubfolders);
+        }
+    }
+    catch (...)
+    {
+        CloseHandle(logDirHandle);
+        throw;
+    }
+
+    //
+    // Watch the directory before it's enumerated, so the changes made
+    // meanwhile aren't missed.
+    //
+    status = m_directoryWatcher->Start();
+    if (status != ERROR_SUCCESS)
+    {
+        logWriter.TraceError(
+            FORMAT_STRING(
+                L"Failed to monitor log directory changes. Log directory: %ws, Error: %d",
+                m_logDirectory.c_str(),
+                status
+            ).c_str()
+        );
+        return status;
+    }
+
+    //
+    // Now that the directory was open, we can obtain its long and short path.
+    //
+    m_logDirectory = Utility::GetLongPath(m_logDirectory);
+    m_shortLogDirectory = Utility::GetShortPath(m_logDirectory);
+
+    const ULONGLONG restoreStartTime = GetTickCount64();
+
+    LoadCheckpoints();
+
+    status = InitializeDirectoryChangeEventsQueue();
+
+    if (m_checkpointsRestored)
+    {
+        logWriter.TraceInfo(
+            FORMAT_STRING(
+                L"Log file monitor resumed %zu files of directory %ws from checkpoint file %ws in %llu ms.",
+                m_resumedFilesCount,
+                m_logDirectory.c_str(),
+                m_checkpointStore->GetFilePath().c_str(),
+                GetTickCount64() - restoreStartTime
+            ).c_str()
+        );
+    }
+
+    if (status != ERROR_SUCCESS)
+    {
+        //
+        // Failed to enumerate log files in a directory.
+        // Ignore the failure and continue. Some log file
+        // information will not be monitored.
+        //
+        logWriter.TraceError(
+            FORMAT_STRING(
+                L"Failed to open enumerate log directory. Directory: %ws Error=%d",
+                m_logDirectory.c_str(),
+                status
+            ).c_str()
+        );
+
+        status = ERROR_SUCCESS;
+    }
+
+    //
+    // Order stop event first so that stop is prioritized if both events are already signalled (changes
+    // are available but stop has been called).
+    //
+    HANDLE events[eventsCount] = {m_stopEvent, m_directoryWatcher->GetWaitObject(), m_pollTimer};
+
+    AcquireSRWLockExclusive(&m_eventQueueLock);
+    m_readerJobsStarted = true;
+    ReleaseSRWLockExclusive(&m_eventQueueLock);
+
+    PostReaderJob([this]() { return StartReaderJob(); });
+
+    //
+    // Wait for the directory changes. Meanwhile, post the jobs of the
+    // polling timer and of the checkpoint interval.
+    //
+    while (!stopWatching)
+    {
+        DWORD wait = WaitForMultipleObjects(eventsCount, events, FALSE, waitTimeout);
+        switch(wait)
+        {
+            case WAIT_OBJECT_0:
+            {
+                //
+                // Clear the event queue
+                //
+                AcquireSRWLockExclusive(&m_eventQueueLock);
+
+                m_directoryChangeEvents.Clear();
+
+                const DirChangeEventQueue::Statistics statistics = m_directoryChangeEvents.GetStatistics();
+
+                ReleaseSRWLockExclusive(&m_eventQueueLock);
+
+                logWriter.TraceInfo(
+                    FORMAT_STRING(
+                        L"Log file monitor change events of directory %ws: %llu received, %llu coalesced (%.1f%%),"
+                        L" maximum queue depth %zu, %llu overflows.",
+                        m_logDirectory.c_str(),
+                        statistics.Pushed,
+                        statistics.Coalesced,
+                        statistics.Pushed > 0 ? 100.0 * statistics.Coalesced / statistics.Pushed : 0.0,
+                        statistics.MaxDepth,
+                        statistics.Overflows
+                    ).c_str()
+                );
+
+                PostReaderJob([this]()
+                {
+                    SaveCheckpoints(true);
+                    TraceFileHandleStatistics();
+                    return (DWORD)ERROR_SUCCESS;
+                });
+
+                stopWatching = true;
+            }
+            break;
+
+            case WAIT_OBJECT_0 + 1:
+            {
+                status = DirectoryWatcherEventsHandler();
+                if (status != ERROR_SUCCESS)
+                {
+                    logWriter.TraceError(
+                        FORMAT_STRING(
+                            L"Failed to monitor log directory changes. Log directory: %ws, Error: %d",
+                            m_logDirectory.c_str(),
+                            status
+                        ).c_str()
+                    );
+                    stopWatching = true;
+                }
+            }
+            break;
+
+            case WAIT_OBJECT_0 + 2:
+            {
+                PostReaderJob([this]() { return PollTimerJob(); });
+            }
+            break;
+
+            case WAIT_TIMEOUT:
+            {
+                PostReaderJob([this]() { SaveCheckpoints(false); return (DWORD)ERROR_SUCCESS; });
+            }
+            break;
+
+            default:
+                status = GetLastError();
+                logWriter.TraceError(
+                    FORMAT_STRING(
+                        L"Failed to monitor log directory changes. Wait operation failed. Log directory: %ws, Error: %d",
+                        m_logDirectory.c_str(),
+                        status
+                    ).c_str()
+                );
+                stopWatching = true;
+        }
+    }
+
+    return status;
+}
+
+
+///
+/// Check if the filename matches a filter.
+///
+/// \param FileName         The filename to be evaluated.
+/// \param SearchPattern    The filter to evaluate with.
+///
+/// \return True if the file matches filter. Otherwise, false
+///
+inline BOOL
+LogFileMonitor::FileMatchesFilter(
+    _In_ LPCWSTR FileName,
+    _In_ LPCWSTR SearchPattern
+    )
+{
+    return PathMatchSpec(FileName, SearchPattern);
+}
+
+
+DWORD
+LogFileMonitor::InitializeMonitoredFilesInfo()
+{
+    DWORD status = ERROR_SUCCESS;
+
+    return status;
+}
+
+
+///
+/// Queues the events of the directory watcher.
+///
+/// \return ERROR_SUCCESS, or the error that stopped the watcher.
+///
+DWORD
+LogFileMonitor::DirectoryWatcherEventsHandler()
+{
+    DWORD status = m_directoryWatcher->ReadEvents(m_watcherEvents);
+
+    for (const auto& event : m_watcherEvents)
+    {
+        EnqueueDirChangeEvents(event);
+    }
+
+    m_watcherEvents.clear();
+
+    return status;
+}
+
+
+DWORD
+LogFileMonitor::InitializeDirectoryChangeEventsQueue()
+{
+    DWORD status = ERROR_SUCCESS;
+    std::vector<std::pair<std::wstring, FILE_ID_INFO> > logFiles;
+
+    //wprintf(L"InitializeDirectoryChangeEventsQueue\n");
+
+    status = GetFilesInDirectory(m_logDirectory, m_filter, logFiles, m_includeSubfolders);
+
+    if (status == ERROR_SUCCESS)
+    {
+        AcquireSRWLockExclusive(&m_eventQueueLock);
+
+        //
+        // Read log files from the start only when the tool is launched
+        // for the first time and the log files did not exist before.
+        // Subsequent attempts to enumerate the directory should set
+        // the file next read offset to the size of the file.
+        //
+        bool readLogFileFromStart = m_readLogFilesFromStart;
+
+        m_readLogFilesFromStart = false;
+
+        for (auto file : logFiles)
+        {
+            const std::wstring& fileName = file.first;
+            const FILE_ID_INFO& fileId = file.second;
+
+            const std::wstring longPath = fileName.substr(m_logDirectory.size() + 1);
+
+            auto element = GetLogFilesInformationIt(longPath);
+
+            if (element != m_logFilesInformation.end())
+            {
+                //
+                // Log file already exist. Do nothing.
+                //
+            }
+            else
+            {
+                auto logFileInfo = std::make_shared<LogFileInformation>();
+
+                const std::wstring shortPath = Utility::GetShortPath(fileName).substr(m_shortLogDirectory.size() + 1);
+
+                logFileInfo->FileName = longPath;
+                logFileInfo->NextReadOffset = 0;
+                logFileInfo->LastReadTimestamp = 0;
+                logFileInfo->EncodingType = LM_FILETYPE::FileTypeUnknown;
+                logFileInfo->FileId = fileId;
+                logFileInfo->ReadBuffer.SetMaxSize(m_maxReadBufferSize);
+
+                if (m_checkpointsRestored)
+                {
+                    //
+                    // A file without a valid checkpoint was created or replaced
+                    // while LogMonitor wasn't running. Read it from the start.
+                    //
+                    if (RestoreCheckpoint(fileName, *logFileInfo))
+                    {
+                        m_resumedFilesCount++;
+                    }
+                }
+                else if (!readLogFileFromStart)
+                {
+                    LARGE_INTEGER fileSize = {};
+
+                    HANDLE logFile = CreateFileW(fileName.c_str(),
+                                                  GENERIC_READ,
+                                                  FILE_SHARE_READ | FILE_SHARE_WRITE,
+                                                  nullptr,
+                                                  OPEN_EXISTING,
+                                                  FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+                                                  nullptr);
+                    if (logFile == INVALID_HANDLE_VALUE)
+                    {
+                        logWriter.TraceError(
+                            FORMAT_STRING(
+                                L"Error in log file monitor. Failed to open file %ws. Error = %d",
+                                fileName.c_str(),
+                                GetLastError()
+                            ).c_str()
+                        );
+
+                        //
+                        // Ignore failure and continue. In the worst case we will
+                        // read the entire log file.
+                        //
+                        continue;
+                    }
+
+                    if (!GetFileSizeEx (logFile, &fileSize))
+                    {
+                        logWriter.TraceError(
+                            FORMAT_STRING(
+                                L"Error in log file monitor. Failed to get size of file %ws. Error = %d",
+                                fileName.c_str(),
+                                GetLastError()
+                            ).c_str()
+                        );
+                    }
+                    else
+                    {
+                        logFileInfo->NextReadOffset = fileSize.QuadPart;
+                    }
+
+                    CloseHandle(logFile);
+                }
+
+                m_longPaths[shortPath] = longPath;
+                m_logFilesInformation[longPath] = std::move(logFileInfo);
+                m_fileIds[fileId] = longPath;
+            }
+
+            DirChangeNotificationEvent changeEvent;
+
+            changeEvent.Action = EventAction::Modify;
+            changeEvent.FileName = longPath;
+            changeEvent.Timestamp = GetTickCount64();
+
+            EnqueueDirChangeEvents(changeEvent, FALSE);
+        }
+
+        ReleaseSRWLockExclusive(&m_eventQueueLock);
+    }
+    else
+    {
+        logWriter.TraceError(
+            FORMAT_STRING(
+                L"Error in log file monitor. Failed to enumerate log directory %ws. Error=%d",
+                m_logDirectory.c_str(),
+                GetLastError()
+            ).c_str()
+        );
+    }
+
+    return status;
+}
+
+
+///
+/// Posts a job to the strand of the monitor, in the shared reader pool. The
+/// jobs of a monitor run one at a time, in order, so they don't need to
+/// lock the file tables.
+///
+/// \param Job          The job. A failure status is traced.
+///
+/// \return False if the monitor is stopping and the job was discarded.
+///
+bool
+LogFileMonitor::PostReaderJob(
+    _In_ std::function<DWORD()> Job
+    )
+{
+    return m_readerStrand.Post(
+        [this, Job]()
+        {
+            try
+            {
+                DWORD status = Job();
+                if (status != ERROR_SUCCESS)
+                {
+                    logWriter.TraceError(
+                        FORMAT_STRING(
+                            L"Failed to monitor log directory changes. Some log files in a directory %s may not be monitored. Error: %lu",
+                            m_logDirectory.c_str(),
+                            status
+                        ).c_str()
+                    );
+                }
+            }
+            catch (std::exception& ex)
+            {
+                logWriter.TraceError(
+                    FORMAT_STRING(
+                        L"Failed to monitor log directory changes. Some log files in a directory %s may not be monitored. %S",
+                        m_logDirectory.c_str(),
+                        ex.what()
+                    ).c_str()
+                );
+            }
+            catch (...)
+            {
+                logWriter.TraceError(
+                    FORMAT_STRING(
+                        L"Failed to monitor log directory changes. Some log files in a directory %s may not be monitored",
+                        m_logDirectory.c_str()
+                    ).c_str()
+                );
+            }
+        });
+}
+
+
+///
+/// First reader job, posted once the directory change notifications are
+/// registered. Enumerates the directory again, to catch the files created
+/// meanwhile, reads them, and starts the polling timer.
+///
+DWORD
+LogFileMonitor::StartReaderJob()
+{
+    DWORD status = InitializeDirectoryChangeEventsQueue();
+
+    if (status != ERROR_SUCCESS)
+    {
+        logWriter.TraceError(
+            FORMAT_STRING(
+                L"Failed to enumerate log directory %ws. Some log files may not be monitored for application logs",
+                m_logDirectory.c_str()
+            ).c_str()
+        );
+    }
+
+    if (!SetPollTimer(m_pollTimer, GetTickCount64() + POLL_INTERVAL_MIN_MILLIS))
+    {
+        status = GetLastError();
+
+        logWriter.TraceError(
+            FORMAT_STRING(
+                L"Failed to set timer object to monitor log file changes in directory %s. Error: %lu",
+                m_logDirectory.c_str(),
+                status
+            ).c_str()
+        );
+    }
+
+    DirChangeEventsJob();
+
+    return ERROR_SUCCESS;
+}
+
+
+///
+/// Processes the queued directory change events, then reads the files they
+/// marked as dirty. Posted when the queue stops being empty.
+///
+DWORD
+LogFileMonitor::DirChangeEventsJob()
+{
+    DWORD status = ERROR_SUCCESS;
+
+    //
+    // Take the whole batch, so the monitor thread doesn't wait for the
+    // lock while the events are processed. The batch vector is swapped
+    // with the queue storage, so both are reused.
+    //
+    AcquireSRWLockExclusive(&m_eventQueueLock);
+
+    m_directoryChangeEvents.PopAll(m_eventsBatch);
+
+    ReleaseSRWLockExclusive(&m_eventQueueLock);
+
+    for (auto& event : m_eventsBatch)
+    {
+        //
+        // Try to recover the long path. The worst case is when it's already
+        // a long path, and it will make a useless variable reassign.
+        //
+        auto it = m_longPaths.find(event.FileName);
+
+        if (it != m_longPaths.end())
+        {
+            event.FileName = it->second;
+        }
+
+        switch (event.Action)
+        {
+            case EventAction::Add:
+            {
+                status = LogFileAddEventHandler(event);
+                break;
+            }
+
+            case EventAction::Modify:
+            {
+                status = LogFileModifyEventHandler(event);
+                break;
+            }
+
+            case EventAction::Remove:
+            {
+                status = LogFileRemoveEventHandler(event);
+                break;
+            }
+
+            case EventAction::RenameOld:
+            {
+                //
+                // Nothing to do
+                //
+                break;
+            }
+
+            case EventAction::RenameNew:
+            {
+                status = LogFileRenameNewEventHandler(event);
+                break;
+            }
+
+            case EventAction::ReInit:
+            {
+                status = LogFileReInitEventHandler(event);
+                break;
+            }
+
+            default:
+                break;
+        }
+    }
+
+    m_eventsBatch.clear();
+
+    //
+    // The files just read will be polled again after the minimum
+    // interval. Only move the timer if that's earlier than it's due.
+    //
+    const ULONGLONG nextPollTimestamp = ReadDirtyLogFiles();
+
+    if (nextPollTimestamp < m_pollTimerDueTimestamp
+        && !SetPollTimer(m_pollTimer, nextPollTimestamp))
+    {
+        status = GetLastError();
+
+        logWriter.TraceError(
+            FORMAT_STRING(
+                L"Failed to set timer object to monitor log file changes in directory %s. Error: %lu",
+                m_logDirectory.c_str(),
+                status
+            ).c_str()
+        );
+    }
+
+    SaveCheckpoints(false);
+
+    //
+    // Failures of the event handlers were already traced.
+    //
+    return ERROR_SUCCESS;
+}
+
+
+///
+/// Probes the files whose poll interval elapsed, and reads the ones that
+/// changed without a notification. Posted when the polling timer expires.
+///
+DWORD
+LogFileMonitor::PollTimerJob()
+{
+    DWORD status = ERROR_SUCCESS;
+
+    const ULONGLONG nextPollTimestamp = PollLogFiles(false);
+
+    ReadDirtyLogFiles();
+
+    if (!SetPollTimer(m_pollTimer, nextPollTimestamp))
+    {
+        status = GetLastError();
+
+        logWriter.TraceError(
+            FORMAT_STRING(
+                L"Failed to set timer object to monitor log file changes in directory %s. Error: %lu",
+                m_logDirectory.c_str(),
+                status
+            ).c_str()
+        );
+    }
+
+    SaveCheckpoints(false);
+
+    return ERROR_SUCCESS;
+}
+
+
+DWORD
+LogFileMonitor::LogFileAddEventHandler(
+    _In_ DirChangeNotificationEvent& Event
+    )
+{
+    DWORD status = ERROR_SUCCESS;
+
+    auto element = GetLogFilesInformationIt(Event.FileName);
+
+    if (element != m_logFilesInformation.end())
+    {
+        //
+        // A file was created at the path of a log file without a remove
+        // event, it may replace it. Its handle is checked before the read.
+        //
+        element->second->VerifyHandle = true;
+        MarkLogFileDirty(element->second);
+    }
+    else
+    {
+        const std::wstring fullLongPath = Utility::GetLongPath(m_logDirectory + L'\\' + Event.FileName);
+
+        DWORD ftyp = GetFileAttributesW(fullLongPath.c_str());
+        if (ftyp == INVALID_FILE_ATTRIBUTES)
+        {
+            status = GetLastError();
+            logWriter.TraceError(
+                FORMAT_STRING(
+                    L"Error in log file monitor. Failed to query attributes of File: %ws. Error: %d",
+                    fullLongPath.c_str(),
+                    status
+                ).c_str()
+            );
+
+            return status;
+        }
+
+        if (!(ftyp & FILE_ATTRIBUTE_DIRECTORY))
+        {
+            auto logFileInfo = std::make_shared<LogFileInformation>();
+
+            //
+            // Get the short and long relative path
+            //
+            const std::wstring longPath = fullLongPath.substr(m_logDirectory.size() + 1);
+
+            const std::wstring shortPath = Utility::GetShortPath(fullLongPath).substr(m_shortLogDirectory.size() + 1);
+
+            logFileInfo->FileName = longPath;
+            logFileInfo->NextReadOffset = 0;
+            logFileInfo->LastReadTimestamp = 0;
+            logFileInfo->EncodingType = LM_FILETYPE::FileTypeUnknown;
+            logFileInfo->ReadBuffer.SetMaxSize(m_maxReadBufferSize);
+
+            FILE_ID_INFO fileId{ 0 };
+            status = GetFileId(fullLongPath, fileId);
+
+            if (status != ERROR_SUCCESS)
+            {
+                status = GetLastError();
+                logWriter.TraceError(
+                    FORMAT_STRING(
+                        L"Error in log file monitor. Failed to query file ID. File: %ws. Error: %d",
+                        fullLongPath.c_str(),
+                        status
+                    ).c_str()
+                );
+            }
+
+            logFileInfo->FileId = fileId;
+
+            status = ReadLogFile(logFileInfo);
+
+            m_fileIds[fileId] = longPath;
+            m_longPaths[shortPath] = longPath;
+            m_logFilesInformation[longPath] = std::move(logFileInfo);
+        }
+    }
+
+    return status;
+}
+
+
+DWORD
+LogFileMonitor::LogFileRemoveEventHandler(
+    _In_ DirChangeNotificationEvent& Event
+    )
+{
+    DWORD status = ERROR_SUCCESS;
+
+    auto element = GetLogFilesInformationIt(Event.FileName);
+
+    if (element != m_logFilesInformation.end())
+    {
+        std::wstring longPath = element->second->FileName;
+
+        //
+        // Close the cached handle, the file could be delete-pending
+        // until it's closed.
+        //
+        m_fileHandles.Remove(element->second->FileId);
+
+        //
+        // Drop the file from the dirty set.
+        //
+        element->second->IsDirty = false;
+
+        const FILE_ID_INFO fileId = element->second->FileId;
+
+        m_logFilesInformation.erase(element);
+        m_checkpointDirty = true;
+
+        //
+        // Try first the key of the event, it's the short path, or it's the
+        // long path and both are the same.
+        //
+        auto longPathIterator = m_longPaths.find(Event.FileName);
+
+        if (longPathIterator == m_longPaths.end()
+            || _wcsicmp(longPathIterator->second.c_str(), longPath.c_str()) != 0)
+        {
+            longPathIterator =
+                std::find_if(
+                    m_longPaths.begin(),
+                    m_longPaths.end(),
+                    [&longPath](const auto& it) { return _wcsicmp(it.second.c_str(), longPath.c_str()) == 0; });
+        }
+
+        if (longPathIterator != m_longPaths.end())
+        {
+            m_longPaths.erase(longPathIterator);
+        }
+
+        //
+        // The file ID index is normally keyed by the ID of the file. Look for
+        // the path only if the file was replaced since it was added.
+        //
+        auto fileIdIterator = m_fileIds.find(fileId);
+
+        if (fileIdIterator == m_fileIds.end()
+            || _wcsicmp(fileIdIterator->second.c_str(), longPath.c_str()) != 0)
+        {
+            fileIdIterator =
+                std::find_if(
+                    m_fileIds.begin(),
+                    m_fileIds.end(),
+                    [&longPath](const auto& it) { return _wcsicmp(it.second.c_str(), longPath.c_str()) == 0; });
+        }
+
+        if (fileIdIterator != m_fileIds.end())
+        {
+            m_fileIds.erase(fileIdIterator);
+        }
+    }
+    else
+    {
+        //
+        // Log file not found.
+        //
+    }
+
+    return status;
+}
+
+
+DWORD
+LogFileMonitor::LogFileModifyEventHandler(
+    _In_ DirChangeNotificationEvent& Event
+    )
+{
+    DWORD status = ERROR_SUCCESS;
+
+    auto element = GetLogFilesInformationIt(Event.FileName);
+
+    if (element != m_logFilesInformation.end() &&
+        Event.Timestamp > element->second->LastReadTimestamp)
+    {
+        MarkLogFileDirty(element->second);
+    }
+    else
+    {
+        //
+        // Log file not found or event is too old.
+        //
+    }
+
+    return status;
+}
+
+DWORD
+LogFileMonitor::LogFileRenameNewEventHandler(
+    _In_ DirChangeNotificationEvent& Event
+    )
+{
+    DWORD status = ERROR_SUCCESS;
+
+    const std::wstring fullLongPath = Utility::GetLongPath(m_logDirectory + L'\\' + Event.FileName);
+    const std::wstring longPath = fullLongPath.substr(m_logDirectory.size() + 1);
+
+    DWORD ftyp = GetFileAttributesW(fullLongPath.c_str());
+    if (ftyp == INVALID_FILE_ATTRIBUTES)
+    {
+        status = GetLastError();
+        logWriter.TraceError(
+            FORMAT_STRING(
+                L"Error in log file monitor. Failed to query file attributes. File: %ws. Error: %d",
+                fullLongPath.c_str(),
+                status
+            ).c_str()
+        );
+
+        return status;
+    }
+
+    if (ftyp & FILE_ATTRIBUTE_DIRECTORY)
+    {
+        if (m_includeSubfolders)
+        {
+            std::vector<std::pair<std::wstring, FILE_ID_INFO>> logFiles;
+
+            GetFilesInDirectory(fullLongPath, m_filter, logFiles, m_includeSubfolders);
+
+            for (auto file : logFiles)
+            {
+                const std::wstring& fileName = file.first;
+                const FILE_ID_INFO& fileId = file.second;
+
+                auto itFileId = m_fileIds.find(fileId);
+
+                if (itFileId != m_fileIds.end())
+                {
+                    RenameFileInMaps(fileName, itFileId->second, fileId);
+                }
+            }
+        }
+    }
+    else
+    {
+        FILE_ID_INFO fileId{ 0 };
+        GetFileId(fullLongPath, fileId);
+
+        auto it = m_fileIds.find(fileId);
+
+        if (it != m_fileIds.end())
+        {
+            if (FileMatchesFilter(fullLongPath.c_str(), m_filter.c_str()))
+            {
+                RenameFileInMaps(fullLongPath, it->second, fileId);
+            }
+            else
+            {
+                DirChangeNotificationEvent e = Event;
+
+                e.FileName = it->second;
+                e.Action = EventAction::Remove;
+
+                LogFileRemoveEventHandler(e);
+            }
+        }
+        else if (FileMatchesFilter(fullLongPath.c_str(), m_filter.c_str()))
+        {
+            DirChangeNotificationEvent e = Event;
+
+            e.FileName = longPath;
+            e.Action = EventAction::Add;
+
+            LogFileAddEventHandler(e);
+        }
+    }
+
+    return status;
+}
+
+///
+/// This functions replace all the occurrence of the OldName in the maps
+/// with the new name, based on a FileId. If it doesn't find the old
+/// elements in the maps, creates new ones.
+///
+/// \param NewFullName      The new full filename.
+/// \param OldName          The old relative filename.
+/// \param FileId           FileId of the file.
+///
+void
+LogFileMonitor::RenameFileInMaps(
+    _In_ const std::wstring& NewFullName,
+    _In_ const std::wstring& OldName,
+    _In_ const FILE_ID_INFO& FileId
+    )
+{
+    const std::wstring longPath = NewFullName.substr(m_logDirectory.size() + 1);
+    const std::wstring shortPath = Utility::GetShortPath(NewFullName).substr(m_shortLogDirectory.size() + 1);
+
+    auto it = GetLogFilesInformationIt(OldName);
+
+    shared_ptr<LogFileInformation> fileInfo;
+    if (it != m_logFilesInformation.end())
+    {
+        fileInfo = it->second;
+        fileInfo->FileName = longPath;
+        m_logFilesInformation.erase(it);
+    }
+    else
+    {
+        fileInfo = std::make_shared<LogFileInformation>();
+        fileInfo->FileName = longPath;
+        fileInfo->EncodingType = LM_FILETYPE::FileTypeUnknown;
+        fileInfo->LastReadTimestamp = 0;
+        fileInfo->NextReadOffset = 0;
+        fileInfo->FileId = FileId;
+        fileInfo->ReadBuffer.SetMaxSize(m_maxReadBufferSize);
+
+        MarkLogFileDirty(fileInfo);
+    }
+
+    //
+    // Try first the case when the long and short path are the same.
+    //
+    auto longPathIterator = m_longPaths.find(OldName);
+    if (longPathIterator == m_longPaths.end())
+    {
+        //
+        // Look for the map element with value equal to long path.
+        //
+        longPathIterator =
+            std::find_if(
+                m_longPaths.begin(),
+                m_longPaths.end(),
+                [&OldName](const auto& it) {
+                    return _wcsicmp(it.second.c_str(), OldName.c_str()) == 0;
+                }
+            );
+    }
+
+    if (longPathIterator != m_longPaths.end())
+    {
+        m_longPaths.erase(longPathIterator);
+    }
+
+    m_logFilesInformation[longPath] = fileInfo;
+    m_longPaths[shortPath] = longPath;
+    m_fileIds[FileId] = longPath;
+}
+
+
+DWORD
+LogFileMonitor::LogFileReInitEventHandler(
+    _In_ DirChangeNotificationEvent& Event
+    )
+{
+    DWORD status = ERROR_SUCCESS;
+    std::vector<std::pair<std::wstring, FILE_ID_INFO>> logFiles;
+
+    status = GetFilesInDirectory(m_logDirectory, m_filter, logFiles, m_includeSubfolders);
+
+    if (status == ERROR_SUCCESS)
+    {
+        for (auto file : logFiles)
+        {
+            const std::wstring& fileName = file.first;
+            const FILE_ID_INFO& fileId = file.second;
+
+            const std::wstring longPath = fileName.substr(m_logDirectory.size() + 1);
+
+            auto element = GetLogFilesInformationIt(longPath);
+
+            if (element != m_logFilesInformation.end())
+            {
+                //
+                // The file may have been replaced while the events were lost.
+                //
+                if (!file_id_equal()(element->second->FileId, fileId))
+                {
+                    element->second->VerifyHandle = true;
+                    MarkLogFileDirty(element->second);
+                }
+            }
+            else
+            {
+                auto logFileInfo = std::make_shared<LogFileInformation>();
+
+                const std::wstring shortPath = Utility::GetShortPath(fileName).substr(m_shortLogDirectory.size() + 1);
+
+                logFileInfo->FileName = longPath;
+                logFileInfo->NextReadOffset = 0;
+                logFileInfo->LastReadTimestamp = 0;
+                logFileInfo->EncodingType = LM_FILETYPE::FileTypeUnknown;
+                logFileInfo->FileId = fileId;
+                logFileInfo->ReadBuffer.SetMaxSize(m_maxReadBufferSize);
+
+                MarkLogFileDirty(logFileInfo);
+
+                m_longPaths[shortPath] = longPath;
+                m_logFilesInformation[longPath] = std::move(logFileInfo);
+                m_fileIds[fileId] = longPath;
+            }
+        }
+    }
+    else
+    {
+        logWriter.TraceError(
+            FORMAT_STRING(
+                L"Error in log file monitor. Failed to enumerate log directory %ws. Error: %d",
+                m_logDirectory.c_str(),
+                GetLastError()
+            ).c_str()
+        );
+    }
+
+    //
+    // Change notifications were lost, probe every file. The ones that
+    // changed are read with the rest of the dirty set.
+    //
+    PollLogFiles(true);
+
+    return status;
+}
+
+
+DWORD
+LogFileMonitor::ReadLogFile(
+    _Inout_ std::shared_ptr<LogFileInformation> LogFileInfo
+    )
+{
+    DWORD status = ERROR_SUCCESS;
+    OVERLAPPED overlapped = { 0, 0, 0, 0, nullptr };
+    BYTE bom[3 * sizeof(char)] = { 0, 0, 0 }; // Bom could be up to 3 bytes size in UTF8.
+    bool wasBomRead = false;
+
+    const std::wstring fullLongPath = m_logDirectory + L'\\' + LogFileInfo->FileName;
+
+    bool isCachedHandle = false;
+    bool evictHandle = false;
+
+    HANDLE logFile = AcquireLogFileHandle(LogFileInfo, isCachedHandle);
+    if (logFile == INVALID_HANDLE_VALUE)
+    {
+        status = GetLastError();
+        if (status == ERROR_FILE_NOT_FOUND || status == ERROR_PATH_NOT_FOUND)
+        {
+            //
+            // This errors should not trace anything.
+            //
+            status = ERROR_SUCCESS;
+        }
+        else
+        {
+            logWriter.TraceError(
+                FORMAT_STRING(
+                    L"Error in log file monitor. Failed to open file %ws. Error: %d",
+                    fullLongPath.c_str(),
+                    status
+                ).c_str()
+            );
+        }
+        return status;
+    }
+
+    //
+    // If the beginning of the file hasn't been read yet, don't get the BOM.
+    // Also, if EncodingType is already known, skip this.
+    //
+    if (LogFileInfo->NextReadOffset >= 3 && LogFileInfo->EncodingType == LM_FILETYPE::FileTypeUnknown)
+    {
+        DWORD bytesRead = 0;
+        overlapped.Offset = 0;
+        overlapped.OffsetHigh = 0;
+
+        if (!::ReadFile(
+                logFile,
+                &bom,
+                sizeof(bom),
+                &bytesRead,
+                &overlapped)
+            || bytesRead < (sizeof(bom) - 1)) // UTF16 BOM could be only 2 bytes
+        {
+            //
+            // It wasn't possible to read the BOM or it was smaller than expected.
+            //
+            wasBomRead = false;
+        }
+        else
+        {
+            wasBomRead = true;
+        }
+    }
+
+    AdaptiveReadBuffer& readBuffer = LogFileInfo->ReadBuffer;
+    DWORD bytesRead = 0;
+
+    const LogLineDecoder::LineCallback writeLine =
+        [this, &LogFileInfo](_In_reads_(Length) const char* Line, _In_ size_t Length)
+        {
+            WriteToConsole(Line, Length, LogFileInfo->FileName);
+        };
+
+    const UINT64 startOffset = LogFileInfo->NextReadOffset;
+
+    readBuffer.BeginReadPass();
+
+    //
+    // It's important to catch a possible error inside the loop, to at least print
+    // the incomplete line kept by the decoder, if it has any.
+    //
+    try
+    {
+        //
+        // A large backlog, like a big file found when the monitor starts, is
+        // read through a file mapping. Once it catches up, the loop below
+        // reads whatever was appended meanwhile.
+        //
+        LARGE_INTEGER fileSize = {};
+
+        if (GetFileSizeEx(logFile, &fileSize)
+            && static_cast<UINT64>(fileSize.QuadPart) > LogFileInfo->NextReadOffset
+            && static_cast<UINT64>(fileSize.QuadPart) - LogFileInfo->NextReadOffset >= BACKLOG_MAPPING_MIN_BYTES)
+        {
+            const UINT64 backlogStartOffset = LogFileInfo->NextReadOffset;
+            const ULONGLONG backlogStartTime = GetTickCount64();
+
+            DWORD mappingStatus = ReadMappedLogFile(
+                LogFileInfo,
+                logFile,
+                static_cast<UINT64>(fileSize.QuadPart),
+                wasBomRead ? bom : nullptr,
+                sizeof(bom),
+                writeLine
+            );
+
+            if (mappingStatus == ERROR_SUCCESS)
+            {
+                logWriter.TraceInfo(
+                    FORMAT_STRING(
+                        L"Log file monitor read a backlog of %llu bytes from file %ws in %llu ms.",
+                        LogFileInfo->NextReadOffset - backlogStartOffset,
+                        LogFileInfo->FileName.c_str(),
+                        GetTickCount64() - backlogStartTime
+                    ).c_str()
+                );
+            }
+            else
+            {
+                logWriter.TraceWarning(
+                    FORMAT_STRING(
+                        L"Log file monitor failed to map file %ws, reading it sequentially. Error: %lu",
+                        LogFileInfo->FileName.c_str(),
+                        mappingStatus
+                    ).c_str()
+                );
+            }
+        }
+
+        do
+        {
+            BYTE* logFileContents = readBuffer.Data();
+            bytesRead = 0;
+
+            overlapped.Offset = UINT(LogFileInfo->NextReadOffset & 0xFFFFFFFF);
+            overlapped.OffsetHigh = UINT(LogFileInfo->NextReadOffset >> 32);
+
+            LogFileInfo->LastReadTimestamp = GetTickCount64();
+
+            if (!::ReadFile(
+                logFile,
+                logFileContents,
+                readBuffer.Size(),
+                &bytesRead,
+                &overlapped))
+            {
+                status = GetLastError();
+                if (status == ERROR_HANDLE_EOF)
+                {
+                    bytesRead = 0;
+                    status = ERROR_SUCCESS;
+                }
+                else
+                {
+                    logWriter.TraceError(
+                        FORMAT_STRING(
+                            L"Error in log file monitor. File read error. File: %ws. Error: %d",
+                            LogFileInfo->FileName.c_str(),
+                            GetLastError()
+                        ).c_str()
+                    );
+
+                    LogFileInfo->LastReadTimestamp = 0;
+
+                    //
+                    // Don't keep a handle that failed.
+                    //
+                    evictHandle = true;
+                }
+                break;
+            }
+
+            if (bytesRead > 0)
+            {
+                DecodeLogFileContent(
+                    LogFileInfo,
+                    logFileContents,
+                    bytesRead,
+                    wasBomRead ? bom : nullptr,
+                    sizeof(bom),
+                    writeLine
+                );
+            }
+
+            LogFileInfo->NextReadOffset += bytesRead;
+
+            //
+            // Grows the buffer for the next read if this one filled it.
+            //
+            readBuffer.RecordRead(bytesRead);
+        } while (bytesRead > 0);
+    }
+    catch (...) {}
+
+    readBuffer.EndReadPass();
+
+    //
+    // If we reach EOF, print the last line.
+    //
+    LogFileInfo->Decoder.Flush(writeLine);
+
+    ReleaseLogFileHandle(LogFileInfo, logFile, isCachedHandle, evictHandle);
+
+    if (LogFileInfo->NextReadOffset != startOffset)
+    {
+        m_checkpointDirty = true;
+    }
+
+    return status;
+}
+
+///
+/// Detects the encoding of a log file if it's still unknown, and decodes a
+/// chunk of its content, skipping the BOM if the chunk contains it.
+///
+/// \param LogFileInfo     The file the content belongs to. NextReadOffset must
+///                         be the offset of the chunk.
+/// \param Content         The chunk of the file.
+/// \param ContentSize     Size of the chunk in bytes.
+/// \param Bom             The first bytes of the file, if the chunk doesn't
+///                         start at the beginning of the file. Otherwise, nullptr.
+/// \param BomSize         Size of Bom in bytes.
+/// \param OnLine          Callback invoked with each complete line.
+///
+void
+LogFileMonitor::DecodeLogFileContent(
+    _In_ const std::shared_ptr<LogFileInformation>& LogFileInfo,
+    _In_reads_bytes_(ContentSize) LPBYTE Content,
+    _In_ UINT ContentSize,
+    _In_reads_bytes_opt_(BomSize) LPBYTE Bom,
+    _In_ UINT BomSize,
+    _In_ const LogLineDecoder::LineCallback& OnLine
+    )
+{
+    //
+    // Get file type if it's still unknown
+    //
+    UINT foundBomSize = 0;
+    if (LogFileInfo->EncodingType == LM_FILETYPE::FileTypeUnknown)
+    {
+        if (Bom != nullptr)
+        {
+            LogFileInfo->EncodingType = this->FileTypeFromBuffer(
+                Content,
+                ContentSize,
+                Bom,
+                BomSize,
+                foundBomSize
+            );
+        }
+        else
+        {
+            LogFileInfo->EncodingType = this->FileTypeFromBuffer(
+                Content,
+                ContentSize,
+                Content,
+                ContentSize,
+                foundBomSize
+            );
+        }
+    }
+
+    //
+    // Check if we need to skip only some bytes, instead of the whole BOM
+    //
+    if (foundBomSize > LogFileInfo->NextReadOffset)
+    {
+        foundBomSize = (UINT)(foundBomSize - LogFileInfo->NextReadOffset);
+    }
+    else
+    {
+        //
+        // It means that the BOM is not in the read content
+        //
+        foundBomSize = 0;
+    }
+
+    //
+    // Decode the read bytes, skipping the BOM if necessary, and write
+    // each complete line to the LogWriter, which writes them in batches to
+    // stdout and to the log file. Characters and lines split between two
+    // reads are kept by the decoder.
+    //
+    LogFileInfo->Decoder.SetEncoding(LogFileInfo->EncodingType);
+    LogFileInfo->Decoder.Decode(
+        Content + foundBomSize,
+        ContentSize - foundBomSize,
+        OnLine
+    );
+}
+
+///
+/// Reads the content of a log file up to EndOffset by mapping it into
+/// memory, one window at a time. The lines are decoded straight from the
+/// mapped view, so the large backlog is read without a ReadFile call or a
+/// copy per chunk.
+///
+/// A mapping of the file prevents the writer from truncating it, so each
+/// window is mapped and unmapped on its own, and nothing is mapped between
+/// two windows.
+///
+/// \param LogFileInfo     The file to read. NextReadOffset is advanced
+///                         after each window.
+/// \param LogFile         Read handle of the file.
+/// \param EndOffset       Offset where the read stops. Must not be greater
+///                         than the file size.
+/// \param Bom             The first bytes of the file, or nullptr.
+/// \param BomSize         Size of Bom in bytes.
+/// \param OnLine          Callback invoked with each complete line.
+///
+/// \return ERROR_SUCCESS, or the error that stopped the read. In that case,
+///     NextReadOffset is the offset of the first byte that wasn't decoded,
+///     and the decoder still has the partial line before it, so a sequential
+///     read resumes there without losing or repeating lines.
+///
+DWORD
+LogFileMonitor::ReadMappedLogFile(
+    _In_ const std::shared_ptr<LogFileInformation>& LogFileInfo,
+    _In_ HANDLE LogFile,
+    _In_ UINT64 EndOffset,
+    _In_reads_bytes_opt_(BomSize) LPBYTE Bom,
+    _In_ UINT BomSize,
+    _In_ const LogLineDecoder::LineCallback& OnLine
+    )
+{
+    DWORD status = ERROR_SUCCESS;
+
+    SYSTEM_INFO systemInfo;
+    GetSystemInfo(&systemInfo);
+
+    const UINT64 granularity = systemInfo.dwAllocationGranularity;
+
+    while (LogFileInfo->NextReadOffset < EndOffset)
+    {
+        //
+        // Views must start at a multiple of the allocation granularity.
+        //
+        const UINT64 viewOffset = LogFileInfo->NextReadOffset - (LogFileInfo->NextReadOffset % granularity);
+        const UINT64 remainingSize = EndOffset - viewOffset;
+        const SIZE_T viewSize = static_cast<SIZE_T>(
+            remainingSize < BACKLOG_MAPPING_WINDOW_BYTES ? remainingSize : BACKLOG_MAPPING_WINDOW_BYTES);
+        const UINT64 viewEndOffset = viewOffset + viewSize;
+
+        HANDLE mapping = CreateFileMappingW(
+            LogFile,
+            nullptr,
+            PAGE_READONLY,
+            static_cast<DWORD>(viewEndOffset >> 32),
+            static_cast<DWORD>(viewEndOffset & 0xFFFFFFFF),
+            nullptr);
+        if (mapping == NULL)
+        {
+            status = GetLastError();
+            break;
+        }
+
+        LPBYTE view = static_cast<LPBYTE>(MapViewOfFile(
+            mapping,
+            FILE_MAP_READ,
+            static_cast<DWORD>(viewOffset >> 32),
+            static_cast<DWORD>(viewOffset & 0xFFFFFFFF),
+            viewSize));
+        if (view == nullptr)
+        {
+            status = GetLastError();
+            CloseHandle(mapping);
+            break;
+        }
+
+        LogFileInfo->LastReadTimestamp = GetTickCount64();
+
+        while (LogFileInfo->NextReadOffset < viewEndOffset)
+        {
+            const UINT64 remainingViewSize = viewEndOffset - LogFileInfo->NextReadOffset;
+            const UINT sliceSize = static_cast<UINT>(
+                remainingViewSize < BACKLOG_MAPPING_SLICE_BYTES ? remainingViewSize : BACKLOG_MAPPING_SLICE_BYTES);
+
+            if (!DecodeMappedContent(
+                LogFileInfo,
+                view + (LogFileInfo->NextReadOffset - viewOffset),
+                sliceSize,
+                Bom,
+                BomSize,
+                OnLine))
+            {
+                status = ERROR_READ_FAULT;
+                break;
+            }
+
+            LogFileInfo->NextReadOffset += sliceSize;
+        }
+
+        UnmapViewOfFile(view);
+        CloseHandle(mapping);
+
+        if (status != ERROR_SUCCESS)
+        {
+            break;
+        }
+    }
+
+    return status;
+}
+
+///
+/// Decodes a slice of a mapped view. An I/O error while paging in the
+/// view, for example on a network share, raises EXCEPTION_IN_PAGE_ERROR.
+/// It's handled here, where the frame has no C++ objects to unwind.
+///
+/// The pages of the slice are touched before it's decoded, so the error is
+/// raised before any line of the slice is written, and the sequential read
+/// that follows doesn't write a line twice.
+///
+/// \return False if the content couldn't be read.
+///
+bool
+LogFileMonitor::DecodeMappedContent(
+    _In_ const std::shared_ptr<LogFileInformation>& LogFileInfo,
+    _In_reads_bytes_(Size) LPBYTE View,
+    _In_ UINT Size,
+    _In_reads_bytes_opt_(BomSize) LPBYTE Bom,
+    _In_ UINT BomSize,
+    _In_ const LogLineDecoder::LineCallback& OnLine
+    )
+{
+    __try
+    {
+        volatile BYTE pageByte = 0;
+
+        for (UINT offset = 0; offset < Size; offset += BACKLOG_MAPPING_PAGE_BYTES)
+        {
+            pageByte = View[offset];
+        }
+
+        pageByte = View[Size - 1];
+
+        DecodeLogFileContent(
+            LogFileInfo,
+            View,
+            Size,
+            Bom,
+            BomSize,
+            OnLine
+        );
+
+        return true;
+    }
+    __except (GetExceptionCode() == EXCEPTION_IN_PAGE_ERROR ? EXCEPTION_EXECUTE_HANDLER : EXCEPTION_CONTINUE_SEARCH)
+    {
+        return false;
+    }
+}
+
+///
+/// Gets a read handle for a log file, from the handle cache if the file was
+/// read recently. Otherwise, opens the file and adds its handle to the cache.
+///
+/// The files are opened with FILE_SHARE_DELETE, so the handles kept in the
+/// cache don't block the applications that delete or rename their log files.
+///
+/// After a change event, the cached handle is used only if it's still the
+/// handle of the file at the path. A file opened with a new identity
+/// replaced the previous one, and it's read from the start.
+///
+/// \param LogFileInfo     The file to open. Its FileId is updated with the
+///                         identity of the opened file.
+/// \param IsCached        Returns true if the handle is owned by the cache.
+///
+/// \return The handle, or INVALID_HANDLE_VALUE if the file can't be opened.
+///     In that case GetLastError returns the error.
+///
+HANDLE
+LogFileMonitor::AcquireLogFileHandle(
+    _Inout_ const std::shared_ptr<LogFileInformation>& LogFileInfo,
+    _Out_ bool& IsCached
+    )
+{
+    IsCached = false;
+
+    const std::wstring fullLongPath = m_logDirectory + L'\\' + LogFileInfo->FileName;
+
+    HANDLE* cachedHandle = m_fileHandles.Find(LogFileInfo->FileId);
+    if (cachedHandle != nullptr)
+    {
+        if (!LogFileInfo->VerifyHandle || IsFileAtPath(fullLongPath, LogFileInfo->FileId))
+        {
+            LogFileInfo->VerifyHandle = false;
+            IsCached = true;
+            return *cachedHandle;
+        }
+
+        m_fileHandles.Remove(LogFileInfo->FileId);
+    }
+
+    LogFileInfo->VerifyHandle = false;
+
+    HANDLE logFile = CreateFileW(fullLongPath.c_str(),
+                                  GENERIC_READ,
+                                  FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                                  nullptr,
+                                  OPEN_EXISTING,
+                                  FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+                                  nullptr);
+    if (logFile == INVALID_HANDLE_VALUE)
+    {
+        return INVALID_HANDLE_VALUE;
+    }
+
+    FILE_ID_INFO fileId{ 0 };
+
+    if (::GetFileInformationByHandleEx(logFile, FileIdInfo, &fileId, sizeof(fileId)))
+    {
+        if (!file_id_equal()(LogFileInfo->FileId, fileId))
+        {
+            ResetReplacedLogFile(*LogFileInfo, fileId);
+        }
+
+        m_fileHandles.Insert(fileId, logFile);
+        IsCached = true;
+    }
+
+    return logFile;
+}
+
+///
+/// Checks whether the file at a path is the one with the given identity.
+///
+/// \param FullLongPath    The path of the file.
+/// \param FileId          The identity of the file.
+///
+/// \return False if the file at the path is another file, or it can't be
+///     opened, like a deleted file.
+///
+bool
+LogFileMonitor::IsFileAtPath(
+    _In_ const std::wstring& FullLongPath,
+    _In_ const FILE_ID_INFO& FileId
+    )
+{
+    HANDLE file = CreateFileW(FullLongPath.c_str(),
+                              FILE_READ_ATTRIBUTES,
+                              FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                              nullptr,
+                              OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL,
+                              nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+
+    FILE_ID_INFO fileId{ 0 };
+
+    const bool isSameFile = ::GetFileInformationByHandleEx(file, FileIdInfo, &fileId, sizeof(fileId))
+        && file_id_equal()(fileId, FileId);
+
+    CloseHandle(file);
+
+    return isSameFile;
+}
+
+///
+/// Updates the identity of a log file. If the file had another identity,
+/// it was replaced at the same path, and the new file is read from the
+/// start.
+///
+/// \param LogFileInfo     The file.
+/// \param FileId          The identity of the file at its path.
+///
+void
+LogFileMonitor::ResetReplacedLogFile(
+    _Inout_ LogFileInformation& LogFileInfo,
+    _In_ const FILE_ID_INFO& FileId
+    )
+{
+    const FILE_ID_INFO emptyFileId{ 0 };
+
+    if (!file_id_equal()(LogFileInfo.FileId, emptyFileId))
+    {
+        auto fileIdIterator = m_fileIds.find(LogFileInfo.FileId);
+
+        if (fileIdIterator != m_fileIds.end()
+            && _wcsicmp(fileIdIterator->second.c_str(), LogFileInfo.FileName.c_str()) == 0)
+        {
+            m_fileIds.erase(fileIdIterator);
+        }
+
+        LogFileInfo.NextReadOffset = 0;
+        LogFileInfo.EncodingType = LM_FILETYPE::FileTypeUnknown;
+        LogFileInfo.FingerprintSize = 0;
+        LogFileInfo.Fingerprint = 0;
+
+        m_checkpointDirty = true;
+
+        logWriter.TraceInfo(
+            FORMAT_STRING(
+                L"Log file monitor found a new file at the path of file %ws, reading it from the start.",
+                LogFileInfo.FileName.c_str()
+            ).c_str()
+        );
+    }
+
+    LogFileInfo.FileId = FileId;
+    m_fileIds[FileId] = LogFileInfo.FileName;
+}
+
+///
+/// Adds a file to the dirty set, if it isn't already there.
+///
+/// \param LogFileInfo     The file to read.
+///
+void
+LogFileMonitor::MarkLogFileDirty(
+    _In_ const std::shared_ptr<LogFileInformation>& LogFileInfo
+    )
+{
+    if (!LogFileInfo->IsDirty)
+    {
+        LogFileInfo->IsDirty = true;
+        m_dirtyFiles.push_back(LogFileInfo);
+    }
+}
+
+///
+/// Reads the files in the dirty set, and empties it. Files removed since
+/// they were added are skipped.
+///
+/// \return The earliest time a file that was read has to be polled, or
+///     UINT64_MAX if no file was read.
+///
+ULONGLONG
+LogFileMonitor::ReadDirtyLogFiles()
+{
+    ULONGLONG nextPollTimestamp = UINT64_MAX;
+
+    std::vector<std::shared_ptr<LogFileInformation>> dirtyFiles;
+    dirtyFiles.swap(m_dirtyFiles);
+
+    for (const auto& logFileInfo : dirtyFiles)
+    {
+        if (!logFileInfo->IsDirty)
+        {
+            continue;
+        }
+
+        logFileInfo->IsDirty = false;
+
+        ReadLogFile(logFileInfo);
+
+        //
+        // The file is active, poll it often again.
+        //
+        logFileInfo->PollIntervalMillis = POLL_INTERVAL_MIN_MILLIS;
+        logFileInfo->NextPollTimestamp = GetTickCount64() + POLL_INTERVAL_MIN_MILLIS;
+
+        if (logFileInfo->NextPollTimestamp < nextPollTimestamp)
+        {
+            nextPollTimestamp = logFileInfo->NextPollTimestamp;
+        }
+    }
+
+    return nextPollTimestamp;
+}
+
+///
+/// Checks if a file changed since it was last read or probed, comparing its
+/// size with the read offset and its last write time with the previous
+/// probe. It doesn't open the file, GetFileAttributesExW queries the
+/// attributes of the open stream, so the size is current even if the
+/// directory entry wasn't updated yet.
+///
+/// \param LogFileInfo     The file to probe.
+///
+/// \return True if the file has to be read.
+///
+bool
+LogFileMonitor::ProbeLogFile(
+    _Inout_ LogFileInformation& LogFileInfo
+    )
+{
+    const std::wstring fullLongPath = m_logDirectory + L'\\' + LogFileInfo.FileName;
+    WIN32_FILE_ATTRIBUTE_DATA attributes;
+
+    if (!GetFileAttributesExW(fullLongPath.c_str(), GetFileExInfoStandard, &attributes))
+    {
+        //
+        // A deleted file is handled by its remove event. Close its cached
+        // handle, the file could be delete-pending until it's closed.
+        //
+        m_fileHandles.Remove(LogFileInfo.FileId);
+        return false;
+    }
+
+    const UINT64 fileSize = (static_cast<UINT64>(attributes.nFileSizeHigh) << 32) | attributes.nFileSizeLow;
+    const UINT64 writeTime = (static_cast<UINT64>(attributes.ftLastWriteTime.dwHighDateTime) << 32)
+        | attributes.ftLastWriteTime.dwLowDateTime;
+
+    const bool changed = fileSize > LogFileInfo.NextReadOffset || writeTime != LogFileInfo.ProbedWriteTime;
+
+    LogFileInfo.ProbedWriteTime = writeTime;
+
+    //
+    // A change found by the polling may be a replacement without an event.
+    //
+    if (changed)
+    {
+        LogFileInfo.VerifyHandle = true;
+    }
+
+    return changed;
+}
+
+///
+/// Probes the files whose poll interval elapsed, and adds the ones that
+/// changed to the dirty set. The poll interval of a changed file goes back
+/// to POLL_INTERVAL_MIN_MILLIS, and the one of an unchanged file doubles up
+/// to POLL_INTERVAL_MAX_MILLIS, so idle files are rarely probed.
+///
+/// \param PollAll         True to probe all the files, even if their
+///                         interval didn't elapse.
+///
+/// \return The earliest time a file has to be polled again.
+///
+ULONGLONG
+LogFileMonitor::PollLogFiles(
+    _In_ bool PollAll
+    )
+{
+    const ULONGLONG now = GetTickCount64();
+    ULONGLONG nextPollTimestamp = now + POLL_INTERVAL_MIN_MILLIS;
+    bool isFirstFile = true;
+
+    for (const auto& entry : m_logFilesInformation)
+    {
+        const auto& logFileInfo = entry.second;
+
+        if (PollAll || logFileInfo->NextPollTimestamp <= now)
+        {
+            if (ProbeLogFile(*logFileInfo))
+            {
+                logFileInfo->PollIntervalMillis = POLL_INTERVAL_MIN_MILLIS;
+                MarkLogFileDirty(logFileInfo);
+            }
+            else if (logFileInfo->PollIntervalMillis == 0)
+            {
+                logFileInfo->PollIntervalMillis = POLL_INTERVAL_MIN_MILLIS;
+            }
+            else
+            {
+                logFileInfo->PollIntervalMillis = logFileInfo->PollIntervalMillis < POLL_INTERVAL_MAX_MILLIS / 2
+                    ? logFileInfo->PollIntervalMillis * 2
+                    : POLL_INTERVAL_MAX_MILLIS;
+            }
+
+            logFileInfo->NextPollTimestamp = now + logFileInfo->PollIntervalMillis;
+        }
+
+        if (isFirstFile || logFileInfo->NextPollTimestamp < nextPollTimestamp)
+        {
+            nextPollTimestamp = logFileInfo->NextPollTimestamp;
+            isFirstFile = false;
+        }
+    }
+
+    return nextPollTimestamp;
+}
+
+///
+/// Sets the polling timer to expire at the given time.
+///
+/// \param TimerEvent      The waitable timer.
+/// \param DueTimestamp    When the timer expires, in GetTickCount64 units.
+///
+/// \return The result of SetWaitableTimer.
+///
+BOOL
+LogFileMonitor::SetPollTimer(
+    _In_ HANDLE TimerEvent,
+    _In_ ULONGLONG DueTimestamp
+    )
+{
+    const ULONGLONG now = GetTickCount64();
+    LARGE_INTEGER dueTime;
+
+    //
+    // Relative time, in 100 nanoseconds.
+    //
+    dueTime.QuadPart = (DueTimestamp > now) ? -static_cast<LONGLONG>(DueTimestamp - now) * 10000LL : -1LL;
+
+    m_pollTimerDueTimestamp = DueTimestamp;
+
+    return SetWaitableTimer(TimerEvent, &dueTime, 0, NULL, NULL, 0);
+}
+
+///
+/// Loads the checkpoint file, if one was configured. The checkpoints are
+/// applied by InitializeDirectoryChangeEventsQueue through RestoreCheckpoint.
+///
+void
+LogFileMonitor::LoadCheckpoints()
+{
+    if (!m_checkpointStore)
+    {
+        return;
+    }
+
+    std::vector<LogFileCheckpoint> checkpoints;
+
+    DWORD status = m_checkpointStore->Load(checkpoints);
+
+    if (status == ERROR_SUCCESS)
+    {
+        for (const auto& checkpoint : checkpoints)
+        {
+            m_restoredCheckpoints[checkpoint.FileId] = checkpoint;
+        }
+
+        m_checkpointsRestored = true;
+    }
+    else if (status != ERROR_FILE_NOT_FOUND)
+    {
+        logWriter.TraceWarning(
+            FORMAT_STRING(
+                L"Log file monitor failed to load checkpoint file %ws, it will be replaced. Error: %lu",
+                m_checkpointStore->GetFilePath().c_str(),
+                status
+            ).c_str()
+        );
+    }
+}
+
+///
+/// Applies the checkpoint of a file found when the monitor starts. The
+/// checkpoint is ignored if the file is smaller than the saved offset, or
+/// if its first bytes changed, since then it's a different file that
+/// reused the file ID.
+///
+/// \param FullLongPath    Full path of the file.
+/// \param LogFileInfo     The file information. FileId must be set.
+///
+/// \return True if the read offset of the file was restored.
+///
+bool
+LogFileMonitor::RestoreCheckpoint(
+    _In_ const std::wstring& FullLongPath,
+    _Inout_ LogFileInformation& LogFileInfo
+    )
+{
+    auto it = m_restoredCheckpoints.find(LogFileInfo.FileId);
+    if (it == m_restoredCheckpoints.end())
+    {
+        return false;
+    }
+
+    const LogFileCheckpoint checkpoint = it->second;
+    m_restoredCheckpoints.erase(it);
+
+    if (checkpoint.FingerprintSize > LogFileCheckpointStore::FINGERPRINT_MAX_BYTES
+        || checkpoint.FingerprintSize > checkpoint.NextReadOffset)
+    {
+        return false;
+    }
+
+    HANDLE logFile = CreateFileW(FullLongPath.c_str(),
+                                  GENERIC_READ,
+                                  FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                                  nullptr,
+                                  OPEN_EXISTING,
+                                  FILE_ATTRIBUTE_NORMAL,
+                                  nullptr);
+    if (logFile == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+
+    bool restored = false;
+    LARGE_INTEGER fileSize = {};
+    BYTE head[LogFileCheckpointStore::FINGERPRINT_MAX_BYTES];
+    DWORD bytesRead = 0;
+
+    if (GetFileSizeEx(logFile, &fileSize)
+        && static_cast<UINT64>(fileSize.QuadPart) >= checkpoint.NextReadOffset
+        && (checkpoint.FingerprintSize == 0
+            || (::ReadFile(logFile, head, checkpoint.FingerprintSize, &bytesRead, nullptr)
+                && bytesRead == checkpoint.FingerprintSize
+                && LogFileCheckpointStore::ComputeFingerprint(head, bytesRead) == checkpoint.Fingerprint)))
+    {
+        LogFileInfo.NextReadOffset = checkpoint.NextReadOffset;
+        LogFileInfo.EncodingType = checkpoint.EncodingType;
+        LogFileInfo.FingerprintSize = checkpoint.FingerprintSize;
+        LogFileInfo.Fingerprint = checkpoint.Fingerprint;
+        restored = true;
+    }
+
+    CloseHandle(logFile);
+
+    return restored;
+}
+
+///
+/// Saves the read offsets of the monitored files to the checkpoint file,
+/// if they changed and the checkpoint interval elapsed since the last save.
+///
+/// The lines read before an offset may still be queued in the LogWriter,
+/// so they are flushed before the offset is saved. Otherwise a restart
+/// would skip the lines that were lost with the queue.
+///
+/// \param Force           True to save without waiting for the interval.
+///
+void
+LogFileMonitor::SaveCheckpoints(
+    _In_ bool Force
+    )
+{
+    if (!m_checkpointStore || !m_checkpointDirty)
+    {
+        return;
+    }
+
+    const ULONGLONG now = GetTickCount64();
+
+    if (!Force && now - m_lastCheckpointTime < m_checkpointIntervalMillis)
+    {
+        return;
+    }
+
+    std::vector<LogFileCheckpoint> checkpoints;
+    checkpoints.reserve(m_logFilesInformation.size());
+
+    for (const auto& entry : m_logFilesInformation)
+    {
+        const auto& logFileInfo = entry.second;
+
+        UpdateFingerprint(logFileInfo);
+
+        LogFileCheckpoint checkpoint;
+        checkpoint.FileId = logFileInfo->FileId;
+        checkpoint.NextReadOffset = logFileInfo->NextReadOffset;
+        checkpoint.EncodingType = logFileInfo->EncodingType;
+        checkpoint.FingerprintSize = logFileInfo->FingerprintSize;
+        checkpoint.Fingerprint = logFileInfo->Fingerprint;
+
+        checkpoints.push_back(checkpoint);
+    }
+
+    m_lastCheckpointTime = now;
+
+    logWriter.Flush();
+
+    DWORD status = m_checkpointStore->Save(checkpoints);
+
+    if (status == ERROR_SUCCESS)
+    {
+        m_checkpointDirty = false;
+    }
+    else
+    {
+        logWriter.TraceError(
+            FORMAT_STRING(
+                L"Log file monitor failed to save checkpoint file %ws. Error: %lu",
+                m_checkpointStore->GetFilePath().c_str(),
+                status
+            ).c_str()
+        );
+    }
+}
+
+///
+/// Computes the fingerprint of a file, the hash of its first bytes, once
+/// they have been read. A fingerprint over the whole
+/// LogFileCheckpointStore::FINGERPRINT_MAX_BYTES is computed only once.
+///
+/// \param LogFileInfo     The file.
+///
+void
+LogFileMonitor::UpdateFingerprint(
+    _In_ const std::shared_ptr<LogFileInformation>& LogFileInfo
+    )
+{
+    const UINT64 readSize = LogFileInfo->NextReadOffset;
+    const UINT32 fingerprintSize = readSize < LogFileCheckpointStore::FINGERPRINT_MAX_BYTES
+        ? static_cast<UINT32>(readSize)
+        : LogFileCheckpointStore::FINGERPRINT_MAX_BYTES;
+
+    if (fingerprintSize == LogFileInfo->FingerprintSize)
+    {
+        return;
+    }
+
+    bool isCachedHandle = false;
+
+    HANDLE logFile = AcquireLogFileHandle(LogFileInfo, isCachedHandle);
+    if (logFile == INVALID_HANDLE_VALUE)
+    {
+        return;
+    }
+
+    if (LogFileInfo->NextReadOffset != readSize)
+    {
+        //
+        // The file was replaced, and nothing of the new one was read yet.
+        //
+        ReleaseLogFileHandle(LogFileInfo, logFile, isCachedHandle, false);
+        return;
+    }
+
+    BYTE head[LogFileCheckpointStore::FINGERPRINT_MAX_BYTES];
+    OVERLAPPED overlapped = { 0, 0, 0, 0, nullptr };
+    DWORD bytesRead = 0;
+
+    if (::ReadFile(logFile, head, fingerprintSize, &bytesRead, &overlapped))
+    {
+        LogFileInfo->FingerprintSize = bytesRead;
+        LogFileInfo->Fingerprint = LogFileCheckpointStore::ComputeFingerprint(head, bytesRead);
+    }
+
+    ReleaseLogFileHandle(LogFileInfo, logFile, isCachedHandle, false);
+}
+
+///
+/// Returns a handle obtained from AcquireLogFileHandle. A cached handle is
+/// kept open, unless the read failed. The handle of a deleted file is
+/// closed by its remove event, or by the polling.
+///
+/// \param LogFileInfo     The file the handle belongs to.
+/// \param Handle          The handle.
+/// \param IsCached        The value returned by AcquireLogFileHandle.
+/// \param Evict           True to close the handle even if it's cached.
+///
+void
+LogFileMonitor::ReleaseLogFileHandle(
+    _In_ const std::shared_ptr<LogFileInformation>& LogFileInfo,
+    _In_ HANDLE Handle,
+    _In_ bool IsCached,
+    _In_ bool Evict
+    )
+{
+    if (!IsCached)
+    {
+        CloseHandle(Handle);
+        return;
+    }
+
+    if (Evict)
+    {
+        m_fileHandles.Remove(LogFileInfo->FileId);
+    }
+}
+
+///
+/// Traces the hits, misses and evictions of the handle cache. Runs on the
+/// reader strand, like the other users of the cache.
+///
+void
+LogFileMonitor::TraceFileHandleStatistics()
+{
+    const UINT64 hits = m_fileHandles.Hits();
+    const UINT64 misses = m_fileHandles.Misses();
+
+    logWriter.TraceInfo(
+        FORMAT_STRING(
+            L"Log file monitor file handles of directory %ws: %llu hits (%.1f%%), %llu misses, %llu evictions.",
+            m_logDirectory.c_str(),
+            hits,
+            hits + misses > 0 ? 100.0 * hits / (hits + misses) : 0.0,
+            misses,
+            m_fileHandles.Evictions()
+        ).c_str()
+    );
+}
+
+///
+/// Writes a UTF-8 line of a log file, prefixed with the file name if
+/// includeFileNames is set. In the JSON output format, the line and the
+/// file name are members of a JSON object instead.
+///
+/// \param Line            The line, without line break.
+/// \param Length          Size of the line in bytes.
+/// \param FileName        Name of the file, relative to the log directory.
+///
+void
+LogFileMonitor::WriteToConsole(
+    _In_reads_(Length) const char* Line,
+    _In_ size_t Length,
+    _In_ const std::wstring& FileName
+    )
+{
+    m_lineBuffer.clear();
+
+    if (logWriter.GetOutputFormat() == OutputFormat::Json)
+    {
+        JsonLineWriter json(m_lineBuffer);
+
+        json.BeginObject();
+        json.Key("Source");
+        json.String("File");
+        json.Key("LogEntry");
+        json.BeginObject();
+
+        if (m_includeFileNames)
+        {
+            json.Key("FileName");
+            json.String(FileName.data(), FileName.size());
+        }
+
+        json.Key("Logline");
+        json.String(Line, Length);
+        json.EndObject();
+        json.EndObject();
+    }
+    else if (m_includeFileNames)
+    {
+        if (m_linePrefix.empty() || m_linePrefixFileName != FileName)
+        {
+            m_linePrefix.assign("[Log File: ");
+            Utility::AppendUtf8(m_linePrefix, FileName.data(), FileName.size());
+            m_linePrefix.append("] ");
+
+            m_linePrefixFileName = FileName;
+        }
+
+        m_lineBuffer.append(m_linePrefix);
+        m_lineBuffer.append(Line, Length);
+    }
+    else
+    {
+        m_lineBuffer.append(Line, Length);
+    }
+
+    //
+    // The ring gives back the buffer of an earlier line in exchange, so
+    // moving the line doesn't cost an allocation for the next one.
+    //
+    logWriter.WriteConsoleLog(std::move(m_lineBuffer), m_outputSourceId);
+}
+
+DWORD
+LogFileMonitor::GetFilesInDirectory(
+    _In_ const std::wstring& FolderPath,
+    _In_ const std::wstring& SearchPattern,
+    _Out_ std::vector<std::pair<std::wstring, FILE_ID_INFO>>& Files,
+    _In_ bool ShouldLookInSubfolders
+    )
+{
+    WIN32_FIND_DATA ffd;
+    DWORD status = ERROR_SUCCESS;
+
+    //
+    // First search through subfolders.
+    //
+    if (ShouldLookInSubfolders)
+    {
+        std::wstring toSearch = FolderPath + L"\\*";
+        HANDLE hFind = FindFirstFileW(toSearch.c_str(), &ffd);
+        if (hFind != INVALID_HANDLE_VALUE)
+        {
+            do
+            {
+                if ((ffd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) && (ffd.cFileName[0] != L'.'))
+                {
+                    std::wstring subfolderPath = FolderPath + L"\\" + ffd.cFileName;
+                    status = GetFilesInDirectory(subfolderPath, SearchPattern, Files, true);
+                }
+            } while (FindNextFile(hFind, &ffd) != 0 && (status == ERROR_SUCCESS));
+            FindClose(hFind);
+        }
+        else
+        {
+            status = GetLastError();
+        }
+    }
+
+    if (status == ERROR_SUCCESS)
+    {
+        //
+        // Now search for files using SearchPattern
+        //
+        std::wstring toSearch = FolderPath + L"\\" + SearchPattern;
+        HANDLE hFind = FindFirstFileW(toSearch.c_str(), &ffd);
+        if (hFind != INVALID_HANDLE_VALUE)
+        {
+            do
+            {
+                //
+                // Filter out the files that do not match the specified filter.
+                //
+                if (!(ffd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+                    && FileMatchesFilter(ffd.cFileName, SearchPattern.c_str()))
+                {
+                    std::wstring fileName = FolderPath + L"\\" + ffd.cFileName;
+
+                    FILE_ID_INFO fileId{ 0 };
+                    GetFileId(fileName, fileId);
+
+                    //wprintf(L"Started monitoring file: %s\n",fileName.c_str());
+
+                    Files.push_back({ fileName, fileId });
+                }
+            } while (FindNextFile(hFind, &ffd) != 0);
+
+            status = GetLastError();
+
+            if (status == ERROR_NO_MORE_FILES)
+            {
+                status = ERROR_SUCCESS;
+            }
+
+            FindClose(hFind);
+        }
+    }
+
+
+    return status;
+}
+
+///
+/// Detects the encoding of a log file, or of the output of the child
+/// process, from its BOM, or from its first bytes if it has none.
+///
+/// \param FileContents    The first bytes read.
+/// \param ContentSize     Size of the bytes read.
+/// \param Bom             The first bytes of the file, where a BOM would be.
+/// \param BomSize         Size of the first bytes.
+/// \param FoundBomSize    Returns the size of the BOM found, or 0.
+///
+/// \return The encoding, or FileTypeUnknown if there are too few bytes.
+///
+LM_FILETYPE
+LogFileMonitor::FileTypeFromBuffer(
+    _In_reads_bytes_(ContentSize) LPBYTE FileContents,
+    _In_ UINT ContentSize,
+    _In_reads_bytes_(BomSize) LPBYTE Bom,
+    _In_ UINT BomSize,
+    _Out_ UINT& FoundBomSize
+    )
+{
+    LM_FILETYPE lmFileType = LM_FILETYPE::FileTypeUnknown;
+    FoundBomSize = 0;
+
+    PWSTR szBuf = (PWSTR)FileContents;
+    if (ContentSize <= 1 && BomSize <= 1)
+    {
+        return lmFileType;
+    }
+
+    switch (*((PWSTR)Bom))
+    {
+    //
+    // look for the standard BOMs.
+    //
+    case BYTE_ORDER_MARK:
+        lmFileType = LM_FILETYPE::UTF16LE;
+        FoundBomSize = sizeof(WCHAR);
+        break;
+
+    case REVERSE_BYTE_ORDER_MARK:
+        lmFileType = LM_FILETYPE::UTF16BE;
+        FoundBomSize = sizeof(WCHAR);
+        break;
+
+    //
+    // UTF bom has 3 bytes.
+    //
+    case BOM_UTF8_HALF:
+        if (BomSize > 2 && ((BYTE) * ((Bom)+2) == BOM_UTF8_2HALF))
+        {
+            lmFileType = LM_FILETYPE::UTF8;
+            FoundBomSize = sizeof(char) * 3;
+            break;
+        }
+
+        //
+        // If UTF8 BOM doesn't match, continue with the evaluation
+        //
+    default:
+        //
+        // Is the file unicode without BOM ?
+        //
+        if (Utility::IsInputTextUnicode((LPCSTR)FileContents, ContentSize))
+        {
+            lmFileType = LM_FILETYPE::UTF16LE;
+        }
+        else
+        {
+            //
+            // Is the file UTF-8 even though it doesn't have UTF-8 BOM ?
+            //
+            if (Utility::IsTextUTF8((LPCSTR)FileContents, ContentSize))
+            {
+                lmFileType = LM_FILETYPE::UTF8;
+            }
+            //
+            // well, it is most likely an ansi file.
+            //
+            else
+            {
+                lmFileType = LM_FILETYPE::ANSI;
+            }
+        }
+        break;
+    }
+
+    return lmFileType;
+}
+
+
+///
+/// Gets an iterator, using first the Key as if it was a long path, and if it
+/// isn't found recovering the long path using Key as a short path.
+///
+/// \param Key         The filename to look for.
+/// \param IsShortPath Optional boolean pointer. If it's passed, it will return
+///     false if the key wasn't a short path. Otherwise, will be true.
+///
+/// \return Iterator to a m_logFilesInformation element.
+///
+LogFileMonitor::LogFileInfoMap::iterator
+LogFileMonitor::GetLogFilesInformationIt(
+    _In_ const std::wstring& Key,
+    _Out_opt_ bool* IsShortPath
+    )
+{
+    //
+    // Fold and hash the key once for both tables.
+    //
+    const CaseFoldedPath foldedKey(Key);
+
+    auto element = m_logFilesInformation.find(foldedKey);
+
+    if (element == m_logFilesInformation.end())
+    {
+        auto longPath = m_longPaths.find(foldedKey);
+        if (longPath != m_longPaths.end())
+        {
+            element = m_logFilesInformation.find(longPath->second);
+        }
+
+        if (IsShortPath != NULL)
+        {
+            *IsShortPath = true;
+        }
+    }
+    else
+    {
+        if (IsShortPath != NULL)
+        {
+            *IsShortPath = false;
+        }
+    }
+
+    return element;
+}
+
+///
+/// Gets the file id from a specified file.
+///
+/// \param FullLongPath     The filename of the file to get its id.
+/// \param FileId           An output parameter, with the file id.
+/// \param Handle           Optional. If it is passed, it doesn't need to
+///     open the file again.
+///
+/// \return DWORD with a standard result of the function.
+///
+DWORD
+LogFileMonitor::GetFileId(
+    _In_ const std::wstring& FullLongPath,
+    _Out_ FILE_ID_INFO& FileId,
+    _In_opt_ HANDLE Handle
+    )
+{
+    DWORD status = ERROR_SUCCESS;
+
+    //
+    // Flag to close the handle at the end of the function.
+    //
+    bool handleWasGiven = false;
+
+    if (Handle == INVALID_HANDLE_VALUE)
+    {
+        Handle = CreateFileW(FullLongPath.c_str(),
+            GENERIC_READ,
+            FILE_SHARE_READ | FILE_SHARE_WRITE,
+            nullptr,
+            OPEN_EXISTING,
+            FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+            nullptr);
+    }
+    else
+    {
+        handleWasGiven = true;
+    }
+
+    if (Handle == INVALID_HANDLE_VALUE)
+    {
+        status = GetLastError();
+        logWriter.TraceError(
+            FORMAT_STRING(
+                L"Error in log file monitor. Failed to open file %ws. Error: %d",
+                FullLongPath.c_str(),
+                status
+            ).c_str()
+        );
+        return status;
+    }
+
+    BOOL infoQueryStatus = ::GetFileInformationByHandleEx(
+        Handle,
+        FileIdInfo,
+        &FileId,
+        sizeof(FILE_ID_INFO));
+
+    if (!infoQueryStatus)
+    {
+        status = GetLastError();
+        logWriter.TraceError(
+            FORMAT_STRING(
+                L"Error in log file monitor. Failed to query file information. File: %ws. Error: %d",
+                FullLongPath.c_str(),
+                status
+            ).c_str()
+        );
+    }
+
+    if (!handleWasGiven)
+    {
+        CloseHandle(Handle);
+    }
+
+    return status;
+}
@@ -1,227 +1,455 @@
-//
-// Copyright (c) Microsoft Corporation.
-// Licensed under the MIT license.
-//
-
-#pragma once
-
-#define REVERSE_BYTE_ORDER_MARK 0xFFFE
-#define BYTE_ORDER_MARK         0xFEFF
-
-#define BOM_UTF8_HALF           0xBBEF
-#define BOM_UTF8_2HALF          0xBF
-
-#define PREFIX_EXTENDED_PATH L"\\\\?\\"
-
-///
-/// LogMonitor filetype
-///
-enum LM_FILETYPE {
-    FileTypeUnknown,
-    ANSI,
-    UTF16LE,
-    UTF16BE,
-    UTF8
-};
-
-struct LogFileInformation
-{
-    std::wstring FileName;
-    UINT64 NextReadOffset;
-    UINT64 LastReadTimestamp;
-    LM_FILETYPE EncodingType;
-};
-
-enum class EventAction
-{
-    Add = 0,
-    Modify = 1,
-    Remove = 2,
-    RenameOld = 3,
-    RenameNew = 4,
-    ReInit = 5,
-    Unknown = 5,
-};
-
-
-struct DirChangeNotificationEvent
-{
-    std::wstring FileName;
-    EventAction Action;
-    UINT64 Timestamp;
-};
-
-
-class LogFileMonitor final
-{
-public:
-    LogFileMonitor() = delete;
-
-    LogFileMonitor(
-        _In_ const std::wstring& LogDirectory,
-        _In_ const std::wstring& Filter,
-        _In_ bool IncludeSubfolders,
-        _In_ bool IncludeFileNames
-        );
-
-    ~LogFileMonitor();
-
-private:
-    static constexpr int LOG_MONITOR_THREAD_EXIT_MAX_WAIT_MILLIS = 5 * 1000;
-    static constexpr int RECORDS_BUFFER_SIZE_BYTES = 8 * 1024;
-
-    std::wstring m_logDirectory;
-    std::wstring m_shortLogDirectory;
-    std::wstring m_filter;
-    bool m_includeSubfolders;
-    bool m_includeFileNames;
-
-    //
-    // Signaled by destructor to request the spawned thread to stop.
-    //
-    HANDLE m_stopEvent;
-
-    HANDLE m_dirMonitorStartedEvent;
-
-    HANDLE m_workerThreadEvent;
-
-    HANDLE m_logDirHandle;
-
-    OVERLAPPED m_overlapped;
-    HANDLE m_overlappedEvent;
-
-    //
-    // Must be DWORD aligned so allocated on the heap.
-    //
-    std::vector<BYTE> records = std::vector<BYTE>(RECORDS_BUFFER_SIZE_BYTES);
-
-    //
-    // Handle to an event subscriber thread.
-    //
-    HANDLE m_logDirMonitorThread;
-
-    //
-    // Handle to an change notification event handler thread.
-    //
-    HANDLE m_logFilesChangeHandlerThread;
-
-    SRWLOCK m_eventQueueLock;
-
-    //
-    // Case insensitive comparison
-    //
-    struct ci_less
-    {
-        bool operator() (const std::wstring & s1, const std::wstring & s2) const
-        {
-            return _wcsicmp(s1.c_str(), s2.c_str()) < 0;
-        }
-    };
-
-    typedef std::map<std::wstring, std::shared_ptr<LogFileInformation>, ci_less> LogFileInfoMap;
-
-    LogFileInfoMap m_logFilesInformation;
-
-    std::map<std::wstring, std::wstring, ci_less> m_longPaths;
-
-    //
-    // FILE_ID_INFO comparison
-    //
-    struct file_id_less
-    {
-        bool operator() (const FILE_ID_INFO& id1, const FILE_ID_INFO& id2) const
-        {
-            return id1.VolumeSerialNumber < id2.VolumeSerialNumber ||
-                (id1.VolumeSerialNumber == id2.VolumeSerialNumber
-                    && memcmp(id1.FileId.Identifier, id2.FileId.Identifier, sizeof(id1.FileId.Identifier)) < 0);
-        }
-    };
-
-    std::map<FILE_ID_INFO, std::wstring, file_id_less> m_fileIds;
-
-    std::queue<DirChangeNotificationEvent> m_directoryChangeEvents;
-
-    bool m_readLogFilesFromStart;
-
-    DWORD EnqueueDirChangeEvents(DirChangeNotificationEvent event, BOOLEAN lock);
-
-    DWORD StartLogFileMonitor();
-
-    static DWORD StartLogFileMonitorStatic(
-        _In_ LPVOID Context
-        );
-
-    static inline BOOL FileMatchesFilter(
-        _In_ LPCWSTR FileName,
-        _In_ LPCWSTR SearchPattern
-        );
-
-    DWORD InitializeMonitoredFilesInfo();
-
-    DWORD LogDirectoryChangeNotificationHandler();
-
-    static DWORD LogFilesChangeHandlerStatic(
-        _In_ LPVOID Context
-        );
-
-    DWORD LogFilesChangeHandler();
-
-    DWORD InitializeDirectoryChangeEventsQueue();
-
-    static DWORD GetFilesInDirectory(
-        _In_ const std::wstring& FolderPath,
-        _In_ const std::wstring& SearchPattern,
-        _Out_ std::vector<std::pair<std::wstring, FILE_ID_INFO>>& Files,
-        _In_ bool ShouldLookInSubfolders
-        );
-
-    DWORD LogFileAddEventHandler(DirChangeNotificationEvent& Event);
-
-    DWORD LogFileRemoveEventHandler(DirChangeNotificationEvent& Event);
-
-    DWORD LogFileModifyEventHandler(DirChangeNotificationEvent& Event);
-
-    DWORD LogFileRenameNewEventHandler(DirChangeNotificationEvent& Event);
-
-    void RenameFileInMaps(
-        _In_ const std::wstring& NewFullName,
-        _In_ const std::wstring& OldName,
-        _In_ const FILE_ID_INFO& FileId
-        );
-
-    DWORD LogFileReInitEventHandler(DirChangeNotificationEvent& Event);
-
-    DWORD ReadLogFile(
-        _Inout_ std::shared_ptr<LogFileInformation> LogFileInfo
-        );
-
-    void WriteToConsole(
-        _In_ std::wstring Message,
-        _In_ std::wstring FileName
-    );
-
-    LM_FILETYPE FileTypeFromBuffer(
-        _In_reads_bytes_(ContentSize) LPBYTE FileContents,
-        _In_ UINT ContentSize,
-        _In_reads_bytes_(BomSize) LPBYTE Bom,
-        _In_ UINT BomSize,
-        _Out_ UINT& FoundBomSize
-        );
-
-    std::wstring ConvertStringToUTF16(
-        _In_reads_bytes_(StringSize) LPBYTE StringPtr,
-        _In_ UINT StringSize,
-        _In_ LM_FILETYPE EncodingType
-        );
-
-    LogFileInfoMap::iterator GetLogFilesInformationIt(
-        _In_ const std::wstring& Key,
-        _Out_opt_ bool* IsShortPath = NULL
-        );
-
-    static DWORD GetFileId(
-        _In_ const std::wstring& FullLongPath,
-        _Out_ FILE_ID_INFO& FileId,
-        _In_opt_ HANDLE Handle = INVALID_HANDLE_VALUE
-        );
-};
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+
+#pragma once
+
+#define REVERSE_BYTE_ORDER_MARK 0xFFFE
+#define BYTE_ORDER_MARK         0xFEFF
+
+#define BOM_UTF8_HALF           0xBBEF
+#define BOM_UTF8_2HALF          0xBF
+
+#define PREFIX_EXTENDED_PATH L"\\\\?\\"
+
+struct LogFileInformation
+{
+    std::wstring FileName;
+    UINT64 NextReadOffset;
+    UINT64 LastReadTimestamp;
+    LM_FILETYPE EncodingType;
+
+    //
+    // Identity of the file the last time it was opened. Key of its handle
+    // in the handle cache.
+    //
+    FILE_ID_INFO FileId = { 0 };
+
+    //
+    // Hash of the first FingerprintSize bytes of the file, stored in the
+    // checkpoints to recognize the file after a restart.
+    //
+    UINT32 FingerprintSize = 0;
+    UINT64 Fingerprint = 0;
+
+    //
+    // True while the file is in the dirty set, waiting to be read.
+    //
+    bool IsDirty = false;
+
+    //
+    // True if the file at the path may no longer be the one of the cached
+    // handle, after a change event. The handle is checked before its next
+    // read.
+    //
+    bool VerifyHandle = false;
+
+    //
+    // State of the fallback polling, for changes without a notification.
+    // The poll interval doubles each time a probe finds the file unchanged.
+    //
+    UINT64 ProbedWriteTime = 0;
+    ULONGLONG NextPollTimestamp = 0;
+    DWORD PollIntervalMillis = 0;
+
+    //
+    // Reused between reads. Its size follows the amount of data appended
+    // to the file.
+    //
+    AdaptiveReadBuffer ReadBuffer;
+
+    //
+    // Keeps the incomplete characters and line between reads.
+    //
+    LogLineDecoder Decoder;
+};
+
+class LogFileMonitor final
+{
+public:
+    LogFileMonitor() = delete;
+
+    LogFileMonitor(
+        _In_ const std::wstring& LogDirectory,
+        _In_ const std::wstring& Filter,
+        _In_ bool IncludeSubfolders,
+        _In_ bool IncludeFileNames,
+        _In_ DWORD MaxReadBufferSize = 0,
+        _In_ const std::wstring& CheckpointFile = std::wstring(),
+        _In_ DWORD CheckpointIntervalSeconds = 0,
+        _In_ UINT32 OutputSourceId = LogWriter::LOGMONITOR_SOURCE_ID,
+        _In_ DirectoryWatcherFactory WatcherFactory = nullptr
+        );
+
+    ~LogFileMonitor();
+
+    static LM_FILETYPE FileTypeFromBuffer(
+        _In_reads_bytes_(ContentSize) LPBYTE FileContents,
+        _In_ UINT ContentSize,
+        _In_reads_bytes_(BomSize) LPBYTE Bom,
+        _In_ UINT BomSize,
+        _Out_ UINT& FoundBomSize
+        );
+
+private:
+    static constexpr int LOG_MONITOR_THREAD_EXIT_MAX_WAIT_MILLIS = 5 * 1000;
+    static constexpr size_t MAX_CACHED_FILE_HANDLES = 256;
+
+    //
+    // Unread content larger than this is read through a file mapping.
+    //
+    static constexpr UINT64 BACKLOG_MAPPING_MIN_BYTES = 16 * 1024 * 1024;
+    static constexpr UINT64 BACKLOG_MAPPING_WINDOW_BYTES = 16 * 1024 * 1024;
+
+    //
+    // A mapped window is decoded in slices of this size. The pages of a
+    // slice are touched just before it's decoded.
+    //
+    static constexpr UINT BACKLOG_MAPPING_SLICE_BYTES = 1024 * 1024;
+    static constexpr UINT BACKLOG_MAPPING_PAGE_BYTES = 4 * 1024;
+
+    static constexpr DWORD DEFAULT_CHECKPOINT_INTERVAL_SECONDS = 5;
+    static constexpr DWORD MAX_CHECKPOINT_INTERVAL_SECONDS = 24 * 60 * 60;
+
+    //
+    // Bounds of the per file polling interval.
+    //
+    static constexpr DWORD POLL_INTERVAL_MIN_MILLIS = 30 * 1000;
+    static constexpr DWORD POLL_INTERVAL_MAX_MILLIS = 5 * 60 * 1000;
+
+    std::wstring m_logDirectory;
+    std::wstring m_shortLogDirectory;
+    std::wstring m_filter;
+    bool m_includeSubfolders;
+    bool m_includeFileNames;
+    DWORD m_maxReadBufferSize;
+
+    //
+    // Id of the source in the LogWriter, that selects the overflow policy.
+    //
+    UINT32 m_outputSourceId;
+
+    //
+    // Signaled by destructor to request the spawned thread to stop.
+    //
+    HANDLE m_stopEvent;
+
+    HANDLE m_dirMonitorStartedEvent;
+
+    //
+    // Waitable timer of the polling of the log files, waited by the monitor
+    // thread.
+    //
+    HANDLE m_pollTimer;
+
+    //
+    // Source of the directory change events. Created and used by the monitor
+    // thread, with the factory if there is one, or as a Win32DirectoryWatcher.
+    //
+    DirectoryWatcherFactory m_directoryWatcherFactory;
+    std::unique_ptr<DirectoryWatcher> m_directoryWatcher;
+
+    //
+    // Events returned by the watcher, before they are queued.
+    //
+    std::vector<DirChangeNotificationEvent> m_watcherEvents;
+
+    //
+    // Handle to an event subscriber thread.
+    //
+    HANDLE m_logDirMonitorThread;
+
+    SRWLOCK m_eventQueueLock;
+
+    //
+    // True once the monitor thread posted StartReaderJob. Protected by
+    // m_eventQueueLock.
+    //
+    bool m_readerJobsStarted;
+
+    //
+    // Path tables, keyed by the case folded relative path. The key is hashed
+    // once per lookup, see GetLogFilesInformationIt.
+    //
+    typedef std::unordered_map<CaseFoldedPath, std::shared_ptr<LogFileInformation>, CaseFoldedPath::Hasher> LogFileInfoMap;
+
+    LogFileInfoMap m_logFilesInformation;
+
+    std::unordered_map<CaseFoldedPath, std::wstring, CaseFoldedPath::Hasher> m_longPaths;
+
+    //
+    // FILE_ID_INFO comparison
+    //
+    struct file_id_less
+    {
+        bool operator() (const FILE_ID_INFO& id1, const FILE_ID_INFO& id2) const
+        {
+            return id1.VolumeSerialNumber < id2.VolumeSerialNumber ||
+                (id1.VolumeSerialNumber == id2.VolumeSerialNumber
+                    && memcmp(id1.FileId.Identifier, id2.FileId.Identifier, sizeof(id1.FileId.Identifier)) < 0);
+        }
+    };
+
+    //
+    // FILE_ID_INFO hashing and equality, for unordered containers
+    //
+    struct file_id_hash
+    {
+        size_t operator() (const FILE_ID_INFO& id) const
+        {
+            //
+            // FNV-1a over the volume serial number and the file identifier.
+            //
+            UINT64 hash = 14695981039346656037ULL;
+            const BYTE* bytes = reinterpret_cast<const BYTE*>(&id.VolumeSerialNumber);
+
+            for (size_t i = 0; i < sizeof(id.VolumeSerialNumber); i++)
+            {
+                hash = (hash ^ bytes[i]) * 1099511628211ULL;
+            }
+
+            for (size_t i = 0; i < sizeof(id.FileId.Identifier); i++)
+            {
+                hash = (hash ^ id.FileId.Identifier[i]) * 1099511628211ULL;
+            }
+
+            return static_cast<size_t>(hash);
+        }
+    };
+
+    struct file_id_equal
+    {
+        bool operator() (const FILE_ID_INFO& id1, const FILE_ID_INFO& id2) const
+        {
+            return id1.VolumeSerialNumber == id2.VolumeSerialNumber
+                && memcmp(id1.FileId.Identifier, id2.FileId.Identifier, sizeof(id1.FileId.Identifier)) == 0;
+        }
+    };
+
+    std::unordered_map<FILE_ID_INFO, std::wstring, file_id_hash, file_id_equal> m_fileIds;
+
+    //
+    // Saves the read offsets of the files, if a checkpoint file was configured.
+    // The file is written at most once per interval, when an offset changed.
+    //
+    std::unique_ptr<LogFileCheckpointStore> m_checkpointStore;
+    DWORD m_checkpointIntervalMillis;
+    ULONGLONG m_lastCheckpointTime;
+    bool m_checkpointDirty;
+
+    //
+    // Checkpoints loaded at startup, consumed when the directory is enumerated.
+    // m_checkpointsRestored is true if the checkpoint file was loaded, in that
+    // case files without a checkpoint are new, and they are read from the start.
+    //
+    std::map<FILE_ID_INFO, LogFileCheckpoint, file_id_less> m_restoredCheckpoints;
+    bool m_checkpointsRestored;
+    size_t m_resumedFilesCount;
+
+    //
+    // Read handles of the monitored files, kept open between reads. The
+    // least recently read files are closed when the cache is full.
+    //
+    LruCache<FILE_ID_INFO, HANDLE, file_id_hash, file_id_equal> m_fileHandles;
+
+    //
+    // Runs the jobs that process the change events and read the files, one
+    // at a time, on the shared reader pool.
+    //
+    LogReaderStrand m_readerStrand;
+
+    //
+    // Protected by m_eventQueueLock.
+    //
+    DirChangeEventQueue m_directoryChangeEvents;
+
+    //
+    // Events taken from the queue by DirChangeEventsJob.
+    //
+    std::vector<DirChangeNotificationEvent> m_eventsBatch;
+
+    //
+    // Files with pending changes. They are read once after each batch of
+    // change events or polling, however many events they received.
+    //
+    std::vector<std::shared_ptr<LogFileInformation>> m_dirtyFiles;
+
+    //
+    // When the polling timer is due, to only move it earlier.
+    //
+    ULONGLONG m_pollTimerDueTimestamp;
+
+    bool m_readLogFilesFromStart;
+
+    //
+    // Buffer used to compose the UTF-8 lines written to the console. Reused
+    // between lines to avoid an allocation per line.
+    //
+    std::string m_lineBuffer;
+
+    //
+    // "[Log File: <name>] " prefix in UTF-8, for the file whose name is
+    // m_linePrefixFileName, so the name isn't transcoded for every line.
+    //
+    std::string m_linePrefix;
+    std::wstring m_linePrefixFileName;
+
+    DWORD EnqueueDirChangeEvents(DirChangeNotificationEvent event, BOOLEAN lock);
+
+    DWORD StartLogFileMonitor();
+
+    static DWORD StartLogFileMonitorStatic(
+        _In_ LPVOID Context
+        );
+
+    static inline BOOL FileMatchesFilter(
+        _In_ LPCWSTR FileName,
+        _In_ LPCWSTR SearchPattern
+        );
+
+    DWORD InitializeMonitoredFilesInfo();
+
+    DWORD DirectoryWatcherEventsHandler();
+
+    bool PostReaderJob(
+        _In_ std::function<DWORD()> Job
+        );
+
+    DWORD StartReaderJob();
+
+    DWORD DirChangeEventsJob();
+
+    DWORD PollTimerJob();
+
+    DWORD InitializeDirectoryChangeEventsQueue();
+
+    static DWORD GetFilesInDirectory(
+        _In_ const std::wstring& FolderPath,
+        _In_ const std::wstring& SearchPattern,
+        _Out_ std::vector<std::pair<std::wstring, FILE_ID_INFO>>& Files,
+        _In_ bool ShouldLookInSubfolders
+        );
+
+    DWORD LogFileAddEventHandler(DirChangeNotificationEvent& Event);
+
+    DWORD LogFileRemoveEventHandler(DirChangeNotificationEvent& Event);
+
+    DWORD LogFileModifyEventHandler(DirChangeNotificationEvent& Event);
+
+    DWORD LogFileRenameNewEventHandler(DirChangeNotificationEvent& Event);
+
+    void RenameFileInMaps(
+        _In_ const std::wstring& NewFullName,
+        _In_ const std::wstring& OldName,
+        _In_ const FILE_ID_INFO& FileId
+        );
+
+    DWORD LogFileReInitEventHandler(DirChangeNotificationEvent& Event);
+
+    DWORD ReadLogFile(
+        _Inout_ std::shared_ptr<LogFileInformation> LogFileInfo
+        );
+
+    void DecodeLogFileContent(
+        _In_ const std::shared_ptr<LogFileInformation>& LogFileInfo,
+        _In_reads_bytes_(ContentSize) LPBYTE Content,
+        _In_ UINT ContentSize,
+        _In_reads_bytes_opt_(BomSize) LPBYTE Bom,
+        _In_ UINT BomSize,
+        _In_ const LogLineDecoder::LineCallback& OnLine
+        );
+
+    DWORD ReadMappedLogFile(
+        _In_ const std::shared_ptr<LogFileInformation>& LogFileInfo,
+        _In_ HANDLE LogFile,
+        _In_ UINT64 EndOffset,
+        _In_reads_bytes_opt_(BomSize) LPBYTE Bom,
+        _In_ UINT BomSize,
+        _In_ const LogLineDecoder::LineCallback& OnLine
+        );
+
+    bool DecodeMappedContent(
+        _In_ const std::shared_ptr<LogFileInformation>& LogFileInfo,
+        _In_reads_bytes_(Size) LPBYTE View,
+        _In_ UINT Size,
+        _In_reads_bytes_opt_(BomSize) LPBYTE Bom,
+        _In_ UINT BomSize,
+        _In_ const LogLineDecoder::LineCallback& OnLine
+        );
+
+    void MarkLogFileDirty(
+        _In_ const std::shared_ptr<LogFileInformation>& LogFileInfo
+        );
+
+    ULONGLONG ReadDirtyLogFiles();
+
+    bool ProbeLogFile(
+        _Inout_ LogFileInformation& LogFileInfo
+        );
+
+    ULONGLONG PollLogFiles(
+        _In_ bool PollAll
+        );
+
+    BOOL SetPollTimer(
+        _In_ HANDLE TimerEvent,
+        _In_ ULONGLONG DueTimestamp
+        );
+
+    void LoadCheckpoints();
+
+    bool RestoreCheckpoint(
+        _In_ const std::wstring& FullLongPath,
+        _Inout_ LogFileInformation& LogFileInfo
+        );
+
+    void SaveCheckpoints(
+        _In_ bool Force
+        );
+
+    void UpdateFingerprint(
+        _In_ const std::shared_ptr<LogFileInformation>& LogFileInfo
+        );
+
+    HANDLE AcquireLogFileHandle(
+        _Inout_ const std::shared_ptr<LogFileInformation>& LogFileInfo,
+        _Out_ bool& IsCached
+        );
+
+    static bool IsFileAtPath(
+        _In_ const std::wstring& FullLongPath,
+        _In_ const FILE_ID_INFO& FileId
+        );
+
+    void ResetReplacedLogFile(
+        _Inout_ LogFileInformation& LogFileInfo,
+        _In_ const FILE_ID_INFO& FileId
+        );
+
+    void ReleaseLogFileHandle(
+        _In_ const std::shared_ptr<LogFileInformation>& LogFileInfo,
+        _In_ HANDLE Handle,
+        _In_ bool IsCached,
+        _In_ bool Evict
+        );
+
+    void TraceFileHandleStatistics();
+
+    void WriteToConsole(
+        _In_reads_(Length) const char* Line,
+        _In_ size_t Length,
+        _In_ const std::wstring& FileName
+    );
+
+    LogFileInfoMap::iterator GetLogFilesInformationIt(
+        _In_ const std::wstring& Key,
+        _Out_opt_ bool* IsShortPath = NULL
+        );
+
+    static DWORD GetFileId(
+        _In_ const std::wstring& FullLongPath,
+        _Out_ FILE_ID_INFO& FileId,
+        _In_opt_ HANDLE Handle = INVALID_HANDLE_VALUE
+        );
+};
@@ -0,0 +1,1123 @@
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+
+#include "pch.h"
+
+constexpr DWORD LogWriter::DEFAULT_FLUSH_LATENCY_MILLIS;
+constexpr DWORD LogWriter::MAX_FLUSH_LATENCY_MILLIS;
+constexpr size_t LogWriter::MAX_BATCH_BYTES;
+constexpr size_t LogWriter::DEFAULT_MAX_BUFFERED_BYTES;
+constexpr DWORD LogWriter::DEFAULT_DROP_REPORT_INTERVAL_SECONDS;
+constexpr UINT32 LogWriter::MAX_SOURCES;
+constexpr UINT32 LogWriter::LOGMONITOR_SOURCE_ID;
+constexpr size_t LogWriter::MAX_RECYCLED_RECORD_BYTES;
+constexpr DWORD LogWriter::MAX_ROOM_WAIT_MILLIS;
+
+///
+/// Starts the writer thread. The lines written afterwards are written by it.
+///
+/// \param FlushLatencyMillis   Maximum time a line waits for other lines to
+///                             be written in the same batch.
+/// \param RingCapacity         Number of lines that can wait to be written.
+/// \param MaxBufferedBytes     Maximum size of the lines waiting to be
+///                             written. 0 for the default.
+/// \param DropReportIntervalSeconds
+///                             Interval of the reports of the lines dropped
+///                             by the overflow policies. 0 for the default.
+///
+/// When either limit is reached, the overflow policy of the source of a line
+/// decides whether the writer waits, or a line is dropped.
+///
+/// \return False if the thread couldn't be started. The lines are still
+///     written synchronously in that case.
+///
+bool
+LogWriter::Start(
+    _In_ DWORD FlushLatencyMillis,
+    _In_ size_t RingCapacity,
+    _In_ size_t MaxBufferedBytes,
+    _In_ DWORD DropReportIntervalSeconds
+    )
+{
+    if (m_writerThread != NULL)
+    {
+        return true;
+    }
+
+    m_flushLatencyMillis = (std::min)(FlushLatencyMillis, MAX_FLUSH_LATENCY_MILLIS);
+    m_ring = std::make_unique<LogRecordRing>(RingCapacity);
+
+    m_maxBufferedBytes = MaxBufferedBytes != 0 ? MaxBufferedBytes : DEFAULT_MAX_BUFFERED_BYTES;
+
+    if (DropReportIntervalSeconds == 0)
+    {
+        DropReportIntervalSeconds = DEFAULT_DROP_REPORT_INTERVAL_SECONDS;
+    }
+
+    m_dropReportIntervalMillis = (std::min)(DropReportIntervalSeconds, static_cast<DWORD>(MAXDWORD / 1000)) * 1000;
+    m_lastDropReportTime = GetTickCount64();
+
+    m_writerIdle = false;
+    m_batchSignaled = false;
+    m_stopping = false;
+    m_bufferedBytes = 0;
+    m_recordsWritten = 0;
+    m_recordsEvicted = 0;
+    m_batches = 0;
+    m_fullRingWaits = 0;
+
+    m_wakeEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+    if (m_wakeEvent == NULL)
+    {
+        return false;
+    }
+
+    m_writerThread = CreateThread(
+        nullptr,
+        0,
+        (LPTHREAD_START_ROUTINE)&LogWriter::WriterThreadStatic,
+        this,
+        0,
+        nullptr);
+    if (m_writerThread == NULL)
+    {
+        CloseHandle(m_wakeEvent);
+        m_wakeEvent = NULL;
+        return false;
+    }
+
+    m_asynchronous = true;
+
+    return true;
+}
+
+///
+/// Writes the lines still in the ring and stops the writer thread. The
+/// lines written afterwards are written synchronously.
+///
+/// The network sink is stopped too, after it sent its pending lines. It
+/// isn't started again by Start.
+///
+void
+LogWriter::Stop()
+{
+    if (m_writerThread != NULL)
+    {
+        StopWriterThread();
+    }
+
+    AcquireSRWLockExclusive(&m_stdoutLock);
+    FlushFileSink();
+    ReleaseSRWLockExclusive(&m_stdoutLock);
+
+    if (m_networkSink)
+    {
+        m_networkSink->Stop();
+    }
+}
+
+void
+LogWriter::StopWriterThread()
+{
+    m_asynchronous = false;
+
+    //
+    // Let the threads that saw the writer running push their line. The
+    // writer still runs, so the ones waiting for room get it.
+    //
+    AcquireSRWLockExclusive(&m_producerLock);
+
+    while (m_activeProducers.load() != 0)
+    {
+        SleepConditionVariableSRW(&m_producersDone, &m_producerLock, INFINITE, 0);
+    }
+
+    ReleaseSRWLockExclusive(&m_producerLock);
+
+    m_stopping = true;
+    SetEvent(m_wakeEvent);
+
+    WaitForSingleObject(m_writerThread, INFINITE);
+
+    CloseHandle(m_writerThread);
+    m_writerThread = NULL;
+
+    CloseHandle(m_wakeEvent);
+    m_wakeEvent = NULL;
+
+    AcquireSRWLockExclusive(&m_flushLock);
+    ReleaseSRWLockExclusive(&m_flushLock);
+    WakeAllConditionVariable(&m_flushed);
+}
+
+///
+/// Waits until the lines written before the call are written to stdout, or
+/// dropped by the DropOldest policy. The current compressed block of the
+/// file sink is written too.
+///
+void
+LogWriter::Flush()
+{
+    m_activeProducers++;
+
+    if (!m_asynchronous)
+    {
+        LeaveProducer();
+
+        AcquireSRWLockExclusive(&m_stdoutLock);
+        fflush(stdout);
+        FlushFileSink();
+        ReleaseSRWLockExclusive(&m_stdoutLock);
+
+        return;
+    }
+
+    const UINT64 target = m_ring->EnqueuePosition();
+
+    m_flushRequests++;
+    SetEvent(m_wakeEvent);
+
+    LeaveProducer();
+
+    AcquireSRWLockExclusive(&m_flushLock);
+
+    while (m_recordsWritten.load() + m_recordsEvicted.load() < target && m_asynchronous)
+    {
+        SleepConditionVariableSRW(&m_flushed, &m_flushLock, INFINITE, 0);
+    }
+
+    ReleaseSRWLockExclusive(&m_flushLock);
+
+    m_flushRequests--;
+
+    AcquireSRWLockExclusive(&m_stdoutLock);
+    FlushFileSink();
+    ReleaseSRWLockExclusive(&m_stdoutLock);
+}
+
+///
+/// Sets the file where the lines are written, before the writer thread is
+/// started.
+///
+/// \param Sink             The file sink.
+/// \param WriteToStdout    If false, the lines are only written to the file.
+///                         The errors of the sink are always written to
+///                         stdout.
+///
+void
+LogWriter::SetFileSink(
+    _In_ std::unique_ptr<RotatingFileSink> Sink,
+    _In_ bool WriteToStdout
+    )
+{
+    AcquireSRWLockExclusive(&m_stdoutLock);
+
+    m_fileSink = std::move(Sink);
+    m_writeToStdout = WriteToStdout || (!m_fileSink && !m_networkSink);
+    m_fileSinkError = ERROR_SUCCESS;
+
+    ReleaseSRWLockExclusive(&m_stdoutLock);
+}
+
+///
+/// Sets the log collector where the lines are sent, before the writer
+/// thread is started. The sink should already be started.
+///
+/// \param Sink             The network sink.
+/// \param WriteToStdout    If false, the lines are only sent to the
+///                         collector, and written to the file sink if any.
+///                         The errors of the sinks are always written to
+///                         stdout.
+///
+void
+LogWriter::SetNetworkSink(
+    _In_ std::unique_ptr<NetworkSink> Sink,
+    _In_ bool WriteToStdout
+    )
+{
+    AcquireSRWLockExclusive(&m_stdoutLock);
+
+    m_networkSink = std::move(Sink);
+    m_writeToStdout = WriteToStdout || (!m_fileSink && !m_networkSink);
+
+    ReleaseSRWLockExclusive(&m_stdoutLock);
+}
+
+LogWriter::Statistics
+LogWriter::GetStatistics() const
+{
+    Statistics statistics;
+
+    statistics.RecordsWritten = m_recordsWritten.load();
+    statistics.Batches = m_batches.load();
+    statistics.FullRingWaits = m_fullRingWaits.load();
+    statistics.DroppedRecords = m_droppedRecords.load();
+    statistics.SuppressedRecords = m_suppressedRecords.load();
+
+    return statistics;
+}
+
+///
+/// Registers a source of log lines, with the policy applied to its lines
+/// when the ring is full or the max buffered bytes are reached.
+///
+/// \param Name         Name of the source, used in the dropped lines reports.
+/// \param Policy       The overflow policy.
+/// \param SampleRate   For the Sample policy, one line out of SampleRate
+///                     is kept.
+/// \param RateLimit    Maximum lines per second of the source. 0 for no
+///                     limit.
+/// \param RateLimitBurst   Lines the source can write at once, above the
+///                         rate limit. 0 for one second of lines.
+///
+/// \return The id to pass to WriteConsoleLog. The LogMonitor id if there
+///     are already MAX_SOURCES sources.
+///
+UINT32
+LogWriter::RegisterSource(
+    _In_ const std::wstring& Name,
+    _In_ OverflowPolicy Policy,
+    _In_ DWORD SampleRate,
+    _In_ DWORD RateLimit,
+    _In_ DWORD RateLimitBurst
+    )
+{
+    UINT32 sourceId = LOGMONITOR_SOURCE_ID;
+
+    AcquireSRWLockExclusive(&m_sourcesLock);
+
+    const UINT32 count = m_sourceCount.load();
+
+    if (count < MAX_SOURCES)
+    {
+        OutputSource& source = m_sources[count];
+
+        source.Name = Name;
+        source.Policy = Policy;
+        source.SampleRate = (std::max)(SampleRate, static_cast<DWORD>(1));
+        source.RateLimit.Configure(RateLimit, RateLimitBurst);
+
+        //
+        // Publish the source once it's initialized.
+        //
+        m_sourceCount.store(count + 1);
+        sourceId = count;
+    }
+
+    ReleaseSRWLockExclusive(&m_sourcesLock);
+
+    if (sourceId == LOGMONITOR_SOURCE_ID)
+    {
+        TraceWarning(
+            FORMAT_STRING(
+                L"Too many log sources. The lines of source '%s' are never dropped.",
+                Name.c_str()
+            ).c_str()
+        );
+    }
+
+    return sourceId;
+}
+
+UINT64
+LogWriter::GetDroppedRecords(
+    _In_ UINT32 SourceId
+    ) const
+{
+    if (SourceId >= m_sourceCount.load())
+    {
+        return 0;
+    }
+
+    return m_sources[SourceId].Dropped.load();
+}
+
+UINT64
+LogWriter::GetSuppressedRecords(
+    _In_ UINT32 SourceId
+    ) const
+{
+    if (SourceId >= m_sourceCount.load())
+    {
+        return 0;
+    }
+
+    return m_sources[SourceId].Suppressed.load();
+}
+
+///
+/// Writes a UTF-8 line.
+///
+void
+LogWriter::WriteConsoleLog(
+    _Inout_ std::string&& LogMessage,
+    _In_ UINT32 SourceId
+    )
+{
+    if (IsRateLimited(SourceId))
+    {
+        return;
+    }
+
+    WriteLine(LogMessage, SourceId);
+}
+
+void
+LogWriter::WriteConsoleLog(
+    _In_ const std::string& LogMessage,
+    _In_ UINT32 SourceId
+    )
+{
+    if (IsRateLimited(SourceId))
+    {
+        return;
+    }
+
+    if (!m_asynchronous)
+    {
+        WriteLineSynchronous(LogMessage);
+        return;
+    }
+
+    std::string line(LogMessage);
+
+    WriteLine(line, SourceId);
+}
+
+///
+/// Transcodes a UTF-16 line to UTF-8 and writes it.
+///
+void
+LogWriter::WriteConsoleLog(
+    _In_ const std::wstring& LogMessage,
+    _In_ UINT32 SourceId
+    )
+{
+    WriteConsoleLog(Utility::WideToUtf8(LogMessage), SourceId);
+}
+
+///
+/// Takes a token of the rate limit of the source of a line. The LogMonitor
+/// traces aren't limited.
+///
+/// \return True if the line is suppressed.
+///
+bool
+LogWriter::IsRateLimited(
+    _In_ UINT32 SourceId
+    )
+{
+    if (SourceId >= m_sourceCount.load(std::memory_order_relaxed))
+    {
+        return false;
+    }
+
+    OutputSource& source = m_sources[SourceId];
+
+    if (source.RateLimit.TryTake())
+    {
+        return false;
+    }
+
+    source.Suppressed.fetch_add(1, std::memory_order_relaxed);
+    m_suppressedRecords.fetch_add(1, std::memory_order_relaxed);
+
+    return true;
+}
+
+void
+LogWriter::WriteLine(
+    _Inout_ std::string& LogMessage,
+    _In_ UINT32 SourceId
+    )
+{
+    m_activeProducers++;
+
+    if (!m_asynchronous)
+    {
+        LeaveProducer();
+
+        WriteLineSynchronous(LogMessage);
+
+        return;
+    }
+
+    PushLine(LogMessage, SourceId);
+
+    LeaveProducer();
+}
+
+void
+LogWriter::WriteLineSynchronous(
+    _In_ const std::string& LogMessage
+    )
+{
+    AcquireSRWLockExclusive(&m_stdoutLock);
+
+    if (m_networkSink)
+    {
+        m_networkSink->Append(LogMessage.data(), LogMessage.size());
+    }
+
+    if (m_fileSink)
+    {
+        //
+        // The line and its line break are written together, so a rotation
+        // can't split them.
+        //
+        std::string line;
+        line.reserve(LogMessage.size() + 1);
+        line += LogMessage;
+        line += '\n';
+
+        WriteOutput(line.data(), line.size());
+    }
+    else if (m_writeToStdout)
+    {
+        fwrite(LogMessage.data(), sizeof(char), LogMessage.size(), stdout);
+        fputc('\n', stdout);
+        FlushStdOut();
+    }
+
+    ReleaseSRWLockExclusive(&m_stdoutLock);
+}
+
+///
+/// Writes lines to stdout and to the file sink. Called under m_stdoutLock.
+///
+void
+LogWriter::WriteOutput(
+    _In_reads_bytes_(Size) const char* Data,
+    _In_ size_t Size
+    )
+{
+    if (m_writeToStdout)
+    {
+        fwrite(Data, sizeof(char), Size, stdout);
+        FlushStdOut();
+    }
+
+    if (m_fileSink)
+    {
+        ReportFileSinkStatus(m_fileSink->Write(Data, Size));
+    }
+}
+
+///
+/// Writes the lines that the file sink keeps in its current compressed
+/// block. Called under m_stdoutLock.
+///
+void
+LogWriter::FlushFileSink()
+{
+    if (m_fileSink)
+    {
+        ReportFileSinkStatus(m_fileSink->Flush());
+    }
+}
+
+///
+/// \return Time until the current compressed block of the file sink should
+///     be written, or INFINITE if there is none.
+///
+DWORD
+LogWriter::GetFileSinkFlushDelay()
+{
+    DWORD delay = INFINITE;
+
+    if (m_fileSink)
+    {
+        AcquireSRWLockShared(&m_stdoutLock);
+        delay = m_fileSink->GetMillisUntilFlush();
+        ReleaseSRWLockShared(&m_stdoutLock);
+    }
+
+    return delay;
+}
+
+///
+/// Writes the current compressed block of the file sink if it's older than
+/// the max block age.
+///
+void
+LogWriter::FlushDueFileSink()
+{
+    if (m_fileSink)
+    {
+        AcquireSRWLockExclusive(&m_stdoutLock);
+
+        if (m_fileSink->GetMillisUntilFlush() == 0)
+        {
+            FlushFileSink();
+        }
+
+        ReleaseSRWLockExclusive(&m_stdoutLock);
+    }
+}
+
+///
+/// An error of the file sink is written to stdout when it differs from the
+/// previous write, so a full disk doesn't write an error per batch.
+///
+void
+LogWriter::ReportFileSinkStatus(
+    _In_ DWORD Status
+    )
+{
+    if (Status != m_fileSinkError)
+    {
+        m_fileSinkError = Status;
+
+        if (Status != ERROR_SUCCESS)
+        {
+            const std::string trace = FormatTrace(
+                "ERROR",
+                FORMAT_STRING(
+                    L"Failed to write to the log file %s. Error: %lu",
+                    m_fileSink->GetPath(),
+                    Status
+                ).c_str());
+
+            fwrite(trace.data(), sizeof(char), trace.size(), stdout);
+            fputc('\n', stdout);
+            FlushStdOut();
+        }
+    }
+}
+
+///
+/// Pushes a line to the ring, and wakes up the writer when needed.
+///
+/// If the ring is full, or the line would exceed the max buffered bytes,
+/// the overflow policy of the source decides what happens:
+///   Block        Waits for the writer to make room.
+///   DropOldest   Drops the oldest lines, if they are from DropOldest
+///                sources. Otherwise drops the line.
+///   DropNewest   Drops the line.
+///   Sample       Waits for one line out of the sample rate, and drops the
+///                others.
+///
+void
+LogWriter::PushLine(
+    _Inout_ std::string& LogMessage,
+    _In_ UINT32 SourceId
+    )
+{
+    if (SourceId >= m_sourceCount.load(std::memory_order_relaxed))
+    {
+        SourceId = LOGMONITOR_SOURCE_ID;
+    }
+
+    OutputSource& source = m_sources[SourceId];
+    const size_t size = LogMessage.size();
+    DWORD attempts = 0;
+
+    for (;;)
+    {
+        if (TryReserve(size))
+        {
+            if (m_ring->TryPush(LogMessage, SourceId))
+            {
+                break;
+            }
+
+            m_bufferedBytes -= size;
+        }
+
+        if (attempts == 0)
+        {
+            if (source.Policy == OverflowPolicy::DropNewest)
+            {
+                DropRecord(source);
+                return;
+            }
+
+            if (source.Policy == OverflowPolicy::DropOldest)
+            {
+                if (EvictOldest(size))
+                {
+                    continue;
+                }
+
+                DropRecord(source);
+                return;
+            }
+
+            if (source.Policy == OverflowPolicy::Sample
+                && (source.Overflows++ % source.SampleRate) != 0)
+            {
+                DropRecord(source);
+                return;
+            }
+        }
+
+        WaitForRoom(size, attempts);
+    }
+
+    //
+    // Wake up the writer for the first line after it went idle, to start
+    // the batch window, and when the ring gets half full, to end it early.
+    // Other lines don't make any system call. The fence pairs with the one
+    // of the writer, so either it sees this line or this sees it idle.
+    //
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    if (m_writerIdle.load(std::memory_order_relaxed) && m_writerIdle.exchange(false))
+    {
+        SetEvent(m_wakeEvent);
+    }
+    else if (m_ring->ApproximateSize() >= m_ring->Capacity() / 2
+        && !m_batchSignaled.load(std::memory_order_relaxed)
+        && !m_batchSignaled.exchange(true))
+    {
+        SetEvent(m_wakeEvent);
+    }
+}
+
+///
+/// Charges the size of a line to the max buffered bytes. A line is always
+/// accepted when no other line is buffered, even if it's larger.
+///
+/// \return False if the line doesn't fit.
+///
+bool
+LogWriter::TryReserve(
+    _In_ size_t Size
+    )
+{
+    size_t current = m_bufferedBytes.load(std::memory_order_relaxed);
+
+    do
+    {
+        if (current != 0 && current + Size > m_maxBufferedBytes)
+        {
+            return false;
+        }
+    } while (!m_bufferedBytes.compare_exchange_weak(current, current + Size));
+
+    return true;
+}
+
+///
+/// Drops the lines at the head of the ring, while they are from sources
+/// with the DropOldest policy, until there's room for a line.
+///
+/// \param Size     Size of the line to make room for.
+///
+/// \return True if at least a line was dropped.
+///
+bool
+LogWriter::EvictOldest(
+    _In_ size_t Size
+    )
+{
+    bool evicted = false;
+    UINT32 sourceId;
+
+    AcquireSRWLockExclusive(&m_dequeueLock);
+
+    while (m_ring->TryPeekSourceId(sourceId)
+        && m_sources[sourceId].Policy == OverflowPolicy::DropOldest
+        && m_ring->TryPop(m_evictedRecord))
+    {
+        m_bufferedBytes -= m_evictedRecord.size();
+        m_recordsEvicted++;
+
+        DropRecord(m_sources[sourceId]);
+        evicted = true;
+
+        if (m_bufferedBytes.load() + Size <= m_maxBufferedBytes
+            && m_ring->ApproximateSize() < m_ring->Capacity())
+        {
+            break;
+        }
+    }
+
+    if (m_evictedRecord.capacity() > MAX_RECYCLED_RECORD_BYTES)
+    {
+        std::string().swap(m_evictedRecord);
+    }
+
+    ReleaseSRWLockExclusive(&m_dequeueLock);
+
+    if (evicted)
+    {
+        WakeRoomWaiters();
+    }
+
+    //
+    // The dropped lines count as written for Flush.
+    //
+    if (evicted && m_flushRequests.load() > 0)
+    {
+        AcquireSRWLockExclusive(&m_flushLock);
+        ReleaseSRWLockExclusive(&m_flushLock);
+        WakeAllConditionVariable(&m_flushed);
+    }
+
+    return evicted;
+}
+
+void
+LogWriter::DropRecord(
+    _In_ OutputSource& Source
+    )
+{
+    Source.Dropped++;
+    m_droppedRecords++;
+}
+
+///
+/// Checks whether a line fits in the ring and in the max buffered bytes.
+///
+bool
+LogWriter::HasRoom(
+    _In_ size_t Size
+    ) const
+{
+    const size_t bufferedBytes = m_bufferedBytes.load();
+
+    return (bufferedBytes == 0 || bufferedBytes + Size <= m_maxBufferedBytes)
+        && m_ring->ApproximateSize() < m_ring->Capacity();
+}
+
+///
+/// Wakes up the writer, and waits until it removed lines from the ring.
+///
+/// \param Size         Size of the line to make room for.
+/// \param Attempts     Number of waits for the line, incremented.
+///
+void
+LogWriter::WaitForRoom(
+    _In_ size_t Size,
+    _Inout_ DWORD& Attempts
+    )
+{
+    if (Attempts++ == 0)
+    {
+        m_fullRingWaits++;
+    }
+
+    m_roomWaiters++;
+
+    SetEvent(m_wakeEvent);
+
+    //
+    // The room is checked after the waiter is counted, and the writer
+    // counts the waiters after it made room, so the wake up isn't missed.
+    //
+    AcquireSRWLockExclusive(&m_producerLock);
+
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    if (!HasRoom(Size))
+    {
+        SleepConditionVariableSRW(&m_roomAvailable, &m_producerLock, MAX_ROOM_WAIT_MILLIS, 0);
+    }
+
+    ReleaseSRWLockExclusive(&m_producerLock);
+
+    m_roomWaiters--;
+}
+
+///
+/// Wakes up the producers waiting for room, after lines were removed from
+/// the ring.
+///
+void
+LogWriter::WakeRoomWaiters()
+{
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    if (m_roomWaiters.load(std::memory_order_relaxed) != 0)
+    {
+        AcquireSRWLockExclusive(&m_producerLock);
+        ReleaseSRWLockExclusive(&m_producerLock);
+        WakeAllConditionVariable(&m_roomAvailable);
+    }
+}
+
+///
+/// Ends the call of a producer. The last one wakes up Stop, if it's
+/// waiting for the producers to finish.
+///
+void
+LogWriter::LeaveProducer()
+{
+    if (--m_activeProducers == 0 && !m_asynchronous.load())
+    {
+        AcquireSRWLockExclusive(&m_producerLock);
+        ReleaseSRWLockExclusive(&m_producerLock);
+        WakeAllConditionVariable(&m_producersDone);
+    }
+}
+
+///
+/// Writes a warning for each source that had lines dropped, or suppressed
+/// by its rate limit, since the last report. The warnings bypass the ring,
+/// so they are never dropped themselves: they are written synchronously to
+/// the network sink if there is one, and to the file sink, or to stdout
+/// when there is no file sink.
+///
+/// \param Force    Report even if the report interval hasn't elapsed.
+///
+void
+LogWriter::ReportDroppedRecords(
+    _In_ bool Force
+    )
+{
+    const ULONGLONG now = GetTickCount64();
+
+    if (!Force && now - m_lastDropReportTime < m_dropReportIntervalMillis)
+    {
+        return;
+    }
+
+    const ULONGLONG elapsedSeconds = (std::max)((now - m_lastDropReportTime + 500) / 1000, 1ULL);
+    m_lastDropReportTime = now;
+
+    const UINT32 count = m_sourceCount.load();
+
+    for (UINT32 i = 0; i < count; i++)
+    {
+        OutputSource& source = m_sources[i];
+        const UINT64 suppressed = source.Suppressed.load();
+
+        if (suppressed != source.ReportedSuppressed)
+        {
+            std::wstring message = FORMAT_STRING(
+                L"%llu lines suppressed from source '%s' in the last %llu seconds. Rate limit: %lu lines per second.",
+                suppressed - source.ReportedSuppressed,
+                source.Name.c_str(),
+                elapsedSeconds,
+                source.RateLimit.GetRecordsPerSecond());
+
+            WriteLineSynchronous(FormatTrace("WARNING", message.c_str()));
+
+            source.ReportedSuppressed = suppressed;
+        }
+
+        const UINT64 dropped = source.Dropped.load();
+
+        if (dropped == source.ReportedDropped)
+        {
+            continue;
+        }
+
+        std::wstring message = FORMAT_STRING(
+            L"Dropped %llu lines of source '%s' in the last %llu seconds. Overflow policy: %s.",
+            dropped - source.ReportedDropped,
+            source.Name.c_str(),
+            elapsedSeconds,
+            OverflowPolicyNames[static_cast<int>(source.Policy)]);
+
+        WriteLineSynchronous(FormatTrace("WARNING", message.c_str()));
+
+        source.ReportedDropped = dropped;
+    }
+}
+
+///
+/// Formats a LogMonitor trace in the output format.
+///
+/// \param Level    ERROR, WARNING or INFO.
+/// \param Message  The message of the trace.
+///
+/// \return The UTF-8 line.
+///
+std::string
+LogWriter::FormatTrace(
+    _In_z_ const char* Level,
+    _In_ LPCWSTR Message
+    ) const
+{
+    FILETIME now;
+    GetSystemTimePreciseAsFileTime(&now);
+
+    if (m_outputFormat == OutputFormat::Json)
+    {
+        std::string line;
+        JsonLineWriter json(line);
+
+        json.BeginObject();
+        json.Key("Source");
+        json.String("LogMonitor");
+        json.Key("LogEntry");
+        json.BeginObject();
+        json.Key("Time");
+        json.Time(now);
+        json.Key("Level");
+        json.String(Level);
+        json.Key("Message");
+        json.String(Message);
+        json.EndObject();
+        json.EndObject();
+
+        return line;
+    }
+
+    return Utility::WideToUtf8(
+        FORMAT_STRING(L"[%s][LOGMONITOR] %S: %s",
+            Utility::FileTimeToString(now),
+            Level,
+            Message));
+}
+
+DWORD
+LogWriter::WriterThreadStatic(
+    _In_ LPVOID Context
+    )
+{
+    reinterpret_cast<LogWriter*>(Context)->WriterThread();
+
+    return ERROR_SUCCESS;
+}
+
+void
+LogWriter::WriterThread()
+{
+    for (;;)
+    {
+        WriteBatch();
+        ReportDroppedRecords(false);
+
+        if (m_stopping && m_ring->ApproximateSize() == 0)
+        {
+            break;
+        }
+
+        //
+        // Check the ring again once the producers can see the writer is
+        // idle, so a line pushed meanwhile isn't left behind.
+        //
+        m_writerIdle = true;
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        if (m_ring->ApproximateSize() != 0 || m_stopping)
+        {
+            m_writerIdle = false;
+            continue;
+        }
+
+        //
+        // Wake up at the report interval, so the dropped lines are reported
+        // even if no other line is written, and when the current compressed
+        // block of the file sink gets too old, so the last lines of a quiet
+        // source don't stay in memory.
+        //
+        const DWORD waitMillis = (std::min)(m_dropReportIntervalMillis, GetFileSinkFlushDelay());
+        const DWORD waitResult = WaitForSingleObject(m_wakeEvent, waitMillis);
+
+        m_writerIdle = false;
+
+        if (waitResult == WAIT_TIMEOUT)
+        {
+            FlushDueFileSink();
+            continue;
+        }
+
+        //
+        // Group commit: give the other producers up to the flush latency
+        // to add lines to the batch.
+        //
+        if (m_flushLatencyMillis > 0
+            && !m_stopping
+            && m_flushRequests.load() == 0
+            && m_ring->ApproximateSize() < m_ring->Capacity() / 2)
+        {
+            WaitForSingleObject(m_wakeEvent, m_flushLatencyMillis);
+        }
+    }
+
+    WriteBatch();
+    ReportDroppedRecords(true);
+}
+
+///
+/// Writes the lines in the ring, with one write and one flush for every
+/// MAX_BATCH_BYTES bytes, to stdout and to the file sink.
+///
+/// The ring is only read under m_dequeueLock, which isn't held while
+/// writing, so the producers can drop lines meanwhile.
+///
+void
+LogWriter::WriteBatch()
+{
+    bool more = true;
+
+    while (more)
+    {
+        UINT64 count = 0;
+
+        m_batch.clear();
+
+        AcquireSRWLockExclusive(&m_dequeueLock);
+
+        while ((more = m_ring->TryPop(m_record)) == true)
+        {
+            m_bufferedBytes -= m_record.size();
+
+            //
+            // The network sink frames each line on its own, as a line can
+            // have line breaks.
+            //
+            if (m_networkSink)
+            {
+                m_networkSink->Append(m_record.data(), m_record.size());
+            }
+
+            m_batch += m_record;
+            m_batch += '\n';
+            count++;
+
+            if (m_record.capacity() > MAX_RECYCLED_RECORD_BYTES)
+            {
+                std::string().swap(m_record);
+            }
+
+            if (m_batch.size() >= MAX_BATCH_BYTES)
+            {
+                break;
+            }
+        }
+
+        ReleaseSRWLockExclusive(&m_dequeueLock);
+
+        if (count > 0)
+        {
+            WakeRoomWaiters();
+        }
+
+        m_batchSignaled = false;
+
+        if (count > 0)
+        {
+            AcquireSRWLockExclusive(&m_stdoutLock);
+
+            WriteOutput(m_batch.data(), m_batch.size());
+
+            ReleaseSRWLockExclusive(&m_stdoutLock);
+
+            m_recordsWritten += count;
+            m_batches++;
+        }
+    }
+
+    //
+    // A batch only exceeds MAX_BATCH_BYTES with a very long line. Don't keep
+    // its memory.
+    //
+    if (m_batch.capacity() > 2 * MAX_BATCH_BYTES)
+    {
+        std::string().swap(m_batch);
+    }
+
+    if (m_flushRequests.load() > 0)
+    {
+        AcquireSRWLockExclusive(&m_flushLock);
+        ReleaseSRWLockExclusive(&m_flushLock);
+        WakeAllConditionVariable(&m_flushed);
+    }
+}
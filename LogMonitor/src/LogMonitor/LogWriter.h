@@ -1,128 +1,444 @@
-//
-// Copyright (c) Microsoft Corporation.
-// Licensed under the MIT license.
-//
-
-#pragma once
-
-class LogWriter final
-{
-public:
-    LogWriter()
-    {
-        InitializeSRWLock(&m_stdoutLock);
-
-        DWORD dwMode;
-
-        if (!GetConsoleMode(GetStdHandle(STD_OUTPUT_HANDLE), &dwMode))
-        {
-            m_isConsole = false;
-        }
-
-        m_isConsole = true;
-
-        _setmode(_fileno(stdout), _O_U8TEXT);
-    };
-
-    ~LogWriter() {}
-
-private:
-    SRWLOCK m_stdoutLock;
-    bool m_isConsole;
-
-    void FlushStdOut()
-    {
-        if (m_isConsole)
-        {
-            fflush(stdout);
-        }
-    }
-
-public :
-    bool WriteLog(
-        _In_ HANDLE       FileHandle,
-        _In_ LPCVOID      Buffer,
-        _In_ DWORD        NumberOfBytesToWrite,
-        _In_ LPDWORD      NumberOfBytesWritten,
-        _In_ LPOVERLAPPED Overlapped
-    )
-    {
-        bool result;
-
-        AcquireSRWLockExclusive(&m_stdoutLock);
-
-        result = WriteFile(FileHandle, Buffer, NumberOfBytesToWrite, NumberOfBytesWritten, Overlapped);
-
-        ReleaseSRWLockExclusive(&m_stdoutLock);
-
-        return result;
-    }
-
-    void WriteConsoleLog(
-        _In_ const std::wstring&& LogMessage
-    )
-    {
-        AcquireSRWLockExclusive(&m_stdoutLock);
-
-        wprintf(L"%s\n", LogMessage.c_str());
-        FlushStdOut();
-
-        ReleaseSRWLockExclusive(&m_stdoutLock);
-    }
-
-    void WriteConsoleLog(
-        _In_ const std::wstring& LogMessage
-    )
-    {
-        AcquireSRWLockExclusive(&m_stdoutLock);
-
-        wprintf(L"%s\n", LogMessage.c_str());
-        FlushStdOut();
-
-        ReleaseSRWLockExclusive(&m_stdoutLock);
-    }
-
-    void TraceError(
-        _In_ LPCWSTR Message
-    )
-    {
-        SYSTEMTIME st;
-        GetSystemTime(&st);
-
-        std::wstring formattedMessage = Utility::FormatString(L"[%s][LOGMONITOR] ERROR: %s",
-            Utility::SystemTimeToString(st).c_str(),
-            Message);
-
-        WriteConsoleLog(formattedMessage);
-    }
-
-    void TraceWarning(
-        _In_ LPCWSTR Message
-    )
-    {
-        SYSTEMTIME st;
-        GetSystemTime(&st);
-
-        std::wstring formattedMessage = Utility::FormatString(L"[%s][LOGMONITOR] WARNING: %s",
-            Utility::SystemTimeToString(st).c_str(),
-            Message);
-
-        WriteConsoleLog(formattedMessage);
-    }
-
-    void TraceInfo(
-        _In_ LPCWSTR Message
-    )
-    {
-        SYSTEMTIME st;
-        GetSystemTime(&st);
-
-        std::wstring formattedMessage = Utility::FormatString(L"[%s][LOGMONITOR] INFO: %s",
-            Utility::SystemTimeToString(st).c_str(),
-            Message);
-
-        WriteConsoleLog(formattedMessage);
-    }
-};
-
-extern LogWriter logWriter;
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+
+#pragma once
+
+///
+/// Writes the log lines of all the sources to stdout.
+///
+/// The lines are written in UTF-8, with stdout in binary mode, so a line
+/// that is already UTF-8 is written as it is. Lines passed as wstrings are
+/// transcoded once, before they are queued.
+///
+/// Until Start is called, and after Stop, each line is written and flushed
+/// by the calling thread. Once started, the lines are pushed to a
+/// LogRecordRing and a writer thread writes them in batches, with one write
+/// and one flush per batch. The writer waits up to the flush latency after
+/// the first line of a batch before writing it, or less if the ring gets
+/// half full.
+///
+/// The memory used by the lines waiting to be written is bounded by the
+/// max buffered bytes budget. When a line doesn't fit, the overflow policy
+/// of its source decides whether the producer waits, or a line is dropped.
+///
+/// A source can also have a rate limit, a TokenBucket checked before its
+/// line is queued, so a source that writes too fast doesn't use all the
+/// output. The lines over the limit are suppressed without waiting.
+///
+/// The writer thread periodically reports the lines dropped and suppressed
+/// per source.
+///
+/// The output format is chosen before the monitors start. In the JSON
+/// format, the sources write JSON objects, and the LogMonitor traces are
+/// written as JSON objects too.
+///
+/// The lines can also be written to a RotatingFileSink, batch by batch, and
+/// sent to a log collector by a NetworkSink, line by line, in addition to
+/// stdout or instead of it.
+///
+class LogWriter final
+{
+public:
+    static constexpr DWORD DEFAULT_FLUSH_LATENCY_MILLIS = 10;
+    static constexpr DWORD MAX_FLUSH_LATENCY_MILLIS = 1000;
+
+    //
+    // A batch is written once it reaches this size, even if the ring has
+    // more lines.
+    //
+    static constexpr size_t MAX_BATCH_BYTES = 64 * 1024;
+
+    static constexpr size_t DEFAULT_MAX_BUFFERED_BYTES = 16 * 1024 * 1024;
+    static constexpr DWORD DEFAULT_DROP_REPORT_INTERVAL_SECONDS = 60;
+
+    //
+    // Maximum number of sources, including the LogMonitor traces. The lines
+    // of the sources registered past it are written as LogMonitor lines.
+    //
+    static constexpr UINT32 MAX_SOURCES = 64;
+    static constexpr UINT32 LOGMONITOR_SOURCE_ID = 0;
+
+    //
+    // Record buffers larger than this are released by the writer thread
+    // instead of being recycled through the ring, so the idle slots don't
+    // keep the memory of the longest lines.
+    //
+    static constexpr size_t MAX_RECYCLED_RECORD_BYTES = 1024;
+
+    //
+    // A producer waiting for room checks the ring again at least this
+    // often, as the size of the ring is only a hint.
+    //
+    static constexpr DWORD MAX_ROOM_WAIT_MILLIS = 10;
+
+    struct Statistics
+    {
+        UINT64 RecordsWritten = 0;
+        UINT64 Batches = 0;
+        UINT64 FullRingWaits = 0;
+        UINT64 DroppedRecords = 0;
+        UINT64 SuppressedRecords = 0;
+    };
+
+    LogWriter()
+    {
+        InitializeSRWLock(&m_stdoutLock);
+        InitializeSRWLock(&m_flushLock);
+        InitializeSRWLock(&m_dequeueLock);
+        InitializeSRWLock(&m_sourcesLock);
+        InitializeSRWLock(&m_producerLock);
+        InitializeConditionVariable(&m_flushed);
+        InitializeConditionVariable(&m_roomAvailable);
+        InitializeConditionVariable(&m_producersDone);
+
+        m_sources[LOGMONITOR_SOURCE_ID].Name = L"LogMonitor";
+
+        DWORD dwMode;
+
+        if (!GetConsoleMode(GetStdHandle(STD_OUTPUT_HANDLE), &dwMode))
+        {
+            m_isConsole = false;
+        }
+
+        m_isConsole = true;
+
+        if (GetFileType(GetStdHandle(STD_OUTPUT_HANDLE)) == FILE_TYPE_CHAR)
+        {
+            SetConsoleOutputCP(CP_UTF8);
+        }
+
+        _setmode(_fileno(stdout), _O_BINARY);
+    };
+
+    ~LogWriter()
+    {
+        Stop();
+    }
+
+    LogWriter(const LogWriter&) = delete;
+    LogWriter& operator=(const LogWriter&) = delete;
+
+    bool Start(
+        _In_ DWORD FlushLatencyMillis = DEFAULT_FLUSH_LATENCY_MILLIS,
+        _In_ size_t RingCapacity = LogRecordRing::DEFAULT_CAPACITY,
+        _In_ size_t MaxBufferedBytes = DEFAULT_MAX_BUFFERED_BYTES,
+        _In_ DWORD DropReportIntervalSeconds = DEFAULT_DROP_REPORT_INTERVAL_SECONDS
+        );
+
+    void Stop();
+
+    void Flush();
+
+    Statistics GetStatistics() const;
+
+    UINT32 RegisterSource(
+        _In_ const std::wstring& Name,
+        _In_ OverflowPolicy Policy,
+        _In_ DWORD SampleRate,
+        _In_ DWORD RateLimit = 0,
+        _In_ DWORD RateLimitBurst = 0
+        );
+
+    UINT64 GetDroppedRecords(
+        _In_ UINT32 SourceId
+        ) const;
+
+    UINT64 GetSuppressedRecords(
+        _In_ UINT32 SourceId
+        ) const;
+
+    void SetOutputFormat(
+        _In_ OutputFormat Format
+        )
+    {
+        m_outputFormat = Format;
+    }
+
+    OutputFormat GetOutputFormat() const
+    {
+        return m_outputFormat;
+    }
+
+    void SetFileSink(
+        _In_ std::unique_ptr<RotatingFileSink> Sink,
+        _In_ bool WriteToStdout
+        );
+
+    void SetNetworkSink(
+        _In_ std::unique_ptr<NetworkSink> Sink,
+        _In_ bool WriteToStdout
+        );
+
+    const NetworkSink* GetNetworkSink() const
+    {
+        return m_networkSink.get();
+    }
+
+private:
+    struct OutputSource
+    {
+        std::wstring Name;
+        OverflowPolicy Policy = OverflowPolicy::Block;
+        DWORD SampleRate = 1;
+
+        //
+        // Lines that didn't fit in the budget, used to pick the sampled ones.
+        //
+        std::atomic<UINT64> Overflows{ 0 };
+        std::atomic<UINT64> Dropped{ 0 };
+
+        TokenBucket RateLimit;
+
+        //
+        // Lines over the rate limit.
+        //
+        std::atomic<UINT64> Suppressed{ 0 };
+
+        //
+        // Values of Dropped and Suppressed in the last report. Used by the
+        // writer thread only.
+        //
+        UINT64 ReportedDropped = 0;
+        UINT64 ReportedSuppressed = 0;
+    };
+
+    SRWLOCK m_stdoutLock;
+    bool m_isConsole;
+
+    OutputFormat m_outputFormat = OutputFormat::Xml;
+
+    //
+    // Used under m_stdoutLock, which serializes all the output.
+    //
+    std::unique_ptr<RotatingFileSink> m_fileSink;
+    bool m_writeToStdout = true;
+    DWORD m_fileSinkError = ERROR_SUCCESS;
+
+    //
+    // Set before the writer thread is started. Its Append is thread safe,
+    // and never blocks on the network.
+    //
+    std::unique_ptr<NetworkSink> m_networkSink;
+
+    OutputSource m_sources[MAX_SOURCES];
+    std::atomic<UINT32> m_sourceCount{ 1 };
+    SRWLOCK m_sourcesLock;
+
+    size_t m_maxBufferedBytes = DEFAULT_MAX_BUFFERED_BYTES;
+
+    //
+    // Size of the lines in the ring.
+    //
+    std::atomic<size_t> m_bufferedBytes{ 0 };
+
+    //
+    // Serializes TryPop between the writer thread and the producers that
+    // evict the oldest lines for the DropOldest policy.
+    //
+    SRWLOCK m_dequeueLock;
+    std::string m_evictedRecord;
+
+    DWORD m_dropReportIntervalMillis = DEFAULT_DROP_REPORT_INTERVAL_SECONDS * 1000;
+    ULONGLONG m_lastDropReportTime = 0;
+
+    std::unique_ptr<LogRecordRing> m_ring;
+    HANDLE m_writerThread = NULL;
+
+    //
+    // Auto-reset event that wakes up the writer thread.
+    //
+    HANDLE m_wakeEvent = NULL;
+
+    DWORD m_flushLatencyMillis = DEFAULT_FLUSH_LATENCY_MILLIS;
+
+    //
+    // True while the lines are written by the writer thread.
+    //
+    std::atomic<bool> m_asynchronous{ false };
+
+    //
+    // Number of threads that are pushing a line to the ring. Stop waits
+    // on m_producersDone until they finish, before it stops the writer.
+    //
+    std::atomic<LONG> m_activeProducers{ 0 };
+
+    //
+    // Number of producers waiting on m_roomAvailable, that the writer
+    // signals after it removed lines from the ring.
+    //
+    std::atomic<LONG> m_roomWaiters{ 0 };
+
+    SRWLOCK m_producerLock;
+    CONDITION_VARIABLE m_roomAvailable;
+    CONDITION_VARIABLE m_producersDone;
+
+    std::atomic<bool> m_writerIdle{ false };
+    std::atomic<bool> m_batchSignaled{ false };
+    std::atomic<bool> m_stopping{ false };
+    std::atomic<LONG> m_flushRequests{ 0 };
+
+    std::atomic<UINT64> m_recordsWritten{ 0 };
+    std::atomic<UINT64> m_recordsEvicted{ 0 };
+    std::atomic<UINT64> m_batches{ 0 };
+    std::atomic<UINT64> m_fullRingWaits{ 0 };
+    std::atomic<UINT64> m_droppedRecords{ 0 };
+    std::atomic<UINT64> m_suppressedRecords{ 0 };
+
+    //
+    // Flush waits on m_flushed until the lines written or evicted reach the
+    // ring position it saw.
+    //
+    SRWLOCK m_flushLock;
+    CONDITION_VARIABLE m_flushed;
+
+    //
+    // Used by the writer thread only.
+    //
+    std::string m_batch;
+    std::string m_record;
+
+    void FlushStdOut()
+    {
+        if (m_isConsole)
+        {
+            fflush(stdout);
+        }
+    }
+
+    bool IsRateLimited(
+        _In_ UINT32 SourceId
+        );
+
+    void WriteLine(
+        _Inout_ std::string& LogMessage,
+        _In_ UINT32 SourceId
+        );
+
+    void WriteLineSynchronous(
+        _In_ const std::string& LogMessage
+        );
+
+    void WriteOutput(
+        _In_reads_bytes_(Size) const char* Data,
+        _In_ size_t Size
+        );
+
+    void FlushFileSink();
+
+    DWORD GetFileSinkFlushDelay();
+
+    void FlushDueFileSink();
+
+    void ReportFileSinkStatus(
+        _In_ DWORD Status
+        );
+
+    void PushLine(
+        _Inout_ std::string& LogMessage,
+        _In_ UINT32 SourceId
+        );
+
+    bool TryReserve(
+        _In_ size_t Size
+        );
+
+    bool EvictOldest(
+        _In_ size_t Size
+        );
+
+    void DropRecord(
+        _In_ OutputSource& Source
+        );
+
+    bool HasRoom(
+        _In_ size_t Size
+        ) const;
+
+    void WaitForRoom(
+        _In_ size_t Size,
+        _Inout_ DWORD& Attempts
+        );
+
+    void WakeRoomWaiters();
+
+    void LeaveProducer();
+
+    void ReportDroppedRecords(
+        _In_ bool Force
+        );
+
+    std::string FormatTrace(
+        _In_z_ const char* Level,
+        _In_ LPCWSTR Message
+        ) const;
+
+    static DWORD WriterThreadStatic(
+        _In_ LPVOID Context
+        );
+
+    void WriterThread();
+
+    void StopWriterThread();
+
+    void WriteBatch();
+
+public :
+    bool WriteLog(
+        _In_ HANDLE       FileHandle,
+        _In_ LPCVOID      Buffer,
+        _In_ DWORD        NumberOfBytesToWrite,
+        _In_ LPDWORD      NumberOfBytesWritten,
+        _In_ LPOVERLAPPED Overlapped
+    )
+    {
+        bool result;
+
+        AcquireSRWLockExclusive(&m_stdoutLock);
+
+        result = WriteFile(FileHandle, Buffer, NumberOfBytesToWrite, NumberOfBytesWritten, Overlapped);
+
+        ReleaseSRWLockExclusive(&m_stdoutLock);
+
+        return result;
+    }
+
+    void WriteConsoleLog(
+        _Inout_ std::string&& LogMessage,
+        _In_ UINT32 SourceId = LOGMONITOR_SOURCE_ID
+    );
+
+    void WriteConsoleLog(
+        _In_ const std::string& LogMessage,
+        _In_ UINT32 SourceId = LOGMONITOR_SOURCE_ID
+    );
+
+    void WriteConsoleLog(
+        _In_ const std::wstring& LogMessage,
+        _In_ UINT32 SourceId = LOGMONITOR_SOURCE_ID
+    );
+
+    void TraceError(
+        _In_ LPCWSTR Message
+    )
+    {
+        WriteConsoleLog(FormatTrace("ERROR", Message));
+    }
+
+    void TraceWarning(
+        _In_ LPCWSTR Message
+    )
+    {
+        WriteConsoleLog(FormatTrace("WARNING", Message));
+    }
+
+    void TraceInfo(
+        _In_ LPCWSTR Message
+    )
+    {
+        WriteConsoleLog(FormatTrace("INFO", Message));
+    }
+};
+
+extern LogWriter logWriter;
@@ -0,0 +1,166 @@
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+
+#pragma once
+
+///
+/// Bounded cache that evicts the least recently used entry when it's full.
+///
+/// The OnEvict callback is invoked for every entry that leaves the cache,
+/// because of an eviction, Remove, Clear or the destruction of the cache, so
+/// it can be used to release resources owned by the values.
+///
+/// The cache isn't thread safe.
+///
+template <typename Key, typename Value, typename Hash = std::hash<Key>, typename KeyEqual = std::equal_to<Key>>
+class LruCache final
+{
+public:
+    typedef std::function<void(const Key& EntryKey, Value& EntryValue)> EvictCallback;
+
+    LruCache(
+        _In_ size_t Capacity,
+        _In_ EvictCallback OnEvict = nullptr
+        ) :
+        m_capacity(Capacity > 0 ? Capacity : 1),
+        m_onEvict(std::move(OnEvict))
+    {
+    }
+
+    LruCache(const LruCache&) = delete;
+    LruCache& operator=(const LruCache&) = delete;
+
+    ~LruCache()
+    {
+        Clear();
+    }
+
+    ///
+    /// Looks for an entry, and marks it as the most recently used.
+    ///
+    /// \return A pointer to the value, valid until the entry is evicted or
+    ///     removed. nullptr if the key isn't in the cache.
+    ///
+    Value* Find(
+        _In_ const Key& EntryKey
+        )
+    {
+        auto it = m_index.find(EntryKey);
+        if (it == m_index.end())
+        {
+            m_misses++;
+            return nullptr;
+        }
+
+        m_hits++;
+        m_entries.splice(m_entries.begin(), m_entries, it->second);
+
+        return &it->second->second;
+    }
+
+    ///
+    /// Inserts or replaces an entry, as the most recently used. If the cache
+    /// is full, the least recently used entry is evicted.
+    ///
+    void Insert(
+        _In_ const Key& EntryKey,
+        _In_ Value EntryValue
+        )
+    {
+        Remove(EntryKey);
+
+        if (m_entries.size() >= m_capacity)
+        {
+            m_evictions++;
+            EvictEntry(std::prev(m_entries.end()));
+        }
+
+        m_entries.emplace_front(EntryKey, std::move(EntryValue));
+        m_index[EntryKey] = m_entries.begin();
+    }
+
+    ///
+    /// \return True if the key was in the cache.
+    ///
+    bool Remove(
+        _In_ const Key& EntryKey
+        )
+    {
+        auto it = m_index.find(EntryKey);
+        if (it == m_index.end())
+        {
+            return false;
+        }
+
+        EvictEntry(it->second);
+
+        return true;
+    }
+
+    void Clear()
+    {
+        while (!m_entries.empty())
+        {
+            EvictEntry(m_entries.begin());
+        }
+    }
+
+    size_t Size() const
+    {
+        return m_entries.size();
+    }
+
+    size_t Capacity() const
+    {
+        return m_capacity;
+    }
+
+    UINT64 Hits() const
+    {
+        return m_hits;
+    }
+
+    UINT64 Misses() const
+    {
+        return m_misses;
+    }
+
+    UINT64 Evictions() const
+    {
+        return m_evictions;
+    }
+
+private:
+    typedef std::list<std::pair<Key, Value>> EntryList;
+
+    //
+    // Entries ordered from the most to the least recently used.
+    //
+    EntryList m_entries;
+
+    std::unordered_map<Key, typename EntryList::iterator, Hash, KeyEqual> m_index;
+
+    size_t m_capacity;
+
+    EvictCallback m_onEvict;
+
+    UINT64 m_hits = 0;
+    UINT64 m_misses = 0;
+    UINT64 m_evictions = 0;
+
+    void EvictEntry(
+        _In_ typename EntryList::iterator Entry
+        )
+    {
+        m_index.erase(Entry->first);
+
+        if (m_onEvict)
+        {
+            m_onEvict(Entry->first, Entry->second);
+        }
+
+        m_entries.erase(Entry);
+    }
+};
@@ -0,0 +1,27 @@
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+
+#include "pch.h"
+
+///
+/// Creates the codec of a block header.
+///
+/// \return The codec, or nullptr for CompressionCodec::None or an unknown
+///     codec.
+///
+std::unique_ptr<BlockCodec>
+BlockCodec::Create(
+    _In_ CompressionCodec Codec
+    )
+{
+    switch (Codec)
+    {
+        case CompressionCodec::Lz4:
+            return std::make_unique<Lz4BlockCodec>();
+
+        default:
+            return nullptr;
+    }
+}
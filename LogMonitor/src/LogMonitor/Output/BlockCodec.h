@@ -0,0 +1,68 @@
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+
+#pragma once
+
+///
+/// Codec of the blocks of a compressed output file. The values are written
+/// in the block headers, so they can't change.
+///
+enum class CompressionCodec : UINT8
+{
+    None = 0,
+
+    //
+    // LZ4 block format. Fast, with a ratio of about 3 to 6 on log lines.
+    //
+    Lz4
+};
+
+///
+/// Compresses and decompresses independent blocks of bytes. A block holds
+/// all the context needed to decompress it, so a reader can start at any
+/// block.
+///
+/// An instance isn't thread safe. It can keep state, like a hash table,
+/// between the blocks to avoid allocating it for each one.
+///
+class BlockCodec
+{
+public:
+    virtual ~BlockCodec() = default;
+
+    virtual CompressionCodec GetId() const = 0;
+
+    ///
+    /// Size of the buffer that Compress needs for a block of the given size.
+    ///
+    virtual size_t GetMaxCompressedSize(
+        _In_ size_t Size
+        ) const = 0;
+
+    ///
+    /// \return The size of the compressed block.
+    ///
+    virtual size_t Compress(
+        _In_reads_bytes_(SourceSize) const char* Source,
+        _In_ size_t SourceSize,
+        _Out_writes_bytes_to_(DestinationCapacity, return) char* Destination,
+        _In_ size_t DestinationCapacity
+        ) = 0;
+
+    ///
+    /// \return True if the block was valid, and decompressed to exactly
+    ///     DestinationSize bytes.
+    ///
+    virtual bool Decompress(
+        _In_reads_bytes_(SourceSize) const char* Source,
+        _In_ size_t SourceSize,
+        _Out_writes_bytes_(DestinationSize) char* Destination,
+        _In_ size_t DestinationSize
+        ) = 0;
+
+    static std::unique_ptr<BlockCodec> Create(
+        _In_ CompressionCodec Codec
+        );
+};
@@ -0,0 +1,469 @@
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+
+#include "pch.h"
+
+constexpr size_t BlockHeader::SIZE;
+constexpr UINT32 BlockHeader::MAGIC;
+constexpr UINT8 BlockHeader::FLAG_STORED;
+
+constexpr size_t BlockSpoolWriter::DEFAULT_BLOCK_BYTES;
+constexpr size_t BlockSpoolWriter::MIN_BLOCK_BYTES;
+constexpr size_t BlockSpoolWriter::MAX_BLOCK_BYTES;
+constexpr DWORD BlockSpoolWriter::DEFAULT_MAX_BLOCK_AGE_MILLIS;
+
+static inline void
+WriteLittleEndian32(
+    _Out_writes_bytes_(4) char* Buffer,
+    _In_ UINT32 Value
+    )
+{
+    for (int i = 0; i < 4; i++)
+    {
+        Buffer[i] = static_cast<char>((Value >> (8 * i)) & 0xFF);
+    }
+}
+
+static inline UINT32
+ReadLittleEndian32(
+    _In_reads_bytes_(4) const char* Buffer
+    )
+{
+    UINT32 value = 0;
+
+    for (int i = 3; i >= 0; i--)
+    {
+        value = (value << 8) | static_cast<UINT8>(Buffer[i]);
+    }
+
+    return value;
+}
+
+void
+BlockHeader::Write(
+    _Out_writes_bytes_(SIZE) char* Buffer
+    ) const
+{
+    WriteLittleEndian32(Buffer, MAGIC);
+    Buffer[4] = static_cast<char>(Codec);
+    Buffer[5] = static_cast<char>(Flags);
+    Buffer[6] = 0;
+    Buffer[7] = 0;
+    WriteLittleEndian32(Buffer + 8, UncompressedSize);
+    WriteLittleEndian32(Buffer + 12, StoredSize);
+}
+
+///
+/// \return False if the buffer isn't a block header.
+///
+bool
+BlockHeader::Parse(
+    _In_reads_bytes_(SIZE) const char* Buffer
+    )
+{
+    if (ReadLittleEndian32(Buffer) != MAGIC)
+    {
+        return false;
+    }
+
+    Codec = static_cast<CompressionCodec>(Buffer[4]);
+    Flags = static_cast<UINT8>(Buffer[5]);
+    UncompressedSize = ReadLittleEndian32(Buffer + 8);
+    StoredSize = ReadLittleEndian32(Buffer + 12);
+
+    return (Flags & FLAG_STORED) == 0 || StoredSize == UncompressedSize;
+}
+
+///
+/// \param Codec                The codec of the blocks.
+/// \param BlockBytes           Size of the lines of a block. Clamped between
+///                             MIN_BLOCK_BYTES and MAX_BLOCK_BYTES. 0 for the
+///                             default.
+/// \param MaxBlockAgeMillis    Time after which a block is compressed even if
+///                             it isn't full. 0 for the default.
+///
+BlockSpoolWriter::BlockSpoolWriter(
+    _In_ std::unique_ptr<BlockCodec> Codec,
+    _In_ size_t BlockBytes,
+    _In_ DWORD MaxBlockAgeMillis
+    ) :
+    m_codec(std::move(Codec)),
+    m_blockBytes(BlockBytes != 0
+        ? (std::max)(MIN_BLOCK_BYTES, (std::min)(BlockBytes, MAX_BLOCK_BYTES))
+        : DEFAULT_BLOCK_BYTES),
+    m_maxBlockAgeMillis(MaxBlockAgeMillis != 0 ? MaxBlockAgeMillis : DEFAULT_MAX_BLOCK_AGE_MILLIS)
+{
+    m_block.reserve(m_blockBytes);
+
+    QueryPerformanceFrequency(&m_frequency);
+}
+
+///
+/// Adds lines to the current block, and appends the blocks that got full to
+/// the output.
+///
+/// \param Data     The lines, each ending with a line break.
+/// \param Size     Size of the lines, in bytes.
+/// \param Output   Returns the compressed blocks, with their header.
+///
+void
+BlockSpoolWriter::Append(
+    _In_reads_bytes_(Size) const char* Data,
+    _In_ size_t Size,
+    _Inout_ std::string& Output
+    )
+{
+    while (Size > 0)
+    {
+        const size_t room = m_blockBytes - m_block.size();
+
+        if (Size < room)
+        {
+            if (m_block.empty())
+            {
+                m_blockStartTime = GetTickCount64();
+            }
+
+            m_block.append(Data, Size);
+            break;
+        }
+
+        //
+        // The block is full. Close it after the last line that fits.
+        //
+        size_t length = room;
+
+        while (length > 0 && Data[length - 1] != '\n')
+        {
+            length--;
+        }
+
+        if (length == 0)
+        {
+            if (!m_block.empty())
+            {
+                Flush(Output);
+                continue;
+            }
+
+            //
+            // A line longer than a block.
+            //
+            const char* lineEnd = static_cast<const char*>(memchr(Data, '\n', Size));
+
+            length = (lineEnd != nullptr) ? (lineEnd - Data + 1) : Size;
+        }
+
+        if (m_block.empty())
+        {
+            CompressBlock(Data, length, Output);
+        }
+        else
+        {
+            m_block.append(Data, length);
+            Flush(Output);
+        }
+
+        Data += length;
+        Size -= length;
+    }
+
+    if (!m_block.empty() && GetTickCount64() - m_blockStartTime >= m_maxBlockAgeMillis)
+    {
+        Flush(Output);
+    }
+}
+
+///
+/// Compresses the current block, even if it isn't full.
+///
+void
+BlockSpoolWriter::Flush(
+    _Inout_ std::string& Output
+    )
+{
+    if (m_block.empty())
+    {
+        return;
+    }
+
+    CompressBlock(m_block.data(), m_block.size(), Output);
+
+    m_block.clear();
+}
+
+///
+/// Time until the current block is older than the max block age, so the
+/// caller can flush it when no other line comes.
+///
+/// \return The time in milliseconds, 0 if the block should be flushed now,
+///     or INFINITE if there is no block.
+///
+DWORD
+BlockSpoolWriter::GetMillisUntilFlush() const
+{
+    if (m_block.empty())
+    {
+        return INFINITE;
+    }
+
+    const ULONGLONG age = GetTickCount64() - m_blockStartTime;
+
+    return (age >= m_maxBlockAgeMillis) ? 0 : static_cast<DWORD>(m_maxBlockAgeMillis - age);
+}
+
+void
+BlockSpoolWriter::CompressBlock(
+    _In_reads_bytes_(Size) const char* Data,
+    _In_ size_t Size,
+    _Inout_ std::string& Output
+    )
+{
+    const size_t headerOffset = Output.size();
+    const size_t capacity = (std::max)(m_codec->GetMaxCompressedSize(Size), Size);
+
+    Output.resize(headerOffset + BlockHeader::SIZE + capacity);
+
+    char* const block = &Output[headerOffset + BlockHeader::SIZE];
+
+    LARGE_INTEGER start;
+    LARGE_INTEGER end;
+
+    QueryPerformanceCounter(&start);
+
+    size_t storedSize = m_codec->Compress(Data, Size, block, capacity);
+
+    QueryPerformanceCounter(&end);
+
+    BlockHeader header;
+    header.Codec = m_codec->GetId();
+    header.UncompressedSize = static_cast<UINT32>(Size);
+
+    if (storedSize == 0 || storedSize >= Size)
+    {
+        memcpy(block, Data, Size);
+        storedSize = Size;
+        header.Flags = BlockHeader::FLAG_STORED;
+    }
+
+    header.StoredSize = static_cast<UINT32>(storedSize);
+    header.Write(&Output[headerOffset]);
+
+    Output.resize(headerOffset + BlockHeader::SIZE + storedSize);
+
+    m_statistics.Blocks++;
+    m_statistics.UncompressedBytes += Size;
+    m_statistics.CompressedBytes += BlockHeader::SIZE + storedSize;
+    m_statistics.CompressMicroseconds +=
+        static_cast<UINT64>(end.QuadPart - start.QuadPart) * 1000000 / m_frequency.QuadPart;
+}
+
+DWORD
+BlockSpoolReader::Open()
+{
+    if (m_file != INVALID_HANDLE_VALUE)
+    {
+        return ERROR_SUCCESS;
+    }
+
+    //
+    // The file can still be written by LogMonitor.
+    //
+    m_file = CreateFileW(
+        m_path.c_str(),
+        GENERIC_READ,
+        FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+        NULL,
+        OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+        NULL);
+
+    if (m_file == INVALID_HANDLE_VALUE)
+    {
+        return GetLastError();
+    }
+
+    return ERROR_SUCCESS;
+}
+
+///
+/// Moves to a block, by skipping the previous blocks without reading them.
+///
+/// \param Index    Index of the block, from the start of the file.
+///
+/// \return ERROR_SUCCESS, ERROR_HANDLE_EOF if the file has fewer blocks,
+///     or ERROR_INVALID_DATA if a header is invalid.
+///
+DWORD
+BlockSpoolReader::SeekToBlock(
+    _In_ UINT64 Index
+    )
+{
+    LARGE_INTEGER distance{};
+
+    if (!SetFilePointerEx(m_file, distance, NULL, FILE_BEGIN))
+    {
+        return GetLastError();
+    }
+
+    for (UINT64 i = 0; i < Index; i++)
+    {
+        BlockHeader header;
+        const DWORD status = ReadHeader(header);
+
+        if (status != ERROR_SUCCESS)
+        {
+            return status;
+        }
+
+        distance.QuadPart = header.StoredSize;
+
+        if (!SetFilePointerEx(m_file, distance, NULL, FILE_CURRENT))
+        {
+            return GetLastError();
+        }
+    }
+
+    return ERROR_SUCCESS;
+}
+
+///
+/// Reads and decompresses the next block.
+///
+/// \param Lines    Returns the lines of the block, each ending with a line
+///                 break.
+///
+/// \return ERROR_SUCCESS, ERROR_HANDLE_EOF at the end of the file,
+///     ERROR_INVALID_DATA if the block is invalid or truncated, or
+///     ERROR_NOT_SUPPORTED for an unknown codec.
+///
+DWORD
+BlockSpoolReader::ReadBlock(
+    _Out_ std::string& Lines
+    )
+{
+    Lines.clear();
+
+    BlockHeader header;
+    DWORD status = ReadHeader(header);
+
+    if (status != ERROR_SUCCESS)
+    {
+        return status;
+    }
+
+    m_stored.resize(header.StoredSize);
+
+    status = ReadExactly(&m_stored[0], header.StoredSize);
+
+    if (status != ERROR_SUCCESS)
+    {
+        return (status == ERROR_HANDLE_EOF) ? ERROR_INVALID_DATA : status;
+    }
+
+    if ((header.Flags & BlockHeader::FLAG_STORED) != 0)
+    {
+        Lines.swap(m_stored);
+
+        return ERROR_SUCCESS;
+    }
+
+    if (!m_codec || m_codec->GetId() != header.Codec)
+    {
+        m_codec = BlockCodec::Create(header.Codec);
+
+        if (!m_codec)
+        {
+            return ERROR_NOT_SUPPORTED;
+        }
+    }
+
+    Lines.resize(header.UncompressedSize);
+
+    if (!m_codec->Decompress(m_stored.data(), m_stored.size(), &Lines[0], Lines.size()))
+    {
+        Lines.clear();
+
+        return ERROR_INVALID_DATA;
+    }
+
+    return ERROR_SUCCESS;
+}
+
+void
+BlockSpoolReader::Close()
+{
+    if (m_file != INVALID_HANDLE_VALUE)
+    {
+        CloseHandle(m_file);
+        m_file = INVALID_HANDLE_VALUE;
+    }
+}
+
+///
+/// \return ERROR_SUCCESS, ERROR_HANDLE_EOF if the file ends before the
+///     buffer is full, or the error of ReadFile.
+///
+DWORD
+BlockSpoolReader::ReadExactly(
+    _Out_writes_bytes_(Size) char* Buffer,
+    _In_ DWORD Size
+    )
+{
+    while (Size > 0)
+    {
+        DWORD read = 0;
+
+        if (!ReadFile(m_file, Buffer, Size, &read, NULL))
+        {
+            return GetLastError();
+        }
+
+        if (read == 0)
+        {
+            return ERROR_HANDLE_EOF;
+        }
+
+        Buffer += read;
+        Size -= read;
+    }
+
+    return ERROR_SUCCESS;
+}
+
+///
+/// \return ERROR_SUCCESS, ERROR_HANDLE_EOF at the end of the file, or
+///     ERROR_INVALID_DATA if the header is invalid or truncated.
+///
+DWORD
+BlockSpoolReader::ReadHeader(
+    _Out_ BlockHeader& Header
+    )
+{
+    char buffer[BlockHeader::SIZE];
+    DWORD read = 0;
+
+    if (!ReadFile(m_file, buffer, sizeof(buffer), &read, NULL))
+    {
+        return GetLastError();
+    }
+
+    if (read == 0)
+    {
+        return ERROR_HANDLE_EOF;
+    }
+
+    if (read < sizeof(buffer))
+    {
+        const DWORD status = ReadExactly(buffer + read, sizeof(buffer) - read);
+
+        if (status != ERROR_SUCCESS)
+        {
+            return (status == ERROR_HANDLE_EOF) ? ERROR_INVALID_DATA : status;
+        }
+    }
+
+    return Header.Parse(buffer) ? ERROR_SUCCESS : ERROR_INVALID_DATA;
+}
@@ -0,0 +1,177 @@
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+
+#pragma once
+
+///
+/// Header of a block of a compressed output file, 16 bytes, little-endian:
+///
+///   0   Magic "LMBK"
+///   4   Codec, a CompressionCodec value
+///   5   Flags
+///   6   Reserved, 0
+///   8   Size of the lines of the block
+///   12  Size of the stored block, after the header
+///
+/// A block holds whole lines, and is compressed on its own, so a reader can
+/// skip from header to header to any block, and decompress it alone.
+///
+struct BlockHeader
+{
+    static constexpr size_t SIZE = 16;
+    static constexpr UINT32 MAGIC = 0x4B424D4C;
+
+    //
+    // The block is stored as it is, because it didn't get smaller.
+    //
+    static constexpr UINT8 FLAG_STORED = 0x01;
+
+    CompressionCodec Codec = CompressionCodec::None;
+    UINT8 Flags = 0;
+    UINT32 UncompressedSize = 0;
+    UINT32 StoredSize = 0;
+
+    void Write(
+        _Out_writes_bytes_(SIZE) char* Buffer
+        ) const;
+
+    bool Parse(
+        _In_reads_bytes_(SIZE) const char* Buffer
+        );
+};
+
+///
+/// Groups the lines of the output batches into blocks of about the block
+/// size, and compresses each block with a BlockCodec.
+///
+/// A block is closed at the last line break that fits in it, so the lines
+/// are never split between two blocks; a line longer than a block is a
+/// block of its own. A block that isn't full is compressed once it's older
+/// than the max block age, by the next Append, or by the caller when
+/// GetMillisUntilFlush gets to 0, so a quiet source doesn't keep its lines
+/// in memory for long. Until then, the lines are lost if the process
+/// crashes.
+///
+/// The writer isn't thread safe. The RotatingFileSink calls it under the
+/// output lock of the LogWriter.
+///
+class BlockSpoolWriter final
+{
+public:
+    static constexpr size_t DEFAULT_BLOCK_BYTES = 64 * 1024;
+    static constexpr size_t MIN_BLOCK_BYTES = 4 * 1024;
+    static constexpr size_t MAX_BLOCK_BYTES = 4 * 1024 * 1024;
+    static constexpr DWORD DEFAULT_MAX_BLOCK_AGE_MILLIS = 1000;
+
+    struct Statistics
+    {
+        UINT64 Blocks = 0;
+        UINT64 UncompressedBytes = 0;
+
+        //
+        // Including the block headers.
+        //
+        UINT64 CompressedBytes = 0;
+        UINT64 CompressMicroseconds = 0;
+    };
+
+    BlockSpoolWriter(
+        _In_ std::unique_ptr<BlockCodec> Codec,
+        _In_ size_t BlockBytes = DEFAULT_BLOCK_BYTES,
+        _In_ DWORD MaxBlockAgeMillis = DEFAULT_MAX_BLOCK_AGE_MILLIS
+        );
+
+    BlockSpoolWriter(const BlockSpoolWriter&) = delete;
+    BlockSpoolWriter& operator=(const BlockSpoolWriter&) = delete;
+
+    void Append(
+        _In_reads_bytes_(Size) const char* Data,
+        _In_ size_t Size,
+        _Inout_ std::string& Output
+        );
+
+    void Flush(
+        _Inout_ std::string& Output
+        );
+
+    size_t GetBufferedBytes() const
+    {
+        return m_block.size();
+    }
+
+    DWORD GetMillisUntilFlush() const;
+
+    const Statistics& GetStatistics() const
+    {
+        return m_statistics;
+    }
+
+private:
+    std::unique_ptr<BlockCodec> m_codec;
+    size_t m_blockBytes;
+    ULONGLONG m_maxBlockAgeMillis;
+
+    std::string m_block;
+    ULONGLONG m_blockStartTime = 0;
+
+    LARGE_INTEGER m_frequency;
+    Statistics m_statistics;
+
+    void CompressBlock(
+        _In_reads_bytes_(Size) const char* Data,
+        _In_ size_t Size,
+        _Inout_ std::string& Output
+        );
+};
+
+///
+/// Reads the lines of a compressed output file, block by block.
+///
+class BlockSpoolReader final
+{
+public:
+    explicit BlockSpoolReader(
+        _In_ const std::wstring& Path
+        ) :
+        m_path(Path)
+    {
+    }
+
+    ~BlockSpoolReader()
+    {
+        Close();
+    }
+
+    BlockSpoolReader(const BlockSpoolReader&) = delete;
+    BlockSpoolReader& operator=(const BlockSpoolReader&) = delete;
+
+    DWORD Open();
+
+    DWORD SeekToBlock(
+        _In_ UINT64 Index
+        );
+
+    DWORD ReadBlock(
+        _Out_ std::string& Lines
+        );
+
+    void Close();
+
+private:
+    std::wstring m_path;
+    HANDLE m_file = INVALID_HANDLE_VALUE;
+
+    std::unique_ptr<BlockCodec> m_codec;
+    std::string m_stored;
+
+    DWORD ReadExactly(
+        _Out_writes_bytes_(Size) char* Buffer,
+        _In_ DWORD Size
+        );
+
+    DWORD ReadHeader(
+        _Out_ BlockHeader& Header
+        );
+};
@@ -0,0 +1,1132 @@
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+
+#include "pch.h"
+
+constexpr UINT64 DurableQueue::DEFAULT_MAX_BYTES;
+constexpr UINT64 DurableQueue::DEFAULT_SEGMENT_BYTES;
+constexpr UINT64 DurableQueue::MIN_SEGMENT_BYTES;
+constexpr size_t DurableQueue::MAX_RECYCLED_SEGMENTS;
+constexpr size_t DurableQueue::RECORD_HEADER_SIZE;
+constexpr UINT32 DurableQueue::MAX_RECORD_BYTES;
+
+//
+// Size of the reads of Open and Read.
+//
+static constexpr size_t c_QueueReadBytes = 1024 * 1024;
+
+//
+// Sequence and offset of the acknowledged cursor, and their CRC-32.
+//
+static constexpr DWORD c_QueueCursorSize = 20;
+
+static const wchar_t c_QueueSegmentExtension[] = L".lmq";
+static const wchar_t c_QueueSpareExtension[] = L".spare";
+
+///
+/// Tables of the CRC-32 (IEEE 802.3) computed 8 bytes at a time.
+///
+struct QueueCrcTable
+{
+    UINT32 Entries[8][256];
+
+    QueueCrcTable()
+    {
+        for (UINT32 i = 0; i < 256; i++)
+        {
+            UINT32 crc = i;
+
+            for (int bit = 0; bit < 8; bit++)
+            {
+                crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320 : crc >> 1;
+            }
+
+            Entries[0][i] = crc;
+        }
+
+        for (UINT32 i = 0; i < 256; i++)
+        {
+            for (int k = 1; k < 8; k++)
+            {
+                Entries[k][i] = (Entries[k - 1][i] >> 8) ^ Entries[0][Entries[k - 1][i] & 0xFF];
+            }
+        }
+    }
+};
+
+///
+/// Continues a CRC-32, like the crc32 function of zlib.
+///
+static UINT32
+QueueCrc32(
+    _In_ UINT32 Crc,
+    _In_reads_bytes_(Size) const char* Data,
+    _In_ size_t Size
+    )
+{
+    static const QueueCrcTable table;
+
+    const UINT8* data = reinterpret_cast<const UINT8*>(Data);
+    const auto& entries = table.Entries;
+
+    Crc = ~Crc;
+
+    while (Size >= 8)
+    {
+        UINT32 low;
+        UINT32 high;
+
+        memcpy(&low, data, sizeof(low));
+        memcpy(&high, data + 4, sizeof(high));
+
+        low ^= Crc;
+
+        Crc = entries[7][low & 0xFF] ^ entries[6][(low >> 8) & 0xFF]
+            ^ entries[5][(low >> 16) & 0xFF] ^ entries[4][low >> 24]
+            ^ entries[3][high & 0xFF] ^ entries[2][(high >> 8) & 0xFF]
+            ^ entries[1][(high >> 16) & 0xFF] ^ entries[0][high >> 24];
+
+        data += 8;
+        Size -= 8;
+    }
+
+    while (Size > 0)
+    {
+        Crc = entries[0][(Crc ^ *data++) & 0xFF] ^ (Crc >> 8);
+        Size--;
+    }
+
+    return ~Crc;
+}
+
+static inline void
+QueueWrite32(
+    _Out_writes_bytes_(4) char* Buffer,
+    _In_ UINT32 Value
+    )
+{
+    for (int i = 0; i < 4; i++)
+    {
+        Buffer[i] = static_cast<char>((Value >> (8 * i)) & 0xFF);
+    }
+}
+
+static inline UINT32
+QueueRead32(
+    _In_reads_bytes_(4) const char* Buffer
+    )
+{
+    UINT32 value = 0;
+
+    for (int i = 3; i >= 0; i--)
+    {
+        value = (value << 8) | static_cast<UINT8>(Buffer[i]);
+    }
+
+    return value;
+}
+
+static inline void
+QueueWrite64(
+    _Out_writes_bytes_(8) char* Buffer,
+    _In_ UINT64 Value
+    )
+{
+    QueueWrite32(Buffer, static_cast<UINT32>(Value));
+    QueueWrite32(Buffer + 4, static_cast<UINT32>(Value >> 32));
+}
+
+static inline UINT64
+QueueRead64(
+    _In_reads_bytes_(8) const char* Buffer
+    )
+{
+    return QueueRead32(Buffer) | (static_cast<UINT64>(QueueRead32(Buffer + 4)) << 32);
+}
+
+///
+/// CRC of a record: the sequence of its segment, its length and its bytes.
+///
+static UINT32
+QueueRecordCrc(
+    _In_ UINT64 Sequence,
+    _In_reads_bytes_(Size) const char* Data,
+    _In_ UINT32 Size
+    )
+{
+    char prefix[12];
+
+    QueueWrite64(prefix, Sequence);
+    QueueWrite32(prefix + 8, Size);
+
+    return QueueCrc32(QueueCrc32(0, prefix, sizeof(prefix)), Data, Size);
+}
+
+///
+/// Parses the name of a segment or a spare file, "<16 hex digits><ext>".
+///
+static bool
+ParseQueueFileName(
+    _In_ const std::wstring& Name,
+    _In_ LPCWSTR Extension,
+    _Out_ UINT64& Sequence
+    )
+{
+    const size_t extensionLength = wcslen(Extension);
+
+    Sequence = 0;
+
+    if (Name.size() != 16 + extensionLength || _wcsicmp(Name.c_str() + 16, Extension) != 0)
+    {
+        return false;
+    }
+
+    for (size_t i = 0; i < 16; i++)
+    {
+        const wchar_t c = Name[i];
+
+        if (!iswxdigit(c))
+        {
+            return false;
+        }
+
+        Sequence = (Sequence << 4) | ((c <= L'9') ? (c - L'0') : ((c | 0x20) - L'a' + 10));
+    }
+
+    return true;
+}
+
+///
+/// \param Directory        Directory of the segments. Created by Open.
+/// \param MaxBytes         Size of the valid records of the segments before
+///                         the oldest ones are dropped. 0 for the default.
+/// \param SegmentBytes     Size of a segment before a new one is started.
+///                         0 for the default. Clamped to a quarter of the
+///                         max bytes.
+///
+DurableQueue::DurableQueue(
+    _In_ const std::wstring& Directory,
+    _In_ UINT64 MaxBytes,
+    _In_ UINT64 SegmentBytes
+    ) :
+    m_directory(Directory),
+    m_maxBytes(MaxBytes != 0 ? MaxBytes : DEFAULT_MAX_BYTES),
+    m_segmentBytes(SegmentBytes != 0 ? SegmentBytes : DEFAULT_SEGMENT_BYTES)
+{
+    //
+    // With at least 4 segments, dropping the oldest one frees enough space
+    // for a batch.
+    //
+    m_segmentBytes = (std::max)(MIN_SEGMENT_BYTES, (std::min)(m_segmentBytes, m_maxBytes / 4));
+}
+
+///
+/// Creates the directory, or finds the segments and the acknowledged cursor
+/// it has, and scans the segments after the cursor.
+///
+/// \return ERROR_SUCCESS, or the error of the file operations.
+///
+DWORD
+DurableQueue::Open()
+{
+    if (m_writeFile != INVALID_HANDLE_VALUE)
+    {
+        return ERROR_SUCCESS;
+    }
+
+    if (!CreateDirectoryW(m_directory.c_str(), NULL))
+    {
+        const DWORD status = GetLastError();
+
+        if (status != ERROR_ALREADY_EXISTS)
+        {
+            return status;
+        }
+    }
+
+    m_segments.clear();
+    m_recycled.clear();
+    m_queuedBytes = 0;
+    m_nextSequence = 1;
+
+    WIN32_FIND_DATAW findData;
+    HANDLE find = FindFirstFileW((m_directory + L"\\*").c_str(), &findData);
+
+    if (find != INVALID_HANDLE_VALUE)
+    {
+        do
+        {
+            if ((findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0)
+            {
+                continue;
+            }
+
+            UINT64 sequence;
+
+            if (ParseQueueFileName(findData.cFileName, c_QueueSegmentExtension, sequence))
+            {
+                m_segments.push_back(Segment{ sequence, 0, 0 });
+            }
+            else if (ParseQueueFileName(findData.cFileName, c_QueueSpareExtension, sequence))
+            {
+                m_recycled.push_back(m_directory + L"\\" + findData.cFileName);
+            }
+            else
+            {
+                continue;
+            }
+
+            //
+            // A new segment must never reuse a sequence, or the records
+            // left in a recycled file could be valid again.
+            //
+            m_nextSequence = (std::max)(m_nextSequence, sequence + 1);
+        } while (FindNextFileW(find, &findData));
+
+        FindClose(find);
+    }
+
+    std::sort(
+        m_segments.begin(),
+        m_segments.end(),
+        [](const Segment& Left, const Segment& Right) { return Left.Sequence < Right.Sequence; });
+
+    while (m_recycled.size() > MAX_RECYCLED_SEGMENTS)
+    {
+        DeleteFileW(m_recycled.back().c_str());
+        m_recycled.pop_back();
+    }
+
+    //
+    // Without a valid cursor, all the segments are read again.
+    //
+    Cursor cursor;
+    DWORD status = ReadCursor(cursor);
+
+    if (status == ERROR_INVALID_DATA)
+    {
+        cursor = Cursor();
+    }
+    else if (status != ERROR_SUCCESS)
+    {
+        Close();
+
+        return status;
+    }
+
+    m_nextSequence = (std::max)(m_nextSequence, cursor.Sequence + 1);
+
+    //
+    // The segments before the cursor were acknowledged before the restart.
+    //
+    while (!m_segments.empty() && m_segments.front().Sequence < cursor.Sequence)
+    {
+        RecycleSegmentFile(m_segments.front().Sequence);
+        m_segments.erase(m_segments.begin());
+    }
+
+    m_acknowledged = Cursor();
+    m_statistics.ReplayedRecords = 0;
+
+    for (Segment& segment : m_segments)
+    {
+        Cursor found;
+
+        status = ScanSegment(segment, (segment.Sequence == cursor.Sequence) ? cursor.Offset : 0, found);
+
+        if (status != ERROR_SUCCESS)
+        {
+            Close();
+
+            return status;
+        }
+
+        if (segment.Sequence == cursor.Sequence)
+        {
+            m_acknowledged = found;
+        }
+
+        m_queuedBytes += segment.Bytes;
+        m_statistics.ReplayedRecords += segment.Records;
+    }
+
+    if (m_segments.empty())
+    {
+        status = StartSegment();
+    }
+    else
+    {
+        status = OpenWriteSegment(m_segments.back().Sequence, m_segments.back().Bytes);
+    }
+
+    if (status != ERROR_SUCCESS)
+    {
+        Close();
+
+        return status;
+    }
+
+    //
+    // The cursor's segment was dropped, or there's no cursor.
+    //
+    if (m_acknowledged.Sequence != m_segments.front().Sequence)
+    {
+        m_acknowledged = Cursor();
+        m_acknowledged.Sequence = m_segments.front().Sequence;
+    }
+
+    m_statistics.ReplayedRecords -= m_acknowledged.Record;
+    m_read = m_acknowledged;
+    m_readRecords = 0;
+
+    return ERROR_SUCCESS;
+}
+
+///
+/// Appends a batch of records to the last segment, with one write. A new
+/// segment is started first if the batch doesn't fit in the last one, and
+/// the oldest segments are dropped if the batch doesn't fit in the max
+/// bytes.
+///
+/// \param Records  The records, one after the other.
+/// \param Ends     End offset of each record in Records.
+///
+/// \return ERROR_SUCCESS, or the error of the file operations. The queue
+///     is opened again by the next call after an error.
+///
+DWORD
+DurableQueue::Append(
+    _In_ const char* Records,
+    _In_ const std::vector<size_t>& Ends
+    )
+{
+    if (Ends.empty())
+    {
+        return ERROR_SUCCESS;
+    }
+
+    DWORD status = Open();
+
+    if (status != ERROR_SUCCESS)
+    {
+        return status;
+    }
+
+    const UINT64 batchBytes = Ends.back() + Ends.size() * RECORD_HEADER_SIZE;
+
+    if (m_segments.back().Bytes > 0 && m_segments.back().Bytes + batchBytes > m_segmentBytes)
+    {
+        status = StartSegment();
+
+        if (status != ERROR_SUCCESS)
+        {
+            Close();
+
+            return status;
+        }
+    }
+
+    while (m_queuedBytes + batchBytes > m_maxBytes && m_segments.size() > 1)
+    {
+        RemoveOldestSegment();
+    }
+
+    Segment& segment = m_segments.back();
+    size_t start = 0;
+    UINT64 records = 0;
+
+    m_writeBuffer.clear();
+
+    for (const size_t end : Ends)
+    {
+        const size_t size = end - start;
+
+        if (size > MAX_RECORD_BYTES)
+        {
+            m_statistics.DroppedRecords++;
+            start = end;
+            continue;
+        }
+
+        char header[RECORD_HEADER_SIZE];
+
+        QueueWrite32(header, static_cast<UINT32>(size));
+        QueueWrite32(header + 4, QueueRecordCrc(segment.Sequence, Records + start, static_cast<UINT32>(size)));
+
+        m_writeBuffer.append(header, sizeof(header));
+        m_writeBuffer.append(Records + start, size);
+
+        records++;
+        start = end;
+    }
+
+    const char* data = m_writeBuffer.data();
+    size_t size = m_writeBuffer.size();
+
+    while (size > 0)
+    {
+        const DWORD chunk = static_cast<DWORD>((std::min)(size, static_cast<size_t>(MAXDWORD)));
+        DWORD written = 0;
+
+        if (!WriteFile(m_writeFile, data, chunk, &written, NULL))
+        {
+            status = GetLastError();
+
+            Close();
+
+            return status;
+        }
+
+        data += written;
+        size -= written;
+    }
+
+    segment.Bytes += m_writeBuffer.size();
+    segment.Records += records;
+    m_queuedBytes += m_writeBuffer.size();
+
+    m_statistics.AppendedRecords += records;
+    m_statistics.AppendedBytes += m_writeBuffer.size();
+
+    return ERROR_SUCCESS;
+}
+
+///
+/// Reads the records after the read cursor, and moves the cursor after
+/// them.
+///
+/// \param MaxRecords   Maximum number of records read.
+/// \param MaxBytes     Maximum size of the records read, unless the first
+///                     record is larger.
+/// \param Records      Returns the records, one after the other.
+/// \param Ends         Returns the end offset of each record in Records.
+///
+/// \return ERROR_SUCCESS, even if there's no record to read, or the error
+///     of the file operations.
+///
+DWORD
+DurableQueue::Read(
+    _In_ size_t MaxRecords,
+    _In_ size_t MaxBytes,
+    _Out_ std::string& Records,
+    _Out_ std::vector<size_t>& Ends
+    )
+{
+    Records.clear();
+    Ends.clear();
+
+    DWORD status = Open();
+
+    if (status != ERROR_SUCCESS)
+    {
+        return status;
+    }
+
+    size_t index = 0;
+
+    while (index < m_segments.size() && m_segments[index].Sequence < m_read.Sequence)
+    {
+        index++;
+    }
+
+    while (Ends.size() < MaxRecords && Records.size() < MaxBytes && index < m_segments.size())
+    {
+        const Segment& segment = m_segments[index];
+
+        if (m_read.Sequence != segment.Sequence)
+        {
+            m_read = Cursor();
+            m_read.Sequence = segment.Sequence;
+        }
+
+        if (m_read.Offset >= segment.Bytes)
+        {
+            if (index + 1 == m_segments.size())
+            {
+                break;
+            }
+
+            index++;
+            continue;
+        }
+
+        status = FillReadBuffer(segment, RECORD_HEADER_SIZE);
+
+        if (status != ERROR_SUCCESS)
+        {
+            return status;
+        }
+
+        const char* header = m_readBuffer.data() + (m_read.Offset - m_readBufferOffset);
+        const UINT32 size = QueueRead32(header);
+
+        if (size > segment.Bytes - m_read.Offset - RECORD_HEADER_SIZE)
+        {
+            return ERROR_INVALID_DATA;
+        }
+
+        if (!Ends.empty() && Records.size() + size > MaxBytes)
+        {
+            break;
+        }
+
+        status = FillReadBuffer(segment, RECORD_HEADER_SIZE + size);
+
+        if (status != ERROR_SUCCESS)
+        {
+            return status;
+        }
+
+        Records.append(m_readBuffer.data() + (m_read.Offset - m_readBufferOffset) + RECORD_HEADER_SIZE, size);
+        Ends.push_back(Records.size());
+
+        m_read.Offset += RECORD_HEADER_SIZE + size;
+        m_read.Record++;
+        m_readRecords++;
+    }
+
+    return ERROR_SUCCESS;
+}
+
+///
+/// Moves the acknowledged cursor to the read cursor and writes it, and
+/// recycles the segments before it.
+///
+/// \return ERROR_SUCCESS, or the error of the write of the cursor. The
+///     records are read again after a restart in that case.
+///
+DWORD
+DurableQueue::Acknowledge()
+{
+    if (m_segments.empty())
+    {
+        return ERROR_SUCCESS;
+    }
+
+    m_statistics.AcknowledgedRecords += m_readRecords;
+    m_readRecords = 0;
+    m_acknowledged = m_read;
+
+    while (m_segments.size() > 1 && m_segments.front().Sequence < m_acknowledged.Sequence)
+    {
+        const UINT64 sequence = m_segments.front().Sequence;
+
+        m_queuedBytes -= m_segments.front().Bytes;
+        m_segments.erase(m_segments.begin());
+
+        if (m_readFileSequence == sequence)
+        {
+            CloseReadFile();
+        }
+
+        RecycleSegmentFile(sequence);
+    }
+
+    return WriteCursor();
+}
+
+///
+/// Moves the read cursor back to the acknowledged cursor.
+///
+void
+DurableQueue::Rewind()
+{
+    m_read = m_acknowledged;
+    m_readRecords = 0;
+}
+
+void
+DurableQueue::Close()
+{
+    if (m_writeFile != INVALID_HANDLE_VALUE)
+    {
+        CloseHandle(m_writeFile);
+        m_writeFile = INVALID_HANDLE_VALUE;
+    }
+
+    if (m_cursorFile != INVALID_HANDLE_VALUE)
+    {
+        CloseHandle(m_cursorFile);
+        m_cursorFile = INVALID_HANDLE_VALUE;
+    }
+
+    CloseReadFile();
+
+    m_segments.clear();
+    m_queuedBytes = 0;
+}
+
+std::wstring
+DurableQueue::SegmentPath(
+    _In_ UINT64 Sequence,
+    _In_ LPCWSTR Extension
+    ) const
+{
+    wchar_t name[32];
+
+    swprintf_s(name, L"%016llx%s", Sequence, Extension);
+
+    return m_directory + L"\\" + name;
+}
+
+///
+/// Reads the records of a segment until the end of the file, or until a
+/// record is truncated or doesn't match its CRC.
+///
+/// \param Scanned      The segment. Returns the size and count of its valid
+///                     records.
+/// \param CursorOffset Offset of the acknowledged cursor in the segment.
+/// \param Found        Returns the cursor of the first record at or after
+///                     the offset, or the end of the valid records.
+///
+DWORD
+DurableQueue::ScanSegment(
+    _Inout_ Segment& Scanned,
+    _In_ UINT64 CursorOffset,
+    _Out_ Cursor& Found
+    )
+{
+    HANDLE file = CreateFileW(
+        SegmentPath(Scanned.Sequence, c_QueueSegmentExtension).c_str(),
+        GENERIC_READ,
+        FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+        NULL,
+        OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+        NULL);
+
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        return GetLastError();
+    }
+
+    Scanned.Bytes = 0;
+    Scanned.Records = 0;
+
+    Found = Cursor();
+    Found.Sequence = Scanned.Sequence;
+
+    bool cursorFound = false;
+    bool end = false;
+    DWORD status = ERROR_SUCCESS;
+
+    //
+    // m_readBuffer holds the bytes from Scanned.Bytes, the end of the valid
+    // records so far.
+    //
+    m_readBuffer.clear();
+    CloseReadFile();
+
+    while (!end)
+    {
+        size_t position = 0;
+
+        while (m_readBuffer.size() - position >= RECORD_HEADER_SIZE)
+        {
+            const char* header = m_readBuffer.data() + position;
+            const UINT32 size = QueueRead32(header);
+
+            if (size > MAX_RECORD_BYTES)
+            {
+                end = true;
+                break;
+            }
+
+            if (m_readBuffer.size() - position - RECORD_HEADER_SIZE < size)
+            {
+                break;
+            }
+
+            if (QueueRead32(header + 4) != QueueRecordCrc(Scanned.Sequence, header + RECORD_HEADER_SIZE, size))
+            {
+                end = true;
+                break;
+            }
+
+            if (!cursorFound && Scanned.Bytes >= CursorOffset)
+            {
+                Found.Offset = Scanned.Bytes;
+                Found.Record = Scanned.Records;
+                cursorFound = true;
+            }
+
+            position += RECORD_HEADER_SIZE + size;
+            Scanned.Bytes += RECORD_HEADER_SIZE + size;
+            Scanned.Records++;
+        }
+
+        m_readBuffer.erase(0, position);
+
+        if (end)
+        {
+            break;
+        }
+
+        //
+        // Read at least the rest of the record, if it's larger than a read.
+        //
+        size_t readSize = c_QueueReadBytes;
+
+        if (m_readBuffer.size() >= RECORD_HEADER_SIZE)
+        {
+            readSize = (std::max)(readSize, static_cast<size_t>(QueueRead32(m_readBuffer.data())) + RECORD_HEADER_SIZE);
+        }
+
+        const size_t offset = m_readBuffer.size();
+        DWORD read = 0;
+
+        m_readBuffer.resize(offset + readSize);
+
+        if (!ReadFile(file, &m_readBuffer[offset], static_cast<DWORD>(readSize), &read, NULL))
+        {
+            status = GetLastError();
+            break;
+        }
+
+        m_readBuffer.resize(offset + read);
+
+        end = (read == 0);
+    }
+
+    CloseHandle(file);
+
+    m_readBuffer.clear();
+
+    if (status != ERROR_SUCCESS)
+    {
+        return status;
+    }
+
+    if (!cursorFound)
+    {
+        Found.Offset = Scanned.Bytes;
+        Found.Record = Scanned.Records;
+    }
+
+    return ERROR_SUCCESS;
+}
+
+///
+/// Opens the cursor file, creating it if needed, and reads the
+/// acknowledged cursor.
+///
+/// \return ERROR_SUCCESS, ERROR_INVALID_DATA if the file is empty or
+///     doesn't match its CRC, or the error of the file operations.
+///
+DWORD
+DurableQueue::ReadCursor(
+    _Out_ Cursor& Result
+    )
+{
+    Result = Cursor();
+
+    m_cursorFile = CreateFileW(
+        (m_directory + L"\\cursor").c_str(),
+        GENERIC_READ | GENERIC_WRITE,
+        FILE_SHARE_READ | FILE_SHARE_DELETE,
+        NULL,
+        OPEN_ALWAYS,
+        FILE_ATTRIBUTE_NORMAL,
+        NULL);
+
+    if (m_cursorFile == INVALID_HANDLE_VALUE)
+    {
+        return GetLastError();
+    }
+
+    char buffer[c_QueueCursorSize];
+    DWORD read = 0;
+    OVERLAPPED start{};
+
+    if (!ReadFile(m_cursorFile, buffer, sizeof(buffer), &read, &start))
+    {
+        const DWORD status = GetLastError();
+
+        return (status == ERROR_HANDLE_EOF) ? ERROR_INVALID_DATA : status;
+    }
+
+    if (read < sizeof(buffer) || QueueRead32(buffer + 16) != QueueCrc32(0, buffer, 16))
+    {
+        return ERROR_INVALID_DATA;
+    }
+
+    Result.Sequence = QueueRead64(buffer);
+    Result.Offset = QueueRead64(buffer + 8);
+
+    return ERROR_SUCCESS;
+}
+
+///
+/// Writes the acknowledged cursor over the previous one. A write torn by a
+/// crash doesn't match its CRC, so all the segments are read again.
+///
+DWORD
+DurableQueue::WriteCursor()
+{
+    char buffer[c_QueueCursorSize];
+
+    QueueWrite64(buffer, m_acknowledged.Sequence);
+    QueueWrite64(buffer + 8, m_acknowledged.Offset);
+    QueueWrite32(buffer + 16, QueueCrc32(0, buffer, 16));
+
+    DWORD written = 0;
+    OVERLAPPED start{};
+
+    if (!WriteFile(m_cursorFile, buffer, sizeof(buffer), &written, &start))
+    {
+        return GetLastError();
+    }
+
+    return ERROR_SUCCESS;
+}
+
+///
+/// Opens the last segment found by Open, to append after its valid records.
+///
+DWORD
+DurableQueue::OpenWriteSegment(
+    _In_ UINT64 Sequence,
+    _In_ UINT64 Offset
+    )
+{
+    m_writeFile = CreateFileW(
+        SegmentPath(Sequence, c_QueueSegmentExtension).c_str(),
+        GENERIC_WRITE,
+        FILE_SHARE_READ | FILE_SHARE_DELETE,
+        NULL,
+        OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL,
+        NULL);
+
+    if (m_writeFile == INVALID_HANDLE_VALUE)
+    {
+        return GetLastError();
+    }
+
+    LARGE_INTEGER distance;
+    distance.QuadPart = static_cast<LONGLONG>(Offset);
+
+    if (!SetFilePointerEx(m_writeFile, distance, NULL, FILE_BEGIN))
+    {
+        return GetLastError();
+    }
+
+    return ERROR_SUCCESS;
+}
+
+///
+/// Starts a new last segment, in a recycled file if there's one.
+///
+DWORD
+DurableQueue::StartSegment()
+{
+    if (m_writeFile != INVALID_HANDLE_VALUE)
+    {
+        CloseHandle(m_writeFile);
+        m_writeFile = INVALID_HANDLE_VALUE;
+    }
+
+    const UINT64 sequence = m_nextSequence++;
+    const std::wstring path = SegmentPath(sequence, c_QueueSegmentExtension);
+    bool recycled = false;
+
+    while (!m_recycled.empty() && !recycled)
+    {
+        recycled = MoveFileExW(m_recycled.back().c_str(), path.c_str(), 0) != FALSE;
+
+        if (!recycled)
+        {
+            DeleteFileW(m_recycled.back().c_str());
+        }
+
+        m_recycled.pop_back();
+    }
+
+    m_writeFile = CreateFileW(
+        path.c_str(),
+        GENERIC_WRITE,
+        FILE_SHARE_READ | FILE_SHARE_DELETE,
+        NULL,
+        recycled ? OPEN_EXISTING : CREATE_ALWAYS,
+        FILE_ATTRIBUTE_NORMAL,
+        NULL);
+
+    if (m_writeFile == INVALID_HANDLE_VALUE)
+    {
+        return GetLastError();
+    }
+
+    if (!recycled)
+    {
+        //
+        // A failure only costs the contiguous allocation, so it's ignored.
+        //
+        FILE_ALLOCATION_INFO allocation{};
+        allocation.AllocationSize.QuadPart = static_cast<LONGLONG>(m_segmentBytes);
+
+        SetFileInformationByHandle(m_writeFile, FileAllocationInfo, &allocation, sizeof(allocation));
+    }
+
+    m_segments.push_back(Segment{ sequence, 0, 0 });
+
+    return ERROR_SUCCESS;
+}
+
+///
+/// Drops the oldest segment, and counts its records that weren't read. The
+/// cursors in it move to the next segment.
+///
+void
+DurableQueue::RemoveOldestSegment()
+{
+    const Segment oldest = m_segments.front();
+    UINT64 unread = 0;
+
+    if (m_read.Sequence <= oldest.Sequence)
+    {
+        unread = oldest.Records - ((m_read.Sequence == oldest.Sequence) ? m_read.Record : 0);
+    }
+
+    m_statistics.DroppedRecords += unread;
+
+    m_queuedBytes -= oldest.Bytes;
+    m_segments.erase(m_segments.begin());
+
+    if (m_read.Sequence <= oldest.Sequence)
+    {
+        m_read = Cursor();
+        m_read.Sequence = m_segments.front().Sequence;
+    }
+
+    if (m_acknowledged.Sequence <= oldest.Sequence)
+    {
+        m_acknowledged = Cursor();
+        m_acknowledged.Sequence = m_segments.front().Sequence;
+    }
+
+    if (m_readFileSequence == oldest.Sequence)
+    {
+        CloseReadFile();
+    }
+
+    RecycleSegmentFile(oldest.Sequence);
+}
+
+///
+/// Renames the file of a segment that is no longer needed to a spare file,
+/// or deletes it if there are enough spare files.
+///
+void
+DurableQueue::RecycleSegmentFile(
+    _In_ UINT64 Sequence
+    )
+{
+    const std::wstring path = SegmentPath(Sequence, c_QueueSegmentExtension);
+
+    if (m_recycled.size() < MAX_RECYCLED_SEGMENTS)
+    {
+        const std::wstring spare = SegmentPath(Sequence, c_QueueSpareExtension);
+
+        if (MoveFileExW(path.c_str(), spare.c_str(), MOVEFILE_REPLACE_EXISTING))
+        {
+            m_recycled.push_back(spare);
+            m_statistics.RecycledSegments++;
+
+            return;
+        }
+    }
+
+    DeleteFileW(path.c_str());
+}
+
+///
+/// Reads the segment from the read cursor, unless the read buffer already
+/// has the bytes.
+///
+/// \param Source       The segment of the read cursor.
+/// \param MinBytes     Bytes needed from the read cursor. At most the valid
+///                     bytes after the cursor.
+///
+DWORD
+DurableQueue::FillReadBuffer(
+    _In_ const Segment& Source,
+    _In_ size_t MinBytes
+    )
+{
+    if (m_readFileSequence == Source.Sequence
+        && m_read.Offset >= m_readBufferOffset
+        && m_read.Offset + MinBytes <= m_readBufferOffset + m_readBuffer.size())
+    {
+        return ERROR_SUCCESS;
+    }
+
+    if (m_readFileSequence != Source.Sequence || m_readFile == INVALID_HANDLE_VALUE)
+    {
+        CloseReadFile();
+
+        //
+        // The file is still written by the writer handle.
+        //
+        m_readFile = CreateFileW(
+            SegmentPath(Source.Sequence, c_QueueSegmentExtension).c_str(),
+            GENERIC_READ,
+            FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+            NULL,
+            OPEN_EXISTING,
+            FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+            NULL);
+
+        if (m_readFile == INVALID_HANDLE_VALUE)
+        {
+            return GetLastError();
+        }
+
+        m_readFileSequence = Source.Sequence;
+    }
+
+    const size_t size = static_cast<size_t>((std::min)(
+        static_cast<UINT64>((std::max)(MinBytes, c_QueueReadBytes)),
+        Source.Bytes - m_read.Offset));
+
+    m_readBuffer.resize(size);
+    m_readBufferOffset = m_read.Offset;
+
+    OVERLAPPED position{};
+    position.Offset = static_cast<DWORD>(m_read.Offset);
+    position.OffsetHigh = static_cast<DWORD>(m_read.Offset >> 32);
+
+    DWORD read = 0;
+
+    if (!ReadFile(m_readFile, &m_readBuffer[0], static_cast<DWORD>(size), &read, &position))
+    {
+        const DWORD status = GetLastError();
+
+        m_readBuffer.clear();
+
+        return status;
+    }
+
+    m_readBuffer.resize(read);
+
+    if (read < MinBytes)
+    {
+        return ERROR_INVALID_DATA;
+    }
+
+    return ERROR_SUCCESS;
+}
+
+void
+DurableQueue::CloseReadFile()
+{
+    if (m_readFile != INVALID_HANDLE_VALUE)
+    {
+        CloseHandle(m_readFile);
+        m_readFile = INVALID_HANDLE_VALUE;
+    }
+
+    m_readFileSequence = 0;
+    m_readBuffer.clear();
+}
@@ -0,0 +1,233 @@
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+
+#pragma once
+
+///
+/// Append-only queue of records on disk, in a directory of segment files, so
+/// the lines keep being accepted while a sink can't send them, and survive a
+/// restart of LogMonitor.
+///
+/// The records are appended to the last segment, "<sequence>.lmq", with one
+/// WriteFile per batch. Each record has an 8-byte header: its length, and a
+/// CRC-32 of the sequence of its segment, its length and its bytes. Once the
+/// last segment is full, a new segment is started.
+///
+/// The reader reads the records from its read cursor, and acknowledges them
+/// once they were sent, which moves the acknowledged cursor to the read
+/// cursor and writes it to the "cursor" file. The records after the
+/// acknowledged cursor are read again after a restart, so a record can be
+/// sent twice, but is never lost by a crash of LogMonitor. Rewind moves the
+/// read cursor back to the acknowledged cursor, to read a batch again after
+/// a send failed.
+///
+/// The segments before the acknowledged cursor are recycled: up to
+/// MAX_RECYCLED_SEGMENTS are renamed "<sequence>.spare" and reused as the next
+/// segments, overwriting their old records, so the file system doesn't
+/// allocate the space of each new segment again. The CRC includes the
+/// sequence, so an old record of a recycled segment is never read as a new
+/// one.
+///
+/// When a batch would make the segments larger than the max bytes, the
+/// oldest segments are dropped, with their records that weren't read yet,
+/// so the writer is never blocked by a reader that can't keep up.
+///
+/// Open scans the segments to find the end of their valid records. A record
+/// torn by a crash, and anything after it in its segment, is ignored and
+/// overwritten by the next batch.
+///
+/// The queue isn't thread safe. The NetworkSink uses it from its sender
+/// thread only.
+///
+class DurableQueue final
+{
+public:
+    static constexpr UINT64 DEFAULT_MAX_BYTES = 1024 * 1024 * 1024;
+    static constexpr UINT64 DEFAULT_SEGMENT_BYTES = 16 * 1024 * 1024;
+    static constexpr UINT64 MIN_SEGMENT_BYTES = 64 * 1024;
+    static constexpr size_t MAX_RECYCLED_SEGMENTS = 2;
+    static constexpr size_t RECORD_HEADER_SIZE = 8;
+
+    //
+    // A longer record is considered corrupted by Open.
+    //
+    static constexpr UINT32 MAX_RECORD_BYTES = 64 * 1024 * 1024;
+
+    struct Statistics
+    {
+        UINT64 AppendedRecords = 0;
+        UINT64 AppendedBytes = 0;
+        UINT64 AcknowledgedRecords = 0;
+
+        //
+        // Records of the dropped segments that weren't read.
+        //
+        UINT64 DroppedRecords = 0;
+
+        //
+        // Records after the acknowledged cursor found by Open.
+        //
+        UINT64 ReplayedRecords = 0;
+        UINT64 RecycledSegments = 0;
+    };
+
+    DurableQueue(
+        _In_ const std::wstring& Directory,
+        _In_ UINT64 MaxBytes = DEFAULT_MAX_BYTES,
+        _In_ UINT64 SegmentBytes = DEFAULT_SEGMENT_BYTES
+        );
+
+    ~DurableQueue()
+    {
+        Close();
+    }
+
+    DurableQueue(const DurableQueue&) = delete;
+    DurableQueue& operator=(const DurableQueue&) = delete;
+
+    DWORD Open();
+
+    DWORD Append(
+        _In_ const char* Records,
+        _In_ const std::vector<size_t>& Ends
+        );
+
+    DWORD Read(
+        _In_ size_t MaxRecords,
+        _In_ size_t MaxBytes,
+        _Out_ std::string& Records,
+        _Out_ std::vector<size_t>& Ends
+        );
+
+    DWORD Acknowledge();
+
+    void Rewind();
+
+    void Close();
+
+    bool HasUnreadRecords() const
+    {
+        return !m_segments.empty()
+            && (m_read.Sequence != m_segments.back().Sequence || m_read.Offset < m_segments.back().Bytes);
+    }
+
+    ///
+    /// Size of the valid records of the segments, including their headers.
+    ///
+    UINT64 GetQueuedBytes() const
+    {
+        return m_queuedBytes;
+    }
+
+    size_t GetSegmentCount() const
+    {
+        return m_segments.size();
+    }
+
+    const Statistics& GetStatistics() const
+    {
+        return m_statistics;
+    }
+
+    const std::wstring& GetDirectory() const
+    {
+        return m_directory;
+    }
+
+private:
+    struct Segment
+    {
+        UINT64 Sequence;
+
+        //
+        // Size of the valid records.
+        //
+        UINT64 Bytes;
+        UINT64 Records;
+    };
+
+    struct Cursor
+    {
+        UINT64 Sequence = 0;
+        UINT64 Offset = 0;
+
+        //
+        // Index of the next record in the segment.
+        //
+        UINT64 Record = 0;
+    };
+
+    std::wstring m_directory;
+    UINT64 m_maxBytes;
+    UINT64 m_segmentBytes;
+
+    //
+    // Oldest first. The last one is written.
+    //
+    std::vector<Segment> m_segments;
+    std::vector<std::wstring> m_recycled;
+    UINT64 m_queuedBytes = 0;
+    UINT64 m_nextSequence = 1;
+
+    Cursor m_read;
+    Cursor m_acknowledged;
+
+    //
+    // Records read since the last Acknowledge or Rewind.
+    //
+    UINT64 m_readRecords = 0;
+
+    HANDLE m_writeFile = INVALID_HANDLE_VALUE;
+    HANDLE m_readFile = INVALID_HANDLE_VALUE;
+    UINT64 m_readFileSequence = 0;
+    HANDLE m_cursorFile = INVALID_HANDLE_VALUE;
+
+    std::string m_writeBuffer;
+
+    //
+    // Bytes of the read segment from m_readBufferOffset, not parsed yet.
+    //
+    std::string m_readBuffer;
+    UINT64 m_readBufferOffset = 0;
+
+    Statistics m_statistics;
+
+    std::wstring SegmentPath(
+        _In_ UINT64 Sequence,
+        _In_ LPCWSTR Extension
+        ) const;
+
+    DWORD ScanSegment(
+        _Inout_ Segment& Scanned,
+        _In_ UINT64 CursorOffset,
+        _Out_ Cursor& Found
+        );
+
+    DWORD ReadCursor(
+        _Out_ Cursor& Result
+        );
+
+    DWORD WriteCursor();
+
+    DWORD OpenWriteSegment(
+        _In_ UINT64 Sequence,
+        _In_ UINT64 Offset
+        );
+
+    DWORD StartSegment();
+
+    void RemoveOldestSegment();
+
+    void RecycleSegmentFile(
+        _In_ UINT64 Sequence
+        );
+
+    DWORD FillReadBuffer(
+        _In_ const Segment& Source,
+        _In_ size_t MinBytes
+        );
+
+    void CloseReadFile();
+};
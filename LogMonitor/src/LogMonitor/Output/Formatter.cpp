@@ -0,0 +1,491 @@
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+
+#include "pch.h"
+
+constexpr UINT64 Formatter::INVALID_SIGNATURE;
+constexpr UINT64 Formatter::MAX_ARGUMENTS;
+
+static const wchar_t c_FormatLowerDigits[] = L"0123456789abcdef";
+static const wchar_t c_FormatUpperDigits[] = L"0123456789ABCDEF";
+
+///
+/// Appends the text of a format string up to its next conversion.
+///
+/// \param Buffer   The buffer where the text is appended.
+/// \param Format   The format string.
+/// \param Spec     Returns the next conversion.
+///
+/// \return The character after the conversion, or NULL if the format string
+///     has no more conversions. An unsupported conversion is written as text.
+///
+LPCWSTR
+Formatter::AppendLiteral(
+    _Inout_ std::wstring& Buffer,
+    _In_z_ LPCWSTR Format,
+    _Out_ FormatSpec& Spec
+    )
+{
+    for (;;)
+    {
+        LPCWSTR start = Format;
+
+        while (*Format != L'\0' && *Format != L'%')
+        {
+            Format++;
+        }
+
+        Buffer.append(start, Format - start);
+
+        if (*Format == L'\0')
+        {
+            return NULL;
+        }
+
+        Format++;
+
+        if (*Format == L'%')
+        {
+            Buffer.push_back(L'%');
+            Format++;
+            continue;
+        }
+
+        LPCWSTR end = ParseSpec(Format, Spec);
+
+        if (Spec.Kind != FormatArgumentKind::Invalid)
+        {
+            return end;
+        }
+
+        Buffer.push_back(L'%');
+    }
+}
+
+///
+/// Appends the rest of a format string once all the arguments are written.
+/// Conversions without an argument are skipped.
+///
+void
+Formatter::AppendArguments(
+    _Inout_ std::wstring& Buffer,
+    _In_z_ LPCWSTR Format
+    )
+{
+    FormatSpec spec;
+
+    while (Format != NULL)
+    {
+        Format = AppendLiteral(Buffer, Format, spec);
+    }
+}
+
+void
+Formatter::AppendArgument(
+    _Inout_ std::wstring& Buffer,
+    _In_ const FormatSpec& Spec,
+    _In_ bool Value
+    )
+{
+    AppendInteger(Buffer, Spec, Value ? 1 : 0, Value ? 1 : 0, false);
+}
+
+void
+Formatter::AppendArgument(
+    _Inout_ std::wstring& Buffer,
+    _In_ const FormatSpec& Spec,
+    _In_ double Value
+    )
+{
+    AppendFloat(Buffer, Spec, Value);
+}
+
+void
+Formatter::AppendArgument(
+    _Inout_ std::wstring& Buffer,
+    _In_ const FormatSpec& Spec,
+    _In_opt_z_ const wchar_t* Value
+    )
+{
+    if (Spec.Kind == FormatArgumentKind::Pointer)
+    {
+        AppendArgument(Buffer, Spec, static_cast<const void*>(Value));
+        return;
+    }
+
+    if (Value == NULL)
+    {
+        Value = L"(null)";
+    }
+
+    AppendString(Buffer, Spec, Value, wcslen(Value));
+}
+
+void
+Formatter::AppendArgument(
+    _Inout_ std::wstring& Buffer,
+    _In_ const FormatSpec& Spec,
+    _In_ const std::wstring& Value
+    )
+{
+    AppendString(Buffer, Spec, Value.data(), Value.size());
+}
+
+void
+Formatter::AppendArgument(
+    _Inout_ std::wstring& Buffer,
+    _In_ const FormatSpec& Spec,
+    _In_opt_z_ const char* Value
+    )
+{
+    if (Spec.Kind == FormatArgumentKind::Pointer)
+    {
+        AppendArgument(Buffer, Spec, static_cast<const void*>(Value));
+        return;
+    }
+
+    if (Value == NULL)
+    {
+        Value = "(null)";
+    }
+
+    AppendNarrowString(Buffer, Spec, Value, strlen(Value));
+}
+
+void
+Formatter::AppendArgument(
+    _Inout_ std::wstring& Buffer,
+    _In_ const FormatSpec& Spec,
+    _In_ const std::string& Value
+    )
+{
+    AppendNarrowString(Buffer, Spec, Value.data(), Value.size());
+}
+
+///
+/// Writes a pointer as the CRT does, with all the hexadecimal digits.
+///
+void
+Formatter::AppendArgument(
+    _Inout_ std::wstring& Buffer,
+    _In_ const FormatSpec& Spec,
+    _In_opt_ const void* Value
+    )
+{
+    FormatSpec pointerSpec = Spec;
+
+    pointerSpec.Conversion = L'X';
+    pointerSpec.Precision = static_cast<int>(sizeof(Value) * 2);
+
+    const UINT64 bits = reinterpret_cast<UINT_PTR>(Value);
+
+    AppendInteger(Buffer, pointerSpec, bits, bits, false);
+}
+
+///
+/// Writes an integer argument.
+///
+/// \param Buffer       The buffer where the integer is appended.
+/// \param Spec         The conversion.
+/// \param Bits         The value, as an unsigned integer of the size of the
+///                     argument. Used by the unsigned conversions.
+/// \param Magnitude    The absolute value. Used by the signed conversions.
+/// \param IsNegative   True if the value is negative.
+///
+void
+Formatter::AppendInteger(
+    _Inout_ std::wstring& Buffer,
+    _In_ const FormatSpec& Spec,
+    _In_ UINT64 Bits,
+    _In_ UINT64 Magnitude,
+    _In_ bool IsNegative
+    )
+{
+    if (Spec.Kind == FormatArgumentKind::Character)
+    {
+        const wchar_t ch = static_cast<wchar_t>(Bits);
+
+        AppendString(Buffer, Spec, &ch, 1);
+        return;
+    }
+
+    if (Spec.Kind == FormatArgumentKind::Float)
+    {
+        AppendFloat(Buffer, Spec, IsNegative ? -static_cast<double>(Magnitude) : static_cast<double>(Magnitude));
+        return;
+    }
+
+    UINT64 value = Magnitude;
+    UINT64 base = 10;
+    const wchar_t* digits = c_FormatLowerDigits;
+    wchar_t prefix[2] = {};
+    size_t prefixLength = 0;
+
+    switch (Spec.Conversion)
+    {
+        case L'u':
+            value = Bits;
+            IsNegative = false;
+            break;
+
+        case L'o':
+            value = Bits;
+            base = 8;
+            IsNegative = false;
+            break;
+
+        case L'x':
+        case L'X':
+            value = Bits;
+            base = 16;
+            IsNegative = false;
+
+            if (Spec.Conversion == L'X')
+            {
+                digits = c_FormatUpperDigits;
+            }
+
+            if (Spec.Alternate && value != 0)
+            {
+                prefix[prefixLength++] = L'0';
+                prefix[prefixLength++] = Spec.Conversion;
+            }
+            break;
+
+        default:
+            if (IsNegative)
+            {
+                prefix[prefixLength++] = L'-';
+            }
+            else if (Spec.ForceSign)
+            {
+                prefix[prefixLength++] = L'+';
+            }
+            else if (Spec.SpaceSign)
+            {
+                prefix[prefixLength++] = L' ';
+            }
+            break;
+    }
+
+    //
+    // 22 octal digits for the largest value.
+    //
+    wchar_t reversed[24];
+    size_t count = 0;
+
+    //
+    // As in printf, a precision of 0 writes no digit for the value 0.
+    //
+    if (value != 0 || Spec.Precision != 0)
+    {
+        do
+        {
+            reversed[count++] = digits[value % base];
+            value /= base;
+        } while (value != 0);
+    }
+
+    if (Spec.Conversion == L'o' && Spec.Alternate && (count == 0 || reversed[count - 1] != L'0'))
+    {
+        reversed[count++] = L'0';
+    }
+
+    const size_t width = static_cast<size_t>(Spec.Width);
+    size_t zeros = 0;
+
+    if (Spec.Precision > 0 && static_cast<size_t>(Spec.Precision) > count)
+    {
+        zeros = static_cast<size_t>(Spec.Precision) - count;
+    }
+    else if (Spec.ZeroPad && !Spec.LeftAlign && Spec.Precision < 0 && width > prefixLength + count)
+    {
+        //
+        // The 0 flag pads between the sign and the digits, unless a
+        // precision is given.
+        //
+        zeros = width - (prefixLength + count);
+    }
+
+    const size_t length = prefixLength + zeros + count;
+    const size_t spaces = (width > length) ? width - length : 0;
+
+    if (!Spec.LeftAlign)
+    {
+        Buffer.append(spaces, L' ');
+    }
+
+    Buffer.append(prefix, prefixLength);
+    Buffer.append(zeros, L'0');
+
+    while (count > 0)
+    {
+        Buffer.push_back(reversed[--count]);
+    }
+
+    if (Spec.LeftAlign)
+    {
+        Buffer.append(spaces, L' ');
+    }
+}
+
+///
+/// Writes a floating point argument. The floating point conversions are
+/// rare, so they're left to the CRT.
+///
+void
+Formatter::AppendFloat(
+    _Inout_ std::wstring& Buffer,
+    _In_ const FormatSpec& Spec,
+    _In_ double Value
+    )
+{
+    wchar_t format[32];
+    size_t length = 0;
+
+    format[length++] = L'%';
+
+    if (Spec.LeftAlign)
+    {
+        format[length++] = L'-';
+    }
+
+    if (Spec.ZeroPad)
+    {
+        format[length++] = L'0';
+    }
+
+    if (Spec.ForceSign)
+    {
+        format[length++] = L'+';
+    }
+
+    if (Spec.SpaceSign)
+    {
+        format[length++] = L' ';
+    }
+
+    if (Spec.Alternate)
+    {
+        format[length++] = L'#';
+    }
+
+    const int precision = (Spec.Precision >= 0) ? Spec.Precision : 6;
+    const wchar_t conversion = (Spec.Kind == FormatArgumentKind::Float) ? Spec.Conversion : L'f';
+
+    if (Spec.Width > 0)
+    {
+        StringCchPrintfW(format + length, _countof(format) - length, L"%d.%d%c", Spec.Width, precision, conversion);
+    }
+    else
+    {
+        StringCchPrintfW(format + length, _countof(format) - length, L".%d%c", precision, conversion);
+    }
+
+    //
+    // Large enough for any double written with %f, which has up to 309
+    // integer digits.
+    //
+    const size_t capacity = 320 + static_cast<size_t>(Spec.Width) + static_cast<size_t>(precision);
+    const size_t start = Buffer.size();
+
+    Buffer.resize(start + capacity);
+
+    const int written = _snwprintf_s(&Buffer[start], capacity, _TRUNCATE, format, Value);
+
+    Buffer.resize(start + (written >= 0 ? written : wcslen(&Buffer[start])));
+}
+
+void
+Formatter::AppendString(
+    _Inout_ std::wstring& Buffer,
+    _In_ const FormatSpec& Spec,
+    _In_reads_(Length) const wchar_t* Value,
+    _In_ size_t Length
+    )
+{
+    const size_t start = Buffer.size();
+
+    if (Spec.Precision >= 0 && static_cast<size_t>(Spec.Precision) < Length)
+    {
+        Length = static_cast<size_t>(Spec.Precision);
+    }
+
+    Buffer.append(Value, Length);
+
+    Pad(Buffer, Spec, start);
+}
+
+///
+/// Writes a narrow string, converted from the ANSI code page. ASCII strings
+/// are copied without calling MultiByteToWideChar.
+///
+void
+Formatter::AppendNarrowString(
+    _Inout_ std::wstring& Buffer,
+    _In_ const FormatSpec& Spec,
+    _In_reads_(Length) const char* Value,
+    _In_ size_t Length
+    )
+{
+    const size_t start = Buffer.size();
+    size_t ascii = 0;
+
+    while (ascii < Length && static_cast<unsigned char>(Value[ascii]) < 0x80)
+    {
+        ascii++;
+    }
+
+    if (ascii == Length)
+    {
+        Buffer.append(Value, Value + Length);
+    }
+    else
+    {
+        const int wideLength = MultiByteToWideChar(CP_ACP, 0, Value, static_cast<int>(Length), NULL, 0);
+
+        if (wideLength > 0)
+        {
+            Buffer.resize(start + wideLength);
+            MultiByteToWideChar(CP_ACP, 0, Value, static_cast<int>(Length), &Buffer[start], wideLength);
+        }
+    }
+
+    if (Spec.Precision >= 0 && Buffer.size() - start > static_cast<size_t>(Spec.Precision))
+    {
+        Buffer.resize(start + static_cast<size_t>(Spec.Precision));
+    }
+
+    Pad(Buffer, Spec, start);
+}
+
+///
+/// Pads the value written at Start with spaces, up to the width of the
+/// conversion.
+///
+void
+Formatter::Pad(
+    _Inout_ std::wstring& Buffer,
+    _In_ const FormatSpec& Spec,
+    _In_ size_t Start
+    )
+{
+    const size_t length = Buffer.size() - Start;
+    const size_t width = static_cast<size_t>(Spec.Width);
+
+    if (width <= length)
+    {
+        return;
+    }
+
+    if (Spec.LeftAlign)
+    {
+        Buffer.append(width - length, L' ');
+    }
+    else
+    {
+        Buffer.insert(Start, width - length, L' ');
+    }
+}
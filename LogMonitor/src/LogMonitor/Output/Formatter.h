@@ -0,0 +1,528 @@
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+
+#pragma once
+
+///
+/// Kind of argument taken by a conversion of a format string.
+///
+enum class FormatArgumentKind : UINT8
+{
+    None = 0,
+    Integer,
+    Float,
+    WideString,
+    NarrowString,
+    Character,
+    Pointer,
+    Invalid
+};
+
+///
+/// A conversion of a format string, like %-10s or %08llx.
+///
+struct FormatSpec
+{
+    FormatArgumentKind Kind = FormatArgumentKind::None;
+    wchar_t Conversion = L'\0';
+    bool LeftAlign = false;
+    bool ZeroPad = false;
+    bool ForceSign = false;
+    bool SpaceSign = false;
+    bool Alternate = false;
+    int Width = 0;
+    int Precision = -1;
+};
+
+///
+/// Formats printf-style format strings, appending the result to a caller's
+/// buffer.
+///
+/// The format string is walked once, and each argument is written by an
+/// overload chosen from its type, so a buffer reused between calls doesn't
+/// allocate once it's large enough, and an argument can't be read as a
+/// different type. The length modifiers (l, ll, z, I64...) are accepted
+/// and ignored, since the type of the argument gives its size. As in the
+/// wide printf functions, %s and %ls are wide strings, and %S and %hs are
+/// narrow strings, converted from the ANSI code page. %n and the * width
+/// aren't supported.
+///
+/// Use FORMAT_STRING and APPEND_FORMAT with a literal format string: its
+/// conversions are parsed at compile time, and the number and the types of
+/// the arguments are checked against them with static_assert.
+///
+class Formatter final
+{
+public:
+    static constexpr UINT64 INVALID_SIGNATURE = ~0ULL;
+
+    //
+    // The signature of a format string keeps the kind of each argument in
+    // 4 bits, after the number of arguments.
+    //
+    static constexpr UINT64 MAX_ARGUMENTS = 15;
+
+    ///
+    /// Parses the conversion that starts after a '%'.
+    ///
+    /// \param Format   The first character after the '%'.
+    /// \param Spec     Returns the conversion. Its kind is Invalid if the
+    ///                 conversion isn't supported.
+    ///
+    /// \return The character after the conversion.
+    ///
+    static constexpr LPCWSTR ParseSpec(
+        _In_z_ LPCWSTR Format,
+        _Out_ FormatSpec& Spec
+        )
+    {
+        Spec = FormatSpec();
+
+        for (;; Format++)
+        {
+            if (*Format == L'-')
+            {
+                Spec.LeftAlign = true;
+            }
+            else if (*Format == L'0')
+            {
+                Spec.ZeroPad = true;
+            }
+            else if (*Format == L'+')
+            {
+                Spec.ForceSign = true;
+            }
+            else if (*Format == L' ')
+            {
+                Spec.SpaceSign = true;
+            }
+            else if (*Format == L'#')
+            {
+                Spec.Alternate = true;
+            }
+            else
+            {
+                break;
+            }
+        }
+
+        for (; *Format >= L'0' && *Format <= L'9'; Format++)
+        {
+            Spec.Width = Spec.Width * 10 + (*Format - L'0');
+        }
+
+        if (*Format == L'.')
+        {
+            Spec.Precision = 0;
+
+            for (Format++; *Format >= L'0' && *Format <= L'9'; Format++)
+            {
+                Spec.Precision = Spec.Precision * 10 + (*Format - L'0');
+            }
+        }
+
+        //
+        // Only h and l/w change the meaning of the conversion, for the
+        // strings and characters.
+        //
+        bool isShort = false;
+        bool isLong = false;
+
+        for (;; Format++)
+        {
+            if (*Format == L'h')
+            {
+                isShort = true;
+            }
+            else if (*Format == L'l' || *Format == L'w')
+            {
+                isLong = true;
+            }
+            else if (*Format == L'I')
+            {
+                if ((Format[1] == L'6' && Format[2] == L'4') || (Format[1] == L'3' && Format[2] == L'2'))
+                {
+                    Format += 2;
+                }
+            }
+            else if (*Format != L'L' && *Format != L'j' && *Format != L'z' && *Format != L't')
+            {
+                break;
+            }
+        }
+
+        Spec.Conversion = *Format;
+
+        switch (*Format)
+        {
+            case L'd':
+            case L'i':
+            case L'u':
+            case L'o':
+            case L'x':
+            case L'X':
+                Spec.Kind = FormatArgumentKind::Integer;
+                break;
+
+            case L'f':
+            case L'F':
+            case L'e':
+            case L'E':
+            case L'g':
+            case L'G':
+            case L'a':
+            case L'A':
+                Spec.Kind = FormatArgumentKind::Float;
+                break;
+
+            case L's':
+                Spec.Kind = isShort ? FormatArgumentKind::NarrowString : FormatArgumentKind::WideString;
+                break;
+
+            case L'S':
+                Spec.Kind = isLong ? FormatArgumentKind::WideString : FormatArgumentKind::NarrowString;
+                break;
+
+            case L'c':
+            case L'C':
+                Spec.Kind = FormatArgumentKind::Character;
+                break;
+
+            case L'p':
+                Spec.Kind = FormatArgumentKind::Pointer;
+                break;
+
+            default:
+                Spec.Kind = FormatArgumentKind::Invalid;
+                return Format;
+        }
+
+        return Format + 1;
+    }
+
+    ///
+    /// Returns the signature of a format string: the number of arguments it
+    /// takes, and the kind of each one.
+    ///
+    /// \return INVALID_SIGNATURE if a conversion isn't supported, or if the
+    ///     format string takes more than MAX_ARGUMENTS arguments.
+    ///
+    static constexpr UINT64 Signature(
+        _In_z_ LPCWSTR Format
+        )
+    {
+        UINT64 signature = 0;
+        UINT64 count = 0;
+
+        while (*Format != L'\0')
+        {
+            if (*Format++ != L'%')
+            {
+                continue;
+            }
+
+            if (*Format == L'%')
+            {
+                Format++;
+                continue;
+            }
+
+            FormatSpec spec;
+            Format = ParseSpec(Format, spec);
+
+            if (spec.Kind == FormatArgumentKind::Invalid || count == MAX_ARGUMENTS)
+            {
+                return INVALID_SIGNATURE;
+            }
+
+            signature |= static_cast<UINT64>(spec.Kind) << (4 + 4 * count);
+            count++;
+        }
+
+        return signature | count;
+    }
+
+    ///
+    /// Returns true if an argument of type T can be written by a conversion
+    /// of kind Kind.
+    ///
+    template<typename T>
+    static constexpr bool Accepts(
+        _In_ FormatArgumentKind Kind
+        )
+    {
+        using Type = std::decay_t<T>;
+
+        switch (Kind)
+        {
+            case FormatArgumentKind::Integer:
+                return std::is_integral<Type>::value || std::is_enum<Type>::value;
+
+            case FormatArgumentKind::Float:
+                return std::is_floating_point<Type>::value;
+
+            case FormatArgumentKind::WideString:
+                return std::is_same<Type, const wchar_t*>::value
+                    || std::is_same<Type, wchar_t*>::value
+                    || std::is_same<Type, std::wstring>::value;
+
+            case FormatArgumentKind::NarrowString:
+                return std::is_same<Type, const char*>::value
+                    || std::is_same<Type, char*>::value
+                    || std::is_same<Type, std::string>::value;
+
+            case FormatArgumentKind::Character:
+                return std::is_same<Type, wchar_t>::value || std::is_same<Type, char>::value;
+
+            case FormatArgumentKind::Pointer:
+                return std::is_pointer<Type>::value;
+
+            default:
+                return false;
+        }
+    }
+
+    template<UINT64 Kinds>
+    static constexpr bool ArgumentsMatch()
+    {
+        return true;
+    }
+
+    ///
+    /// Returns true if each argument type is accepted by the kind at the
+    /// same position in Kinds.
+    ///
+    template<UINT64 Kinds, typename T, typename... Rest>
+    static constexpr bool ArgumentsMatch()
+    {
+        return Accepts<T>(static_cast<FormatArgumentKind>(Kinds & 0xF))
+            && ArgumentsMatch<(Kinds >> 4), Rest...>();
+    }
+
+    ///
+    /// Appends a formatted string to Buffer.
+    ///
+    /// \param Buffer       The buffer where the string is appended.
+    /// \param Format       Format string that follows the printf specifications.
+    /// \param Arguments    Arguments of the conversions, in order.
+    ///
+    template<typename... Args>
+    static void Append(
+        _Inout_ std::wstring& Buffer,
+        _In_z_ LPCWSTR Format,
+        _In_ const Args&... Arguments
+        )
+    {
+        AppendArguments(Buffer, Format, Arguments...);
+    }
+
+    ///
+    /// Returns a formatted string.
+    ///
+    template<typename... Args>
+    static std::wstring ToString(
+        _In_z_ LPCWSTR Format,
+        _In_ const Args&... Arguments
+        )
+    {
+        std::wstring result;
+
+        AppendArguments(result, Format, Arguments...);
+
+        return result;
+    }
+
+    ///
+    /// Append, with the arguments checked against the signature of the
+    /// format string. Used by APPEND_FORMAT.
+    ///
+    template<UINT64 Signature, typename... Args>
+    static void AppendChecked(
+        _Inout_ std::wstring& Buffer,
+        _In_z_ LPCWSTR Format,
+        _In_ const Args&... Arguments
+        )
+    {
+        CheckArguments<Signature, Args...>();
+
+        AppendArguments(Buffer, Format, Arguments...);
+    }
+
+    ///
+    /// ToString, with the arguments checked against the signature of the
+    /// format string. Used by FORMAT_STRING.
+    ///
+    template<UINT64 Signature, typename... Args>
+    static std::wstring ToStringChecked(
+        _In_z_ LPCWSTR Format,
+        _In_ const Args&... Arguments
+        )
+    {
+        CheckArguments<Signature, Args...>();
+
+        std::wstring result;
+
+        AppendArguments(result, Format, Arguments...);
+
+        return result;
+    }
+
+private:
+    template<UINT64 Signature, typename... Args>
+    static void CheckArguments()
+    {
+        static_assert(Signature != INVALID_SIGNATURE,
+            "The format string has an unsupported conversion, or too many of them.");
+        static_assert((Signature & 0xF) == sizeof...(Args),
+            "The number of arguments doesn't match the format string.");
+        static_assert(ArgumentsMatch<(Signature >> 4), Args...>(),
+            "The type of an argument doesn't match its conversion in the format string.");
+    }
+
+    static LPCWSTR AppendLiteral(
+        _Inout_ std::wstring& Buffer,
+        _In_z_ LPCWSTR Format,
+        _Out_ FormatSpec& Spec
+        );
+
+    static void AppendArguments(
+        _Inout_ std::wstring& Buffer,
+        _In_z_ LPCWSTR Format
+        );
+
+    template<typename T, typename... Rest>
+    static void AppendArguments(
+        _Inout_ std::wstring& Buffer,
+        _In_z_ LPCWSTR Format,
+        _In_ const T& Argument,
+        _In_ const Rest&... Arguments
+        )
+    {
+        FormatSpec spec;
+
+        Format = AppendLiteral(Buffer, Format, spec);
+
+        if (Format == NULL)
+        {
+            return;
+        }
+
+        AppendArgument(Buffer, spec, Argument);
+        AppendArguments(Buffer, Format, Arguments...);
+    }
+
+    template<typename T>
+    static typename std::enable_if<std::is_integral<T>::value || std::is_enum<T>::value>::type
+    AppendArgument(
+        _Inout_ std::wstring& Buffer,
+        _In_ const FormatSpec& Spec,
+        _In_ T Value
+        )
+    {
+        using Integer = typename std::conditional<
+            std::is_enum<T>::value,
+            std::underlying_type<T>,
+            std::enable_if<true, T>>::type::type;
+
+        const Integer value = static_cast<Integer>(Value);
+        const bool isNegative = std::is_signed<Integer>::value && value < static_cast<Integer>(0);
+
+        AppendInteger(
+            Buffer,
+            Spec,
+            static_cast<UINT64>(static_cast<std::make_unsigned_t<Integer>>(value)),
+            isNegative ? 0 - static_cast<UINT64>(static_cast<INT64>(value)) : static_cast<UINT64>(value),
+            isNegative);
+    }
+
+    static void AppendArgument(
+        _Inout_ std::wstring& Buffer,
+        _In_ const FormatSpec& Spec,
+        _In_ bool Value
+        );
+
+    static void AppendArgument(
+        _Inout_ std::wstring& Buffer,
+        _In_ const FormatSpec& Spec,
+        _In_ double Value
+        );
+
+    static void AppendArgument(
+        _Inout_ std::wstring& Buffer,
+        _In_ const FormatSpec& Spec,
+        _In_opt_z_ const wchar_t* Value
+        );
+
+    static void AppendArgument(
+        _Inout_ std::wstring& Buffer,
+        _In_ const FormatSpec& Spec,
+        _In_ const std::wstring& Value
+        );
+
+    static void AppendArgument(
+        _Inout_ std::wstring& Buffer,
+        _In_ const FormatSpec& Spec,
+        _In_opt_z_ const char* Value
+        );
+
+    static void AppendArgument(
+        _Inout_ std::wstring& Buffer,
+        _In_ const FormatSpec& Spec,
+        _In_ const std::string& Value
+        );
+
+    static void AppendArgument(
+        _Inout_ std::wstring& Buffer,
+        _In_ const FormatSpec& Spec,
+        _In_opt_ const void* Value
+        );
+
+    static void AppendInteger(
+        _Inout_ std::wstring& Buffer,
+        _In_ const FormatSpec& Spec,
+        _In_ UINT64 Bits,
+        _In_ UINT64 Magnitude,
+        _In_ bool IsNegative
+        );
+
+    static void AppendFloat(
+        _Inout_ std::wstring& Buffer,
+        _In_ const FormatSpec& Spec,
+        _In_ double Value
+        );
+
+    static void AppendString(
+        _Inout_ std::wstring& Buffer,
+        _In_ const FormatSpec& Spec,
+        _In_reads_(Length) const wchar_t* Value,
+        _In_ size_t Length
+        );
+
+    static void AppendNarrowString(
+        _Inout_ std::wstring& Buffer,
+        _In_ const FormatSpec& Spec,
+        _In_reads_(Length) const char* Value,
+        _In_ size_t Length
+        );
+
+    static void Pad(
+        _Inout_ std::wstring& Buffer,
+        _In_ const FormatSpec& Spec,
+        _In_ size_t Start
+        );
+};
+
+///
+/// Returns a formatted wstring. The format must be a string literal.
+///
+#define FORMAT_STRING(Format, ...) \
+    Formatter::ToStringChecked<Formatter::Signature(Format)>(Format, __VA_ARGS__)
+
+///
+/// Appends a formatted string to a wstring. The format must be a string
+/// literal.
+///
+#define APPEND_FORMAT(Buffer, Format, ...) \
+    Formatter::AppendChecked<Formatter::Signature(Format)>(Buffer, Format, __VA_ARGS__)
@@ -0,0 +1,316 @@
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+
+#include "pch.h"
+
+static const char c_HexDigits[] = "0123456789abcdef";
+
+void
+JsonLineWriter::BeginObject()
+{
+    BeginValue();
+    m_buffer.push_back('{');
+    m_needsComma = false;
+}
+
+void
+JsonLineWriter::EndObject()
+{
+    m_buffer.push_back('}');
+    m_needsComma = true;
+}
+
+void
+JsonLineWriter::BeginArray()
+{
+    BeginValue();
+    m_buffer.push_back('[');
+    m_needsComma = false;
+}
+
+void
+JsonLineWriter::EndArray()
+{
+    m_buffer.push_back(']');
+    m_needsComma = true;
+}
+
+///
+/// Writes the name of the next member of an object.
+///
+/// \param Name     The name, in UTF-8.
+///
+void
+JsonLineWriter::Key(
+    _In_z_ const char* Name
+    )
+{
+    BeginValue();
+    AppendEscaped(Name, strlen(Name));
+    m_buffer.push_back(':');
+    m_needsComma = false;
+}
+
+void
+JsonLineWriter::Key(
+    _In_z_ const wchar_t* Name
+    )
+{
+    BeginValue();
+    AppendEscaped(Name, wcslen(Name));
+    m_buffer.push_back(':');
+    m_needsComma = false;
+}
+
+///
+/// Writes a UTF-16 string, transcoded to UTF-8. Unpaired surrogates are
+/// replaced by U+FFFD.
+///
+void
+JsonLineWriter::String(
+    _In_reads_(Length) const wchar_t* Value,
+    _In_ size_t Length
+    )
+{
+    BeginValue();
+    AppendEscaped(Value, Length);
+    m_needsComma = true;
+}
+
+void
+JsonLineWriter::String(
+    _In_z_ const wchar_t* Value
+    )
+{
+    String(Value, wcslen(Value));
+}
+
+///
+/// Writes a UTF-8 string. It must be valid UTF-8, only the characters that
+/// JSON requires to escape are changed.
+///
+void
+JsonLineWriter::String(
+    _In_reads_(Length) const char* Value,
+    _In_ size_t Length
+    )
+{
+    BeginValue();
+    AppendEscaped(Value, Length);
+    m_needsComma = true;
+}
+
+void
+JsonLineWriter::String(
+    _In_z_ const char* Value
+    )
+{
+    String(Value, strlen(Value));
+}
+
+void
+JsonLineWriter::Number(
+    _In_ UINT64 Value
+    )
+{
+    char digits[20];
+    size_t count = 0;
+
+    do
+    {
+        digits[count++] = static_cast<char>('0' + Value % 10);
+        Value /= 10;
+    } while (Value != 0);
+
+    BeginValue();
+
+    while (count > 0)
+    {
+        m_buffer.push_back(digits[--count]);
+    }
+
+    m_needsComma = true;
+}
+
+///
+/// Writes a number as a "0x" prefixed hexadecimal string, used for masks
+/// like the ETW keywords.
+///
+void
+JsonLineWriter::HexNumberString(
+    _In_ UINT64 Value
+    )
+{
+    char digits[16];
+    size_t count = 0;
+
+    do
+    {
+        digits[count++] = c_HexDigits[Value & 0xF];
+        Value >>= 4;
+    } while (Value != 0);
+
+    BeginValue();
+    m_buffer.append("\"0x");
+
+    while (count > 0)
+    {
+        m_buffer.push_back(digits[--count]);
+    }
+
+    m_buffer.push_back('"');
+    m_needsComma = true;
+}
+
+///
+/// Writes a UTC time as an ISO 8601 string, with the timestamp precision of
+/// the process.
+///
+void
+JsonLineWriter::Time(
+    _In_ const FILETIME& Value
+    )
+{
+    BeginValue();
+    m_buffer.push_back('"');
+    TimestampFormatter::ForCurrentThread().Append(m_buffer, Value);
+    m_buffer.push_back('"');
+    m_needsComma = true;
+}
+
+///
+/// Writes a value that is already valid JSON on a single line, like a log
+/// line parsed by JsonLineParser, as it is.
+///
+void
+JsonLineWriter::Raw(
+    _In_reads_(Length) const char* Value,
+    _In_ size_t Length
+    )
+{
+    BeginValue();
+    m_buffer.append(Value, Length);
+    m_needsComma = true;
+}
+
+void
+JsonLineWriter::BeginValue()
+{
+    if (m_needsComma)
+    {
+        m_buffer.push_back(',');
+    }
+}
+
+void
+JsonLineWriter::AppendEscaped(
+    _In_reads_(Length) const wchar_t* Value,
+    _In_ size_t Length
+    )
+{
+    m_buffer.reserve(m_buffer.size() + Length + 2);
+    m_buffer.push_back('"');
+
+    size_t i = 0;
+
+    while (i < Length)
+    {
+        const wchar_t ch = Value[i];
+
+        if (ch >= 0x80)
+        {
+            //
+            // Transcode the whole run of non-ASCII characters at once. A
+            // surrogate pair is never split, since both halves are in it.
+            //
+            size_t end = i + 1;
+
+            while (end < Length && Value[end] >= 0x80)
+            {
+                end++;
+            }
+
+            Utility::AppendUtf8(m_buffer, Value + i, end - i);
+            i = end;
+            continue;
+        }
+
+        if (ch < 0x20 || ch == L'"' || ch == L'\\')
+        {
+            AppendEscapedAscii(static_cast<char>(ch));
+        }
+        else
+        {
+            m_buffer.push_back(static_cast<char>(ch));
+        }
+
+        i++;
+    }
+
+    m_buffer.push_back('"');
+}
+
+void
+JsonLineWriter::AppendEscaped(
+    _In_reads_(Length) const char* Value,
+    _In_ size_t Length
+    )
+{
+    m_buffer.reserve(m_buffer.size() + Length + 2);
+    m_buffer.push_back('"');
+
+    size_t start = 0;
+
+    for (size_t i = 0; i < Length; i++)
+    {
+        const unsigned char ch = static_cast<unsigned char>(Value[i]);
+
+        if (ch < 0x20 || ch == '"' || ch == '\\')
+        {
+            m_buffer.append(Value + start, i - start);
+            AppendEscapedAscii(static_cast<char>(ch));
+            start = i + 1;
+        }
+    }
+
+    m_buffer.append(Value + start, Length - start);
+    m_buffer.push_back('"');
+}
+
+void
+JsonLineWriter::AppendEscapedAscii(
+    _In_ char Character
+    )
+{
+    m_buffer.push_back('\\');
+
+    switch (Character)
+    {
+        case '"':
+        case '\\':
+            m_buffer.push_back(Character);
+            break;
+        case '\b':
+            m_buffer.push_back('b');
+            break;
+        case '\f':
+            m_buffer.push_back('f');
+            break;
+        case '\n':
+            m_buffer.push_back('n');
+            break;
+        case '\r':
+            m_buffer.push_back('r');
+            break;
+        case '\t':
+            m_buffer.push_back('t');
+            break;
+        default:
+            m_buffer.append("u00");
+            m_buffer.push_back(c_HexDigits[(Character >> 4) & 0xF]);
+            m_buffer.push_back(c_HexDigits[Character & 0xF]);
+            break;
+    }
+}
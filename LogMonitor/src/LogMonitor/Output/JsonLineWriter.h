@@ -0,0 +1,108 @@
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+
+#pragma once
+
+///
+/// Writes a JSON value on a single line, in UTF-8, at the end of a caller's
+/// buffer. It's used to write the log lines in the JSON output format.
+///
+/// Values are escaped and transcoded as they are appended, in a single pass
+/// and without intermediate strings, so a buffer reused between lines
+/// doesn't allocate once it's large enough. Control characters, including
+/// line breaks, are escaped, so a value never spans several lines.
+///
+/// The writer adds the commas between members and array elements. It
+/// doesn't check that the calls make a valid JSON document.
+///
+class JsonLineWriter final
+{
+public:
+    JsonLineWriter(
+        _Inout_ std::string& Buffer
+        ) :
+        m_buffer(Buffer)
+    {
+    }
+
+    JsonLineWriter(const JsonLineWriter&) = delete;
+    JsonLineWriter& operator=(const JsonLineWriter&) = delete;
+
+    void BeginObject();
+
+    void EndObject();
+
+    void BeginArray();
+
+    void EndArray();
+
+    void Key(
+        _In_z_ const char* Name
+        );
+
+    void Key(
+        _In_z_ const wchar_t* Name
+        );
+
+    void String(
+        _In_reads_(Length) const wchar_t* Value,
+        _In_ size_t Length
+        );
+
+    void String(
+        _In_z_ const wchar_t* Value
+        );
+
+    void String(
+        _In_reads_(Length) const char* Value,
+        _In_ size_t Length
+        );
+
+    void String(
+        _In_z_ const char* Value
+        );
+
+    void Number(
+        _In_ UINT64 Value
+        );
+
+    void HexNumberString(
+        _In_ UINT64 Value
+        );
+
+    void Time(
+        _In_ const FILETIME& Value
+        );
+
+    void Raw(
+        _In_reads_(Length) const char* Value,
+        _In_ size_t Length
+        );
+
+private:
+    std::string& m_buffer;
+
+    //
+    // A value was written in the current object or array, so the next one
+    // is preceded by a comma.
+    //
+    bool m_needsComma = false;
+
+    void BeginValue();
+
+    void AppendEscaped(
+        _In_reads_(Length) const wchar_t* Value,
+        _In_ size_t Length
+        );
+
+    void AppendEscaped(
+        _In_reads_(Length) const char* Value,
+        _In_ size_t Length
+        );
+
+    void AppendEscapedAscii(
+        _In_ char Character
+        );
+};
@@ -0,0 +1,149 @@
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+
+#include "pch.h"
+
+constexpr size_t LogRecordRing::DEFAULT_CAPACITY;
+
+///
+/// \param Capacity     Number of slots, rounded up to a power of two.
+///
+LogRecordRing::LogRecordRing(
+    _In_ size_t Capacity
+    ) :
+    m_enqueuePosition(0),
+    m_dequeuePosition(0)
+{
+    size_t capacity = 2;
+
+    while (capacity < Capacity)
+    {
+        capacity <<= 1;
+    }
+
+    m_slots = std::make_unique<Slot[]>(capacity);
+    m_mask = capacity - 1;
+
+    for (size_t i = 0; i < capacity; i++)
+    {
+        m_slots[i].Sequence.store(i, std::memory_order_relaxed);
+    }
+}
+
+///
+/// Adds a record at the end of the ring.
+///
+/// \param Record       The record. It's moved into the ring on success, and
+///                     left unchanged if the ring is full.
+/// \param SourceId     Id of the source of the record.
+///
+/// \return False if the ring is full.
+///
+bool
+LogRecordRing::TryPush(
+    _Inout_ std::string& Record,
+    _In_ UINT32 SourceId
+    )
+{
+    size_t position = m_enqueuePosition.load(std::memory_order_relaxed);
+
+    for (;;)
+    {
+        Slot& slot = m_slots[position & m_mask];
+        const size_t sequence = slot.Sequence.load(std::memory_order_acquire);
+        const intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+
+        if (difference == 0)
+        {
+            if (m_enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+            {
+                slot.Record.swap(Record);
+                slot.SourceId = SourceId;
+                Record.clear();
+
+                slot.Sequence.store(position + 1, std::memory_order_release);
+
+                return true;
+            }
+        }
+        else if (difference < 0)
+        {
+            //
+            // The slot still holds the record of the previous lap.
+            //
+            return false;
+        }
+        else
+        {
+            position = m_enqueuePosition.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+///
+/// Removes the first record of the ring. Must only be called by one thread
+/// at a time.
+///
+/// \param Record       Returns the record. Its previous buffer is left in the
+///                     slot, to be reused by the next producer.
+/// \param SourceId     Optionally returns the id of the source of the record.
+///
+/// \return False if the ring is empty, or the first record isn't published
+///     yet.
+///
+bool
+LogRecordRing::TryPop(
+    _Out_ std::string& Record,
+    _Out_opt_ UINT32* SourceId
+    )
+{
+    const size_t position = m_dequeuePosition.load(std::memory_order_relaxed);
+    Slot& slot = m_slots[position & m_mask];
+
+    if (slot.Sequence.load(std::memory_order_acquire) != position + 1)
+    {
+        return false;
+    }
+
+    Record.swap(slot.Record);
+    slot.Record.clear();
+
+    if (SourceId != nullptr)
+    {
+        *SourceId = slot.SourceId;
+    }
+
+    m_dequeuePosition.store(position + 1, std::memory_order_relaxed);
+    slot.Sequence.store(position + m_mask + 1, std::memory_order_release);
+
+    return true;
+}
+
+///
+/// Gets the source id of the first record of the ring, without removing it.
+/// Must only be called by the thread allowed to call TryPop.
+///
+/// \param SourceId     Returns the id of the source of the first record.
+///
+/// \return False if the ring is empty, or the first record isn't published
+///     yet.
+///
+bool
+LogRecordRing::TryPeekSourceId(
+    _Out_ UINT32& SourceId
+    ) const
+{
+    const size_t position = m_dequeuePosition.load(std::memory_order_relaxed);
+    const Slot& slot = m_slots[position & m_mask];
+
+    if (slot.Sequence.load(std::memory_order_acquire) != position + 1)
+    {
+        return false;
+    }
+
+    SourceId = slot.SourceId;
+
+    return true;
+}
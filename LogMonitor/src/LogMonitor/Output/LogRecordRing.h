@@ -0,0 +1,87 @@
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+
+#pragma once
+
+///
+/// Bounded ring of output records, written by any number of threads and
+/// read by a single one, without locks. A record is a UTF-8 line, tagged
+/// with the id of the source that wrote it.
+///
+/// Each slot has a sequence number. A producer claims a slot by advancing
+/// the enqueue position with a compare-exchange, moves its record in, and
+/// publishes it by storing the next sequence number. The consumer takes the
+/// slots in order once they are published. A producer never waits for
+/// another one, except for the slot it claimed to be consumed when the ring
+/// is full, in which case TryPush fails instead.
+///
+class LogRecordRing final
+{
+public:
+    static constexpr size_t DEFAULT_CAPACITY = 16 * 1024;
+
+    LogRecordRing(
+        _In_ size_t Capacity = DEFAULT_CAPACITY
+        );
+
+    LogRecordRing(const LogRecordRing&) = delete;
+    LogRecordRing& operator=(const LogRecordRing&) = delete;
+
+    bool TryPush(
+        _Inout_ std::string& Record,
+        _In_ UINT32 SourceId = 0
+        );
+
+    bool TryPop(
+        _Out_ std::string& Record,
+        _Out_opt_ UINT32* SourceId = nullptr
+        );
+
+    bool TryPeekSourceId(
+        _Out_ UINT32& SourceId
+        ) const;
+
+    size_t Capacity() const
+    {
+        return m_mask + 1;
+    }
+
+    ///
+    /// Number of slots claimed and not consumed yet. Only a hint while
+    /// producers are running.
+    ///
+    size_t ApproximateSize() const
+    {
+        return m_enqueuePosition.load(std::memory_order_relaxed)
+            - m_dequeuePosition.load(std::memory_order_relaxed);
+    }
+
+    ///
+    /// Number of records pushed since the ring was created, including
+    /// the ones being moved in.
+    ///
+    UINT64 EnqueuePosition() const
+    {
+        return m_enqueuePosition.load(std::memory_order_acquire);
+    }
+
+private:
+    struct Slot
+    {
+        std::atomic<size_t> Sequence;
+        std::string Record;
+        UINT32 SourceId = 0;
+    };
+
+    std::unique_ptr<Slot[]> m_slots;
+    size_t m_mask;
+
+    //
+    // On separate cache lines, so the producers and the consumer don't
+    // invalidate each other's position.
+    //
+    alignas(64) std::atomic<size_t> m_enqueuePosition;
+    alignas(64) std::atomic<size_t> m_dequeuePosition;
+};
@@ -0,0 +1,325 @@
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+
+#include "pch.h"
+
+constexpr size_t Lz4BlockCodec::MAX_OFFSET;
+constexpr UINT32 Lz4BlockCodec::HASH_BITS;
+
+//
+// Limits of the LZ4 block format: a match is at least 4 bytes, the last 5
+// bytes of a block are literals, and the last match starts at least 12 bytes
+// before the end of the block.
+//
+static constexpr size_t c_Lz4MinMatch = 4;
+static constexpr size_t c_Lz4LastLiterals = 5;
+static constexpr size_t c_Lz4MatchFindLimit = 12;
+
+//
+// The search step grows by one every 2^c_Lz4SkipTrigger positions without a
+// match.
+//
+static constexpr size_t c_Lz4SkipTrigger = 6;
+
+static inline UINT32
+Lz4Read32(
+    _In_reads_bytes_(4) const UINT8* Data
+    )
+{
+    UINT32 value;
+    memcpy(&value, Data, sizeof(value));
+
+    return value;
+}
+
+static inline UINT32
+Lz4Hash(
+    _In_ UINT32 Sequence
+    )
+{
+    return (Sequence * 2654435761U) >> (32 - Lz4BlockCodec::HASH_BITS);
+}
+
+///
+/// Writes the 255-byte continuation of a length that didn't fit in its 4
+/// bits of the token.
+///
+static inline UINT8*
+Lz4WriteLength(
+    _Out_ UINT8* Output,
+    _In_ size_t Length
+    )
+{
+    while (Length >= 255)
+    {
+        *Output++ = 255;
+        Length -= 255;
+    }
+
+    *Output++ = static_cast<UINT8>(Length);
+
+    return Output;
+}
+
+///
+/// Writes a sequence: the token, the literals and, unless it's the last
+/// sequence, the offset and the length of the match.
+///
+static inline UINT8*
+Lz4WriteSequence(
+    _Out_ UINT8* Output,
+    _In_reads_bytes_(LiteralLength) const UINT8* Literals,
+    _In_ size_t LiteralLength,
+    _In_ size_t Offset,
+    _In_ size_t MatchLength
+    )
+{
+    UINT8* token = Output++;
+
+    if (LiteralLength >= 15)
+    {
+        *token = 15 << 4;
+        Output = Lz4WriteLength(Output, LiteralLength - 15);
+    }
+    else
+    {
+        *token = static_cast<UINT8>(LiteralLength << 4);
+    }
+
+    memcpy(Output, Literals, LiteralLength);
+    Output += LiteralLength;
+
+    if (MatchLength == 0)
+    {
+        return Output;
+    }
+
+    *Output++ = static_cast<UINT8>(Offset);
+    *Output++ = static_cast<UINT8>(Offset >> 8);
+
+    const size_t length = MatchLength - c_Lz4MinMatch;
+
+    if (length >= 15)
+    {
+        *token |= 15;
+        Output = Lz4WriteLength(Output, length - 15);
+    }
+    else
+    {
+        *token |= static_cast<UINT8>(length);
+    }
+
+    return Output;
+}
+
+///
+/// \param DestinationCapacity  At least GetMaxCompressedSize(SourceSize).
+///
+/// \return The size of the compressed block, or 0 if the destination is
+///     too small.
+///
+size_t
+Lz4BlockCodec::Compress(
+    _In_reads_bytes_(SourceSize) const char* Source,
+    _In_ size_t SourceSize,
+    _Out_writes_bytes_to_(DestinationCapacity, return) char* Destination,
+    _In_ size_t DestinationCapacity
+    )
+{
+    if (DestinationCapacity < GetMaxCompressedSize(SourceSize) || SourceSize > MAXUINT32)
+    {
+        return 0;
+    }
+
+    const UINT8* source = reinterpret_cast<const UINT8*>(Source);
+    UINT8* output = reinterpret_cast<UINT8*>(Destination);
+
+    size_t anchor = 0;
+
+    if (SourceSize > c_Lz4MatchFindLimit)
+    {
+        const size_t matchFindLimit = SourceSize - c_Lz4MatchFindLimit;
+        const size_t matchLimit = SourceSize - c_Lz4LastLiterals;
+
+        memset(m_hashTable, 0, sizeof(m_hashTable));
+
+        size_t position = 1;
+        m_hashTable[Lz4Hash(Lz4Read32(source))] = 0;
+
+        while (position <= matchFindLimit)
+        {
+            const UINT32 sequence = Lz4Read32(source + position);
+            const UINT32 hash = Lz4Hash(sequence);
+            size_t candidate = m_hashTable[hash];
+
+            m_hashTable[hash] = static_cast<UINT32>(position);
+
+            if (position - candidate > MAX_OFFSET || Lz4Read32(source + candidate) != sequence)
+            {
+                position += 1 + ((position - anchor) >> c_Lz4SkipTrigger);
+                continue;
+            }
+
+            size_t matchStart = position;
+
+            //
+            // Extend the match backward over the pending literals.
+            //
+            while (matchStart > anchor && candidate > 0 && source[matchStart - 1] == source[candidate - 1])
+            {
+                matchStart--;
+                candidate--;
+            }
+
+            size_t matchEnd = position + c_Lz4MinMatch;
+            size_t candidateEnd = candidate + (matchEnd - matchStart);
+
+            while (matchEnd < matchLimit && source[matchEnd] == source[candidateEnd])
+            {
+                matchEnd++;
+                candidateEnd++;
+            }
+
+            output = Lz4WriteSequence(
+                output,
+                source + anchor,
+                matchStart - anchor,
+                matchStart - candidate,
+                matchEnd - matchStart);
+
+            anchor = matchEnd;
+            position = matchEnd;
+
+            //
+            // Index a position inside the match, so the next match can start
+            // right after this one.
+            //
+            if (position - 2 <= matchFindLimit)
+            {
+                m_hashTable[Lz4Hash(Lz4Read32(source + position - 2))] = static_cast<UINT32>(position - 2);
+            }
+        }
+    }
+
+    output = Lz4WriteSequence(output, source + anchor, SourceSize - anchor, 0, 0);
+
+    return output - reinterpret_cast<UINT8*>(Destination);
+}
+
+bool
+Lz4BlockCodec::Decompress(
+    _In_reads_bytes_(SourceSize) const char* Source,
+    _In_ size_t SourceSize,
+    _Out_writes_bytes_(DestinationSize) char* Destination,
+    _In_ size_t DestinationSize
+    )
+{
+    const UINT8* source = reinterpret_cast<const UINT8*>(Source);
+    const UINT8* const sourceEnd = source + SourceSize;
+    UINT8* output = reinterpret_cast<UINT8*>(Destination);
+    UINT8* const outputEnd = output + DestinationSize;
+
+    for (;;)
+    {
+        if (source == sourceEnd)
+        {
+            return false;
+        }
+
+        const UINT8 token = *source++;
+        size_t literalLength = token >> 4;
+
+        if (literalLength == 15)
+        {
+            UINT8 extra;
+
+            do
+            {
+                if (source == sourceEnd)
+                {
+                    return false;
+                }
+
+                extra = *source++;
+                literalLength += extra;
+            } while (extra == 255);
+        }
+
+        if (literalLength > static_cast<size_t>(sourceEnd - source)
+            || literalLength > static_cast<size_t>(outputEnd - output))
+        {
+            return false;
+        }
+
+        memcpy(output, source, literalLength);
+        source += literalLength;
+        output += literalLength;
+
+        //
+        // The last sequence has no match.
+        //
+        if (source == sourceEnd)
+        {
+            return output == outputEnd;
+        }
+
+        if (sourceEnd - source < 2)
+        {
+            return false;
+        }
+
+        const size_t offset = source[0] | (static_cast<size_t>(source[1]) << 8);
+        source += 2;
+
+        if (offset == 0 || offset > static_cast<size_t>(output - reinterpret_cast<UINT8*>(Destination)))
+        {
+            return false;
+        }
+
+        size_t matchLength = token & 15;
+
+        if (matchLength == 15)
+        {
+            UINT8 extra;
+
+            do
+            {
+                if (source == sourceEnd)
+                {
+                    return false;
+                }
+
+                extra = *source++;
+                matchLength += extra;
+            } while (extra == 255);
+        }
+
+        matchLength += c_Lz4MinMatch;
+
+        if (matchLength > static_cast<size_t>(outputEnd - output))
+        {
+            return false;
+        }
+
+        const UINT8* match = output - offset;
+
+        if (offset >= matchLength)
+        {
+            memcpy(output, match, matchLength);
+            output += matchLength;
+        }
+        else
+        {
+            //
+            // The match overlaps the bytes it writes, like a run of the same
+            // byte, so it's copied byte by byte.
+            //
+            for (size_t i = 0; i < matchLength; i++)
+            {
+                *output++ = *match++;
+            }
+        }
+    }
+}
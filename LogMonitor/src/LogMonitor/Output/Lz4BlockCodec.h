@@ -0,0 +1,64 @@
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+
+#pragma once
+
+///
+/// Compresses blocks in the LZ4 block format, so they can also be read by
+/// the LZ4 library (LZ4_decompress_safe).
+///
+/// The compressor is a greedy single-pass LZ77: each position's next 4
+/// bytes are hashed into a table of the last position with the same hash,
+/// and a candidate that matches is extended as far as possible. The search
+/// skips ahead faster in data that doesn't match, so incompressible data
+/// costs little. The decompressor checks every length and offset against
+/// the buffers, so a corrupted block fails instead of overflowing.
+///
+class Lz4BlockCodec final : public BlockCodec
+{
+public:
+    //
+    // Matches can't be further back than the 16-bit offset of the format.
+    //
+    static constexpr size_t MAX_OFFSET = 65535;
+
+    //
+    // The hash table has 2^HASH_BITS positions, 16 KB, so it stays in the
+    // L1 cache.
+    //
+    static constexpr UINT32 HASH_BITS = 12;
+
+    CompressionCodec GetId() const override
+    {
+        return CompressionCodec::Lz4;
+    }
+
+    size_t GetMaxCompressedSize(
+        _In_ size_t Size
+        ) const override
+    {
+        return Size + Size / 255 + 16;
+    }
+
+    size_t Compress(
+        _In_reads_bytes_(SourceSize) const char* Source,
+        _In_ size_t SourceSize,
+        _Out_writes_bytes_to_(DestinationCapacity, return) char* Destination,
+        _In_ size_t DestinationCapacity
+        ) override;
+
+    bool Decompress(
+        _In_reads_bytes_(SourceSize) const char* Source,
+        _In_ size_t SourceSize,
+        _Out_writes_bytes_(DestinationSize) char* Destination,
+        _In_ size_t DestinationSize
+        ) override;
+
+private:
+    //
+    // Position of the last 4 bytes seen for each hash, in the current block.
+    //
+    UINT32 m_hashTable[1 << HASH_BITS];
+};
@@ -0,0 +1,1005 @@
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+
+#include "pch.h"
+
+constexpr DWORD NetworkSink::DEFAULT_MAX_BATCH_RECORDS;
+constexpr size_t NetworkSink::DEFAULT_MAX_BATCH_BYTES;
+constexpr DWORD NetworkSink::DEFAULT_MAX_BATCH_DELAY_MILLIS;
+constexpr size_t NetworkSink::DEFAULT_MAX_BUFFERED_BYTES;
+constexpr DWORD NetworkSink::DEFAULT_MIN_RECONNECT_DELAY_MILLIS;
+constexpr DWORD NetworkSink::DEFAULT_MAX_RECONNECT_DELAY_MILLIS;
+constexpr USHORT NetworkSink::DEFAULT_SYSLOG_PORT;
+constexpr USHORT NetworkSink::DEFAULT_FLUENT_FORWARD_PORT;
+constexpr size_t NetworkSink::MAX_DATAGRAM_BYTES;
+constexpr DWORD NetworkSink::STOP_TIMEOUT_MILLIS;
+
+//
+// PRI of the syslog messages: facility user-level (1), severity
+// informational (6). The lines are opaque to the sink, so they all have the
+// same severity.
+//
+static const char c_SyslogHeader[] = "<14>1 ";
+
+//
+// RFC 5424 limits the APP-NAME to 48 printable ASCII characters.
+//
+static constexpr size_t c_SyslogMaxAppNameLength = 48;
+
+//
+// A send that blocks longer than this closes the connection, so a collector
+// that stopped reading is connected again.
+//
+static constexpr DWORD c_NetworkSendTimeoutMillis = 30000;
+
+//
+// Seconds from 1601-01-01, the epoch of FILETIME, to 1970-01-01, the epoch
+// of the Fluent Forward EventTime.
+//
+static constexpr UINT64 c_UnixEpochSeconds = 11644473600ULL;
+
+static inline void
+AppendBigEndian(
+    _Inout_ std::string& Buffer,
+    _In_ UINT32 Value,
+    _In_ size_t Bytes
+    )
+{
+    for (size_t i = Bytes; i > 0; i--)
+    {
+        Buffer += static_cast<char>((Value >> (8 * (i - 1))) & 0xFF);
+    }
+}
+
+///
+/// Appends the header of a MessagePack str of the given length.
+///
+static void
+AppendMessagePackStringHeader(
+    _Inout_ std::string& Buffer,
+    _In_ size_t Length
+    )
+{
+    if (Length < 32)
+    {
+        Buffer += static_cast<char>(0xA0 | Length);
+    }
+    else if (Length <= 0xFF)
+    {
+        Buffer += static_cast<char>(0xD9);
+        AppendBigEndian(Buffer, static_cast<UINT32>(Length), 1);
+    }
+    else if (Length <= 0xFFFF)
+    {
+        Buffer += static_cast<char>(0xDA);
+        AppendBigEndian(Buffer, static_cast<UINT32>(Length), 2);
+    }
+    else
+    {
+        Buffer += static_cast<char>(0xDB);
+        AppendBigEndian(Buffer, static_cast<UINT32>(Length), 4);
+    }
+}
+
+///
+/// Appends the header of a MessagePack array of the given size.
+///
+static void
+AppendMessagePackArrayHeader(
+    _Inout_ std::string& Buffer,
+    _In_ size_t Size
+    )
+{
+    if (Size < 16)
+    {
+        Buffer += static_cast<char>(0x90 | Size);
+    }
+    else if (Size <= 0xFFFF)
+    {
+        Buffer += static_cast<char>(0xDC);
+        AppendBigEndian(Buffer, static_cast<UINT32>(Size), 2);
+    }
+    else
+    {
+        Buffer += static_cast<char>(0xDD);
+        AppendBigEndian(Buffer, static_cast<UINT32>(Size), 4);
+    }
+}
+
+///
+/// \param Settings     The collector and the batching settings. Zero values
+///                     are replaced by the defaults.
+///
+NetworkSink::NetworkSink(
+    _In_ const NetworkOutputSettings& Settings
+    ) :
+    m_settings(Settings),
+    m_maxBatchBytes(Settings.MaxBatchBytes != 0
+        ? static_cast<size_t>((std::min)(Settings.MaxBatchBytes, static_cast<UINT64>(SIZE_MAX)))
+        : DEFAULT_MAX_BATCH_BYTES),
+    m_maxBufferedBytes(Settings.MaxBufferedBytes != 0
+        ? static_cast<size_t>((std::min)(Settings.MaxBufferedBytes, static_cast<UINT64>(SIZE_MAX)))
+        : DEFAULT_MAX_BUFFERED_BYTES),
+    m_timestamps((std::min)(TimestampFormatter::GetDefaultPrecision(), TimestampPrecision::Microseconds))
+{
+    InitializeSRWLock(&m_lock);
+    InitializeConditionVariable(&m_pendingReady);
+
+    //
+    // A Fluent Forward message holds a whole batch, so it needs a stream.
+    //
+    if (m_settings.Framing == NetworkFraming::FluentForward)
+    {
+        m_settings.Protocol = NetworkProtocol::Tcp;
+    }
+
+    if (m_settings.Port == 0)
+    {
+        m_settings.Port = (m_settings.Framing == NetworkFraming::FluentForward)
+            ? DEFAULT_FLUENT_FORWARD_PORT
+            : DEFAULT_SYSLOG_PORT;
+    }
+
+    if (m_settings.MaxBatchRecords == 0)
+    {
+        m_settings.MaxBatchRecords = DEFAULT_MAX_BATCH_RECORDS;
+    }
+
+    if (m_settings.MaxBatchDelayMillis == 0)
+    {
+        m_settings.MaxBatchDelayMillis = DEFAULT_MAX_BATCH_DELAY_MILLIS;
+    }
+
+    if (m_settings.MinReconnectDelayMillis == 0)
+    {
+        m_settings.MinReconnectDelayMillis = DEFAULT_MIN_RECONNECT_DELAY_MILLIS;
+    }
+
+    if (m_settings.MaxReconnectDelayMillis == 0)
+    {
+        m_settings.MaxReconnectDelayMillis = DEFAULT_MAX_RECONNECT_DELAY_MILLIS;
+    }
+
+    m_settings.MaxReconnectDelayMillis =
+        (std::max)(m_settings.MaxReconnectDelayMillis, m_settings.MinReconnectDelayMillis);
+    m_reconnectDelayMillis = m_settings.MinReconnectDelayMillis;
+
+    m_tag = Utility::WideToUtf8(m_settings.Tag);
+
+    if (m_settings.Framing == NetworkFraming::Syslog)
+    {
+        if (m_tag.size() > c_SyslogMaxAppNameLength)
+        {
+            m_tag.resize(c_SyslogMaxAppNameLength);
+        }
+
+        for (char& c : m_tag)
+        {
+            if (c < '!' || c > '~')
+            {
+                c = '_';
+            }
+        }
+
+        if (m_tag.empty())
+        {
+            m_tag = "-";
+        }
+
+        char hostName[256];
+        DWORD hostNameLength = _countof(hostName);
+
+        if (GetComputerNameExA(ComputerNameDnsHostname, hostName, &hostNameLength) && hostNameLength > 0)
+        {
+            m_hostName.assign(hostName, hostNameLength);
+        }
+        else
+        {
+            m_hostName = "-";
+        }
+
+        m_processId = std::to_string(GetCurrentProcessId());
+    }
+
+    if (!m_settings.QueueDirectory.empty())
+    {
+        m_queue = std::make_unique<DurableQueue>(
+            m_settings.QueueDirectory,
+            m_settings.QueueMaxBytes,
+            m_settings.QueueSegmentBytes);
+    }
+}
+
+///
+/// Starts the sender thread. The lines appended before, and the lines left
+/// in the queue by the previous run, are sent once it's connected. When the
+/// queue can't be opened, the lines are kept in memory only.
+///
+/// \return ERROR_SUCCESS, or the error of WSAStartup or CreateThread.
+///
+DWORD
+NetworkSink::Start()
+{
+    if (m_senderThread != NULL)
+    {
+        return ERROR_SUCCESS;
+    }
+
+    if (m_queue)
+    {
+        const DWORD queueStatus = m_queue->Open();
+
+        if (queueStatus != ERROR_SUCCESS)
+        {
+            logWriter.TraceError(
+                FORMAT_STRING(
+                    L"Failed to open the queue directory %s. The log lines are kept in memory only. Error: %lu",
+                    m_queue->GetDirectory(),
+                    queueStatus
+                ).c_str()
+            );
+
+            m_queue.reset();
+        }
+        else if (m_queue->GetStatistics().ReplayedRecords > 0)
+        {
+            logWriter.TraceInfo(
+                FORMAT_STRING(
+                    L"Sending %llu log lines left in the queue directory %s.",
+                    m_queue->GetStatistics().ReplayedRecords,
+                    m_queue->GetDirectory()
+                ).c_str()
+            );
+        }
+    }
+
+    WSADATA wsaData;
+    const int wsaError = WSAStartup(MAKEWORD(2, 2), &wsaData);
+
+    if (wsaError != 0)
+    {
+        return static_cast<DWORD>(wsaError);
+    }
+
+    m_winsockStarted = true;
+
+    m_stopEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+
+    if (m_stopEvent == NULL)
+    {
+        const DWORD status = GetLastError();
+
+        Stop();
+
+        return status;
+    }
+
+    m_senderThread = CreateThread(NULL, 0, SenderThreadStatic, this, 0, NULL);
+
+    if (m_senderThread == NULL)
+    {
+        const DWORD status = GetLastError();
+
+        Stop();
+
+        return status;
+    }
+
+    return ERROR_SUCCESS;
+}
+
+///
+/// Sends the pending lines and stops the sender thread. If the sender can't
+/// send them within STOP_TIMEOUT_MILLIS, the connection is closed and they
+/// are dropped, or left in the queue for the next start. The lines appended
+/// afterwards are dropped.
+///
+void
+NetworkSink::Stop()
+{
+    if (m_senderThread != NULL)
+    {
+        AcquireSRWLockExclusive(&m_lock);
+        m_stopping = true;
+        ReleaseSRWLockExclusive(&m_lock);
+
+        WakeAllConditionVariable(&m_pendingReady);
+        SetEvent(m_stopEvent);
+
+        if (WaitForSingleObject(m_senderThread, STOP_TIMEOUT_MILLIS) != WAIT_OBJECT_0)
+        {
+            //
+            // The sender is blocked in a connect or a send. Closing the
+            // socket makes it fail.
+            //
+            CloseSocket();
+
+            WaitForSingleObject(m_senderThread, INFINITE);
+        }
+
+        CloseHandle(m_senderThread);
+        m_senderThread = NULL;
+
+        AcquireSRWLockExclusive(&m_lock);
+
+        m_stopped = true;
+        m_droppedRecords += m_pendingEnds.size();
+        m_pending.clear();
+        m_pendingEnds.clear();
+
+        ReleaseSRWLockExclusive(&m_lock);
+    }
+
+    if (m_queue)
+    {
+        m_queue->Close();
+    }
+
+    if (m_stopEvent != NULL)
+    {
+        CloseHandle(m_stopEvent);
+        m_stopEvent = NULL;
+    }
+
+    if (m_winsockStarted)
+    {
+        WSACleanup();
+        m_winsockStarted = false;
+    }
+}
+
+///
+/// Frames a line and adds it to the pending lines. The line is dropped if
+/// the pending lines already use the max buffered bytes.
+///
+/// \param Record   The line, without line break.
+/// \param Size     Size of the line, in bytes.
+///
+void
+NetworkSink::Append(
+    _In_reads_bytes_(Size) const char* Record,
+    _In_ size_t Size
+    )
+{
+    FILETIME now;
+    GetSystemTimePreciseAsFileTime(&now);
+
+    AcquireSRWLockExclusive(&m_lock);
+
+    if (m_stopped || m_pending.size() + Size > m_maxBufferedBytes)
+    {
+        ReleaseSRWLockExclusive(&m_lock);
+
+        m_droppedRecords++;
+
+        return;
+    }
+
+    const bool first = m_pendingEnds.empty();
+
+    if (first)
+    {
+        m_firstPendingTime = GetTickCount64();
+    }
+
+    FrameRecord(Record, Size, now);
+    m_pendingEnds.push_back(m_pending.size());
+
+    const bool full = m_pendingEnds.size() >= m_settings.MaxBatchRecords
+        || m_pending.size() >= m_maxBatchBytes;
+
+    ReleaseSRWLockExclusive(&m_lock);
+
+    //
+    // The sender is woken up by the first line, to wait for the max batch
+    // delay, and by a full batch.
+    //
+    if (first || full)
+    {
+        WakeConditionVariable(&m_pendingReady);
+    }
+}
+
+NetworkSink::Statistics
+NetworkSink::GetStatistics() const
+{
+    Statistics statistics;
+
+    statistics.RecordsSent = m_recordsSent.load();
+    statistics.Batches = m_batches.load();
+    statistics.DroppedRecords = m_droppedRecords.load();
+    statistics.Connections = m_connections.load();
+
+    return statistics;
+}
+
+///
+/// Appends a framed line to m_pending. Called under m_lock.
+///
+/// Syslog:         [LEN SP] <PRI>1 TIMESTAMP HOSTNAME APP-NAME PROCID - - MSG
+/// Fluent Forward: [EventTime, {"log": MSG}]
+///
+void
+NetworkSink::FrameRecord(
+    _In_reads_bytes_(Size) const char* Record,
+    _In_ size_t Size,
+    _In_ const FILETIME& Time
+    )
+{
+    const UINT64 ticks = TimestampFormatter::ToTicks(Time);
+
+    if (m_settings.Framing == NetworkFraming::FluentForward)
+    {
+        const UINT64 seconds = ticks / TimestampFormatter::TICKS_PER_SECOND;
+        const UINT32 nanoseconds = static_cast<UINT32>(ticks % TimestampFormatter::TICKS_PER_SECOND) * 100;
+
+        //
+        // EventTime is the ext type 0, with the seconds and nanoseconds
+        // since the Unix epoch, as big-endian 32-bit integers.
+        //
+        m_pending += static_cast<char>(0x92);
+        m_pending += static_cast<char>(0xD7);
+        m_pending += static_cast<char>(0x00);
+        AppendBigEndian(m_pending, static_cast<UINT32>(seconds - c_UnixEpochSeconds), 4);
+        AppendBigEndian(m_pending, nanoseconds, 4);
+        m_pending += static_cast<char>(0x81);
+        m_pending += "\xA3log";
+        AppendMessagePackStringHeader(m_pending, Size);
+        m_pending.append(Record, Size);
+
+        return;
+    }
+
+    char timestamp[TimestampFormatter::MAX_LENGTH];
+    const size_t timestampLength = m_timestamps.Format(ticks, timestamp);
+
+    const size_t headerLength = (_countof(c_SyslogHeader) - 1)
+        + timestampLength + 1
+        + m_hostName.size() + 1
+        + m_tag.size() + 1
+        + m_processId.size()
+        + 5;
+
+    if (m_settings.Protocol == NetworkProtocol::Udp)
+    {
+        Size = (std::min)(Size, MAX_DATAGRAM_BYTES - headerLength);
+    }
+    else
+    {
+        char length[24];
+        const int lengthSize = sprintf_s(length, "%zu ", headerLength + Size);
+
+        m_pending.append(length, lengthSize);
+    }
+
+    m_pending.append(c_SyslogHeader, _countof(c_SyslogHeader) - 1);
+    m_pending.append(timestamp, timestampLength);
+    m_pending += ' ';
+    m_pending += m_hostName;
+    m_pending += ' ';
+    m_pending += m_tag;
+    m_pending += ' ';
+    m_pending += m_processId;
+    m_pending += " - - ";
+    m_pending.append(Record, Size);
+}
+
+DWORD
+NetworkSink::SenderThreadStatic(
+    _In_ LPVOID Context
+    )
+{
+    NetworkSink* const sink = static_cast<NetworkSink*>(Context);
+
+    if (sink->m_queue)
+    {
+        sink->QueueSenderThread();
+    }
+    else
+    {
+        sink->SenderThread();
+    }
+
+    return ERROR_SUCCESS;
+}
+
+///
+/// Sends the batches until the sink is stopped. A batch that fails is sent
+/// again after the reconnect delay, until the sink is stopping, where it
+/// gets one more attempt.
+///
+void
+NetworkSink::SenderThread()
+{
+    while (TakeBatch())
+    {
+        while (!SendBatch())
+        {
+            if (WaitForSingleObject(m_stopEvent, m_reconnectDelayMillis) == WAIT_OBJECT_0)
+            {
+                if (!SendBatch())
+                {
+                    m_droppedRecords += m_batchEnds.size();
+                }
+
+                break;
+            }
+
+            m_reconnectDelayMillis = (std::min)(m_reconnectDelayMillis * 2, m_settings.MaxReconnectDelayMillis);
+        }
+
+        //
+        // The batch only exceeds the max batch bytes after the collector was
+        // unreachable. Don't keep its memory.
+        //
+        if (m_batch.capacity() > 2 * m_maxBatchBytes)
+        {
+            std::string().swap(m_batch);
+        }
+    }
+
+    CloseSocket();
+}
+
+///
+/// Moves the batches to the queue, and sends the batches of the queue until
+/// the sink is stopped. A batch that fails is rewound, and read again after
+/// the reconnect delay, during which the new batches keep being queued. When
+/// the sink is stopping, the queue gets one more attempt, and what it can't
+/// send is left for the next start.
+///
+void
+NetworkSink::QueueSenderThread()
+{
+    ULONGLONG retryTime = 0;
+    bool stopping = false;
+
+    while (!stopping)
+    {
+        DWORD timeout = INFINITE;
+
+        if (m_queue->HasUnreadRecords())
+        {
+            const ULONGLONG now = GetTickCount64();
+
+            timeout = (retryTime > now) ? static_cast<DWORD>(retryTime - now) : 0;
+        }
+
+        stopping = !TakeBatch(timeout);
+
+        if (!m_batchEnds.empty())
+        {
+            const UINT64 dropped = m_queue->GetStatistics().DroppedRecords;
+            const DWORD status = m_queue->Append(m_batch.data(), m_batchEnds);
+
+            if (status != ERROR_SUCCESS)
+            {
+                m_droppedRecords += m_batchEnds.size();
+            }
+
+            //
+            // Including the unsent lines of the segments dropped to stay
+            // under the max queue bytes.
+            //
+            m_droppedRecords += m_queue->GetStatistics().DroppedRecords - dropped;
+
+            ReportQueueError(status);
+        }
+
+        if (!stopping && GetTickCount64() < retryTime)
+        {
+            continue;
+        }
+
+        //
+        // One batch at a time, so the pending lines are queued between the
+        // batches of a long backlog. When stopping, the whole queue.
+        //
+        while (m_queue->HasUnreadRecords())
+        {
+            const DWORD status = m_queue->Read(m_settings.MaxBatchRecords, m_maxBatchBytes, m_batch, m_batchEnds);
+
+            ReportQueueError(status);
+
+            if (status == ERROR_SUCCESS && SendBatch())
+            {
+                ReportQueueError(m_queue->Acknowledge());
+                retryTime = 0;
+            }
+            else
+            {
+                m_queue->Rewind();
+                retryTime = GetTickCount64() + m_reconnectDelayMillis;
+                m_reconnectDelayMillis = (std::min)(m_reconnectDelayMillis * 2, m_settings.MaxReconnectDelayMillis);
+                break;
+            }
+
+            if (!stopping)
+            {
+                break;
+            }
+        }
+
+        if (m_batch.capacity() > 2 * m_maxBatchBytes)
+        {
+            std::string().swap(m_batch);
+        }
+    }
+
+    CloseSocket();
+}
+
+///
+/// Waits for a batch, and moves the pending lines to m_batch.
+///
+/// \param TimeoutMillis   Time after which the pending lines are taken
+///                         even if they aren't a batch yet, possibly none.
+///
+/// \return False if the sink is stopping and there are no pending lines.
+///
+bool
+NetworkSink::TakeBatch(
+    _In_ DWORD TimeoutMillis
+    )
+{
+    const ULONGLONG startTime = GetTickCount64();
+
+    AcquireSRWLockExclusive(&m_lock);
+
+    for (;;)
+    {
+        if (m_pendingEnds.empty() && m_stopping)
+        {
+            m_batch.clear();
+            m_batchEnds.clear();
+
+            ReleaseSRWLockExclusive(&m_lock);
+
+            return false;
+        }
+
+        DWORD wait = INFINITE;
+
+        if (TimeoutMillis != INFINITE)
+        {
+            const ULONGLONG elapsed = GetTickCount64() - startTime;
+
+            if (elapsed >= TimeoutMillis)
+            {
+                break;
+            }
+
+            wait = static_cast<DWORD>(TimeoutMillis - elapsed);
+        }
+
+        if (m_pendingEnds.empty())
+        {
+            SleepConditionVariableSRW(&m_pendingReady, &m_lock, wait, 0);
+            continue;
+        }
+
+        if (m_stopping
+            || m_pendingEnds.size() >= m_settings.MaxBatchRecords
+            || m_pending.size() >= m_maxBatchBytes)
+        {
+            break;
+        }
+
+        const ULONGLONG elapsed = GetTickCount64() - m_firstPendingTime;
+
+        if (elapsed >= m_settings.MaxBatchDelayMillis)
+        {
+            break;
+        }
+
+        SleepConditionVariableSRW(
+            &m_pendingReady,
+            &m_lock,
+            (std::min)(wait, static_cast<DWORD>(m_settings.MaxBatchDelayMillis - elapsed)),
+            0);
+    }
+
+    //
+    // The buffers are swapped, so the memory of the previous batch is
+    // reused for the next pending lines.
+    //
+    m_batch.clear();
+    m_batchEnds.clear();
+    m_batch.swap(m_pending);
+    m_batchEnds.swap(m_pendingEnds);
+
+    ReleaseSRWLockExclusive(&m_lock);
+
+    return true;
+}
+
+///
+/// Sends m_batch, connecting first if needed.
+///
+/// \return True if the batch was sent.
+///
+bool
+NetworkSink::SendBatch()
+{
+    int error = 0;
+
+    if (m_socket.load() != INVALID_SOCKET && m_settings.Protocol == NetworkProtocol::Tcp)
+    {
+        //
+        // The collector doesn't send anything, so a readable socket means
+        // it closed the connection. Checking it before sending avoids
+        // losing the first batch after a collector restart, which would
+        // otherwise be accepted by the closed connection.
+        //
+        WSAPOLLFD poll{};
+        poll.fd = m_socket.load();
+        poll.events = POLLRDNORM;
+
+        if (WSAPoll(&poll, 1, 0) != 0)
+        {
+            CloseSocket();
+        }
+    }
+
+    if (m_socket.load() == INVALID_SOCKET)
+    {
+        error = Connect();
+    }
+
+    if (error == 0)
+    {
+        if (m_settings.Protocol == NetworkProtocol::Udp)
+        {
+            size_t start = 0;
+
+            for (const size_t end : m_batchEnds)
+            {
+                if (send(m_socket.load(), m_batch.data() + start, static_cast<int>(end - start), 0) == SOCKET_ERROR)
+                {
+                    error = WSAGetLastError();
+                    break;
+                }
+
+                start = end;
+            }
+        }
+        else
+        {
+            if (m_settings.Framing == NetworkFraming::FluentForward)
+            {
+                //
+                // Forward mode: [tag, [entry, ...]]
+                //
+                m_header.clear();
+                m_header += static_cast<char>(0x92);
+                AppendMessagePackStringHeader(m_header, m_tag.size());
+                m_header += m_tag;
+                AppendMessagePackArrayHeader(m_header, m_batchEnds.size());
+
+                error = SendAll(m_header.data(), m_header.size());
+            }
+
+            if (error == 0)
+            {
+                error = SendAll(m_batch.data(), m_batch.size());
+            }
+        }
+    }
+
+    if (error != 0)
+    {
+        CloseSocket();
+        ReportError(error);
+
+        return false;
+    }
+
+    m_recordsSent += m_batchEnds.size();
+    m_batches++;
+    m_reconnectDelayMillis = m_settings.MinReconnectDelayMillis;
+
+    ReportError(0);
+
+    return true;
+}
+
+///
+/// Resolves the host and connects to the first address that accepts the
+/// connection. A UDP socket is connected too, so its sends go to the same
+/// address.
+///
+/// \return 0, or the Winsock error of the last address tried.
+///
+int
+NetworkSink::Connect()
+{
+    ADDRINFOW hints{};
+    hints.ai_family = AF_UNSPEC;
+
+    if (m_settings.Protocol == NetworkProtocol::Tcp)
+    {
+        hints.ai_socktype = SOCK_STREAM;
+        hints.ai_protocol = IPPROTO_TCP;
+    }
+    else
+    {
+        hints.ai_socktype = SOCK_DGRAM;
+        hints.ai_protocol = IPPROTO_UDP;
+    }
+
+    const std::wstring port = std::to_wstring(m_settings.Port);
+    PADDRINFOW addresses = NULL;
+
+    int error = GetAddrInfoW(m_settings.Host.c_str(), port.c_str(), &hints, &addresses);
+
+    if (error != 0)
+    {
+        return error;
+    }
+
+    error = WSAHOST_NOT_FOUND;
+
+    for (PADDRINFOW address = addresses; address != NULL; address = address->ai_next)
+    {
+        const SOCKET socket = WSASocketW(
+            address->ai_family,
+            address->ai_socktype,
+            address->ai_protocol,
+            NULL,
+            0,
+            WSA_FLAG_NO_HANDLE_INHERIT);
+
+        if (socket == INVALID_SOCKET)
+        {
+            error = WSAGetLastError();
+            continue;
+        }
+
+        //
+        // Stored before connecting, so Stop can close it.
+        //
+        m_socket = socket;
+
+        if (connect(socket, address->ai_addr, static_cast<int>(address->ai_addrlen)) == 0)
+        {
+            error = 0;
+            break;
+        }
+
+        error = WSAGetLastError();
+
+        CloseSocket();
+    }
+
+    FreeAddrInfoW(addresses);
+
+    if (error != 0)
+    {
+        return error;
+    }
+
+    if (m_settings.Protocol == NetworkProtocol::Tcp)
+    {
+        //
+        // The lines are already batched, so Nagle's algorithm would only add
+        // latency.
+        //
+        const BOOL noDelay = TRUE;
+        const DWORD sendTimeout = c_NetworkSendTimeoutMillis;
+
+        setsockopt(m_socket.load(), IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&noDelay), sizeof(noDelay));
+        setsockopt(m_socket.load(), SOL_SOCKET, SO_SNDTIMEO, reinterpret_cast<const char*>(&sendTimeout), sizeof(sendTimeout));
+    }
+
+    m_connections++;
+
+    return 0;
+}
+
+///
+/// Sends a buffer on the TCP connection.
+///
+/// \return 0, or the Winsock error of send.
+///
+int
+NetworkSink::SendAll(
+    _In_reads_bytes_(Size) const char* Data,
+    _In_ size_t Size
+    )
+{
+    while (Size > 0)
+    {
+        const int chunk = static_cast<int>((std::min)(Size, static_cast<size_t>(INT_MAX)));
+        const int sent = send(m_socket.load(), Data, chunk, 0);
+
+        if (sent == SOCKET_ERROR)
+        {
+            return WSAGetLastError();
+        }
+
+        Data += sent;
+        Size -= static_cast<size_t>(sent);
+    }
+
+    return 0;
+}
+
+void
+NetworkSink::CloseSocket()
+{
+    const SOCKET socket = m_socket.exchange(INVALID_SOCKET);
+
+    if (socket != INVALID_SOCKET)
+    {
+        closesocket(socket);
+    }
+}
+
+///
+/// Traces a connection error when it differs from the previous one, so an
+/// unreachable collector doesn't write an error per attempt, and traces when
+/// the lines are sent again.
+///
+void
+NetworkSink::ReportError(
+    _In_ int Error
+    )
+{
+    if (Error == m_lastError)
+    {
+        return;
+    }
+
+    if (Error != 0)
+    {
+        logWriter.TraceError(
+            FORMAT_STRING(
+                L"Failed to send the log lines to %s:%u. Error: %d",
+                m_settings.Host,
+                m_settings.Port,
+                Error
+            ).c_str()
+        );
+    }
+    else
+    {
+        logWriter.TraceInfo(
+            FORMAT_STRING(
+                L"Sending the log lines to %s:%u again.",
+                m_settings.Host,
+                m_settings.Port
+            ).c_str()
+        );
+    }
+
+    m_lastError = Error;
+}
+
+///
+/// Traces an error of the queue when it differs from the previous one.
+///
+void
+NetworkSink::ReportQueueError(
+    _In_ DWORD Error
+    )
+{
+    if (Error == m_lastQueueError)
+    {
+        return;
+    }
+
+    if (Error != ERROR_SUCCESS)
+    {
+        logWriter.TraceError(
+            FORMAT_STRING(
+                L"Failed to queue the log lines in %s. Error: %lu",
+                m_queue->GetDirectory(),
+                Error
+            ).c_str()
+        );
+    }
+
+    m_lastQueueError = Error;
+}
@@ -0,0 +1,192 @@
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+
+#pragma once
+
+///
+/// Sends the log lines of the LogWriter to a log collector, over UDP or TCP,
+/// as RFC 5424 syslog messages or Fluent Forward messages.
+///
+/// Append frames a line into the pending buffer and returns, so a slow or
+/// unreachable collector never blocks the LogWriter. A sender thread takes
+/// the pending buffer once it has the max batch records or bytes, or once
+/// its first line waited the max batch delay, and sends it with one send
+/// call on TCP, or one datagram per line on UDP.
+///
+/// The connection is kept between the batches. When a send fails, the
+/// socket is closed and the sender connects again, waiting between the
+/// attempts from the min reconnect delay, doubled after each failure, up to
+/// the max reconnect delay. The batch that failed is sent again on the new
+/// connection, so a line is only lost when the collector closes the
+/// connection before reading the lines it received. Meanwhile, the lines
+/// keep being appended until the max buffered bytes, after which the new
+/// lines are dropped and counted.
+///
+/// With a queue directory, the sender appends the batches to a DurableQueue
+/// instead, and sends the batches it reads from the queue, acknowledging
+/// them once they were sent. The lines then survive a collector that stays
+/// unreachable, up to the max queue bytes, and a restart of LogMonitor: the
+/// lines not acknowledged yet are sent again on the next start, so a line
+/// can be received twice.
+///
+/// The host name is resolved on each connection, so a collector that moves
+/// to another address is found again.
+///
+class NetworkSink final
+{
+public:
+    static constexpr DWORD DEFAULT_MAX_BATCH_RECORDS = 512;
+    static constexpr size_t DEFAULT_MAX_BATCH_BYTES = 256 * 1024;
+    static constexpr DWORD DEFAULT_MAX_BATCH_DELAY_MILLIS = 100;
+    static constexpr size_t DEFAULT_MAX_BUFFERED_BYTES = 8 * 1024 * 1024;
+    static constexpr DWORD DEFAULT_MIN_RECONNECT_DELAY_MILLIS = 100;
+    static constexpr DWORD DEFAULT_MAX_RECONNECT_DELAY_MILLIS = 30000;
+
+    static constexpr USHORT DEFAULT_SYSLOG_PORT = 514;
+    static constexpr USHORT DEFAULT_FLUENT_FORWARD_PORT = 24224;
+
+    //
+    // Syslog messages are truncated to this size over UDP, the max payload
+    // of an IPv4 datagram.
+    //
+    static constexpr size_t MAX_DATAGRAM_BYTES = 65507;
+
+    //
+    // Time Stop waits for the sender to send the pending lines, or to fail.
+    //
+    static constexpr DWORD STOP_TIMEOUT_MILLIS = 5000;
+
+    struct Statistics
+    {
+        UINT64 RecordsSent = 0;
+        UINT64 Batches = 0;
+        UINT64 DroppedRecords = 0;
+        UINT64 Connections = 0;
+    };
+
+    explicit NetworkSink(
+        _In_ const NetworkOutputSettings& Settings
+        );
+
+    ~NetworkSink()
+    {
+        Stop();
+    }
+
+    NetworkSink(const NetworkSink&) = delete;
+    NetworkSink& operator=(const NetworkSink&) = delete;
+
+    DWORD Start();
+
+    void Stop();
+
+    void Append(
+        _In_reads_bytes_(Size) const char* Record,
+        _In_ size_t Size
+        );
+
+    Statistics GetStatistics() const;
+
+    const std::wstring& GetHost() const
+    {
+        return m_settings.Host;
+    }
+
+    USHORT GetPort() const
+    {
+        return m_settings.Port;
+    }
+
+private:
+    NetworkOutputSettings m_settings;
+    size_t m_maxBatchBytes;
+    size_t m_maxBufferedBytes;
+
+    //
+    // Syslog HOSTNAME, APP-NAME and PROCID, or Fluent Forward tag.
+    //
+    std::string m_hostName;
+    std::string m_tag;
+    std::string m_processId;
+
+    //
+    // Guards the pending lines, and the state shared with the sender.
+    //
+    SRWLOCK m_lock;
+    CONDITION_VARIABLE m_pendingReady;
+    std::string m_pending;
+    std::vector<size_t> m_pendingEnds;
+    ULONGLONG m_firstPendingTime = 0;
+    bool m_stopping = false;
+    bool m_stopped = false;
+
+    //
+    // Set by Stop, so the sender doesn't wait for the reconnect delay.
+    //
+    HANDLE m_stopEvent = NULL;
+    HANDLE m_senderThread = NULL;
+
+    TimestampFormatter m_timestamps;
+
+    //
+    // Null without a queue directory, or when it can't be opened.
+    //
+    std::unique_ptr<DurableQueue> m_queue;
+    DWORD m_lastQueueError = ERROR_SUCCESS;
+
+    //
+    // Used by the sender thread only, except m_socket that Stop closes when
+    // the sender doesn't exit in time.
+    //
+    std::string m_batch;
+    std::vector<size_t> m_batchEnds;
+    std::string m_header;
+    std::atomic<SOCKET> m_socket{ INVALID_SOCKET };
+    DWORD m_reconnectDelayMillis;
+    int m_lastError = 0;
+    bool m_winsockStarted = false;
+
+    std::atomic<UINT64> m_recordsSent{ 0 };
+    std::atomic<UINT64> m_batches{ 0 };
+    std::atomic<UINT64> m_droppedRecords{ 0 };
+    std::atomic<UINT64> m_connections{ 0 };
+
+    void FrameRecord(
+        _In_reads_bytes_(Size) const char* Record,
+        _In_ size_t Size,
+        _In_ const FILETIME& Time
+        );
+
+    static DWORD SenderThreadStatic(
+        _In_ LPVOID Context
+        );
+
+    void SenderThread();
+
+    void QueueSenderThread();
+
+    bool TakeBatch(
+        _In_ DWORD TimeoutMillis = INFINITE
+        );
+
+    bool SendBatch();
+
+    int Connect();
+
+    int SendAll(
+        _In_reads_bytes_(Size) const char* Data,
+        _In_ size_t Size
+        );
+
+    void CloseSocket();
+
+    void ReportError(
+        _In_ int Error
+        );
+
+    void ReportQueueError(
+        _In_ DWORD Error
+        );
+};
@@ -0,0 +1,358 @@
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+
+#include "pch.h"
+
+constexpr UINT64 RotatingFileSink::DEFAULT_MAX_FILE_BYTES;
+constexpr DWORD RotatingFileSink::DEFAULT_RETAINED_FILES;
+constexpr DWORD RotatingFileSink::MAX_RETAINED_FILES;
+
+///
+/// \param Path                     Path of the file. The rotated files are
+///                                 next to it.
+/// \param MaxFileBytes             The file is rotated before it exceeds this
+///                                 size. 0 for the default.
+/// \param RotationIntervalSeconds  The file is rotated once it's older than
+///                                 this. 0 to rotate by size only.
+/// \param RetainedFiles            Number of rotated files kept. 0 deletes
+///                                 the file when it's rotated.
+/// \param PreallocateBytes         Disk space reserved for a new file. 0 to
+///                                 let the file system allocate it as the
+///                                 file grows.
+///
+RotatingFileSink::RotatingFileSink(
+    _In_ const std::wstring& Path,
+    _In_ UINT64 MaxFileBytes,
+    _In_ DWORD RotationIntervalSeconds,
+    _In_ DWORD RetainedFiles,
+    _In_ UINT64 PreallocateBytes
+    ) :
+    m_path(Path),
+    m_maxFileBytes(MaxFileBytes != 0 ? MaxFileBytes : DEFAULT_MAX_FILE_BYTES),
+    m_rotationIntervalMillis(static_cast<ULONGLONG>(RotationIntervalSeconds) * 1000),
+    m_retainedFiles((std::min)(RetainedFiles, MAX_RETAINED_FILES)),
+    m_preallocateBytes((std::min)(PreallocateBytes, m_maxFileBytes))
+{
+}
+
+///
+/// Compresses the lines in blocks. Called before the file is opened.
+///
+/// \param Codec        The codec of the blocks.
+/// \param BlockBytes   Size of the lines of a block.
+///
+void
+RotatingFileSink::SetCompression(
+    _In_ std::unique_ptr<BlockCodec> Codec,
+    _In_ size_t BlockBytes
+    )
+{
+    m_spool = std::make_unique<BlockSpoolWriter>(std::move(Codec), BlockBytes);
+}
+
+///
+/// Opens the file, or creates it. The lines are appended to an existing
+/// file, which is rotated by the next write if it's already full, or if it
+/// was written in the other format. Its age counts from its creation time,
+/// so a file reopened after a restart is still rotated on time. The
+/// creation time of an empty file is set to the current time.
+///
+/// \return ERROR_SUCCESS, or the error of CreateFile.
+///
+DWORD
+RotatingFileSink::Open()
+{
+    if (m_file != INVALID_HANDLE_VALUE)
+    {
+        return ERROR_SUCCESS;
+    }
+
+    //
+    // The file is opened with write access, instead of append only, as the
+    // disk space can only be reserved with it. The sink is the only writer,
+    // so the file pointer stays at the end. Read access is only used to
+    // check the format of an existing file.
+    //
+    m_file = CreateFileW(
+        m_path.c_str(),
+        GENERIC_READ | GENERIC_WRITE,
+        FILE_SHARE_READ | FILE_SHARE_DELETE,
+        NULL,
+        OPEN_ALWAYS,
+        FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+        NULL);
+
+    if (m_file == INVALID_HANDLE_VALUE)
+    {
+        return GetLastError();
+    }
+
+    LARGE_INTEGER size{};
+    const LARGE_INTEGER zero{};
+
+    if (!SetFilePointerEx(m_file, zero, &size, FILE_END))
+    {
+        const DWORD status = GetLastError();
+
+        Close();
+
+        return status;
+    }
+
+    m_fileSize = static_cast<UINT64>(size.QuadPart);
+    m_openTime = GetTickCount64();
+    m_formatMismatch = false;
+
+    if (m_fileSize == 0)
+    {
+        //
+        // A new file may get the creation time of a file renamed or deleted
+        // from the same path, by the tunneling of the file system. Once the
+        // file has lines, that time would make a restart rotate it early.
+        // A failure only costs the age after a restart, so it's ignored.
+        //
+        FILETIME now{};
+
+        GetSystemTimeAsFileTime(&now);
+        SetFileTime(m_file, &now, NULL, NULL);
+    }
+    else
+    {
+        FILETIME creationTime{};
+
+        if (GetFileTime(m_file, &creationTime, NULL, NULL))
+        {
+            FILETIME now{};
+            ULARGE_INTEGER created{};
+            ULARGE_INTEGER current{};
+
+            GetSystemTimeAsFileTime(&now);
+            created.LowPart = creationTime.dwLowDateTime;
+            created.HighPart = creationTime.dwHighDateTime;
+            current.LowPart = now.dwLowDateTime;
+            current.HighPart = now.dwHighDateTime;
+
+            if (current.QuadPart > created.QuadPart)
+            {
+                const ULONGLONG ageMillis = (current.QuadPart - created.QuadPart) / 10000;
+
+                m_openTime -= (std::min)(ageMillis, m_openTime);
+            }
+        }
+
+        //
+        // A compressed file starts with a block header. The read at offset
+        // 0 moves the file pointer, so it's moved back to the end.
+        //
+        char buffer[BlockHeader::SIZE] = {};
+        DWORD read = 0;
+        OVERLAPPED start{};
+        BlockHeader header;
+
+        const bool compressed = ReadFile(m_file, buffer, sizeof(buffer), &read, &start)
+            && read == sizeof(buffer)
+            && header.Parse(buffer);
+
+        m_formatMismatch = compressed != (m_spool != nullptr);
+
+        if (!SetFilePointerEx(m_file, zero, NULL, FILE_END))
+        {
+            const DWORD status = GetLastError();
+
+            Close();
+
+            return status;
+        }
+    }
+
+    if (m_preallocateBytes > m_fileSize)
+    {
+        //
+        // A failure only costs the contiguous allocation, so it's ignored.
+        //
+        FILE_ALLOCATION_INFO allocation{};
+        allocation.AllocationSize.QuadPart = static_cast<LONGLONG>(m_preallocateBytes);
+
+        SetFileInformationByHandle(m_file, FileAllocationInfo, &allocation, sizeof(allocation));
+    }
+
+    return ERROR_SUCCESS;
+}
+
+///
+/// Appends a batch of lines to the file, or to the current compressed block.
+///
+/// \param Data     The lines, each ending with a line break.
+/// \param Size     Size of the lines, in bytes.
+///
+/// \return ERROR_SUCCESS, or the error of the rotation or the write. The
+///     sink tries to open the file again on the next write after an error.
+///
+DWORD
+RotatingFileSink::Write(
+    _In_reads_bytes_(Size) const char* Data,
+    _In_ size_t Size
+    )
+{
+    if (!m_spool)
+    {
+        return WriteData(Data, Size);
+    }
+
+    m_blocks.clear();
+    m_spool->Append(Data, Size, m_blocks);
+
+    if (m_blocks.empty())
+    {
+        return ERROR_SUCCESS;
+    }
+
+    return WriteData(m_blocks.data(), m_blocks.size());
+}
+
+///
+/// Compresses and writes the current block, even if it isn't full.
+///
+DWORD
+RotatingFileSink::Flush()
+{
+    if (!m_spool || m_spool->GetBufferedBytes() == 0)
+    {
+        return ERROR_SUCCESS;
+    }
+
+    m_blocks.clear();
+    m_spool->Flush(m_blocks);
+
+    return WriteData(m_blocks.data(), m_blocks.size());
+}
+
+///
+/// Writes lines or compressed blocks at the end of the file, after rotating
+/// it if needed.
+///
+DWORD
+RotatingFileSink::WriteData(
+    _In_reads_bytes_(Size) const char* Data,
+    _In_ size_t Size
+    )
+{
+    DWORD status = Open();
+
+    if (status != ERROR_SUCCESS)
+    {
+        return status;
+    }
+
+    if (NeedsRotation(Size))
+    {
+        status = Rotate();
+
+        if (status != ERROR_SUCCESS)
+        {
+            return status;
+        }
+    }
+
+    while (Size > 0)
+    {
+        const DWORD chunk = static_cast<DWORD>((std::min)(Size, static_cast<size_t>(MAXDWORD)));
+        DWORD written = 0;
+
+        if (!WriteFile(m_file, Data, chunk, &written, NULL))
+        {
+            status = GetLastError();
+
+            Close();
+
+            return status;
+        }
+
+        Data += written;
+        Size -= written;
+        m_fileSize += written;
+    }
+
+    return ERROR_SUCCESS;
+}
+
+void
+RotatingFileSink::Close()
+{
+    if (m_file != INVALID_HANDLE_VALUE)
+    {
+        CloseHandle(m_file);
+        m_file = INVALID_HANDLE_VALUE;
+    }
+}
+
+///
+/// An empty file is never rotated, so a batch larger than the max file size
+/// is written to its own file.
+///
+bool
+RotatingFileSink::NeedsRotation(
+    _In_ size_t Size
+    ) const
+{
+    if (m_fileSize == 0)
+    {
+        return false;
+    }
+
+    if (m_formatMismatch || m_fileSize + Size > m_maxFileBytes)
+    {
+        return true;
+    }
+
+    return m_rotationIntervalMillis != 0
+        && GetTickCount64() - m_openTime >= m_rotationIntervalMillis;
+}
+
+///
+/// Closes the file, shifts the rotated files by one, deleting the oldest,
+/// and opens a new file.
+///
+DWORD
+RotatingFileSink::Rotate()
+{
+    Close();
+
+    if (m_retainedFiles == 0)
+    {
+        DeleteFileW(m_path.c_str());
+    }
+    else
+    {
+        DeleteFileW(RotatedPath(m_retainedFiles).c_str());
+
+        for (DWORD index = m_retainedFiles - 1; index > 0; index--)
+        {
+            MoveFileExW(RotatedPath(index).c_str(), RotatedPath(index + 1).c_str(), MOVEFILE_REPLACE_EXISTING);
+        }
+
+        if (!MoveFileExW(m_path.c_str(), RotatedPath(1).c_str(), MOVEFILE_REPLACE_EXISTING))
+        {
+            //
+            // Keep writing to the same file rather than losing the lines.
+            //
+            const DWORD status = GetLastError();
+
+            return (Open() == ERROR_SUCCESS) ? ERROR_SUCCESS : status;
+        }
+    }
+
+    m_rotations++;
+
+    return Open();
+}
+
+std::wstring
+RotatingFileSink::RotatedPath(
+    _In_ DWORD Index
+    ) const
+{
+    return m_path + L"." + std::to_wstring(Index);
+}
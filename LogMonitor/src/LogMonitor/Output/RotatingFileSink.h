@@ -0,0 +1,143 @@
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+
+#pragma once
+
+///
+/// Writes the batches of log lines of the LogWriter to a file, rotated by
+/// size and by age.
+///
+/// A batch is written with a single WriteFile, at the end of the file, and a
+/// batch is never split between two files. Before a batch is written, the
+/// file is rotated if the batch would make it larger than the max file
+/// size, or if the file is older than the rotation interval. The file is
+/// renamed "<path>.1", the previous "<path>.1" is renamed "<path>.2", and so
+/// on, and the oldest file past the retained files count is deleted.
+///
+/// The disk space of a new file can be reserved when it's opened, so the
+/// file system allocates contiguous extents as the file grows. The size of
+/// the file doesn't change until the lines are written.
+///
+/// The batches can be compressed by a BlockSpoolWriter before they are
+/// written, in which case the file is a sequence of compressed blocks, and
+/// the sizes are those of the compressed blocks. A file written in the
+/// other format is rotated before the first write.
+///
+/// The sink isn't thread safe. The LogWriter calls it under its output lock.
+///
+class RotatingFileSink final
+{
+public:
+    static constexpr UINT64 DEFAULT_MAX_FILE_BYTES = 10 * 1024 * 1024;
+    static constexpr DWORD DEFAULT_RETAINED_FILES = 5;
+    static constexpr DWORD MAX_RETAINED_FILES = 100;
+
+    RotatingFileSink(
+        _In_ const std::wstring& Path,
+        _In_ UINT64 MaxFileBytes = DEFAULT_MAX_FILE_BYTES,
+        _In_ DWORD RotationIntervalSeconds = 0,
+        _In_ DWORD RetainedFiles = DEFAULT_RETAINED_FILES,
+        _In_ UINT64 PreallocateBytes = 0
+        );
+
+    ~RotatingFileSink()
+    {
+        Flush();
+        Close();
+    }
+
+    RotatingFileSink(const RotatingFileSink&) = delete;
+    RotatingFileSink& operator=(const RotatingFileSink&) = delete;
+
+    void SetCompression(
+        _In_ std::unique_ptr<BlockCodec> Codec,
+        _In_ size_t BlockBytes = BlockSpoolWriter::DEFAULT_BLOCK_BYTES
+        );
+
+    DWORD Open();
+
+    DWORD Write(
+        _In_reads_bytes_(Size) const char* Data,
+        _In_ size_t Size
+        );
+
+    DWORD Flush();
+
+    void Close();
+
+    ///
+    /// Time until the current compressed block should be flushed, or
+    /// INFINITE if there is none.
+    ///
+    DWORD GetMillisUntilFlush() const
+    {
+        return m_spool ? m_spool->GetMillisUntilFlush() : INFINITE;
+    }
+
+    const std::wstring& GetPath() const
+    {
+        return m_path;
+    }
+
+    UINT64 GetFileSize() const
+    {
+        return m_fileSize;
+    }
+
+    UINT64 GetRotations() const
+    {
+        return m_rotations;
+    }
+
+    ///
+    /// The compression stage, or nullptr if the lines are written as they
+    /// are.
+    ///
+    const BlockSpoolWriter* GetSpool() const
+    {
+        return m_spool.get();
+    }
+
+private:
+    std::wstring m_path;
+    UINT64 m_maxFileBytes;
+    ULONGLONG m_rotationIntervalMillis;
+    DWORD m_retainedFiles;
+    UINT64 m_preallocateBytes;
+
+    HANDLE m_file = INVALID_HANDLE_VALUE;
+    UINT64 m_fileSize = 0;
+
+    //
+    // Tick count when the file was created, or when it was opened if its
+    // creation time isn't known.
+    //
+    ULONGLONG m_openTime = 0;
+    UINT64 m_rotations = 0;
+
+    std::unique_ptr<BlockSpoolWriter> m_spool;
+    std::string m_blocks;
+
+    //
+    // True if the open file was written in the other format, compressed or
+    // not.
+    //
+    bool m_formatMismatch = false;
+
+    DWORD WriteData(
+        _In_reads_bytes_(Size) const char* Data,
+        _In_ size_t Size
+        );
+
+    bool NeedsRotation(
+        _In_ size_t Size
+        ) const;
+
+    DWORD Rotate();
+
+    std::wstring RotatedPath(
+        _In_ DWORD Index
+        ) const;
+};
@@ -0,0 +1,186 @@
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+
+#include "pch.h"
+
+constexpr size_t TimestampFormatter::MAX_LENGTH;
+constexpr UINT64 TimestampFormatter::TICKS_PER_SECOND;
+constexpr size_t TimestampFormatter::PREFIX_LENGTH;
+
+std::atomic<TimestampPrecision> TimestampFormatter::s_defaultPrecision{ TimestampPrecision::Milliseconds };
+
+//
+// Number of digits of the fraction of a second, and the divisor of the
+// 100ns ticks, for each TimestampPrecision.
+//
+static const size_t c_TimestampFractionDigits[] = { 3, 6, 7 };
+static const UINT32 c_TimestampFractionDivisors[] = { 10000, 10, 1 };
+
+static constexpr UINT64 c_TimestampSecondsPerDay = 24 * 60 * 60;
+
+//
+// Days from 0000-03-01, the epoch of the date conversion, to 1601-01-01, the
+// epoch of FILETIME.
+//
+static constexpr UINT64 c_TimestampFileTimeEpochDays = 584694;
+
+static inline void
+WriteTwoDigits(
+    _Out_writes_(2) char* Buffer,
+    _In_ UINT32 Value
+    )
+{
+    Buffer[0] = static_cast<char>('0' + Value / 10);
+    Buffer[1] = static_cast<char>('0' + Value % 10);
+}
+
+///
+/// Writes the timestamp of a time in 100ns ticks since 1601-01-01 UTC, the
+/// value of a FILETIME.
+///
+/// \param Ticks    The time.
+/// \param Buffer   Returns the timestamp. It isn't null terminated.
+///
+/// \return The length of the timestamp.
+///
+size_t
+TimestampFormatter::Format(
+    _In_ UINT64 Ticks,
+    _Out_writes_(MAX_LENGTH) char* Buffer
+    )
+{
+    const UINT64 seconds = Ticks / TICKS_PER_SECOND;
+
+    if (seconds != m_cachedSecond)
+    {
+        UpdatePrefix(seconds);
+    }
+
+    memcpy(Buffer, m_prefix, PREFIX_LENGTH);
+
+    const size_t precision = static_cast<size_t>(m_precision);
+    const size_t digits = c_TimestampFractionDigits[precision];
+    UINT32 fraction = static_cast<UINT32>(Ticks % TICKS_PER_SECOND) / c_TimestampFractionDivisors[precision];
+
+    for (size_t i = PREFIX_LENGTH + digits; i > PREFIX_LENGTH; i--)
+    {
+        Buffer[i - 1] = static_cast<char>('0' + fraction % 10);
+        fraction /= 10;
+    }
+
+    Buffer[PREFIX_LENGTH + digits] = 'Z';
+
+    return PREFIX_LENGTH + digits + 1;
+}
+
+void
+TimestampFormatter::Append(
+    _Inout_ std::string& Buffer,
+    _In_ const FILETIME& Time
+    )
+{
+    char timestamp[MAX_LENGTH];
+    const size_t length = Format(ToTicks(Time), timestamp);
+
+    Buffer.append(timestamp, length);
+}
+
+void
+TimestampFormatter::Append(
+    _Inout_ std::wstring& Buffer,
+    _In_ const FILETIME& Time
+    )
+{
+    char timestamp[MAX_LENGTH];
+    const size_t length = Format(ToTicks(Time), timestamp);
+
+    Buffer.append(timestamp, timestamp + length);
+}
+
+///
+/// Sets the precision of the formatters returned by ForCurrentThread. It's
+/// set once, from the config file, before the monitors start.
+///
+void
+TimestampFormatter::SetDefaultPrecision(
+    _In_ TimestampPrecision Precision
+    )
+{
+    s_defaultPrecision.store(Precision, std::memory_order_relaxed);
+}
+
+TimestampPrecision
+TimestampFormatter::GetDefaultPrecision()
+{
+    return s_defaultPrecision.load(std::memory_order_relaxed);
+}
+
+///
+/// Returns the formatter of the calling thread, so its cache is kept between
+/// the timestamps written by the thread.
+///
+TimestampFormatter&
+TimestampFormatter::ForCurrentThread()
+{
+    thread_local TimestampFormatter formatter;
+
+    const TimestampPrecision precision = GetDefaultPrecision();
+
+    if (formatter.m_precision != precision)
+    {
+        formatter = TimestampFormatter(precision);
+    }
+
+    return formatter;
+}
+
+///
+/// Writes the date and time of a second to the cached prefix.
+///
+/// The date is computed from the number of days with the civil_from_days
+/// algorithm of Howard Hinnant, which counts the years from March so that
+/// the leap day is the last day of the year.
+///
+void
+TimestampFormatter::UpdatePrefix(
+    _In_ UINT64 Seconds
+    )
+{
+    const UINT64 day = Seconds / c_TimestampSecondsPerDay;
+
+    if (day != m_cachedDay)
+    {
+        const UINT64 days = day + c_TimestampFileTimeEpochDays;
+        const UINT64 era = days / 146097;
+        const UINT32 dayOfEra = static_cast<UINT32>(days - era * 146097);
+        const UINT32 yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+        const UINT32 dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+        const UINT32 shiftedMonth = (5 * dayOfYear + 2) / 153;
+        const UINT32 dayOfMonth = dayOfYear - (153 * shiftedMonth + 2) / 5 + 1;
+        const UINT32 month = (shiftedMonth < 10) ? shiftedMonth + 3 : shiftedMonth - 9;
+        const UINT32 year = static_cast<UINT32>(era * 400 + yearOfEra + ((month <= 2) ? 1 : 0));
+
+        WriteTwoDigits(m_prefix, year / 100 % 100);
+        WriteTwoDigits(m_prefix + 2, year % 100);
+        m_prefix[4] = '-';
+        WriteTwoDigits(m_prefix + 5, month);
+        m_prefix[7] = '-';
+        WriteTwoDigits(m_prefix + 8, dayOfMonth);
+        m_prefix[10] = 'T';
+        m_prefix[13] = ':';
+        m_prefix[16] = ':';
+        m_prefix[19] = '.';
+
+        m_cachedDay = day;
+    }
+
+    const UINT32 secondOfDay = static_cast<UINT32>(Seconds % c_TimestampSecondsPerDay);
+
+    WriteTwoDigits(m_prefix + 11, secondOfDay / 3600);
+    WriteTwoDigits(m_prefix + 14, secondOfDay / 60 % 60);
+    WriteTwoDigits(m_prefix + 17, secondOfDay % 60);
+
+    m_cachedSecond = Seconds;
+}
@@ -0,0 +1,109 @@
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+
+#pragma once
+
+///
+/// Number of digits of the fraction of a second in the timestamps.
+///
+enum class TimestampPrecision : UINT8
+{
+    Milliseconds = 0,
+    Microseconds,
+
+    //
+    // The resolution of a FILETIME.
+    //
+    HundredNanoseconds
+};
+
+///
+/// Writes UTC times in the ISO 8601 format, "yyyy-MM-ddTHH:mm:ss.fffZ", with
+/// 3, 6 or 7 digits in the fraction of a second.
+///
+/// A FILETIME is converted to a date with integer arithmetic, instead of
+/// FileTimeToSystemTime and the locale-aware GetDateFormatEx. The
+/// "yyyy-MM-ddTHH:mm:ss." prefix of the last second written is cached, so the
+/// timestamps of the same second only write their fraction, and those of the
+/// same day don't compute the date again. Years after 9999 aren't supported.
+///
+/// An instance isn't thread safe. ForCurrentThread returns a formatter owned
+/// by the calling thread, with the precision chosen for the process.
+///
+class TimestampFormatter final
+{
+public:
+    //
+    // Length of a timestamp with 7 digits in the fraction of a second.
+    //
+    static constexpr size_t MAX_LENGTH = 28;
+
+    static constexpr UINT64 TICKS_PER_SECOND = 10000000;
+
+    explicit TimestampFormatter(
+        _In_ TimestampPrecision Precision = TimestampPrecision::Milliseconds
+        ) :
+        m_precision(Precision)
+    {
+    }
+
+    TimestampPrecision GetPrecision() const
+    {
+        return m_precision;
+    }
+
+    size_t Format(
+        _In_ UINT64 Ticks,
+        _Out_writes_(MAX_LENGTH) char* Buffer
+        );
+
+    void Append(
+        _Inout_ std::string& Buffer,
+        _In_ const FILETIME& Time
+        );
+
+    void Append(
+        _Inout_ std::wstring& Buffer,
+        _In_ const FILETIME& Time
+        );
+
+    static UINT64 ToTicks(
+        _In_ const FILETIME& Time
+        )
+    {
+        return (static_cast<UINT64>(Time.dwHighDateTime) << 32) | Time.dwLowDateTime;
+    }
+
+    static void SetDefaultPrecision(
+        _In_ TimestampPrecision Precision
+        );
+
+    static TimestampPrecision GetDefaultPrecision();
+
+    static TimestampFormatter& ForCurrentThread();
+
+private:
+    //
+    // Length of "yyyy-MM-ddTHH:mm:ss.".
+    //
+    static constexpr size_t PREFIX_LENGTH = 20;
+
+    static std::atomic<TimestampPrecision> s_defaultPrecision;
+
+    TimestampPrecision m_precision;
+
+    //
+    // Second of the cached prefix, counted from the FILETIME epoch, and the
+    // day of its date.
+    //
+    UINT64 m_cachedSecond = ~0ULL;
+    UINT64 m_cachedDay = ~0ULL;
+
+    char m_prefix[PREFIX_LENGTH] = {};
+
+    void UpdatePrefix(
+        _In_ UINT64 Seconds
+        );
+};
@@ -0,0 +1,93 @@
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+
+#include "pch.h"
+
+///
+/// Sets the rate of the bucket, and fills it. Called before the bucket is
+/// used by other threads.
+///
+/// \param RecordsPerSecond     Tokens added per second. 0 to disable the
+///                             limit.
+/// \param Burst                Size of the bucket, the lines that can be
+///                             written at once. 0 for one second of lines.
+///
+void
+TokenBucket::Configure(
+    _In_ DWORD RecordsPerSecond,
+    _In_ DWORD Burst
+    )
+{
+    m_recordsPerSecond = RecordsPerSecond;
+    m_interval = 0;
+    m_capacity = 0;
+    m_fullTime = 0;
+
+    if (RecordsPerSecond == 0)
+    {
+        return;
+    }
+
+    LARGE_INTEGER frequency;
+    QueryPerformanceFrequency(&frequency);
+
+    m_interval = (std::max)(frequency.QuadPart / RecordsPerSecond, 1LL);
+    m_capacity = m_interval * (Burst != 0 ? Burst : RecordsPerSecond);
+}
+
+///
+/// Takes a token at the current time.
+///
+/// \return False if the bucket is empty, and the line is suppressed.
+///
+bool
+TokenBucket::TryTake()
+{
+    if (m_interval == 0)
+    {
+        return true;
+    }
+
+    LARGE_INTEGER now;
+    QueryPerformanceCounter(&now);
+
+    return TryTake(now.QuadPart);
+}
+
+///
+/// \param Now      The current performance counter ticks.
+///
+/// \return False if the bucket is empty, and the line is suppressed.
+///
+bool
+TokenBucket::TryTake(
+    _In_ INT64 Now
+    )
+{
+    if (m_interval == 0)
+    {
+        return true;
+    }
+
+    INT64 fullTime = m_fullTime.load(std::memory_order_relaxed);
+
+    for (;;)
+    {
+        //
+        // A bucket that was full before now is just full.
+        //
+        const INT64 nextFullTime = (std::max)(fullTime, Now) + m_interval;
+
+        if (nextFullTime - Now > m_capacity)
+        {
+            return false;
+        }
+
+        if (m_fullTime.compare_exchange_weak(fullTime, nextFullTime, std::memory_order_relaxed))
+        {
+            return true;
+        }
+    }
+}
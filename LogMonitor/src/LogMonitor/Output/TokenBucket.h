@@ -0,0 +1,64 @@
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+
+#pragma once
+
+///
+/// Token bucket that limits the rate of the lines of a source, without a
+/// lock.
+///
+/// The bucket holds up to Burst tokens, and is refilled with
+/// RecordsPerSecond tokens per second. Each line takes a token, and is
+/// suppressed when the bucket is empty.
+///
+/// Instead of a count of tokens refilled by a timer, the bucket is kept as
+/// the single time at which it's full again: each token taken pushes that
+/// time one interval later, and a token can be taken as long as that time
+/// is less than Burst intervals away. TryTake is then one compare-exchange
+/// on the hot path of the producers, with no lock and no timer.
+///
+/// The times are performance counter ticks.
+///
+class TokenBucket final
+{
+public:
+    TokenBucket() = default;
+
+    TokenBucket(const TokenBucket&) = delete;
+    TokenBucket& operator=(const TokenBucket&) = delete;
+
+    void Configure(
+        _In_ DWORD RecordsPerSecond,
+        _In_ DWORD Burst
+        );
+
+    bool IsEnabled() const
+    {
+        return m_interval != 0;
+    }
+
+    DWORD GetRecordsPerSecond() const
+    {
+        return m_recordsPerSecond;
+    }
+
+    bool TryTake();
+
+    bool TryTake(
+        _In_ INT64 Now
+        );
+
+private:
+    DWORD m_recordsPerSecond = 0;
+
+    //
+    // Ticks per token, and ticks of a full bucket. Zero if the rate isn't
+    // limited.
+    //
+    INT64 m_interval = 0;
+    INT64 m_capacity = 0;
+
+    std::atomic<INT64> m_fullTime{ 0 };
+};
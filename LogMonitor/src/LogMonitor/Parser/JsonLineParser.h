@@ -0,0 +1,102 @@
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+
+#pragma once
+
+///
+/// Parses a UTF-8 log line that is a JSON object, like the lines of the
+/// structured loggers, into its top-level members.
+///
+/// The members are views (pointer and length) into the line, so the line
+/// isn't copied: the name and the value of a string are their content
+/// between the quotes, still escaped, and any other value is its JSON text.
+/// AppendUnescaped decodes them when the output needs it. Nested objects
+/// and arrays are validated, but not split into members.
+///
+/// A line that isn't a single valid JSON object, with only whitespace
+/// around it, isn't parsed. Its first character is enough to skip a line
+/// of text.
+///
+/// The parser is reused between lines, so its members don't allocate once
+/// the vector is large enough. The views are only valid as long as the
+/// line is.
+///
+class JsonLineParser final
+{
+public:
+    //
+    // A line with values nested deeper isn't parsed.
+    //
+    static constexpr size_t MAX_DEPTH = 64;
+
+    enum class ValueType
+    {
+        String,
+        Number,
+        Boolean,
+        Null,
+        Object,
+        Array
+    };
+
+    struct Member
+    {
+        const char* Name;
+        size_t NameLength;
+        const char* Value;
+        size_t ValueLength;
+        ValueType Type;
+    };
+
+    bool Parse(
+        _In_reads_(Length) const char* Line,
+        _In_ size_t Length
+        );
+
+    const std::vector<Member>& GetMembers() const
+    {
+        return m_members;
+    }
+
+    static void AppendUnescaped(
+        _Inout_ std::string& Buffer,
+        _In_reads_(Length) const char* Value,
+        _In_ size_t Length
+        );
+
+private:
+    std::vector<Member> m_members;
+
+    const char* m_position = nullptr;
+    const char* m_end = nullptr;
+
+    void SkipWhitespace();
+
+    bool ParseValue(
+        _In_ size_t Depth,
+        _Out_ ValueType& Type
+        );
+
+    bool ParseString();
+
+    bool ParseNumber();
+
+    bool ParseLiteral(
+        _In_z_ const char* Literal
+        );
+
+    bool ParseObject(
+        _In_ size_t Depth
+        );
+
+    bool ParseArray(
+        _In_ size_t Depth
+        );
+
+    static bool ParseHex4(
+        _In_reads_(4) const char* Digits,
+        _Out_ UINT32& Value
+        );
+};
@@ -1,414 +1,856 @@
-//
-// Copyright (c) Microsoft Corporation.
-// Licensed under the MIT license.
-//
-
-#pragma once
-
-#define DEFAULT_CONFIG_FILENAME L"C:\\LogMonitor\\LogMonitorConfig.json"
-
-#define JSON_TAG_LOG_CONFIG L"LogConfig"
-#define JSON_TAG_SOURCES L"sources"
-
-///
-/// Valid source attributes
-///
-#define JSON_TAG_TYPE L"type"
-#define JSON_TAG_FORMAT_MULTILINE L"eventFormatMultiLine"
-#define JSON_TAG_START_AT_OLDEST_RECORD L"startAtOldestRecord"
-#define JSON_TAG_CHANNELS L"channels"
-#define JSON_TAG_DIRECTORY L"directory"
-#define JSON_TAG_FILTER L"filter"
-#define JSON_TAG_INCLUDE_SUBDIRECTORIES L"includeSubdirectories"
-#define JSON_TAG_INCLUDE_FILENAMES L"includeFileNames"
-#define JSON_TAG_PROVIDERS L"providers"
-
-///
-/// Valid channel attributes
-///
-#define JSON_TAG_CHANNEL_NAME L"name"
-#define JSON_TAG_CHANNEL_LEVEL L"level"
-
-///
-/// Valid ETW provider attributes
-///
-#define JSON_TAG_PROVIDER_NAME L"providerName"
-#define JSON_TAG_PROVIDER_GUID L"providerGuid"
-#define JSON_TAG_PROVIDER_LEVEL L"level"
-#define JSON_TAG_KEYWORDS L"keywords"
-
-//
-// Define the AttributesMap, that is a map<wstring, void*> with case
-// insensitive keys
-//
-struct CaseInsensitiveWideString
-{
-    bool operator() (const std::wstring& c1, const std::wstring& c2) const {
-        return _wcsicmp(c1.c_str(), c2.c_str()) < 0;
-    }
-};
-
-typedef std::map<std::wstring, void*, CaseInsensitiveWideString> AttributesMap;
-
-enum class EventChannelLogLevel
-{
-    Critical = 1,
-    Error = 2,
-    Warning = 3,
-    Information = 4,
-    Verbose = 5,
-    All = 6,
-};
-
-DEFINE_ENUM_FLAG_OPERATORS(EventChannelLogLevel);
-
-///
-/// String names of the EventChannelLogLevel enum, used to parse the config file
-///
-const std::wstring LogLevelNames[] = {
-    L"Critical",
-    L"Error",
-    L"Warning",
-    L"Information",
-    L"Verbose"
-};
-
-///
-/// Array with EventChannelLogLevel enum values, used to get the real value,
-/// when you have the index of the desired value at LogLevelNames.
-///
-const EventChannelLogLevel LogLevelValues[] = {
-    EventChannelLogLevel::Critical,
-    EventChannelLogLevel::Error,
-    EventChannelLogLevel::Warning,
-    EventChannelLogLevel::Information,
-    EventChannelLogLevel::Verbose
-};
-
-inline
-bool
-StringToGuid(_In_ const std::wstring& str, _Out_ GUID& guid)
-{
-    std::wstring guidStr;
-
-    //
-    // Validate if is a GUID
-    //
-    if (str.length() == 36)
-    {
-        guidStr = str;
-    }
-    else if (str.length() == 38
-        && str[0] == '{'
-        && str[37] == '}')
-    {
-        guidStr = str.substr(1, 36);
-    }
-    else
-    {
-        return false;
-    }
-
-    for (int i = 0; i < 36; i++)
-    {
-        if (i == 8 || i == 13 || i == 18 || i == 23)
-        {
-            if (guidStr[i] != '-')
-            {
-                return false;
-            }
-        }
-        else if (!isxdigit(guidStr[i]))
-        {
-            return false;
-        }
-    }
-
-    int count = swscanf_s(guidStr.c_str(),
-        L"%8x-%4hx-%4hx-%2hhx%2hhx-%2hhx%2hhx%2hhx%2hhx%2hhx%2hhx",
-        &guid.Data1, &guid.Data2, &guid.Data3,
-        &guid.Data4[0], &guid.Data4[1], &guid.Data4[2], &guid.Data4[3],
-        &guid.Data4[4], &guid.Data4[5], &guid.Data4[6], &guid.Data4[7]);
-
-    //
-    // Check if all the data was successfully read
-    //
-    return count == 11;
-}
-
-enum class LogSourceType
-{
-    EventLog = 0,
-    File,
-    ETW
-};
-
-///
-/// String names of the LogSourceType enum, used to parse the config file
-///
-const LPCWSTR LogSourceTypeNames[] = {
-    L"EventLog",
-    L"File",
-    L"ETW"
-};
-
-///
-/// Base class of a generic source configuration.
-/// it only include the type (used to recover the real type with polymorphism)
-///
-class LogSource
-{
-public:
-    LogSourceType Type;
-};
-
-///
-/// Information about an event log channel, It includes its name and Log level
-///
-typedef struct _EventLogChannel
-{
-    std::wstring Name;
-    EventChannelLogLevel Level = EventChannelLogLevel::Error;
-
-    inline bool IsValid()
-    {
-        return !Name.empty();
-    }
-
-    inline bool SetLevelByString(
-        _In_ const std::wstring& Str
-    )
-    {
-        int errorLevelSize = sizeof(LogLevelNames) / sizeof(LogLevelNames[0]);
-
-        for (int i = 0; i < errorLevelSize; i++)
-        {
-            if (_wcsicmp(Str.c_str(), LogLevelNames[i].c_str()) == 0)
-            {
-                Level = LogLevelValues[i];
-                return true;
-            }
-        }
-
-        return false;
-    }
-} EventLogChannel;
-
-///
-/// Represents a Source of EventLog type
-///
-class SourceEventLog : LogSource
-{
-public:
-    std::vector<EventLogChannel> Channels;
-    bool EventFormatMultiLine = true;
-    bool StartAtOldestRecord = false;
-
-    static bool Unwrap(
-        _In_ AttributesMap& Attributes,
-        _Out_ SourceEventLog& NewSource)
-    {
-        NewSource.Type = LogSourceType::EventLog;
-
-        //
-        // Get required 'channels' value
-        //
-        if (Attributes.find(JSON_TAG_CHANNELS) == Attributes.end()
-            || Attributes[JSON_TAG_CHANNELS] == nullptr)
-        {
-            return false;
-        }
-
-        //
-        // Clone the array, the original one could be deleted.
-        //
-        NewSource.Channels = *(std::vector<EventLogChannel>*)Attributes[JSON_TAG_CHANNELS];
-
-        //
-        // eventFormatMultiLine is an optional value
-        //
-        if (Attributes.find(JSON_TAG_FORMAT_MULTILINE) != Attributes.end()
-            && Attributes[JSON_TAG_FORMAT_MULTILINE] != nullptr)
-        {
-            NewSource.EventFormatMultiLine = *(bool*)Attributes[JSON_TAG_FORMAT_MULTILINE];
-        }
-
-        //
-        // startAtOldestRecord is an optional value
-        //
-        if (Attributes.find(JSON_TAG_START_AT_OLDEST_RECORD) != Attributes.end()
-            && Attributes[JSON_TAG_START_AT_OLDEST_RECORD] != nullptr)
-        {
-            NewSource.StartAtOldestRecord = *(bool*)Attributes[JSON_TAG_START_AT_OLDEST_RECORD];
-        }
-
-        return true;
-    }
-};
-
-///
-/// Represents a Source of File type
-///
-class SourceFile : LogSource
-{
-public:
-    std::wstring Directory;
-    std::wstring Filter;
-    bool IncludeSubdirectories = false;
-    bool IncludeFileNames = false;
-
-    static bool Unwrap(
-        _In_ AttributesMap& Attributes,
-        _Out_ SourceFile& NewSource)
-    {
-        NewSource.Type = LogSourceType::File;
-
-        //
-        // Directory is required
-        //
-        if (Attributes.find(JSON_TAG_DIRECTORY) == Attributes.end()
-            || Attributes[JSON_TAG_DIRECTORY] == nullptr)
-        {
-            return false;
-        }
-
-        //
-        // Clone the value, the original one could be deleted.
-        //
-        NewSource.Directory = *(std::wstring*)Attributes[JSON_TAG_DIRECTORY];
-
-        //
-        // Filter is an optional value
-        //
-        if (Attributes.find(JSON_TAG_FILTER) != Attributes.end()
-            && Attributes[JSON_TAG_FILTER] != nullptr)
-        {
-            NewSource.Filter = *(std::wstring*)Attributes[JSON_TAG_FILTER];
-        }
-
-        //
-        // includeSubdirectories is an optional value
-        //
-        if (Attributes.find(JSON_TAG_INCLUDE_SUBDIRECTORIES) != Attributes.end()
-            && Attributes[JSON_TAG_INCLUDE_SUBDIRECTORIES] != nullptr)
-        {
-            NewSource.IncludeSubdirectories = *(bool*)Attributes[JSON_TAG_INCLUDE_SUBDIRECTORIES];
-        }
-
-        //
-        // includeFileNames is an optional value
-        //
-        if (Attributes.find(JSON_TAG_INCLUDE_FILENAMES) != Attributes.end()
-            && Attributes[JSON_TAG_INCLUDE_FILENAMES] != nullptr)
-        {
-            NewSource.IncludeFileNames = *(bool*)Attributes[JSON_TAG_INCLUDE_FILENAMES];
-        }
-
-        return true;
-    }
-};
-
-///
-/// ETW Provider
-///
-class ETWProvider
-{
-public:
-    std::wstring ProviderName;
-    std::wstring ProviderGuidStr;
-    GUID ProviderGuid = { 0 };
-    ULONGLONG Keywords = 0;
-    UCHAR Level = 2; // Error level
-
-    inline bool IsValid()
-    {
-        return !ProviderName.empty() || !ProviderGuidStr.empty();
-    }
-
-    inline bool SetProviderGuid(const std::wstring &value)
-    {
-        GUID guid;
-
-        if (!StringToGuid(value, guid))
-        {
-            return false;
-        }
-
-        ProviderGuid = guid;
-        ProviderGuidStr = value;
-
-        return true;
-    }
-
-    inline bool StringToLevel(
-        _In_ const std::wstring& Str
-    )
-    {
-        int errorLevelSize = (sizeof(LogLevelNames) / sizeof(LogLevelNames[0])); // Don't include the ALL value
-
-        for (UCHAR i = 0; i < errorLevelSize; i++)
-        {
-            if (_wcsicmp(Str.c_str(), LogLevelNames[i].c_str()) == 0)
-            {
-                //
-                // Level starts at 1
-                //
-                Level = i + 1;
-                return true;
-            }
-        }
-
-        return false;
-    }
-};
-
-///
-/// Represents a Source if ETW type
-///
-class SourceETW : LogSource
-{
-public:
-    std::vector<ETWProvider> Providers;
-    bool EventFormatMultiLine = true;
-
-    static bool Unwrap(
-        _In_ AttributesMap& Attributes,
-        _Out_ SourceETW& NewSource)
-    {
-        NewSource.Type = LogSourceType::ETW;
-
-        //
-        // Get required 'providers' value
-        //
-        if (Attributes.find(JSON_TAG_PROVIDERS) == Attributes.end()
-            || Attributes[JSON_TAG_PROVIDERS] == nullptr)
-        {
-            return false;
-        }
-
-        //
-        // Clone the array, the original one could be deleted.
-        //
-        NewSource.Providers = *(std::vector<ETWProvider>*)Attributes[JSON_TAG_PROVIDERS];
-
-        //
-        // eventFormatMultiLine is an optional value
-        //
-        if (Attributes.find(JSON_TAG_FORMAT_MULTILINE) != Attributes.end()
-            && Attributes[JSON_TAG_FORMAT_MULTILINE] != nullptr)
-        {
-            NewSource.EventFormatMultiLine = *(bool*)Attributes[JSON_TAG_FORMAT_MULTILINE];
-        }
-
-
-        return true;
-    }
-};
-
-///
-/// Information about a channel Log
-///
-typedef struct _LoggerSettings
-{
-    std::vector<std::shared_ptr<LogSource> > Sources;
-} LoggerSettings;
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+
+#pragma once
+
+#define DEFAULT_CONFIG_FILENAME L"C:\\LogMonitor\\LogMonitorConfig.json"
+
+#define JSON_TAG_LOG_CONFIG L"LogConfig"
+#define JSON_TAG_SOURCES L"sources"
+#define JSON_TAG_OUTPUT L"output"
+
+///
+/// Valid source attributes
+///
+#define JSON_TAG_TYPE L"type"
+#define JSON_TAG_FORMAT_MULTILINE L"eventFormatMultiLine"
+#define JSON_TAG_START_AT_OLDEST_RECORD L"startAtOldestRecord"
+#define JSON_TAG_CHANNELS L"channels"
+#define JSON_TAG_DIRECTORY L"directory"
+#define JSON_TAG_FILTER L"filter"
+#define JSON_TAG_INCLUDE_SUBDIRECTORIES L"includeSubdirectories"
+#define JSON_TAG_INCLUDE_FILENAMES L"includeFileNames"
+#define JSON_TAG_MAX_READ_BUFFER_SIZE L"maxReadBufferSize"
+#define JSON_TAG_CHECKPOINT_FILE L"checkpointFile"
+#define JSON_TAG_CHECKPOINT_INTERVAL L"checkpointIntervalSeconds"
+#define JSON_TAG_PROVIDERS L"providers"
+#define JSON_TAG_OVERFLOW_POLICY L"overflowPolicy"
+#define JSON_TAG_OVERFLOW_SAMPLE_RATE L"overflowSampleRate"
+#define JSON_TAG_RATE_LIMIT L"rateLimit"
+#define JSON_TAG_RATE_LIMIT_BURST L"rateLimitBurst"
+#define JSON_TAG_PARSE_JSON_LINES L"parseJsonLines"
+
+///
+/// Valid output attributes
+///
+#define JSON_TAG_FLUSH_LATENCY L"flushLatencyMillis"
+#define JSON_TAG_MAX_BUFFERED_BYTES L"maxBufferedBytes"
+#define JSON_TAG_DROP_REPORT_INTERVAL L"dropReportIntervalSeconds"
+#define JSON_TAG_OUTPUT_FORMAT L"format"
+#define JSON_TAG_TIMESTAMP_PRECISION L"timestampPrecision"
+#define JSON_TAG_OUTPUT_STDOUT L"stdout"
+#define JSON_TAG_OUTPUT_FILE L"file"
+#define JSON_TAG_OUTPUT_NETWORK L"network"
+
+///
+/// Valid output file attributes
+///
+#define JSON_TAG_FILE_PATH L"path"
+#define JSON_TAG_MAX_FILE_SIZE L"maxFileSizeBytes"
+#define JSON_TAG_ROTATION_INTERVAL L"rotationIntervalSeconds"
+#define JSON_TAG_RETAINED_FILES L"retainedFiles"
+#define JSON_TAG_PREALLOCATE_BYTES L"preallocateBytes"
+#define JSON_TAG_COMPRESSION L"compression"
+#define JSON_TAG_COMPRESSION_BLOCK_BYTES L"compressionBlockBytes"
+
+///
+/// Valid output network attributes. 'maxBufferedBytes' is shared with the
+/// output attributes.
+///
+#define JSON_TAG_NETWORK_HOST L"host"
+#define JSON_TAG_NETWORK_PORT L"port"
+#define JSON_TAG_NETWORK_PROTOCOL L"protocol"
+#define JSON_TAG_NETWORK_FRAMING L"framing"
+#define JSON_TAG_NETWORK_TAG L"tag"
+#define JSON_TAG_MAX_BATCH_RECORDS L"maxBatchRecords"
+#define JSON_TAG_MAX_BATCH_BYTES L"maxBatchBytes"
+#define JSON_TAG_MAX_BATCH_DELAY L"maxBatchDelayMillis"
+#define JSON_TAG_MIN_RECONNECT_DELAY L"minReconnectDelayMillis"
+#define JSON_TAG_MAX_RECONNECT_DELAY L"maxReconnectDelayMillis"
+#define JSON_TAG_QUEUE_DIRECTORY L"queueDirectory"
+#define JSON_TAG_QUEUE_MAX_BYTES L"queueMaxBytes"
+#define JSON_TAG_QUEUE_SEGMENT_BYTES L"queueSegmentBytes"
+
+///
+/// Valid channel attributes
+///
+#define JSON_TAG_CHANNEL_NAME L"name"
+#define JSON_TAG_CHANNEL_LEVEL L"level"
+
+///
+/// Valid ETW provider attributes
+///
+#define JSON_TAG_PROVIDER_NAME L"providerName"
+#define JSON_TAG_PROVIDER_GUID L"providerGuid"
+#define JSON_TAG_PROVIDER_LEVEL L"level"
+#define JSON_TAG_KEYWORDS L"keywords"
+
+//
+// Define the AttributesMap, that is a map<wstring, void*> with case
+// insensitive keys
+//
+struct CaseInsensitiveWideString
+{
+    bool operator() (const std::wstring& c1, const std::wstring& c2) const {
+        return _wcsicmp(c1.c_str(), c2.c_str()) < 0;
+    }
+};
+
+typedef std::map<std::wstring, void*, CaseInsensitiveWideString> AttributesMap;
+
+enum class EventChannelLogLevel
+{
+    Critical = 1,
+    Error = 2,
+    Warning = 3,
+    Information = 4,
+    Verbose = 5,
+    All = 6,
+};
+
+DEFINE_ENUM_FLAG_OPERATORS(EventChannelLogLevel);
+
+///
+/// String names of the EventChannelLogLevel enum, used to parse the config file
+///
+const std::wstring LogLevelNames[] = {
+    L"Critical",
+    L"Error",
+    L"Warning",
+    L"Information",
+    L"Verbose"
+};
+
+///
+/// Array with EventChannelLogLevel enum values, used to get the real value,
+/// when you have the index of the desired value at LogLevelNames.
+///
+const EventChannelLogLevel LogLevelValues[] = {
+    EventChannelLogLevel::Critical,
+    EventChannelLogLevel::Error,
+    EventChannelLogLevel::Warning,
+    EventChannelLogLevel::Information,
+    EventChannelLogLevel::Verbose
+};
+
+inline
+bool
+StringToGuid(_In_ const std::wstring& str, _Out_ GUID& guid)
+{
+    std::wstring guidStr;
+
+    //
+    // Validate if is a GUID
+    //
+    if (str.length() == 36)
+    {
+        guidStr = str;
+    }
+    else if (str.length() == 38
+        && str[0] == '{'
+        && str[37] == '}')
+    {
+        guidStr = str.substr(1, 36);
+    }
+    else
+    {
+        return false;
+    }
+
+    for (int i = 0; i < 36; i++)
+    {
+        if (i == 8 || i == 13 || i == 18 || i == 23)
+        {
+            if (guidStr[i] != '-')
+            {
+                return false;
+            }
+        }
+        else if (!isxdigit(guidStr[i]))
+        {
+            return false;
+        }
+    }
+
+    int count = swscanf_s(guidStr.c_str(),
+        L"%8x-%4hx-%4hx-%2hhx%2hhx-%2hhx%2hhx%2hhx%2hhx%2hhx%2hhx",
+        &guid.Data1, &guid.Data2, &guid.Data3,
+        &guid.Data4[0], &guid.Data4[1], &guid.Data4[2], &guid.Data4[3],
+        &guid.Data4[4], &guid.Data4[5], &guid.Data4[6], &guid.Data4[7]);
+
+    //
+    // Check if all the data was successfully read
+    //
+    return count == 11;
+}
+
+enum class LogSourceType
+{
+    EventLog = 0,
+    File,
+    ETW,
+    Process
+};
+
+///
+/// String names of the LogSourceType enum, used to parse the config file
+///
+const LPCWSTR LogSourceTypeNames[] = {
+    L"EventLog",
+    L"File",
+    L"ETW",
+    L"Process"
+};
+
+///
+/// What a source does with a new line when the lines waiting to be written
+/// to stdout already use all the output memory budget.
+///
+enum class OverflowPolicy
+{
+    //
+    // Wait until there is room. No line is lost.
+    //
+    Block = 0,
+
+    //
+    // Discard the oldest waiting lines of 'DropOldest' sources to make room.
+    // The new line is discarded if that isn't enough.
+    //
+    DropOldest,
+
+    //
+    // Discard the new line.
+    //
+    DropNewest,
+
+    //
+    // Keep one line out of overflowSampleRate, waiting for room like Block,
+    // and discard the others.
+    //
+    Sample
+};
+
+///
+/// String names of the OverflowPolicy enum, used to parse the config file
+///
+const LPCWSTR OverflowPolicyNames[] = {
+    L"Block",
+    L"DropOldest",
+    L"DropNewest",
+    L"Sample"
+};
+
+///
+/// Format of the lines written to stdout.
+///
+enum class OutputFormat
+{
+    //
+    // Event Log and ETW events as XML elements, log file lines as they are.
+    //
+    Xml = 0,
+
+    //
+    // One JSON object per line, for all the sources.
+    //
+    Json
+};
+
+///
+/// String names of the OutputFormat enum, used to parse the config file
+///
+const LPCWSTR OutputFormatNames[] = {
+    L"XML",
+    L"JSON"
+};
+
+///
+/// String names of the TimestampPrecision enum, used to parse the config file
+///
+const LPCWSTR TimestampPrecisionNames[] = {
+    L"Milliseconds",
+    L"Microseconds",
+    L"HundredNanoseconds"
+};
+
+///
+/// String names of the CompressionCodec enum, used to parse the config file
+///
+const LPCWSTR CompressionCodecNames[] = {
+    L"None",
+    L"LZ4"
+};
+
+///
+/// Transport of the lines sent to a log collector.
+///
+enum class NetworkProtocol
+{
+    Udp = 0,
+    Tcp
+};
+
+///
+/// String names of the NetworkProtocol enum, used to parse the config file
+///
+const LPCWSTR NetworkProtocolNames[] = {
+    L"UDP",
+    L"TCP"
+};
+
+///
+/// Framing of the lines sent to a log collector.
+///
+enum class NetworkFraming
+{
+    //
+    // One RFC 5424 syslog message per line. Over TCP, the messages are
+    // prefixed with their length, as in RFC 6587 octet counting.
+    //
+    Syslog = 0,
+
+    //
+    // Fluentd Forward protocol, in Forward mode: one MessagePack message
+    // per batch, with an entry per line. TCP only.
+    //
+    FluentForward
+};
+
+///
+/// String names of the NetworkFraming enum, used to parse the config file
+///
+const LPCWSTR NetworkFramingNames[] = {
+    L"Syslog",
+    L"FluentForward"
+};
+
+///
+/// Base class of a generic source configuration.
+/// It includes the type (used to recover the real type with polymorphism)
+/// and the settings shared by all the source types.
+///
+class LogSource
+{
+public:
+    LogSourceType Type;
+    OverflowPolicy Overflow = OverflowPolicy::Block;
+    DWORD OverflowSampleRate = 10;
+
+    //
+    // Maximum lines per second, and lines written at once above it. Zero
+    // means no limit, and a burst of one second of lines.
+    //
+    DWORD RateLimit = 0;
+    DWORD RateLimitBurst = 0;
+
+protected:
+    void UnwrapOverflowAttributes(
+        _In_ AttributesMap& Attributes)
+    {
+        //
+        // overflowPolicy is an optional value
+        //
+        if (Attributes.find(JSON_TAG_OVERFLOW_POLICY) != Attributes.end()
+            && Attributes[JSON_TAG_OVERFLOW_POLICY] != nullptr)
+        {
+            Overflow = *(OverflowPolicy*)Attributes[JSON_TAG_OVERFLOW_POLICY];
+        }
+
+        //
+        // overflowSampleRate is an optional value
+        //
+        if (Attributes.find(JSON_TAG_OVERFLOW_SAMPLE_RATE) != Attributes.end()
+            && Attributes[JSON_TAG_OVERFLOW_SAMPLE_RATE] != nullptr)
+        {
+            const double sampleRate = *(double*)Attributes[JSON_TAG_OVERFLOW_SAMPLE_RATE];
+
+            OverflowSampleRate = (sampleRate >= MAXDWORD)
+                ? MAXDWORD
+                : (sampleRate >= 1 ? static_cast<DWORD>(sampleRate) : 1);
+        }
+    }
+
+    void UnwrapRateLimitAttributes(
+        _In_ AttributesMap& Attributes)
+    {
+        //
+        // rateLimit is an optional value
+        //
+        if (Attributes.find(JSON_TAG_RATE_LIMIT) != Attributes.end()
+            && Attributes[JSON_TAG_RATE_LIMIT] != nullptr)
+        {
+            const double rateLimit = *(double*)Attributes[JSON_TAG_RATE_LIMIT];
+
+            RateLimit = (rateLimit >= MAXDWORD)
+                ? MAXDWORD
+                : (rateLimit > 0 ? static_cast<DWORD>(rateLimit) : 0);
+        }
+
+        //
+        // rateLimitBurst is an optional value
+        //
+        if (Attributes.find(JSON_TAG_RATE_LIMIT_BURST) != Attributes.end()
+            && Attributes[JSON_TAG_RATE_LIMIT_BURST] != nullptr)
+        {
+            const double rateLimitBurst = *(double*)Attributes[JSON_TAG_RATE_LIMIT_BURST];
+
+            RateLimitBurst = (rateLimitBurst >= MAXDWORD)
+                ? MAXDWORD
+                : (rateLimitBurst > 0 ? static_cast<DWORD>(rateLimitBurst) : 0);
+        }
+    }
+};
+
+///
+/// Information about an event log channel, It includes its name and Log level
+///
+typedef struct _EventLogChannel
+{
+    std::wstring Name;
+    EventChannelLogLevel Level = EventChannelLogLevel::Error;
+
+    //
+    // LogWriter source of the events of the channel, registered for its
+    // EventLog source when the monitors are started.
+    //
+    UINT32 OutputSourceId = 0;
+
+    inline bool IsValid()
+    {
+        return !Name.empty();
+    }
+
+    inline bool SetLevelByString(
+        _In_ const std::wstring& Str
+    )
+    {
+        int errorLevelSize = sizeof(LogLevelNames) / sizeof(LogLevelNames[0]);
+
+        for (int i = 0; i < errorLevelSize; i++)
+        {
+            if (_wcsicmp(Str.c_str(), LogLevelNames[i].c_str()) == 0)
+            {
+                Level = LogLevelValues[i];
+                return true;
+            }
+        }
+
+        return false;
+    }
+} EventLogChannel;
+
+///
+/// Represents a Source of EventLog type
+///
+class SourceEventLog : LogSource
+{
+public:
+    std::vector<EventLogChannel> Channels;
+    bool EventFormatMultiLine = true;
+    bool StartAtOldestRecord = false;
+
+    static bool Unwrap(
+        _In_ AttributesMap& Attributes,
+        _Out_ SourceEventLog& NewSource)
+    {
+        NewSource.Type = LogSourceType::EventLog;
+
+        //
+        // Get required 'channels' value
+        //
+        if (Attributes.find(JSON_TAG_CHANNELS) == Attributes.end()
+            || Attributes[JSON_TAG_CHANNELS] == nullptr)
+        {
+            return false;
+        }
+
+        //
+        // Clone the array, the original one could be deleted.
+        //
+        NewSource.Channels = *(std::vector<EventLogChannel>*)Attributes[JSON_TAG_CHANNELS];
+
+        //
+        // eventFormatMultiLine is an optional value
+        //
+        if (Attributes.find(JSON_TAG_FORMAT_MULTILINE) != Attributes.end()
+            && Attributes[JSON_TAG_FORMAT_MULTILINE] != nullptr)
+        {
+            NewSource.EventFormatMultiLine = *(bool*)Attributes[JSON_TAG_FORMAT_MULTILINE];
+        }
+
+        //
+        // startAtOldestRecord is an optional value
+        //
+        if (Attributes.find(JSON_TAG_START_AT_OLDEST_RECORD) != Attributes.end()
+            && Attributes[JSON_TAG_START_AT_OLDEST_RECORD] != nullptr)
+        {
+            NewSource.StartAtOldestRecord = *(bool*)Attributes[JSON_TAG_START_AT_OLDEST_RECORD];
+        }
+
+        NewSource.UnwrapOverflowAttributes(Attributes);
+        NewSource.UnwrapRateLimitAttributes(Attributes);
+
+        return true;
+    }
+};
+
+///
+/// Represents a Source of File type
+///
+class SourceFile : LogSource
+{
+public:
+    std::wstring Directory;
+    std::wstring Filter;
+    bool IncludeSubdirectories = false;
+    bool IncludeFileNames = false;
+    DWORD MaxReadBufferSize = 0; // Zero means the LogFileMonitor default.
+    std::wstring CheckpointFile;
+    DWORD CheckpointIntervalSeconds = 0; // Zero means the LogFileMonitor default.
+
+    static bool Unwrap(
+        _In_ AttributesMap& Attributes,
+        _Out_ SourceFile& NewSource)
+    {
+        NewSource.Type = LogSourceType::File;
+
+        //
+        // Directory is required
+        //
+        if (Attributes.find(JSON_TAG_DIRECTORY) == Attributes.end()
+            || Attributes[JSON_TAG_DIRECTORY] == nullptr)
+        {
+            return false;
+        }
+
+        //
+        // Clone the value, the original one could be deleted.
+        //
+        NewSource.Directory = *(std::wstring*)Attributes[JSON_TAG_DIRECTORY];
+
+        //
+        // Filter is an optional value
+        //
+        if (Attributes.find(JSON_TAG_FILTER) != Attributes.end()
+            && Attributes[JSON_TAG_FILTER] != nullptr)
+        {
+            NewSource.Filter = *(std::wstring*)Attributes[JSON_TAG_FILTER];
+        }
+
+        //
+        // includeSubdirectories is an optional value
+        //
+        if (Attributes.find(JSON_TAG_INCLUDE_SUBDIRECTORIES) != Attributes.end()
+            && Attributes[JSON_TAG_INCLUDE_SUBDIRECTORIES] != nullptr)
+        {
+            NewSource.IncludeSubdirectories = *(bool*)Attributes[JSON_TAG_INCLUDE_SUBDIRECTORIES];
+        }
+
+        //
+        // includeFileNames is an optional value
+        //
+        if (Attributes.find(JSON_TAG_INCLUDE_FILENAMES) != Attributes.end()
+            && Attributes[JSON_TAG_INCLUDE_FILENAMES] != nullptr)
+        {
+            NewSource.IncludeFileNames = *(bool*)Attributes[JSON_TAG_INCLUDE_FILENAMES];
+        }
+
+        //
+        // maxReadBufferSize is an optional value, in bytes. LogFileMonitor
+        // adjusts it to its supported range.
+        //
+        if (Attributes.find(JSON_TAG_MAX_READ_BUFFER_SIZE) != Attributes.end()
+            && Attributes[JSON_TAG_MAX_READ_BUFFER_SIZE] != nullptr)
+        {
+            const double maxReadBufferSize = *(double*)Attributes[JSON_TAG_MAX_READ_BUFFER_SIZE];
+
+            NewSource.MaxReadBufferSize = (maxReadBufferSize >= MAXDWORD)
+                ? MAXDWORD
+                : (maxReadBufferSize > 0 ? static_cast<DWORD>(maxReadBufferSize) : 0);
+        }
+
+        //
+        // checkpointFile is an optional value
+        //
+        if (Attributes.find(JSON_TAG_CHECKPOINT_FILE) != Attributes.end()
+            && Attributes[JSON_TAG_CHECKPOINT_FILE] != nullptr)
+        {
+            NewSource.CheckpointFile = *(std::wstring*)Attributes[JSON_TAG_CHECKPOINT_FILE];
+        }
+
+        //
+        // checkpointIntervalSeconds is an optional value
+        //
+        if (Attributes.find(JSON_TAG_CHECKPOINT_INTERVAL) != Attributes.end()
+            && Attributes[JSON_TAG_CHECKPOINT_INTERVAL] != nullptr)
+        {
+            const double checkpointInterval = *(double*)Attributes[JSON_TAG_CHECKPOINT_INTERVAL];
+
+            NewSource.CheckpointIntervalSeconds = (checkpointInterval >= MAXDWORD)
+                ? MAXDWORD
+                : (checkpointInterval > 0 ? static_cast<DWORD>(checkpointInterval) : 0);
+        }
+
+        NewSource.UnwrapOverflowAttributes(Attributes);
+        NewSource.UnwrapRateLimitAttributes(Attributes);
+
+        return true;
+    }
+};
+
+///
+/// ETW Provider
+///
+class ETWProvider
+{
+public:
+    std::wstring ProviderName;
+    std::wstring ProviderGuidStr;
+    GUID ProviderGuid = { 0 };
+    ULONGLONG Keywords = 0;
+    UCHAR Level = 2; // Error level
+
+    //
+    // LogWriter source of the events of the provider, registered for its
+    // ETW source when the monitors are started.
+    //
+    UINT32 OutputSourceId = 0;
+
+    inline bool IsValid()
+    {
+        return !ProviderName.empty() || !ProviderGuidStr.empty();
+    }
+
+    inline bool SetProviderGuid(const std::wstring &value)
+    {
+        GUID guid;
+
+        if (!StringToGuid(value, guid))
+        {
+            return false;
+        }
+
+        ProviderGuid = guid;
+        ProviderGuidStr = value;
+
+        return true;
+    }
+
+    inline bool StringToLevel(
+        _In_ const std::wstring& Str
+    )
+    {
+        int errorLevelSize = (sizeof(LogLevelNames) / sizeof(LogLevelNames[0])); // Don't include the ALL value
+
+        for (UCHAR i = 0; i < errorLevelSize; i++)
+        {
+            if (_wcsicmp(Str.c_str(), LogLevelNames[i].c_str()) == 0)
+            {
+                //
+                // Level starts at 1
+                //
+                Level = i + 1;
+                return true;
+            }
+        }
+
+        return false;
+    }
+};
+
+///
+/// Represents a Source if ETW type
+///
+class SourceETW : LogSource
+{
+public:
+    std::vector<ETWProvider> Providers;
+    bool EventFormatMultiLine = true;
+
+    static bool Unwrap(
+        _In_ AttributesMap& Attributes,
+        _Out_ SourceETW& NewSource)
+    {
+        NewSource.Type = LogSourceType::ETW;
+
+        //
+        // Get required 'providers' value
+        //
+        if (Attributes.find(JSON_TAG_PROVIDERS) == Attributes.end()
+            || Attributes[JSON_TAG_PROVIDERS] == nullptr)
+        {
+            return false;
+        }
+
+        //
+        // Clone the array, the original one could be deleted.
+        //
+        NewSource.Providers = *(std::vector<ETWProvider>*)Attributes[JSON_TAG_PROVIDERS];
+
+        //
+        // eventFormatMultiLine is an optional value
+        //
+        if (Attributes.find(JSON_TAG_FORMAT_MULTILINE) != Attributes.end()
+            && Attributes[JSON_TAG_FORMAT_MULTILINE] != nullptr)
+        {
+            NewSource.EventFormatMultiLine = *(bool*)Attributes[JSON_TAG_FORMAT_MULTILINE];
+        }
+
+        NewSource.UnwrapOverflowAttributes(Attributes);
+        NewSource.UnwrapRateLimitAttributes(Attributes);
+
+        return true;
+    }
+};
+
+///
+/// Represents a Source of Process type, the output of the entrypoint
+/// process started by LogMonitor.
+///
+class SourceProcess : LogSource
+{
+public:
+    bool ParseJsonLines = false;
+
+    static bool Unwrap(
+        _In_ AttributesMap& Attributes,
+        _Out_ SourceProcess& NewSource)
+    {
+        NewSource.Type = LogSourceType::Process;
+
+        //
+        // parseJsonLines is an optional value
+        //
+        if (Attributes.find(JSON_TAG_PARSE_JSON_LINES) != Attributes.end()
+            && Attributes[JSON_TAG_PARSE_JSON_LINES] != nullptr)
+        {
+            NewSource.ParseJsonLines = *(bool*)Attributes[JSON_TAG_PARSE_JSON_LINES];
+        }
+
+        NewSource.UnwrapOverflowAttributes(Attributes);
+        NewSource.UnwrapRateLimitAttributes(Attributes);
+
+        return true;
+    }
+};
+
+///
+/// Information about a channel Log
+///
+///
+/// Settings of the log file, read from the 'file' object of 'output'
+///
+typedef struct _FileOutputSettings
+{
+    //
+    // Path of the log file. Empty if the lines aren't written to a file.
+    //
+    std::wstring Path;
+
+    //
+    // Zero means the RotatingFileSink defaults, except for the rotation
+    // interval, where it means no rotation by age.
+    //
+    UINT64 MaxFileSizeBytes = 0;
+    DWORD RotationIntervalSeconds = 0;
+    DWORD RetainedFiles = 5;
+    UINT64 PreallocateBytes = 0;
+
+    CompressionCodec Compression = CompressionCodec::None;
+
+    //
+    // Zero means the BlockSpoolWriter default.
+    //
+    UINT64 CompressionBlockBytes = 0;
+} FileOutputSettings;
+
+///
+/// Settings of the log collector, read from the 'network' object of 'output'
+///
+typedef struct _NetworkOutputSettings
+{
+    //
+    // Host name or address of the collector. Empty if the lines aren't
+    // sent to a collector.
+    //
+    std::wstring Host;
+
+    //
+    // Zero means the default port of the framing: 514 for syslog, 24224
+    // for Fluent Forward.
+    //
+    USHORT Port = 0;
+
+    NetworkProtocol Protocol = NetworkProtocol::Tcp;
+    NetworkFraming Framing = NetworkFraming::Syslog;
+
+    //
+    // Fluent Forward tag, or syslog APP-NAME.
+    //
+    std::wstring Tag = L"logmonitor";
+
+    //
+    // Zero means the NetworkSink defaults.
+    //
+    DWORD MaxBatchRecords = 0;
+    UINT64 MaxBatchBytes = 0;
+    DWORD MaxBatchDelayMillis = 0;
+    UINT64 MaxBufferedBytes = 0;
+    DWORD MinReconnectDelayMillis = 0;
+    DWORD MaxReconnectDelayMillis = 0;
+
+    //
+    // Directory of the DurableQueue of the lines. Empty to keep the lines
+    // in memory only. Zero sizes mean the DurableQueue defaults.
+    //
+    std::wstring QueueDirectory;
+    UINT64 QueueMaxBytes = 0;
+    UINT64 QueueSegmentBytes = 0;
+} NetworkOutputSettings;
+
+///
+/// Settings of the output of the log lines, read from the 'output' object
+///
+typedef struct _OutputSettings
+{
+    //
+    // Maximum time a line waits for other lines to be written with it. Same
+    // default as LogWriter::DEFAULT_FLUSH_LATENCY_MILLIS.
+    //
+    DWORD FlushLatencyMillis = 10;
+
+    //
+    // Maximum size of the lines waiting to be written. Zero means the
+    // LogWriter default.
+    //
+    UINT64 MaxBufferedBytes = 0;
+
+    //
+    // Interval of the reports of the lines dropped by the overflow policies.
+    // Zero means the LogWriter default.
+    //
+    DWORD DropReportIntervalSeconds = 0;
+
+    OutputFormat Format = OutputFormat::Xml;
+
+    TimestampPrecision TimePrecision = TimestampPrecision::Milliseconds;
+
+    //
+    // False if the lines are only written to the log file, or sent to the
+    // log collector.
+    //
+    bool Stdout = true;
+
+    FileOutputSettings File;
+
+    NetworkOutputSettings Network;
+} OutputSettings;
+
+typedef struct _LoggerSettings
+{
+    std::vector<std::shared_ptr<LogSource> > Sources;
+    OutputSettings Output;
+} LoggerSettings;
@@ -1,204 +1,685 @@
-//
-// Copyright (c) Microsoft Corporation.
-// Licensed under the MIT license.
-//
-
-#include "pch.h"
-
-using namespace std;
-
-#define BUFSIZE 4096
-
-HANDLE g_hChildStd_OUT_Rd = NULL;
-HANDLE g_hChildStd_OUT_Wr = NULL;
-
-DWORD CreateChildProcess(std::wstring& Cmdline);
-DWORD ReadFromPipe(LPVOID Param);
-
-///
-/// Creates a new process, and link its STDIN and STDOUT to the LogMonitor proccess' ones.
-///
-/// \param Cmdline      The command to start the new process.
-///
-/// \return Status
-///
-DWORD CreateAndMonitorProcess(std::wstring& Cmdline)
-{
-    SECURITY_ATTRIBUTES saAttr;
-    DWORD status = ERROR_SUCCESS;
-
-    //
-    // Set the bInheritHandle flag so pipe handles are inherited.
-    //
-    saAttr.nLength = sizeof(SECURITY_ATTRIBUTES);
-    saAttr.bInheritHandle = TRUE;
-    saAttr.lpSecurityDescriptor = NULL;
-
-    //
-    // Create a pipe for the child process's STDOUT.
-    //
-    if (!CreatePipe(&g_hChildStd_OUT_Rd, &g_hChildStd_OUT_Wr, &saAttr, 0))
-    {
-        status = GetLastError();
-
-        logWriter.TraceError(
-            Utility::FormatString(
-                L"Process monitor error. Failed to create stdout pipe. Error: %lu",
-                status
-            ).c_str()
-        );
-
-        return status;
-    }
-
-    //
-    // Ensure the read handle to the pipe for STDOUT is not inherited.
-    //
-    if (!SetHandleInformation(g_hChildStd_OUT_Rd, HANDLE_FLAG_INHERIT, 0))
-    {
-        status = GetLastError();
-
-        logWriter.TraceError(
-            Utility::FormatString(
-                L"Process monitor error. Failed to update handle to stdout pipe. Error: %lu",
-                status
-            ).c_str()
-        );
-
-        return status;
-    }
-
-    //
-    // Create the child process.
-    //
-
-    return CreateChildProcess(Cmdline);
-}
-
-///
-/// Create a child process that uses the previously created pipe for STDOUT.
-///
-/// \param Cmdline      The command to start the new process.
-///
-DWORD CreateChildProcess(std::wstring& Cmdline)
-{
-    PROCESS_INFORMATION piProcInfo;
-    STARTUPINFO siStartInfo;
-    bool bSuccess = false;
-    DWORD exitcode = 0;
-    wchar_t cmdl[32768]; // The maximum size of CreateProcess's lpCommandLine parameter is 32,768
-
-    ZeroMemory(&cmdl, sizeof(cmdl));
-    wcscpy_s(cmdl, 32768, Cmdline.c_str());
-
-    //
-    // Set up members of the PROCESS_INFORMATION structure.
-    //
-    ZeroMemory(&piProcInfo, sizeof(PROCESS_INFORMATION));
-
-    //
-    // Set up members of the STARTUPINFO structure.
-    // This structure specifies the STDIN and STDOUT handles for redirection.
-    //
-    ZeroMemory(&siStartInfo, sizeof(STARTUPINFO));
-    siStartInfo.cb = sizeof(STARTUPINFO);
-    siStartInfo.hStdError = g_hChildStd_OUT_Wr; // redirect errors too to avoid log interleaving
-    siStartInfo.hStdOutput = g_hChildStd_OUT_Wr;
-    siStartInfo.hStdInput = GetStdHandle(STD_INPUT_HANDLE);
-    siStartInfo.dwFlags |= STARTF_USESTDHANDLES;
-
-    //
-    // Create the child process.
-    //
-    bSuccess = CreateProcess(NULL,
-                             cmdl,          // command line
-                             NULL,          // process security attributes
-                             NULL,          // primary thread security attributes
-                             TRUE,          // handles are inherited
-                             0,             // creation flags
-                             NULL,          // use parent's environment
-                             NULL,          // use parent's current directory
-                             &siStartInfo,  // STARTUPINFO pointer
-                             &piProcInfo);  // receives PROCESS_INFORMATION
-
-//
-// If an error occurs, exit the application.
-//
-    if (!bSuccess)
-    {
-        exitcode = GetLastError();
-
-        logWriter.TraceError(
-            Utility::FormatString(L"Failed to start entrypoint process. Error: %lu", exitcode).c_str()
-        );
-    }
-    else
-    {
-        CreateThread(NULL, 0, (LPTHREAD_START_ROUTINE)&ReadFromPipe, NULL, 0, NULL);
-        WaitForSingleObject(piProcInfo.hProcess, INFINITE);
-
-        if (GetExitCodeProcess(piProcInfo.hProcess, &exitcode))
-        {
-            logWriter.TraceInfo(
-                Utility::FormatString(L"Entrypoint processs exit code: %d", exitcode).c_str()
-            );
-        }
-        else
-        {
-            logWriter.TraceError(
-                Utility::FormatString(
-                    L"Process monitor error. Failed to get entrypoint process exit code. Error: %d",
-                    GetLastError()
-                ).c_str()
-            );
-        }
-
-        //
-        // Close handles to the child process and its primary thread.
-        //
-        CloseHandle(piProcInfo.hProcess);
-        CloseHandle(piProcInfo.hThread);
-    }
-
-    return exitcode;
-}
-
-///
-/// Read output from the child process's pipe for STDOUT
-/// and write to the parent process's pipe for STDOUT.
-/// Stop when there is no more data.
-///
-/// \param Param        UNUSED.
-///
-DWORD ReadFromPipe(LPVOID Param)
-{
-    DWORD dwRead, dwWritten;
-    char chBuf[BUFSIZE];
-    bool bSuccess = false;
-    HANDLE hParentStdOut = GetStdHandle(STD_OUTPUT_HANDLE);
-
-    UNREFERENCED_PARAMETER(Param);
-
-    for (;;)
-    {
-        bSuccess = ReadFile(g_hChildStd_OUT_Rd, chBuf, BUFSIZE, &dwRead, NULL);
-
-        if (!bSuccess || dwRead == 0)
-        {
-            break;
-        }
-
-        bSuccess = logWriter.WriteLog(hParentStdOut,
-                                      chBuf,
-                                      dwRead,
-                                      &dwWritten,
-                                      NULL);
-
-        if (!bSuccess)
-        {
-            break;
-        }
-    }
-
-    return ERROR_SUCCESS;
-}
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+
+#include "pch.h"
+
+using namespace std;
+
+constexpr DWORD ProcessOutputRelay::PIPE_BUFFER_BYTES;
+constexpr DWORD ProcessOutputRelay::READ_BUFFER_BYTES;
+
+//
+// Time the output of the child process is still read after it exited. A
+// process it started can keep the pipes open.
+//
+static constexpr DWORD c_ProcessOutputDrainMillis = 5000;
+
+HANDLE g_hChildStd_OUT_Rd = NULL;
+HANDLE g_hChildStd_OUT_Wr = NULL;
+HANDLE g_hChildStd_ERR_Rd = NULL;
+HANDLE g_hChildStd_ERR_Wr = NULL;
+
+DWORD CreateOutputPipe(LPCWSTR Name, SECURITY_ATTRIBUTES& Attributes, HANDLE& ReadPipe, HANDLE& WritePipe);
+DWORD CreateChildProcess(std::wstring& Cmdline, std::shared_ptr<LogSource> Source);
+
+///
+/// Creates a new process, and link its STDIN to the LogMonitor proccess' one,
+/// and its STDOUT and STDERR to the LogWriter.
+///
+/// \param Cmdline      The command to start the new process.
+/// \param Source       The Process source of the configuration, or null to
+///                     write the output of the process as it is.
+///
+/// \return Status
+///
+DWORD CreateAndMonitorProcess(std::wstring& Cmdline, std::shared_ptr<LogSource> Source)
+{
+    SECURITY_ATTRIBUTES saAttr;
+    DWORD status = ERROR_SUCCESS;
+
+    //
+    // Set the bInheritHandle flag so pipe handles are inherited.
+    //
+    saAttr.nLength = sizeof(SECURITY_ATTRIBUTES);
+    saAttr.bInheritHandle = TRUE;
+    saAttr.lpSecurityDescriptor = NULL;
+
+    status = CreateOutputPipe(L"stdout", saAttr, g_hChildStd_OUT_Rd, g_hChildStd_OUT_Wr);
+
+    if (status != ERROR_SUCCESS)
+    {
+        return status;
+    }
+
+    status = CreateOutputPipe(L"stderr", saAttr, g_hChildStd_ERR_Rd, g_hChildStd_ERR_Wr);
+
+    if (status != ERROR_SUCCESS)
+    {
+        return status;
+    }
+
+    //
+    // Create the child process.
+    //
+
+    return CreateChildProcess(Cmdline, std::move(Source));
+}
+
+///
+/// Creates a pipe for an output stream of the child process.
+///
+/// \param Name         Name of the stream, for the traces.
+/// \param Attributes   Security attributes of the pipe, with inheritable handles.
+/// \param ReadPipe     Returns the read handle, not inherited.
+/// \param WritePipe    Returns the write handle, inherited by the child process.
+///
+/// \return Status
+///
+DWORD CreateOutputPipe(LPCWSTR Name, SECURITY_ATTRIBUTES& Attributes, HANDLE& ReadPipe, HANDLE& WritePipe)
+{
+    DWORD status = ERROR_SUCCESS;
+
+    if (!CreatePipe(&ReadPipe, &WritePipe, &Attributes, ProcessOutputRelay::PIPE_BUFFER_BYTES))
+    {
+        status = GetLastError();
+
+        logWriter.TraceError(
+            FORMAT_STRING(
+                L"Process monitor error. Failed to create %s pipe. Error: %lu",
+                Name,
+                status
+            ).c_str()
+        );
+
+        return status;
+    }
+
+    //
+    // Ensure the read handle to the pipe is not inherited.
+    //
+    if (!SetHandleInformation(ReadPipe, HANDLE_FLAG_INHERIT, 0))
+    {
+        status = GetLastError();
+
+        logWriter.TraceError(
+            FORMAT_STRING(
+                L"Process monitor error. Failed to update handle to %s pipe. Error: %lu",
+                Name,
+                status
+            ).c_str()
+        );
+
+        return status;
+    }
+
+    return status;
+}
+
+///
+/// Create a child process that uses the previously created pipes for STDOUT
+/// and STDERR.
+///
+/// \param Cmdline      The command to start the new process.
+/// \param Source       The Process source of the configuration, or null.
+///
+DWORD CreateChildProcess(std::wstring& Cmdline, std::shared_ptr<LogSource> Source)
+{
+    PROCESS_INFORMATION piProcInfo;
+    STARTUPINFO siStartInfo;
+    bool bSuccess = false;
+    DWORD exitcode = 0;
+    wchar_t cmdl[32768]; // The maximum size of CreateProcess's lpCommandLine parameter is 32,768
+
+    ZeroMemory(&cmdl, sizeof(cmdl));
+    wcscpy_s(cmdl, 32768, Cmdline.c_str());
+
+    //
+    // Set up members of the PROCESS_INFORMATION structure.
+    //
+    ZeroMemory(&piProcInfo, sizeof(PROCESS_INFORMATION));
+
+    //
+    // Set up members of the STARTUPINFO structure.
+    // This structure specifies the STDIN, STDOUT and STDERR handles for redirection.
+    //
+    ZeroMemory(&siStartInfo, sizeof(STARTUPINFO));
+    siStartInfo.cb = sizeof(STARTUPINFO);
+    siStartInfo.hStdError = g_hChildStd_ERR_Wr;
+    siStartInfo.hStdOutput = g_hChildStd_OUT_Wr;
+    siStartInfo.hStdInput = GetStdHandle(STD_INPUT_HANDLE);
+    siStartInfo.dwFlags |= STARTF_USESTDHANDLES;
+
+    //
+    // Create the child process.
+    //
+    bSuccess = CreateProcess(NULL,
+                             cmdl,          // command line
+                             NULL,          // process security attributes
+                             NULL,          // primary thread security attributes
+                             TRUE,          // handles are inherited
+                             0,             // creation flags
+                             NULL,          // use parent's environment
+                             NULL,          // use parent's current directory
+                             &siStartInfo,  // STARTUPINFO pointer
+                             &piProcInfo);  // receives PROCESS_INFORMATION
+
+    //
+    // The child has its own handles to the write ends of the pipes. Closing
+    // ours lets the reads end once the child closed them.
+    //
+    CloseHandle(g_hChildStd_OUT_Wr);
+    CloseHandle(g_hChildStd_ERR_Wr);
+    g_hChildStd_OUT_Wr = NULL;
+    g_hChildStd_ERR_Wr = NULL;
+
+    //
+    // Without a Process source, the output isn't dropped nor limited. Each
+    // stream has its own rate limit.
+    //
+    const OverflowPolicy overflow = Source ? Source->Overflow : OverflowPolicy::Block;
+    const DWORD overflowSampleRate = Source ? Source->OverflowSampleRate : 1;
+    const DWORD rateLimit = Source ? Source->RateLimit : 0;
+    const DWORD rateLimitBurst = Source ? Source->RateLimitBurst : 0;
+
+    //
+    // The relays own the read ends of the pipes.
+    //
+    ProcessOutputRelay stdoutRelay(
+        g_hChildStd_OUT_Rd,
+        logWriter.RegisterSource(L"Process stdout", overflow, overflowSampleRate, rateLimit, rateLimitBurst));
+    ProcessOutputRelay stderrRelay(
+        g_hChildStd_ERR_Rd,
+        logWriter.RegisterSource(L"Process stderr", overflow, overflowSampleRate, rateLimit, rateLimitBurst));
+
+    g_hChildStd_OUT_Rd = NULL;
+    g_hChildStd_ERR_Rd = NULL;
+
+    if (Source)
+    {
+        std::shared_ptr<SourceProcess> sourceProcess = std::reinterpret_pointer_cast<SourceProcess>(Source);
+
+        stdoutRelay.SetProcessSource("stdout", sourceProcess->ParseJsonLines);
+        stderrRelay.SetProcessSource("stderr", sourceProcess->ParseJsonLines);
+    }
+
+//
+// If an error occurs, exit the application.
+//
+    if (!bSuccess)
+    {
+        exitcode = GetLastError();
+
+        logWriter.TraceError(
+            FORMAT_STRING(L"Failed to start entrypoint process. Error: %lu", exitcode).c_str()
+        );
+    }
+    else
+    {
+        ProcessOutputRelay* relays[] = { &stdoutRelay, &stderrRelay };
+
+        for (ProcessOutputRelay* relay : relays)
+        {
+            const DWORD status = relay->Start();
+
+            if (status != ERROR_SUCCESS)
+            {
+                logWriter.TraceError(
+                    FORMAT_STRING(
+                        L"Process monitor error. Failed to start reading the output of the entrypoint process. Error: %lu",
+                        status
+                    ).c_str()
+                );
+            }
+        }
+
+        WaitForSingleObject(piProcInfo.hProcess, INFINITE);
+
+        //
+        // Write the last lines of the child before its exit code.
+        //
+        const ULONGLONG exitTime = GetTickCount64();
+
+        for (ProcessOutputRelay* relay : relays)
+        {
+            const ULONGLONG elapsed = GetTickCount64() - exitTime;
+
+            relay->WaitForEnd(
+                static_cast<DWORD>(c_ProcessOutputDrainMillis - (std::min)(elapsed, static_cast<ULONGLONG>(c_ProcessOutputDrainMillis))));
+            relay->Stop();
+        }
+
+        if (GetExitCodeProcess(piProcInfo.hProcess, &exitcode))
+        {
+            logWriter.TraceInfo(
+                FORMAT_STRING(L"Entrypoint processs exit code: %d", exitcode).c_str()
+            );
+        }
+        else
+        {
+            logWriter.TraceError(
+                FORMAT_STRING(
+                    L"Process monitor error. Failed to get entrypoint process exit code. Error: %d",
+                    GetLastError()
+                ).c_str()
+            );
+        }
+
+        //
+        // Close handles to the child process and its primary thread.
+        //
+        CloseHandle(piProcInfo.hProcess);
+        CloseHandle(piProcInfo.hThread);
+    }
+
+    return exitcode;
+}
+
+///
+/// \param Pipe             Read handle of the pipe. Closed by the relay.
+/// \param OutputSourceId   Id returned by LogWriter::RegisterSource for the
+///                         stream.
+/// \param Writer           The LogWriter the lines are written to.
+///
+ProcessOutputRelay::ProcessOutputRelay(
+    _In_ HANDLE Pipe,
+    _In_ UINT32 OutputSourceId,
+    _In_ LogWriter& Writer
+    ) :
+    m_pipe(Pipe),
+    m_outputSourceId(OutputSourceId),
+    m_writer(Writer)
+{
+    m_decoder.SetEncoding(UTF8);
+}
+
+ProcessOutputRelay::~ProcessOutputRelay()
+{
+    Stop();
+
+    if (m_pipe != NULL && m_pipe != INVALID_HANDLE_VALUE)
+    {
+        CloseHandle(m_pipe);
+    }
+}
+
+///
+/// Starts the reader thread.
+///
+/// \return ERROR_SUCCESS, or the error of CreateThread.
+///
+DWORD
+ProcessOutputRelay::Start()
+{
+    if (m_readerThread != NULL)
+    {
+        return ERROR_SUCCESS;
+    }
+
+    m_buffer.resize(READ_BUFFER_BYTES);
+
+    m_readerThread = CreateThread(NULL, 0, ReaderThreadStatic, this, 0, NULL);
+
+    if (m_readerThread == NULL)
+    {
+        return GetLastError();
+    }
+
+    return ERROR_SUCCESS;
+}
+
+///
+/// Waits until the pipe is closed by all the processes that write to it,
+/// and its last line is written.
+///
+/// \return False if the pipe is still open after the timeout.
+///
+bool
+ProcessOutputRelay::WaitForEnd(
+    _In_ DWORD TimeoutMillis
+    )
+{
+    return m_readerThread == NULL || WaitForSingleObject(m_readerThread, TimeoutMillis) == WAIT_OBJECT_0;
+}
+
+///
+/// Stops reading the pipe, and writes the incomplete last line, if any.
+///
+void
+ProcessOutputRelay::Stop()
+{
+    if (m_readerThread == NULL)
+    {
+        return;
+    }
+
+    m_stopping = true;
+
+    //
+    // Cancel the read the reader is blocked in. The reader can also be
+    // about to start a read, so the cancel is repeated until it exits.
+    //
+    while (WaitForSingleObject(m_readerThread, 10) == WAIT_TIMEOUT)
+    {
+        CancelSynchronousIo(m_readerThread);
+    }
+
+    CloseHandle(m_readerThread);
+    m_readerThread = NULL;
+}
+
+///
+/// Makes the stream a stream of a Process source. Called before Start.
+///
+/// \param StreamName       Name of the stream, "stdout" or "stderr".
+/// \param ParseJsonLines   Write the members of the lines that are JSON
+///                         objects as fields.
+///
+void
+ProcessOutputRelay::SetProcessSource(
+    _In_ const std::string& StreamName,
+    _In_ bool ParseJsonLines
+    )
+{
+    m_streamName = StreamName;
+    m_parseJsonLines = ParseJsonLines;
+    m_detectEncoding = true;
+}
+
+///
+/// \return The statistics of the lines written. Only complete once the
+///     relay is stopped.
+///
+ProcessOutputRelay::Statistics
+ProcessOutputRelay::GetStatistics() const
+{
+    Statistics statistics;
+
+    statistics.Lines = m_lines.load();
+    statistics.Bytes = m_bytes.load();
+    statistics.Reads = m_reads.load();
+
+    return statistics;
+}
+
+DWORD
+ProcessOutputRelay::ReaderThreadStatic(
+    _In_ LPVOID Context
+    )
+{
+    static_cast<ProcessOutputRelay*>(Context)->ReaderThread();
+
+    return ERROR_SUCCESS;
+}
+
+///
+/// Reads the pipe until it's closed, or the relay is stopped.
+///
+void
+ProcessOutputRelay::ReaderThread()
+{
+    const LogLineDecoder::LineCallback onLine = [this](const char* Line, size_t Length)
+    {
+        WriteLine(Line, Length);
+    };
+
+    while (!m_stopping)
+    {
+        DWORD read = 0;
+
+        //
+        // Fails with ERROR_BROKEN_PIPE once the pipe is closed, or with
+        // ERROR_OPERATION_ABORTED when Stop cancels it.
+        //
+        if (!ReadFile(m_pipe, m_buffer.data(), READ_BUFFER_BYTES, &read, NULL) || read == 0)
+        {
+            break;
+        }
+
+        m_reads++;
+        m_bytes += read;
+
+        BYTE* data = m_buffer.data();
+
+        if (m_detectEncoding)
+        {
+            m_detectEncoding = false;
+
+            UINT bomSize = 0;
+            const LM_FILETYPE encoding = LogFileMonitor::FileTypeFromBuffer(data, read, data, read, bomSize);
+
+            if (encoding != FileTypeUnknown)
+            {
+                m_decoder.SetEncoding(encoding);
+            }
+
+            data += bomSize;
+            read -= bomSize;
+        }
+
+        GetSystemTimePreciseAsFileTime(&m_readTime);
+
+        m_decoder.Decode(data, read, onLine);
+    }
+
+    m_decoder.Flush(onLine);
+}
+
+void
+ProcessOutputRelay::WriteLine(
+    _In_reads_(Length) const char* Line,
+    _In_ size_t Length
+    )
+{
+    if (m_streamName.empty())
+    {
+        m_lineBuffer.assign(Line, Length);
+    }
+    else
+    {
+        FormatLine(Line, Length);
+    }
+
+    m_writer.WriteConsoleLog(std::move(m_lineBuffer), m_outputSourceId);
+    m_lines++;
+}
+
+///
+/// Formats a line of a Process source in the output format.
+///
+void
+ProcessOutputRelay::FormatLine(
+    _In_reads_(Length) const char* Line,
+    _In_ size_t Length
+    )
+{
+    m_lineBuffer.clear();
+
+    const bool parsed = m_parseJsonLines && m_jsonParser.Parse(Line, Length);
+
+    if (m_writer.GetOutputFormat() == OutputFormat::Json)
+    {
+        JsonLineWriter json(m_lineBuffer);
+
+        json.BeginObject();
+        json.Key("Source");
+        json.String("Process");
+        json.Key("LogEntry");
+        json.BeginObject();
+        json.Key("Time");
+        json.Time(m_readTime);
+        json.Key("Stream");
+        json.String(m_streamName.data(), m_streamName.size());
+
+        if (parsed)
+        {
+            json.Key("Fields");
+            json.Raw(Line, Length);
+        }
+        else
+        {
+            json.Key("Logline");
+            json.String(Line, Length);
+        }
+
+        json.EndObject();
+        json.EndObject();
+
+        return;
+    }
+
+    m_lineBuffer.append("<Source>Process</Source><Time>");
+    TimestampFormatter::ForCurrentThread().Append(m_lineBuffer, m_readTime);
+    m_lineBuffer.append("</Time><LogEntry><Stream>");
+    m_lineBuffer.append(m_streamName);
+    m_lineBuffer.append("</Stream>");
+
+    if (parsed)
+    {
+        for (const JsonLineParser::Member& field : m_jsonParser.GetMembers())
+        {
+            AppendXmlField(field);
+        }
+    }
+    else
+    {
+        m_lineBuffer.append("<Logline>");
+        m_lineBuffer.append(Line, Length);
+        m_lineBuffer.append("</Logline>");
+    }
+
+    m_lineBuffer.append("</LogEntry>");
+}
+
+///
+/// Appends a member of a JSON line as an element named after it. A string
+/// is unescaped, with its line breaks replaced by spaces so the line isn't
+/// split; any other value is its JSON text.
+///
+/// A member whose name isn't a valid XML name is written as a Field element,
+/// with the name in its Name attribute.
+///
+void
+ProcessOutputRelay::AppendXmlField(
+    _In_ const JsonLineParser::Member& Field
+    )
+{
+    const size_t nameOffset = m_lineBuffer.size() + 1;
+
+    m_lineBuffer.push_back('<');
+    JsonLineParser::AppendUnescaped(m_lineBuffer, Field.Name, Field.NameLength);
+
+    size_t nameLength = m_lineBuffer.size() - nameOffset;
+
+    if (!IsXmlName(m_lineBuffer.data() + nameOffset, nameLength))
+    {
+        const std::string name(m_lineBuffer, nameOffset, nameLength);
+
+        m_lineBuffer.resize(nameOffset);
+        m_lineBuffer.append("Field");
+        nameLength = m_lineBuffer.size() - nameOffset;
+
+        m_lineBuffer.append(" Name=\"");
+        AppendXmlAttributeValue(m_lineBuffer, name.data(), name.size());
+        m_lineBuffer.push_back('"');
+    }
+
+    m_lineBuffer.push_back('>');
+
+    if (Field.Type == JsonLineParser::ValueType::String)
+    {
+        const size_t valueOffset = m_lineBuffer.size();
+
+        JsonLineParser::AppendUnescaped(m_lineBuffer, Field.Value, Field.ValueLength);
+
+        std::replace_if(
+            m_lineBuffer.begin() + valueOffset,
+            m_lineBuffer.end(),
+            [](char ch) { return ch == '\r' || ch == '\n'; },
+            ' ');
+    }
+    else
+    {
+        m_lineBuffer.append(Field.Value, Field.ValueLength);
+    }
+
+    m_lineBuffer.append("</");
+    m_lineBuffer.append(m_lineBuffer, nameOffset, nameLength);
+    m_lineBuffer.push_back('>');
+}
+
+///
+/// Checks that a UTF-8 string can be the name of an element. It starts with
+/// a letter or an underscore, then has letters, digits, '-', '.' or '_'. The
+/// non-ASCII characters are taken as letters, and ':' isn't allowed so the
+/// name has no namespace prefix.
+///
+bool
+ProcessOutputRelay::IsXmlName(
+    _In_reads_(Length) const char* Name,
+    _In_ size_t Length
+    )
+{
+    if (Length == 0)
+    {
+        return false;
+    }
+
+    for (size_t i = 0; i < Length; i++)
+    {
+        const unsigned char ch = static_cast<unsigned char>(Name[i]);
+
+        if ((ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z') || ch == '_' || ch >= 0x80)
+        {
+            continue;
+        }
+
+        if (i == 0 || !((ch >= '0' && ch <= '9') || ch == '-' || ch == '.'))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+///
+/// Appends a string to a double-quoted attribute value, with its markup
+/// characters and line breaks replaced by references.
+///
+void
+ProcessOutputRelay::AppendXmlAttributeValue(
+    _Inout_ std::string& Buffer,
+    _In_reads_(Length) const char* Value,
+    _In_ size_t Length
+    )
+{
+    for (size_t i = 0; i < Length; i++)
+    {
+        switch (Value[i])
+        {
+            case '&':
+                Buffer.append("&amp;");
+                break;
+            case '<':
+                Buffer.append("&lt;");
+                break;
+            case '>':
+                Buffer.append("&gt;");
+                break;
+            case '"':
+                Buffer.append("&quot;");
+                break;
+            case '\r':
+                Buffer.append("&#13;");
+                break;
+            case '\n':
+                Buffer.append("&#10;");
+                break;
+            default:
+                Buffer.push_back(Value[i]);
+                break;
+        }
+    }
+}
@@ -1,9 +1,137 @@
-//
-// Copyright (c) Microsoft Corporation.
-// Licensed under the MIT license.
-//
-
-#pragma once
-
-DWORD CreateAndMonitorProcess(std::wstring& Cmdline);
-
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+
+#pragma once
+
+DWORD CreateAndMonitorProcess(std::wstring& Cmdline, std::shared_ptr<LogSource> Source = nullptr);
+
+///
+/// Relays a stream of the output of the child process, stdout or stderr, to
+/// the LogWriter, as the lines of its own source.
+///
+/// A reader thread reads the pipe in chunks of READ_BUFFER_BYTES, splits
+/// them into lines with a LogLineDecoder, and writes each complete line with
+/// WriteConsoleLog. The lines are then batched with the lines of the other
+/// sources by the writer thread, and a line is never split by the output of
+/// LogMonitor. The incomplete line at the end of a chunk is kept until its
+/// line break is read, and written when the stream ends.
+///
+/// The output is decoded as UTF-8, the encoding of the output of LogMonitor.
+/// CR LF and CR line breaks are replaced by the line break of the output.
+///
+/// SetProcessSource makes the stream the stream of a Process source: its
+/// encoding is detected from its first chunk, like the encoding of a log
+/// file, and each line is written in the output format, with the time it
+/// was read and the name of the stream. With ParseJsonLines, the members of
+/// a line that is a JSON object are written as fields: the line is written
+/// as it is in the JSON output format, and each member as an element in the
+/// XML one.
+///
+class ProcessOutputRelay final
+{
+public:
+    //
+    // Size of the buffers of the pipes, so a child writing at full speed
+    // isn't blocked by each read of LogMonitor.
+    //
+    static constexpr DWORD PIPE_BUFFER_BYTES = 64 * 1024;
+    static constexpr DWORD READ_BUFFER_BYTES = 64 * 1024;
+
+    struct Statistics
+    {
+        UINT64 Lines = 0;
+        UINT64 Bytes = 0;
+        UINT64 Reads = 0;
+    };
+
+    ProcessOutputRelay(
+        _In_ HANDLE Pipe,
+        _In_ UINT32 OutputSourceId,
+        _In_ LogWriter& Writer = logWriter
+        );
+
+    ~ProcessOutputRelay();
+
+    ProcessOutputRelay(const ProcessOutputRelay&) = delete;
+    ProcessOutputRelay& operator=(const ProcessOutputRelay&) = delete;
+
+    DWORD Start();
+
+    bool WaitForEnd(
+        _In_ DWORD TimeoutMillis
+        );
+
+    void Stop();
+
+    void SetProcessSource(
+        _In_ const std::string& StreamName,
+        _In_ bool ParseJsonLines
+        );
+
+    Statistics GetStatistics() const;
+
+private:
+    HANDLE m_pipe;
+    UINT32 m_outputSourceId;
+    LogWriter& m_writer;
+
+    HANDLE m_readerThread = NULL;
+    std::atomic<bool> m_stopping{ false };
+
+    //
+    // Used by the reader thread only.
+    //
+    std::vector<BYTE> m_buffer;
+    LogLineDecoder m_decoder;
+    std::string m_lineBuffer;
+
+    //
+    // Empty if the lines are written as they are.
+    //
+    std::string m_streamName;
+    bool m_parseJsonLines = false;
+    bool m_detectEncoding = false;
+    JsonLineParser m_jsonParser;
+
+    //
+    // Time of the read of the current chunk, the time of its lines.
+    //
+    FILETIME m_readTime{};
+
+    std::atomic<UINT64> m_lines{ 0 };
+    std::atomic<UINT64> m_bytes{ 0 };
+    std::atomic<UINT64> m_reads{ 0 };
+
+    static DWORD ReaderThreadStatic(
+        _In_ LPVOID Context
+        );
+
+    void ReaderThread();
+
+    void WriteLine(
+        _In_reads_(Length) const char* Line,
+        _In_ size_t Length
+        );
+
+    void FormatLine(
+        _In_reads_(Length) const char* Line,
+        _In_ size_t Length
+        );
+
+    void AppendXmlField(
+        _In_ const JsonLineParser::Member& Field
+        );
+
+    static bool IsXmlName(
+        _In_reads_(Length) const char* Name,
+        _In_ size_t Length
+        );
+
+    static void AppendXmlAttributeValue(
+        _Inout_ std::string& Buffer,
+        _In_reads_(Length) const char* Value,
+        _In_ size_t Length
+        );
+};
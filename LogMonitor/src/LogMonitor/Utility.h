@@ -1,47 +1,57 @@
-//
-// Copyright (c) Microsoft Corporation.
-// Licensed under the MIT license.
-//
-
-#pragma once
-
-class Utility final
-{
-public:
-    static std::wstring SystemTimeToString(
-        SYSTEMTIME SystemTime
-    );
-
-    static std::wstring FileTimeToString(
-        FILETIME FileTime
-    );
-
-    static std::wstring FormatString(
-        _In_ _Printf_format_string_ LPCWSTR FormatString,
-        ...
-    );
-
-    static bool IsTextUTF8(
-        _In_ LPCSTR InputStream,
-        _In_ int Length
-    );
-
-    static bool IsInputTextUnicode(
-        _In_ LPCSTR InputStream,
-        _In_ int Length
-    );
-
-    static std::wstring GetShortPath(
-        _In_ const std::wstring& Path
-    );
-
-    static std::wstring GetLongPath(
-        _In_ const std::wstring& Path
-    );
-
-    static std::wstring ReplaceAll(
-        _In_ std::wstring Str,
-        _In_ const std::wstring& From,
-        _In_ const std::wstring& To
-    );
-};
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+
+#pragma once
+
+class Utility final
+{
+public:
+    static std::wstring SystemTimeToString(
+        SYSTEMTIME SystemTime
+    );
+
+    static std::wstring FileTimeToString(
+        FILETIME FileTime
+    );
+
+    static bool IsTextUTF8(
+        _In_ LPCSTR InputStream,
+        _In_ int Length
+    );
+
+    static bool IsInputTextUnicode(
+        _In_ LPCSTR InputStream,
+        _In_ int Length
+    );
+
+    static std::wstring GetShortPath(
+        _In_ const std::wstring& Path
+    );
+
+    static std::wstring GetLongPath(
+        _In_ const std::wstring& Path
+    );
+
+    static std::wstring ReplaceAll(
+        _In_ std::wstring Str,
+        _In_ const std::wstring& From,
+        _In_ const std::wstring& To
+    );
+
+    static void AppendUtf8(
+        _Inout_ std::string& Destination,
+        _In_reads_(Length) const wchar_t* Source,
+        _In_ size_t Length
+    );
+
+    static std::string WideToUtf8(
+        _In_ const std::wstring& Str
+    );
+
+    static std::wstring Utf8ToWide(
+        _In_reads_(Length) const char* Source,
+        _In_ size_t Length
+    );
+};
@@ -1,59 +1,88 @@
-//
-// Copyright (c) Microsoft Corporation.
-// Licensed under the MIT license.
-//
-#ifndef PCH_H
-#define PCH_H
-
-// TODO(annandaa): reorder the header files as per convention.
-// currently there are some implicit dependencies, things break when
-// you try to reorder.
-
-#include <functional>
-#include <conio.h>
-#include <stdio.h>
-#include <array>
-#include <memory>
-#include <variant>
-#include <cstdint>
-#include <string>
-#include <algorithm>
-#include <sstream>
-#include <vector>
-#include <queue>
-#include <map>
-#include <stdexcept>
-#include <Windows.h>
-#include <cctype>
-#include <sal.h>
-#include <winevt.h>
-#include <wbemidl.h>
-#include <wmistr.h>
-#include <evntrace.h>
-#include <tdh.h>
-#include <in6addr.h>
-#include <winsock.h>
-#include <time.h>
-#include <iostream>
-#include <tchar.h>
-#include <strsafe.h>
-#include <fstream>
-#include <streambuf>
-#include <system_error>
-#include <locale>
-#include <codecvt>
-#include "shlwapi.h"
-#include <io.h> 
-#include <fcntl.h>
-#include "Utility.h"
-#include "Parser/ConfigFileParser.h"
-#include "Parser/LoggerSettings.h"
-#include "Parser/JsonFileParser.h"
-#include "LogWriter.h"
-#include "EtwMonitor.h"
-#include "EventMonitor.h"
-#include "FileMonitor/Utilities.h"
-#include "LogFileMonitor.h"
-#include "ProcessMonitor.h"
-
-#endif //PCH_H
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+#ifndef PCH_H
+#define PCH_H
+
+// TODO(annandaa): reorder the header files as per convention.
+// currently there are some implicit dependencies, things break when
+// you try to reorder.
+
+#include <functional>
+#include <conio.h>
+#include <stdio.h>
+#include <array>
+#include <memory>
+#include <variant>
+#include <cstdint>
+#include <string>
+#include <algorithm>
+#include <sstream>
+#include <vector>
+#include <queue>
+#include <map>
+#include <list>
+#include <unordered_map>
+#include <stdexcept>
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <Windows.h>
+#include <cctype>
+#include <sal.h>
+#include <winevt.h>
+#include <wbemidl.h>
+#include <wmistr.h>
+#include <evntrace.h>
+#include <tdh.h>
+#include <in6addr.h>
+#include <time.h>
+#include <iostream>
+#include <tchar.h>
+#include <strsafe.h>
+#include <fstream>
+#include <streambuf>
+#include <system_error>
+#include <atomic>
+#include <type_traits>
+#include <locale>
+#include <codecvt>
+#include "shlwapi.h"
+#include <io.h> 
+#include <fcntl.h>
+#include "Output/Formatter.h"
+#include "Output/TimestampFormatter.h"
+#include "Output/BlockCodec.h"
+#include "Output/Lz4BlockCodec.h"
+#include "Utility.h"
+#include "LruCache.h"
+#include "Parser/ConfigFileParser.h"
+#include "Parser/LoggerSettings.h"
+#include "Parser/JsonFileParser.h"
+#include "Parser/JsonLineParser.h"
+#include "Output/LogRecordRing.h"
+#include "Output/TokenBucket.h"
+#include "Output/JsonLineWriter.h"
+#include "Output/BlockSpool.h"
+#include "Output/RotatingFileSink.h"
+#include "Output/DurableQueue.h"
+#include "Output/NetworkSink.h"
+#include "LogWriter.h"
+#include "EtwMonitor.h"
+#include "EventRenderer.h"
+#include "EventMonitor.h"
+#include "FileMonitor/Utilities.h"
+#include "FileMonitor/CaseFoldedPath.h"
+#include "FileMonitor/LogLineDecoder.h"
+#include "FileMonitor/AdaptiveReadBuffer.h"
+#include "FileMonitor/LogFileCheckpoint.h"
+#include "FileMonitor/LogReaderPool.h"
+#include "FileMonitor/DirectoryWatcher.h"
+#include "FileMonitor/Win32DirectoryWatcher.h"
+#include "FileMonitor/InotifyEventParser.h"
+#include "FileMonitor/InotifyDirectoryWatcher.h"
+#include "FileMonitor/DirChangeEventQueue.h"
+#include "LogFileMonitor.h"
+#include "ProcessMonitor.h"
+
+#endif //PCH_H
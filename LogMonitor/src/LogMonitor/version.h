@@ -1,16 +1,16 @@
-//
-// Copyright (c) Microsoft Corporation.
-// Licensed under the MIT license.
-//
-
-#ifndef _VERSION_H_
-#define _VERSION_H_
-
-#define LM_MAJORNUMBER          1
-#define LM_MINORNUMBER          2
-#define LM_BUILDNUMBER          1
-#ifndef LM_BUILDMINORVERSION
-#define LM_BUILDMINORVERSION    0
-#endif
-
-#endif
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+
+#ifndef _VERSION_H_
+#define _VERSION_H_
+
+#define LM_MAJORNUMBER          1
+#define LM_MINORNUMBER          2
+#define LM_BUILDNUMBER          1
+#ifndef LM_BUILDMINORVERSION
+#define LM_BUILDMINORVERSION    0
+#endif
+
+#endif